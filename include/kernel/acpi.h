@@ -599,4 +599,29 @@ int acpi_pci_lookup_irq(const char* bridge_path,
 // Returns current counter value, or 0 if PM Timer unavailable.
 uint32_t acpi_read_pmtimer(void);
 
+// ============================================================================
+// Processor Idle States (_CST)
+// ============================================================================
+
+#define ACPI_CSTATE_MAX         8
+
+// How a C-state is entered
+#define ACPI_CSTATE_HALT        0   // HLT instruction
+#define ACPI_CSTATE_MWAIT       1   // MWAIT with the hint in mwait_hint
+#define ACPI_CSTATE_SYSTEMIO    2   // Read of io_port (legacy chipset C2/C3)
+
+typedef struct {
+    uint8_t type;               // 1 = C1, 2 = C2, 3 = C3
+    uint8_t entry;              // ACPI_CSTATE_*
+    uint32_t mwait_hint;        // EAX for MWAIT (ACPI_CSTATE_MWAIT)
+    uint16_t io_port;           // Port to read (ACPI_CSTATE_SYSTEMIO)
+    uint32_t latency_us;        // Worst-case exit latency
+    uint32_t power_mw;          // Average power consumption
+} acpi_cstate_t;
+
+// Evaluate _CST of the first processor object that has one.  Firmware
+// describes the same states for every CPU on all supported platforms.
+// Returns the number of states stored in out (0 if there is no _CST).
+int acpi_get_cstates(acpi_cstate_t* out, int max_out);
+
 #endif // _KERNEL_ACPI_H_
@@ -0,0 +1,32 @@
+// LikeOS-64 - CPU Idle States
+// MONITOR/MWAIT idle loop with C-states from ACPI _CST, falling back to HLT.
+// An idle CPU in MWAIT watches its idle task's need_resched, so a remote
+// wakeup only has to write that flag instead of sending a reschedule IPI.
+
+#ifndef _KERNEL_CPUIDLE_H_
+#define _KERNEL_CPUIDLE_H_
+
+#include "types.h"
+
+struct k_sched_idlestats;
+
+// Pick the idle method and C-states (BSP, after acpi_init())
+void cpuidle_init(void);
+
+// Idle this CPU once.  Returns after an interrupt or when need_resched of
+// the idle task is set; the caller then reschedules if needed.
+void cpuidle_enter(void);
+
+// Close the idle interval of this CPU (residency accounting).  Called by
+// the idle loop and when the idle task is switched away from an interrupt.
+void cpuidle_exit(void);
+
+// Wake cpu_id if it is polling need_resched in MWAIT.  Returns true if the
+// flag write alone wakes it, false if a reschedule IPI is still needed.
+bool cpuidle_kick_polling(uint32_t cpu_id);
+
+// Per-CPU residency and IPI counters for SCHEDCTL_IDLESTATS
+int cpuidle_get_stats(uint32_t cpu_id, struct k_sched_idlestats* out);
+void cpuidle_reset_stats(void);
+
+#endif // _KERNEL_CPUIDLE_H_
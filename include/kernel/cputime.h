@@ -0,0 +1,97 @@
+// LikeOS-64 - Precise CPU time accounting
+// ============================================================================
+// Every CPU is always in one accounting context: user, system or hard IRQ.
+// Each kernel entry and exit (syscall, exception, interrupt) and each
+// context switch charges the TSC cycles since the CPU's last stamp to the
+// context it is leaving: user and system time to the current task, IRQ
+// time to the CPU.  A task switched out keeps its context (the way it keeps
+// its preempt_count) and gets it back when it is switched in.
+//
+// Cycles are converted to nanoseconds only when read.  Threads that exit
+// fold their time into the group leader, and a reaped child's totals are
+// added to the reaper's children totals (getrusage RUSAGE_CHILDREN, times).
+// ============================================================================
+
+#ifndef _KERNEL_CPUTIME_H_
+#define _KERNEL_CPUTIME_H_
+
+#include "types.h"
+#include "percpu.h"
+#include "timer.h"
+
+// Accounting contexts (percpu_t::cputime_ctx, task_t::cputime_ctx).  Zeroed
+// CPUs and tasks start in system context.
+#define CPUTIME_SYS     0
+#define CPUTIME_USER    1
+#define CPUTIME_IRQ     2
+
+// Charge the cycles since cpu's stamp to its current context.  Idle and
+// bootstrap time is not charged to anyone; the first event on a CPU only
+// starts the clock.  Interrupts must be off.
+static inline void cputime_charge(percpu_t* cpu, task_t* t, uint64_t now) {
+    uint64_t delta = now - cpu->cputime_stamp;
+    if (!cpu->cputime_stamp || now < cpu->cputime_stamp) {
+        delta = 0;
+    }
+    cpu->cputime_stamp = now;
+    if (cpu->cputime_ctx == CPUTIME_IRQ) {
+        cpu->irq_time_tsc += delta;
+    } else if (t && t != cpu->idle_task && t->id != 0) {
+        if (cpu->cputime_ctx == CPUTIME_USER) {
+            t->utime_tsc += delta;
+        } else {
+            t->stime_tsc += delta;
+        }
+    }
+}
+
+// Enter accounting context ctx; returns the previous one for the matching
+// exit.  Safe from any context.
+static inline int cputime_switch(int ctx) {
+    uint64_t flags = local_irq_save();
+    percpu_t* cpu = this_cpu();
+    int prev = cpu->cputime_ctx;
+    cputime_charge(cpu, cpu->current_task, timer_rdtsc());
+    cpu->cputime_ctx = ctx;
+    local_irq_restore(flags);
+    return prev;
+}
+
+// Context switch: close prev's interval and hand over the accounting
+// context.  Called with interrupts off right before ctx_switch_asm.
+static inline void cputime_task_switch(percpu_t* cpu, task_t* prev, task_t* next) {
+    cputime_charge(cpu, prev, timer_rdtsc());
+    prev->cputime_ctx = cpu->cputime_ctx;
+    cpu->cputime_ctx = next->cputime_ctx;
+}
+
+// Zero a new task's times; it is first switched in in context ctx
+static inline void cputime_task_init(task_t* t, int ctx) {
+    t->utime_tsc = 0;
+    t->stime_tsc = 0;
+    t->cputime_ctx = ctx;
+    t->dead_utime_tsc = 0;
+    t->dead_stime_tsc = 0;
+    t->cutime_tsc = 0;
+    t->cstime_tsc = 0;
+}
+
+// TSC cycles to nanoseconds (0 if the TSC was never calibrated)
+uint64_t cputime_to_ns(uint64_t tsc);
+
+// User and system time in nanoseconds: of one thread; of a whole thread
+// group including exited threads; of the group's reaped children.  Time
+// the caller's own CPU has not charged yet is flushed first.
+void cputime_thread(task_t* t, uint64_t* utime_ns, uint64_t* stime_ns);
+void cputime_group(task_t* t, uint64_t* utime_ns, uint64_t* stime_ns);
+void cputime_children(task_t* t, uint64_t* utime_ns, uint64_t* stime_ns);
+
+// A thread is leaving its group: fold its time into the leader.  Caller
+// holds g_task_list_lock.
+void cputime_thread_exit(task_t* leader, task_t* thread);
+
+// parent reaped child: add the child's group and children totals to the
+// parent group's children totals
+void cputime_reap(task_t* parent, task_t* child);
+
+#endif // _KERNEL_CPUTIME_H_
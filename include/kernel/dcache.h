@@ -7,7 +7,8 @@
 // Supports negative dentries (not-found results) to speed up $PATH
 // lookups where most candidates miss.
 //
-// SMP-safe with per-bucket spinlocks.
+// Lookups walk the hash chains locklessly under rcu_read_lock(); updates
+// take per-bucket spinlocks and free entries after an RCU grace period.
 
 #ifndef _KERNEL_DCACHE_H_
 #define _KERNEL_DCACHE_H_
@@ -63,9 +64,11 @@ typedef struct dc_entry {
 
     // State
     uint32_t        flags;
+    volatile uint8_t referenced;        // Hit since the LRU last looked at it
 
-    // Hash chain (per-bucket singly-linked list)
+    // Hash chain (per-bucket singly-linked list, RCU-protected)
     struct dc_entry* hash_next;
+    rcu_head_t      rcu;
 
     // Global LRU doubly-linked list
     struct dc_entry* lru_prev;
@@ -81,7 +84,8 @@ void dcache_init(void);
 
 // Look up a dentry. Returns a pointer to the cached entry, or NULL on miss.
 // If the returned entry has DC_NEGATIVE set, the name was looked up before
-// and confirmed not to exist.
+// and confirmed not to exist.  The caller must hold rcu_read_lock() for as
+// long as it uses the entry.
 dc_entry_t* dcache_lookup(unsigned long parent_cluster, const char *name);
 
 // Insert a positive dentry (found result) into the cache.
@@ -0,0 +1,28 @@
+// LikeOS-64 - Event Notification Files (eventfd)
+// ============================================================================
+// An eventfd is a 64-bit counter behind a file descriptor.  write() adds
+// to it and wakes readers; read() returns the counter and resets it to 0,
+// or with EFD_SEMAPHORE returns 1 and decrements it.  Reads block while the
+// counter is 0 and writes block while the addition would overflow past
+// 0xfffffffffffffffe.  The fd is readable while the counter is non-zero
+// and writable while it is below that maximum, so it works with poll,
+// select, epoll and io_uring as a cheap cross-thread wakeup.
+// ============================================================================
+
+#ifndef _KERNEL_EVENTFD_H_
+#define _KERNEL_EVENTFD_H_
+
+#include "types.h"
+#include "vfs.h"
+
+// eventfd2() flags
+#define EFD_SEMAPHORE   0x00001
+#define EFD_NONBLOCK    0x00800     // O_NONBLOCK
+#define EFD_CLOEXEC     0x80000     // O_CLOEXEC
+
+#define EFD_COUNT_MAX   0xfffffffffffffffeULL
+
+// Create an eventfd file with the counter set to initval
+int eventfd_create(unsigned int initval, int flags, vfs_file_t** out);
+
+#endif // _KERNEL_EVENTFD_H_
@@ -0,0 +1,48 @@
+// LikeOS-64 - Event Poll (epoll)
+// ============================================================================
+// An epoll instance is a file holding an interest list of (fd, events)
+// items.  Adding an item hooks a wait entry onto each wait queue the fd's
+// poll function names (see poll.h); when the source wakes its queue the
+// item goes on the instance's ready list and one epoll_wait() caller is
+// woken.  epoll_wait() only looks at the ready list, so its cost follows
+// the number of ready fds rather than the number watched.
+//
+//  - Level-triggered items are put back on the ready list after being
+//    reported and drop off once a re-poll finds them idle.
+//  - EPOLLET items are reported once per wakeup of their source.
+//  - EPOLLONESHOT items are disabled after one report until EPOLL_CTL_MOD.
+//  - EPOLLEXCLUSIVE items wait on their source exclusively, so an event
+//    wakes one of several instances watching the same fd, not all.
+//
+// Items are keyed by (fd table entry, fd) like Linux's (file, fd), so an
+// item stays registered while its file is still open through a dup, and
+// goes away when the file's last reference is closed.  Epoll fds can watch
+// each other up to EP_MAX_NESTS deep; loops are refused with ELOOP.
+// ============================================================================
+
+#ifndef _KERNEL_EVENTPOLL_H_
+#define _KERNEL_EVENTPOLL_H_
+
+#include "types.h"
+#include "vfs.h"
+#include "net.h"
+
+#define EP_MAX_NESTS    4
+
+// Create an epoll file; flags is 0 or EPOLL_CLOEXEC
+int epoll_create_internal(int flags, vfs_file_t** out);
+
+// Returns 1 if the file is an epoll instance
+int epoll_is_epoll(vfs_file_t* f);
+
+int epoll_ctl_internal(vfs_file_t* epf, int op, int fd, struct epoll_event* event);
+
+// timeout_ns: 0 = don't block, KTIME_MAX = block until an event
+int epoll_wait_internal(vfs_file_t* epf, struct epoll_event* events,
+                        int maxevents, uint64_t timeout_ns);
+
+// Drop every item watching `file` (an fd table entry); called when the
+// file's last reference goes away, before it is freed
+void eventpoll_release(void* file);
+
+#endif // _KERNEL_EVENTPOLL_H_
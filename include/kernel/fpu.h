@@ -0,0 +1,91 @@
+// LikeOS-64 - FPU / SIMD Extended State Management
+// Per-task x87/SSE/AVX register state saved with XSAVE(OPT)/XRSTOR (or
+// FXSAVE/FXRSTOR on CPUs without XSAVE), and the kernel_fpu_begin/end
+// bracket for kernel code that uses SIMD registers.
+
+#ifndef _KERNEL_FPU_H_
+#define _KERNEL_FPU_H_
+
+#include "types.h"
+
+struct task;
+
+// ============================================================================
+// XSAVE State Components (XCR0 bits)
+// ============================================================================
+
+#define XFEATURE_X87            (1ULL << 0)
+#define XFEATURE_SSE            (1ULL << 1)
+#define XFEATURE_AVX            (1ULL << 2)     // YMM upper halves
+#define XFEATURE_OPMASK         (1ULL << 5)     // AVX-512 k0-k7
+#define XFEATURE_ZMM_HI256      (1ULL << 6)     // ZMM0-15 upper halves
+#define XFEATURE_HI16_ZMM       (1ULL << 7)     // ZMM16-31
+#define XFEATURE_AVX512         (XFEATURE_OPMASK | XFEATURE_ZMM_HI256 | XFEATURE_HI16_ZMM)
+
+// Save areas must be 64-byte aligned for XSAVE (16 for FXSAVE)
+#define FPU_ALIGN               64
+#define FPU_LEGACY_SIZE         512             // FXSAVE image / XSAVE legacy region
+#define FPU_XSAVE_HDR_SIZE      64              // XSAVE header following the legacy region
+
+// Default control words loaded for new tasks and after execve
+#define FPU_DEFAULT_FCW         0x037F          // All x87 exceptions masked, 64-bit precision
+#define FPU_DEFAULT_MXCSR       0x1F80          // All SSE exceptions masked, round-to-nearest
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+// Detect XSAVE/AVX features, program XCR0 and size the save area (BSP)
+void fpu_init_boot(void);
+
+// Enable the FPU features chosen by fpu_init_boot() on an AP
+void fpu_init_cpu(void);
+
+// Size in bytes of one task's save area
+uint32_t fpu_state_size(void);
+
+// Enabled XCR0 feature mask (XFEATURE_X87 | XFEATURE_SSE without XSAVE)
+uint64_t fpu_xfeatures(void);
+
+// ============================================================================
+// Per-Task State
+// ============================================================================
+
+// Give a user task a save area holding the initial FPU state
+int fpu_task_alloc(struct task* t);
+
+// Give child a copy of parent's current FPU state (fork / clone)
+int fpu_task_fork(struct task* child, struct task* parent);
+
+// Release a task's save area
+void fpu_task_free(struct task* t);
+
+// Reset the current task's FPU state to the initial state (execve)
+void fpu_task_reset(struct task* t);
+
+// Write the live registers of t (if this CPU holds them) to its save area
+void fpu_task_sync(struct task* t);
+
+// Sanitize a save image supplied by user space (sigreturn) and load it as
+// the current task's state.  Returns -EINVAL if the task has no FPU state.
+int fpu_task_load_image(struct task* t, const void* image);
+
+// Save prev's registers and load next's.  Called with IRQs disabled just
+// before the stack switch.
+void fpu_switch(struct task* prev, struct task* next);
+
+// ============================================================================
+// Kernel SIMD Use
+// ============================================================================
+
+// Bracket kernel code that touches x87/SSE/AVX registers.  Saves the
+// current task's user state if it is live, and disables interrupts until
+// the matching kernel_fpu_end().  Calls may nest.
+void kernel_fpu_begin(void);
+void kernel_fpu_end(void);
+
+// Sum of the native-endian 16-bit words of buf (SSE2).  len must be a
+// multiple of 16 and at most 256 KiB.  Caller must hold kernel_fpu_begin().
+uint64_t fpu_csum16(const void* buf, size_t len);
+
+#endif // _KERNEL_FPU_H_
@@ -40,13 +40,17 @@
 // Initialize the futex hash table (called once during kernel init)
 void futex_init(void);
 
+// `shared` is set for operations without FUTEX_PRIVATE_FLAG: a futex in a
+// MAP_SHARED page is then keyed by physical address so other processes
+// mapping the page can wake it.  In private memory it makes no difference.
+
 // Futex wait: block until futex value changes or timeout
 // Returns: 0 on success, -EAGAIN if value changed, -ETIMEDOUT on timeout
-int futex_wait(uint64_t uaddr, uint32_t expected_val, uint64_t timeout_ns);
+int futex_wait(uint64_t uaddr, uint32_t expected_val, uint64_t timeout_ns, bool shared);
 
 // Futex wake: wake up to nr_wake waiters
 // Returns: number of waiters woken
-int futex_wake(uint64_t uaddr, int nr_wake);
+int futex_wake(uint64_t uaddr, int nr_wake, bool shared);
 
 // Like futex_wake but uses a specific task's PML4 for key computation.
 // Use when performing futex operations on behalf of a task that may differ
@@ -55,7 +59,7 @@ int futex_wake_for_task(uint64_t uaddr, int nr_wake, task_t* on_behalf_of);
 
 // Futex requeue: wake some waiters and move others to a different futex
 // Returns: total number of waiters processed (woken + requeued)
-int futex_requeue(uint64_t uaddr, uint64_t uaddr2, int nr_wake, int nr_requeue);
+int futex_requeue(uint64_t uaddr, uint64_t uaddr2, int nr_wake, int nr_requeue, bool shared);
 
 // ============================================================================
 // ROBUST FUTEX SUPPORT
@@ -0,0 +1,91 @@
+// LikeOS-64 - High-Resolution Timers
+// ============================================================================
+// One-shot timers with nanosecond expiry times on the monotonic clock
+// (ktime_get_ns(), the precise clock behind CLOCK_MONOTONIC).  Armed timers
+// sit in a red-black tree ordered by expiry; every CPU's timer tick runs
+// the ones that are due, so a timer fires on the first tick on any CPU at
+// or after its expiry.  The LAPIC timers of different CPUs are not phase
+// locked, which on SMP spreads those checks across the tick period.
+//
+// Callbacks run in hard IRQ context with no hrtimer lock held.  One that
+// returns HRTIMER_RESTART is queued again at its (updated) expiry; use
+// hrtimer_forward() to step a periodic timer past the current time.
+//
+// hrtimer_try_to_cancel() never waits and returns -1 while the callback is
+// running on another CPU; a caller holding a lock the callback takes must
+// drop it and retry.  hrtimer_cancel() spins until the callback is done.
+// ============================================================================
+
+#ifndef _KERNEL_HRTIMER_H_
+#define _KERNEL_HRTIMER_H_
+
+#include "types.h"
+#include "rbtree.h"
+#include "timer.h"
+
+#define NSEC_PER_SEC        1000000000ULL
+#define NSEC_PER_USEC       1000ULL
+#define KTIME_MAX           ((uint64_t)-1)
+
+typedef enum {
+    HRTIMER_NORESTART,
+    HRTIMER_RESTART,
+} hrtimer_restart_t;
+
+struct hrtimer;
+typedef hrtimer_restart_t (*hrtimer_func_t)(struct hrtimer* timer);
+
+typedef struct hrtimer {
+    struct rb_node node;
+    uint64_t expires;           // ktime_get_ns() value at which to fire
+    hrtimer_func_t function;
+    int queued;                 // In the tree (base lock)
+} hrtimer_t;
+
+// A timer that wakes a task, for sleeping with a timeout.  The task
+// pointer is cleared when the timer fires, so hrtimer_sleeper_expired()
+// tells a timeout from another wakeup.  Cancel it before it goes out of
+// scope.
+struct task;
+typedef struct hrtimer_sleeper {
+    hrtimer_t timer;
+    struct task* task;
+} hrtimer_sleeper_t;
+
+// Nanoseconds since boot
+static inline uint64_t ktime_get_ns(void) {
+    return timer_get_precise_us() * NSEC_PER_USEC;
+}
+
+void hrtimer_init(hrtimer_t* timer, hrtimer_func_t function);
+
+// Arm (or re-arm) the timer to fire at the absolute time `expires`
+void hrtimer_start(hrtimer_t* timer, uint64_t expires);
+
+// Return 1 if the timer was armed and is now disarmed, 0 if it was not
+// armed, -1 if its callback is running
+int hrtimer_try_to_cancel(hrtimer_t* timer);
+
+// Disarm and wait for a running callback; return 1 if it was armed
+int hrtimer_cancel(hrtimer_t* timer);
+
+void hrtimer_init_sleeper(hrtimer_sleeper_t* sl, struct task* task);
+
+static inline bool hrtimer_sleeper_expired(const hrtimer_sleeper_t* sl) {
+    return __atomic_load_n(&sl->task, __ATOMIC_ACQUIRE) == NULL;
+}
+
+static inline bool hrtimer_is_queued(const hrtimer_t* timer) {
+    return __atomic_load_n(&timer->queued, __ATOMIC_RELAXED) != 0;
+}
+
+// Advance the expiry of a periodic timer by whole intervals until it is
+// after `now`.  Returns the number of intervals skipped (0 if the timer
+// had not expired yet).  Only for a timer that is not queued, e.g. from
+// its own callback.
+uint64_t hrtimer_forward(hrtimer_t* timer, uint64_t now, uint64_t interval);
+
+// Run expired timers; called from every CPU's timer tick
+void hrtimer_run_queues(void);
+
+#endif // _KERNEL_HRTIMER_H_
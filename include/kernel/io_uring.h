@@ -0,0 +1,150 @@
+// LikeOS-64 - Submission/Completion Rings (io_uring)
+// ============================================================================
+// A ring fd owns two queues shared with user space: the submission queue
+// (an index array plus an array of 64-byte SQEs) and the completion queue
+// (16-byte CQEs).  User space fills SQEs and advances the SQ tail, then
+// io_uring_enter() consumes them; completions are posted to the CQ and
+// user space advances the CQ head as it reaps them.  The layout and the
+// SQE/CQE formats follow Linux, so the mmap offsets and opcode numbers
+// match <linux/io_uring.h>.
+//
+// Operations run in the context of the task that submitted them: one that
+// can finish without blocking (a regular file, or a socket or pipe that is
+// already ready) completes inside io_uring_enter().  One that would block
+// is parked on the ring and hooked onto its fd's wait queues; when the fd
+// wakes them, a task waiting in io_uring_enter() retries it.
+//
+// Parked requests only make progress while a task of the submitter's
+// address space is inside io_uring_enter(): there is no kernel thread to
+// issue them, and the hooks are dropped when the call returns.  An
+// application that parks requests must keep calling io_uring_enter()
+// with IORING_ENTER_GETEVENTS to see them complete.  Timeouts are delayed
+// work on system_wq and post their completion from the worker.
+//
+// Nothing is handed to a worker to run asynchronously, so an SQE that
+// sets IOSQE_ASYNC fails with -EINVAL rather than being issued inline.
+// ============================================================================
+
+#ifndef _KERNEL_IO_URING_H_
+#define _KERNEL_IO_URING_H_
+
+#include "types.h"
+
+#define IO_URING_MAX_ENTRIES    1024    // SQ entries; the CQ may be up to twice that
+
+// Opcodes (Linux numbering; the gaps are not implemented)
+#define IORING_OP_NOP           0
+#define IORING_OP_READV         1
+#define IORING_OP_WRITEV        2
+#define IORING_OP_FSYNC         3
+#define IORING_OP_POLL_ADD      6
+#define IORING_OP_TIMEOUT       11
+#define IORING_OP_ACCEPT        13
+#define IORING_OP_CONNECT       16
+#define IORING_OP_READ          22
+#define IORING_OP_WRITE         23
+#define IORING_OP_SEND          26
+#define IORING_OP_RECV          27
+
+// io_uring_sqe::flags
+#define IOSQE_FIXED_FILE        (1U << 0)   // Not supported
+#define IOSQE_IO_DRAIN          (1U << 1)   // Not supported
+#define IOSQE_IO_LINK           (1U << 2)   // Start the next SQE when this one succeeds
+#define IOSQE_IO_HARDLINK       (1U << 3)   // Start the next SQE however this one ends
+#define IOSQE_ASYNC             (1U << 4)   // Not supported (-EINVAL)
+#define IOSQE_CQE_SKIP_SUCCESS  (1U << 6)   // No CQE unless the op fails
+
+// io_uring_sqe::timeout_flags
+#define IORING_TIMEOUT_ETIME_SUCCESS (1U << 5)  // Expiry does not break a link
+
+// io_uring_params::flags
+#define IORING_SETUP_CQSIZE     (1U << 3)   // cq_entries is valid
+#define IORING_SETUP_CLAMP      (1U << 4)   // Clamp sizes instead of failing
+
+// io_uring_params::features
+#define IORING_FEAT_SINGLE_MMAP (1U << 0)   // SQ and CQ rings share one mapping
+
+// io_uring_enter() flags
+#define IORING_ENTER_GETEVENTS  (1U << 0)
+
+// mmap() offsets on the ring fd
+#define IORING_OFF_SQ_RING      0ULL
+#define IORING_OFF_CQ_RING      0x8000000ULL
+#define IORING_OFF_SQES         0x10000000ULL
+
+struct io_uring_sqe {
+    uint8_t  opcode;
+    uint8_t  flags;         // IOSQE_*
+    uint16_t ioprio;
+    int32_t  fd;
+    uint64_t off;           // File offset, -1 = current; addrlen pointer for
+                            // ACCEPT, addrlen for CONNECT, count for TIMEOUT
+    uint64_t addr;          // Buffer, iovec array, sockaddr or timespec
+    uint32_t len;           // Buffer length or iovec count
+    uint32_t op_flags;      // poll events, msg_flags, accept or timeout flags
+    uint64_t user_data;     // Copied to the CQE
+    uint16_t buf_index;
+    uint16_t personality;
+    int32_t  splice_fd_in;
+    uint64_t __pad2[2];
+};
+
+struct io_uring_cqe {
+    uint64_t user_data;
+    int32_t  res;           // Result, or negative errno
+    uint32_t flags;
+};
+
+struct io_sqring_offsets {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t flags;
+    uint32_t dropped;
+    uint32_t array;
+    uint32_t resv1;
+    uint64_t resv2;
+};
+
+struct io_cqring_offsets {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t overflow;
+    uint32_t cqes;
+    uint32_t flags;
+    uint32_t resv1;
+    uint64_t resv2;
+};
+
+struct io_uring_params {
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t flags;
+    uint32_t sq_thread_cpu;
+    uint32_t sq_thread_idle;
+    uint32_t features;
+    uint32_t wq_fd;
+    uint32_t resv[3];
+    struct io_sqring_offsets sq_off;
+    struct io_cqring_offsets cq_off;
+};
+
+struct vfs_file;
+
+// Create a ring for `entries` submissions (rounded up to a power of two)
+// and fill in *p.  Returns 0 and the ring's file, or a negative errno.
+int io_uring_create(uint32_t entries, struct io_uring_params* p, struct vfs_file** out);
+
+// The ring behind an fd table entry, or NULL if the entry is not a ring
+struct io_ring_ctx* io_uring_from_file(void* entry);
+
+// Consume up to to_submit SQEs, then with IORING_ENTER_GETEVENTS wait
+// until min_complete CQEs are available.  Returns the number of SQEs
+// consumed, or a negative errno if none were.
+int64_t io_uring_enter(struct io_ring_ctx* ctx, uint32_t to_submit,
+                       uint32_t min_complete, uint32_t flags);
+
+#endif // _KERNEL_IO_URING_H_
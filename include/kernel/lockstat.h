@@ -0,0 +1,25 @@
+// LikeOS-64 - Lock Statistics
+// ============================================================================
+// Optional per-class spinlock contention and hold-time accounting, enabled
+// by building with LOCKSTAT=1.  Locks sharing a name form one class.  The
+// report is read through SYS_LOCKSTAT (see the lockstat(1) tool).
+// ============================================================================
+
+#ifndef _KERNEL_LOCKSTAT_H_
+#define _KERNEL_LOCKSTAT_H_
+
+#include "types.h"
+
+struct k_lockstat_entry;
+
+// 1 if the kernel was built with LOCKSTAT=1
+int lockstat_enabled(void);
+
+// Fill *out with the index'th registered class.  Returns 1 if filled, 0
+// past the last class, -ENOSYS when the kernel was built without LOCKSTAT.
+int lockstat_get(int index, struct k_lockstat_entry* out);
+
+// Zero every class's counters (-ENOSYS without LOCKSTAT)
+int lockstat_reset(void);
+
+#endif // _KERNEL_LOCKSTAT_H_
@@ -65,6 +65,7 @@ uint64_t mm_get_kernel_heap_start(void);
 #define PAGE_SIZE_FLAG          0x080
 #define PAGE_GLOBAL             0x100
 #define PAGE_COW                0x200       // Copy-on-Write marker (available bit)
+#define PAGE_SHARED             0x400       // MAP_SHARED page, never COW (available bit)
 #define PAGE_NO_EXECUTE         0x8000000000000000ULL
 
 // Physical address mask for extracting physical address from page table entries
@@ -304,6 +305,9 @@ void mm_remove_smp_identity_map(uint64_t physical_addr, size_t size);
 // Global flag indicating SMAP is active (use stac/clac only when true)
 extern bool g_smap_enabled;
 
+// Set when the CPU has Enhanced REP MOVSB (see uaccess.c)
+extern bool g_cpu_has_erms;
+
 // SMAP control functions for user memory access
 // Call smap_disable() before accessing user memory, smap_enable() after
 void smap_disable(void);  // Execute STAC if SMAP is enabled
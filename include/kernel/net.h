@@ -6,6 +6,9 @@
 
 #include "types.h"
 #include "sched.h"  // spinlock_t
+#include "wait.h"
+#include "poll.h"
+#include "uio.h"
 
 // ============================================================================
 // Network Configuration
@@ -713,6 +716,9 @@ typedef struct net_socket {
     spinlock_t lock;
     int active;
     int ref_count;
+
+    // poll/epoll watchers; woken whenever sock_poll() may report differently
+    wait_queue_head_t wq;
 } net_socket_t;
 
 // ============================================================================
@@ -881,6 +887,12 @@ int  sock_recvfrom(int sockfd, void* buf, size_t len, int flags,
                    struct sockaddr_in* src_addr, socklen_t* addrlen);
 int  sock_send(int sockfd, const void* buf, size_t len, int flags);
 int  sock_recv(int sockfd, void* buf, size_t len, int flags);
+// The same over every segment of an iterator (readv/writev, sendmsg/recvmsg)
+int  sock_sendto_iter(int sockfd, iov_iter_t* it, int flags,
+                      const struct sockaddr_in* dest_addr, socklen_t addrlen);
+int  sock_recvfrom_iter(int sockfd, iov_iter_t* it, int flags,
+                        struct sockaddr_in* src_addr, socklen_t* addrlen);
+int  sock_recv_iter(int sockfd, iov_iter_t* it, int flags);
 int  sock_close(int sockfd);
 int  sock_shutdown(int sockfd, int how);
 int  sock_setsockopt(int sockfd, int level, int optname,
@@ -904,10 +916,7 @@ void net_timer_tick(void);
 // Socket FD Markers (stored in fd_table[] alongside vfs_file_t* and pipe markers)
 // ============================================================================
 #define SOCKET_FD_BASE      0x10000UL
-#define EPOLL_FD_BASE       0x20000UL
 #define UNIX_SOCKET_FD_BASE 0x30000UL
-#define MAX_EPOLL_INSTANCES 32
-#define MAX_EPOLL_ENTRIES   64
 #define MAX_UNIX_SOCKETS    64
 
 #define IS_SOCKET_FD(ptr)   ((uintptr_t)(ptr) >= SOCKET_FD_BASE && \
@@ -915,11 +924,6 @@ void net_timer_tick(void);
 #define SOCKET_FD_IDX(ptr)  ((int)((uintptr_t)(ptr) - SOCKET_FD_BASE))
 #define MAKE_SOCKET_FD(idx) ((struct vfs_file*)(SOCKET_FD_BASE + (unsigned)(idx)))
 
-#define IS_EPOLL_FD(ptr)    ((uintptr_t)(ptr) >= EPOLL_FD_BASE && \
-                             (uintptr_t)(ptr) < EPOLL_FD_BASE + MAX_EPOLL_INSTANCES)
-#define EPOLL_FD_IDX(ptr)   ((int)((uintptr_t)(ptr) - EPOLL_FD_BASE))
-#define MAKE_EPOLL_FD(idx)  ((struct vfs_file*)(EPOLL_FD_BASE + (unsigned)(idx)))
-
 #define IS_UNIX_SOCKET_FD(ptr)  ((uintptr_t)(ptr) >= UNIX_SOCKET_FD_BASE && \
                                  (uintptr_t)(ptr) < UNIX_SOCKET_FD_BASE + MAX_UNIX_SOCKETS)
 #define UNIX_SOCKET_FD_IDX(ptr) ((int)((uintptr_t)(ptr) - UNIX_SOCKET_FD_BASE))
@@ -928,11 +932,6 @@ void net_timer_tick(void);
 // ============================================================================
 // Scatter/Gather I/O (sendmsg/recvmsg)
 // ============================================================================
-struct iovec {
-    void*  iov_base;
-    size_t iov_len;
-};
-
 struct msghdr {
     void*         msg_name;       // Optional address
     socklen_t     msg_namelen;    // Size of address
@@ -992,8 +991,13 @@ typedef struct {
 #define EPOLLRDBAND     0x080
 #define EPOLLWRNORM     0x100
 #define EPOLLWRBAND     0x200
-#define EPOLLONESHOT    (1 << 30)
-#define EPOLLET         (1 << 31)
+#define EPOLLRDHUP      0x2000
+#define EPOLLEXCLUSIVE  (1U << 28)
+#define EPOLLWAKEUP     (1U << 29)
+#define EPOLLONESHOT    (1U << 30)
+#define EPOLLET         (1U << 31)
+
+#define EPOLL_CLOEXEC   0x80000     // O_CLOEXEC
 
 typedef union epoll_data {
     void*    ptr;
@@ -1007,19 +1011,6 @@ struct epoll_event {
     epoll_data_t data;
 } __attribute__((packed));
 
-// Epoll instance (kernel internal)
-typedef struct {
-    int active;
-    struct {
-        int      fd;
-        uint32_t events;
-        uint64_t data;
-        int      oneshot_triggered;
-    } entries[MAX_EPOLL_ENTRIES];
-    int nentries;
-    spinlock_t lock;
-} epoll_instance_t;
-
 // ============================================================================
 // Network Interface Ioctls (Linux-compatible values)
 // ============================================================================
@@ -1150,21 +1141,25 @@ int  sock_socketpair(int domain, int type, int protocol, int sv[2]);
 int  sock_accept4(int sockfd, struct sockaddr_in* addr, socklen_t* addrlen, int flags);
 int  sock_sendmsg(int sockfd, const struct msghdr* msg, int flags);
 int  sock_recvmsg(int sockfd, struct msghdr* msg, int flags);
-int  sock_poll(int sockfd, short events);
+int  sock_poll(int sockfd, short events, poll_table_t* pt);
 int  sock_ioctl_net(int sockfd, unsigned long request, void* argp);
 int  sock_fcntl_net(int sockfd, int cmd, unsigned long arg);
 net_socket_t* sock_get(int sockfd);
 
 // ============================================================================
-// Poll / Select / Epoll API (kernel-side)
+// Poll / Select API (kernel-side); epoll is in eventpoll.h
 // ============================================================================
+// timeout_ns: 0 = don't block, KTIME_MAX (hrtimer.h) = no timeout
 int  sys_select_internal(int nfds, fd_set* readfds, fd_set* writefds,
-                         fd_set* exceptfds, uint64_t timeout_ticks);
-int  sys_poll_internal(struct pollfd* fds, int nfds, uint64_t timeout_ticks);
-int  epoll_create_internal(int flags);
-int  epoll_ctl_internal(int epfd_idx, int op, int fd, struct epoll_event* event);
-int  epoll_wait_internal(int epfd_idx, struct epoll_event* events,
-                         int maxevents, uint64_t timeout_ticks);
+                         fd_set* exceptfds, uint64_t timeout_ns);
+int  sys_poll_internal(struct pollfd* fds, int nfds, uint64_t timeout_ns);
+short fd_poll_one(int fd, short events);   // revents of one fd, never blocks
+// revents of an fd table entry; with a table, also names its wait queues
+short fd_entry_poll(void* entry, short events, poll_table_t* pt);
+// Pin an fd table entry as dup() would; returns the reference to put, or NULL
+void* fd_entry_get(void* entry);
+void fd_entry_put(void* ref);
+void* fd_get(int fd);                       // ...of the current task's fd
 int  net_ioctl(unsigned long request, void* argp);
 
 // ============================================================================
@@ -1245,6 +1240,9 @@ typedef struct unix_socket {
 
     spinlock_t lock;
     int ref_count;
+
+    // poll/epoll watchers; woken whenever unix_poll() may report differently
+    wait_queue_head_t wq;
 } unix_socket_t;
 
 // UNIX domain socket API
@@ -1259,7 +1257,7 @@ int  unix_close(int usockfd);
 int  unix_socketpair(int type, int sv[2]);
 int  unix_shutdown(int usockfd, int how);
 unix_socket_t* unix_get(int usockfd);
-int  unix_poll(int usockfd, short events);
+int  unix_poll(int usockfd, short events, poll_table_t* pt);
 /* SCM_RIGHTS file-descriptor passing helpers.  push() enqueues an
  * fd_table entry (already ref-counted by caller) onto the receiver's
  * queue; pop() removes the head entry.  Both return 0 on success or a
@@ -1365,7 +1363,6 @@ int  net_get_udp_sockets(net_udp_info_t* entries, int max_entries);
 int  net_get_iface_info(net_iface_info_t* entries, int max_entries);
 int  dhcp_release(net_device_t* dev);
 int  dhcp_renew(net_device_t* dev);
-void dhcp_tick(void);
 int  dhcp_get_status(void);
 // Invalidate the cached lease without sending a RELEASE.  Called by
 // link drivers on a link-DOWN edge so the next dhcp_renew() will
@@ -107,6 +107,12 @@ pc_page_t* pagecache_get(unsigned long cluster_id, unsigned long page_index,
                          unsigned long file_size,
                          struct fat32_fs* fs, unsigned long start_cluster);
 
+// Take a reference on the data page of a cached page, for holders outside
+// the cache (splice into a pipe).  Eviction then leaves the page to the
+// holder, who drops it with mm_decref_page().  Returns the physical page,
+// or 0 if it is not cached.
+uint64_t pagecache_ref_page(unsigned long cluster_id, unsigned long page_index);
+
 // Insert a page into the cache (used internally and by write path).
 // The caller provides a page with data already filled in.
 // If a page with the same key exists, returns the existing one.
@@ -121,7 +127,7 @@ void pagecache_mark_dirty(pc_page_t* page);
 // Called on close, fsync. Acquires fat32_io_lock internally.
 int pagecache_flush_file(unsigned long cluster_id);
 
-// Flush all dirty pages globally. Called by periodic writeback timer.
+// Flush all dirty pages globally. Called by the periodic writeback work.
 int pagecache_flush_all(void);
 
 // Sync: flush all + block sync. Called by sync() syscall.
@@ -170,10 +176,4 @@ typedef struct pc_stats {
 
 void pagecache_get_stats(pc_stats_t* stats);
 
-// --- Timer callback ---
-
-// Called from timer IRQ handler every PC_WRITEBACK_INTERVAL ticks.
-// Schedules dirty writeback (deferred to a non-IRQ context).
-void pagecache_timer_tick(uint64_t ticks);
-
 #endif // _KERNEL_PAGECACHE_H_
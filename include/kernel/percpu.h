@@ -50,25 +50,44 @@ struct percpu {
     // Idle task for this CPU
     task_t* idle_task;
     
-    // Preemption control (replaces global g_preempt_count)
+    // Preemption control (see preempt.h)
     volatile int preempt_count;
     
     // Nested interrupt count
     volatile int interrupt_nesting;
     
-    // Need reschedule flag
+    // Hint that the current task has need_resched set; tested by
+    // preempt_enable() when the count drops to zero
     volatile int need_resched;
     
-    // Per-CPU run queue for scheduler
-    task_t* runqueue_head;      // Head of ready task list
-    task_t* runqueue_tail;      // Tail for O(1) enqueue
+    // Per-CPU run queue for scheduler (READY tasks ordered by vruntime)
+    struct rb_root_cached cfs_tasks;  // Tree of queued tasks, leftmost = next to run
+    uint64_t cfs_min_vruntime;  // Monotonic floor of vruntime on this CPU
+    uint64_t cfs_load_weight;   // Sum of load_weight of queued tasks
+    uint32_t rt_nr_running;     // Queued RT tasks (also counted in runqueue_length)
+    int curr_prio;              // Class of current_task: -1 idle, 0 fair, 1..99 RT priority
+    uint64_t rt_time;           // RT runtime consumed in the current throttling period
+    uint64_t rt_period_start;   // sched_clock() at the start of that period
+    volatile int rt_throttled;  // RT tasks exhausted RT_RUNTIME_NS this period
     uint32_t runqueue_length;   // Number of tasks in queue
     spinlock_t runqueue_lock;   // Lock for this CPU's run queue
+    uint64_t load_avg;          // Decaying average of run queue load (balancer)
     
     // Per-CPU statistics
     uint64_t context_switches;
     uint64_t interrupts;
     uint64_t timer_ticks;
+
+    // Scheduler statistics (updated under runqueue_lock, see sched.c)
+    uint64_t sched_run_delay;   // Time tasks waited on this run queue (ns)
+    uint64_t sched_pcount;      // Tasks given this CPU
+    uint64_t sched_migrations;  // Tasks pulled or placed here from another CPU
+    uint64_t sched_wakeup_hist[SCHED_LAT_BUCKETS];  // Wakeup-to-run latency, log2 us
+
+    // CPU time accounting (see cputime.h)
+    uint64_t cputime_stamp;     // TSC at the last accounting event, 0 = not started
+    uint64_t irq_time_tsc;      // Cycles spent in hard IRQ context
+    int cputime_ctx;            // CPUTIME_* context the CPU is in
     
     // Per-CPU kernel stack (for interrupt/exception handling)
     uint64_t kernel_stack_top;
@@ -90,9 +109,24 @@ struct percpu {
     // on "prev"'s kernel stack — a preemption here would save the wrong RSP
     // into next->sp, permanently corrupting its saved stack pointer.
     volatile int in_context_switch;
+
+    // FPU / SIMD register ownership (see fpu.c)
+    task_t* fpu_owner;          // Task whose user state is live in the registers
+    task_t* fpu_saved_task;     // Task saved by kernel_fpu_begin(), reloaded at end
+    int fpu_depth;              // kernel_fpu_begin() nesting depth
+    uint64_t fpu_irq_flags;     // RFLAGS saved by the outermost kernel_fpu_begin()
+
+    // Idle state (see cpuidle.c)
+    volatile int idle_polling;  // Idle task is in MWAIT on its need_resched
+    int idle_state;             // C-state index being entered, -1 when running
+    uint64_t idle_enter_ns;     // sched_clock() at idle entry
+
+    // RCU read-side nesting depth (see rcu.h).  Preemption is held off
+    // while non-zero; updated with %gs-relative inc/dec from any context.
+    volatile int rcu_nesting;
     
     // Padding to ensure page alignment and cache line separation
-    uint8_t padding[PERCPU_SIZE - 240];  // Adjust based on actual struct size
+    uint8_t padding[PERCPU_SIZE - 516 - SPINLOCK_LOCKSTAT_SIZE];  // Adjust based on actual struct size
 } __attribute__((aligned(64)));
 
 typedef struct percpu percpu_t;
@@ -112,6 +146,9 @@ _Static_assert(__builtin_offsetof(percpu_t, syscall_saved_user_r14) == 72, "perc
 _Static_assert(__builtin_offsetof(percpu_t, syscall_saved_user_r15) == 80, "percpu: syscall_saved_user_r15 must be at offset 80");
 _Static_assert(__builtin_offsetof(percpu_t, syscall_saved_user_rax) == 88, "percpu: syscall_saved_user_rax must be at offset 88");
 _Static_assert(__builtin_offsetof(percpu_t, syscall_signal_pending) == 96, "percpu: syscall_signal_pending must be at offset 96");
+_Static_assert(__builtin_offsetof(percpu_t, preempt_count) == PERCPU_PREEMPT_COUNT, "percpu: preempt_count must match preempt.h");
+_Static_assert(__builtin_offsetof(percpu_t, need_resched) == PERCPU_NEED_RESCHED, "percpu: need_resched must match preempt.h");
+_Static_assert(sizeof(percpu_t) == PERCPU_SIZE, "percpu: padding must keep the structure at PERCPU_SIZE");
 
 // ============================================================================
 // Per-CPU Access Macros
@@ -155,44 +192,6 @@ static inline void set_current(task_t* task) {
         : "memory");
 }
 
-// ============================================================================
-// Preemption Control (Per-CPU)
-// ============================================================================
-
-// Disable preemption on this CPU
-static inline void percpu_preempt_disable(void) {
-    __asm__ volatile("" ::: "memory");
-    __asm__ volatile("incl %%gs:%c0"
-        :
-        : "i"(__builtin_offsetof(percpu_t, preempt_count))
-        : "memory");
-    __asm__ volatile("" ::: "memory");
-}
-
-// Enable preemption on this CPU
-static inline void percpu_preempt_enable(void) {
-    __asm__ volatile("" ::: "memory");
-    __asm__ volatile("decl %%gs:%c0"
-        :
-        : "i"(__builtin_offsetof(percpu_t, preempt_count))
-        : "memory");
-    __asm__ volatile("" ::: "memory");
-}
-
-// Get preemption count
-static inline int percpu_preempt_count(void) {
-    int count;
-    __asm__ volatile("movl %%gs:%c1, %0"
-        : "=r"(count)
-        : "i"(__builtin_offsetof(percpu_t, preempt_count)));
-    return count;
-}
-
-// Check if preemption is enabled
-static inline int percpu_preemption_enabled(void) {
-    return percpu_preempt_count() == 0;
-}
-
 // ============================================================================
 // MSR Definitions for GS Base
 // ============================================================================
@@ -230,6 +229,9 @@ static inline void swapgs(void) {
 // Per-CPU Initialization Functions
 // ============================================================================
 
+// Point %gs at the BSP's static area (first thing in kernel_main)
+void percpu_early_init(void);
+
 // Initialize per-CPU infrastructure (called once by BSP)
 void percpu_init(void);
 
@@ -239,6 +241,9 @@ void percpu_init_cpu(uint32_t cpu_id, uint32_t apic_id);
 // Allocate per-CPU area for a new CPU (returns virtual address)
 percpu_t* percpu_alloc(uint32_t cpu_id);
 
+// Allocate an AP's area on the BSP before the AP is started
+percpu_t* percpu_prepare_ap(uint32_t cpu_id);
+
 // Get percpu data for a specific CPU
 percpu_t* percpu_get(uint32_t cpu_id);
 
@@ -249,14 +254,8 @@ uint32_t percpu_get_online_count(void);
 // Per-CPU Run Queue Functions
 // ============================================================================
 
-// Enqueue task to this CPU's run queue
-void percpu_runqueue_enqueue(task_t* task);
-
-// Dequeue next task from this CPU's run queue
-task_t* percpu_runqueue_dequeue(void);
-
-// Enqueue task to specific CPU's run queue
-void percpu_runqueue_enqueue_cpu(uint32_t cpu_id, task_t* task);
+// Run queue insertion/removal lives in sched.c (vruntime-ordered tree);
+// these helpers only inspect queue state.
 
 // Get run queue length for a CPU
 uint32_t percpu_runqueue_length(uint32_t cpu_id);
@@ -1,21 +1,49 @@
 // LikeOS-64 Pipe Support
+//
+// A pipe is a ring of page buffers.  Each slot holds a page reference plus
+// the offset and length of the bytes still unread in it; writers append to
+// the newest slot while it has room and otherwise start a new page, readers
+// drain from the oldest.  The ring starts at PIPE_DEF_BUFFERS slots and can
+// be resized with fcntl(F_SETPIPE_SZ).
 #ifndef _KERNEL_PIPE_H_
 #define _KERNEL_PIPE_H_
 
 #include "types.h"
 #include "sched.h"
+#include "rwsem.h"
+#include "wait.h"
+#include "poll.h"
+#include "uio.h"
 
 #define PIPE_MAGIC 0x50495045U  // "PIPE"
 
+#define PIPE_DEF_BUFFERS    16                  // Default capacity: 64 KiB
+#define PIPE_MAX_SIZE       (1024 * 1024)       // F_SETPIPE_SZ upper limit
+#define PIPE_BUF            4096                // Writes up to this size are atomic
+
+// pipe_buf_t::flags
+#define PIPE_BUF_FLAG_CAN_MERGE 0x1             // Page is private to the pipe; writes may append
+
+typedef struct pipe_buf {
+    uint64_t page;      // Physical page; the slot holds one reference
+    uint32_t offset;    // First unread byte
+    uint32_t len;       // Unread bytes
+    uint32_t flags;
+} pipe_buf_t;
+
 typedef struct pipe {
-    uint8_t* buffer;
-    size_t size;
-    size_t read_pos;
-    size_t write_pos;
-    size_t used;
+    pipe_buf_t* bufs;
+    uint32_t ring_size; // Slots, a power of two
+    uint32_t head;      // Next slot to fill (free-running, masked on use)
+    uint32_t tail;      // Oldest filled slot
+    size_t used;        // Bytes buffered
     int readers;
     int writers;
-    spinlock_t lock;  // Protects all pipe state
+    uint64_t spare_page; // A drained page kept for the next write, 0 = none
+    spinlock_t lock;    // Protects readers and writers
+    rw_semaphore_t mutex; // Serialises reads, writes and resizes (taken for write)
+    wait_queue_head_t rd_wait;  // Readers waiting for data
+    wait_queue_head_t wr_wait;  // Writers waiting for room
 } pipe_t;
 
 typedef struct pipe_end {
@@ -28,8 +56,44 @@ typedef struct pipe_end {
 
 bool pipe_is_end(const void* ptr);
 pipe_t* pipe_create(size_t size);
+void pipe_destroy(pipe_t* pipe);   // Free a pipe that has no ends
 pipe_end_t* pipe_create_end(pipe_t* pipe, bool is_read);
 pipe_end_t* pipe_dup_end(pipe_end_t* end);
 void pipe_close_end(pipe_end_t* end);
 
-#endif // _KERNEL_PIPE_H_
\ No newline at end of file
+// Copy to/from a buffer the caller has validated (user or kernel).  Both
+// block unless the end or flags has O_NONBLOCK, and return bytes moved or
+// a negative errno.
+int64_t pipe_read(pipe_end_t* end, uint64_t buf, uint64_t count, int flags);
+int64_t pipe_write(pipe_end_t* end, uint64_t buf, uint64_t count, int flags);
+
+// The same over every segment of an iterator (readv, writev, vmsplice);
+// a write of up to PIPE_BUF bytes in total is still atomic
+int64_t pipe_read_iter(pipe_end_t* end, iov_iter_t* it, int flags);
+int64_t pipe_write_iter(pipe_end_t* end, iov_iter_t* it, int flags);
+
+// tee() (move = false) or splice() (move = true) between two pipes: the
+// out pipe gets references to the in pipe's pages, no data is copied
+int64_t pipe_link(pipe_end_t* in, pipe_end_t* out, size_t len, int flags, bool move);
+
+// Ring access for splice().  pipe_lock() is the pipe mutex; the waits
+// below need it held and drop it while they sleep.
+void pipe_lock(pipe_t* pipe);
+void pipe_unlock(pipe_t* pipe);
+int pipe_wait_readable(pipe_t* pipe, bool nonblock);  // 1 = data, 0 = EOF, or -errno
+int pipe_wait_writable(pipe_t* pipe, bool nonblock);  // 0 = a slot is free, or -errno
+uint64_t pipe_get_page(pipe_t* pipe);   // New page with one reference, 0 = no memory
+void pipe_put_page(pipe_t* pipe, uint64_t page);  // Drop one page reference
+// Append a slot; takes over one reference to page.  A slot must be free.
+void pipe_push_buf(pipe_t* pipe, uint64_t page, uint32_t offset, uint32_t len, uint32_t flags);
+void pipe_consume(pipe_t* pipe, size_t n);  // Drop n bytes from the front
+
+static inline bool pipe_full(const pipe_t* pipe) {
+    return pipe->head - pipe->tail >= pipe->ring_size;
+}
+
+short pipe_poll(pipe_end_t* end, short events, poll_table_t* pt);  // revents, never blocks
+long pipe_get_size(pipe_t* pipe);                // Capacity in bytes
+long pipe_set_size(pipe_t* pipe, unsigned long size);  // New capacity or -errno
+
+#endif // _KERNEL_PIPE_H_
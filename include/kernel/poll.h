@@ -0,0 +1,43 @@
+// LikeOS-64 - Poll Tables
+// ============================================================================
+// A poll function reports an fd's current readiness and, when it is given a
+// poll table, also names the wait queue(s) that will be woken when that
+// readiness changes:
+//
+//     short foo_poll(foo_t* foo, short events, poll_table_t* pt) {
+//         poll_wait(&foo->wq, pt);
+//         return foo_ready(foo) ? POLLIN : 0;
+//     }
+//
+// poll_wait() hands each queue to the table's qproc, which is how epoll
+// hooks its entries onto the sources it watches.  A NULL table (a one-off
+// readiness check) registers nothing.  Sources must wake their queue,
+// preferably with the changed events as the key, whenever the result of
+// their poll function may have changed.
+// ============================================================================
+
+#ifndef _KERNEL_POLL_H_
+#define _KERNEL_POLL_H_
+
+#include "types.h"
+#include "wait.h"
+
+struct poll_table_struct;
+
+typedef void (*poll_queue_proc)(wait_queue_head_t* wq, struct poll_table_struct* pt);
+
+typedef struct poll_table_struct {
+    poll_queue_proc qproc;
+} poll_table_t;
+
+static inline void poll_wait(wait_queue_head_t* wq, poll_table_t* pt) {
+    if (pt && pt->qproc && wq) {
+        pt->qproc(wq, pt);
+    }
+}
+
+static inline void init_poll_funcptr(poll_table_t* pt, poll_queue_proc qproc) {
+    pt->qproc = qproc;
+}
+
+#endif // _KERNEL_POLL_H_
@@ -0,0 +1,72 @@
+// LikeOS-64 - Kernel Preemption Control
+// ============================================================================
+// Kernel code runs preemptibly: an interrupt that finds need_resched set
+// switches tasks on its way out (sched_preempt), whether it interrupted
+// user or kernel mode.  Code that must not lose the CPU raises the per-CPU
+// preempt_count; every spinlock does so for as long as it is held, so a
+// lock holder is never switched out and a same-CPU waiter never spins
+// against a task that cannot run.
+//
+// preempt_enable() dropping the count to zero takes a reschedule that was
+// held off in the meantime, so a wakeup does not have to wait for the next
+// interrupt.  percpu_t::need_resched is the cheap hint it tests; the
+// authoritative flag is still task_t::need_resched.
+//
+// The count is per CPU while a task runs and saved in the task while it is
+// switched out (sched.c), so a task that sleeps with a lock held does not
+// leave its count behind on the CPU.
+// ============================================================================
+
+#ifndef _KERNEL_PREEMPT_H_
+#define _KERNEL_PREEMPT_H_
+
+#include "types.h"
+
+// Offsets into percpu_t; percpu.h asserts that they match the structure
+#define PERCPU_PREEMPT_COUNT    128
+#define PERCPU_NEED_RESCHED     136
+
+// Out of line (sched.c): switch away if the current task should yield and
+// nothing holds preemption off
+void preempt_schedule(void);
+
+static inline void preempt_disable(void) {
+    __asm__ volatile("incl %%gs:%c0" :: "i"(PERCPU_PREEMPT_COUNT) : "memory");
+}
+
+// Drop the count without the reschedule check, for paths that are about to
+// schedule anyway or run with interrupts disabled
+static inline void preempt_enable_no_resched(void) {
+    __asm__ volatile("decl %%gs:%c0" :: "i"(PERCPU_PREEMPT_COUNT) : "memory");
+}
+
+static inline void preempt_enable(void) {
+    uint8_t zero;
+    __asm__ volatile("decl %%gs:%c1\n\t"
+                     "setz %0"
+                     : "=q"(zero)
+                     : "i"(PERCPU_PREEMPT_COUNT)
+                     : "memory", "cc");
+    if (zero) {
+        int resched;
+        __asm__ volatile("movl %%gs:%c1, %0"
+                         : "=r"(resched)
+                         : "i"(PERCPU_NEED_RESCHED));
+        if (__builtin_expect(resched, 0))
+            preempt_schedule();
+    }
+}
+
+static inline int preempt_count(void) {
+    int count;
+    __asm__ volatile("movl %%gs:%c1, %0"
+                     : "=r"(count)
+                     : "i"(PERCPU_PREEMPT_COUNT));
+    return count;
+}
+
+static inline int preemptible(void) {
+    return preempt_count() == 0;
+}
+
+#endif // _KERNEL_PREEMPT_H_
@@ -0,0 +1,67 @@
+// LikeOS-64 Red-Black Tree
+// ============================================================================
+// Intrusive red-black tree (Linux-style API).  Nodes are embedded in the
+// owning structure and recovered with rb_entry().  The tree does no locking
+// and no allocation; callers search for the insertion point themselves,
+// link the node with rb_link_node() and then rebalance with rb_insert_color().
+// ============================================================================
+
+#ifndef _KERNEL_RBTREE_H_
+#define _KERNEL_RBTREE_H_
+
+#include "types.h"
+
+#define RB_RED      0
+#define RB_BLACK    1
+
+struct rb_node {
+    struct rb_node* rb_parent;
+    struct rb_node* rb_left;
+    struct rb_node* rb_right;
+    int rb_color;
+};
+
+struct rb_root {
+    struct rb_node* rb_node;
+};
+
+// Root with a cached pointer to the leftmost (smallest) node for O(1) rb_first
+struct rb_root_cached {
+    struct rb_root rb_root;
+    struct rb_node* rb_leftmost;
+};
+
+#define RB_ROOT             ((struct rb_root){ NULL })
+#define RB_ROOT_CACHED      ((struct rb_root_cached){ { NULL }, NULL })
+
+#define rb_entry(ptr, type, member) \
+    ((type*)((char*)(ptr) - __builtin_offsetof(type, member)))
+
+#define RB_EMPTY_ROOT(root)         ((root)->rb_node == NULL)
+#define rb_first_cached(root)       ((root)->rb_leftmost)
+
+// Link a new node as child *link of parent (parent NULL for the root)
+static inline void rb_link_node(struct rb_node* node, struct rb_node* parent,
+                                struct rb_node** link) {
+    node->rb_parent = parent;
+    node->rb_left = NULL;
+    node->rb_right = NULL;
+    node->rb_color = RB_RED;
+    *link = node;
+}
+
+void rb_insert_color(struct rb_node* node, struct rb_root* root);
+void rb_erase(struct rb_node* node, struct rb_root* root);
+
+struct rb_node* rb_first(const struct rb_root* root);
+struct rb_node* rb_last(const struct rb_root* root);
+struct rb_node* rb_next(const struct rb_node* node);
+struct rb_node* rb_prev(const struct rb_node* node);
+
+// Cached variants keep rb_leftmost up to date.  leftmost must be true when
+// the node was linked as the new smallest element.
+void rb_insert_color_cached(struct rb_node* node, struct rb_root_cached* root,
+                            bool leftmost);
+void rb_erase_cached(struct rb_node* node, struct rb_root_cached* root);
+
+#endif // _KERNEL_RBTREE_H_
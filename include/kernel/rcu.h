@@ -0,0 +1,90 @@
+// LikeOS-64 - Read-Copy-Update
+// ============================================================================
+// Quiescent-state-based RCU for read-mostly kernel data.
+//
+// Readers bracket their accesses with rcu_read_lock()/rcu_read_unlock() and
+// load shared pointers with rcu_dereference().  They take no locks and write
+// no shared cache lines: the read-side lock only bumps this CPU's nesting
+// count, which holds off preemption until the section ends.  Readers may
+// nest and may run in interrupt context, but must not sleep.
+//
+// Updaters serialize among themselves with their own lock, publish new
+// objects with rcu_assign_pointer(), unlink old ones, and free them only
+// after a grace period: call_rcu() queues a callback, synchronize_rcu()
+// blocks until every reader that could still see the old object is done.
+//
+// A CPU passes through a quiescent state on every context switch and on a
+// timer tick taken outside a read-side section.  A grace period ends once
+// every online CPU has reported one; callbacks then run from SOFTIRQ_RCU.
+// ============================================================================
+
+#ifndef _KERNEL_RCU_H_
+#define _KERNEL_RCU_H_
+
+#include "types.h"
+#include "percpu.h"
+
+// Set by rcu_init() once %gs points at per-CPU data.  Before that only the
+// BSP runs and nothing preempts, so read-side sections need no bookkeeping.
+extern volatile int g_rcu_percpu_ready;
+
+static inline void rcu_read_lock(void) {
+    if (g_rcu_percpu_ready) {
+        __asm__ volatile("incl %%gs:%c0"
+                         : : "i"(__builtin_offsetof(percpu_t, rcu_nesting)) : "memory");
+    }
+    __asm__ volatile("" ::: "memory");
+}
+
+// Leaving the outermost section takes a reschedule it held off
+static inline void rcu_read_unlock(void) {
+    __asm__ volatile("" ::: "memory");
+    if (g_rcu_percpu_ready) {
+        uint8_t zero;
+        __asm__ volatile("decl %%gs:%c1\n\t"
+                         "setz %0"
+                         : "=q"(zero)
+                         : "i"(__builtin_offsetof(percpu_t, rcu_nesting))
+                         : "memory", "cc");
+        if (zero && __builtin_expect(this_cpu()->need_resched, 0))
+            preempt_schedule();
+    }
+}
+
+// Load an RCU-protected pointer (inside rcu_read_lock) / publish one
+// (under the updater's lock).  The release store orders the initialization
+// of the new object before the pointer becomes visible.
+#define rcu_dereference(p)          __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rcu_assign_pointer(p, v)    __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+// Initialize the RCU core (BSP, after percpu_init())
+void rcu_init(void);
+
+// Queue func(head) to run after a grace period.  Callable from any
+// context; func runs in softirq context on the calling CPU.
+void call_rcu(rcu_head_t* head, void (*func)(rcu_head_t* head));
+
+// Block until all pre-existing read-side sections have completed.
+// Process context only, never inside rcu_read_lock().
+void synchronize_rcu(void);
+
+// Scheduler hooks: timer tick (IRQs disabled) and context switch
+void rcu_tick(void);
+void rcu_note_context_switch(void);
+
+// Counters for diagnostics
+typedef struct rcu_stats {
+    uint64_t gp_completed;      // Grace periods ended
+    uint64_t cbs_queued;        // call_rcu() callbacks queued
+    uint64_t cbs_invoked;       // Callbacks run
+    uint64_t cbs_pending;       // Queued but not yet run
+} rcu_stats_t;
+
+void rcu_get_stats(rcu_stats_t* out);
+
+#ifdef RCU_TORTURE
+// Start the RCU stress test threads (after SMP and ksoftirqd are up)
+void rcu_torture_start(void);
+#endif
+
+#endif // _KERNEL_RCU_H_
@@ -0,0 +1,77 @@
+// LikeOS-64 - Restartable sequences (rseq)
+// ============================================================================
+// A thread registers a struct rseq in its TLS.  The kernel keeps cpu_id in
+// it current on every return to user mode, so user code can index per-CPU
+// data without a syscall.  A critical section is described by a struct
+// rseq_cs that user code points rseq_cs at while it runs: if the thread is
+// preempted, migrated or interrupted by a signal handler before reaching
+// the commit point (start_ip + post_commit_offset), the kernel moves its
+// instruction pointer to abort_ip on the way back to user mode.  The four
+// bytes before abort_ip must hold the signature given at registration.
+//
+// The layout and semantics match the Linux ABI.
+// ============================================================================
+
+#ifndef _KERNEL_RSEQ_H_
+#define _KERNEL_RSEQ_H_
+
+#include "types.h"
+#include "sched.h"
+
+#define RSEQ_ORIG_SIZE                  32      // sizeof(struct rseq), v0 ABI
+#define RSEQ_FLAG_UNREGISTER            (1 << 0)
+
+#define RSEQ_CPU_ID_UNINITIALIZED       ((uint32_t)-1)
+#define RSEQ_CPU_ID_REGISTRATION_FAILED ((uint32_t)-2)
+
+// Registered per-thread area (user memory, 32-byte aligned)
+typedef struct k_rseq {
+    uint32_t cpu_id_start;      // CPU number, always valid
+    uint32_t cpu_id;            // CPU number, or RSEQ_CPU_ID_* when unregistered
+    uint64_t rseq_cs;           // Active critical section descriptor, 0 = none
+    uint32_t flags;
+    uint32_t node_id;
+    uint32_t mm_cid;
+    uint32_t reserved;
+} k_rseq_t;
+
+// Critical section descriptor (user memory)
+typedef struct k_rseq_cs {
+    uint32_t version;           // Must be 0
+    uint32_t flags;
+    uint64_t start_ip;
+    uint64_t post_commit_offset;
+    uint64_t abort_ip;
+} k_rseq_cs_t;
+
+// SYS_RSEQ
+int64_t rseq_register(task_t* t, uint64_t uptr, uint32_t len, int flags, uint32_t sig);
+
+// Drop the registration (execve, CLONE_VM children)
+static inline void rseq_clear(task_t* t) {
+    t->rseq = 0;
+    t->rseq_len = 0;
+    t->rseq_sig = 0;
+    t->rseq_event = 0;
+    t->rseq_cpu = -1;
+}
+
+// The thread is being switched out: whatever it was doing in user mode
+// must be restarted.  Called from the context-switch paths.
+static inline void rseq_preempt(task_t* t) {
+    if (t->rseq) {
+        t->rseq_event = 1;
+    }
+}
+
+// A signal frame is being built for an interrupted user context: abort a
+// critical section first so the handler sees (and returns to) abort_ip
+void rseq_signal_deliver(task_t* t, uint64_t* user_ip);
+
+// Return to user mode: abort an interrupted critical section if there was
+// a preemption since the last return (user_ip is the return address in
+// the interrupt frame, NULL on paths that cannot be inside one), then
+// refresh cpu_id if the thread changed CPUs.  Interrupts off.
+void rseq_notify_resume(task_t* t, uint64_t* user_ip);
+
+#endif // _KERNEL_RSEQ_H_
@@ -0,0 +1,39 @@
+// LikeOS-64 - Reader-Writer Semaphore
+// ============================================================================
+// Sleeping reader-writer lock for process context.  Any number of readers
+// or one writer may hold it; contenders block instead of spinning, so the
+// holder may sleep (disk I/O, page faults).  Waiting writers are preferred:
+// once one is queued new readers block until it has had its turn.
+// ============================================================================
+
+#ifndef _KERNEL_RWSEM_H_
+#define _KERNEL_RWSEM_H_
+
+#include "types.h"
+#include "spinlock.h"
+
+typedef struct rw_semaphore {
+    spinlock_t lock;            // Protects the fields below
+    int count;                  // >0 readers, -1 writer, 0 free
+    int waiting_writers;        // Writers blocked in down_write()
+    int waiters;                // Tasks blocked on this semaphore
+    const char* name;
+} rw_semaphore_t;
+
+#define RWSEM_INIT(n) { .lock = SPINLOCK_INIT(n), .count = 0, \
+                        .waiting_writers = 0, .waiters = 0, .name = (n) }
+
+void rwsem_init(rw_semaphore_t* sem, const char* name);
+
+void down_read(rw_semaphore_t* sem);
+int  down_read_trylock(rw_semaphore_t* sem);  // 1 if acquired
+void up_read(rw_semaphore_t* sem);
+
+void down_write(rw_semaphore_t* sem);
+int  down_write_trylock(rw_semaphore_t* sem); // 1 if acquired
+void up_write(rw_semaphore_t* sem);
+
+// Turn a held write lock into a read lock without letting a writer in
+void downgrade_write(rw_semaphore_t* sem);
+
+#endif // _KERNEL_RWSEM_H_
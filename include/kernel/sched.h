@@ -5,6 +5,8 @@
 #include "types.h"
 #include "vfs.h"
 #include "signal.h"
+#include "rbtree.h"
+#include "spinlock.h"
 
 // Forward declaration
 struct vfs_file;
@@ -29,173 +31,63 @@ struct task;
 // Global CPU feature flags (detected at boot)
 extern uint32_t g_cpu_features_ext;
 
-// Preemption configuration
-// Time slice in timer ticks (at 100Hz, 2 ticks = 20ms for better responsiveness)
-#define SCHED_TIME_SLICE    2
-
 // ============================================================================
-// SMP-READY SPINLOCK IMPLEMENTATION
+// FAIR SCHEDULING CONFIGURATION
 // ============================================================================
 
-// UP (Uniprocessor) mode flag - when set, spinlocks only use interrupt disable
-// This avoids deadlocks on single-CPU systems where spinning would be fatal
-// Defined in smp.c, set to 1 if only one CPU is active
-extern volatile uint32_t g_smp_up_mode;
-
-typedef struct spinlock {
-    volatile uint32_t locked;    // 0 = unlocked, 1 = locked
-    volatile uint32_t owner_cpu; // For debugging: CPU that holds lock (0xFFFFFFFF = none)
-    const char* name;            // Lock name for debugging
-} spinlock_t;
-
-// Static initializer for spinlock
-#define SPINLOCK_INIT(n) { .locked = 0, .owner_cpu = 0xFFFFFFFF, .name = (n) }
-
-// Initialize a spinlock at runtime
-static inline void spinlock_init(spinlock_t* lock, const char* name) {
-    lock->locked = 0;
-    lock->owner_cpu = 0xFFFFFFFF;
-    lock->name = name;
-}
-
-// Acquire spinlock (SMP-safe using atomic compare-and-swap)
-// On UP systems, we don't spin - interrupts must be disabled by caller
-static inline void spin_lock(spinlock_t* lock) {
-    // In UP mode, if interrupts are disabled, no other context can run,
-    // so we can "acquire" the lock without spinning
-    if (g_smp_up_mode) {
-        // Just mark as locked for debugging/assertions
-        __asm__ volatile("" ::: "memory");
-        lock->locked = 1;
-        return;
-    }
-    // SMP mode: actual spinlock with atomic CAS
-    while (1) {
-        uint32_t expected = 0;
-        uint32_t desired = 1;
-        uint32_t old;
-        __asm__ volatile (
-            "lock cmpxchgl %2, %1"
-            : "=a"(old), "+m"(lock->locked)
-            : "r"(desired), "0"(expected)
-            : "memory", "cc"
-        );
-        if (old == 0) {
-            __asm__ volatile("" ::: "memory"); // Memory barrier
-            return;
-        }
-        // Spin with PAUSE instruction (reduces power, improves SMP performance)
-        __asm__ volatile("pause" ::: "memory");
-    }
-}
-
-// Try to acquire spinlock, return 1 if acquired, 0 if failed
-static inline int spin_trylock(spinlock_t* lock) {
-    // In UP mode, always succeed if interrupts are disabled
-    if (g_smp_up_mode) {
-        __asm__ volatile("" ::: "memory");
-        lock->locked = 1;
-        return 1;
-    }
-    // SMP mode: actual atomic trylock
-    uint32_t expected = 0;
-    uint32_t desired = 1;
-    uint32_t old;
-    __asm__ volatile (
-        "lock cmpxchgl %2, %1"
-        : "=a"(old), "+m"(lock->locked)
-        : "r"(desired), "0"(expected)
-        : "memory", "cc"
-    );
-    if (old == 0) {
-        __asm__ volatile("" ::: "memory");
-        return 1;
-    }
-    return 0;
-}
-
-// Release spinlock
-// On x86, stores are not reordered with stores (TSO model), so a compiler
-// barrier is sufficient for release semantics.  mfence (~33-100 cycles)
-// was needlessly serialising the pipeline on every unlock kernel-wide.
-static inline void spin_unlock(spinlock_t* lock) {
-    __asm__ volatile("" ::: "memory");  // compiler barrier (release semantics on x86)
-    lock->locked = 0;
-    lock->owner_cpu = 0xFFFFFFFF;
-}
-
-// Check if spinlock is held
-static inline int spin_is_locked(spinlock_t* lock) {
-    return lock->locked != 0;
-}
-
-// Save interrupt flags and disable interrupts
-static inline uint64_t local_irq_save(void) {
-    uint64_t flags;
-    __asm__ volatile (
-        "pushfq\n\t"
-        "popq %0\n\t"
-        "cli"
-        : "=r"(flags)
-        :
-        : "memory"
-    );
-    return flags;
-}
-
-// Restore interrupt flags
-static inline void local_irq_restore(uint64_t flags) {
-    __asm__ volatile (
-        "pushq %0\n\t"
-        "popfq"
-        :
-        : "r"(flags)
-        : "memory", "cc"
-    );
-}
-
-// Spinlock with interrupt save/restore (for use in interrupt handlers)
-static inline void spin_lock_irqsave(spinlock_t* lock, uint64_t* flags) {
-    *flags = local_irq_save();
-    spin_lock(lock);
-}
-
-static inline void spin_unlock_irqrestore(spinlock_t* lock, uint64_t flags) {
-    spin_unlock(lock);
-    local_irq_restore(flags);
-}
+// Nice range (Linux-compatible).  Each nice step is worth ~10% CPU share.
+#define NICE_MIN            (-20)
+#define NICE_MAX            19
+#define NICE_WIDTH          40
+#define NICE_0_LOAD         1024    // Load weight of a nice-0 task
+
+// Scheduling period targeted when few tasks are runnable: every runnable task
+// should get the CPU once within this window (nanoseconds).
+#define SCHED_LATENCY_NS            20000000ULL
+// Lower bound on a single slice; the period stretches once
+// nr_running > SCHED_LATENCY_NS / SCHED_MIN_GRANULARITY_NS.
+#define SCHED_MIN_GRANULARITY_NS     4000000ULL
+// vruntime lead a woken task needs over the running one to preempt it
+#define SCHED_WAKEUP_GRANULARITY_NS  1000000ULL
+
+// Defaults for the SMP placement tunables (SYS_SCHEDCTL).  A task that ran
+// within the migration cost is cache-hot and is not moved by the balancer.
+// At wakeup the waker's CPU is preferred over the task's previous CPU when
+// its load (with the task added) is below the previous CPU's load scaled by
+// the imbalance percentage; up to WAKE_IDLE_SCAN CPUs sharing the cache are
+// searched for an idle one.
+#define SCHED_MIGRATION_COST_NS       500000ULL
+#define SCHED_WAKE_IMBALANCE_PCT     117
+#define SCHED_WAKE_IDLE_SCAN           8
+
+// Wakeup-to-run latency histograms (schedstats): bucket 0 counts waits under
+// 1 us, bucket i waits of [2^(i-1), 2^i) us, the last bucket everything longer.
+#define SCHED_LAT_BUCKETS             16
 
 // ============================================================================
-// PREEMPTION CONTROL (Full Kernel Preemption)
+// SCHEDULING POLICIES AND REAL-TIME CONFIGURATION
 // ============================================================================
 
-// Global preemption counter (per-CPU for SMP, single for UP)
-// When > 0, preemption is disabled in the current context
-extern volatile int g_preempt_count;
-
-// Disable kernel preemption (increment counter)
-static inline void preempt_disable(void) {
-    __asm__ volatile("" ::: "memory");
-    g_preempt_count++;
-    __asm__ volatile("" ::: "memory");
-}
-
-// Enable kernel preemption (decrement counter)
-static inline void preempt_enable(void) {
-    __asm__ volatile("" ::: "memory");
-    g_preempt_count--;
-    __asm__ volatile("" ::: "memory");
-}
-
-// Get current preemption count
-static inline int preempt_count_get(void) {
-    return g_preempt_count;
-}
-
-// Check if preemption is currently enabled
-static inline int preemption_enabled(void) {
-    return g_preempt_count == 0;
-}
+// Scheduling policies (Linux ABI values)
+#define SCHED_NORMAL    0
+#define SCHED_FIFO      1
+#define SCHED_RR        2
+#define SCHED_BATCH     3
+#define SCHED_IDLE      5
+#define SCHED_DEADLINE  6
+
+// Real-time priorities run 1..MAX_RT_PRIO-1; a higher value runs first and
+// any runnable RT task preempts every fair-class task.
+#define MAX_RT_PRIO         100
+#define SCHED_IDLE_WEIGHT   3       // Load weight of SCHED_IDLE tasks (below nice 19)
+
+// SCHED_RR quantum
+#define RR_TIMESLICE_NS     100000000ULL
+// RT throttling: RT tasks may use at most RT_RUNTIME_NS of every RT_PERIOD_NS
+// on a CPU while fair tasks are waiting there, so a runaway FIFO loop
+// cannot lock the CPU up.
+#define RT_PERIOD_NS        1000000000ULL
+#define RT_RUNTIME_NS        950000000ULL
 
 // ============================================================================
 // THREAD GROUP SUPPORT STRUCTURES
@@ -259,6 +151,14 @@ typedef enum {
     TASK_USER = 3      // Ring 3
 } task_privilege_t;
 
+// Hash chain link for the PID, process-group and session indices.  pprev
+// points at whichever pointer references this node (bucket head or the
+// previous node's next), so unlinking needs no bucket walk.
+typedef struct task_hnode {
+    struct task_hnode* next;
+    struct task_hnode** pprev;  // NULL when not hashed
+} task_hnode_t;
+
 // Memory region for mmap tracking
 typedef struct mmap_region {
     uint64_t start;     // Virtual start address
@@ -290,17 +190,47 @@ typedef struct task {
     task_state_t state;
     task_privilege_t privilege;  // Ring level
     struct task* next;     // Global task list link (linear, all tasks)
-    struct task* rq_next;   // Per-CPU run queue link (NULL when not in rq)
+    rcu_head_t rcu;        // Deferred free once lock-free list walkers are done
+    struct rb_node rq_node; // Per-CPU run queue link (vruntime-ordered tree)
     uint32_t on_cpu;        // CPU this task is currently assigned to
+    uint32_t rq_cpu;        // CPU whose run queue / vruntime base the task belongs to
     uint64_t cpu_affinity;  // Bitmask of allowed CPUs (0 = all CPUs allowed)
     bool on_rq;             // Whether currently in a per-CPU run queue
     int id;
     
     // Preemption support
     volatile int need_resched;       // Set by timer when time slice expired
-    int remaining_ticks;             // Remaining time slice ticks
+    int saved_preempt_count;         // percpu preempt_count while switched out
     interrupt_frame_t* preempt_frame; // Saved interrupt frame (NULL if cooperative switch)
     
+    // Fair scheduling
+    int nice;                        // NICE_MIN..NICE_MAX
+    uint32_t load_weight;            // Weight derived from nice (NICE_0_LOAD at nice 0)
+    uint64_t vruntime;               // Weighted virtual runtime (ns) – run queue key
+    uint64_t exec_start;             // sched_clock() when runtime was last charged
+    uint64_t sum_exec_runtime;       // Total CPU time consumed (ns)
+    uint64_t prev_sum_exec_runtime;  // sum_exec_runtime when the current slice began
+
+    // Scheduler statistics (sched_clock() nanoseconds, see sched_stat_switch)
+    uint64_t sched_last_queued;      // When it was queued to wait for a CPU, 0 = not waiting
+    uint64_t sched_wakeup_ts;        // When it was last woken, 0 = not since it last ran
+    uint64_t sched_block_start;      // When it last blocked or slept, 0 = runnable
+    bool sched_block_io;             // That block was on a wait_channel (not a plain sleep)
+    uint64_t sched_run_delay;        // Total time runnable but waiting on a run queue
+    uint64_t sched_pcount;           // Times it was given a CPU
+    uint64_t sched_block_time;       // Total time blocked on a wait_channel
+    uint64_t sched_sleep_time;       // Total time in other sleeps (nanosleep, pause, ...)
+    uint64_t nvcsw;                  // Voluntary switches (blocked, stopped, exited)
+    uint64_t nivcsw;                 // Involuntary switches (preempted, yielded)
+    uint64_t nr_migrations;          // Moves to another CPU's run queue
+    uint32_t wakeup_lat_hist[SCHED_LAT_BUCKETS];  // Wakeup-to-run latency, log2 us
+
+    // Real-time scheduling
+    int policy;                      // SCHED_NORMAL, SCHED_FIFO, SCHED_RR, ...
+    int rt_priority;                 // 1..MAX_RT_PRIO-1 for FIFO/RR, 0 otherwise
+    uint64_t rt_time_slice;          // Remaining RR quantum (ns); 0 = requeue at tail
+    struct task* rt_next;            // Per-priority RT run queue link
+    
     // Process hierarchy
     struct task* parent;        // Parent task (NULL for init)
     struct task* first_child;   // First child in linked list
@@ -317,14 +247,18 @@ typedef struct task {
     uint64_t kernel_stack_top;  // Kernel stack for syscalls/interrupts (for user tasks)
     void* kernel_stack_base;    // Kernel stack allocation base (for freeing)
 
-    // Job control / session
+    // Job control / session (change pgid/sid through sched_set_pgid_sid)
     int pgid;
     int sid;
     struct tty* ctty;
+    task_hnode_t pid_node;      // PID hash chain (walked under RCU)
+    task_hnode_t pgrp_node;     // Process-group hash chain (g_task_list_lock)
+    task_hnode_t session_node;  // Session hash chain (g_task_list_lock)
 
     // Wait linkage for blocking I/O
     struct task* wait_next;
     void* wait_channel;
+    struct worker* wq_worker;       // Workqueue worker run by this kernel thread
     
     // Timer-based sleep support
     uint64_t wakeup_tick;           // Tick count when task should wake (0 = not sleeping)
@@ -356,8 +290,13 @@ typedef struct task {
     
     // Timing / accounting
     uint64_t start_tick;        // Tick count when task was created
-    uint64_t utime_ticks;       // Ticks spent in user mode
-    uint64_t stime_ticks;       // Ticks spent in kernel mode
+    uint64_t utime_tsc;         // TSC cycles spent in user mode (see cputime.h)
+    uint64_t stime_tsc;         // TSC cycles spent in kernel mode
+    int cputime_ctx;            // CPUTIME_* context to resume in when switched in
+    uint64_t dead_utime_tsc;    // Group leader: time of threads that have exited
+    uint64_t dead_stime_tsc;
+    uint64_t cutime_tsc;        // Group leader: time of reaped children
+    uint64_t cstime_tsc;
     
     // Current working directory
     char cwd[256];
@@ -398,10 +337,22 @@ typedef struct task {
     // TLS (Thread Local Storage) support
     uint64_t fs_base;               // FS segment base for user TLS
     uint64_t gs_base;               // GS segment base (usually not used by user)
+
+    // Extended FPU / SIMD state (user tasks only, see fpu.c)
+    uint8_t* fpu_state;             // XSAVE/FXSAVE area, FPU_ALIGN aligned
+    void* fpu_alloc;                // Raw allocation backing fpu_state
+    int fpu_last_cpu;               // CPU that last loaded fpu_state (-1 = none)
     
     // Robust futex support
     struct robust_list_head* robust_list;  // Robust futex list head
     size_t robust_list_len;                // Size of robust list head structure
+
+    // Restartable sequences (see rseq.h)
+    uint64_t rseq;                  // Registered struct rseq (user address), 0 = none
+    uint32_t rseq_len;
+    uint32_t rseq_sig;              // Signature expected before abort_ip
+    volatile int rseq_event;        // Switched out since the last return to user
+    int rseq_cpu;                   // CPU last written to cpu_id, -1 = none
     
     // Shared structures (NULL = use legacy per-task fields)
     mm_struct_t* mm;                // Shared address space (CLONE_VM)
@@ -415,6 +366,10 @@ task_t* sched_add_user_task(task_entry_t entry, void* arg, uint64_t* pml4, uint6
 void sched_tick(void);
 void sched_schedule(void);    // Core preemptive scheduler - switch to next ready task
 void sched_yield_in_kernel(void); // In-kernel cooperative yield (no syscall)
+void sched_task_tick(task_t* cur); // Per-CPU timer tick: charge runtime, check slice expiry
+void sched_cond_resched(void);    // Reschedule now if need_resched is set (syscall return)
+uint64_t sched_clock(void);       // Monotonic per-CPU scheduler clock (nanoseconds)
+void sched_idle_loop(void) __attribute__((noreturn)); // Idle task body (MWAIT/HLT until need_resched)
 void sched_run_ready(void);
 task_t* sched_current(void);
 int sched_has_user_tasks(void);  // Check if any user tasks are running
@@ -425,6 +380,7 @@ int sched_need_resched(void);                  // Check if reschedule is needed
 void sched_set_need_resched(task_t* t);        // Mark task as needing reschedule
 void sched_wake_expired_sleepers(uint64_t current_tick);  // Wake tasks whose sleep timer expired
 void sched_wake_channel(void* channel);        // Wake all tasks waiting on a channel
+int sched_wake_task(task_t* task);             // Wake one blocked task; 1 if it was blocked
 
 // Global task list lock (protects the all-tasks linked list)
 extern spinlock_t g_task_list_lock;
@@ -436,10 +392,24 @@ int sched_is_smp(void);        // Check if SMP mode is enabled
 // Per-CPU scheduling API
 void sched_init_ap(uint32_t cpu_id);     // Initialize per-CPU scheduler for AP
 void sched_enqueue_ready(task_t* task);  // Enqueue task to its assigned CPU's run queue
-void sched_load_balance(void);           // Pull tasks from busiest CPU (called from timer)
+void sched_load_balance(void);           // Balance expired scheduling domains (called every tick)
+
+// Scheduler tunables and wakeup placement statistics (SYS_SCHEDCTL)
+struct k_sched_wakestats;
+int sched_tunable_get(int id, uint64_t* value);
+int sched_tunable_set(int id, uint64_t value);
+void sched_get_wakestats(struct k_sched_wakestats* out);
+void sched_reset_wakestats(void);  // Also zeroes the per-CPU run queue statistics
+struct k_sched_cpustats;
+int sched_get_cpustats(uint32_t cpu_id, struct k_sched_cpustats* out);
 
 // Process management
 task_t* sched_fork_current(void);           // Fork current task with COW
+void sched_fork_init(task_t* child, task_t* parent); // Reset scheduling state for a new child
+int sched_set_nice(task_t* task, int nice);  // Change nice level (clamped), reweights queued task
+int sched_getpriority(int which, int who, int* nice_out); // Lowest nice among PRIO_* targets
+int sched_setpriority(int which, int who, int nice);      // Set nice for PRIO_* targets
+int sched_setscheduler(task_t* task, int policy, int rt_priority); // Change policy / RT priority
 void sched_remove_task(task_t* task);       // Remove task from scheduler
 task_t* sched_find_task_by_id(uint32_t pid); // Find task by PID
 task_t* sched_find_task_by_id_locked(uint32_t pid); // Find task by PID (caller holds g_task_list_lock)
@@ -451,7 +421,11 @@ void sched_reap_zombies(task_t* parent);    // Reap all zombie children of paren
 void sched_mark_task_exited(task_t* task, int status);
 void sched_signal_task(task_t* task, int sig);
 void sched_signal_pgrp(int pgid, int sig);
+int sched_collect_pgrp(int pgid, task_t** out, int max); // Live user tasks of a group (caller in rcu_read_lock)
 int sched_pgid_exists(int pgid);
+int sched_pgid_session(int pgid);           // Session of a group member, -1 if none
+void sched_set_pgid_sid(task_t* task, int pgid, int sid); // Move task between pgrp/session indices
+int sched_snapshot_tasks(task_t** out, int max); // Live tasks by ascending PID (caller in rcu_read_lock)
 void sched_dump_tasks(void);  // Debug: dump all task states
 
 // ============================================================================
@@ -0,0 +1,46 @@
+// LikeOS-64 - RAM Filesystem for Shared Memory (/dev/shm, memfd)
+// ============================================================================
+// A shm object is a resizable run of physical pages that lives only in
+// memory.  Named objects sit under /dev/shm (shm_open() in libc is open()
+// of /dev/shm/<name>); memfd_create() makes an anonymous one that goes
+// away with its last file and mapping.  read/write/pread/readv and
+// ftruncate work as on any file, and a MAP_SHARED mapping maps the
+// object's own pages, so every process mapping it sees the same memory.
+//
+// Each page is reference counted: the object holds one reference and
+// every mapping of it one more.  Pages are allocated zeroed on first
+// write or mapping, so a grown object reads as zeros until it is touched.
+// Shrinking drops the object's references; a page still mapped somewhere
+// stays with that mapping until it is unmapped.
+// ============================================================================
+
+#ifndef _KERNEL_SHMFS_H_
+#define _KERNEL_SHMFS_H_
+
+#include "types.h"
+#include "vfs.h"
+
+#define SHMFS_PREFIX        "/dev/shm/"
+#define SHMFS_PREFIX_LEN    9
+#define SHMFS_MAX_SIZE      (1024UL * 1024 * 1024)  // Largest object
+
+// memfd_create() flags
+#define MFD_CLOEXEC         0x0001U
+#define MFD_ALLOW_SEALING   0x0002U     // Accepted; there are no seals yet
+#define MFD_NAME_MAX        249         // Name length, without "memfd:"
+
+// Open /dev/shm/<name>; honours O_CREAT, O_EXCL and O_TRUNC.  ST_* codes.
+int shmfs_open(const char* path, int flags, vfs_file_t** out);
+int shmfs_stat(const char* path, struct kstat* st);
+int shmfs_unlink(const char* path);
+
+// Name of the index'th object in /dev/shm; false past the last one
+bool shmfs_name_at(int index, char* name, size_t len);
+
+// Create an unlinked object for memfd_create(); 0 or a negative errno
+int memfd_create(const char* name, unsigned int flags, vfs_file_t** out);
+
+bool shmfs_is_file(vfs_file_t* f);
+size_t shmfs_size(vfs_file_t* f);
+
+#endif // _KERNEL_SHMFS_H_
@@ -385,6 +385,9 @@ typedef struct signal_frame {
     
     // Saved signal mask
     kernel_sigset_t saved_mask;
+
+    // User address of the saved FPU/SIMD image below this frame (0 = none)
+    uint64_t        fpstate;
     
     // Sigreturn trampoline code (if needed)
     uint8_t         retcode[16];
@@ -26,6 +26,7 @@ enum {
     SOFTIRQ_NET_RX = 0,    // process per-CPU RX skb queue
     SOFTIRQ_NET_TX = 1,    // future use
     SOFTIRQ_TIMER  = 2,    // future use
+    SOFTIRQ_RCU    = 3,    // advance grace periods, invoke call_rcu() callbacks
     NR_SOFTIRQ     = 32
 };
 
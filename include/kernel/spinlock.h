@@ -0,0 +1,416 @@
+// LikeOS-64 - Spinning Locks
+// ============================================================================
+// spinlock_t is a queued spinlock: the uncontended path is a single cmpxchg
+// on a 32-bit word, exactly like a test-and-set lock.  Under contention each
+// waiter appends a per-CPU MCS node to a queue and spins on its own node, so
+// waiters do not all hammer the lock's cache line and the lock is handed
+// over in FIFO order.
+//
+// Lock word layout:
+//   bits  0- 7  locked byte (released with a plain byte store)
+//   bits  8-15  unused
+//   bits 16-31  tail: ((cpu + 1) << 2) | node index of the last waiter
+//
+// rwlock_t is a queued reader-writer lock built on the same queue: readers
+// share the lock, a waiting writer stops new readers from entering, and
+// contending readers and writers line up on the embedded spinlock.
+//
+// seqcount_t / seqlock_t let readers copy data without writing shared state
+// and retry if a writer got in between.
+//
+// Building with LOCKSTAT=1 adds per-class wait/hold accounting to every
+// spinlock_t (see lockstat.c).  A lock's class is its name.
+// ============================================================================
+
+#ifndef _KERNEL_SPINLOCK_H_
+#define _KERNEL_SPINLOCK_H_
+
+#include "types.h"
+#include "preempt.h"
+
+// UP (Uniprocessor) mode flag - when set, spinlocks only use interrupt disable
+// This avoids deadlocks on single-CPU systems where spinning would be fatal
+// Defined in smp.c, set to 1 if only one CPU is active
+extern volatile uint32_t g_smp_up_mode;
+
+static inline void cpu_relax(void) {
+    __asm__ volatile("pause" ::: "memory");
+}
+
+// ============================================================================
+// QUEUED SPINLOCK
+// ============================================================================
+
+typedef struct spinlock {
+    union {
+        volatile uint32_t val;          // Whole lock word (see layout above)
+        struct {
+            volatile uint8_t locked;    // 0 = unlocked, 1 = locked
+            volatile uint8_t reserved;
+            volatile uint16_t tail;     // Last queued waiter, 0 = none
+        };
+    };
+    volatile uint32_t owner_cpu; // For debugging: CPU that holds lock (0xFFFFFFFF = none)
+    const char* name;            // Lock name for debugging
+#ifdef LOCKSTAT
+    struct lock_class* lockstat_class;  // Resolved from name on first use
+    uint64_t lockstat_hold_start;       // TSC when the current owner got it
+#endif
+} spinlock_t;
+
+#ifdef LOCKSTAT
+#define SPINLOCK_LOCKSTAT_SIZE  16      // Bytes lockstat adds to spinlock_t
+#else
+#define SPINLOCK_LOCKSTAT_SIZE  0
+#endif
+
+#define Q_LOCKED_VAL    1U
+#define Q_TAIL_SHIFT    16
+
+// Static initializer for spinlock
+#define SPINLOCK_INIT(n) { .val = 0, .owner_cpu = 0xFFFFFFFF, .name = (n) }
+
+// Initialize a spinlock at runtime
+static inline void spinlock_init(spinlock_t* lock, const char* name) {
+    lock->val = 0;
+    lock->owner_cpu = 0xFFFFFFFF;
+    lock->name = name;
+#ifdef LOCKSTAT
+    lock->lockstat_class = NULL;
+    lock->lockstat_hold_start = 0;
+#endif
+}
+
+#ifdef LOCKSTAT
+// Accounting hooks (lockstat.c); wait_start is the TSC before the attempt
+void lockstat_acquired(spinlock_t* lock, uint64_t wait_start, int contended);
+void lockstat_released(spinlock_t* lock);
+
+static inline uint64_t lockstat_clock(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+#endif
+
+// Contended path (spinlock.c): queue up and wait for our turn
+void queued_spin_lock_slowpath(spinlock_t* lock);
+
+// Atomically take a completely free lock word (no owner, no queue)
+static inline int queued_spin_trylock(spinlock_t* lock) {
+    uint32_t expected = 0;
+    uint32_t desired = Q_LOCKED_VAL;
+    uint32_t old;
+    __asm__ volatile (
+        "lock cmpxchgl %2, %1"
+        : "=a"(old), "+m"(lock->val)
+        : "r"(desired), "0"(expected)
+        : "memory", "cc"
+    );
+    return old == 0;
+}
+
+// Acquire spinlock.  Preemption stays disabled until the matching unlock.
+// On UP systems, we don't spin - interrupts must be disabled by caller
+static inline void spin_lock(spinlock_t* lock) {
+#ifdef LOCKSTAT
+    uint64_t wait_start = lockstat_clock();
+#endif
+    preempt_disable();
+    // In UP mode, if interrupts are disabled, no other context can run,
+    // so we can "acquire" the lock without spinning
+    if (g_smp_up_mode) {
+        // Just mark as locked for debugging/assertions
+        __asm__ volatile("" ::: "memory");
+        lock->locked = 1;
+#ifdef LOCKSTAT
+        lockstat_acquired(lock, wait_start, 0);
+#endif
+        return;
+    }
+    if (__builtin_expect(queued_spin_trylock(lock), 1)) {
+#ifdef LOCKSTAT
+        lockstat_acquired(lock, wait_start, 0);
+#endif
+        return;
+    }
+    queued_spin_lock_slowpath(lock);
+#ifdef LOCKSTAT
+    lockstat_acquired(lock, wait_start, 1);
+#endif
+}
+
+// Try to acquire spinlock, return 1 if acquired, 0 if failed
+static inline int spin_trylock(spinlock_t* lock) {
+    preempt_disable();
+    // In UP mode, always succeed if interrupts are disabled
+    if (g_smp_up_mode) {
+        __asm__ volatile("" ::: "memory");
+        lock->locked = 1;
+#ifdef LOCKSTAT
+        lockstat_acquired(lock, lockstat_clock(), 0);
+#endif
+        return 1;
+    }
+    if (!queued_spin_trylock(lock)) {
+        preempt_enable();
+        return 0;
+    }
+#ifdef LOCKSTAT
+    lockstat_acquired(lock, lockstat_clock(), 0);
+#endif
+    return 1;
+}
+
+// Release the lock word only
+// On x86, stores are not reordered with stores (TSO model), so a compiler
+// barrier is sufficient for release semantics.  Only the locked byte is
+// cleared; the tail belongs to the waiters.
+static inline void spin_release(spinlock_t* lock) {
+#ifdef LOCKSTAT
+    lockstat_released(lock);
+#endif
+    lock->owner_cpu = 0xFFFFFFFF;
+    __asm__ volatile("" ::: "memory");  // compiler barrier (release semantics on x86)
+    lock->locked = 0;
+}
+
+// Release spinlock and re-enable preemption
+static inline void spin_unlock(spinlock_t* lock) {
+    spin_release(lock);
+    preempt_enable();
+}
+
+// Check if spinlock is held (or has waiters)
+static inline int spin_is_locked(spinlock_t* lock) {
+    return lock->val != 0;
+}
+
+// Save interrupt flags and disable interrupts
+static inline uint64_t local_irq_save(void) {
+    uint64_t flags;
+    __asm__ volatile (
+        "pushfq\n\t"
+        "popq %0\n\t"
+        "cli"
+        : "=r"(flags)
+        :
+        : "memory"
+    );
+    return flags;
+}
+
+// Restore interrupt flags
+static inline void local_irq_restore(uint64_t flags) {
+    __asm__ volatile (
+        "pushq %0\n\t"
+        "popfq"
+        :
+        : "r"(flags)
+        : "memory", "cc"
+    );
+}
+
+// Spinlock with interrupt save/restore (for use in interrupt handlers)
+static inline void spin_lock_irqsave(spinlock_t* lock, uint64_t* flags) {
+    *flags = local_irq_save();
+    spin_lock(lock);
+}
+
+// A reschedule held off by the lock is taken once interrupts are back on
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint64_t flags) {
+    spin_release(lock);
+    local_irq_restore(flags);
+    preempt_enable();
+}
+
+// ============================================================================
+// READER-WRITER SPINLOCK
+// ============================================================================
+// A lock that is read in interrupt context must be taken with the _irqsave
+// variants everywhere, as with spinlock_t: a reader queued behind a waiting
+// writer does not get in ahead of it.
+
+typedef struct rwlock {
+    volatile uint32_t cnts;     // Readers << 9 | writer waiting | writer locked
+    spinlock_t wait_lock;       // Queue for contending readers and writers
+} rwlock_t;
+
+#define RW_WLOCKED      0x0FFU  // Writer holds the lock (low byte)
+#define RW_WAITING      0x100U  // A writer is waiting for readers to drain
+#define RW_WMASK        0x1FFU
+#define RW_READER_BIAS  0x200U
+
+#define RWLOCK_INIT(n) { .cnts = 0, .wait_lock = SPINLOCK_INIT(n) }
+
+static inline void rwlock_init(rwlock_t* lock, const char* name) {
+    lock->cnts = 0;
+    spinlock_init(&lock->wait_lock, name);
+}
+
+// Contended paths (spinlock.c)
+void queued_read_lock_slowpath(rwlock_t* lock);
+void queued_write_lock_slowpath(rwlock_t* lock);
+
+static inline void read_lock(rwlock_t* lock) {
+    preempt_disable();
+    uint32_t c = __atomic_add_fetch(&lock->cnts, RW_READER_BIAS, __ATOMIC_ACQUIRE);
+    if (__builtin_expect(!(c & RW_WMASK), 1) || g_smp_up_mode)
+        return;
+    queued_read_lock_slowpath(lock);
+}
+
+static inline void read_release(rwlock_t* lock) {
+    __atomic_sub_fetch(&lock->cnts, RW_READER_BIAS, __ATOMIC_RELEASE);
+}
+
+static inline void read_unlock(rwlock_t* lock) {
+    read_release(lock);
+    preempt_enable();
+}
+
+// Take a free lock word for writing (no preemption accounting)
+static inline int queued_write_trylock(rwlock_t* lock) {
+    uint32_t expected = 0;
+    return __atomic_compare_exchange_n(&lock->cnts, &expected, RW_WLOCKED, 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline int write_trylock(rwlock_t* lock) {
+    preempt_disable();
+    if (queued_write_trylock(lock))
+        return 1;
+    preempt_enable();
+    return 0;
+}
+
+static inline void write_lock(rwlock_t* lock) {
+    preempt_disable();
+    if (__builtin_expect(queued_write_trylock(lock), 1))
+        return;
+    if (g_smp_up_mode) {
+        __atomic_fetch_or(&lock->cnts, RW_WLOCKED, __ATOMIC_ACQUIRE);
+        return;
+    }
+    queued_write_lock_slowpath(lock);
+}
+
+static inline void write_release(rwlock_t* lock) {
+    __asm__ volatile("" ::: "memory");  // release: clear only the writer byte
+    *(volatile uint8_t*)&lock->cnts = 0;
+}
+
+static inline void write_unlock(rwlock_t* lock) {
+    write_release(lock);
+    preempt_enable();
+}
+
+static inline void read_lock_irqsave(rwlock_t* lock, uint64_t* flags) {
+    *flags = local_irq_save();
+    read_lock(lock);
+}
+
+static inline void read_unlock_irqrestore(rwlock_t* lock, uint64_t flags) {
+    read_release(lock);
+    local_irq_restore(flags);
+    preempt_enable();
+}
+
+static inline void write_lock_irqsave(rwlock_t* lock, uint64_t* flags) {
+    *flags = local_irq_save();
+    write_lock(lock);
+}
+
+static inline void write_unlock_irqrestore(rwlock_t* lock, uint64_t flags) {
+    write_release(lock);
+    local_irq_restore(flags);
+    preempt_enable();
+}
+
+// ============================================================================
+// SEQUENCE COUNTERS
+// ============================================================================
+// The count is odd while a write is in progress.  Readers snapshot it,
+// copy the data and retry if it changed:
+//
+//     do {
+//         seq = read_seqbegin(&sl);
+//         copy = data;
+//     } while (read_seqretry(&sl, seq));
+//
+// x86 does not reorder loads with loads or stores with stores, so compiler
+// barriers give the required ordering.  Readers may not follow pointers
+// that a writer can free.
+
+typedef struct seqcount {
+    volatile uint32_t sequence;
+} seqcount_t;
+
+#define SEQCOUNT_INIT { .sequence = 0 }
+
+static inline uint32_t read_seqcount_begin(const seqcount_t* s) {
+    uint32_t seq;
+    while ((seq = s->sequence) & 1)
+        cpu_relax();
+    __asm__ volatile("" ::: "memory");
+    return seq;
+}
+
+static inline int read_seqcount_retry(const seqcount_t* s, uint32_t start) {
+    __asm__ volatile("" ::: "memory");
+    return s->sequence != start;
+}
+
+// Writers must already be serialized (single writer, or seqlock_t)
+static inline void write_seqcount_begin(seqcount_t* s) {
+    s->sequence++;
+    __asm__ volatile("" ::: "memory");
+}
+
+static inline void write_seqcount_end(seqcount_t* s) {
+    __asm__ volatile("" ::: "memory");
+    s->sequence++;
+}
+
+// Sequence counter with a spinlock serializing the writers
+typedef struct seqlock {
+    seqcount_t seqcount;
+    spinlock_t lock;
+} seqlock_t;
+
+#define SEQLOCK_INIT(n) { .seqcount = SEQCOUNT_INIT, .lock = SPINLOCK_INIT(n) }
+
+static inline void seqlock_init(seqlock_t* sl, const char* name) {
+    sl->seqcount.sequence = 0;
+    spinlock_init(&sl->lock, name);
+}
+
+static inline uint32_t read_seqbegin(const seqlock_t* sl) {
+    return read_seqcount_begin(&sl->seqcount);
+}
+
+static inline int read_seqretry(const seqlock_t* sl, uint32_t start) {
+    return read_seqcount_retry(&sl->seqcount, start);
+}
+
+static inline void write_seqlock(seqlock_t* sl) {
+    spin_lock(&sl->lock);
+    write_seqcount_begin(&sl->seqcount);
+}
+
+static inline void write_sequnlock(seqlock_t* sl) {
+    write_seqcount_end(&sl->seqcount);
+    spin_unlock(&sl->lock);
+}
+
+static inline void write_seqlock_irqsave(seqlock_t* sl, uint64_t* flags) {
+    spin_lock_irqsave(&sl->lock, flags);
+    write_seqcount_begin(&sl->seqcount);
+}
+
+static inline void write_sequnlock_irqrestore(seqlock_t* sl, uint64_t flags) {
+    write_seqcount_end(&sl->seqcount);
+    spin_unlock_irqrestore(&sl->lock, flags);
+}
+
+#endif // _KERNEL_SPINLOCK_H_
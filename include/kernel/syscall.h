@@ -196,6 +196,61 @@
 #define SYS_READV           384
 #define SYS_WRITEV          385
 
+// Process priority (nice levels)
+#define SYS_GETPRIORITY     386  // Returns 20 - nice (Linux raw syscall ABI)
+#define SYS_SETPRIORITY     387
+
+// Scheduler tunables and wakeup placement statistics (LikeOS specific)
+#define SYS_SCHEDCTL        388
+
+// Spinlock contention statistics (LikeOS specific, LOCKSTAT=1 kernels)
+#define SYS_LOCKSTAT        389
+
+// Process CPU times in clock ticks
+#define SYS_TIMES           390
+#define USER_HZ             100     // times(2) tick, sysconf(_SC_CLK_TCK)
+
+// Restartable sequences and the current CPU number
+#define SYS_RSEQ            391
+#define SYS_GETCPU          392
+
+// Per-syscall call counts and latency histograms (LikeOS specific)
+#define SYS_SYSCALLSTAT     393
+
+// Shared-memory submission/completion rings (see io_uring.h)
+#define SYS_IO_URING_SETUP  394
+#define SYS_IO_URING_ENTER  395
+
+// Zero-copy pipe data movement
+#define SYS_SPLICE          396
+#define SYS_TEE             397
+#define SYS_VMSPLICE        398
+
+// Event loop file descriptors (see eventfd.h, timerfd.h)
+#define SYS_EVENTFD2        399
+#define SYS_TIMERFD_CREATE  400
+#define SYS_TIMERFD_SETTIME 401
+#define SYS_TIMERFD_GETTIME 402
+
+// Positional and flagged vector I/O (RWF_* flags in uio.h)
+#define SYS_PREAD64         403
+#define SYS_PWRITE64        404
+#define SYS_PREADV          405
+#define SYS_PWRITEV         406
+#define SYS_PREADV2         407
+#define SYS_PWRITEV2        408
+
+// Anonymous shared memory file (see shmfs.h)
+#define SYS_MEMFD_CREATE    409
+
+// Size of the syscall table: one past the highest SYS_* number
+#define NR_SYSCALLS         410
+
+// getpriority/setpriority "which" values
+#define PRIO_PROCESS        0
+#define PRIO_PGRP           1
+#define PRIO_USER           2
+
 // rusage who values
 #define RUSAGE_SELF         0
 #define RUSAGE_CHILDREN     (-1)
@@ -222,6 +277,106 @@
 #define SYSLOG_ACTION_CLEAR      5
 #define SYSLOG_ACTION_SIZE_BUFFER 10
 
+// Scheduler control operations (for SYS_SCHEDCTL)
+#define SCHEDCTL_GET            0   // schedctl(GET, id, &value)
+#define SCHEDCTL_SET            1   // schedctl(SET, id, value)
+#define SCHEDCTL_WAKESTATS      2   // schedctl(WAKESTATS, 0, &k_sched_wakestats_t)
+#define SCHEDCTL_RESET_STATS    3   // Zero the wakeup, idle and per-CPU run queue statistics
+#define SCHEDCTL_IDLESTATS      4   // schedctl(IDLESTATS, cpu, &k_sched_idlestats_t)
+#define SCHEDCTL_CPUSTATS       5   // schedctl(CPUSTATS, cpu, &k_sched_cpustats_t)
+
+// Scheduler tunable IDs
+#define SCHED_TUNE_WAKE_AFFINE      0   // 1 = consider the waker's CPU at wakeup
+#define SCHED_TUNE_WAKE_IMBALANCE   1   // Percentage, 100..1000
+#define SCHED_TUNE_WAKE_IDLE_SCAN   2   // CPUs searched for an idle sibling (0 = off)
+#define SCHED_TUNE_MIGRATION_COST   3   // Cache-hot window in nanoseconds
+#define SCHED_TUNE_COUNT            4
+
+// Wakeup placement counters returned by SCHEDCTL_WAKESTATS
+typedef struct k_sched_wakestats {
+    uint64_t wakeups;           // Fair-class tasks placed at wakeup
+    uint64_t wake_prev;         // Stayed on the previous CPU
+    uint64_t wake_affine;       // Moved to the waker's CPU
+    uint64_t wake_idle;         // Moved to another idle CPU sharing the cache
+    uint64_t wake_migrations;   // Placed anywhere but the previous CPU
+    uint64_t wake_ipis;         // Enqueued remotely (reschedule IPI sent)
+} k_sched_wakestats_t;
+
+// Per-CPU idle state counters returned by SCHEDCTL_IDLESTATS
+#define SCHED_IDLE_MAX_STATES   8
+#define SCHED_IDLE_HLT          0xFFFFFFFFU     // mwait_hint of a state entered with HLT
+
+typedef struct k_sched_idlestate {
+    uint32_t type;              // ACPI C-state type (1 = C1, 2 = C2, 3 = C3)
+    uint32_t mwait_hint;        // MWAIT EAX hint, SCHED_IDLE_HLT for HLT
+    uint32_t latency_us;        // Worst-case exit latency
+    uint32_t reserved;
+    uint64_t usage;             // Times entered
+    uint64_t time_ns;           // Total residency
+} k_sched_idlestate_t;
+
+typedef struct k_sched_idlestats {
+    uint32_t nr_states;
+    uint32_t polling;           // 1 = MWAIT on need_resched, 0 = HLT
+    uint64_t ipis_avoided;      // Remote wakeups that needed no reschedule IPI
+    k_sched_idlestate_t states[SCHED_IDLE_MAX_STATES];
+} k_sched_idlestats_t;
+
+// Per-CPU scheduler statistics returned by SCHEDCTL_CPUSTATS.  Histogram
+// bucket 0 counts wakeup-to-run latencies under 1 us, bucket i those in
+// [2^(i-1), 2^i) us, the last bucket everything longer.
+#define SCHED_STAT_LAT_BUCKETS  16
+
+typedef struct k_sched_cpustats {
+    uint64_t context_switches;
+    uint64_t run_delay_ns;      // Time tasks waited on this CPU's run queue
+    uint64_t pcount;            // Tasks given the CPU
+    uint64_t migrations;        // Tasks placed here from another CPU
+    uint64_t wakeup_hist[SCHED_STAT_LAT_BUCKETS];
+    uint64_t irq_time_ns;       // Time spent in hard interrupt handlers
+} k_sched_cpustats_t;
+
+// Lock statistics operations (for SYS_LOCKSTAT)
+#define LOCKSTAT_READ           0   // lockstat(READ, &k_lockstat_entry_t[], count)
+#define LOCKSTAT_RESET          1   // Zero all counters
+#define LOCKSTAT_TSC_HZ         2   // Returns the TSC frequency (0 if unknown)
+
+// Per-lock-class counters returned by LOCKSTAT_READ (times in TSC cycles)
+#define LOCKSTAT_NAME_LEN       32
+
+typedef struct k_lockstat_entry {
+    char     name[LOCKSTAT_NAME_LEN];
+    uint64_t acquisitions;      // Successful lock/trylock calls
+    uint64_t contentions;       // Acquisitions that had to wait
+    uint64_t wait_total;        // Cycles spent waiting
+    uint64_t wait_max;
+    uint64_t hold_total;        // Cycles between acquire and release
+    uint64_t hold_max;
+} k_lockstat_entry_t;
+
+// Syscall statistics operations (for SYS_SYSCALLSTAT)
+#define SYSCALLSTAT_ENABLE      0   // syscallstat(ENABLE, pid): zero counters, count pid's calls (0 = all)
+#define SYSCALLSTAT_DISABLE     1   // Stop counting, keep the counters
+#define SYSCALLSTAT_RESET       2   // Zero all counters
+#define SYSCALLSTAT_READ        3   // syscallstat(READ, &k_syscallstat_entry_t[], count)
+#define SYSCALLSTAT_TSC_HZ      4   // Returns the TSC frequency (0 if unknown)
+
+// Per-syscall totals returned by SYSCALLSTAT_READ, one entry for each
+// syscall called since the last reset (times in TSC cycles).  Histogram
+// bucket 0 counts calls under 64 cycles, bucket i those in
+// [2^(i+5), 2^(i+6)) cycles, the last bucket everything longer.
+#define SYSCALLSTAT_BUCKETS     32
+
+typedef struct k_syscallstat_entry {
+    uint32_t nr;                // Syscall number
+    uint32_t reserved;
+    uint64_t calls;
+    uint64_t errors;            // Calls that returned -errno
+    uint64_t time_total;        // Cycles from dispatch to return
+    uint64_t time_max;
+    uint64_t hist[SYSCALLSTAT_BUCKETS];
+} k_syscallstat_entry_t;
+
 // sysinfo structure returned by SYS_SYSINFO
 typedef struct k_sysinfo {
     long     uptime;          // Seconds since boot
@@ -276,6 +431,14 @@ typedef struct k_sysinfo {
 #define F_GETFL         3
 #define F_SETFL         4
 #define F_DUPFD_CLOEXEC 1030
+#define F_SETPIPE_SZ    1031
+#define F_GETPIPE_SZ    1032
+
+// splice/tee/vmsplice flags
+#define SPLICE_F_MOVE       0x01
+#define SPLICE_F_NONBLOCK   0x02
+#define SPLICE_F_MORE       0x04
+#define SPLICE_F_GIFT       0x08
 #ifndef FD_CLOEXEC
 #define FD_CLOEXEC      1
 #endif
@@ -308,6 +471,7 @@ typedef struct k_sysinfo {
 #define EINTR           4   // Interrupted system call
 #define ESRCH           3   // No such process
 #define EIO             5   // I/O error
+#define ENXIO           6   // No such device or address
 #define ENOMEM          12  // Out of memory
 #define EACCES          13  // Permission denied
 #define EFAULT          14  // Bad address
@@ -324,6 +488,7 @@ typedef struct k_sysinfo {
 #define EEXIST          17  // File exists
 #define EXDEV           18  // Cross-device link
 #define EISDIR          21  // Is a directory
+#define EFBIG           27  // File too large
 #define ENOSPC          28  // No space left on device
 #define EROFS           30  // Read-only file system
 #define ENAMETOOLONG    36  // File name too long
@@ -356,10 +521,18 @@ typedef struct k_sysinfo {
 #define ELOOP           40  // Too many symbolic links
 #define ENFILE          23  // File table overflow
 #define EMSGSIZE        90  // Message too long
+#define ETIME           62  // Timer expired
+#define ECANCELED      125  // Operation canceled
 
-// Syscall handler prototype
+// Syscall handler prototype (called from syscall_entry with the six
+// argument registers rdi, rsi, rdx, r10, r8, r9)
 int64_t syscall_handler(uint64_t num, uint64_t a1, uint64_t a2,
-                        uint64_t a3, uint64_t a4, uint64_t a5);
+                        uint64_t a3, uint64_t a4, uint64_t a5, uint64_t a6);
+
+// Run syscall num for the current task without the entry/exit work
+// (accounting, signal delivery); io_uring issues its operations this way
+int64_t syscall_dispatch(uint64_t num, uint64_t a1, uint64_t a2, uint64_t a3,
+                         uint64_t a4, uint64_t a5, uint64_t a6);
 
 // ============================================================================
 // Process info structure for SYS_GETPROCINFO
@@ -375,21 +548,31 @@ typedef struct procinfo {
     int     euid;           // Effective user ID
     int     egid;           // Effective group ID
     int     state;          // 0=READY 1=RUNNING 2=BLOCKED 3=STOPPED 4=ZOMBIE
-    int     nice;           // Nice value (always 0 for now)
+    int     nice;           // Nice value (-20..19)
     int     nr_threads;     // Number of threads in thread group
     int     on_cpu;         // CPU number the task runs on
     int     exit_code;      // Exit status (for zombies)
     int     tty_nr;         // Controlling terminal (0 = none)
     int     is_kernel;      // 1 if kernel task, 0 if user
     uint64_t start_tick;    // Tick when process started
-    uint64_t utime_ticks;   // User-mode ticks
-    uint64_t stime_ticks;   // Kernel-mode ticks
+    uint64_t utime_ticks;   // User-mode time in USER_HZ ticks
+    uint64_t stime_ticks;   // Kernel-mode time in USER_HZ ticks
     uint64_t vsz;           // Virtual memory size (bytes)
     uint64_t rss;           // Resident set size (pages)
     char    comm[256];      // Process name (basename of executable)
     char    cmdline[1024];  // Full command line (argv joined by spaces)
     char    environ[2048];  // Environment (envp joined by spaces)
     char    cwd[256];       // Current working directory
+    // Scheduler statistics (nanoseconds)
+    uint64_t run_time_ns;   // CPU time consumed
+    uint64_t run_delay_ns;  // Time runnable but waiting for a CPU
+    uint64_t pcount;        // Times given a CPU
+    uint64_t nvcsw;         // Voluntary context switches
+    uint64_t nivcsw;        // Involuntary context switches
+    uint64_t nr_migrations; // Moves to another CPU
+    uint64_t block_ns;      // Time blocked on a wait channel (I/O, locks, ...)
+    uint64_t sleep_ns;      // Time in other sleeps (nanosleep, pause, ...)
+    uint32_t wakeup_hist[SCHED_STAT_LAT_BUCKETS]; // Wakeup-to-run latency, log2 us
 } procinfo_t;
 
 #endif // _KERNEL_SYSCALL_H_
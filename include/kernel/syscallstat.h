@@ -0,0 +1,42 @@
+// LikeOS-64 - Syscall Statistics
+// ============================================================================
+// Optional per-syscall call, error and latency accounting, switched on at
+// run time through SYS_SYSCALLSTAT (see the syscount(1) tool).  Counters
+// live in per-CPU arrays indexed by syscall number and are summed when
+// read.  Latency is measured in TSC cycles from dispatch to return, so time
+// a syscall spends blocked is included.  While accounting is off the
+// syscall path only tests syscallstat_active().
+// ============================================================================
+
+#ifndef _KERNEL_SYSCALLSTAT_H_
+#define _KERNEL_SYSCALLSTAT_H_
+
+#include "types.h"
+
+struct k_syscallstat_entry;
+
+extern volatile int g_syscallstat_on;
+
+static inline int syscallstat_active(void) {
+    return g_syscallstat_on;
+}
+
+// Account syscall num, which returned ret, started at TSC start.  Called
+// by the dispatcher on the task's way out; filters on the traced process.
+void syscallstat_record(uint64_t num, int64_t ret, uint64_t start);
+
+// Zero the counters and start counting syscalls of process pid (0 = all).
+// Returns -ENOMEM if the per-CPU arrays cannot be allocated.
+int syscallstat_enable(int pid);
+
+// Stop counting; the counters keep their values
+int syscallstat_disable(void);
+
+// Zero every counter
+int syscallstat_reset(void);
+
+// Fill *out with the totals for syscall nr.  Returns 1 if it was called
+// since the last reset, 0 if not, -EINVAL past the last syscall number.
+int syscallstat_get(uint32_t nr, struct k_syscallstat_entry* out);
+
+#endif // _KERNEL_SYSCALLSTAT_H_
@@ -0,0 +1,40 @@
+// LikeOS-64 - Timer Files (timerfd)
+// ============================================================================
+// A timerfd delivers timer expirations through a file descriptor: read()
+// returns the number of expirations since the last read as a uint64_t and
+// blocks while there are none, and the fd polls readable once the timer
+// has fired.  Timers run on hrtimers (see hrtimer.h); a periodic timer is
+// re-armed from its own callback at the next multiple of its interval, so
+// expirations are counted exactly and the period does not drift however
+// late a given expiry is noticed.
+//
+// CLOCK_REALTIME timers are kept on the monotonic clock; an absolute
+// realtime expiry is converted when the timer is set.
+// ============================================================================
+
+#ifndef _KERNEL_TIMERFD_H_
+#define _KERNEL_TIMERFD_H_
+
+#include "types.h"
+#include "vfs.h"
+#include "signal.h"
+
+// timerfd_create() flags
+#define TFD_NONBLOCK            0x00800     // O_NONBLOCK
+#define TFD_CLOEXEC             0x80000     // O_CLOEXEC
+
+// timerfd_settime() flags
+#define TFD_TIMER_ABSTIME       0x1
+#define TFD_TIMER_CANCEL_ON_SET 0x2         // Accepted; clock jumps are not tracked
+
+int timerfd_create(int clockid, int flags, vfs_file_t** out);
+
+// Returns 1 if the file is a timerfd
+int timerfd_is_timerfd(vfs_file_t* f);
+
+// Arm or disarm (it_value zero); the previous setting goes to *old if set
+int timerfd_settime(vfs_file_t* f, int flags, const struct k_itimerspec* new_value,
+                    struct k_itimerspec* old);
+void timerfd_gettime(vfs_file_t* f, struct k_itimerspec* cur);
+
+#endif // _KERNEL_TIMERFD_H_
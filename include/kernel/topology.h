@@ -0,0 +1,75 @@
+// LikeOS-64 - CPU Topology and Scheduling Domains
+// Enumerates SMT / core / cache / package relationships from CPUID and
+// groups CPUs into per-CPU scheduling domains for the load balancer.
+
+#ifndef _KERNEL_TOPOLOGY_H_
+#define _KERNEL_TOPOLOGY_H_
+
+#include "types.h"
+
+// ============================================================================
+// Scheduling Domain Levels (innermost first)
+// ============================================================================
+
+#define SD_LEVEL_SMT    0   // Hardware threads of one core
+#define SD_LEVEL_MC     1   // Cores sharing the last-level cache
+#define SD_LEVEL_PKG    2   // All CPUs of one package (socket)
+#define SD_LEVEL_SYS    3   // Every online CPU
+#define SD_NR_LEVELS    4
+
+// ============================================================================
+// Per-CPU Topology (from CPUID leaf 0x1F / 0xB, cache leaf 4 / 0x8000001D)
+// ============================================================================
+
+typedef struct cpu_topology {
+    uint32_t x2apic_id;     // Full x2APIC ID of this logical CPU
+    uint32_t core_key;      // x2apic_id >> smt_shift (equal for SMT siblings)
+    uint32_t llc_key;       // x2apic_id >> llc_shift (equal when sharing the LLC)
+    uint32_t l2_key;        // x2apic_id >> l2_shift (equal when sharing L2)
+    uint32_t pkg_key;       // x2apic_id >> pkg_shift (equal within a package)
+    uint8_t smt_shift;      // APIC ID bits that select the thread within a core
+    uint8_t pkg_shift;      // APIC ID bits that select the CPU within a package
+    uint8_t llc_shift;
+    uint8_t l2_shift;
+    uint8_t llc_level;      // Cache level of the LLC (0 = unknown)
+    uint8_t leaf;           // CPUID leaf used (0x1F, 0xB, or 1 for legacy)
+    bool valid;             // Filled in by topology_init_cpu()
+} cpu_topology_t;
+
+// ============================================================================
+// Scheduling Domain (one per CPU per level)
+// ============================================================================
+
+typedef struct sched_domain {
+    uint64_t span;              // CPUs in this domain (bit per cpu_id)
+    uint32_t min_interval;      // Balance interval while this CPU is idle (ticks)
+    uint32_t max_interval;      // Balance interval while this CPU is busy (ticks)
+    uint32_t imbalance_pct;     // Busiest load must exceed local by this percentage
+    uint32_t nr_failed;         // Consecutive passes that found only cache-hot tasks
+    uint64_t next_balance;      // percpu timer_ticks value of the next balance pass
+    bool active;                // Level spans more CPUs than the level below it
+} sched_domain_t;
+
+// ============================================================================
+// Topology Functions
+// ============================================================================
+
+// Read this CPU's topology via CPUID.  Must run on the CPU being described.
+void topology_init_cpu(uint32_t cpu_id);
+
+// Build scheduling domains once every CPU has run topology_init_cpu().
+void topology_build_domains(void);
+
+// True once topology_build_domains() has completed
+bool topology_domains_ready(void);
+
+// Topology of a CPU (NULL if unknown)
+const cpu_topology_t* topology_cpu(uint32_t cpu_id);
+
+// Scheduling domain of cpu_id at level (SD_LEVEL_*), NULL before build
+sched_domain_t* topology_domain(uint32_t cpu_id, int level);
+
+// True if CPUs a and b share a last-level cache (or are the same CPU)
+bool topology_cpus_share_cache(uint32_t a, uint32_t b);
+
+#endif // _KERNEL_TOPOLOGY_H_
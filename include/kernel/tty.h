@@ -4,6 +4,8 @@
 
 #include "types.h"
 #include "sched.h"
+#include "wait.h"
+#include "poll.h"
 
 // Termios-like types
 typedef unsigned int tcflag_t;
@@ -90,6 +92,7 @@ typedef struct tty {
     uint8_t mouse_last_buttons; // last button state for release detection
 
     task_t* read_waiters;
+    wait_queue_head_t read_wq;  // poll/epoll watchers, woken with readers
 
     void (*output)(struct tty* tty, char c);
     void* priv; // pty linkage
@@ -120,7 +123,7 @@ int tty_pty_is_allocated(int id);
 long tty_pty_master_read(int id, void* buf, long count, int nonblock);
 long tty_pty_master_write(int id, const void* buf, long count);
 int tty_pty_master_close(int id);
-int tty_pty_master_poll(int id, int events);
+int tty_pty_master_poll(int id, int events, poll_table_t* pt);
 int tty_pty_slave_close(int id);
 
 #endif
@@ -27,4 +27,15 @@ typedef int bool;
 #define NULL ((void*)0)
 #endif
 
+// Callback queued with call_rcu() (see rcu.h).  Embedded in RCU-freed
+// objects, so it lives here where every structure definition can see it.
+typedef struct rcu_head {
+    struct rcu_head* next;
+    void (*func)(struct rcu_head* head);
+} rcu_head_t;
+
+// Pointer to the structure containing member `member` at ptr
+#define container_of(ptr, type, member) \
+    ((type*)((char*)(ptr) - __builtin_offsetof(type, member)))
+
 #endif // _KERNEL_TYPES_H_
@@ -0,0 +1,163 @@
+// LikeOS-64 - User Memory Access
+// ============================================================================
+// Copies between kernel and user memory that survive bad user pointers.
+// Every instruction that may touch a user address is listed in the
+// __ex_table section with a fixup address.  When one of them faults and
+// the fault handler cannot resolve the fault (a COW break), it looks the
+// faulting RIP up with search_exception_tables() and resumes at the fixup,
+// so the access fails with -EFAULT instead of killing the task.
+//
+// access_ok() only keeps pointers inside the user half; whether the pages
+// are mapped is left to the fault.  All of these lift SMAP themselves.
+//
+//  - copy_from_user() / copy_to_user() / clear_user() return 0 or -EFAULT.
+//  - __copy_from_user() / __copy_to_user() return the number of bytes NOT
+//    copied, for callers that report a short transfer (read, write).  The
+//    caller has checked access_ok().
+//  - get_user() / put_user() move one 1, 2, 4 or 8 byte value.
+//  - strncpy_from_user() / strnlen_user() see below.
+// ============================================================================
+
+#ifndef _KERNEL_UACCESS_H_
+#define _KERNEL_UACCESS_H_
+
+#include "types.h"
+#include "memory.h"
+#include "syscall.h"
+
+#define USER_ADDR_MIN       0x10000ULL          // Low pages stay unmapped
+#define USER_ADDR_END       0x7FFFFFFFFFFFULL   // Last canonical user page
+
+typedef struct exception_table_entry {
+    uint64_t insn;              // Address of an instruction that may fault
+    uint64_t fixup;             // Where to resume if it does
+} exception_table_entry_t;
+
+// Record an (insn, fixup) pair from inline asm; both are local labels
+#define _ASM_EXTABLE(from, to)                  \
+    ".pushsection __ex_table, \"a\"\n"          \
+    ".balign 8\n"                               \
+    ".quad " #from ", " #to "\n"                \
+    ".popsection\n"
+
+// Fixup address for a kernel instruction that faulted, or 0
+uint64_t search_exception_tables(uint64_t rip);
+
+static inline bool access_ok(const void* ptr, size_t len) {
+    uint64_t addr = (uint64_t)ptr;
+    return addr >= USER_ADDR_MIN && addr < USER_ADDR_END && len <= USER_ADDR_END - addr;
+}
+
+size_t __copy_from_user(void* dst, const void* user_src, size_t len);
+size_t __copy_to_user(void* user_dst, const void* src, size_t len);
+
+static inline int copy_from_user(void* dst, const void* user_src, size_t len) {
+    if (!access_ok(user_src, len)) {
+        return -EFAULT;
+    }
+    return __copy_from_user(dst, user_src, len) ? -EFAULT : 0;
+}
+
+static inline int copy_to_user(void* user_dst, const void* src, size_t len) {
+    if (!access_ok(user_dst, len)) {
+        return -EFAULT;
+    }
+    return __copy_to_user(user_dst, src, len) ? -EFAULT : 0;
+}
+
+int clear_user(void* user_dst, size_t len);
+
+// Copy a NUL-terminated string of at most count bytes.  Returns its length
+// (dst is terminated), count if no NUL came first (dst is not terminated),
+// or -EFAULT.
+long strncpy_from_user(char* dst, const char* user_src, long count);
+
+// Length of a user string, count if no NUL is in its first count bytes,
+// or -EFAULT
+long strnlen_user(const char* user_str, long count);
+
+// ----------------------------------------------------------------------------
+// Single values.  The __ forms assume SMAP is lifted and the range checked,
+// for loops that do both once around many accesses.
+// ----------------------------------------------------------------------------
+
+#define __get_user_asm(val, ptr, err, insn)                         \
+    __asm__ volatile("1: " insn " %2, %1\n"                         \
+                     "2:\n"                                         \
+                     ".pushsection .fixup, \"ax\"\n"                \
+                     "3: mov %3, %0\n"                              \
+                     "   xor %k1, %k1\n"                            \
+                     "   jmp 2b\n"                                  \
+                     ".popsection\n"                                \
+                     _ASM_EXTABLE(1b, 3b)                           \
+                     : "+r"(err), "=r"(val)                         \
+                     : "m"(*(ptr)), "i"(-EFAULT))
+
+#define __put_user_asm(val, ptr, err, insn)                         \
+    __asm__ volatile("1: " insn " %1, %2\n"                         \
+                     "2:\n"                                         \
+                     ".pushsection .fixup, \"ax\"\n"                \
+                     "3: mov %3, %0\n"                              \
+                     "   jmp 2b\n"                                  \
+                     ".popsection\n"                                \
+                     _ASM_EXTABLE(1b, 3b)                           \
+                     : "+r"(err), "=m"(*(ptr))                      \
+                     : "r"(val), "i"(-EFAULT))
+
+static inline int __get_user_size(uint64_t* out, const void* ptr, size_t size) {
+    int err = 0;
+    uint64_t val;
+    switch (size) {
+    case 1: __get_user_asm(val, (const uint8_t*)ptr, err, "movzbq"); break;
+    case 2: __get_user_asm(val, (const uint16_t*)ptr, err, "movzwq"); break;
+    case 4: {
+        uint32_t v32;
+        __get_user_asm(v32, (const uint32_t*)ptr, err, "movl");
+        val = v32;
+        break;
+    }
+    case 8: __get_user_asm(val, (const uint64_t*)ptr, err, "movq"); break;
+    default: return -EFAULT;
+    }
+    *out = val;
+    return err;
+}
+
+static inline int __put_user_size(uint64_t val, void* ptr, size_t size) {
+    int err = 0;
+    switch (size) {
+    case 1: __put_user_asm((uint8_t)val, (uint8_t*)ptr, err, "movb"); break;
+    case 2: __put_user_asm((uint16_t)val, (uint16_t*)ptr, err, "movw"); break;
+    case 4: __put_user_asm((uint32_t)val, (uint32_t*)ptr, err, "movl"); break;
+    case 8: __put_user_asm(val, (uint64_t*)ptr, err, "movq"); break;
+    default: return -EFAULT;
+    }
+    return err;
+}
+
+// x = *ptr; 0 or -EFAULT (x is zeroed on a fault)
+#define get_user(x, ptr) ({                                         \
+    uint64_t __gu_val = 0;                                          \
+    int __gu_err = -EFAULT;                                         \
+    if (access_ok((ptr), sizeof(*(ptr)))) {                         \
+        smap_disable();                                             \
+        __gu_err = __get_user_size(&__gu_val, (ptr), sizeof(*(ptr))); \
+        smap_enable();                                              \
+    }                                                               \
+    (x) = (__typeof__(*(ptr)))__gu_val;                             \
+    __gu_err;                                                       \
+})
+
+// *ptr = x; 0 or -EFAULT
+#define put_user(x, ptr) ({                                         \
+    __typeof__(*(ptr)) __pu_val = (x);                              \
+    int __pu_err = -EFAULT;                                         \
+    if (access_ok((ptr), sizeof(*(ptr)))) {                         \
+        smap_disable();                                             \
+        __pu_err = __put_user_size((uint64_t)__pu_val, (ptr), sizeof(*(ptr))); \
+        smap_enable();                                              \
+    }                                                               \
+    __pu_err;                                                       \
+})
+
+#endif // _KERNEL_UACCESS_H_
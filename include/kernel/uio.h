@@ -0,0 +1,66 @@
+// LikeOS-64 - I/O Vectors
+// ============================================================================
+// An iov_iter walks a list of buffers for readv/writev, preadv/pwritev and
+// recvmsg/sendmsg, so a file, pipe or socket can move one request's data
+// in a single pass instead of being called once per buffer.  The segment
+// array is a kernel copy (see import_iovec()); the buffers it names are
+// user memory that has passed access_ok(), or kernel memory for callers
+// such as sendfile, since the __copy_*_user helpers accept both.
+//
+// copy_to_iter() / copy_from_iter() advance the iterator by what they
+// moved and return that; a short count with it->count left means a fault.
+// ============================================================================
+
+#ifndef _KERNEL_UIO_H_
+#define _KERNEL_UIO_H_
+
+#include "types.h"
+
+#define UIO_FASTIOV     8           // Segments import_iovec() keeps on the stack
+#define UIO_MAXIOV      1024        // IOV_MAX
+
+// Largest transfer one read/write-style call makes; longer requests are
+// cut short like any other partial transfer
+#define MAX_RW_COUNT    (1024UL * 1024 * 1024)
+
+// preadv2/pwritev2 flags
+#define RWF_HIPRI       0x01        // Accepted, no polled I/O here
+#define RWF_DSYNC       0x02        // Write through to the disk like fsync
+#define RWF_SYNC        0x04
+#define RWF_NOWAIT      0x08        // -EAGAIN instead of waiting for the disk
+#define RWF_APPEND      0x10        // Write at the end, as if O_APPEND
+#define RWF_SUPPORTED   (RWF_HIPRI | RWF_DSYNC | RWF_SYNC | RWF_NOWAIT | RWF_APPEND)
+
+struct iovec {
+    void*  iov_base;
+    size_t iov_len;
+};
+
+typedef struct iov_iter {
+    const struct iovec* iov;        // Current segment
+    unsigned long nr_segs;          // Segments left, counting the current one
+    size_t iov_offset;              // Bytes of the current segment used up
+    size_t count;                   // Bytes left over all segments
+} iov_iter_t;
+
+void iov_iter_init(iov_iter_t* it, const struct iovec* iov, unsigned long nr_segs, size_t count);
+void iov_iter_advance(iov_iter_t* it, size_t bytes);
+
+size_t copy_to_iter(const void* src, size_t len, iov_iter_t* it);
+size_t copy_from_iter(void* dst, size_t len, iov_iter_t* it);
+
+// Copy nr_segs iovecs in from user space, check each buffer and set up
+// an iterator over them.  *iov is `fast` when nr_segs <= UIO_FASTIOV and
+// a kalloc()ed array otherwise, for the caller to kfree().  The total is
+// capped at MAX_RW_COUNT.  Returns the byte count or a negative errno.
+long import_iovec(const struct iovec* uvec, unsigned long nr_segs,
+                  struct iovec* fast, struct iovec** iov, iov_iter_t* it);
+
+// One-segment iterator for a plain read()/write() buffer
+static inline void iov_iter_single(iov_iter_t* it, struct iovec* iov, void* buf, size_t len) {
+    iov->iov_base = buf;
+    iov->iov_len = len;
+    iov_iter_init(it, iov, 1, len);
+}
+
+#endif // _KERNEL_UIO_H_
@@ -13,6 +13,12 @@ typedef unsigned long uintptr_t;
 #define VFS_MAX_PATH 256
 
 typedef struct vfs_file vfs_file_t;
+struct pipe;
+struct poll_table_struct;
+struct iov_iter;
+
+// read_iter/write_iter position meaning "the file position, advanced"
+#define VFS_POS_CUR (-1L)
 
 typedef struct {
     int (*open)(const char* path, int flags, vfs_file_t** out);
@@ -28,6 +34,24 @@ typedef struct {
     int (*rmdir)(const char* path);
     int (*chdir)(const char* path);
     int (*close)(vfs_file_t* f);
+    // Optional: the physical page backing byte `offset` of a MAP_SHARED
+    // mapping, with a page reference taken for the new mapping
+    int (*mmap)(vfs_file_t* f, unsigned long offset, unsigned long* phys);
+    // Optional: move up to `bytes` from the file position into free slots
+    // of a locked pipe as page references, advancing the position
+    long (*splice_read)(vfs_file_t* f, struct pipe* pipe, long bytes);
+    // Optional: poll revents for files that are not always ready; must
+    // not block, and passes its wait queue to poll_wait() (see poll.h).
+    // Without it a file polls as readable and writable.
+    short (*poll)(vfs_file_t* f, short events, struct poll_table_struct* pt);
+    // Optional: move data between the file at `pos` and every segment of
+    // `it` in one call (see uio.h).  pos is VFS_POS_CUR for read/readv,
+    // which use and advance the file position; pread-style callers pass
+    // an offset and the file position is left alone.  flags take RWF_*.
+    // Without them readv/writev call read/write once per segment and
+    // pread/pwrite fail with ESPIPE.
+    long (*read_iter)(vfs_file_t* f, struct iov_iter* it, long pos, int flags);
+    long (*write_iter)(vfs_file_t* f, struct iov_iter* it, long pos, int flags);
 } vfs_ops_t;
 
 struct vfs_file {
@@ -52,6 +76,9 @@ int vfs_chdir(const char* path);
 long vfs_read(vfs_file_t* f, void* buf, long bytes);
 long vfs_write(vfs_file_t* f, const void* buf, long bytes);
 long vfs_seek(vfs_file_t* f, long offset, int whence);
+long vfs_splice_read(vfs_file_t* f, struct pipe* pipe, long bytes);  // ST_UNSUPPORTED if no op
+long vfs_read_iter(vfs_file_t* f, struct iov_iter* it, long pos, int flags);
+long vfs_write_iter(vfs_file_t* f, struct iov_iter* it, long pos, int flags);
 long vfs_readdir(vfs_file_t* f, void* buf, long bytes);
 int vfs_truncate(vfs_file_t* f, unsigned long size);
 int vfs_unlink(const char* path);
@@ -60,6 +87,7 @@ int vfs_mkdir(const char* path, unsigned int mode);
 int vfs_rmdir(const char* path);
 int vfs_close(vfs_file_t* f);
 size_t vfs_size(vfs_file_t* f);
+int vfs_on_root(vfs_file_t* f);      // File was opened on the root filesystem
 vfs_file_t* vfs_dup(vfs_file_t* f);  // Increment refcount and return same pointer
 void vfs_incref(vfs_file_t* f);      // Increment refcount
 
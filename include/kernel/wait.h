@@ -0,0 +1,99 @@
+// LikeOS-64 - Wait Queues
+// ============================================================================
+// A wait queue is the list of entries waiting for one event source (a pipe
+// becoming readable, a timer firing).  A waker walks only that list instead
+// of scanning every task the way sched_wake_channel() does, and can pass a
+// key (a poll event mask) that the entries' wake functions look at.
+//
+// The default entry wakes its task and removes itself.  Entries with their
+// own wake function stay queued until removed and may do anything that is
+// safe under a spinlock with interrupts off.
+//
+// Exclusive entries queue behind all the others, and a wakeup stops after
+// the first exclusive entry whose function reports a woken task, so a
+// pool of threads waiting on one source is woken one at a time.
+//
+// Sleeping on a condition:
+//
+//     wait_queue_entry_t wait;
+//     init_wait_entry(&wait, cur);
+//     for (;;) {
+//         prepare_to_wait(&wq, &wait);    // queue and mark TASK_BLOCKED
+//         if (condition || signal_pending(cur)) break;
+//         sched_schedule();
+//     }
+//     finish_wait(&wq, &wait);
+//
+// The waker makes the condition true and then calls wake_up(&wq).  Since
+// the sleeper queues itself before testing, a wakeup between the test and
+// sched_schedule() only makes sched_schedule() return at once.
+// ============================================================================
+
+#ifndef _KERNEL_WAIT_H_
+#define _KERNEL_WAIT_H_
+
+#include "types.h"
+#include "spinlock.h"
+
+struct task;
+typedef struct wait_queue_entry wait_queue_entry_t;
+
+// Called under the queue's lock for each entry a wake_up() reaches.
+// Returns 1 if it woke a task.
+typedef int (*wait_func_t)(wait_queue_entry_t* entry, unsigned long key);
+
+struct wait_queue_entry {
+    struct task* task;
+    wait_func_t func;
+    void* private;              // For func
+    wait_queue_entry_t* next;
+    wait_queue_entry_t* prev;
+    int queued;
+    int flags;                  // WQ_FLAG_*
+};
+
+#define WQ_FLAG_EXCLUSIVE   0x01
+
+typedef struct wait_queue_head {
+    spinlock_t lock;
+    wait_queue_entry_t* head;   // Non-exclusive entries, then exclusive
+    wait_queue_entry_t* tail;
+} wait_queue_head_t;
+
+#define WAIT_QUEUE_HEAD_INIT(n) { .lock = SPINLOCK_INIT(n), .head = NULL, .tail = NULL }
+
+void wait_queue_init(wait_queue_head_t* wq, const char* name);
+
+// Entry that wakes task and dequeues itself
+void init_wait_entry(wait_queue_entry_t* entry, struct task* task);
+// Entry with its own wake function; stays queued until removed
+void init_wait_func_entry(wait_queue_entry_t* entry, wait_func_t func, void* private);
+
+void add_wait_queue(wait_queue_head_t* wq, wait_queue_entry_t* entry);
+void add_wait_queue_exclusive(wait_queue_head_t* wq, wait_queue_entry_t* entry);
+void remove_wait_queue(wait_queue_head_t* wq, wait_queue_entry_t* entry);
+
+// Queue entry (if it is not queued) and block the current task on wq
+void prepare_to_wait(wait_queue_head_t* wq, wait_queue_entry_t* entry);
+void prepare_to_wait_exclusive(wait_queue_head_t* wq, wait_queue_entry_t* entry);
+// Undo prepare_to_wait() after waking or deciding not to sleep
+void finish_wait(wait_queue_head_t* wq, wait_queue_entry_t* entry);
+
+// Run the wake function of every non-exclusive entry and of exclusive
+// entries up to the first that wakes a task, passing key (0 = any event).
+// Safe from any context.  Returns the number of tasks woken.
+int wake_up_key(wait_queue_head_t* wq, unsigned long key);
+
+static inline int wake_up(wait_queue_head_t* wq) {
+    return wake_up_key(wq, 0);
+}
+
+// Lockless check for waiters.  A waker that skips wake_up() when this is
+// false must order its condition update before the check (the full barrier
+// here); prepare_to_wait() orders the sleeper's queueing before its test.
+static inline int waitqueue_active(wait_queue_head_t* wq) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&wq->head, __ATOMIC_RELAXED) != NULL;
+}
+
+#endif // _KERNEL_WAIT_H_
@@ -0,0 +1,149 @@
+// LikeOS-64 - Workqueues
+// ============================================================================
+// Deferred work in process context.  A work item is a function plus an
+// embedded work_t; queueing it hands it to a pool of kernel worker threads
+// that run it with interrupts enabled and may sleep.  Queueing is safe from
+// any context, including hard IRQ, and a work item that is already pending
+// is not queued twice.
+//
+// Pools:
+//   - one bound pool per CPU ("kworker/N:M"), workers pinned to that CPU.
+//     Concurrency management keeps one worker running per CPU: when it
+//     blocks inside a work function the scheduler tells the pool
+//     (wq_worker_sleeping) and an idle worker takes the next item, so a
+//     sleeping item never stalls the rest of the queue.
+//   - one unbound pool ("kworker/u:M") whose workers may run anywhere, up
+//     to one running worker per online CPU, for long or I/O-bound work.
+// Pools start with one worker and grow on demand (a worker leaving the idle
+// list spawns a reserve if none is left), up to WQ_MAX_WORKERS.  Workers
+// are never torn down; surplus ones stay parked on the idle list.
+//
+// Delayed work sits on a timer wheel advanced by the BSP timer tick and is
+// queued to its workqueue when it expires.
+//
+// flush_work() waits for one item to finish, flush_workqueue() for
+// everything queued to a workqueue, and the cancel_*_sync() calls remove a
+// pending item and wait out a running one; the item may requeue itself
+// meanwhile, which the cancel suppresses.
+// ============================================================================
+
+#ifndef _KERNEL_WORKQUEUE_H_
+#define _KERNEL_WORKQUEUE_H_
+
+#include "types.h"
+
+#define WQ_MAX_WORKERS      8       // Workers per pool
+#define WQ_TIMER_SLOTS      256     // Timer wheel slots (one tick each, power of two)
+
+// workqueue_t::flags
+#define WQ_UNBOUND          0x01    // Run on the unbound pool
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct* work);
+
+typedef struct work_struct {
+    struct work_struct* next;       // Pool worklist link
+    struct work_struct* prev;
+    work_func_t func;
+    volatile int pending;           // Queued or timer armed; cleared before func runs
+    volatile int canceling;         // cancel_*_sync() in progress: refuse to queue
+    struct worker_pool* pool;       // Pool it was last queued on
+    struct workqueue_struct* wq;    // Workqueue it was last queued on
+} work_t;
+
+typedef struct delayed_work {
+    work_t work;
+    struct delayed_work* tnext;     // Timer wheel slot link
+    struct delayed_work** tpprev;   // NULL when the timer is not armed
+    uint64_t expires;               // Tick at which to queue the work
+    struct workqueue_struct* wq;    // Target of the armed timer
+    int cpu;                        // Target CPU, -1 = local CPU at expiry
+} delayed_work_t;
+
+typedef struct workqueue_struct {
+    const char* name;
+    uint32_t flags;
+    volatile int nr_inflight;       // Queued or running items
+    volatile int flush_waiters;     // Tasks in flush_workqueue()
+} workqueue_t;
+
+#define WORK_INIT(fn)               { .func = (fn) }
+#define DELAYED_WORK_INIT(fn)       { .work = WORK_INIT(fn), .cpu = -1 }
+#define WORKQUEUE_INIT(n, f)        { .name = (n), .flags = (f) }
+
+static inline void work_init(work_t* work, work_func_t func) {
+    work->next = work->prev = NULL;
+    work->func = func;
+    work->pending = 0;
+    work->canceling = 0;
+    work->pool = NULL;
+    work->wq = NULL;
+}
+
+static inline void delayed_work_init(delayed_work_t* dwork, work_func_t func) {
+    work_init(&dwork->work, func);
+    dwork->tnext = NULL;
+    dwork->tpprev = NULL;
+    dwork->expires = 0;
+    dwork->wq = NULL;
+    dwork->cpu = -1;
+}
+
+static inline delayed_work_t* to_delayed_work(work_t* work) {
+    return container_of(work, delayed_work_t, work);
+}
+
+// Per-CPU bound work, and long-running or blocking work
+extern workqueue_t* system_wq;
+extern workqueue_t* system_unbound_wq;
+
+// Spawn the first worker of every pool.  Work queued before this runs once
+// the workers start; call after SMP bring-up.
+void workqueue_init(void);
+
+// Queue work; return 1 if queued, 0 if it was already pending (or being
+// cancelled).  queue_work uses the current CPU's pool for bound queues.
+int queue_work(workqueue_t* wq, work_t* work);
+int queue_work_on(int cpu, workqueue_t* wq, work_t* work);
+
+// Queue work after `delay` timer ticks (0 = now).  mod_delayed_work
+// re-arms an already armed timer; queue_delayed_work leaves it alone.
+int queue_delayed_work(workqueue_t* wq, delayed_work_t* dwork, uint64_t delay);
+int queue_delayed_work_on(int cpu, workqueue_t* wq, delayed_work_t* dwork, uint64_t delay);
+int mod_delayed_work(workqueue_t* wq, delayed_work_t* dwork, uint64_t delay);
+
+static inline int schedule_work(work_t* work) {
+    return queue_work(system_wq, work);
+}
+
+static inline int schedule_delayed_work(delayed_work_t* dwork, uint64_t delay) {
+    return queue_delayed_work(system_wq, dwork, delay);
+}
+
+// Wait (process context) until the work is neither pending nor running.
+// flush_delayed_work queues an armed timer immediately first.  Return 1 if
+// there was anything to wait for.
+int flush_work(work_t* work);
+int flush_delayed_work(delayed_work_t* dwork);
+
+// Wait until every item queued to the workqueue has run
+void flush_workqueue(workqueue_t* wq);
+
+// Disarm the timer without waiting; safe from any context.  Return 1 if
+// the timer was armed.
+int cancel_delayed_work(delayed_work_t* dwork);
+
+// Remove pending work and wait for a running instance to finish (process
+// context).  Return 1 if the work was pending.
+int cancel_work_sync(work_t* work);
+int cancel_delayed_work_sync(delayed_work_t* dwork);
+
+// Timer wheel, called from the BSP timer tick
+void workqueue_timer_tick(uint64_t now);
+
+// Scheduler hooks for concurrency management (sched.c)
+struct task;
+void wq_worker_sleeping(struct task* task);
+void wq_worker_running(struct task* task);
+
+#endif // _KERNEL_WORKQUEUE_H_
@@ -397,7 +397,7 @@ typedef struct xhci_controller {
 
     // Hot-plug: bitmask of ports with pending connect/disconnect changes.
     // Set by xhci_handle_port_event() in IRQ context, consumed by
-    // xhci_hotplug_poll() in the main loop.
+    // xhci_hotplug_poll() from the hot-plug work item.
     volatile uint32_t hotplug_ports;
 } xhci_controller_t;
 
@@ -424,8 +424,9 @@ int xhci_port_reset(xhci_controller_t* ctrl, uint8_t port);
 uint8_t xhci_port_speed(xhci_controller_t* ctrl, uint8_t port);
 
 // Hot-plug support: poll for runtime connect/disconnect events.
-// Called from the main loop.  Checks hotplug_ports bitmask set by IRQ,
-// enumerates newly connected devices, cleans up disconnected ones.
+// Called from the hot-plug work item (xhci_boot.c).  Checks hotplug_ports
+// bitmask set by IRQ, enumerates newly connected devices, cleans up
+// disconnected ones.
 void xhci_hotplug_poll(xhci_controller_t* ctrl);
 
 // Device management
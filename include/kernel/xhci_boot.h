@@ -19,4 +19,7 @@ void xhci_boot_init(xhci_boot_state_t* state);
 void xhci_boot_poll(xhci_boot_state_t* state);
 int xhci_boot_is_ready(xhci_boot_state_t* state);
 
+// Start periodic hot-plug polling of both controllers on a workqueue
+void xhci_hotplug_start(void);
+
 #endif // LIKEOS_XHCI_BOOT_H
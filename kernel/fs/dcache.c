@@ -8,11 +8,19 @@
 // cache "not found" results to accelerate $PATH resolution where most
 // candidate paths miss.
 //
-// Uses a hash table with per-bucket spinlocks for SMP safety.
-// A global LRU doubly-linked list provides eviction ordering when
-// the cache exceeds DC_MAX_ENTRIES.
+// Lookups walk the hash chains under rcu_read_lock() without taking any
+// lock.  Insertions and removals take the bucket's spinlock, and a removed
+// entry is freed with call_rcu() once no lookup can still be looking at it.
+// Entries are never modified after they are published; a changed result
+// is a new entry replacing the old one.
+//
+// A global LRU doubly-linked list provides eviction ordering when the
+// cache exceeds DC_MAX_ENTRIES.  Hits only set the entry's referenced
+// bit, so the read path never takes the LRU lock; eviction gives a
+// referenced tail entry a second chance at the head instead.
 
 #include "../../include/kernel/dcache.h"
+#include "../../include/kernel/rcu.h"
 #include "../../include/kernel/memory.h"
 #include "../../include/kernel/console.h"
 
@@ -130,6 +138,23 @@ static void dc_lru_touch(dc_entry_t *e)
     dc_lru_add(e);
 }
 
+// ============================================================================
+// Deferred free
+// ============================================================================
+
+static void dc_free_rcu(rcu_head_t *head)
+{
+    kfree(container_of(head, dc_entry_t, rcu));
+}
+
+// Free an entry that is off its hash chain and the LRU once lock-free
+// lookups can no longer be holding it
+static void dc_retire(dc_entry_t *e)
+{
+    call_rcu(&e->rcu, dc_free_rcu);
+    __sync_fetch_and_sub(&dc_entry_count, 1);
+}
+
 // ============================================================================
 // Hash helpers
 // ============================================================================
@@ -146,19 +171,32 @@ static inline unsigned long dc_bucket_index(unsigned long parent_cluster,
 
 static void dc_evict_one(void)
 {
-    // Pick the LRU tail (least recently used)
+    // The victim may be invalidated and retired by another CPU between
+    // dropping the LRU lock and taking its bucket lock; the read-side
+    // section keeps its memory valid until we are done with it.
+    rcu_read_lock();
+
+    // Pick the LRU tail (least recently used), giving entries that were
+    // hit since they last reached the tail a second chance
     uint64_t lru_flags;
     spin_lock_irqsave(&dc_lru_lock, &lru_flags);
 
     dc_entry_t *victim = dc_lru_sentinel.lru_prev;
+    for (uint64_t n = dc_entry_count; n && victim != &dc_lru_sentinel &&
+         victim->referenced; n--) {
+        victim->referenced = 0;
+        dc_lru_touch(victim);
+        victim = dc_lru_sentinel.lru_prev;
+    }
     if (victim == &dc_lru_sentinel) {
         spin_unlock_irqrestore(&dc_lru_lock, lru_flags);
+        rcu_read_unlock();
         return; // empty
     }
     dc_lru_remove(victim);
     spin_unlock_irqrestore(&dc_lru_lock, lru_flags);
 
-    // Remove from hash bucket
+    // Remove from hash bucket; whoever unlinks it retires it
     unsigned long bucket = dc_bucket_index(victim->parent_cluster,
                                            victim->name_hash);
     uint64_t bucket_flags;
@@ -166,16 +204,16 @@ static void dc_evict_one(void)
     dc_entry_t **pp = &dc_hash[bucket].head;
     while (*pp) {
         if (*pp == victim) {
-            *pp = victim->hash_next;
+            rcu_assign_pointer(*pp, victim->hash_next);
+            dc_retire(victim);
+            __sync_fetch_and_add(&dc_stat_evictions, 1);
             break;
         }
         pp = &(*pp)->hash_next;
     }
     spin_unlock_irqrestore(&dc_hash[bucket].lock, bucket_flags);
 
-    kfree(victim);
-    __sync_fetch_and_sub(&dc_entry_count, 1);
-    __sync_fetch_and_add(&dc_stat_evictions, 1);
+    rcu_read_unlock();
 }
 
 // ============================================================================
@@ -190,21 +228,14 @@ dc_entry_t* dcache_lookup(unsigned long parent_cluster, const char *name)
     unsigned long nh = dc_name_hash(name);
     unsigned long bucket = dc_bucket_index(parent_cluster, nh);
 
-    uint64_t flags;
-    spin_lock_irqsave(&dc_hash[bucket].lock, &flags);
-
-    dc_entry_t *e = dc_hash[bucket].head;
+    dc_entry_t *e = rcu_dereference(dc_hash[bucket].head);
     while (e) {
         if (e->parent_cluster == parent_cluster &&
             e->name_hash == nh &&
             dc_strcasecmp(e->name, name) == 0) {
-            // Hit — move to LRU head
-            uint64_t lru_flags;
-            spin_lock_irqsave(&dc_lru_lock, &lru_flags);
-            dc_lru_touch(e);
-            spin_unlock_irqrestore(&dc_lru_lock, lru_flags);
-
-            spin_unlock_irqrestore(&dc_hash[bucket].lock, flags);
+            // Hit — mark for the LRU (avoid dirtying the line if set)
+            if (!e->referenced)
+                e->referenced = 1;
 
             if (e->flags & DC_NEGATIVE)
                 __sync_fetch_and_add(&dc_stat_neg_hits, 1);
@@ -212,9 +243,8 @@ dc_entry_t* dcache_lookup(unsigned long parent_cluster, const char *name)
                 __sync_fetch_and_add(&dc_stat_hits, 1);
             return e;
         }
-        e = e->hash_next;
+        e = rcu_dereference(e->hash_next);
     }
-    spin_unlock_irqrestore(&dc_hash[bucket].lock, flags);
     __sync_fetch_and_add(&dc_stat_misses, 1);
     return 0;
 }
@@ -256,7 +286,7 @@ static void dc_remove_existing(unsigned long parent_cluster, const char *name,
         if (e->parent_cluster == parent_cluster &&
             e->name_hash == nh &&
             dc_strcasecmp(e->name, name) == 0) {
-            *pp = e->hash_next;
+            rcu_assign_pointer(*pp, e->hash_next);
             spin_unlock_irqrestore(&dc_hash[bucket].lock, flags);
 
             uint64_t lru_flags;
@@ -264,8 +294,7 @@ static void dc_remove_existing(unsigned long parent_cluster, const char *name,
             dc_lru_remove(e);
             spin_unlock_irqrestore(&dc_lru_lock, lru_flags);
 
-            kfree(e);
-            __sync_fetch_and_sub(&dc_entry_count, 1);
+            dc_retire(e);
             return;
         }
         pp = &(*pp)->hash_next;
@@ -313,7 +342,7 @@ void dcache_insert(unsigned long parent_cluster, const char *name,
     uint64_t flags;
     spin_lock_irqsave(&dc_hash[bucket].lock, &flags);
     e->hash_next = dc_hash[bucket].head;
-    dc_hash[bucket].head = e;
+    rcu_assign_pointer(dc_hash[bucket].head, e);
     spin_unlock_irqrestore(&dc_hash[bucket].lock, flags);
 
     // Add to LRU head
@@ -351,7 +380,7 @@ void dcache_insert_negative(unsigned long parent_cluster, const char *name)
     uint64_t flags;
     spin_lock_irqsave(&dc_hash[bucket].lock, &flags);
     e->hash_next = dc_hash[bucket].head;
-    dc_hash[bucket].head = e;
+    rcu_assign_pointer(dc_hash[bucket].head, e);
     spin_unlock_irqrestore(&dc_hash[bucket].lock, flags);
 
     // Add to LRU head
@@ -384,7 +413,7 @@ void dcache_invalidate(unsigned long parent_cluster, const char *name)
         if (e->parent_cluster == parent_cluster &&
             e->name_hash == nh &&
             dc_strcasecmp(e->name, name) == 0) {
-            *pp = e->hash_next;
+            rcu_assign_pointer(*pp, e->hash_next);
             spin_unlock_irqrestore(&dc_hash[bucket].lock, flags);
 
             uint64_t lru_flags;
@@ -392,8 +421,7 @@ void dcache_invalidate(unsigned long parent_cluster, const char *name)
             dc_lru_remove(e);
             spin_unlock_irqrestore(&dc_lru_lock, lru_flags);
 
-            kfree(e);
-            __sync_fetch_and_sub(&dc_entry_count, 1);
+            dc_retire(e);
             return;
         }
         pp = &(*pp)->hash_next;
@@ -415,15 +443,14 @@ void dcache_invalidate_dir(unsigned long parent_cluster)
         while (*pp) {
             dc_entry_t *e = *pp;
             if (e->parent_cluster == parent_cluster) {
-                *pp = e->hash_next;
+                rcu_assign_pointer(*pp, e->hash_next);
 
                 uint64_t lru_flags;
                 spin_lock_irqsave(&dc_lru_lock, &lru_flags);
                 dc_lru_remove(e);
                 spin_unlock_irqrestore(&dc_lru_lock, lru_flags);
 
-                kfree(e);
-                __sync_fetch_and_sub(&dc_entry_count, 1);
+                dc_retire(e);
             } else {
                 pp = &(*pp)->hash_next;
             }
@@ -437,27 +464,32 @@ void dcache_invalidate_all(void)
     if (!dc_initialized)
         return;
 
+    // Empty the LRU first so eviction cannot pick entries being retired
+    uint64_t lru_flags;
+    spin_lock_irqsave(&dc_lru_lock, &lru_flags);
+    for (dc_entry_t *e = dc_lru_sentinel.lru_next; e != &dc_lru_sentinel; ) {
+        dc_entry_t *next = e->lru_next;
+        e->lru_prev = 0;
+        e->lru_next = 0;
+        e = next;
+    }
+    dc_lru_sentinel.lru_prev = &dc_lru_sentinel;
+    dc_lru_sentinel.lru_next = &dc_lru_sentinel;
+    spin_unlock_irqrestore(&dc_lru_lock, lru_flags);
+
     for (int b = 0; b < DC_HASH_BUCKETS; b++) {
         uint64_t flags;
         spin_lock_irqsave(&dc_hash[b].lock, &flags);
 
         dc_entry_t *e = dc_hash[b].head;
+        rcu_assign_pointer(dc_hash[b].head, (dc_entry_t *)0);
         while (e) {
             dc_entry_t *next = e->hash_next;
-            kfree(e);
+            dc_retire(e);
             e = next;
         }
-        dc_hash[b].head = 0;
         spin_unlock_irqrestore(&dc_hash[b].lock, flags);
     }
-
-    uint64_t lru_flags;
-    spin_lock_irqsave(&dc_lru_lock, &lru_flags);
-    dc_lru_sentinel.lru_prev = &dc_lru_sentinel;
-    dc_lru_sentinel.lru_next = &dc_lru_sentinel;
-    spin_unlock_irqrestore(&dc_lru_lock, lru_flags);
-
-    dc_entry_count = 0;
 }
 
 // ============================================================================
@@ -6,6 +6,7 @@
 #include "../../include/kernel/dirent.h"
 #include "../../include/kernel/timer.h"
 #include "../../include/kernel/random.h"
+#include "../../include/kernel/shmfs.h"
 
 #define DEVFS_TYPE_TTY       1
 #define DEVFS_TYPE_PTY_MASTER 2
@@ -16,6 +17,7 @@
 #define DEVFS_TYPE_URANDOM    7
 #define DEVFS_TYPE_NULL       8
 #define DEVFS_TYPE_ZERO       9
+#define DEVFS_TYPE_SHM_DIR    10
 
 typedef struct {
     vfs_file_t vfs;
@@ -41,6 +43,7 @@ static int is_prefix(const char* path, const char* prefix) {
 }
 
 long devfs_readdir(vfs_file_t* f, void* buf, long bytes);
+static int devfs_unlink(const char* path);
 
 int devfs_init(void) {
     g_devfs_ops.open = devfs_open;
@@ -50,7 +53,7 @@ int devfs_init(void) {
     g_devfs_ops.seek = NULL;
     g_devfs_ops.readdir = devfs_readdir;
     g_devfs_ops.truncate = NULL;
-    g_devfs_ops.unlink = NULL;
+    g_devfs_ops.unlink = devfs_unlink;
     g_devfs_ops.rename = NULL;
     g_devfs_ops.mkdir = NULL;
     g_devfs_ops.rmdir = NULL;
@@ -122,7 +125,6 @@ static int devfs_open_pty_slave(int id, vfs_file_t** out) {
 }
 
 int devfs_open_for_task(const char* path, int flags, vfs_file_t** out, task_t* cur) {
-    (void)flags;
     if (!path || !out) return ST_INVALID;
 
     if (is_path(path, "/dev") || is_path(path, "/dev/")) {
@@ -131,6 +133,12 @@ int devfs_open_for_task(const char* path, int flags, vfs_file_t** out, task_t* c
     if (is_path(path, "/dev/pts") || is_path(path, "/dev/pts/")) {
         return devfs_open_dir(DEVFS_TYPE_PTS_DIR, out);
     }
+    if (is_path(path, "/dev/shm") || is_path(path, "/dev/shm/")) {
+        return devfs_open_dir(DEVFS_TYPE_SHM_DIR, out);
+    }
+    if (is_prefix(path, SHMFS_PREFIX)) {
+        return shmfs_open(path, flags, out);
+    }
 
     if (is_path(path, "/dev/tty") && cur) {
         tty_t* tty = cur->ctty ? cur->ctty : tty_get_console();
@@ -202,7 +210,8 @@ int devfs_stat(const char* path, struct kstat* st) {
     if (!path || !st) return ST_INVALID;
     mm_memset(st, 0, sizeof(*st));
     uint64_t now = timer_get_epoch();  /* real wall-clock seconds */
-    if (is_path(path, "/dev") || is_path(path, "/dev/") || is_path(path, "/dev/pts") || is_path(path, "/dev/pts/")) {
+    if (is_path(path, "/dev") || is_path(path, "/dev/") || is_path(path, "/dev/pts") || is_path(path, "/dev/pts/") ||
+        is_path(path, "/dev/shm") || is_path(path, "/dev/shm/")) {
         st->st_mode = S_IFDIR | (S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
         st->st_nlink = 1;
         st->st_atime = now;
@@ -220,6 +229,9 @@ int devfs_stat(const char* path, struct kstat* st) {
         st->st_ctime = now;
         return ST_OK;
     }
+    if (is_prefix(path, SHMFS_PREFIX)) {
+        return shmfs_stat(path, st);
+    }
     if (is_prefix(path, "/dev/pts/")) {
         st->st_mode = S_IFCHR | (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
         st->st_nlink = 1;
@@ -233,7 +245,8 @@ int devfs_stat(const char* path, struct kstat* st) {
 
 int devfs_chdir(const char* path) {
     if (!path) return ST_INVALID;
-    if (is_path(path, "/dev") || is_path(path, "/dev/") || is_path(path, "/dev/pts") || is_path(path, "/dev/pts/")) {
+    if (is_path(path, "/dev") || is_path(path, "/dev/") || is_path(path, "/dev/pts") || is_path(path, "/dev/pts/") ||
+        is_path(path, "/dev/shm") || is_path(path, "/dev/shm/")) {
         return ST_OK;
     }
     return ST_NOT_FOUND;
@@ -329,7 +342,7 @@ long devfs_readdir(vfs_file_t* f, void* buf, long bytes) {
     if (!f || !buf || bytes <= 0) return -EINVAL;
     devfs_file_t* df = (devfs_file_t*)f->fs_private;
     if (!df) return -EINVAL;
-    if (df->type != DEVFS_TYPE_DIR && df->type != DEVFS_TYPE_PTS_DIR) {
+    if (df->type != DEVFS_TYPE_DIR && df->type != DEVFS_TYPE_PTS_DIR && df->type != DEVFS_TYPE_SHM_DIR) {
         return -ENOTDIR;
     }
     if (df->dir_pos) {
@@ -347,6 +360,18 @@ long devfs_readdir(vfs_file_t* f, void* buf, long bytes) {
         devfs_write_dirent64((char*)buf, (unsigned)bytes, &out_off, "urandom", 7, 2);
         devfs_write_dirent64((char*)buf, (unsigned)bytes, &out_off, "null", 8, 2);
         devfs_write_dirent64((char*)buf, (unsigned)bytes, &out_off, "zero", 9, 2);
+        devfs_write_dirent64((char*)buf, (unsigned)bytes, &out_off, "shm", 10, 4);
+        df->dir_pos = 1;
+        return (long)out_off;
+    }
+
+    if (df->type == DEVFS_TYPE_SHM_DIR) {
+        char name[VFS_MAX_PATH];
+        for (int i = 0; shmfs_name_at(i, name, sizeof(name)); ++i) {
+            if (!devfs_write_dirent64((char*)buf, (unsigned)bytes, &out_off, name, (uint64_t)(200 + i), 8)) {
+                break;
+            }
+        }
         df->dir_pos = 1;
         return (long)out_off;
     }
@@ -373,6 +398,15 @@ long devfs_readdir(vfs_file_t* f, void* buf, long bytes) {
     return (long)out_off;
 }
 
+// Only shm objects can be removed from /dev
+static int devfs_unlink(const char* path) {
+    if (!path) return ST_INVALID;
+    if (is_prefix(path, SHMFS_PREFIX)) {
+        return shmfs_unlink(path);
+    }
+    return ST_UNSUPPORTED;
+}
+
 int devfs_close(vfs_file_t* f) {
     if (!f) return ST_INVALID;
     devfs_file_t* df = (devfs_file_t*)f->fs_private;
@@ -7,10 +7,14 @@
 #include "../../include/kernel/syscall.h"
 #include "../../include/kernel/dirent.h"
 #include "../../include/kernel/sched.h"
+#include "../../include/kernel/rcu.h"
 #include "../../include/kernel/timer.h"
 #include "../../include/kernel/pagecache.h"
 #include "../../include/kernel/dcache.h"
 #include "../../include/kernel/icache.h"
+#include "../../include/kernel/pipe.h"
+#include "../../include/kernel/uaccess.h"
+#include "../../include/kernel/uio.h"
 
 // Spinlock for FAT32 filesystem access
 static spinlock_t fat32_lock = SPINLOCK_INIT("fat32");
@@ -1775,17 +1779,22 @@ static int fat32_dir_find_nolock(unsigned long start_cluster, const char *name,
         return ST_INVALID;
 
     // --- Dentry cache lookup ---
+    rcu_read_lock();
     dc_entry_t *cached = dcache_lookup(start_cluster, name);
     if (cached) {
-        if (cached->flags & DC_NEGATIVE)
+        if (cached->flags & DC_NEGATIVE) {
+            rcu_read_unlock();
             return ST_NOT_FOUND;
+        }
         if (attr) *attr = cached->attr;
         if (first_cluster) *first_cluster = cached->start_cluster;
         if (size) *size = cached->size;
         if (out_wrt_time) *out_wrt_time = cached->wrt_time;
         if (out_wrt_date) *out_wrt_date = cached->wrt_date;
+        rcu_read_unlock();
         return ST_OK;
     }
+    rcu_read_unlock();
 
     unsigned cluster_size = g_root_fs->sectors_per_cluster * g_root_fs->bytes_per_sector;
     unsigned long cluster = start_cluster;
@@ -2126,7 +2135,10 @@ static int fat32_open_impl(const char* path, int flags, vfs_file_t** out);
 static int fat32_stat_vfs_impl(const char* path, struct kstat* st);
 static long fat32_read_impl(vfs_file_t* f, void* buf, long bytes);
 static long fat32_write_impl(vfs_file_t* f, const void* buf, long bytes);
+static long fat32_read_iter_impl(vfs_file_t* f, iov_iter_t* it, long pos, int flags);
+static long fat32_write_iter_impl(vfs_file_t* f, iov_iter_t* it, long pos, int flags);
 static long fat32_seek_impl(vfs_file_t* f, long offset, int whence);
+static long fat32_splice_read_impl(vfs_file_t* f, struct pipe* pipe, long bytes);
 static long fat32_readdir_impl(vfs_file_t* f, void* buf, long bytes);
 static int fat32_truncate_impl(vfs_file_t* f, unsigned long size);
 static int fat32_close(vfs_file_t* f);  // close doesn't touch disk/cache
@@ -2150,9 +2162,18 @@ static long fat32_read(vfs_file_t* f, void* buf, long bytes) {
 static long fat32_write(vfs_file_t* f, const void* buf, long bytes) {
     fat32_io_lock(); long r = fat32_write_impl(f, buf, bytes); fat32_io_unlock(); return r;
 }
+static long fat32_read_iter(vfs_file_t* f, iov_iter_t* it, long pos, int flags) {
+    fat32_io_lock(); long r = fat32_read_iter_impl(f, it, pos, flags); fat32_io_unlock(); return r;
+}
+static long fat32_write_iter(vfs_file_t* f, iov_iter_t* it, long pos, int flags) {
+    fat32_io_lock(); long r = fat32_write_iter_impl(f, it, pos, flags); fat32_io_unlock(); return r;
+}
 static long fat32_seek(vfs_file_t* f, long offset, int whence) {
     fat32_io_lock(); long r = fat32_seek_impl(f, offset, whence); fat32_io_unlock(); return r;
 }
+static long fat32_splice_read(vfs_file_t* f, struct pipe* pipe, long bytes) {
+    fat32_io_lock(); long r = fat32_splice_read_impl(f, pipe, bytes); fat32_io_unlock(); return r;
+}
 static long fat32_readdir(vfs_file_t* f, void* buf, long bytes) {
     fat32_io_lock(); long r = fat32_readdir_impl(f, buf, bytes); fat32_io_unlock(); return r;
 }
@@ -2175,7 +2196,7 @@ static int fat32_chdir(const char* path) {
     fat32_io_lock(); int r = fat32_chdir_impl(path); fat32_io_unlock(); return r;
 }
 
-static const vfs_ops_t fat32_vfs_ops = { fat32_open, fat32_stat_vfs, fat32_read, fat32_write, fat32_seek, fat32_readdir, fat32_truncate, fat32_unlink, fat32_rename, fat32_mkdir, fat32_rmdir, fat32_chdir, fat32_close };
+static const vfs_ops_t fat32_vfs_ops = { fat32_open, fat32_stat_vfs, fat32_read, fat32_write, fat32_seek, fat32_readdir, fat32_truncate, fat32_unlink, fat32_rename, fat32_mkdir, fat32_rmdir, fat32_chdir, fat32_close, NULL, fat32_splice_read, NULL, fat32_read_iter, fat32_write_iter };
 
 static int fat32_resolve_parent(unsigned long start_cluster, const char *path,
     unsigned long *parent_cluster, char *name_out, unsigned name_out_len)
@@ -2830,26 +2851,42 @@ static int fat32_chdir_impl(const char* path)
     return ST_OK;
 }
 
-static long fat32_read_impl(vfs_file_t *f, void *buf, long bytes)
+// Read from the file into every segment of `it`.  Each page cache page is
+// looked up once however the segments split it.  pos is VFS_POS_CUR or a
+// pread offset; RWF_NOWAIT reads only what is already cached.
+static long fat32_read_iter_impl(vfs_file_t *f, iov_iter_t *it, long pos, int flags)
 {
-    if (!f || !buf)
+    if (!f || !it)
         return ST_INVALID;
     fat32_file_t *ff = (fat32_file_t *)f->fs_private;
     if (!ff)
         return ST_INVALID;
+
+    if (pos != VFS_POS_CUR) {
+        // pread: borrow the file position and put it back.  The FAT32
+        // lock is held across the call, so nothing else sees it move.
+        if (pos < 0)
+            return ST_INVALID;
+        unsigned long saved_pos = ff->pos;
+        unsigned long saved_cluster = ff->current_cluster;
+        fat32_set_position(ff, (unsigned long)pos);
+        long r = fat32_read_iter_impl(f, it, VFS_POS_CUR, flags);
+        ff->pos = saved_pos;
+        ff->current_cluster = saved_cluster;
+        return r;
+    }
+
     if (ff->pos >= ff->size)
         return 0;
-    if (bytes < 0)
-        return ST_INVALID;
 
-    if ((unsigned long)bytes > ff->size - ff->pos)
-        bytes = (long)(ff->size - ff->pos);
-    unsigned long remaining = (unsigned long)bytes;
+    unsigned long remaining = it->count;
+    if (remaining > ff->size - ff->pos)
+        remaining = ff->size - ff->pos;
     unsigned long copied = 0;
     unsigned cluster_size = ff->fs->sectors_per_cluster * ff->fs->bytes_per_sector;
+    int nowait = (flags & RWF_NOWAIT) != 0;
 
     // Use page cache for regular file reads
-    smap_disable();
     while (remaining) {
         // Determine which cache page this file position maps to
         unsigned long page_idx = ff->pos / PAGE_SIZE;
@@ -2857,34 +2894,46 @@ static long fat32_read_impl(vfs_file_t *f, void *buf, long bytes)
         unsigned avail_in_page = PAGE_SIZE - page_offset;
         unsigned chunk = (remaining < avail_in_page) ? (unsigned)remaining : avail_in_page;
 
-        pc_page_t *pg = pagecache_get(ff->start_cluster, page_idx,
-                                       ff->size,
-                                       (struct fat32_fs *)ff->fs,
-                                       ff->start_cluster);
+        pc_page_t *pg;
+        if (nowait) {
+            pg = pagecache_lookup(ff->start_cluster, page_idx);
+            if (!pg)
+                return copied ? (long)copied : -EAGAIN;
+        } else {
+            pg = pagecache_get(ff->start_cluster, page_idx,
+                               ff->size,
+                               (struct fat32_fs *)ff->fs,
+                               ff->start_cluster);
+        }
         if (pg) {
             // Cache hit (or successful disk read on miss)
-            mm_memcpy(((uint8_t *)buf) + copied,
-                      pg->data + page_offset, chunk);
+            size_t n = copy_to_iter(pg->data + page_offset, chunk, it);
+            if (n < chunk) {
+                fat32_set_position(ff, ff->pos + n);
+                copied += n;
+                return copied ? (long)copied : -EFAULT;
+            }
 
             // Trigger read-ahead on sequential access
-            pc_readahead_t ra_state;
-            ra_state.last_page_index  = ff->ra_last_page;
-            ra_state.sequential_count = ff->ra_seq_count;
-            ra_state.ra_pages         = ff->ra_pages;
-            pagecache_readahead(&ra_state, ff->start_cluster, page_idx,
-                                ff->size,
-                                (struct fat32_fs *)ff->fs,
-                                ff->start_cluster);
-            ff->ra_last_page = ra_state.last_page_index;
-            ff->ra_seq_count = ra_state.sequential_count;
-            ff->ra_pages     = ra_state.ra_pages;
+            if (!nowait) {
+                pc_readahead_t ra_state;
+                ra_state.last_page_index  = ff->ra_last_page;
+                ra_state.sequential_count = ff->ra_seq_count;
+                ra_state.ra_pages         = ff->ra_pages;
+                pagecache_readahead(&ra_state, ff->start_cluster, page_idx,
+                                    ff->size,
+                                    (struct fat32_fs *)ff->fs,
+                                    ff->start_cluster);
+                ff->ra_last_page = ra_state.last_page_index;
+                ff->ra_seq_count = ra_state.sequential_count;
+                ff->ra_pages     = ra_state.ra_pages;
+            }
         } else {
             // Cache miss and disk read failed — fall back to direct read
             // This can happen if the page cache is not yet initialized
             // or if the file's cluster chain is corrupt.
             void *tmp = kalloc(cluster_size);
             if (!tmp) {
-                smap_enable();
                 return copied ? (long)copied : ST_NOMEM;
             }
             fat32_io_lock();
@@ -2893,7 +2942,6 @@ static long fat32_read_impl(vfs_file_t *f, void *buf, long bytes)
                 ff->fs->sectors_per_cluster, tmp);
             fat32_io_unlock();
             if (st != ST_OK) {
-                smap_enable();
                 kfree(tmp);
                 return copied ? (long)copied : ST_IO;
             }
@@ -2901,9 +2949,13 @@ static long fat32_read_impl(vfs_file_t *f, void *buf, long bytes)
             unsigned avail_in_cluster = cluster_size - cluster_offset;
             if (chunk > avail_in_cluster)
                 chunk = avail_in_cluster;
-            mm_memcpy(((uint8_t *)buf) + copied,
-                      ((uint8_t *)tmp) + cluster_offset, chunk);
+            size_t n = copy_to_iter(((uint8_t *)tmp) + cluster_offset, chunk, it);
             kfree(tmp);
+            if (n < chunk) {
+                fat32_set_position(ff, ff->pos + n);
+                copied += n;
+                return copied ? (long)copied : -EFAULT;
+            }
         }
 
         ff->pos += chunk;
@@ -2929,29 +2981,110 @@ static long fat32_read_impl(vfs_file_t *f, void *buf, long bytes)
             ff->current_cluster = next;
         }
     }
-    smap_enable();
     return (long)copied;
 }
 
-static long fat32_write_impl(vfs_file_t *f, const void *buf, long bytes)
+static long fat32_read_impl(vfs_file_t *f, void *buf, long bytes)
 {
-    if (!f || !buf)
+    if (!buf || bytes < 0)
         return ST_INVALID;
-    fat32_file_t *ff = (fat32_file_t *)f->fs_private;
-    if (!ff || !ff->fs)
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, buf, (size_t)bytes);
+    return fat32_read_iter_impl(f, &it, VFS_POS_CUR, 0);
+}
+
+// splice() from a file: the pipe gets references to the page cache pages
+// themselves instead of a copy of their bytes
+static long fat32_splice_read_impl(vfs_file_t *f, struct pipe *pipe, long bytes)
+{
+    if (!f || !pipe)
         return ST_INVALID;
+    fat32_file_t *ff = (fat32_file_t *)f->fs_private;
+    if (!ff || ff->is_dir || ff->start_cluster < 2)
+        return ST_UNSUPPORTED;
+    if (ff->pos >= ff->size)
+        return 0;
     if (bytes < 0)
         return ST_INVALID;
 
-    if (f->flags & O_APPEND) {
+    if ((unsigned long)bytes > ff->size - ff->pos)
+        bytes = (long)(ff->size - ff->pos);
+    unsigned long pos = ff->pos;
+    unsigned long end = pos + (unsigned long)bytes;
+
+    while (pos < end && !pipe_full(pipe)) {
+        unsigned long page_idx = pos / PAGE_SIZE;
+        unsigned page_offset   = pos % PAGE_SIZE;
+        unsigned chunk = PAGE_SIZE - page_offset;
+        if (chunk > end - pos)
+            chunk = (unsigned)(end - pos);
+
+        // Bring the page in, then pin it; if it was evicted in between,
+        // this and the rest are left to the copying path
+        if (!pagecache_get(ff->start_cluster, page_idx, ff->size,
+                           (struct fat32_fs *)ff->fs, ff->start_cluster))
+            break;
+        uint64_t phys = pagecache_ref_page(ff->start_cluster, page_idx);
+        if (!phys)
+            break;
+
+        pipe_push_buf(pipe, phys, page_offset, chunk, 0);
+        pos += chunk;
+    }
+
+    unsigned long moved = pos - ff->pos;
+    if (!moved)
+        return ST_UNSUPPORTED;
+    fat32_set_position(ff, pos);
+    return (long)moved;
+}
+
+// Write every segment of `it` to the file, like fat32_read_iter_impl().
+// O_APPEND and RWF_APPEND write at the end even for pwrite, as Linux
+// does.  A pwrite past the end grows the file first, as ftruncate()
+// does.  RWF_NOWAIT writes only into cached pages; RWF_DSYNC/RWF_SYNC
+// flush the file before returning.
+static long fat32_write_iter_impl(vfs_file_t *f, iov_iter_t *it, long pos, int flags)
+{
+    if (!f || !it)
+        return ST_INVALID;
+    fat32_file_t *ff = (fat32_file_t *)f->fs_private;
+    if (!ff || !ff->fs)
+        return ST_INVALID;
+
+    int append = (f->flags & O_APPEND) || (flags & RWF_APPEND);
+    if (pos != VFS_POS_CUR && !append) {
+        if (pos < 0)
+            return ST_INVALID;
+        if ((unsigned long)pos > ff->size) {
+            if (flags & RWF_NOWAIT)
+                return -EAGAIN;
+            int st = fat32_truncate_impl(f, (unsigned long)pos);
+            if (st != ST_OK)
+                return st;
+        }
+        unsigned long saved_pos = ff->pos;
+        unsigned long saved_cluster = ff->current_cluster;
+        fat32_set_position(ff, (unsigned long)pos);
+        long r = fat32_write_iter_impl(f, it, VFS_POS_CUR, flags);
+        ff->pos = saved_pos;
+        ff->current_cluster = saved_cluster;
+        return r;
+    }
+    if (append) {
         fat32_set_position(ff, ff->size);
     }
 
-    unsigned long remaining = (unsigned long)bytes;
+    unsigned long remaining = it->count;
     unsigned long written = 0;
     unsigned cluster_size = ff->fs->sectors_per_cluster * ff->fs->bytes_per_sector;
+    int nowait = (flags & RWF_NOWAIT) != 0;
+    long err = 0;
 
     if (ff->start_cluster < 2) {
+        if (nowait)
+            return -EAGAIN;
         unsigned long newc = 0;
         if (fat32_alloc_cluster(ff->fs, &newc) != ST_OK)
             return ST_IO;
@@ -2974,52 +3107,60 @@ static long fat32_write_impl(vfs_file_t *f, const void *buf, long bytes)
         if (chunk > avail_in_page)
             chunk = avail_in_page;
 
+        size_t n;
         pc_page_t *pg = pagecache_lookup(ff->start_cluster, page_idx);
         if (pg) {
             // Update cached page in place and mark dirty (write-back)
-            smap_disable();
-            mm_memcpy(pg->data + page_offset,
-                      ((const uint8_t *)buf) + written, chunk);
-            smap_enable();
+            n = copy_from_iter(pg->data + page_offset, chunk, it);
             pagecache_mark_dirty(pg);
+        } else if (nowait) {
+            err = -EAGAIN;
+            break;
         } else {
             // Page not cached — do a direct read-modify-write to disk.
             // (We don't populate the cache on writes to avoid excessive memory
             //  use for write-only workloads.)
             void *tmp = kalloc(cluster_size);
             if (!tmp) {
-                return written ? (long)written : ST_NOMEM;
+                err = ST_NOMEM;
+                break;
             }
 
             if (read_sectors(ff->fs->bdev,
                 cluster_to_lba(ff->fs, ff->current_cluster),
                 ff->fs->sectors_per_cluster, tmp) != ST_OK) {
                 kfree(tmp);
-                return written ? (long)written : ST_IO;
+                err = ST_IO;
+                break;
             }
 
-            smap_disable();
-            mm_memcpy(((uint8_t *)tmp) + cluster_offset,
-                      ((const uint8_t *)buf) + written, chunk);
-            smap_enable();
-
-            if (write_sectors(ff->fs->bdev,
+            n = copy_from_iter(((uint8_t *)tmp) + cluster_offset, chunk, it);
+            if (n && write_sectors(ff->fs->bdev,
                 cluster_to_lba(ff->fs, ff->current_cluster),
                 ff->fs->sectors_per_cluster, tmp) != ST_OK) {
                 kfree(tmp);
-                return written ? (long)written : ST_IO;
+                err = ST_IO;
+                break;
             }
             kfree(tmp);
         }
 
-        ff->pos += chunk;
-        written += chunk;
-        remaining -= chunk;
+        ff->pos += n;
+        written += n;
+        remaining -= n;
+        if (n < chunk) {
+            err = -EFAULT;
+            break;
+        }
 
         if (ff->pos % cluster_size == 0 && remaining > 0) {
             unsigned long next = fat32_next_cluster_cached(ff->fs, ff->current_cluster);
             if (next >= 0x0FFFFFF8 || next == 0) {
                 unsigned long newc = 0;
+                if (nowait) {
+                    err = -EAGAIN;
+                    break;
+                }
                 if (fat32_append_cluster(ff->fs, ff->current_cluster, &newc) != ST_OK)
                     break;
                 ff->current_cluster = newc;
@@ -3037,7 +3178,23 @@ static long fat32_write_impl(vfs_file_t *f, const void *buf, long bytes)
             icache_update_size((ic_inode_t *)ff->inode, ff->size);
     }
 
-    return (long)written;
+    if (written && (flags & (RWF_DSYNC | RWF_SYNC))) {
+        pagecache_flush_file(ff->start_cluster);
+        if (ff->inode)
+            icache_flush((ic_inode_t *)ff->inode);
+    }
+
+    return written ? (long)written : err;
+}
+
+static long fat32_write_impl(vfs_file_t *f, const void *buf, long bytes)
+{
+    if (!buf || bytes < 0)
+        return ST_INVALID;
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, (void *)buf, (size_t)bytes);
+    return fat32_write_iter_impl(f, &it, VFS_POS_CUR, 0);
 }
 
 static unsigned fat32_write_dirent64(char* out, unsigned out_size, unsigned* out_off,
@@ -14,6 +14,7 @@
 #include "../../include/kernel/sched.h"
 #include "../../include/kernel/timer.h"
 #include "../../include/kernel/icache.h"
+#include "../../include/kernel/workqueue.h"
 
 // ============================================================================
 // External FAT32 internals we need (declared in fat32.h)
@@ -96,10 +97,10 @@ static volatile uint64_t pc_stat_evictions;
 static volatile uint64_t pc_stat_writebacks;
 static volatile uint64_t pc_stat_total_pages;
 
-// Writeback flag — set by timer, consumed by a deferred context.
-// Since we don't have kernel threads yet, writeback is done synchronously
-// on the next cache access after the timer sets the flag.
-static volatile int pc_writeback_pending;
+// Periodic dirty writeback, run by an unbound worker so the disk I/O never
+// lands on whichever task happens to touch the cache next
+static void pagecache_writeback_work(work_t *work);
+static delayed_work_t pc_writeback_work = DELAYED_WORK_INIT(pagecache_writeback_work);
 
 // Initialized flag
 static int pc_initialized;
@@ -192,7 +193,9 @@ static void pc_page_free(pc_page_t *pg)
     if (!pg)
         return;
     if (pg->phys_addr) {
-        mm_free_physical_page(pg->phys_addr);
+        // A pipe may still hold the data page (splice); it frees it then
+        if (mm_decref_page(pg->phys_addr))
+            mm_free_physical_page(pg->phys_addr);
         pg->phys_addr = 0;
         pg->data = 0;
     }
@@ -259,8 +262,8 @@ void pagecache_init(void)
     pc_stat_writebacks  = 0;
     pc_stat_total_pages = 0;
 
-    pc_writeback_pending = 0;
     pc_initialized = 1;
+    queue_delayed_work(system_unbound_wq, &pc_writeback_work, PC_WRITEBACK_INTERVAL);
 
     kprintf("pagecache: initialized (%d hash buckets)\n", PC_HASH_BUCKETS);
 }
@@ -292,6 +295,37 @@ pc_page_t* pagecache_lookup(unsigned long cluster_id, unsigned long page_index)
     return 0;
 }
 
+// ============================================================================
+// Take a reference on a cached data page
+// ============================================================================
+
+uint64_t pagecache_ref_page(unsigned long cluster_id, unsigned long page_index)
+{
+    if (!pc_initialized)
+        return 0;
+
+    unsigned long bucket = pc_hash_key(cluster_id, page_index);
+    uint64_t flags;
+    spin_lock_irqsave(&pc_hash[bucket].lock, &flags);
+
+    // Under the bucket lock the page cannot be evicted, so the reference
+    // is taken before pc_page_free() could drop the cache's own
+    uint64_t phys = 0;
+    for (pc_page_t *pg = pc_hash[bucket].head; pg; pg = pg->hash_next) {
+        if (pg->cluster_id == cluster_id && pg->page_index == page_index) {
+            phys = pg->phys_addr;
+            if (mm_get_page_refcount(phys) == 0)
+                mm_incref_page(phys);   // count the cache's reference
+            mm_incref_page(phys);
+            pg->flags |= PC_PAGE_REFERENCED;
+            break;
+        }
+    }
+
+    spin_unlock_irqrestore(&pc_hash[bucket].lock, flags);
+    return phys;
+}
+
 // ============================================================================
 // Insert a page into the hash table + LRU
 // ============================================================================
@@ -694,12 +728,6 @@ pc_page_t* pagecache_get(unsigned long cluster_id, unsigned long page_index,
     if (!fs || start_cluster < 2)
         return 0;
 
-    // Check memory pressure first and do deferred writeback
-    if (pc_writeback_pending) {
-        pc_writeback_pending = 0;
-        pagecache_flush_all();
-    }
-
     // 1. Try cache lookup (no I/O lock needed)
     pc_page_t *pg = pagecache_lookup(cluster_id, page_index);
     if (pg) {
@@ -1272,16 +1300,12 @@ void pagecache_get_stats(pc_stats_t *stats)
 }
 
 // ============================================================================
-// Timer callback
+// Periodic writeback
 // ============================================================================
 
-void pagecache_timer_tick(uint64_t ticks)
+static void pagecache_writeback_work(work_t *work)
 {
-    if (!pc_initialized)
-        return;
-    // Set the writeback pending flag; actual flush happens on next cache
-    // access (we can't do blocking I/O in an IRQ handler).
-    if ((ticks % PC_WRITEBACK_INTERVAL) == 0) {
-        pc_writeback_pending = 1;
-    }
+    (void)work;
+    pagecache_flush_all();
+    queue_delayed_work(system_unbound_wq, &pc_writeback_work, PC_WRITEBACK_INTERVAL);
 }
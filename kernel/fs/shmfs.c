@@ -0,0 +1,550 @@
+// LikeOS-64 - RAM Filesystem for Shared Memory (/dev/shm, memfd)
+//
+// See include/kernel/shmfs.h.  An shm_inode is the object: its pages[]
+// holds one physical page per page of the file (0 for a page never
+// written or mapped) and grows as pages are touched, not when the size
+// does.  Each open file is an shm_file wrapping the vfs_file_t with its
+// own position.
+//
+// g_shm_lock covers the /dev/shm list and every inode's refcount: one per
+// open file plus one while the name is linked.  The inode's rw_semaphore
+// covers its pages and size; copies to and from user memory happen under
+// it, which is why it is a sleeping lock.  Mappings do not hold the inode,
+// only their pages, so a mapping outlives close() and shm_unlink().
+
+#include "../../include/kernel/shmfs.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/console.h"
+#include "../../include/kernel/syscall.h"
+#include "../../include/kernel/timer.h"
+#include "../../include/kernel/rwsem.h"
+#include "../../include/kernel/spinlock.h"
+#include "../../include/kernel/uio.h"
+
+typedef struct shm_inode {
+    struct shm_inode* next;         // /dev/shm list, while linked
+    rw_semaphore_t lock;            // pages[], nr_slots, size, mtime
+    uint64_t* pages;                // Physical page per page index, 0 = hole
+    unsigned long nr_slots;         // Entries in pages[]
+    unsigned long size;
+    uint64_t mtime;
+    unsigned long ino;
+    int refcount;                   // Under g_shm_lock
+    bool linked;
+    char name[VFS_MAX_PATH];
+} shm_inode_t;
+
+typedef struct shm_file {
+    vfs_file_t vfs;                 // Must be first: the fd table points here
+    shm_inode_t* inode;
+    unsigned long pos;
+} shm_file_t;
+
+static spinlock_t g_shm_lock = SPINLOCK_INIT("shmfs");
+static shm_inode_t* g_shm_list;
+static unsigned long g_shm_next_ino = 1;
+
+// Source for reads of holes
+static const uint8_t shmfs_zero_page[PAGE_SIZE];
+
+static long shmfs_read(vfs_file_t* f, void* buf, long bytes);
+static long shmfs_write(vfs_file_t* f, const void* buf, long bytes);
+static long shmfs_seek(vfs_file_t* f, long offset, int whence);
+static int shmfs_truncate(vfs_file_t* f, unsigned long size);
+static int shmfs_close(vfs_file_t* f);
+static int shmfs_mmap(vfs_file_t* f, unsigned long offset, unsigned long* phys);
+static long shmfs_read_iter(vfs_file_t* f, iov_iter_t* it, long pos, int flags);
+static long shmfs_write_iter(vfs_file_t* f, iov_iter_t* it, long pos, int flags);
+
+static const vfs_ops_t shmfs_ops = {
+    .read = shmfs_read,
+    .write = shmfs_write,
+    .seek = shmfs_seek,
+    .truncate = shmfs_truncate,
+    .close = shmfs_close,
+    .mmap = shmfs_mmap,
+    .read_iter = shmfs_read_iter,
+    .write_iter = shmfs_write_iter,
+};
+
+// ============================================================================
+// Objects
+// ============================================================================
+
+// Copy a string into a len-byte buffer, cutting it short if need be
+static void shmfs_copy_name(char* dst, const char* src, size_t len) {
+    size_t n = kstrlen(src);
+    if (n > len - 1) {
+        n = len - 1;
+    }
+    mm_memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+static shm_inode_t* shmfs_alloc_inode(const char* prefix, const char* name) {
+    shm_inode_t* ino = kalloc(sizeof(shm_inode_t));
+    if (!ino) {
+        return NULL;
+    }
+    mm_memset(ino, 0, sizeof(shm_inode_t));
+    rwsem_init(&ino->lock, "shm_inode");
+    ino->mtime = timer_get_epoch();
+
+    size_t len = kstrlen(prefix);
+    mm_memcpy(ino->name, prefix, len);
+    shmfs_copy_name(ino->name + len, name, sizeof(ino->name) - len);
+
+    uint64_t flags;
+    spin_lock_irqsave(&g_shm_lock, &flags);
+    ino->ino = g_shm_next_ino++;
+    spin_unlock_irqrestore(&g_shm_lock, flags);
+    return ino;
+}
+
+// Drop the object's reference on pages [first, nr_slots)
+static void shmfs_drop_pages(shm_inode_t* ino, unsigned long first) {
+    for (unsigned long i = first; i < ino->nr_slots; i++) {
+        uint64_t phys = ino->pages[i];
+        if (phys) {
+            ino->pages[i] = 0;
+            if (mm_decref_page(phys)) {
+                mm_free_physical_page(phys);
+            }
+        }
+    }
+}
+
+static void shmfs_put_inode(shm_inode_t* ino) {
+    uint64_t flags;
+    spin_lock_irqsave(&g_shm_lock, &flags);
+    int left = --ino->refcount;
+    spin_unlock_irqrestore(&g_shm_lock, flags);
+    if (left) {
+        return;
+    }
+    shmfs_drop_pages(ino, 0);
+    if (ino->pages) {
+        kfree(ino->pages);
+    }
+    kfree(ino);
+}
+
+// Page idx of the object, allocated zeroed if it is a hole.  The object
+// holds one reference to it.  Caller holds ino->lock for writing.
+static uint64_t shmfs_get_page(shm_inode_t* ino, unsigned long idx) {
+    if (idx >= ino->nr_slots) {
+        unsigned long slots = ino->nr_slots ? ino->nr_slots : 16;
+        while (slots <= idx) {
+            slots *= 2;
+        }
+        uint64_t* pages = krealloc(ino->pages, slots * sizeof(uint64_t));
+        if (!pages) {
+            return 0;
+        }
+        mm_memset(pages + ino->nr_slots, 0, (slots - ino->nr_slots) * sizeof(uint64_t));
+        ino->pages = pages;
+        ino->nr_slots = slots;
+    }
+    if (!ino->pages[idx]) {
+        uint64_t phys = mm_allocate_physical_page();
+        if (!phys) {
+            return 0;
+        }
+        mm_memset(phys_to_virt(phys), 0, PAGE_SIZE);
+        mm_incref_page(phys);
+        ino->pages[idx] = phys;
+    }
+    return ino->pages[idx];
+}
+
+static shm_file_t* shmfs_alloc_file(shm_inode_t* ino) {
+    shm_file_t* sf = kalloc(sizeof(shm_file_t));
+    if (!sf) {
+        return NULL;
+    }
+    mm_memset(sf, 0, sizeof(shm_file_t));
+    sf->vfs.ops = &shmfs_ops;
+    sf->vfs.fs_private = sf;
+    sf->vfs.refcount = 1;
+    sf->inode = ino;
+    return sf;
+}
+
+// Name under /dev/shm: non-empty, one component
+static const char* shmfs_name(const char* path) {
+    if (kstrncmp(path, SHMFS_PREFIX, SHMFS_PREFIX_LEN) != 0) {
+        return NULL;
+    }
+    const char* name = path + SHMFS_PREFIX_LEN;
+    if (!*name) {
+        return NULL;
+    }
+    for (const char* p = name; *p; p++) {
+        if (*p == '/') {
+            return NULL;
+        }
+    }
+    return name;
+}
+
+// Caller holds g_shm_lock
+static shm_inode_t* shmfs_lookup(const char* name) {
+    for (shm_inode_t* ino = g_shm_list; ino; ino = ino->next) {
+        if (kstrcmp(ino->name, name) == 0) {
+            return ino;
+        }
+    }
+    return NULL;
+}
+
+static void shmfs_set_size(shm_inode_t* ino, unsigned long size) {
+    if (size < ino->size) {
+        shmfs_drop_pages(ino, PAGE_ALIGN(size) / PAGE_SIZE);
+        // The rest of the last page reads as zeros if the object grows again
+        unsigned long idx = size / PAGE_SIZE;
+        unsigned long in = size % PAGE_SIZE;
+        if (in && idx < ino->nr_slots && ino->pages[idx]) {
+            mm_memset((uint8_t*)phys_to_virt(ino->pages[idx]) + in, 0, PAGE_SIZE - in);
+        }
+    }
+    ino->size = size;
+    ino->mtime = timer_get_epoch();
+}
+
+// ============================================================================
+// /dev/shm
+// ============================================================================
+
+int shmfs_open(const char* path, int flags, vfs_file_t** out) {
+    const char* name = shmfs_name(path);
+    if (!name) {
+        return ST_NOT_FOUND;
+    }
+
+    // Allocated up front so the lookup and insert are one critical section
+    shm_inode_t* fresh = NULL;
+    if (flags & O_CREAT) {
+        fresh = shmfs_alloc_inode("", name);
+        if (!fresh) {
+            return ST_NOMEM;
+        }
+    }
+
+    uint64_t irq;
+    spin_lock_irqsave(&g_shm_lock, &irq);
+    shm_inode_t* ino = shmfs_lookup(name);
+    if (ino && (flags & O_CREAT) && (flags & O_EXCL)) {
+        spin_unlock_irqrestore(&g_shm_lock, irq);
+        kfree(fresh);
+        return ST_EXISTS;
+    }
+    if (!ino && !fresh) {
+        spin_unlock_irqrestore(&g_shm_lock, irq);
+        return ST_NOT_FOUND;
+    }
+    if (!ino) {
+        ino = fresh;
+        fresh = NULL;
+        ino->linked = true;
+        ino->refcount = 1;
+        ino->next = g_shm_list;
+        g_shm_list = ino;
+    }
+    ino->refcount++;
+    spin_unlock_irqrestore(&g_shm_lock, irq);
+    if (fresh) {
+        kfree(fresh);
+    }
+
+    shm_file_t* sf = shmfs_alloc_file(ino);
+    if (!sf) {
+        shmfs_put_inode(ino);
+        return ST_NOMEM;
+    }
+    if ((flags & O_TRUNC) && (flags & (O_WRONLY | O_RDWR))) {
+        down_write(&ino->lock);
+        shmfs_set_size(ino, 0);
+        up_write(&ino->lock);
+    }
+    *out = &sf->vfs;
+    return ST_OK;
+}
+
+int shmfs_stat(const char* path, struct kstat* st) {
+    const char* name = shmfs_name(path);
+    if (!name) {
+        return ST_NOT_FOUND;
+    }
+    uint64_t irq;
+    spin_lock_irqsave(&g_shm_lock, &irq);
+    shm_inode_t* ino = shmfs_lookup(name);
+    if (!ino) {
+        spin_unlock_irqrestore(&g_shm_lock, irq);
+        return ST_NOT_FOUND;
+    }
+    mm_memset(st, 0, sizeof(*st));
+    st->st_ino = ino->ino;
+    st->st_mode = S_IFREG | (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    st->st_nlink = 1;
+    st->st_size = ino->size;
+    st->st_blksize = PAGE_SIZE;
+    st->st_blocks = PAGE_ALIGN(ino->size) / 512;
+    st->st_atime = ino->mtime;
+    st->st_mtime = ino->mtime;
+    st->st_ctime = ino->mtime;
+    spin_unlock_irqrestore(&g_shm_lock, irq);
+    return ST_OK;
+}
+
+int shmfs_unlink(const char* path) {
+    const char* name = shmfs_name(path);
+    if (!name) {
+        return ST_NOT_FOUND;
+    }
+    uint64_t irq;
+    spin_lock_irqsave(&g_shm_lock, &irq);
+    shm_inode_t** pp = &g_shm_list;
+    while (*pp && kstrcmp((*pp)->name, name) != 0) {
+        pp = &(*pp)->next;
+    }
+    shm_inode_t* ino = *pp;
+    if (ino) {
+        *pp = ino->next;
+        ino->linked = false;
+    }
+    spin_unlock_irqrestore(&g_shm_lock, irq);
+    if (!ino) {
+        return ST_NOT_FOUND;
+    }
+    shmfs_put_inode(ino);
+    return ST_OK;
+}
+
+bool shmfs_name_at(int index, char* name, size_t len) {
+    uint64_t irq;
+    spin_lock_irqsave(&g_shm_lock, &irq);
+    shm_inode_t* ino = g_shm_list;
+    while (ino && index-- > 0) {
+        ino = ino->next;
+    }
+    if (ino) {
+        shmfs_copy_name(name, ino->name, len);
+    }
+    spin_unlock_irqrestore(&g_shm_lock, irq);
+    return ino != NULL;
+}
+
+int memfd_create(const char* name, unsigned int flags, vfs_file_t** out) {
+    if (flags & ~(MFD_CLOEXEC | MFD_ALLOW_SEALING)) {
+        return -EINVAL;
+    }
+    if (kstrlen(name) > MFD_NAME_MAX) {
+        return -EINVAL;
+    }
+    shm_inode_t* ino = shmfs_alloc_inode("memfd:", name);
+    if (!ino) {
+        return -ENOMEM;
+    }
+    ino->refcount = 1;
+    shm_file_t* sf = shmfs_alloc_file(ino);
+    if (!sf) {
+        kfree(ino);
+        return -ENOMEM;
+    }
+    sf->vfs.flags = O_RDWR | ((flags & MFD_CLOEXEC) ? O_CLOEXEC : 0);
+    *out = &sf->vfs;
+    return 0;
+}
+
+bool shmfs_is_file(vfs_file_t* f) {
+    return f && f->ops == &shmfs_ops;
+}
+
+size_t shmfs_size(vfs_file_t* f) {
+    if (!shmfs_is_file(f)) {
+        return 0;
+    }
+    return ((shm_file_t*)f)->inode->size;
+}
+
+// ============================================================================
+// File operations
+// ============================================================================
+
+static bool shmfs_writable(vfs_file_t* f) {
+    return (f->flags & (O_WRONLY | O_RDWR)) != 0;
+}
+
+static long shmfs_read_iter(vfs_file_t* f, iov_iter_t* it, long pos, int flags) {
+    (void)flags;    // Never waits: RWF_NOWAIT is always satisfied
+    shm_file_t* sf = (shm_file_t*)f;
+    shm_inode_t* ino = sf->inode;
+    if ((f->flags & (O_WRONLY | O_RDWR)) == O_WRONLY) {
+        return -EBADF;
+    }
+
+    down_read(&ino->lock);
+    unsigned long off = pos == VFS_POS_CUR ? sf->pos : (unsigned long)pos;
+    long done = 0;
+    while (it->count && off < ino->size) {
+        unsigned long idx = off / PAGE_SIZE;
+        unsigned long in = off % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in;
+        if (chunk > ino->size - off) {
+            chunk = ino->size - off;
+        }
+        uint64_t phys = idx < ino->nr_slots ? ino->pages[idx] : 0;
+        const uint8_t* src = phys ? (const uint8_t*)phys_to_virt(phys) + in : shmfs_zero_page;
+        size_t moved = copy_to_iter(src, chunk, it);
+        done += moved;
+        off += moved;
+        if (moved < chunk && it->count) {
+            if (!done) {
+                done = -EFAULT;
+            }
+            break;
+        }
+    }
+    if (pos == VFS_POS_CUR && done > 0) {
+        sf->pos = off;
+    }
+    up_read(&ino->lock);
+    return done;
+}
+
+static long shmfs_write_iter(vfs_file_t* f, iov_iter_t* it, long pos, int flags) {
+    shm_file_t* sf = (shm_file_t*)f;
+    shm_inode_t* ino = sf->inode;
+    if (!shmfs_writable(f)) {
+        return -EBADF;
+    }
+
+    down_write(&ino->lock);
+    unsigned long off = pos == VFS_POS_CUR ? sf->pos : (unsigned long)pos;
+    if ((f->flags & O_APPEND) || (flags & RWF_APPEND)) {
+        off = ino->size;
+    }
+    if (off >= SHMFS_MAX_SIZE) {
+        up_write(&ino->lock);
+        return it->count ? -EFBIG : 0;
+    }
+    if (it->count > SHMFS_MAX_SIZE - off) {
+        it->count = SHMFS_MAX_SIZE - off;
+    }
+
+    long done = 0;
+    while (it->count) {
+        unsigned long in = off % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in;
+        uint64_t phys = shmfs_get_page(ino, off / PAGE_SIZE);
+        if (!phys) {
+            if (!done) {
+                done = -ENOSPC;
+            }
+            break;
+        }
+        if (chunk > it->count) {
+            chunk = it->count;
+        }
+        size_t moved = copy_from_iter((uint8_t*)phys_to_virt(phys) + in, chunk, it);
+        done += moved;
+        off += moved;
+        if (moved < chunk) {
+            if (!done) {
+                done = -EFAULT;
+            }
+            break;
+        }
+    }
+    if (done > 0) {
+        if (off > ino->size) {
+            ino->size = off;
+        }
+        ino->mtime = timer_get_epoch();
+        if (pos == VFS_POS_CUR) {
+            sf->pos = off;
+        }
+    }
+    up_write(&ino->lock);
+    return done;
+}
+
+static long shmfs_read(vfs_file_t* f, void* buf, long bytes) {
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, buf, (size_t)bytes);
+    return shmfs_read_iter(f, &it, VFS_POS_CUR, 0);
+}
+
+static long shmfs_write(vfs_file_t* f, const void* buf, long bytes) {
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, (void*)buf, (size_t)bytes);
+    return shmfs_write_iter(f, &it, VFS_POS_CUR, 0);
+}
+
+static long shmfs_seek(vfs_file_t* f, long offset, int whence) {
+    shm_file_t* sf = (shm_file_t*)f;
+    long base;
+    switch (whence) {
+    case SEEK_SET:
+        base = 0;
+        break;
+    case SEEK_CUR:
+        base = (long)sf->pos;
+        break;
+    case SEEK_END:
+        down_read(&sf->inode->lock);
+        base = (long)sf->inode->size;
+        up_read(&sf->inode->lock);
+        break;
+    default:
+        return -1;
+    }
+    if (base + offset < 0) {
+        return -1;
+    }
+    sf->pos = (unsigned long)(base + offset);
+    return (long)sf->pos;
+}
+
+static int shmfs_truncate(vfs_file_t* f, unsigned long size) {
+    shm_file_t* sf = (shm_file_t*)f;
+    if (!shmfs_writable(f) || size > SHMFS_MAX_SIZE) {
+        return ST_INVALID;
+    }
+    down_write(&sf->inode->lock);
+    shmfs_set_size(sf->inode, size);
+    up_write(&sf->inode->lock);
+    return ST_OK;
+}
+
+static int shmfs_close(vfs_file_t* f) {
+    shm_file_t* sf = (shm_file_t*)f;
+    shmfs_put_inode(sf->inode);
+    kfree(sf);
+    return ST_OK;
+}
+
+// Mappings stop at the end of the object: ftruncate() before mmap()
+static int shmfs_mmap(vfs_file_t* f, unsigned long offset, unsigned long* phys) {
+    shm_inode_t* ino = ((shm_file_t*)f)->inode;
+    if (offset & (PAGE_SIZE - 1)) {
+        return -EINVAL;
+    }
+    down_write(&ino->lock);
+    if (offset >= PAGE_ALIGN(ino->size)) {
+        up_write(&ino->lock);
+        return -ENXIO;
+    }
+    uint64_t page = shmfs_get_page(ino, offset / PAGE_SIZE);
+    if (page) {
+        mm_incref_page(page);
+    }
+    up_write(&ino->lock);
+    if (!page) {
+        return -ENOMEM;
+    }
+    *phys = page;
+    return 0;
+}
@@ -5,6 +5,9 @@
 #include "../../include/kernel/console.h"
 #include "../../include/kernel/dirent.h"
 #include "../../include/kernel/stat.h"
+#include "../../include/kernel/eventpoll.h"
+#include "../../include/kernel/uio.h"
+#include "../../include/kernel/shmfs.h"
 
 static const vfs_ops_t* g_root_ops = 0;
 static const vfs_ops_t* g_dev_ops = 0;
@@ -75,6 +78,41 @@ int vfs_chdir(const char* path) {
 long vfs_read(vfs_file_t* f, void* buf, long bytes) { if (!f || !f->ops || !f->ops->read) return ST_INVALID; return f->ops->read(f, buf, bytes); }
 long vfs_write(vfs_file_t* f, const void* buf, long bytes) { if (!f || !f->ops || !f->ops->write) return ST_INVALID; return f->ops->write(f, buf, bytes); }
 long vfs_seek(vfs_file_t* f, long offset, int whence) { if (!f || !f->ops || !f->ops->seek) return -1; return f->ops->seek(f, offset, whence); }
+long vfs_splice_read(vfs_file_t* f, struct pipe* pipe, long bytes) { if (!f || !f->ops || !f->ops->splice_read) return ST_UNSUPPORTED; return f->ops->splice_read(f, pipe, bytes); }
+
+// Without read_iter/write_iter a vector is one read/write per segment,
+// stopping at the first short one
+static long vfs_iter_by_segment(vfs_file_t* f, iov_iter_t* it, int write) {
+    long total = 0;
+    while (it->count) {
+        void* base = (uint8_t*)it->iov->iov_base + it->iov_offset;
+        size_t len = it->iov->iov_len - it->iov_offset;
+        if (len > it->count) len = it->count;
+        long r = write ? f->ops->write(f, base, (long)len) : f->ops->read(f, base, (long)len);
+        if (r < 0) return total ? total : r;
+        iov_iter_advance(it, (size_t)r);
+        total += r;
+        if ((size_t)r < len) break;
+    }
+    return total;
+}
+
+// Positional and RWF_NOWAIT requests need the iterator ops: ST_UNSUPPORTED
+long vfs_read_iter(vfs_file_t* f, iov_iter_t* it, long pos, int flags) {
+    if (!f || !f->ops) return ST_INVALID;
+    if (f->ops->read_iter) return f->ops->read_iter(f, it, pos, flags);
+    if (pos != VFS_POS_CUR || (flags & RWF_NOWAIT)) return ST_UNSUPPORTED;
+    if (!f->ops->read) return ST_INVALID;
+    return vfs_iter_by_segment(f, it, 0);
+}
+
+long vfs_write_iter(vfs_file_t* f, iov_iter_t* it, long pos, int flags) {
+    if (!f || !f->ops) return ST_INVALID;
+    if (f->ops->write_iter) return f->ops->write_iter(f, it, pos, flags);
+    if (pos != VFS_POS_CUR || (flags & RWF_NOWAIT)) return ST_UNSUPPORTED;
+    if (!f->ops->write) return ST_INVALID;
+    return vfs_iter_by_segment(f, it, 1);
+}
 
 long vfs_readdir(vfs_file_t* f, void* buf, long bytes) {
     if (!f || !f->ops || !f->ops->readdir) return ST_UNSUPPORTED;
@@ -124,7 +162,14 @@ long vfs_readdir(vfs_file_t* f, void* buf, long bytes) {
 }
 
 int vfs_truncate(vfs_file_t* f, unsigned long size) { if (!f || !f->ops || !f->ops->truncate) return ST_UNSUPPORTED; return f->ops->truncate(f, size); }
-int vfs_unlink(const char* path) { if (!g_root_ops || !g_root_ops->unlink) return ST_UNSUPPORTED; return g_root_ops->unlink(path); }
+int vfs_unlink(const char* path) {
+    if (vfs_is_dev_path(path)) {
+        if (!g_dev_ops || !g_dev_ops->unlink) return ST_UNSUPPORTED;
+        return g_dev_ops->unlink(path);
+    }
+    if (!g_root_ops || !g_root_ops->unlink) return ST_UNSUPPORTED;
+    return g_root_ops->unlink(path);
+}
 int vfs_rename(const char* oldpath, const char* newpath) { if (!g_root_ops || !g_root_ops->rename) return ST_UNSUPPORTED; return g_root_ops->rename(oldpath, newpath); }
 int vfs_mkdir(const char* path, unsigned int mode) { if (!g_root_ops || !g_root_ops->mkdir) return ST_UNSUPPORTED; return g_root_ops->mkdir(path, mode); }
 int vfs_rmdir(const char* path) { if (!g_root_ops || !g_root_ops->rmdir) return ST_UNSUPPORTED; return g_root_ops->rmdir(path); }
@@ -146,7 +191,9 @@ int vfs_close(vfs_file_t* f) {
         return ST_INVALID;
     }
     
-    // Actually close when refcount reaches 0 (old was 1, now 0)
+    // Actually close when refcount reaches 0 (old was 1, now 0); epoll
+    // watches on the file go first, while its wait queues still exist
+    eventpoll_release(f);
     return f->ops->close(f);
 }
 
@@ -163,8 +210,13 @@ void vfs_incref(vfs_file_t* f) {
     if (f) __sync_fetch_and_add(&f->refcount, 1);
 }
 
+int vfs_on_root(vfs_file_t* f) {
+    return f && g_root_ops && f->ops == g_root_ops;
+}
+
 size_t vfs_size(vfs_file_t* f) {
-    if (!f) return 0;
+    if (shmfs_is_file(f)) return shmfs_size(f);
+    if (!vfs_on_root(f)) return 0;
     // vfs_file_t is embedded as the first member of fat32_file_t
     // so we can cast directly (or use fs_private which points to same)
     fat32_file_t* ff = (fat32_file_t*)f;
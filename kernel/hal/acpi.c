@@ -2322,3 +2322,93 @@ uint32_t acpi_read_pmtimer(void) {
         return 0;
     return ticks;
 }
+
+// ============================================================================
+// Processor Idle States (_CST)
+// ============================================================================
+
+#define CST_GENERIC_REGISTER        0x82    // Large resource tag of the _CST register
+#define CST_FFH_VENDOR_INTEL        1   // Generic register BitWidth for FFH
+#define CST_FFH_CLASS_MWAIT         2   // BitOffset: native C-state via MWAIT
+
+static ACPI_STATUS
+find_cst_callback(ACPI_HANDLE Object, UINT32 NestingLevel, void *Context,
+                  void **ReturnValue)
+{
+    ACPI_HANDLE tmp;
+    (void)NestingLevel;
+    (void)ReturnValue;
+
+    if (AcpiGetHandle(Object, "_CST", &tmp) != AE_OK)
+        return AE_OK;
+    *(ACPI_HANDLE*)Context = Object;
+    return AE_CTRL_TERMINATE;
+}
+
+int acpi_get_cstates(acpi_cstate_t* out, int max_out) {
+    if (!out || max_out <= 0) return 0;
+
+    // Legacy Processor objects first, then ACPI0007 processor devices
+    ACPI_HANDLE cpu = NULL;
+    AcpiWalkNamespace(ACPI_TYPE_PROCESSOR, ACPI_ROOT_OBJECT, ACPI_UINT32_MAX,
+                      find_cst_callback, NULL, &cpu, NULL);
+    if (!cpu)
+        AcpiGetDevices("ACPI0007", find_cst_callback, &cpu, NULL);
+    if (!cpu) return 0;
+
+    ACPI_BUFFER buf = {ACPI_ALLOCATE_BUFFER, NULL};
+    if (ACPI_FAILURE(AcpiEvaluateObject(cpu, "_CST", NULL, &buf)) || !buf.Pointer)
+        return 0;
+
+    // Package { Count, Package { Register, Type, Latency, Power }, ... }
+    ACPI_OBJECT* cst = (ACPI_OBJECT*)buf.Pointer;
+    int count = 0;
+    if (cst->Type == ACPI_TYPE_PACKAGE) {
+        for (UINT32 i = 1; i < cst->Package.Count && count < max_out; i++) {
+            ACPI_OBJECT* cx = &cst->Package.Elements[i];
+            if (cx->Type != ACPI_TYPE_PACKAGE || cx->Package.Count < 4)
+                continue;
+            ACPI_OBJECT* reg = &cx->Package.Elements[0];
+            ACPI_OBJECT* type = &cx->Package.Elements[1];
+            ACPI_OBJECT* latency = &cx->Package.Elements[2];
+            ACPI_OBJECT* power = &cx->Package.Elements[3];
+            if (reg->Type != ACPI_TYPE_BUFFER || reg->Buffer.Length < 15 ||
+                type->Type != ACPI_TYPE_INTEGER || latency->Type != ACPI_TYPE_INTEGER)
+                continue;
+
+            // Generic Register Descriptor: tag, length(2), space, bit width,
+            // bit offset, access size, address(8)
+            const uint8_t* r = reg->Buffer.Pointer;
+            if (r[0] != CST_GENERIC_REGISTER)
+                continue;
+            uint64_t address;
+            my_memcpy(&address, r + 7, sizeof(address));
+
+            acpi_cstate_t* cs = &out[count];
+            my_memset(cs, 0, sizeof(*cs));
+            cs->type = (uint8_t)type->Integer.Value;
+            cs->latency_us = (uint32_t)latency->Integer.Value;
+            cs->power_mw = power->Type == ACPI_TYPE_INTEGER ? (uint32_t)power->Integer.Value : 0;
+
+            if (r[3] == ACPI_ADR_SPACE_FIXED_HARDWARE) {
+                if (r[4] == CST_FFH_VENDOR_INTEL && r[5] == CST_FFH_CLASS_MWAIT) {
+                    cs->entry = ACPI_CSTATE_MWAIT;
+                    cs->mwait_hint = (uint32_t)address;
+                } else {
+                    cs->entry = ACPI_CSTATE_HALT;
+                }
+            } else if (r[3] == ACPI_ADR_SPACE_SYSTEM_IO) {
+                cs->entry = cs->type == 1 ? ACPI_CSTATE_HALT : ACPI_CSTATE_SYSTEMIO;
+                cs->io_port = (uint16_t)address;
+            } else {
+                continue;
+            }
+            acpi_dbg("ACPI: _CST C%u entry=%u hint=0x%x latency=%uus\n",
+                     cs->type, cs->entry, cs->mwait_hint, cs->latency_us);
+            count++;
+        }
+    }
+
+    AcpiOsFree(buf.Pointer);
+    return count;
+}
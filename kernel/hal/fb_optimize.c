@@ -7,6 +7,7 @@
 #include "../../include/kernel/memory.h"
 #include "../../include/kernel/console.h"
 #include "../../include/kernel/sched.h"
+#include "../../include/kernel/fpu.h"
 
 
 // Define missing types for kernel
@@ -144,6 +145,7 @@ const char* cpu_features_to_string(uint32_t features)
 }
 
 // SSE-optimized memory copy for aligned addresses
+__attribute__((target("sse2")))
 void sse_copy_aligned(void* dst, const void* src, size_t bytes)
 {
     if(!(g_double_buffer.cpu_features & CPU_FEATURE_SSE2) || bytes < 16) {
@@ -155,6 +157,7 @@ void sse_copy_aligned(void* dst, const void* src, size_t bytes)
     size_t sse_bytes = bytes & ~15; // Round down to 16-byte boundary
     size_t remaining = bytes - sse_bytes;
 
+    kernel_fpu_begin();
     __asm__ volatile (
         "1:\n\t"
         "movdqa (%0), %%xmm0\n\t"
@@ -167,6 +170,7 @@ void sse_copy_aligned(void* dst, const void* src, size_t bytes)
         :
         : "memory", "xmm0"
     );
+    kernel_fpu_end();
 
     // Copy remaining bytes
     if(remaining) {
@@ -179,6 +183,7 @@ void sse_copy_aligned(void* dst, const void* src, size_t bytes)
 }
 
 // SSE-optimized memory copy for unaligned addresses
+__attribute__((target("sse2")))
 void sse_copy_unaligned(void* dst, const void* src, size_t bytes)
 {
     if(!(g_double_buffer.cpu_features & CPU_FEATURE_SSE2) || bytes < 16) {
@@ -190,6 +195,7 @@ void sse_copy_unaligned(void* dst, const void* src, size_t bytes)
     size_t sse_bytes = bytes & ~15; // Round down to 16-byte boundary
     size_t remaining = bytes - sse_bytes;
 
+    kernel_fpu_begin();
     __asm__ volatile (
         "1:\n\t"
         "movdqu (%0), %%xmm0\n\t"
@@ -202,6 +208,7 @@ void sse_copy_unaligned(void* dst, const void* src, size_t bytes)
         :
         : "memory", "xmm0"
     );
+    kernel_fpu_end();
 
     // Copy remaining bytes
     if(remaining) {
@@ -216,6 +223,7 @@ void sse_copy_unaligned(void* dst, const void* src, size_t bytes)
 // SSE non-temporal copy for write-combining memory (VRAM front buffer)
 // Uses movntdq to bypass cache - ideal for WC memory writes
 // Does NOT issue sfence - caller must sfence after all NT writes are done
+__attribute__((target("sse2")))
 void sse_copy_nt(void* dst, const void* src, size_t bytes)
 {
     if(!(g_double_buffer.cpu_features & CPU_FEATURE_SSE2) || bytes < 16) {
@@ -236,6 +244,8 @@ void sse_copy_nt(void* dst, const void* src, size_t bytes)
     s += align_off;
     bytes -= align_off;
 
+    kernel_fpu_begin();
+
     // Main NT copy: 64 bytes per iteration (4 x movntdq) for WC buffer filling
     size_t bulk = bytes & ~63;
     if(bulk > 0) {
@@ -287,6 +297,8 @@ void sse_copy_nt(void* dst, const void* src, size_t bytes)
         d += mid16;
     }
 
+    kernel_fpu_end();
+
     // Trailing bytes (< 16)
     size_t tail = mid & 15;
     for(size_t i = 0; i < tail; i++) {
@@ -621,15 +633,19 @@ void fb_flush_dirty_regions_unlocked(void)
     if(g_double_buffer.full_screen_dirty) {
         // Copy entire screen using non-temporal stores for WC VRAM
         size_t buffer_size = g_double_buffer.height * g_double_buffer.pitch * sizeof(uint32_t);
+        kernel_fpu_begin();
         sse_copy_nt(g_double_buffer.front_buffer, g_double_buffer.back_buffer, buffer_size);
         // Ensure all NT stores are globally visible
         __asm__ volatile("sfence" ::: "memory");
+        kernel_fpu_end();
         g_double_buffer.pixels_copied += g_double_buffer.width * g_double_buffer.height;
         g_double_buffer.full_screen_dirty = 0;
         g_double_buffer.num_dirty_regions = 0;
         return;
     }
-    // Copy individual dirty regions
+    // Copy individual dirty regions.  One SIMD section for all rows so the
+    // per-row copies do not each save and restore the user FPU state.
+    kernel_fpu_begin();
     for(uint32_t i = 0; i < g_double_buffer.num_dirty_regions; i++) {
         dirty_rect_t* region = &g_double_buffer.dirty_regions[i];
         if(region->dirty) {
@@ -672,6 +688,7 @@ void fb_flush_dirty_regions_unlocked(void)
     if(g_double_buffer.cpu_features & CPU_FEATURE_SSE2) {
         __asm__ volatile("sfence" ::: "memory");
     }
+    kernel_fpu_end();
     // Clear dirty regions
     g_double_buffer.num_dirty_regions = 0;
 }
@@ -789,6 +806,7 @@ void fb_copy_rect(uint32_t dst_x, uint32_t dst_y, uint32_t src_x, uint32_t src_y
         }
     } else {
         // Copy from top to bottom, left to right
+        kernel_fpu_begin();
         for(uint32_t y = 0; y < height; y++) {
             uint32_t src_offset = (src_y + y) * g_double_buffer.pitch + src_x;
             uint32_t dst_offset = (dst_y + y) * g_double_buffer.pitch + dst_x;
@@ -796,6 +814,7 @@ void fb_copy_rect(uint32_t dst_x, uint32_t dst_y, uint32_t src_x, uint32_t src_y
                    &g_double_buffer.back_buffer[src_offset],
                    width * sizeof(uint32_t));
         }
+        kernel_fpu_end();
     }
     // Mark destination area as dirty
     fb_mark_dirty(dst_x, dst_y, dst_x + width - 1, dst_y + height - 1);
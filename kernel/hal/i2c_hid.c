@@ -751,6 +751,9 @@ static int dw_i2c_xfer_irq(i2c_dw_controller_t *ctrl, uint16_t addr,
 // Forward declaration for worker thread
 static void i2c_hid_worker_thread(void *arg);
 
+// RT priority of the per-controller input workers (SCHED_FIFO)
+#define I2C_HID_WORKER_RT_PRIO  50
+
 // Forward declaration for length-first I2C HID read
 static int i2c_hid_read_length_first(i2c_hid_device_t *dev,
                                      uint8_t *buf, uint16_t buf_size);
@@ -4190,7 +4193,11 @@ int i2c_hid_init(void) {
             continue;
         }
         ctrl->worker_running = 1;
-        sched_add_task(i2c_hid_worker_thread, ctrl, stack, 16384);
+        task_t *worker = sched_add_task(i2c_hid_worker_thread, ctrl, stack, 16384);
+        // Input latency matters more than throughput: run the worker in the
+        // RT class so a GPIO wakeup preempts whatever is running.
+        if (worker)
+            sched_setscheduler(worker, SCHED_FIFO, I2C_HID_WORKER_RT_PRIO);
         kprintf("[I2C-HID] Worker thread created for I2C%d\n", ctrl->bus_id);
     }
 
@@ -4578,6 +4585,23 @@ static void i2c_hid_read_and_process(i2c_hid_device_t *dev)
 // Worker Thread (Threaded IRQ Bottom-Half)
 // ============================================================================
 
+// Block the worker for ms, rounded up to whole timer ticks (the wakeup lands
+// on a tick boundary, so one iteration per tick is the upper bound).
+static void i2c_hid_worker_sleep_ms(task_t *self, uint32_t ms)
+{
+    uint32_t hz = timer_get_frequency();
+    uint64_t ticks = hz ? ((uint64_t)ms * hz + 999) / 1000 : 1;
+    if (ticks == 0)
+        ticks = 1;
+
+    self->wait_channel = NULL;
+    self->wakeup_tick = timer_ticks() + ticks;
+    self->state = TASK_BLOCKED;
+    sched_schedule();
+    self->wakeup_tick = 0;
+    self->state = TASK_RUNNING;
+}
+
 // Per-controller worker thread: blocks until woken by GPIO ISR, then reads
 // input reports from all pending devices on this controller.
 static void i2c_hid_worker_thread(void *arg)
@@ -4780,7 +4804,9 @@ static void i2c_hid_worker_thread(void *arg)
         // Keep IE masked during this gap so no ISR fires.  8 ms gives
         // the bus and device firmware breathing room and yields a
         // natural ~100 Hz read rate (matching the touchpad report rate).
-        i2c_delay_us(8000);
+        // Sleep instead of spinning: the worker runs in the RT class, so
+        // a busy-wait would hold its CPU for most of every report period.
+        i2c_hid_worker_sleep_ms(self, 8);
 
         // NOW re-enable GPI_IE — any pending INT# assertion will
         // fire the ISR which sets work_pending and wakes us.
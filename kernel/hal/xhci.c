@@ -1653,7 +1653,7 @@ int xhci_disable_slot(xhci_controller_t* ctrl, uint8_t slot) {
     return ST_OK;
 }
 
-// Hot-plug poll: called from the main loop to handle runtime USB
+// Hot-plug poll: called from the hot-plug work item to handle runtime USB
 // connect/disconnect events that were flagged by xhci_handle_port_event().
 //
 // Also processes the xHCI event ring as a fallback for systems where
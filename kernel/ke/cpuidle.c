@@ -0,0 +1,243 @@
+// LikeOS-64 - CPU Idle States
+// ============================================================================
+// The idle task enters the deepest usable C-state whose target residency
+// fits the predicted idle time of this CPU (an average of recent idle
+// periods).  With MONITOR/MWAIT, the CPU arms the monitor on its idle
+// task's need_resched and sets idle_polling.  A remote enqueue that sees
+// idle_polling only has to store need_resched, which ends the MWAIT.
+// With interrupt break-events (CPUID.5:ECX[1]) MWAIT runs with interrupts
+// masked, so residency is measured before any handler runs.
+//
+// C-states come from ACPI _CST (FFH entries carry the MWAIT hint).  States
+// deeper than C1 stop the LAPIC timer unless the CPU has ARAT, so they are
+// only used with ARAT.  Chipset I/O-port C-states are not supported.  CPUs
+// without usable MWAIT idle with HLT.
+// ============================================================================
+
+#include "../../include/kernel/cpuidle.h"
+#include "../../include/kernel/percpu.h"
+#include "../../include/kernel/acpi.h"
+#include "../../include/kernel/console.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/syscall.h"
+
+typedef struct cpuidle_state {
+    uint8_t type;               // ACPI C-state type (1 = C1, ...)
+    bool mwait;                 // Enter with MWAIT (else HLT)
+    uint32_t hint;              // MWAIT EAX hint
+    uint32_t latency_us;        // Exit latency
+    uint64_t target_ns;         // Predicted idle time needed to pay off
+} cpuidle_state_t;
+
+// Per-CPU counters, written by the owning CPU except ipis_avoided
+typedef struct cpuidle_cpu {
+    uint64_t usage[SCHED_IDLE_MAX_STATES];
+    uint64_t time_ns[SCHED_IDLE_MAX_STATES];
+    uint64_t ipis_avoided;
+    uint64_t predict_ns;        // Running average of idle periods
+} cpuidle_cpu_t;
+
+static cpuidle_state_t g_idle_states[SCHED_IDLE_MAX_STATES];
+static int g_nr_idle_states = 1;
+static bool g_idle_mwait = false;
+static cpuidle_cpu_t g_idle_cpu[MAX_CPUS];
+
+// A C-state is worth entering when the CPU stays idle for at least this
+// many times its exit latency
+#define CPUIDLE_RESIDENCY_FACTOR    3
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+static inline void cpuid_count(uint32_t leaf, uint32_t subleaf, uint32_t* eax,
+                               uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(subleaf));
+}
+
+// Number of MWAIT sub-states CPUID leaf 5 reports for the hint's C-state
+static bool mwait_hint_supported(uint32_t hint, uint32_t substates) {
+    uint32_t cstate = ((hint >> 4) & 0xF) + 1;
+    if (cstate >= 8) return false;
+    return (hint & 0xF) < ((substates >> (cstate * 4)) & 0xF);
+}
+
+void cpuidle_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid_count(0, 0, &eax, &ebx, &ecx, &edx);
+    uint32_t max_leaf = eax;
+    cpuid_count(1, 0, &eax, &ebx, &ecx, &edx);
+    bool has_monitor = ecx & (1U << 3);
+
+    uint32_t substates = 0;
+    if (has_monitor && max_leaf >= 5) {
+        cpuid_count(5, 0, &eax, &ebx, &ecx, &edx);
+        // Needs extensions enumerated and break-on-masked-interrupt
+        if ((ecx & 0x3) == 0x3) {
+            g_idle_mwait = true;
+            substates = edx;
+        }
+    }
+    bool arat = false;
+    if (max_leaf >= 6) {
+        cpuid_count(6, 0, &eax, &ebx, &ecx, &edx);
+        arat = eax & (1U << 2);
+    }
+
+    // State 0 is always C1: MWAIT hint 0 or HLT
+    g_idle_states[0].type = 1;
+    g_idle_states[0].mwait = g_idle_mwait;
+    g_idle_states[0].hint = 0;
+    g_idle_states[0].latency_us = 1;
+    g_idle_states[0].target_ns = 0;
+    g_nr_idle_states = 1;
+
+    acpi_cstate_t cst[ACPI_CSTATE_MAX];
+    int n = g_idle_mwait ? acpi_get_cstates(cst, ACPI_CSTATE_MAX) : 0;
+    for (int i = 0; i < n; i++) {
+        if (cst[i].entry != ACPI_CSTATE_MWAIT) continue;
+        if (!mwait_hint_supported(cst[i].mwait_hint, substates)) continue;
+        if (cst[i].type == 1) {
+            g_idle_states[0].hint = cst[i].mwait_hint;
+            if (cst[i].latency_us) g_idle_states[0].latency_us = cst[i].latency_us;
+            continue;
+        }
+        if (!arat || g_nr_idle_states >= SCHED_IDLE_MAX_STATES) continue;
+        // Keep the table ordered by exit latency
+        if (cst[i].latency_us < g_idle_states[g_nr_idle_states - 1].latency_us) continue;
+
+        cpuidle_state_t* s = &g_idle_states[g_nr_idle_states++];
+        s->type = cst[i].type;
+        s->mwait = true;
+        s->hint = cst[i].mwait_hint;
+        s->latency_us = cst[i].latency_us;
+        s->target_ns = (uint64_t)cst[i].latency_us * 1000 * CPUIDLE_RESIDENCY_FACTOR;
+    }
+
+    kprintf("CPU idle: %s", g_idle_mwait ? "MWAIT polling," : "HLT");
+    if (g_idle_mwait) {
+        for (int i = 0; i < g_nr_idle_states; i++)
+            kprintf(" C%u(0x%02x)", g_idle_states[i].type, g_idle_states[i].hint);
+        if (n) kprintf(" from _CST");
+    }
+    kprintf("\n");
+}
+
+// ============================================================================
+// Idle Entry / Exit
+// ============================================================================
+
+// Deepest state whose target residency fits the predicted idle time
+static int cpuidle_select(const cpuidle_cpu_t* st) {
+    int idx = 0;
+    for (int i = 1; i < g_nr_idle_states; i++) {
+        if (g_idle_states[i].target_ns > st->predict_ns) break;
+        idx = i;
+    }
+    return idx;
+}
+
+void cpuidle_enter(void) {
+    if (!sched_is_smp()) {
+        __asm__ volatile("sti; hlt" ::: "memory");
+        return;
+    }
+
+    percpu_t* cpu = this_cpu();
+    task_t* self = cpu->current_task;
+    const cpuidle_state_t* cs = &g_idle_states[cpuidle_select(&g_idle_cpu[cpu->cpu_id])];
+
+    __asm__ volatile("cli" ::: "memory");
+    if (self->need_resched) {
+        __asm__ volatile("sti" ::: "memory");
+        return;
+    }
+    cpu->idle_state = (int)(cs - g_idle_states);
+    cpu->idle_enter_ns = sched_clock();
+
+    if (cs->mwait) {
+        // Publish polling before arming the monitor; a waker stores
+        // need_resched and then checks idle_polling (see
+        // cpuidle_kick_polling), so one side always sees the other.
+        __atomic_store_n(&cpu->idle_polling, 1, __ATOMIC_SEQ_CST);
+        __asm__ volatile("monitor" : : "a"(&self->need_resched), "c"(0), "d"(0));
+        if (!self->need_resched) {
+            // ECX bit 0: masked interrupts still end the wait
+            __asm__ volatile("mwait" : : "a"(cs->hint), "c"(1) : "memory");
+        }
+        __atomic_store_n(&cpu->idle_polling, 0, __ATOMIC_SEQ_CST);
+        cpuidle_exit();
+        __asm__ volatile("sti" ::: "memory");
+    } else {
+        // The wakeup interrupt runs before we get back here and may switch
+        // away from the idle task; the context switch closes the interval.
+        __asm__ volatile("sti; hlt" ::: "memory");
+        cpuidle_exit();
+    }
+}
+
+void cpuidle_exit(void) {
+    uint64_t flags = local_irq_save();
+    percpu_t* cpu = this_cpu();
+    int idx = cpu->idle_state;
+    if (idx >= 0 && idx < g_nr_idle_states) {
+        cpuidle_cpu_t* st = &g_idle_cpu[cpu->cpu_id];
+        uint64_t delta = sched_clock() - cpu->idle_enter_ns;
+        st->usage[idx]++;
+        st->time_ns[idx] += delta;
+        st->predict_ns = (st->predict_ns * 7 + delta) / 8;
+    }
+    cpu->idle_state = -1;
+    local_irq_restore(flags);
+}
+
+bool cpuidle_kick_polling(uint32_t cpu_id) {
+    percpu_t* cpu = percpu_get(cpu_id);
+    if (!cpu || !cpu->idle_task) return false;
+    if (!__atomic_load_n(&cpu->idle_polling, __ATOMIC_ACQUIRE)) return false;
+
+    // The store hits the monitored line and ends MWAIT.  If the CPU has
+    // already stopped polling it re-checks need_resched after clearing
+    // idle_polling, so it still sees the store.
+    __atomic_store_n(&cpu->idle_task->need_resched, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&cpu->idle_polling, __ATOMIC_SEQ_CST)) return false;
+
+    __atomic_add_fetch(&g_idle_cpu[cpu_id].ipis_avoided, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+int cpuidle_get_stats(uint32_t cpu_id, k_sched_idlestats_t* out) {
+    if (cpu_id >= MAX_CPUS || !percpu_get(cpu_id)) return -EINVAL;
+
+    const cpuidle_cpu_t* st = &g_idle_cpu[cpu_id];
+    mm_memset(out, 0, sizeof(*out));
+    out->nr_states = (uint32_t)g_nr_idle_states;
+    out->polling = g_idle_mwait ? 1 : 0;
+    out->ipis_avoided = __atomic_load_n(&st->ipis_avoided, __ATOMIC_RELAXED);
+    for (int i = 0; i < g_nr_idle_states; i++) {
+        out->states[i].type = g_idle_states[i].type;
+        out->states[i].mwait_hint = g_idle_states[i].mwait ? g_idle_states[i].hint : SCHED_IDLE_HLT;
+        out->states[i].latency_us = g_idle_states[i].latency_us;
+        out->states[i].usage = st->usage[i];
+        out->states[i].time_ns = st->time_ns[i];
+    }
+    return 0;
+}
+
+void cpuidle_reset_stats(void) {
+    for (uint32_t c = 0; c < MAX_CPUS; c++) {
+        cpuidle_cpu_t* st = &g_idle_cpu[c];
+        for (int i = 0; i < SCHED_IDLE_MAX_STATES; i++) {
+            st->usage[i] = 0;
+            st->time_ns[i] = 0;
+        }
+        __atomic_store_n(&st->ipis_avoided, 0, __ATOMIC_RELAXED);
+    }
+}
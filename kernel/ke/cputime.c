@@ -0,0 +1,105 @@
+// LikeOS-64 - Precise CPU time accounting
+//
+// See include/kernel/cputime.h for the model.  The hot path (entry, exit
+// and context switch) lives in the header; this file holds the readers and
+// the bookkeeping for exiting threads and reaped children.
+//
+// A running task's counters lag by at most the time since its CPU's last
+// accounting event, and every CPU takes at least a timer interrupt per tick.
+// Readers flush their own CPU first so a task reading its own clock sees
+// the time up to the call.
+
+#include "../../include/kernel/cputime.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/percpu.h"
+#include "../../include/kernel/spinlock.h"
+#include "../../include/kernel/lapic.h"
+
+uint64_t cputime_to_ns(uint64_t tsc) {
+    uint64_t tsc_hz = lapic_get_tsc_freq();
+    if (!tsc_hz) {
+        return 0;
+    }
+    uint64_t whole = tsc / tsc_hz;
+    uint64_t rem = tsc % tsc_hz;
+    return whole * 1000000000ULL + (rem * 1000000000ULL) / tsc_hz;
+}
+
+// Charge this CPU's running interval without leaving its context
+static void cputime_flush(void) {
+    uint64_t flags = local_irq_save();
+    percpu_t* cpu = this_cpu();
+    cputime_charge(cpu, cpu->current_task, timer_rdtsc());
+    local_irq_restore(flags);
+}
+
+void cputime_thread(task_t* t, uint64_t* utime_ns, uint64_t* stime_ns) {
+    if (t == sched_current()) {
+        cputime_flush();
+    }
+    *utime_ns = cputime_to_ns(t->utime_tsc);
+    *stime_ns = cputime_to_ns(t->stime_tsc);
+}
+
+void cputime_group(task_t* t, uint64_t* utime_ns, uint64_t* stime_ns) {
+    task_t* leader = t->group_leader ? t->group_leader : t;
+    uint64_t utime = 0, stime = 0;
+    int seen_leader = 0;
+
+    cputime_flush();
+
+    uint64_t flags;
+    spin_lock_irqsave(&g_task_list_lock, &flags);
+    task_t* p = t;
+    do {
+        utime += p->utime_tsc;
+        stime += p->stime_tsc;
+        if (p == leader) {
+            seen_leader = 1;
+        }
+        p = p->thread_group_next;
+    } while (p && p != t);
+    // A leader that exited before its threads has left the list but keeps
+    // its own times
+    if (!seen_leader) {
+        utime += leader->utime_tsc;
+        stime += leader->stime_tsc;
+    }
+    utime += leader->dead_utime_tsc;
+    stime += leader->dead_stime_tsc;
+    spin_unlock_irqrestore(&g_task_list_lock, flags);
+
+    *utime_ns = cputime_to_ns(utime);
+    *stime_ns = cputime_to_ns(stime);
+}
+
+void cputime_children(task_t* t, uint64_t* utime_ns, uint64_t* stime_ns) {
+    task_t* leader = t->group_leader ? t->group_leader : t;
+    *utime_ns = cputime_to_ns(leader->cutime_tsc);
+    *stime_ns = cputime_to_ns(leader->cstime_tsc);
+}
+
+void cputime_thread_exit(task_t* leader, task_t* thread) {
+    if (leader == thread) {
+        return;
+    }
+    if (thread == sched_current()) {
+        cputime_flush();
+    }
+    leader->dead_utime_tsc += thread->utime_tsc;
+    leader->dead_stime_tsc += thread->stime_tsc;
+    thread->utime_tsc = 0;
+    thread->stime_tsc = 0;
+}
+
+void cputime_reap(task_t* parent, task_t* child) {
+    task_t* leader = parent->group_leader ? parent->group_leader : parent;
+    uint64_t utime = child->utime_tsc + child->dead_utime_tsc + child->cutime_tsc;
+    uint64_t stime = child->stime_tsc + child->dead_stime_tsc + child->cstime_tsc;
+
+    uint64_t flags;
+    spin_lock_irqsave(&g_task_list_lock, &flags);
+    leader->cutime_tsc += utime;
+    leader->cstime_tsc += stime;
+    spin_unlock_irqrestore(&g_task_list_lock, flags);
+}
@@ -384,8 +384,7 @@ int elf_exec(const char* path, char* const argv[], char* const envp[],
         // Inherit session/group from parent, but only override ctty
         // if parent actually has one (otherwise keep the default from
         // sched_add_user_task which sets tty_get_console)
-        t->pgid = cur->pgid;
-        t->sid  = cur->sid;
+        sched_set_pgid_sid(t, cur->pgid, cur->sid);
         if (cur->ctty)
             t->ctty = cur->ctty;
         mm_memset(t->cwd, 0, sizeof(t->cwd));
@@ -509,12 +508,6 @@ uint64_t elf_exec_replace(const char* path, char* const argv[],
                 int ufd = (int)(uintptr_t)cur->fd_table[i];
                 cur->fd_table[i] = NULL;
                 unix_close(ufd);
-            } else if (IS_EPOLL_FD(cur->fd_table[i])) {
-                int idx = EPOLL_FD_IDX(cur->fd_table[i]);
-                cur->fd_table[i] = NULL;
-                extern epoll_instance_t epoll_instances[];
-                if (idx >= 0 && idx < MAX_EPOLL_INSTANCES)
-                    epoll_instances[idx].active = 0;
             } else if (pipe_is_end(cur->fd_table[i])) {
                 pipe_close_end((pipe_end_t*)cur->fd_table[i]);
                 cur->fd_table[i] = NULL;
@@ -0,0 +1,175 @@
+// LikeOS-64 - Event Notification Files (eventfd)
+//
+// See include/kernel/eventfd.h.  An eventfd_ctx embeds the vfs_file_t the
+// fd table points at, so dup, fork and close work as for any file.  The
+// wait queue's lock also protects the counter; readers and writers share
+// the queue and each wakeup passes POLLIN or POLLOUT as the key.
+//
+// The user buffer is accessed with get_user()/put_user(); a read whose
+// copy-out faults puts the value back so it is not lost.
+
+#include "../../include/kernel/eventfd.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/signal.h"
+#include "../../include/kernel/wait.h"
+#include "../../include/kernel/poll.h"
+#include "../../include/kernel/net.h"
+#include "../../include/kernel/syscall.h"
+#include "../../include/kernel/uaccess.h"
+
+typedef struct eventfd_ctx {
+    vfs_file_t vfs;                 // Must be first: the fd table points here
+    wait_queue_head_t wqh;          // Readers and writers; lock covers count
+    uint64_t count;
+    unsigned int flags;             // EFD_SEMAPHORE
+} eventfd_ctx_t;
+
+static long eventfd_read(vfs_file_t* f, void* buf, long bytes);
+static long eventfd_write(vfs_file_t* f, const void* buf, long bytes);
+static int eventfd_close(vfs_file_t* f);
+static short eventfd_poll(vfs_file_t* f, short events, poll_table_t* pt);
+
+static const vfs_ops_t eventfd_ops = {
+    .read = eventfd_read,
+    .write = eventfd_write,
+    .close = eventfd_close,
+    .poll = eventfd_poll,
+};
+
+// Sleep on the context until cond() holds for the count or a signal comes
+static int eventfd_wait(eventfd_ctx_t* ctx, bool (*cond)(eventfd_ctx_t*, uint64_t),
+                        uint64_t arg) {
+    task_t* cur = sched_current();
+    if (!cur || (ctx->vfs.flags & O_NONBLOCK)) {
+        return -EAGAIN;
+    }
+    if (signal_pending(cur)) {
+        return -EINTR;
+    }
+    wait_queue_entry_t wait;
+    init_wait_entry(&wait, cur);
+    prepare_to_wait(&ctx->wqh, &wait);
+    if (!cond(ctx, arg) && !signal_pending(cur)) {
+        sched_schedule();
+    }
+    finish_wait(&ctx->wqh, &wait);
+    return 0;
+}
+
+static bool eventfd_readable(eventfd_ctx_t* ctx, uint64_t unused) {
+    (void)unused;
+    return __atomic_load_n(&ctx->count, __ATOMIC_ACQUIRE) != 0;
+}
+
+static bool eventfd_has_room(eventfd_ctx_t* ctx, uint64_t n) {
+    return EFD_COUNT_MAX - __atomic_load_n(&ctx->count, __ATOMIC_ACQUIRE) >= n;
+}
+
+static long eventfd_read(vfs_file_t* f, void* buf, long bytes) {
+    eventfd_ctx_t* ctx = (eventfd_ctx_t*)f;
+    if (bytes < (long)sizeof(uint64_t)) {
+        return -EINVAL;
+    }
+
+    uint64_t val;
+    uint64_t flags;
+    for (;;) {
+        spin_lock_irqsave(&ctx->wqh.lock, &flags);
+        if (ctx->count) {
+            val = (ctx->flags & EFD_SEMAPHORE) ? 1 : ctx->count;
+            ctx->count -= val;
+            spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+            break;
+        }
+        spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+        int ret = eventfd_wait(ctx, eventfd_readable, 0);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    if (put_user(val, (uint64_t*)buf)) {
+        spin_lock_irqsave(&ctx->wqh.lock, &flags);
+        uint64_t room = EFD_COUNT_MAX - ctx->count;
+        ctx->count += val < room ? val : room;
+        spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+        wake_up_key(&ctx->wqh, POLLIN);
+        return -EFAULT;
+    }
+    wake_up_key(&ctx->wqh, POLLOUT);
+    return sizeof(val);
+}
+
+static long eventfd_write(vfs_file_t* f, const void* buf, long bytes) {
+    eventfd_ctx_t* ctx = (eventfd_ctx_t*)f;
+    if (bytes < (long)sizeof(uint64_t)) {
+        return -EINVAL;
+    }
+
+    uint64_t val;
+    if (get_user(val, (const uint64_t*)buf)) {
+        return -EFAULT;
+    }
+    if (val == (uint64_t)-1) {
+        return -EINVAL;
+    }
+
+    uint64_t flags;
+    for (;;) {
+        spin_lock_irqsave(&ctx->wqh.lock, &flags);
+        if (EFD_COUNT_MAX - ctx->count >= val) {
+            ctx->count += val;
+            spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+            break;
+        }
+        spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+        int ret = eventfd_wait(ctx, eventfd_has_room, val);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    if (val) {
+        wake_up_key(&ctx->wqh, POLLIN);
+    }
+    return sizeof(val);
+}
+
+static short eventfd_poll(vfs_file_t* f, short events, poll_table_t* pt) {
+    eventfd_ctx_t* ctx = (eventfd_ctx_t*)f;
+    poll_wait(&ctx->wqh, pt);
+    uint64_t count = __atomic_load_n(&ctx->count, __ATOMIC_ACQUIRE);
+    short rev = 0;
+    if ((events & (POLLIN | POLLRDNORM)) && count)
+        rev |= POLLIN | POLLRDNORM;
+    if ((events & (POLLOUT | POLLWRNORM)) && count < EFD_COUNT_MAX)
+        rev |= POLLOUT | POLLWRNORM;
+    return rev;
+}
+
+static int eventfd_close(vfs_file_t* f) {
+    kfree(f);
+    return 0;
+}
+
+int eventfd_create(unsigned int initval, int flags, vfs_file_t** out) {
+    if (flags & ~(EFD_SEMAPHORE | EFD_NONBLOCK | EFD_CLOEXEC)) {
+        return -EINVAL;
+    }
+
+    eventfd_ctx_t* ctx = kalloc(sizeof(eventfd_ctx_t));
+    if (!ctx) {
+        return -ENOMEM;
+    }
+    mm_memset(ctx, 0, sizeof(eventfd_ctx_t));
+    wait_queue_init(&ctx->wqh, "eventfd");
+    ctx->count = initval;
+    ctx->flags = flags & EFD_SEMAPHORE;
+
+    ctx->vfs.ops = &eventfd_ops;
+    ctx->vfs.fs_private = ctx;
+    ctx->vfs.refcount = 1;
+    ctx->vfs.flags = O_RDWR | (flags & (EFD_NONBLOCK | EFD_CLOEXEC));
+
+    *out = &ctx->vfs;
+    return 0;
+}
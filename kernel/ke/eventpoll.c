@@ -0,0 +1,687 @@
+// LikeOS-64 - Event Poll (epoll)
+//
+// See include/kernel/eventpoll.h.  An eventpoll embeds the vfs_file_t the
+// fd table points at.  Each watched fd is an epitem in the instance's
+// red-black tree, keyed by (file, fd), and in a global hash keyed by file
+// so that the file's last close can find every item watching it.
+//
+// Adding an item polls its file with a poll table whose qproc hooks one of
+// the item's wait entries onto each queue the file names.  From then on a
+// wake_up() of the source runs ep_poll_callback(), which moves the item to
+// the ready list and wakes one epoll_wait() caller.  A transfer takes the
+// whole ready list, re-polls each item to get its current events, and
+// puts level-triggered items that are still ready back on the list.  A
+// callback that fires while its item is out on a transfer marks it, and
+// the transfer requeues it, so a wakeup is never lost.
+//
+// Locking, outermost first:
+//   ep_nest_lock        serialises loop checks when epolls watch epolls
+//   ep->lock            interest tree, item events; held across a transfer
+//   source locks        whatever the watched file's poll function takes
+//   source queue lock   held while ep_poll_callback() runs
+//   ep->rdlock          ready list and each item's rdstate
+//   ep->wq, ep->poll_wq queue locks, then the task lock
+// g_ep_hash.lock is taken either alone or inside ep->lock.  Allocation and
+// freeing happen outside all of these.
+
+#include "../../include/kernel/eventpoll.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/signal.h"
+#include "../../include/kernel/hrtimer.h"
+#include "../../include/kernel/rbtree.h"
+#include "../../include/kernel/wait.h"
+#include "../../include/kernel/poll.h"
+#include "../../include/kernel/syscall.h"
+
+#define EP_MAX_WAIT     2       // Queues hooked per item; no source names more
+#define EP_HASH_BITS    6
+#define EP_HASH_SIZE    (1 << EP_HASH_BITS)
+
+// Events an item may ask for along with EPOLLEXCLUSIVE
+#define EP_EXCLUSIVE_OK_BITS    (EPOLLIN | EPOLLOUT | EPOLLERR | EPOLLHUP | \
+                                 EPOLLWAKEUP | EPOLLET | EPOLLEXCLUSIVE)
+// Flag bits that are not events; a fired EPOLLONESHOT item keeps only these
+#define EP_PRIVATE_BITS         (EPOLLWAKEUP | EPOLLONESHOT | EPOLLET | EPOLLEXCLUSIVE)
+// Events a source's poll function reports
+#define EP_POLL_BITS            (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLRDNORM | \
+                                 EPOLLRDBAND | EPOLLWRNORM | EPOLLWRBAND)
+
+// epitem_t::rdstate
+#define EP_RD_IDLE          0   // Not known to be ready
+#define EP_RD_QUEUED        1   // On ep->rdhead
+#define EP_RD_TX            2   // Taken by a transfer in progress
+#define EP_RD_TX_PENDING    3   // Taken, and its source woke since
+
+typedef struct eventpoll eventpoll_t;
+typedef struct epitem epitem_t;
+
+typedef struct ep_wait {
+    wait_queue_entry_t entry;       // private = the epitem
+    wait_queue_head_t* whead;
+} ep_wait_t;
+
+struct epitem {
+    struct rb_node rbn;             // In ep->rbr
+    epitem_t* rdnext;               // Ready list, or a transfer's list
+    epitem_t* rdprev;
+    epitem_t* hnext;                // g_ep_hash chain
+    epitem_t* hprev;
+    eventpoll_t* ep;
+    void* file;                     // Watched fd table entry
+    eventpoll_t* nested;            // file, if it is an epoll instance
+    int fd;
+    int rdstate;                    // EP_RD_*, under ep->rdlock
+    int nwait;                      // Hooked entries in wait[]
+    int wait_overflow;              // The file named more than EP_MAX_WAIT
+    ep_wait_t wait[EP_MAX_WAIT];
+    uint32_t events;                // EPOLL* mask asked for
+    uint64_t data;
+};
+
+struct eventpoll {
+    vfs_file_t vfs;                 // Must be first: the fd table points here
+    spinlock_t lock;                // Tree and item events
+    spinlock_t rdlock;              // Ready list and item rdstate
+    wait_queue_head_t wq;           // epoll_wait() callers, exclusive
+    wait_queue_head_t poll_wq;      // Epoll instances watching this one
+    struct rb_root rbr;
+    epitem_t* rdhead;
+    epitem_t* rdtail;
+    int refs;                       // The file, plus releases in progress
+};
+
+// Poll table handed to the watched file when an item is added
+typedef struct ep_pqueue {
+    poll_table_t pt;
+    epitem_t* epi;
+} ep_pqueue_t;
+
+// Every item by watched file
+static struct {
+    spinlock_t lock;
+    epitem_t* buckets[EP_HASH_SIZE];
+    int nitems;
+} g_ep_hash = { .lock = SPINLOCK_INIT("ep_hash") };
+
+static spinlock_t ep_nest_lock = SPINLOCK_INIT("ep_nest");
+
+static short ep_eventpoll_poll(vfs_file_t* f, short events, poll_table_t* pt);
+static int ep_eventpoll_close(vfs_file_t* f);
+
+static const vfs_ops_t eventpoll_ops = {
+    .close = ep_eventpoll_close,
+    .poll = ep_eventpoll_poll,
+};
+
+int epoll_is_epoll(vfs_file_t* f) {
+    return f && (uintptr_t)f >= 0xFFFF800000000000ULL && f->ops == &eventpoll_ops;
+}
+
+static void ep_get(eventpoll_t* ep) {
+    __atomic_fetch_add(&ep->refs, 1, __ATOMIC_ACQ_REL);
+}
+
+static void ep_put(eventpoll_t* ep) {
+    if (__atomic_sub_fetch(&ep->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        kfree(ep);
+    }
+}
+
+// ============================================================================
+// Interest tree and file hash
+// ============================================================================
+
+static int ep_cmp(void* f1, int fd1, void* f2, int fd2) {
+    if (f1 != f2) {
+        return (uintptr_t)f1 < (uintptr_t)f2 ? -1 : 1;
+    }
+    return fd1 - fd2;
+}
+
+static epitem_t* ep_find(eventpoll_t* ep, void* file, int fd) {
+    struct rb_node* n = ep->rbr.rb_node;
+    while (n) {
+        epitem_t* epi = rb_entry(n, epitem_t, rbn);
+        int c = ep_cmp(file, fd, epi->file, epi->fd);
+        if (c == 0) {
+            return epi;
+        }
+        n = c < 0 ? n->rb_left : n->rb_right;
+    }
+    return NULL;
+}
+
+static void ep_rbtree_insert(eventpoll_t* ep, epitem_t* epi) {
+    struct rb_node** link = &ep->rbr.rb_node;
+    struct rb_node* parent = NULL;
+    while (*link) {
+        parent = *link;
+        epitem_t* cur = rb_entry(parent, epitem_t, rbn);
+        link = ep_cmp(epi->file, epi->fd, cur->file, cur->fd) < 0
+             ? &parent->rb_left : &parent->rb_right;
+    }
+    rb_link_node(&epi->rbn, parent, link);
+    rb_insert_color(&epi->rbn, &ep->rbr);
+}
+
+static unsigned ep_hash(void* file) {
+    return (unsigned)(((uintptr_t)file * 0x9E3779B97F4A7C15ULL) >> (64 - EP_HASH_BITS));
+}
+
+static void ep_hash_add(epitem_t* epi) {
+    uint64_t flags;
+    spin_lock_irqsave(&g_ep_hash.lock, &flags);
+    epitem_t** bucket = &g_ep_hash.buckets[ep_hash(epi->file)];
+    epi->hprev = NULL;
+    epi->hnext = *bucket;
+    if (*bucket) {
+        (*bucket)->hprev = epi;
+    }
+    *bucket = epi;
+    g_ep_hash.nitems++;
+    spin_unlock_irqrestore(&g_ep_hash.lock, flags);
+}
+
+static void ep_hash_del(epitem_t* epi) {
+    uint64_t flags;
+    spin_lock_irqsave(&g_ep_hash.lock, &flags);
+    if (epi->hprev) {
+        epi->hprev->hnext = epi->hnext;
+    } else {
+        g_ep_hash.buckets[ep_hash(epi->file)] = epi->hnext;
+    }
+    if (epi->hnext) {
+        epi->hnext->hprev = epi->hprev;
+    }
+    g_ep_hash.nitems--;
+    spin_unlock_irqrestore(&g_ep_hash.lock, flags);
+}
+
+// ============================================================================
+// Ready list
+// ============================================================================
+
+// Called with ep->rdlock held
+static void ep_rdlist_add(eventpoll_t* ep, epitem_t* epi) {
+    epi->rdnext = NULL;
+    epi->rdprev = ep->rdtail;
+    if (ep->rdtail) {
+        ep->rdtail->rdnext = epi;
+    } else {
+        __atomic_store_n(&ep->rdhead, epi, __ATOMIC_RELEASE);
+    }
+    ep->rdtail = epi;
+}
+
+// Called with ep->rdlock held
+static void ep_rdlist_del(eventpoll_t* ep, epitem_t* epi) {
+    if (epi->rdprev) {
+        epi->rdprev->rdnext = epi->rdnext;
+    } else {
+        __atomic_store_n(&ep->rdhead, epi->rdnext, __ATOMIC_RELEASE);
+    }
+    if (epi->rdnext) {
+        epi->rdnext->rdprev = epi->rdprev;
+    } else {
+        ep->rdtail = epi->rdprev;
+    }
+    epi->rdnext = epi->rdprev = NULL;
+}
+
+static bool ep_events_available(eventpoll_t* ep) {
+    return __atomic_load_n(&ep->rdhead, __ATOMIC_ACQUIRE) != NULL;
+}
+
+// Queue an item that has (or may have) events and wake one waiter.
+// Returns the number of tasks woken.
+static int ep_make_ready(eventpoll_t* ep, epitem_t* epi) {
+    uint64_t flags;
+    spin_lock_irqsave(&ep->rdlock, &flags);
+    if (epi->rdstate == EP_RD_IDLE) {
+        ep_rdlist_add(ep, epi);
+        epi->rdstate = EP_RD_QUEUED;
+    } else if (epi->rdstate == EP_RD_TX) {
+        epi->rdstate = EP_RD_TX_PENDING;
+    }
+    spin_unlock_irqrestore(&ep->rdlock, flags);
+
+    int woken = wake_up(&ep->wq);
+    wake_up_key(&ep->poll_wq, POLLIN | POLLRDNORM);
+    return woken;
+}
+
+// Wake function of the entries hooked onto watched files' queues
+static int ep_poll_callback(wait_queue_entry_t* entry, unsigned long key) {
+    epitem_t* epi = (epitem_t*)entry->private;
+    uint32_t events = __atomic_load_n(&epi->events, __ATOMIC_RELAXED);
+
+    // Disabled by EPOLLONESHOT, or not an event the item waits for
+    if (!(events & ~EP_PRIVATE_BITS)) {
+        return 0;
+    }
+    if (key && !(key & (events | EPOLLERR | EPOLLHUP))) {
+        return 0;
+    }
+    return ep_make_ready(epi->ep, epi);
+}
+
+static void ep_ptable_queue_proc(wait_queue_head_t* whead, poll_table_t* pt) {
+    epitem_t* epi = container_of(pt, ep_pqueue_t, pt)->epi;
+    if (epi->nwait >= EP_MAX_WAIT) {
+        epi->wait_overflow = 1;
+        return;
+    }
+    ep_wait_t* pwq = &epi->wait[epi->nwait++];
+    init_wait_func_entry(&pwq->entry, ep_poll_callback, epi);
+    pwq->whead = whead;
+    if (epi->events & EPOLLEXCLUSIVE) {
+        add_wait_queue_exclusive(whead, &pwq->entry);
+    } else {
+        add_wait_queue(whead, &pwq->entry);
+    }
+}
+
+// Current events of an item, limited to what it asked for
+static uint32_t ep_item_poll(epitem_t* epi, poll_table_t* pt) {
+    uint32_t events = epi->events;
+    short revents = fd_entry_poll(epi->file, (short)(events & EP_POLL_BITS), pt);
+    if (!(events & ~EP_PRIVATE_BITS) || (revents & POLLNVAL)) {
+        return 0;
+    }
+    // The low EPOLL* bits are the POLL* bits
+    return (uint16_t)revents & (events | EPOLLERR | EPOLLHUP);
+}
+
+// Unhook an item and take it out of the instance; called with ep->lock
+// held.  The caller frees it once the lock is dropped.
+static void ep_unlink(eventpoll_t* ep, epitem_t* epi) {
+    // Taking each queue's lock also waits out a callback running on it
+    for (int i = 0; i < epi->nwait; i++) {
+        remove_wait_queue(epi->wait[i].whead, &epi->wait[i].entry);
+    }
+    epi->nwait = 0;
+
+    uint64_t flags;
+    spin_lock_irqsave(&ep->rdlock, &flags);
+    if (epi->rdstate == EP_RD_QUEUED) {
+        ep_rdlist_del(ep, epi);
+    }
+    epi->rdstate = EP_RD_IDLE;
+    spin_unlock_irqrestore(&ep->rdlock, flags);
+
+    rb_erase(&epi->rbn, &ep->rbr);
+    ep_hash_del(epi);
+}
+
+// ============================================================================
+// epoll_ctl
+// ============================================================================
+
+// Called with ep->lock held; takes ownership of epi
+static int ep_insert(eventpoll_t* ep, epitem_t* epi) {
+    ep_rbtree_insert(ep, epi);
+    ep_hash_add(epi);
+
+    ep_pqueue_t epq;
+    init_poll_funcptr(&epq.pt, ep_ptable_queue_proc);
+    epq.epi = epi;
+    uint32_t revents = ep_item_poll(epi, &epq.pt);
+    if (epi->wait_overflow) {
+        ep_unlink(ep, epi);
+        return -ENOMEM;
+    }
+    if (revents) {
+        ep_make_ready(ep, epi);
+    }
+    return 0;
+}
+
+// Called with ep->lock held
+static void ep_modify(eventpoll_t* ep, epitem_t* epi, const struct epoll_event* event) {
+    __atomic_store_n(&epi->events, event->events, __ATOMIC_RELAXED);
+    epi->data = event->data.u64;
+    // Re-arms a fired EPOLLONESHOT item, and reports what is already there
+    if (ep_item_poll(epi, NULL)) {
+        ep_make_ready(ep, epi);
+    }
+}
+
+// Look for `from` among the instances `to` watches, directly or through
+// others.  Called with ep_nest_lock held.
+static int ep_loop_check(eventpoll_t* from, eventpoll_t* to, int depth) {
+    if (depth > EP_MAX_NESTS) {
+        return -ELOOP;
+    }
+    int ret = 0;
+    uint64_t flags;
+    spin_lock_irqsave(&to->lock, &flags);
+    for (struct rb_node* n = rb_first(&to->rbr); n && !ret; n = rb_next(n)) {
+        epitem_t* epi = rb_entry(n, epitem_t, rbn);
+        if (!epi->nested) {
+            continue;
+        }
+        ret = epi->nested == from ? -ELOOP : ep_loop_check(from, epi->nested, depth + 1);
+    }
+    spin_unlock_irqrestore(&to->lock, flags);
+    return ret;
+}
+
+int epoll_ctl_internal(vfs_file_t* epf, int op, int fd, struct epoll_event* event) {
+    eventpoll_t* ep = (eventpoll_t*)epf;
+    task_t* cur = sched_current();
+    if (!cur || fd < 0 || fd >= TASK_MAX_FDS) {
+        return -EBADF;
+    }
+    if (op != EPOLL_CTL_ADD && op != EPOLL_CTL_DEL && op != EPOLL_CTL_MOD) {
+        return -EINVAL;
+    }
+    if (op != EPOLL_CTL_DEL && !event) {
+        return -EFAULT;
+    }
+
+    void* file = cur->fd_table[fd];
+    if (!file) {
+        if (fd >= 3) {
+            return -EBADF;
+        }
+        file = (void*)(uintptr_t)(fd + 1);  // Console, as dup() would store it
+    }
+    if (file == (void*)epf) {
+        return -EINVAL;
+    }
+    eventpoll_t* nested = epoll_is_epoll((vfs_file_t*)file) ? (eventpoll_t*)file : NULL;
+
+    uint32_t events = op != EPOLL_CTL_DEL ? event->events : 0;
+    if (events & EPOLLEXCLUSIVE) {
+        if (op == EPOLL_CTL_MOD || nested || (events & ~EP_EXCLUSIVE_OK_BITS)) {
+            return -EINVAL;
+        }
+    }
+
+    epitem_t* epi_new = NULL;
+    if (op == EPOLL_CTL_ADD) {
+        epi_new = kalloc(sizeof(epitem_t));
+        if (!epi_new) {
+            return -ENOMEM;
+        }
+        mm_memset(epi_new, 0, sizeof(epitem_t));
+        epi_new->ep = ep;
+        epi_new->file = file;
+        epi_new->nested = nested;
+        epi_new->fd = fd;
+        epi_new->events = events;
+        epi_new->data = event->data.u64;
+    }
+
+    uint64_t nflags = 0;
+    bool nest_locked = false;
+    if (nested && op == EPOLL_CTL_ADD) {
+        spin_lock_irqsave(&ep_nest_lock, &nflags);
+        nest_locked = true;
+        int ret = ep_loop_check(ep, nested, 1);
+        if (ret < 0) {
+            spin_unlock_irqrestore(&ep_nest_lock, nflags);
+            kfree(epi_new);
+            return ret;
+        }
+    }
+
+    int ret = 0;
+    epitem_t* to_free = NULL;
+    uint64_t flags;
+    spin_lock_irqsave(&ep->lock, &flags);
+    epitem_t* epi = ep_find(ep, file, fd);
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        if (epi) {
+            ret = -EEXIST;
+            to_free = epi_new;
+            break;
+        }
+        ret = ep_insert(ep, epi_new);
+        if (ret < 0) {
+            to_free = epi_new;
+        }
+        break;
+    case EPOLL_CTL_DEL:
+        if (!epi) {
+            ret = -ENOENT;
+            break;
+        }
+        ep_unlink(ep, epi);
+        to_free = epi;
+        break;
+    case EPOLL_CTL_MOD:
+        if (!epi) {
+            ret = -ENOENT;
+        } else if (epi->events & EPOLLEXCLUSIVE) {
+            ret = -EINVAL;
+        } else {
+            ep_modify(ep, epi, event);
+        }
+        break;
+    }
+    spin_unlock_irqrestore(&ep->lock, flags);
+    if (nest_locked) {
+        spin_unlock_irqrestore(&ep_nest_lock, nflags);
+    }
+
+    if (to_free) {
+        kfree(to_free);
+    }
+    return ret;
+}
+
+// ============================================================================
+// epoll_wait
+// ============================================================================
+
+// Report up to maxevents ready items.  Called with ep->lock held.
+static int ep_send_events(eventpoll_t* ep, struct epoll_event* events, int maxevents) {
+    uint64_t flags;
+    spin_lock_irqsave(&ep->rdlock, &flags);
+    epitem_t* txlist = ep->rdhead;
+    __atomic_store_n(&ep->rdhead, NULL, __ATOMIC_RELEASE);
+    ep->rdtail = NULL;
+    for (epitem_t* epi = txlist; epi; epi = epi->rdnext) {
+        epi->rdstate = EP_RD_TX;
+    }
+    spin_unlock_irqrestore(&ep->rdlock, flags);
+
+    int n = 0;
+    epitem_t* epi = txlist;
+    while (epi) {
+        epitem_t* next = epi->rdnext;
+        bool requeue = true;            // No room left this call
+        if (n < maxevents) {
+            uint32_t revents = ep_item_poll(epi, NULL);
+            requeue = false;
+            if (revents) {
+                events[n].events = revents;
+                events[n].data.u64 = epi->data;
+                n++;
+                if (epi->events & EPOLLONESHOT) {
+                    __atomic_store_n(&epi->events, epi->events & EP_PRIVATE_BITS,
+                                     __ATOMIC_RELAXED);
+                } else if (!(epi->events & EPOLLET)) {
+                    // Level-triggered: report again until a poll finds it idle
+                    requeue = true;
+                }
+            }
+        }
+
+        spin_lock_irqsave(&ep->rdlock, &flags);
+        if (requeue || epi->rdstate == EP_RD_TX_PENDING) {
+            ep_rdlist_add(ep, epi);
+            epi->rdstate = EP_RD_QUEUED;
+        } else {
+            epi->rdstate = EP_RD_IDLE;
+        }
+        spin_unlock_irqrestore(&ep->rdlock, flags);
+        epi = next;
+    }
+
+    // Waiters are woken one at a time; pass on what this caller left
+    if (ep_events_available(ep)) {
+        wake_up(&ep->wq);
+    }
+    return n;
+}
+
+int epoll_wait_internal(vfs_file_t* epf, struct epoll_event* events,
+                        int maxevents, uint64_t timeout_ns) {
+    eventpoll_t* ep = (eventpoll_t*)epf;
+    if (maxevents <= 0 || !events) {
+        return -EINVAL;
+    }
+
+    task_t* cur = sched_current();
+    hrtimer_sleeper_t to;
+    bool timed = false;
+    if (cur && timeout_ns != 0 && timeout_ns != KTIME_MAX) {
+        uint64_t now = ktime_get_ns();
+        if (timeout_ns < KTIME_MAX - now) {
+            hrtimer_init_sleeper(&to, cur);
+            hrtimer_start(&to.timer, now + timeout_ns);
+            timed = true;
+        }
+    }
+
+    int ret;
+    for (;;) {
+        if (ep_events_available(ep)) {
+            uint64_t flags;
+            spin_lock_irqsave(&ep->lock, &flags);
+            ret = ep_send_events(ep, events, maxevents);
+            spin_unlock_irqrestore(&ep->lock, flags);
+            if (ret > 0) {
+                break;
+            }
+        }
+        ret = 0;
+        if (timeout_ns == 0 || !cur || (timed && hrtimer_sleeper_expired(&to))) {
+            break;
+        }
+        if (signal_pending(cur)) {
+            ret = -EINTR;
+            break;
+        }
+
+        wait_queue_entry_t wait;
+        init_wait_entry(&wait, cur);
+        prepare_to_wait_exclusive(&ep->wq, &wait);
+        if (!ep_events_available(ep) && !signal_pending(cur) &&
+            !(timed && hrtimer_sleeper_expired(&to))) {
+            sched_schedule();
+        }
+        finish_wait(&ep->wq, &wait);
+    }
+
+    if (timed) {
+        hrtimer_cancel(&to.timer);
+    }
+    return ret;
+}
+
+// ============================================================================
+// The epoll file
+// ============================================================================
+
+// Readable while anything is on the ready list, for epolls watching epolls
+static short ep_eventpoll_poll(vfs_file_t* f, short events, poll_table_t* pt) {
+    eventpoll_t* ep = (eventpoll_t*)f;
+    poll_wait(&ep->poll_wq, pt);
+    if ((events & (POLLIN | POLLRDNORM)) && ep_events_available(ep)) {
+        return POLLIN | POLLRDNORM;
+    }
+    return 0;
+}
+
+static int ep_eventpoll_close(vfs_file_t* f) {
+    eventpoll_t* ep = (eventpoll_t*)f;
+    epitem_t* dead = NULL;
+    uint64_t flags;
+    spin_lock_irqsave(&ep->lock, &flags);
+    struct rb_node* n;
+    while ((n = rb_first(&ep->rbr)) != NULL) {
+        epitem_t* epi = rb_entry(n, epitem_t, rbn);
+        ep_unlink(ep, epi);
+        epi->rdnext = dead;
+        dead = epi;
+    }
+    spin_unlock_irqrestore(&ep->lock, flags);
+
+    while (dead) {
+        epitem_t* next = dead->rdnext;
+        kfree(dead);
+        dead = next;
+    }
+    ep_put(ep);
+    return 0;
+}
+
+void eventpoll_release(void* file) {
+    if (!__atomic_load_n(&g_ep_hash.nitems, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    unsigned h = ep_hash(file);
+    for (;;) {
+        uint64_t flags;
+        spin_lock_irqsave(&g_ep_hash.lock, &flags);
+        epitem_t* epi = g_ep_hash.buckets[h];
+        while (epi && epi->file != file) {
+            epi = epi->hnext;
+        }
+        if (!epi) {
+            spin_unlock_irqrestore(&g_ep_hash.lock, flags);
+            return;
+        }
+        // Pin the instance; its lock has to be taken before the hash lock
+        eventpoll_t* ep = epi->ep;
+        ep_get(ep);
+        spin_unlock_irqrestore(&g_ep_hash.lock, flags);
+
+        spin_lock_irqsave(&ep->lock, &flags);
+        spin_lock(&g_ep_hash.lock);
+        epi = g_ep_hash.buckets[h];
+        while (epi && !(epi->file == file && epi->ep == ep)) {
+            epi = epi->hnext;
+        }
+        spin_unlock(&g_ep_hash.lock);
+        if (epi) {
+            ep_unlink(ep, epi);
+        }
+        spin_unlock_irqrestore(&ep->lock, flags);
+
+        kfree(epi);
+        ep_put(ep);
+    }
+}
+
+int epoll_create_internal(int flags, vfs_file_t** out) {
+    if (flags & ~EPOLL_CLOEXEC) {
+        return -EINVAL;
+    }
+
+    eventpoll_t* ep = kalloc(sizeof(eventpoll_t));
+    if (!ep) {
+        return -ENOMEM;
+    }
+    mm_memset(ep, 0, sizeof(eventpoll_t));
+    spinlock_init(&ep->lock, "epoll");
+    spinlock_init(&ep->rdlock, "epoll_rd");
+    wait_queue_init(&ep->wq, "epoll");
+    wait_queue_init(&ep->poll_wq, "epoll_poll");
+    ep->rbr = RB_ROOT;
+    ep->refs = 1;
+
+    ep->vfs.ops = &eventpoll_ops;
+    ep->vfs.fs_private = ep;
+    ep->vfs.refcount = 1;
+    ep->vfs.flags = O_RDWR | (flags & EPOLL_CLOEXEC);
+
+    *out = &ep->vfs;
+    return 0;
+}
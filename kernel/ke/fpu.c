@@ -0,0 +1,357 @@
+// LikeOS-64 - FPU / SIMD Extended State Management
+// ============================================================================
+// The kernel itself is built with -mgeneral-regs-only, so the x87/SSE/AVX
+// registers only ever hold user state, except inside kernel_fpu_begin/end.
+// Each user task owns a 64-byte aligned save area sized from CPUID leaf 0xD
+// for the features enabled in XCR0 (x87, SSE, AVX and, where present,
+// AVX-512).  State is switched eagerly in fpu_switch():
+//
+//   - prev is saved with XSAVEOPT, which skips components that were not
+//     modified since the last XRSTOR and writes init-state components as
+//     a single XSTATE_BV bit;
+//   - next is restored with XRSTOR unless this CPU still holds its
+//     registers (fpu_owner == next and next last ran here).
+//
+// CPUs without XSAVE fall back to the 512-byte FXSAVE/FXRSTOR format.
+// ============================================================================
+
+#include "../../include/kernel/fpu.h"
+#include "../../include/kernel/percpu.h"
+#include "../../include/kernel/console.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/syscall.h"
+
+// Largest save area supported by the static init image.  x87 + SSE + AVX +
+// AVX-512 needs ~2.7 KiB; larger components (AMX tiles) are never enabled.
+#define FPU_MAX_SIZE    4096
+
+#define CR0_MP          (1ULL << 1)
+#define CR0_EM          (1ULL << 2)
+#define CR0_TS          (1ULL << 3)
+#define CR0_NE          (1ULL << 5)
+#define CR4_OSFXSR      (1ULL << 9)
+#define CR4_OSXMMEXCPT  (1ULL << 10)
+#define CR4_OSXSAVE     (1ULL << 18)
+
+// Offsets within the legacy region / XSAVE header
+#define FXSAVE_MXCSR        24
+#define FXSAVE_MXCSR_MASK   28
+#define XSAVE_HDR_BV        (FPU_LEGACY_SIZE + 0)
+#define XSAVE_HDR_COMP_BV   (FPU_LEGACY_SIZE + 8)
+#define XSAVE_HDR_RESERVED  (FPU_LEGACY_SIZE + 16)
+
+static bool g_fpu_ready = false;
+static bool g_fpu_xsave = false;
+static bool g_fpu_xsaveopt = false;
+static bool g_fpu_avx2 = false;
+static uint64_t g_fpu_xcr0 = XFEATURE_X87 | XFEATURE_SSE;
+static uint32_t g_fpu_size = FPU_LEGACY_SIZE;
+static uint32_t g_mxcsr_mask = 0xFFBF;
+
+// Initial state loaded into new tasks and on execve
+static uint8_t g_fpu_init_image[FPU_MAX_SIZE] __attribute__((aligned(FPU_ALIGN)));
+
+// kernel_fpu_begin() nesting before per-CPU data exists (BSP only)
+static int g_boot_fpu_depth;
+static uint64_t g_boot_fpu_flags;
+
+// ============================================================================
+// Low-Level Helpers
+// ============================================================================
+
+static inline void cpuid_count(uint32_t leaf, uint32_t subleaf, uint32_t* eax,
+                               uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(subleaf));
+}
+
+static inline void xsetbv(uint32_t index, uint64_t value) {
+    __asm__ volatile("xsetbv" : : "c"(index), "a"((uint32_t)value),
+                     "d"((uint32_t)(value >> 32)));
+}
+
+static inline void fpu_save_regs(uint8_t* area) {
+    uint32_t lo = (uint32_t)g_fpu_xcr0, hi = (uint32_t)(g_fpu_xcr0 >> 32);
+    if (g_fpu_xsaveopt) {
+        __asm__ volatile("xsaveopt64 (%0)" : : "r"(area), "a"(lo), "d"(hi) : "memory");
+    } else if (g_fpu_xsave) {
+        __asm__ volatile("xsave64 (%0)" : : "r"(area), "a"(lo), "d"(hi) : "memory");
+    } else {
+        __asm__ volatile("fxsave64 (%0)" : : "r"(area) : "memory");
+    }
+}
+
+static inline void fpu_restore_regs(const uint8_t* area) {
+    uint32_t lo = (uint32_t)g_fpu_xcr0, hi = (uint32_t)(g_fpu_xcr0 >> 32);
+    if (g_fpu_xsave) {
+        __asm__ volatile("xrstor64 (%0)" : : "r"(area), "a"(lo), "d"(hi) : "memory");
+    } else {
+        __asm__ volatile("fxrstor64 (%0)" : : "r"(area) : "memory");
+    }
+}
+
+// Load next's registers on this CPU and record the ownership
+static inline void fpu_load_task(percpu_t* cpu, task_t* t) {
+    fpu_restore_regs(t->fpu_state);
+    cpu->fpu_owner = t;
+    t->fpu_last_cpu = (int)cpu->cpu_id;
+}
+
+// Clear bits that would make XRSTOR/FXRSTOR fault on an image that came
+// from user memory.
+static void fpu_sanitize(uint8_t* area) {
+    *(uint32_t*)(area + FXSAVE_MXCSR) &= g_mxcsr_mask;
+    if (!g_fpu_xsave) return;
+    *(uint64_t*)(area + XSAVE_HDR_BV) &= g_fpu_xcr0;
+    *(uint64_t*)(area + XSAVE_HDR_COMP_BV) = 0;     // Standard format only
+    mm_memset(area + XSAVE_HDR_RESERVED, 0, FPU_XSAVE_HDR_SIZE - 16);
+}
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+void fpu_init_cpu(void) {
+    uint64_t cr0, cr4;
+
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP | CR0_NE;
+    __asm__ volatile("mov %0, %%cr0" : : "r"(cr0));
+
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    if (g_fpu_xsave) cr4 |= CR4_OSXSAVE;
+    __asm__ volatile("mov %0, %%cr4" : : "r"(cr4));
+
+    if (g_fpu_xsave) xsetbv(0, g_fpu_xcr0);
+    __asm__ volatile("fninit");
+}
+
+void fpu_init_boot(void) {
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid_count(0, 0, &eax, &ebx, &ecx, &edx);
+    uint32_t max_leaf = eax;
+    cpuid_count(1, 0, &eax, &ebx, &ecx, &edx);
+    bool has_xsave = ecx & (1U << 26);
+    bool has_avx = ecx & (1U << 28);
+
+    if (has_xsave && max_leaf >= 0xD) {
+        cpuid_count(0xD, 0, &eax, &ebx, &ecx, &edx);
+        uint64_t supported = eax | ((uint64_t)edx << 32);
+
+        uint64_t xcr0 = XFEATURE_X87 | XFEATURE_SSE;
+        if (has_avx && (supported & XFEATURE_AVX)) xcr0 |= XFEATURE_AVX;
+        if ((xcr0 & XFEATURE_AVX) && max_leaf >= 7) {
+            cpuid_count(7, 0, &eax, &ebx, &ecx, &edx);
+            g_fpu_avx2 = ebx & (1U << 5);
+            if ((ebx & (1U << 16)) && (supported & XFEATURE_AVX512) == XFEATURE_AVX512)
+                xcr0 |= XFEATURE_AVX512;
+        }
+        g_fpu_xsave = true;
+        g_fpu_xcr0 = xcr0;
+    }
+
+    fpu_init_cpu();
+
+    if (g_fpu_xsave) {
+        // EBX of leaf 0xD.0 reflects the features currently set in XCR0
+        cpuid_count(0xD, 0, &eax, &ebx, &ecx, &edx);
+        if (ebx > FPU_MAX_SIZE && (g_fpu_xcr0 & XFEATURE_AVX512)) {
+            g_fpu_xcr0 &= ~XFEATURE_AVX512;
+            xsetbv(0, g_fpu_xcr0);
+            cpuid_count(0xD, 0, &eax, &ebx, &ecx, &edx);
+        }
+        g_fpu_size = ebx;
+        cpuid_count(0xD, 1, &eax, &ebx, &ecx, &edx);
+        g_fpu_xsaveopt = eax & 1;
+    }
+
+    // MXCSR_MASK from a fresh FXSAVE image (0 means the architectural default)
+    mm_memset(g_fpu_init_image, 0, sizeof(g_fpu_init_image));
+    __asm__ volatile("fxsave64 (%0)" : : "r"(g_fpu_init_image) : "memory");
+    uint32_t mask = *(uint32_t*)(g_fpu_init_image + FXSAVE_MXCSR_MASK);
+    if (mask) g_mxcsr_mask = mask;
+
+    // Init image: default control words, every XSAVE component in its
+    // init state (XSTATE_BV = 0)
+    mm_memset(g_fpu_init_image, 0, sizeof(g_fpu_init_image));
+    *(uint16_t*)g_fpu_init_image = FPU_DEFAULT_FCW;
+    *(uint32_t*)(g_fpu_init_image + FXSAVE_MXCSR) = FPU_DEFAULT_MXCSR;
+    *(uint32_t*)(g_fpu_init_image + FXSAVE_MXCSR_MASK) = g_mxcsr_mask;
+
+    __atomic_store_n(&g_fpu_ready, true, __ATOMIC_RELEASE);
+    kprintf("FPU: %s, x87 SSE%s%s%s, %u-byte state\n",
+            g_fpu_xsaveopt ? "XSAVEOPT" : g_fpu_xsave ? "XSAVE" : "FXSAVE",
+            (g_fpu_xcr0 & XFEATURE_AVX) ? " AVX" : "",
+            g_fpu_avx2 ? " AVX2" : "",
+            (g_fpu_xcr0 & XFEATURE_AVX512) ? " AVX-512" : "",
+            g_fpu_size);
+}
+
+uint32_t fpu_state_size(void) {
+    return g_fpu_size;
+}
+
+uint64_t fpu_xfeatures(void) {
+    return g_fpu_xcr0;
+}
+
+// ============================================================================
+// Per-Task State
+// ============================================================================
+
+int fpu_task_alloc(task_t* t) {
+    t->fpu_state = NULL;
+    t->fpu_alloc = NULL;
+    t->fpu_last_cpu = -1;
+    if (!g_fpu_ready) return 0;
+
+    void* raw = kalloc(g_fpu_size + FPU_ALIGN - 1);
+    if (!raw) return -ENOMEM;
+    t->fpu_alloc = raw;
+    t->fpu_state = (uint8_t*)(((uint64_t)raw + FPU_ALIGN - 1) & ~(uint64_t)(FPU_ALIGN - 1));
+    mm_memcpy(t->fpu_state, g_fpu_init_image, g_fpu_size);
+    return 0;
+}
+
+int fpu_task_fork(task_t* child, task_t* parent) {
+    // child is a byte copy of parent: drop the inherited pointers first
+    if (fpu_task_alloc(child) < 0) return -ENOMEM;
+    if (!child->fpu_state || !parent->fpu_state) return 0;
+
+    uint64_t flags = local_irq_save();
+    fpu_task_sync(parent);
+    mm_memcpy(child->fpu_state, parent->fpu_state, g_fpu_size);
+    local_irq_restore(flags);
+    return 0;
+}
+
+void fpu_task_free(task_t* t) {
+    if (t->fpu_alloc) kfree(t->fpu_alloc);
+    t->fpu_alloc = NULL;
+    t->fpu_state = NULL;
+}
+
+void fpu_task_sync(task_t* t) {
+    if (!t->fpu_state || !sched_is_smp()) return;
+    uint64_t flags = local_irq_save();
+    percpu_t* cpu = this_cpu();
+    if (cpu->fpu_owner == t && cpu->current_task == t)
+        fpu_save_regs(t->fpu_state);
+    local_irq_restore(flags);
+}
+
+void fpu_task_reset(task_t* t) {
+    if (!t->fpu_state && fpu_task_alloc(t) < 0) return;
+    if (!t->fpu_state) return;
+
+    uint64_t flags = local_irq_save();
+    mm_memcpy(t->fpu_state, g_fpu_init_image, g_fpu_size);
+    if (sched_is_smp() && this_cpu()->current_task == t)
+        fpu_load_task(this_cpu(), t);
+    local_irq_restore(flags);
+}
+
+int fpu_task_load_image(task_t* t, const void* image) {
+    if (!t->fpu_state) return -EINVAL;
+
+    uint64_t flags = local_irq_save();
+    mm_memcpy(t->fpu_state, image, g_fpu_size);
+    fpu_sanitize(t->fpu_state);
+    if (sched_is_smp() && this_cpu()->current_task == t)
+        fpu_load_task(this_cpu(), t);
+    local_irq_restore(flags);
+    return 0;
+}
+
+void fpu_switch(task_t* prev, task_t* next) {
+    if (!g_fpu_ready) return;
+    percpu_t* cpu = this_cpu();
+
+    if (prev->fpu_state && cpu->fpu_owner == prev)
+        fpu_save_regs(prev->fpu_state);
+
+    // Kernel threads never touch the registers outside kernel_fpu_begin(),
+    // so prev's state can stay loaded; fpu_owner still names prev.
+    if (!next->fpu_state) return;
+    if (cpu->fpu_owner == next && next->fpu_last_cpu == (int)cpu->cpu_id) return;
+    fpu_load_task(cpu, next);
+}
+
+// ============================================================================
+// Kernel SIMD Use
+// ============================================================================
+
+void kernel_fpu_begin(void) {
+    uint64_t flags = local_irq_save();
+
+    if (!sched_is_smp()) {
+        if (g_boot_fpu_depth++ == 0) g_boot_fpu_flags = flags;
+        return;
+    }
+
+    percpu_t* cpu = this_cpu();
+    if (cpu->fpu_depth++) return;
+    cpu->fpu_irq_flags = flags;
+    cpu->fpu_saved_task = NULL;
+
+    task_t* cur = cpu->current_task;
+    if (g_fpu_ready && cur && cur->fpu_state && cpu->fpu_owner == cur) {
+        fpu_save_regs(cur->fpu_state);
+        cpu->fpu_saved_task = cur;
+    }
+    cpu->fpu_owner = NULL;
+}
+
+void kernel_fpu_end(void) {
+    if (!sched_is_smp()) {
+        if (g_boot_fpu_depth > 0 && --g_boot_fpu_depth == 0)
+            local_irq_restore(g_boot_fpu_flags);
+        return;
+    }
+
+    percpu_t* cpu = this_cpu();
+    if (cpu->fpu_depth <= 0 || --cpu->fpu_depth) return;
+
+    task_t* t = cpu->fpu_saved_task;
+    if (t) {
+        cpu->fpu_saved_task = NULL;
+        fpu_load_task(cpu, t);
+    }
+    local_irq_restore(cpu->fpu_irq_flags);
+}
+
+__attribute__((target("sse2")))
+uint64_t fpu_csum16(const void* buf, size_t len) {
+    const uint8_t* p = (const uint8_t*)buf;
+    uint32_t lanes[4] __attribute__((aligned(16)));
+
+    // Zero-extend each 16-bit word into a 32-bit lane and accumulate.  Each
+    // 16-byte block adds at most 2 * 0xFFFF to a lane, so 256 KiB cannot
+    // overflow.
+    __asm__ volatile(
+        "pxor %%xmm0, %%xmm0\n\t"
+        "pxor %%xmm3, %%xmm3\n\t"
+        "test %1, %1\n\t"
+        "jz 2f\n\t"
+        "1:\n\t"
+        "movdqu (%0), %%xmm1\n\t"
+        "movdqa %%xmm1, %%xmm2\n\t"
+        "punpcklwd %%xmm3, %%xmm1\n\t"
+        "punpckhwd %%xmm3, %%xmm2\n\t"
+        "paddd %%xmm1, %%xmm0\n\t"
+        "paddd %%xmm2, %%xmm0\n\t"
+        "add $16, %0\n\t"
+        "sub $16, %1\n\t"
+        "jnz 1b\n\t"
+        "2:\n\t"
+        "movdqa %%xmm0, (%2)\n\t"
+        : "+r"(p), "+r"(len)
+        : "r"(lanes)
+        : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+
+    return (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
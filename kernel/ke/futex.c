@@ -8,7 +8,8 @@
 // Architecture:
 //   - 256-bucket hash table to reduce lock contention
 //   - Per-bucket spinlock for waiters
-//   - Physical address key for shared futexes, virtual+PML4 for private
+//   - Physical address key for shared futexes in MAP_SHARED pages,
+//     virtual+PML4 for the rest
 //   - Robust futex support for pthread_mutex_t with PTHREAD_MUTEX_ROBUST
 // ============================================================================
 
@@ -184,38 +185,37 @@ static inline uint32_t futex_hash_fn(uint64_t key) {
     return (uint32_t)(key % FUTEX_HASH_BUCKETS);
 }
 
-// Get the key for a futex address
-// - Shared futexes: physical address (same across processes)
-// - Private futexes: combine PML4 base with virtual address
-static uint64_t futex_get_key(uint64_t uaddr, bool shared) {
-    if (shared) {
-        // For shared futexes, use physical address as key
-        return mm_get_physical_address(uaddr);
-    } else {
-        // For private futexes, combine PML4 virtual address with user address.
-        // All CLONE_VM threads share the same task->pml4 pointer, so the
-        // kernel virtual address is a stable, unique per-process identifier.
-        // DO NOT use mm_get_physical_address() here: it walks the page tables
-        // starting from the current CR3, and can return inconsistent results
-        // (including 0) depending on timing and which CPU the thread runs on.
-        task_t* cur = sched_current();
-        uint64_t pml4_id = cur && cur->pml4 ? (uint64_t)cur->pml4 : 0;
-        return pml4_id ^ uaddr;
+// Get the key for a futex address on behalf of a task
+// - Shared futexes (no FUTEX_PRIVATE_FLAG) in a MAP_SHARED page: physical
+//   address, so waiters in every address space mapping the page meet.
+//   PAGE_SHARED is in the PTE itself, which all CLONE_VM threads and both
+//   sides of a fork see, unlike the per-task mmap region tables.
+// - Everything else: combine PML4 base with virtual address.  A shared
+//   futex in private memory is only visible to this address space, and
+//   keying it like a private one keeps it stable across COW breaks.
+// The two never collide: physical addresses are below 2^52 while PML4
+// pointers are kernel-half addresses.
+//
+// DO NOT use mm_get_physical_address() here: it walks the page tables
+// starting from the current CR3, and can return inconsistent results
+// (including 0) depending on timing and which CPU the thread runs on.
+// The walk below starts from the task's own PML4.
+static uint64_t futex_get_key_for_task(uint64_t uaddr, bool shared, task_t* task) {
+    uint64_t* pml4 = task ? task->pml4 : NULL;
+    if (shared && pml4) {
+        uint64_t* pte = mm_get_page_table_from_pml4(pml4, uaddr, false);
+        uint64_t pte_val = pte ? *pte : 0;
+        if ((pte_val & (PAGE_PRESENT | PAGE_SHARED)) == (PAGE_PRESENT | PAGE_SHARED)) {
+            return (pte_val & PTE_ADDR_MASK) | (uaddr & (PAGE_SIZE - 1));
+        }
     }
+    // All CLONE_VM threads share the same task->pml4 pointer, so the
+    // kernel virtual address is a stable, unique per-process identifier.
+    return (uint64_t)pml4 ^ uaddr;
 }
 
-// Variant of futex_get_key that uses a specific task's PML4 instead of
-// sched_current().  Needed when performing futex operations on behalf of
-// a different task (e.g. sched_mark_task_exited called from a cross-CPU
-// SIGKILL sender where sched_current() is the sender, not the victim).
-static uint64_t futex_get_key_for_task(uint64_t uaddr, bool shared, task_t* task) {
-    if (shared) {
-        return mm_get_physical_address(uaddr);
-    } else {
-        uint64_t pml4_id = task && task->pml4 ?
-            (uint64_t)task->pml4 : 0;
-        return pml4_id ^ uaddr;
-    }
+static uint64_t futex_get_key(uint64_t uaddr, bool shared) {
+    return futex_get_key_for_task(uaddr, shared, sched_current());
 }
 
 // ============================================================================
@@ -233,7 +233,7 @@ void futex_init(void) {
     futex_initialized = true;
 }
 
-int futex_wait(uint64_t uaddr, uint32_t expected_val, uint64_t timeout_ns) {
+int futex_wait(uint64_t uaddr, uint32_t expected_val, uint64_t timeout_ns, bool shared) {
     if (!validate_user_ptr(uaddr, sizeof(uint32_t))) {
         return -EFAULT;
     }
@@ -254,7 +254,7 @@ int futex_wait(uint64_t uaddr, uint32_t expected_val, uint64_t timeout_ns) {
     }
     
     // Compute hash key and bucket
-    uint64_t key = futex_get_key(uaddr, false);  // Private futex
+    uint64_t key = futex_get_key(uaddr, shared);
     uint32_t bucket_idx = futex_hash_fn(key);
     futex_bucket_t* bucket = &futex_hash[bucket_idx];
     
@@ -343,10 +343,10 @@ int futex_wait(uint64_t uaddr, uint32_t expected_val, uint64_t timeout_ns) {
     return was_woken ? 0 : -ETIMEDOUT;
 }
 
-int futex_wake(uint64_t uaddr, int nr_wake) {
+int futex_wake(uint64_t uaddr, int nr_wake, bool shared) {
     if (nr_wake <= 0) return 0;
     
-    uint64_t key = futex_get_key(uaddr, false);
+    uint64_t key = futex_get_key(uaddr, shared);
     uint32_t bucket_idx = futex_hash_fn(key);
     futex_bucket_t* bucket = &futex_hash[bucket_idx];
     
@@ -464,11 +464,11 @@ int futex_wake_for_task(uint64_t uaddr, int nr_wake, task_t* on_behalf_of) {
     return woken;
 }
 
-int futex_requeue(uint64_t uaddr, uint64_t uaddr2, int nr_wake, int nr_requeue) {
+int futex_requeue(uint64_t uaddr, uint64_t uaddr2, int nr_wake, int nr_requeue, bool shared) {
     if (nr_wake < 0 || nr_requeue < 0) return -EINVAL;
     
-    uint64_t key1 = futex_get_key(uaddr, false);
-    uint64_t key2 = futex_get_key(uaddr2, false);
+    uint64_t key1 = futex_get_key(uaddr, shared);
+    uint64_t key2 = futex_get_key(uaddr2, shared);
     uint32_t bucket_idx1 = futex_hash_fn(key1);
     uint32_t bucket_idx2 = futex_hash_fn(key2);
     
@@ -2,6 +2,7 @@
 // Global Descriptor Table setup with TSS support for 64-bit mode
 
 #include "../../include/kernel/interrupt.h"
+#include "../../include/kernel/percpu.h"
 
 // GDT structure
 struct gdt_entry {
@@ -25,6 +26,17 @@ static struct gdt_ptr gdt_pointer;
 // External function to load GDT
 extern void gdt_flush(uint64_t);
 
+// Load the GDT.  Reloading the data segments clears the GS base, which
+// already holds this CPU's per-CPU pointer (percpu_early_init), so put it
+// back before anything can take a lock.
+static void gdt_load(void) {
+    uint64_t flags = local_irq_save();
+    uint64_t gs_base = read_gs_base_msr();
+    gdt_flush((uint64_t)&gdt_pointer);
+    write_gs_base(gs_base);
+    local_irq_restore(flags);
+}
+
 // Set GDT entry
 static void gdt_set_gate(int num, uint64_t base, uint64_t limit, uint8_t access, uint8_t gran) {
     gdt[num].base_low = (base & 0xFFFF);
@@ -89,7 +101,7 @@ void gdt_init() {
     gdt_set_gate(7, 0, 0, 0, 0);
     
     // Load the GDT
-    gdt_flush((uint64_t)&gdt_pointer);
+    gdt_load();
     
     kprintf("GDT initialized\n");
 }
@@ -100,7 +112,7 @@ void gdt_install_tss_real(uint64_t tss_base, uint64_t tss_size) {
     gdt_set_tss(5, tss_base, tss_size);
 
     // Reload GDT with TSS
-    gdt_flush((uint64_t)&gdt_pointer);
+    gdt_load();
 
     // Load TSS register
     __asm__ volatile ("ltr %0" : : "r" ((uint16_t)0x28)); // 5 * 8 = 0x28
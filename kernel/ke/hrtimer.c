@@ -0,0 +1,166 @@
+// LikeOS-64 - High-Resolution Timers
+//
+// A single timer base: one tree of armed timers under one spinlock.  The
+// earliest expiry is mirrored in next_expiry so the tick path can skip the
+// lock when nothing is due.  One CPU at a time expires timers; a CPU that
+// finds another one already doing so leaves the queue to it.  The callback
+// in progress is recorded in `running` so cancellation can tell a timer
+// that is about to be requeued from one that is idle.
+
+#include "../../include/kernel/hrtimer.h"
+#include "../../include/kernel/spinlock.h"
+#include "../../include/kernel/sched.h"
+
+static struct {
+    spinlock_t lock;
+    struct rb_root_cached active;
+    hrtimer_t* running;         // Callback in progress, NULL = none
+    uint64_t next_expiry;       // Earliest armed expiry, KTIME_MAX = none
+} g_hrtimer_base = {
+    .lock = SPINLOCK_INIT("hrtimer"),
+    .active = RB_ROOT_CACHED,
+    .running = NULL,
+    .next_expiry = KTIME_MAX,
+};
+
+// Called with the base lock held
+static void hrtimer_update_next(void) {
+    struct rb_node* first = rb_first_cached(&g_hrtimer_base.active);
+    uint64_t next = first ? rb_entry(first, hrtimer_t, node)->expires : KTIME_MAX;
+    __atomic_store_n(&g_hrtimer_base.next_expiry, next, __ATOMIC_RELEASE);
+}
+
+// Called with the base lock held
+static void hrtimer_enqueue(hrtimer_t* timer) {
+    struct rb_node** link = &g_hrtimer_base.active.rb_root.rb_node;
+    struct rb_node* parent = NULL;
+    bool leftmost = true;
+
+    while (*link) {
+        parent = *link;
+        if (timer->expires < rb_entry(parent, hrtimer_t, node)->expires) {
+            link = &parent->rb_left;
+        } else {
+            link = &parent->rb_right;
+            leftmost = false;
+        }
+    }
+    rb_link_node(&timer->node, parent, link);
+    rb_insert_color_cached(&timer->node, &g_hrtimer_base.active, leftmost);
+    timer->queued = 1;
+    hrtimer_update_next();
+}
+
+// Called with the base lock held
+static void hrtimer_dequeue(hrtimer_t* timer) {
+    rb_erase_cached(&timer->node, &g_hrtimer_base.active);
+    timer->queued = 0;
+    hrtimer_update_next();
+}
+
+void hrtimer_init(hrtimer_t* timer, hrtimer_func_t function) {
+    timer->node.rb_parent = NULL;
+    timer->node.rb_left = NULL;
+    timer->node.rb_right = NULL;
+    timer->expires = 0;
+    timer->function = function;
+    timer->queued = 0;
+}
+
+void hrtimer_start(hrtimer_t* timer, uint64_t expires) {
+    uint64_t flags;
+    spin_lock_irqsave(&g_hrtimer_base.lock, &flags);
+    if (timer->queued) {
+        hrtimer_dequeue(timer);
+    }
+    timer->expires = expires;
+    hrtimer_enqueue(timer);
+    spin_unlock_irqrestore(&g_hrtimer_base.lock, flags);
+}
+
+int hrtimer_try_to_cancel(hrtimer_t* timer) {
+    int ret = 0;
+    uint64_t flags;
+    spin_lock_irqsave(&g_hrtimer_base.lock, &flags);
+    if (g_hrtimer_base.running == timer) {
+        ret = -1;
+    } else if (timer->queued) {
+        hrtimer_dequeue(timer);
+        ret = 1;
+    }
+    spin_unlock_irqrestore(&g_hrtimer_base.lock, flags);
+    return ret;
+}
+
+int hrtimer_cancel(hrtimer_t* timer) {
+    for (;;) {
+        int ret = hrtimer_try_to_cancel(timer);
+        if (ret >= 0) {
+            return ret;
+        }
+        cpu_relax();
+    }
+}
+
+static hrtimer_restart_t hrtimer_wakeup(hrtimer_t* timer) {
+    hrtimer_sleeper_t* sl = container_of(timer, hrtimer_sleeper_t, timer);
+    task_t* task = sl->task;
+    __atomic_store_n(&sl->task, NULL, __ATOMIC_RELEASE);
+    if (task) {
+        sched_wake_task(task);
+    }
+    return HRTIMER_NORESTART;
+}
+
+void hrtimer_init_sleeper(hrtimer_sleeper_t* sl, struct task* task) {
+    hrtimer_init(&sl->timer, hrtimer_wakeup);
+    sl->task = task;
+}
+
+uint64_t hrtimer_forward(hrtimer_t* timer, uint64_t now, uint64_t interval) {
+    if (now < timer->expires || interval == 0) {
+        return 0;
+    }
+    uint64_t overruns = (now - timer->expires) / interval + 1;
+    timer->expires += overruns * interval;
+    return overruns;
+}
+
+void hrtimer_run_queues(void) {
+    uint64_t now = ktime_get_ns();
+    if (now < __atomic_load_n(&g_hrtimer_base.next_expiry, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    uint64_t flags;
+    spin_lock_irqsave(&g_hrtimer_base.lock, &flags);
+    if (g_hrtimer_base.running) {
+        // Another CPU is expiring timers and will get to these
+        spin_unlock_irqrestore(&g_hrtimer_base.lock, flags);
+        return;
+    }
+
+    for (;;) {
+        struct rb_node* first = rb_first_cached(&g_hrtimer_base.active);
+        if (!first) {
+            break;
+        }
+        hrtimer_t* timer = rb_entry(first, hrtimer_t, node);
+        if (timer->expires > now) {
+            break;
+        }
+        hrtimer_dequeue(timer);
+        g_hrtimer_base.running = timer;
+        spin_unlock_irqrestore(&g_hrtimer_base.lock, flags);
+
+        hrtimer_restart_t restart = timer->function(timer);
+
+        spin_lock_irqsave(&g_hrtimer_base.lock, &flags);
+        // The callback, or another CPU meanwhile, may have re-armed it
+        if (restart == HRTIMER_RESTART && !timer->queued) {
+            hrtimer_enqueue(timer);
+        }
+        g_hrtimer_base.running = NULL;
+    }
+    spin_unlock_irqrestore(&g_hrtimer_base.lock, flags);
+}
@@ -8,6 +8,9 @@
 #include "../../include/kernel/slab.h"
 #include "../../include/kernel/scrollbar.h"
 #include "../../include/kernel/fb_optimize.h"
+#include "../../include/kernel/fpu.h"
+#include "../../include/kernel/cpuidle.h"
+#include "../../include/kernel/rcu.h"
 #include "../../include/kernel/pci.h"
 #include "../../include/kernel/ps2.h"
 #include "../../include/kernel/ioapic.h"
@@ -21,10 +24,12 @@
 #include "../../include/kernel/acpi.h"
 #include "../../include/kernel/percpu.h"
 #include "../../include/kernel/smp.h"
+#include "../../include/kernel/topology.h"
 #include "../../include/kernel/lapic.h"
 #include "../../include/kernel/usbhid.h"
 #include "../../include/kernel/usb_serial.h"
 #include "../../include/kernel/net.h"
+#include "../../include/kernel/workqueue.h"
 
 void system_startup(boot_info_t* boot_info);
 void kernel_main(boot_info_t* boot_info);
@@ -38,6 +43,7 @@ static uint64_t g_boot_epoch_saved;       // Saved boot epoch from UEFI GetTime
 
 void kernel_main(boot_info_t* boot_info) {
     g_boot_info = boot_info;
+    percpu_early_init();
     console_init((framebuffer_info_t*)&boot_info->fb_info);
     console_init_fb_optimization();
     system_startup(boot_info);
@@ -57,6 +63,9 @@ void system_startup(boot_info_t* boot_info) {
 
     interrupts_init();
 
+    // Enable XSAVE and the AVX state components before any task exists
+    fpu_init_boot();
+
     uint64_t memory_size = boot_info->mem_info.total_memory;
     if (memory_size < 256 * 1024 * 1024) {
         memory_size = 256 * 1024 * 1024;
@@ -132,6 +141,7 @@ void continue_system_startup(void) {
     // device nodes.
     acpi_init(g_rsdp_address);
     acpi_pm_init();
+    cpuidle_init();        // MWAIT hints come from ACPI _CST
     timer_init_hpet();     // Prefer HPET for precise wall-clock timing if available
     timer_init_pmtimer();  // Probe ACPI PM Timer for sub-tick interpolation
 
@@ -165,14 +175,22 @@ void continue_system_startup(void) {
 
     // Initialize SMP support
     percpu_init();
+    rcu_init();            // Read-side sections use %gs from here on
     smp_init(g_smp_trampoline_address);
 
     // Boot Application Processors (APs)
     smp_boot_aps();
     kprintf("SMP: %u CPU(s) online\n", smp_get_cpu_count());
 
+    // Group online CPUs into scheduling domains for the load balancer
+    topology_build_domains();
+
     timer_set_boot_epoch(g_boot_epoch_saved);
 
+    // Worker pools for deferred process-context work (page-cache
+    // writeback, TCP frees, DHCP lease timers, USB hot-plug polling)
+    workqueue_init();
+
     // Spawn one ksoftirqd kernel thread per CPU before enabling interrupts.
     // These threads sleep until softirq_raise() bumps a pending vector for
     // their CPU; the IRQ-tail drain handles the common case but ksoftirqd
@@ -182,6 +200,10 @@ void continue_system_startup(void) {
         ksoftirqd_start_all();
     }
 
+#ifdef RCU_TORTURE
+    rcu_torture_start();
+#endif
+
     // Enable interrupts (SCI stays masked — no EC event storm).
     __asm__ volatile ("sti");
 
@@ -223,13 +245,12 @@ void continue_system_startup(void) {
     shell_init();
     storage_fs_set_ready(&g_storage_state);
     keyboard_activate();
+    xhci_hotplug_start();
 
     while (1) {
         __asm__ volatile ("sti");
         int handled_input = shell_tick();
         xhci_boot_poll(&g_xhci_boot);
-        xhci_hotplug_poll(&g_xhci);
-        xhci_hotplug_poll(&g_xhci_hid);
         usbhid_poll();
         storage_fs_poll(&g_storage_state);
         console_cursor_update();  // Update blinking cursor
@@ -12,6 +12,9 @@
 #include "../../include/kernel/net.h"
 #include "../../include/kernel/e1000.h"
 #include "../../include/kernel/softirq.h"
+#include "../../include/kernel/cputime.h"
+#include "../../include/kernel/rseq.h"
+#include "../../include/kernel/uaccess.h"
 
 #define PS2_STATUS_PORT         0x64
 #define PS2_STATUS_OUTPUT_FULL  0x01
@@ -174,9 +177,7 @@ void pic_send_eoi(uint8_t irq) {
             // potentially swallowing a keyboard or mouse IRQ.
             // Fix: read the PIC ISR and only ACK the PIC when the
             // corresponding IRQ bit is actually in-service.
-            // Note: before percpu_init(), GS base is 0 and this_cpu_id()
-            // would fault.  If GS is unset we are always the BSP (CPU 0).
-            uint32_t cpu = read_gs_base_msr() ? this_cpu_id() : 0;
+            uint32_t cpu = this_cpu_id();
             if (cpu == 0) {
                 if (irq < 8) {
                     uint8_t isr = pic_read_isr();
@@ -370,7 +371,7 @@ static const char* exception_messages[] = {
     "VMM Communication Exception", "Security Exception", "Reserved"
 };
 
-void exception_handler(uint64_t *regs) {
+static void exception_dispatch(uint64_t *regs) {
     uint64_t int_no = regs[15];
     uint64_t err_code = regs[16];
     uint64_t rip = regs[17];
@@ -389,10 +390,19 @@ void exception_handler(uint64_t *regs) {
             }
         }
         
-        // Handle page faults in kernel mode when accessing user memory
-        // (e.g., during syscall, copy_to_user, copy_from_user)
-        // If the faulting address is in user space and we have a user task context,
-        // kill the user process instead of panicking the kernel.
+        // A uaccess primitive hit a bad user page: resume at its fixup,
+        // which makes the access return -EFAULT
+        if (!user_mode && cr2 < 0x8000000000000000ULL) {
+            uint64_t fixup = search_exception_tables(rip);
+            if (fixup) {
+                regs[17] = fixup;
+                return;
+            }
+        }
+
+        // Any other kernel access to a bad user address (one not made
+        // through uaccess.h) kills the user process instead of panicking
+        // the kernel.
         if (!user_mode && cr2 < 0x8000000000000000ULL) {
             task_t* cur = sched_current();
             if (cur && cur->privilege == TASK_USER) {
@@ -406,6 +416,16 @@ void exception_handler(uint64_t *regs) {
         }
     }
 
+    // A non-canonical pointer handed to a uaccess primitive raises #GP
+    // rather than #PF
+    if (!user_mode && int_no == 13) {
+        uint64_t fixup = search_exception_tables(rip);
+        if (fixup) {
+            regs[17] = fixup;
+            return;
+        }
+    }
+
     if (user_mode) {
         task_t* cur = sched_current();
         switch (int_no) {
@@ -492,6 +512,27 @@ void exception_handler(uint64_t *regs) {
     }
 }
 
+// Last step before iretq to user mode: abort a restartable sequence the
+// task was preempted in and refresh its rseq cpu_id (see rseq.h)
+static void irq_return_to_user(interrupt_frame_t* frame) {
+    if ((frame->cs & 3) == 3) {
+        rseq_notify_resume(sched_current(), &frame->rip);
+    }
+}
+
+// A fault taken in user mode is kernel time spent on the task's behalf.
+// Kernel-mode faults (uaccess, IRQ context) stay in the current context.
+void exception_handler(uint64_t *regs) {
+    if ((regs[18] & 0x3) != 0x3) {
+        exception_dispatch(regs);
+        return;
+    }
+    cputime_switch(CPUTIME_SYS);
+    exception_dispatch(regs);
+    cputime_switch(CPUTIME_USER);
+    irq_return_to_user((interrupt_frame_t*)regs);
+}
+
 volatile uint64_t g_irq0_count = 0;
 volatile uint64_t g_irq1_count = 0;
 volatile uint64_t g_irq12_count = 0;
@@ -509,7 +550,7 @@ static inline uint8_t pic2_read_isr(void) {
     return inb(PIC2_CMD);
 }
 
-void irq_handler(uint64_t *regs) {
+static void irq_dispatch(uint64_t *regs) {
     uint64_t int_no = regs[15];
     uint8_t irq = (uint8_t)(int_no - 32);
     
@@ -781,11 +822,26 @@ void irq_handler(uint64_t *regs) {
     softirq_drain();
 }
 
+void irq_handler(uint64_t *regs) {
+    int ctx = cputime_switch(CPUTIME_IRQ);
+    irq_dispatch(regs);
+    cputime_switch(ctx);
+
+    // A device interrupt may have woken a task that outranks the current
+    // one (e.g. an RT input worker woken by its HID IRQ).  Switch now on
+    // return from the interrupt instead of waiting for the next tick.
+    if (sched_need_resched()) {
+        sched_preempt((interrupt_frame_t*)regs);
+    }
+
+    irq_return_to_user((interrupt_frame_t*)regs);
+}
+
 // ============================================================================
 // IPI Handler (called from ipi_common_stub in assembly)
 // ============================================================================
 
-void ipi_handler(uint64_t *regs) {
+static void ipi_dispatch(uint64_t *regs) {
     uint64_t vector = regs[15];  // Vector number pushed by IPI stub
 
     switch (vector) {
@@ -841,6 +897,13 @@ void ipi_handler(uint64_t *regs) {
     }
 }
 
+void ipi_handler(uint64_t *regs) {
+    int ctx = cputime_switch(CPUTIME_IRQ);
+    ipi_dispatch(regs);
+    cputime_switch(ctx);
+    irq_return_to_user((interrupt_frame_t*)regs);
+}
+
 void interrupts_init() {
     extern void gdt_init();
     gdt_init();
@@ -0,0 +1,924 @@
+// LikeOS-64 - Submission/Completion Rings (io_uring)
+//
+// See include/kernel/io_uring.h for the model.  A ring is an io_ring_ctx
+// whose embedded vfs_file_t sits in the fd table, so dup, fork and close
+// need nothing new.  The ring memory is two runs of physically contiguous
+// pages: one holds the SQ and CQ headers, the CQE array and the SQ index
+// array, the other the SQEs.  The kernel works on them through the direct
+// map, which is valid from any task and from workers; user space reaches
+// them by mmap()ing the ring fd, which takes a page reference per mapping.
+//
+// Each SQE is copied into an io_kiocb when it is consumed.  Issuing a
+// request runs the matching syscall through syscall_dispatch() in the
+// submitter's context, but only once fd_poll_one() says it will not block;
+// until then the request waits on the ring's pending list.  Parking a
+// request also hooks it onto its fd's wait queues through a poll table, as
+// select() and poll() do, and a wakeup there wakes the ring's waiters to
+// retry it.  Like poll()'s, the hooks last only until the io_uring_enter()
+// that made them returns, so the fd need not outlive the call.  Requests
+// remember the address space they were submitted from and only a task in
+// that address space issues them, since their buffers and fds are only
+// meaningful there.
+//
+// Locking: uring_lock (a sleeping lock, as issuing may block on disk I/O)
+// serialises submission, the pending list and the requests' hooks.
+// completion_lock covers the CQ tail, the armed timeouts, the reap list and
+// poll_woken, and is the only lock a timeout worker or a hook's wake
+// function takes.
+//
+// A TIMEOUT arms a delayed work item.  Whichever of the worker and a
+// count-based completion disarms it first completes it; a request the
+// worker completed is handed back on the reap list so its owner can start
+// the rest of its link chain and free it.
+
+#include "../../include/kernel/io_uring.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/spinlock.h"
+#include "../../include/kernel/rwsem.h"
+#include "../../include/kernel/workqueue.h"
+#include "../../include/kernel/timer.h"
+#include "../../include/kernel/signal.h"
+#include "../../include/kernel/wait.h"
+#include "../../include/kernel/poll.h"
+#include "../../include/kernel/net.h"
+#include "../../include/kernel/syscall.h"
+#include "../../include/kernel/uaccess.h"
+
+// Shared ring header.  SQ and CQ fields sit on separate cache lines since
+// the kernel writes one side and user space the other.
+typedef struct io_rings {
+    uint32_t sq_head;               // Next SQ index the kernel consumes
+    uint32_t sq_tail;               // Written by user space
+    uint32_t sq_ring_mask;
+    uint32_t sq_ring_entries;
+    uint32_t sq_flags;
+    uint32_t sq_dropped;            // SQ entries with an invalid SQE index
+    uint32_t pad0[10];
+    uint32_t cq_head;               // Written by user space
+    uint32_t cq_tail;               // Next CQE slot the kernel fills
+    uint32_t cq_ring_mask;
+    uint32_t cq_ring_entries;
+    uint32_t cq_overflow;           // Completions lost to a full CQ
+    uint32_t cq_flags;
+    uint32_t pad1[10];
+    struct io_uring_cqe cqes[];     // Followed by the SQ index array
+} io_rings_t;
+
+// io_kiocb_t::state
+#define IO_REQ_QUEUED   0           // Being issued or on the pending list
+#define IO_REQ_ARMED    1           // TIMEOUT waiting for its timer
+#define IO_REQ_DONE     2           // Completed; on the reap list or freed
+
+// io_issue() results
+#define IO_DONE         0           // req->res holds the result
+#define IO_PARKED       1           // Would block; retry later
+#define IO_ARMED        2           // TIMEOUT armed; the timer completes it
+
+#define IO_SQE_FLAGS    (IOSQE_IO_LINK | IOSQE_IO_HARDLINK | IOSQE_CQE_SKIP_SUCCESS)
+
+#define IO_POLL_MAX_WAIT    2       // Queues hooked per request; no source names more
+
+struct io_ring_ctx;
+
+typedef struct io_poll_wait {
+    wait_queue_entry_t entry;       // private = the request
+    wait_queue_head_t* whead;
+} io_poll_wait_t;
+
+typedef struct io_kiocb {
+    struct io_kiocb* next;          // Pending or reap list link
+    struct io_kiocb* link;          // Next request of its link chain
+    struct io_kiocb* tnext;         // Armed timeout list link
+    struct io_ring_ctx* ctx;
+    uint64_t* owner;                // Address space of the submitter
+    struct io_uring_sqe sqe;        // Copied at submission
+    int32_t res;
+    int state;                      // IO_REQ_*
+    int connecting;                 // CONNECT got EINPROGRESS, wait for POLLOUT
+    uint32_t timeout_seq;           // TIMEOUT with a count completes at this cq_seq
+    delayed_work_t timer;
+    task_t* poll_task;              // Task whose io_uring_enter() hooked poll[]
+    void* poll_file;                // fd pinned while poll[] is hooked
+    unsigned long poll_key;         // Events the hooks wake for
+    int npoll;                      // Hooked entries in poll[]
+    int poll_overflow;              // The fd named more than IO_POLL_MAX_WAIT
+    io_poll_wait_t poll[IO_POLL_MAX_WAIT];
+} io_kiocb_t;
+
+typedef struct io_poll_table {
+    poll_table_t pt;
+    io_kiocb_t* req;
+} io_poll_table_t;
+
+typedef struct io_ring_ctx {
+    vfs_file_t vfs;                 // Must be first: the fd table points here
+    rw_semaphore_t uring_lock;
+    spinlock_t completion_lock;
+    io_rings_t* rings;
+    uint32_t* sq_array;
+    struct io_uring_sqe* sqes;
+    uint64_t rings_phys;
+    uint64_t sqes_phys;
+    size_t rings_pages;
+    size_t sqes_pages;
+    uint32_t sq_entries;
+    uint32_t sq_mask;
+    uint32_t cq_entries;
+    uint32_t cq_mask;
+    uint32_t cached_sq_head;        // uring_lock
+    uint32_t cached_cq_tail;        // completion_lock
+    uint32_t cq_seq;                // Completions so far, overflowed ones too
+    int cq_waiters;                 // Tasks asleep in io_cqring_wait()
+    int poll_woken;                 // A parked request's fd may be ready
+    io_kiocb_t* pending;            // Parked requests, oldest first (uring_lock)
+    io_kiocb_t** pending_tail;
+    io_kiocb_t* timeouts;           // Armed TIMEOUTs (completion_lock)
+    io_kiocb_t* reap;               // Completed by a worker (completion_lock)
+} io_ring_ctx_t;
+
+static int io_uring_close(vfs_file_t* f);
+static int io_uring_mmap(vfs_file_t* f, unsigned long offset, unsigned long* phys);
+
+static const vfs_ops_t io_uring_ops = {
+    .close = io_uring_close,
+    .mmap = io_uring_mmap,
+};
+
+// SMAP-aware copy from user space (task context only)
+static int io_copy_from_user(void* dst, uint64_t src, size_t len) {
+    return copy_from_user(dst, (const void*)src, len);
+}
+
+static inline uint32_t io_cqring_events(io_ring_ctx_t* ctx) {
+    uint32_t head = __atomic_load_n(&ctx->rings->cq_head, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ctx->cached_cq_tail, __ATOMIC_ACQUIRE) - head;
+}
+
+// ============================================================================
+// Completion
+// ============================================================================
+
+// A failed request cancels the rest of its chain unless it was hard-linked
+static int io_req_failed(io_kiocb_t* req) {
+    if (req->res >= 0) return 0;
+    if (req->sqe.opcode == IORING_OP_TIMEOUT && req->res == -ETIME &&
+        (req->sqe.op_flags & IORING_TIMEOUT_ETIME_SUCCESS)) {
+        return 0;
+    }
+    return 1;
+}
+
+// Write one CQE.  Called with completion_lock held.
+static void io_fill_cqe(io_ring_ctx_t* ctx, uint64_t user_data, int32_t res) {
+    io_rings_t* r = ctx->rings;
+    uint32_t tail = ctx->cached_cq_tail;
+
+    ctx->cq_seq++;
+    if (tail - __atomic_load_n(&r->cq_head, __ATOMIC_ACQUIRE) >= ctx->cq_entries) {
+        __atomic_store_n(&r->cq_overflow, r->cq_overflow + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    struct io_uring_cqe* cqe = &r->cqes[tail & ctx->cq_mask];
+    cqe->user_data = user_data;
+    cqe->res = res;
+    cqe->flags = 0;
+    __atomic_store_n(&ctx->cached_cq_tail, tail + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->cq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Post a finished timeout's CQE and hand it to the reap list.  Called with
+// completion_lock held, after the timeout is off ctx->timeouts.
+static void io_timeout_done(io_ring_ctx_t* ctx, io_kiocb_t* req) {
+    req->state = IO_REQ_DONE;
+    if (io_req_failed(req) || !(req->sqe.flags & IOSQE_CQE_SKIP_SUCCESS)) {
+        io_fill_cqe(ctx, req->sqe.user_data, req->res);
+    }
+    req->next = ctx->reap;
+    ctx->reap = req;
+}
+
+// Complete TIMEOUTs whose completion count has been reached.  One whose
+// timer already fired is left to its worker.  Called with completion_lock.
+static void io_flush_timeouts(io_ring_ctx_t* ctx) {
+    io_kiocb_t** pp = &ctx->timeouts;
+    while (*pp) {
+        io_kiocb_t* req = *pp;
+        if (req->sqe.off && (int32_t)(ctx->cq_seq - req->timeout_seq) >= 0 &&
+            cancel_delayed_work(&req->timer)) {
+            *pp = req->tnext;
+            req->res = 0;
+            io_timeout_done(ctx, req);
+            continue;
+        }
+        pp = &req->tnext;
+    }
+}
+
+static void io_post_cqe(io_ring_ctx_t* ctx, uint64_t user_data, int32_t res) {
+    uint64_t flags;
+    spin_lock_irqsave(&ctx->completion_lock, &flags);
+    io_fill_cqe(ctx, user_data, res);
+    if (ctx->timeouts) {
+        io_flush_timeouts(ctx);
+    }
+    int waiters = ctx->cq_waiters;
+    spin_unlock_irqrestore(&ctx->completion_lock, flags);
+    if (waiters) {
+        sched_wake_channel(ctx);
+    }
+}
+
+static void io_free_chain(io_kiocb_t* req) {
+    while (req) {
+        io_kiocb_t* link = req->link;
+        kfree(req);
+        req = link;
+    }
+}
+
+// Free a completed request and return the next one of its chain to issue,
+// or NULL.  A failure cancels the rest of the chain.
+static io_kiocb_t* io_req_finish(io_ring_ctx_t* ctx, io_kiocb_t* req) {
+    io_kiocb_t* link = req->link;
+    int failed = io_req_failed(req) && !(req->sqe.flags & IOSQE_IO_HARDLINK);
+    kfree(req);
+
+    if (link && failed) {
+        for (io_kiocb_t* r = link; r; r = r->link) {
+            io_post_cqe(ctx, r->sqe.user_data, -ECANCELED);
+        }
+        io_free_chain(link);
+        return NULL;
+    }
+    return link;
+}
+
+static io_kiocb_t* io_req_complete(io_ring_ctx_t* ctx, io_kiocb_t* req) {
+    if (io_req_failed(req) || !(req->sqe.flags & IOSQE_CQE_SKIP_SUCCESS)) {
+        io_post_cqe(ctx, req->sqe.user_data, req->res);
+    }
+    return io_req_finish(ctx, req);
+}
+
+// ============================================================================
+// Timeouts
+// ============================================================================
+
+static void io_timeout_fn(work_t* work) {
+    io_kiocb_t* req = container_of(to_delayed_work(work), io_kiocb_t, timer);
+    io_ring_ctx_t* ctx = req->ctx;
+
+    uint64_t flags;
+    spin_lock_irqsave(&ctx->completion_lock, &flags);
+    if (req->state != IO_REQ_ARMED) {
+        // Completed by count or cancelled by close; neither frees it
+        // before this function returns
+        spin_unlock_irqrestore(&ctx->completion_lock, flags);
+        return;
+    }
+    for (io_kiocb_t** pp = &ctx->timeouts; *pp; pp = &(*pp)->tnext) {
+        if (*pp == req) {
+            *pp = req->tnext;
+            break;
+        }
+    }
+    req->res = -ETIME;
+    io_timeout_done(ctx, req);
+    int waiters = ctx->cq_waiters;
+    spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+    // req may be freed by its owner from here on
+    if (waiters) {
+        sched_wake_channel(ctx);
+    }
+}
+
+static int io_timeout_arm(io_ring_ctx_t* ctx, io_kiocb_t* req) {
+    struct io_uring_sqe* s = &req->sqe;
+    struct k_timespec ts;
+
+    if (s->len != 1 || (s->op_flags & ~IORING_TIMEOUT_ETIME_SUCCESS)) {
+        req->res = -EINVAL;
+        return IO_DONE;
+    }
+    if (io_copy_from_user(&ts, s->addr, sizeof(ts)) != 0) {
+        req->res = -EFAULT;
+        return IO_DONE;
+    }
+    if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000LL) {
+        req->res = -EINVAL;
+        return IO_DONE;
+    }
+
+    uint32_t freq = timer_get_frequency();
+    uint64_t ticks = (uint64_t)ts.tv_sec * freq + (uint64_t)ts.tv_nsec * freq / 1000000000ULL;
+    if (ticks == 0 && (ts.tv_sec > 0 || ts.tv_nsec > 0)) {
+        ticks = 1;
+    }
+
+    delayed_work_init(&req->timer, io_timeout_fn);
+    uint64_t flags;
+    spin_lock_irqsave(&ctx->completion_lock, &flags);
+    req->timeout_seq = ctx->cq_seq + (uint32_t)s->off;
+    req->state = IO_REQ_ARMED;
+    req->tnext = ctx->timeouts;
+    ctx->timeouts = req;
+    queue_delayed_work(system_wq, &req->timer, ticks);
+    spin_unlock_irqrestore(&ctx->completion_lock, flags);
+    return IO_ARMED;
+}
+
+// ============================================================================
+// Parked request hooks
+// ============================================================================
+
+// Events that may let a parked request make progress
+static short io_poll_events(const io_kiocb_t* req) {
+    switch (req->sqe.opcode) {
+    case IORING_OP_POLL_ADD:
+        return (short)(req->sqe.op_flags & 0xFFFF);
+    case IORING_OP_WRITE:
+    case IORING_OP_WRITEV:
+    case IORING_OP_SEND:
+    case IORING_OP_CONNECT:
+        return POLLOUT;
+    default:
+        return POLLIN;
+    }
+}
+
+// Wakeup keys that matter for `events`, as for poll()
+static unsigned long io_poll_key(short events) {
+    unsigned long key = (unsigned short)events | POLLERR | POLLHUP;
+    if (key & (POLLIN | POLLRDNORM))
+        key |= POLLIN | POLLRDNORM;
+    if (key & (POLLOUT | POLLWRNORM))
+        key |= POLLOUT | POLLWRNORM;
+    return key;
+}
+
+// Mark the ring woken and wake the tasks in io_cqring_wait().  Returns the
+// number of waiters there were.
+static int io_poll_kick(io_ring_ctx_t* ctx) {
+    uint64_t flags;
+    spin_lock_irqsave(&ctx->completion_lock, &flags);
+    ctx->poll_woken = 1;
+    int waiters = ctx->cq_waiters;
+    spin_unlock_irqrestore(&ctx->completion_lock, flags);
+    if (waiters) {
+        sched_wake_channel(ctx);
+    }
+    return waiters;
+}
+
+// Wake function of a parked request's hooks; runs under the source's
+// queue lock
+static int io_poll_wake(wait_queue_entry_t* entry, unsigned long key) {
+    io_kiocb_t* req = (io_kiocb_t*)entry->private;
+    if (key && !(key & req->poll_key)) {
+        return 0;
+    }
+    return io_poll_kick(req->ctx) != 0;
+}
+
+static void io_poll_queue_proc(wait_queue_head_t* whead, poll_table_t* pt) {
+    io_kiocb_t* req = container_of(pt, io_poll_table_t, pt)->req;
+    if (req->npoll >= IO_POLL_MAX_WAIT) {
+        req->poll_overflow = 1;
+        return;
+    }
+    io_poll_wait_t* pw = &req->poll[req->npoll++];
+    init_wait_func_entry(&pw->entry, io_poll_wake, req);
+    pw->whead = whead;
+    add_wait_queue(whead, &pw->entry);
+}
+
+// Unhook a request.  Called with uring_lock held.
+static void io_poll_disarm(io_kiocb_t* req) {
+    // Taking each queue's lock also waits out a wake function running on it
+    for (int i = 0; i < req->npoll; i++) {
+        remove_wait_queue(req->poll[i].whead, &req->poll[i].entry);
+    }
+    req->npoll = 0;
+    req->poll_task = NULL;
+    // Only now may a close by another thread free the queues
+    fd_entry_put(req->poll_file);
+    req->poll_file = NULL;
+}
+
+// Hook a request that was just parked onto its fd's wait queues, pinning
+// the fd so that they outlive a close by a thread sharing the fd table.
+// Polling again through the table closes the window since io_issue()
+// looked, so readiness found here kicks the ring at once.  Called with
+// uring_lock held.
+static int io_poll_arm(io_ring_ctx_t* ctx, io_kiocb_t* req) {
+    void* file = fd_get(req->sqe.fd);
+    if (!file) {
+        return (fd_poll_one(req->sqe.fd, 0) & POLLNVAL) ? -EBADF : -ENOMEM;
+    }
+    short events = io_poll_events(req);
+    io_poll_table_t ipt;
+    init_poll_funcptr(&ipt.pt, io_poll_queue_proc);
+    ipt.req = req;
+    req->poll_task = sched_current();
+    req->poll_file = file;
+    req->poll_key = io_poll_key(events);
+    req->npoll = 0;
+    req->poll_overflow = 0;
+
+    short rev = fd_entry_poll(file, events, &ipt.pt);
+    if (req->poll_overflow) {
+        io_poll_disarm(req);
+        return -ENOMEM;
+    }
+    if (rev & (events | POLLERR | POLLHUP | POLLNVAL)) {
+        io_poll_kick(ctx);
+    }
+    return 0;
+}
+
+// Drop the hooks cur made before its io_uring_enter() returns.  Called
+// with uring_lock held.
+static void io_poll_disarm_task(io_ring_ctx_t* ctx, task_t* cur) {
+    for (io_kiocb_t* req = ctx->pending; req; req = req->next) {
+        if (req->poll_task == cur) {
+            io_poll_disarm(req);
+        }
+    }
+}
+
+// ============================================================================
+// Issue
+// ============================================================================
+
+// An offset goes through the pread family, so the file position is not
+// touched; pipes and sockets cannot seek and ignore it
+static int64_t io_rw(const struct io_uring_sqe* s, uint64_t nr, uint64_t pnr) {
+    if (s->off != (uint64_t)-1) {
+        int64_t ret = syscall_dispatch(pnr, s->fd, s->addr, s->len, s->off, 0, 0);
+        if (ret != -ESPIPE) {
+            return ret;
+        }
+    }
+    return syscall_dispatch(nr, s->fd, s->addr, s->len, 0, 0, 0);
+}
+
+// Anything set, errors and hangups included, means the call will not block
+static inline int io_fd_ready(int fd, short events) {
+    return fd_poll_one(fd, events) != 0;
+}
+
+static int io_issue(io_ring_ctx_t* ctx, io_kiocb_t* req) {
+    struct io_uring_sqe* s = &req->sqe;
+    int64_t ret;
+
+    if (s->flags & ~IO_SQE_FLAGS) {
+        req->res = -EINVAL;
+        return IO_DONE;
+    }
+
+    switch (s->opcode) {
+    case IORING_OP_NOP:
+        ret = 0;
+        break;
+    case IORING_OP_READ:
+    case IORING_OP_READV:
+        if (!io_fd_ready(s->fd, POLLIN)) return IO_PARKED;
+        ret = s->opcode == IORING_OP_READ ? io_rw(s, SYS_READ, SYS_PREAD64)
+                                          : io_rw(s, SYS_READV, SYS_PREADV);
+        break;
+    case IORING_OP_WRITE:
+    case IORING_OP_WRITEV:
+        if (!io_fd_ready(s->fd, POLLOUT)) return IO_PARKED;
+        ret = s->opcode == IORING_OP_WRITE ? io_rw(s, SYS_WRITE, SYS_PWRITE64)
+                                           : io_rw(s, SYS_WRITEV, SYS_PWRITEV);
+        break;
+    case IORING_OP_FSYNC:
+        ret = syscall_dispatch(SYS_FSYNC, s->fd, 0, 0, 0, 0, 0);
+        break;
+    case IORING_OP_POLL_ADD: {
+        short events = (short)(s->op_flags & 0xFFFF);
+        short rev = fd_poll_one(s->fd, events);
+        rev &= events | POLLERR | POLLHUP | POLLNVAL;
+        if (!rev) return IO_PARKED;
+        ret = (uint16_t)rev;
+        break;
+    }
+    case IORING_OP_TIMEOUT:
+        return io_timeout_arm(ctx, req);
+    case IORING_OP_ACCEPT:
+        if (!io_fd_ready(s->fd, POLLIN)) return IO_PARKED;
+        ret = syscall_dispatch(SYS_ACCEPT4, s->fd, s->addr, s->off, s->op_flags, 0, 0);
+        break;
+    case IORING_OP_CONNECT:
+        if (req->connecting) {
+            short rev = fd_poll_one(s->fd, POLLOUT);
+            if (!rev) return IO_PARKED;
+            ret = (rev & (POLLERR | POLLHUP)) ? -ECONNREFUSED : 0;
+            break;
+        }
+        ret = syscall_dispatch(SYS_CONNECT, s->fd, s->addr, s->off, 0, 0, 0);
+        if (ret == -EINPROGRESS) {
+            req->connecting = 1;
+            return IO_PARKED;
+        }
+        break;
+    case IORING_OP_SEND:
+        if (!io_fd_ready(s->fd, POLLOUT)) return IO_PARKED;
+        ret = syscall_dispatch(SYS_SENDTO, s->fd, s->addr, s->len, s->op_flags, 0, 0);
+        break;
+    case IORING_OP_RECV:
+        if (!io_fd_ready(s->fd, POLLIN)) return IO_PARKED;
+        ret = syscall_dispatch(SYS_RECVFROM, s->fd, s->addr, s->len, s->op_flags, 0, 0);
+        break;
+    default:
+        ret = -EINVAL;
+        break;
+    }
+
+    // Lost a race for the data (or a non-blocking fd): wait again
+    if (ret == -EAGAIN) return IO_PARKED;
+
+    req->res = (int32_t)ret;
+    return IO_DONE;
+}
+
+// Issue req and, as each completes, the rest of its chain.  Called with
+// uring_lock held.
+static void io_queue_req(io_ring_ctx_t* ctx, io_kiocb_t* req) {
+    while (req) {
+        req->state = IO_REQ_QUEUED;
+        int ret = io_issue(ctx, req);
+        if (ret == IO_ARMED) return;
+        if (ret == IO_PARKED) {
+            int err = io_poll_arm(ctx, req);
+            if (err < 0) {
+                req->res = err;
+                req = io_req_complete(ctx, req);
+                continue;
+            }
+            req->next = NULL;
+            *ctx->pending_tail = req;
+            ctx->pending_tail = &req->next;
+            return;
+        }
+        req = io_req_complete(ctx, req);
+    }
+}
+
+// Retry parked requests and continue chains a worker completed.  Called
+// with uring_lock held.
+static void io_run_deferred(io_ring_ctx_t* ctx, task_t* cur) {
+    uint64_t flags;
+    spin_lock_irqsave(&ctx->completion_lock, &flags);
+    io_kiocb_t* reap = ctx->reap;
+    ctx->reap = NULL;
+    spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+    while (reap) {
+        io_kiocb_t* req = reap;
+        reap = req->next;
+        if (req->link && req->owner != cur->pml4) {
+            spin_lock_irqsave(&ctx->completion_lock, &flags);
+            req->next = ctx->reap;
+            ctx->reap = req;
+            spin_unlock_irqrestore(&ctx->completion_lock, flags);
+            continue;
+        }
+        io_queue_req(ctx, io_req_finish(ctx, req));
+    }
+
+    io_kiocb_t* list = ctx->pending;
+    ctx->pending = NULL;
+    ctx->pending_tail = &ctx->pending;
+    while (list) {
+        io_kiocb_t* req = list;
+        list = req->next;
+        if (req->owner != cur->pml4) {
+            req->next = NULL;
+            *ctx->pending_tail = req;
+            ctx->pending_tail = &req->next;
+            continue;
+        }
+        io_poll_disarm(req);
+        io_queue_req(ctx, req);
+    }
+}
+
+// Nothing for this task on the reap list means its wait can sleep.
+// Called with completion_lock held.
+static int io_reap_ready(io_ring_ctx_t* ctx, task_t* cur) {
+    for (io_kiocb_t* req = ctx->reap; req; req = req->next) {
+        if (!req->link || req->owner == cur->pml4) return 1;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Submission and waiting
+// ============================================================================
+
+static int64_t io_submit_sqes(io_ring_ctx_t* ctx, uint32_t to_submit, task_t* cur) {
+    io_rings_t* r = ctx->rings;
+    uint32_t avail = __atomic_load_n(&r->sq_tail, __ATOMIC_ACQUIRE) - ctx->cached_sq_head;
+    if (avail > ctx->sq_entries) avail = ctx->sq_entries;
+    if (to_submit > avail) to_submit = avail;
+
+    io_kiocb_t* head = NULL;
+    io_kiocb_t* last = NULL;
+    uint32_t done = 0;
+    int64_t err = 0;
+
+    while (done < to_submit) {
+        io_kiocb_t* req = kalloc(sizeof(io_kiocb_t));
+        if (!req) {
+            err = -EAGAIN;
+            break;
+        }
+        uint32_t idx = __atomic_load_n(&ctx->sq_array[ctx->cached_sq_head & ctx->sq_mask],
+                                       __ATOMIC_RELAXED);
+        ctx->cached_sq_head++;
+        done++;
+        if (idx >= ctx->sq_entries) {
+            __atomic_store_n(&r->sq_dropped, r->sq_dropped + 1, __ATOMIC_RELAXED);
+            kfree(req);
+            continue;
+        }
+
+        mm_memset(req, 0, sizeof(io_kiocb_t));
+        mm_memcpy(&req->sqe, &ctx->sqes[idx], sizeof(req->sqe));
+        req->ctx = ctx;
+        req->owner = cur->pml4;
+
+        if (last) {
+            last->link = req;
+        } else {
+            head = req;
+        }
+        last = req;
+        if (!(req->sqe.flags & (IOSQE_IO_LINK | IOSQE_IO_HARDLINK))) {
+            io_queue_req(ctx, head);
+            head = last = NULL;
+        }
+    }
+    // A chain left open by the last SQE ends there
+    if (head) {
+        io_queue_req(ctx, head);
+    }
+
+    __atomic_store_n(&r->sq_head, ctx->cached_sq_head, __ATOMIC_RELEASE);
+    return done ? (int64_t)done : err;
+}
+
+// Sleep until min_complete CQEs are posted.  A completion, a timeout
+// worker's reap or a parked request's hook wakes the wait; parked
+// requests are retried after each wakeup and re-hooked if still blocked.
+static int io_cqring_wait(io_ring_ctx_t* ctx, uint32_t min_complete, task_t* cur) {
+    int ret;
+    for (;;) {
+        if (io_cqring_events(ctx) >= min_complete) {
+            ret = 0;
+            break;
+        }
+        if (signal_pending(cur)) {
+            ret = -EINTR;
+            break;
+        }
+
+        uint64_t flags;
+        spin_lock_irqsave(&ctx->completion_lock, &flags);
+        if (io_cqring_events(ctx) < min_complete && !io_reap_ready(ctx, cur) &&
+            !ctx->poll_woken) {
+            ctx->cq_waiters++;
+            cur->wait_channel = ctx;
+            cur->state = TASK_BLOCKED;
+            spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+            sched_schedule();
+            cur->wait_channel = NULL;
+            if (cur->state != TASK_RUNNING) cur->state = TASK_RUNNING;
+
+            spin_lock_irqsave(&ctx->completion_lock, &flags);
+            ctx->cq_waiters--;
+        }
+        // Everything parked is about to be retried
+        ctx->poll_woken = 0;
+        spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+        down_write(&ctx->uring_lock);
+        io_run_deferred(ctx, cur);
+        up_write(&ctx->uring_lock);
+    }
+
+    down_write(&ctx->uring_lock);
+    io_poll_disarm_task(ctx, cur);
+    up_write(&ctx->uring_lock);
+    return ret;
+}
+
+int64_t io_uring_enter(io_ring_ctx_t* ctx, uint32_t to_submit,
+                       uint32_t min_complete, uint32_t flags) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+    if (flags & ~IORING_ENTER_GETEVENTS) return -EINVAL;
+
+    int64_t submitted = 0;
+    down_write(&ctx->uring_lock);
+    if (to_submit) {
+        submitted = io_submit_sqes(ctx, to_submit, cur);
+    }
+    io_run_deferred(ctx, cur);
+    bool wait = submitted >= 0 && (flags & IORING_ENTER_GETEVENTS) && min_complete;
+    if (!wait) {
+        io_poll_disarm_task(ctx, cur);
+    }
+    up_write(&ctx->uring_lock);
+    if (submitted < 0) return submitted;
+
+    if (wait) {
+        if (min_complete > ctx->cq_entries) min_complete = ctx->cq_entries;
+        int ret = io_cqring_wait(ctx, min_complete, cur);
+        if (ret < 0 && !submitted) return ret;
+    }
+    return submitted;
+}
+
+// ============================================================================
+// Ring file
+// ============================================================================
+
+static int io_uring_mmap(vfs_file_t* f, unsigned long offset, unsigned long* phys) {
+    io_ring_ctx_t* ctx = (io_ring_ctx_t*)f;
+    uint64_t base = ctx->rings_phys;
+    size_t pages = ctx->rings_pages;
+
+    if (offset >= IORING_OFF_SQES) {
+        offset -= IORING_OFF_SQES;
+        base = ctx->sqes_phys;
+        pages = ctx->sqes_pages;
+    } else if (offset >= IORING_OFF_CQ_RING) {
+        offset -= IORING_OFF_CQ_RING;
+    }
+    if (offset / PAGE_SIZE >= pages) return -EINVAL;
+
+    *phys = base + (offset & ~(uint64_t)(PAGE_SIZE - 1));
+    mm_incref_page(*phys);
+    return 0;
+}
+
+// Drop the ring's reference on its pages; user mappings keep theirs
+static void io_free_pages(uint64_t phys, size_t pages) {
+    for (size_t i = 0; i < pages; i++) {
+        uint64_t p = phys + i * PAGE_SIZE;
+        if (mm_decref_page(p)) {
+            mm_free_physical_page(p);
+        }
+    }
+}
+
+static int io_uring_close(vfs_file_t* f) {
+    io_ring_ctx_t* ctx = (io_ring_ctx_t*)f;
+    uint64_t flags;
+
+    // Disarm the timeouts.  A worker that already took one sees it is no
+    // longer armed and returns; cancel_delayed_work_sync() waits for it.
+    for (;;) {
+        spin_lock_irqsave(&ctx->completion_lock, &flags);
+        io_kiocb_t* req = ctx->timeouts;
+        if (req) {
+            ctx->timeouts = req->tnext;
+            req->state = IO_REQ_DONE;
+        }
+        spin_unlock_irqrestore(&ctx->completion_lock, flags);
+        if (!req) break;
+        cancel_delayed_work_sync(&req->timer);
+        io_free_chain(req);
+    }
+
+    while (ctx->reap) {
+        io_kiocb_t* req = ctx->reap;
+        ctx->reap = req->next;
+        io_free_chain(req);
+    }
+    while (ctx->pending) {
+        io_kiocb_t* req = ctx->pending;
+        ctx->pending = req->next;
+        io_poll_disarm(req);
+        io_free_chain(req);
+    }
+
+    io_free_pages(ctx->rings_phys, ctx->rings_pages);
+    io_free_pages(ctx->sqes_phys, ctx->sqes_pages);
+    kfree(ctx);
+    return 0;
+}
+
+struct io_ring_ctx* io_uring_from_file(void* entry) {
+    // Markers stored in the fd table are small integers; rings live in
+    // the kernel half
+    if ((uintptr_t)entry < 0xFFFF800000000000ULL) return NULL;
+    vfs_file_t* f = (vfs_file_t*)entry;
+    return f->ops == &io_uring_ops ? (io_ring_ctx_t*)f : NULL;
+}
+
+static uint32_t io_roundup_pow2(uint32_t n) {
+    uint32_t v = 1;
+    while (v < n) v <<= 1;
+    return v;
+}
+
+// Allocate zeroed, reference-counted contiguous pages
+static uint64_t io_alloc_pages(size_t pages) {
+    uint64_t phys = mm_allocate_contiguous_pages(pages);
+    if (!phys) return 0;
+    mm_memset(phys_to_virt(phys), 0, pages * PAGE_SIZE);
+    for (size_t i = 0; i < pages; i++) {
+        mm_incref_page(phys + i * PAGE_SIZE);
+    }
+    return phys;
+}
+
+int io_uring_create(uint32_t entries, struct io_uring_params* p, vfs_file_t** out) {
+    if (p->flags & ~(IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP)) return -EINVAL;
+    if (entries == 0) return -EINVAL;
+    if (entries > IO_URING_MAX_ENTRIES) {
+        if (!(p->flags & IORING_SETUP_CLAMP)) return -EINVAL;
+        entries = IO_URING_MAX_ENTRIES;
+    }
+
+    uint32_t sq_entries = io_roundup_pow2(entries);
+    uint32_t cq_entries = 2 * sq_entries;
+    if (p->flags & IORING_SETUP_CQSIZE) {
+        uint32_t n = p->cq_entries;
+        if (n == 0) return -EINVAL;
+        if (n > 2 * IO_URING_MAX_ENTRIES) {
+            if (!(p->flags & IORING_SETUP_CLAMP)) return -EINVAL;
+            n = 2 * IO_URING_MAX_ENTRIES;
+        }
+        cq_entries = io_roundup_pow2(n);
+        if (cq_entries < sq_entries) return -EINVAL;
+    }
+
+    io_ring_ctx_t* ctx = kalloc(sizeof(io_ring_ctx_t));
+    if (!ctx) return -ENOMEM;
+    mm_memset(ctx, 0, sizeof(io_ring_ctx_t));
+
+    size_t cqes_off = sizeof(io_rings_t);
+    size_t array_off = cqes_off + cq_entries * sizeof(struct io_uring_cqe);
+    size_t rings_bytes = array_off + sq_entries * sizeof(uint32_t);
+    ctx->rings_pages = (rings_bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    ctx->sqes_pages = (sq_entries * sizeof(struct io_uring_sqe) + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    ctx->rings_phys = io_alloc_pages(ctx->rings_pages);
+    ctx->sqes_phys = ctx->rings_phys ? io_alloc_pages(ctx->sqes_pages) : 0;
+    if (!ctx->sqes_phys) {
+        if (ctx->rings_phys) io_free_pages(ctx->rings_phys, ctx->rings_pages);
+        kfree(ctx);
+        return -ENOMEM;
+    }
+
+    ctx->rings = (io_rings_t*)phys_to_virt(ctx->rings_phys);
+    ctx->sq_array = (uint32_t*)((uint8_t*)ctx->rings + array_off);
+    ctx->sqes = (struct io_uring_sqe*)phys_to_virt(ctx->sqes_phys);
+    ctx->sq_entries = sq_entries;
+    ctx->sq_mask = sq_entries - 1;
+    ctx->cq_entries = cq_entries;
+    ctx->cq_mask = cq_entries - 1;
+    ctx->pending_tail = &ctx->pending;
+    rwsem_init(&ctx->uring_lock, "io_uring");
+    spinlock_init(&ctx->completion_lock, "io_uring_cq");
+
+    ctx->rings->sq_ring_mask = ctx->sq_mask;
+    ctx->rings->sq_ring_entries = sq_entries;
+    ctx->rings->cq_ring_mask = ctx->cq_mask;
+    ctx->rings->cq_ring_entries = cq_entries;
+
+    ctx->vfs.ops = &io_uring_ops;
+    ctx->vfs.fs_private = ctx;
+    ctx->vfs.refcount = 1;
+    ctx->vfs.flags = O_RDWR | O_CLOEXEC;
+
+    p->sq_entries = sq_entries;
+    p->cq_entries = cq_entries;
+    p->features = IORING_FEAT_SINGLE_MMAP;
+    mm_memset(&p->sq_off, 0, sizeof(p->sq_off));
+    mm_memset(&p->cq_off, 0, sizeof(p->cq_off));
+    p->sq_off.head = __builtin_offsetof(io_rings_t, sq_head);
+    p->sq_off.tail = __builtin_offsetof(io_rings_t, sq_tail);
+    p->sq_off.ring_mask = __builtin_offsetof(io_rings_t, sq_ring_mask);
+    p->sq_off.ring_entries = __builtin_offsetof(io_rings_t, sq_ring_entries);
+    p->sq_off.flags = __builtin_offsetof(io_rings_t, sq_flags);
+    p->sq_off.dropped = __builtin_offsetof(io_rings_t, sq_dropped);
+    p->sq_off.array = (uint32_t)array_off;
+    p->cq_off.head = __builtin_offsetof(io_rings_t, cq_head);
+    p->cq_off.tail = __builtin_offsetof(io_rings_t, cq_tail);
+    p->cq_off.ring_mask = __builtin_offsetof(io_rings_t, cq_ring_mask);
+    p->cq_off.ring_entries = __builtin_offsetof(io_rings_t, cq_ring_entries);
+    p->cq_off.overflow = __builtin_offsetof(io_rings_t, cq_overflow);
+    p->cq_off.cqes = (uint32_t)cqes_off;
+    p->cq_off.flags = __builtin_offsetof(io_rings_t, cq_flags);
+
+    *out = &ctx->vfs;
+    return 0;
+}
@@ -0,0 +1,189 @@
+// LikeOS-64 - Lock Statistics
+//
+// With LOCKSTAT defined, spin_lock()/spin_unlock() call into here.  Each
+// lock caches a pointer to its class, found by name in an open-addressed
+// table on first acquisition.  Registration is lock-free (the table is
+// itself used from inside spinlock operations): a slot is claimed with a
+// CAS and published once its name is copied.
+//
+// Counters are updated with atomics on the class, so the accounting itself
+// adds contention; compare classes against each other, not against a
+// kernel built without LOCKSTAT.
+
+#include "../../include/kernel/lockstat.h"
+#include "../../include/kernel/spinlock.h"
+#include "../../include/kernel/syscall.h"
+#include "../../include/kernel/memory.h"
+
+#ifdef LOCKSTAT
+
+#define LOCKSTAT_MAX_CLASSES    512     // Power of two
+
+typedef struct lock_class {
+    volatile int state;                 // 0 free, 1 claimed, 2 ready
+    uint32_t hash;
+    char name[LOCKSTAT_NAME_LEN];
+    volatile uint64_t acquisitions;
+    volatile uint64_t contentions;
+    volatile uint64_t wait_total;
+    volatile uint64_t wait_max;
+    volatile uint64_t hold_total;
+    volatile uint64_t hold_max;
+} __attribute__((aligned(64))) lock_class_t;
+
+static lock_class_t g_lock_classes[LOCKSTAT_MAX_CLASSES];
+
+// Shared by every lock once the table is full
+static lock_class_t g_lock_class_overflow = { .state = 2, .name = "(overflow)" };
+
+static uint32_t lockstat_hash(const char* name) {
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (int i = 0; name[i] && i < LOCKSTAT_NAME_LEN - 1; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int lockstat_name_eq(const char* a, const char* b) {
+    for (int i = 0; i < LOCKSTAT_NAME_LEN - 1; i++) {
+        if (a[i] != b[i]) return 0;
+        if (!a[i]) return 1;
+    }
+    return 1;
+}
+
+static lock_class_t* lockstat_find_class(const char* name) {
+    if (!name) name = "(unnamed)";
+    uint32_t h = lockstat_hash(name);
+
+    for (uint32_t probe = 0; probe < LOCKSTAT_MAX_CLASSES; probe++) {
+        lock_class_t* c = &g_lock_classes[(h + probe) & (LOCKSTAT_MAX_CLASSES - 1)];
+        int state = __atomic_load_n(&c->state, __ATOMIC_ACQUIRE);
+
+        if (state == 0) {
+            int expected = 0;
+            if (__atomic_compare_exchange_n(&c->state, &expected, 1, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                int i = 0;
+                for (; name[i] && i < LOCKSTAT_NAME_LEN - 1; i++)
+                    c->name[i] = name[i];
+                c->name[i] = '\0';
+                c->hash = h;
+                __atomic_store_n(&c->state, 2, __ATOMIC_RELEASE);
+                return c;
+            }
+            state = expected;
+        }
+
+        // Another CPU is registering this slot; wait for its name
+        while (state == 1) {
+            cpu_relax();
+            state = __atomic_load_n(&c->state, __ATOMIC_ACQUIRE);
+        }
+        if (c->hash == h && lockstat_name_eq(c->name, name))
+            return c;
+    }
+    return &g_lock_class_overflow;
+}
+
+static inline void lockstat_max(volatile uint64_t* max, uint64_t v) {
+    uint64_t cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (v > cur &&
+           !__atomic_compare_exchange_n(max, &cur, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+void lockstat_acquired(spinlock_t* lock, uint64_t wait_start, int contended) {
+    uint64_t now = lockstat_clock();
+    lock_class_t* c = lock->lockstat_class;
+    if (!c) {
+        c = lockstat_find_class(lock->name);
+        lock->lockstat_class = c;
+    }
+
+    __atomic_add_fetch(&c->acquisitions, 1, __ATOMIC_RELAXED);
+    if (contended) {
+        uint64_t wait = now - wait_start;
+        __atomic_add_fetch(&c->contentions, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&c->wait_total, wait, __ATOMIC_RELAXED);
+        lockstat_max(&c->wait_max, wait);
+    }
+    lock->lockstat_hold_start = now;
+}
+
+void lockstat_released(spinlock_t* lock) {
+    lock_class_t* c = lock->lockstat_class;
+    uint64_t start = lock->lockstat_hold_start;
+    if (!c || !start)
+        return;     // Released without a tracked acquisition
+    lock->lockstat_hold_start = 0;
+
+    uint64_t hold = lockstat_clock() - start;
+    __atomic_add_fetch(&c->hold_total, hold, __ATOMIC_RELAXED);
+    lockstat_max(&c->hold_max, hold);
+}
+
+int lockstat_enabled(void) {
+    return 1;
+}
+
+int lockstat_get(int index, k_lockstat_entry_t* out) {
+    if (index < 0)
+        return 0;
+
+    // Walk the ready slots in table order, then the overflow class
+    int n = 0;
+    for (int i = 0; i <= LOCKSTAT_MAX_CLASSES; i++) {
+        lock_class_t* c = (i < LOCKSTAT_MAX_CLASSES) ? &g_lock_classes[i]
+                                                     : &g_lock_class_overflow;
+        if (__atomic_load_n(&c->state, __ATOMIC_ACQUIRE) != 2)
+            continue;
+        if (c == &g_lock_class_overflow && !c->acquisitions)
+            continue;
+        if (n++ != index)
+            continue;
+
+        mm_memcpy(out->name, c->name, LOCKSTAT_NAME_LEN);
+        out->acquisitions = c->acquisitions;
+        out->contentions = c->contentions;
+        out->wait_total = c->wait_total;
+        out->wait_max = c->wait_max;
+        out->hold_total = c->hold_total;
+        out->hold_max = c->hold_max;
+        return 1;
+    }
+    return 0;
+}
+
+int lockstat_reset(void) {
+    for (int i = 0; i <= LOCKSTAT_MAX_CLASSES; i++) {
+        lock_class_t* c = (i < LOCKSTAT_MAX_CLASSES) ? &g_lock_classes[i]
+                                                     : &g_lock_class_overflow;
+        c->acquisitions = 0;
+        c->contentions = 0;
+        c->wait_total = 0;
+        c->wait_max = 0;
+        c->hold_total = 0;
+        c->hold_max = 0;
+    }
+    return 0;
+}
+
+#else // !LOCKSTAT
+
+int lockstat_enabled(void) {
+    return 0;
+}
+
+int lockstat_get(int index, k_lockstat_entry_t* out) {
+    (void)index;
+    (void)out;
+    return -ENOSYS;
+}
+
+int lockstat_reset(void) {
+    return -ENOSYS;
+}
+
+#endif // LOCKSTAT
@@ -6,6 +6,7 @@
 #include "../../include/kernel/memory.h"
 #include "../../include/kernel/acpi.h"
 #include "../../include/kernel/smp.h"
+#include "../../include/kernel/cputime.h"
 
 // ============================================================================
 // Global Per-CPU Data
@@ -20,14 +21,30 @@ static volatile uint32_t g_cpus_online = 0;
 // BSP per-CPU data (statically allocated for bootstrap)
 static percpu_t g_bsp_percpu __attribute__((aligned(4096)));
 
+// AP per-CPU areas, allocated by the BSP before each AP is started
+static percpu_t* g_percpu_boot[MAX_CPUS] = {0};
+
 // ============================================================================
 // Per-CPU Initialization
 // ============================================================================
 
+// Point %gs at the BSP's area before anything takes a lock: every spinlock
+// updates the per-CPU preempt_count.  Only the fields used that early are
+// valid until percpu_init().
+void percpu_early_init(void) {
+    g_bsp_percpu.self = &g_bsp_percpu;
+    g_bsp_percpu.cpu_id = 0;
+    g_bsp_percpu.preempt_count = 0;
+    g_bsp_percpu.need_resched = 0;
+    write_gs_base((uint64_t)&g_bsp_percpu);
+}
+
 void percpu_init(void) {
     smp_dbg("PERCPU: Initializing per-CPU infrastructure\n");
     
-    // Initialize BSP's per-CPU data
+    // Initialize BSP's per-CPU data.  No lock is held here, but an
+    // interrupt handler could take one while the count is being cleared.
+    uint64_t irq_flags = local_irq_save();
     mm_memset(&g_bsp_percpu, 0, sizeof(percpu_t));
     g_bsp_percpu.self = &g_bsp_percpu;
     g_bsp_percpu.cpu_id = 0;
@@ -37,19 +54,41 @@ void percpu_init(void) {
     g_bsp_percpu.preempt_count = 0;
     g_bsp_percpu.interrupt_nesting = 0;
     g_bsp_percpu.need_resched = 0;
-    g_bsp_percpu.runqueue_head = NULL;
-    g_bsp_percpu.runqueue_tail = NULL;
+    g_bsp_percpu.cfs_tasks = RB_ROOT_CACHED;
+    g_bsp_percpu.cfs_min_vruntime = 0;
+    g_bsp_percpu.cfs_load_weight = 0;
+    g_bsp_percpu.rt_nr_running = 0;
+    g_bsp_percpu.curr_prio = 0;        // Bootstrap task is a fair-class task
+    g_bsp_percpu.rt_time = 0;
+    g_bsp_percpu.rt_period_start = 0;
+    g_bsp_percpu.rt_throttled = 0;
+    g_bsp_percpu.load_avg = 0;
     g_bsp_percpu.runqueue_length = 0;
     spinlock_init(&g_bsp_percpu.runqueue_lock, "cpu0_runqueue");
     g_bsp_percpu.context_switches = 0;
     g_bsp_percpu.interrupts = 0;
     g_bsp_percpu.timer_ticks = 0;
+    g_bsp_percpu.sched_run_delay = 0;
+    g_bsp_percpu.sched_pcount = 0;
+    g_bsp_percpu.sched_migrations = 0;
+    for (int i = 0; i < SCHED_LAT_BUCKETS; i++) g_bsp_percpu.sched_wakeup_hist[i] = 0;
+    g_bsp_percpu.cputime_stamp = 0;
+    g_bsp_percpu.irq_time_tsc = 0;
+    g_bsp_percpu.cputime_ctx = CPUTIME_SYS;
+    g_bsp_percpu.fpu_owner = NULL;
+    g_bsp_percpu.fpu_saved_task = NULL;
+    g_bsp_percpu.fpu_depth = 0;
+    g_bsp_percpu.idle_polling = 0;
+    g_bsp_percpu.idle_state = -1;
+    g_bsp_percpu.idle_enter_ns = 0;
+    g_bsp_percpu.rcu_nesting = 0;
     
     g_percpu_ptrs[0] = &g_bsp_percpu;
     g_cpus_online = 1;
     
     // Set GS base to point to BSP's per-CPU data
     write_gs_base((uint64_t)&g_bsp_percpu);
+    local_irq_restore(irq_flags);
     
     smp_dbg("PERCPU: BSP per-CPU data at 0x%lx\n", (uint64_t)&g_bsp_percpu);
 }
@@ -61,12 +100,13 @@ void percpu_init_cpu(uint32_t cpu_id, uint32_t apic_id) {
         // BSP - already initialized
         percpu = &g_bsp_percpu;
     } else {
-        // AP - allocate new per-CPU data
-        percpu = percpu_alloc(cpu_id);
+        // AP - use the area percpu_prepare_ap() set aside; nothing here may
+        // take a lock until %gs points at it
+        percpu = cpu_id < MAX_CPUS ? g_percpu_boot[cpu_id] : NULL;
         if (!percpu) {
-            kprintf("PERCPU: Failed to allocate per-CPU data for CPU %u\n", cpu_id);
-            return;
+            for (;;) __asm__ volatile("cli; hlt");
         }
+        write_gs_base((uint64_t)percpu);
     }
     
     // Initialize per-CPU fields
@@ -78,9 +118,23 @@ void percpu_init_cpu(uint32_t cpu_id, uint32_t apic_id) {
     percpu->preempt_count = 0;
     percpu->interrupt_nesting = 0;
     percpu->need_resched = 0;
-    percpu->runqueue_head = NULL;
-    percpu->runqueue_tail = NULL;
+    percpu->cfs_tasks = RB_ROOT_CACHED;
+    percpu->cfs_min_vruntime = 0;
+    percpu->cfs_load_weight = 0;
+    percpu->rt_nr_running = 0;
+    percpu->curr_prio = -1;            // APs start on their idle task
+    percpu->rt_time = 0;
+    percpu->rt_period_start = 0;
+    percpu->rt_throttled = 0;
+    percpu->load_avg = 0;
     percpu->runqueue_length = 0;
+    percpu->fpu_owner = NULL;
+    percpu->fpu_saved_task = NULL;
+    percpu->fpu_depth = 0;
+    percpu->idle_polling = 0;
+    percpu->idle_state = -1;
+    percpu->idle_enter_ns = 0;
+    percpu->rcu_nesting = 0;
     
     char lock_name[32];
     // Simple string formatting without snprintf
@@ -97,6 +151,13 @@ void percpu_init_cpu(uint32_t cpu_id, uint32_t apic_id) {
     percpu->context_switches = 0;
     percpu->interrupts = 0;
     percpu->timer_ticks = 0;
+    percpu->sched_run_delay = 0;
+    percpu->sched_pcount = 0;
+    percpu->sched_migrations = 0;
+    for (int i = 0; i < SCHED_LAT_BUCKETS; i++) percpu->sched_wakeup_hist[i] = 0;
+    percpu->cputime_stamp = 0;
+    percpu->irq_time_tsc = 0;
+    percpu->cputime_ctx = CPUTIME_SYS;
     
     // Set GS base for this CPU
     write_gs_base((uint64_t)percpu);
@@ -111,6 +172,17 @@ void percpu_init_cpu(uint32_t cpu_id, uint32_t apic_id) {
             cpu_id, apic_id, (uint64_t)percpu);
 }
 
+// Called on the BSP before starting an AP
+percpu_t* percpu_prepare_ap(uint32_t cpu_id) {
+    if (cpu_id == 0 || cpu_id >= MAX_CPUS) {
+        return NULL;
+    }
+    if (!g_percpu_boot[cpu_id]) {
+        g_percpu_boot[cpu_id] = percpu_alloc(cpu_id);
+    }
+    return g_percpu_boot[cpu_id];
+}
+
 percpu_t* percpu_alloc(uint32_t cpu_id) {
     if (cpu_id >= MAX_CPUS) {
         return NULL;
@@ -144,76 +216,6 @@ uint32_t percpu_get_online_count(void) {
 // Per-CPU Run Queue Functions
 // ============================================================================
 
-void percpu_runqueue_enqueue(task_t* task) {
-    percpu_t* cpu = this_cpu();
-    uint64_t flags;
-    
-    spin_lock_irqsave(&cpu->runqueue_lock, &flags);
-    
-    task->next = NULL;
-    
-    if (cpu->runqueue_tail) {
-        cpu->runqueue_tail->next = task;
-        cpu->runqueue_tail = task;
-    } else {
-        cpu->runqueue_head = task;
-        cpu->runqueue_tail = task;
-    }
-    
-    cpu->runqueue_length++;
-    
-    spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
-}
-
-task_t* percpu_runqueue_dequeue(void) {
-    percpu_t* cpu = this_cpu();
-    uint64_t flags;
-    task_t* task = NULL;
-    
-    spin_lock_irqsave(&cpu->runqueue_lock, &flags);
-    
-    if (cpu->runqueue_head) {
-        task = cpu->runqueue_head;
-        cpu->runqueue_head = task->next;
-        
-        if (!cpu->runqueue_head) {
-            cpu->runqueue_tail = NULL;
-        }
-        
-        cpu->runqueue_length--;
-        task->next = NULL;
-    }
-    
-    spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
-    
-    return task;
-}
-
-void percpu_runqueue_enqueue_cpu(uint32_t cpu_id, task_t* task) {
-    if (cpu_id >= MAX_CPUS || !g_percpu_ptrs[cpu_id]) {
-        return;
-    }
-    
-    percpu_t* cpu = g_percpu_ptrs[cpu_id];
-    uint64_t flags;
-    
-    spin_lock_irqsave(&cpu->runqueue_lock, &flags);
-    
-    task->next = NULL;
-    
-    if (cpu->runqueue_tail) {
-        cpu->runqueue_tail->next = task;
-        cpu->runqueue_tail = task;
-    } else {
-        cpu->runqueue_head = task;
-        cpu->runqueue_tail = task;
-    }
-    
-    cpu->runqueue_length++;
-    
-    spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
-}
-
 uint32_t percpu_runqueue_length(uint32_t cpu_id) {
     if (cpu_id >= MAX_CPUS || !g_percpu_ptrs[cpu_id]) {
         return 0;
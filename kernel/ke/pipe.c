@@ -1,7 +1,19 @@
 // LikeOS-64 Pipe Implementation
+//
+// Data lives in a ring of page buffers (see pipe.h).  pipe->mutex, a
+// sleeping lock, serialises everything that touches the ring, so copies to
+// and from user memory run with interrupts on and may fault.  Readers wait
+// on rd_wait for data or for the last writer to go, writers on wr_wait for
+// room or for the last reader to go.
 #include <kernel/pipe.h>
 #include <kernel/memory.h>
 #include <kernel/sched.h>
+#include <kernel/signal.h>
+#include <kernel/net.h>
+#include <kernel/syscall.h>
+#include <kernel/eventpoll.h>
+#include <kernel/uaccess.h>
+#include <kernel/uio.h>
 
 bool pipe_is_end(const void* ptr) {
     if (!ptr) {
@@ -16,8 +28,18 @@ bool pipe_is_end(const void* ptr) {
     return end->magic == PIPE_MAGIC;
 }
 
+// Ring slots for a capacity of size bytes: whole pages, a power of two
+static uint32_t pipe_size_to_slots(unsigned long size) {
+    unsigned long pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t slots = 1;
+    while (slots < pages) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
 pipe_t* pipe_create(size_t size) {
-    if (size == 0) {
+    if (size == 0 || size > PIPE_MAX_SIZE) {
         return NULL;
     }
 
@@ -27,23 +49,57 @@ pipe_t* pipe_create(size_t size) {
     }
     mm_memset(pipe, 0, sizeof(pipe_t));
 
-    pipe->buffer = (uint8_t*)kalloc(size);
-    if (!pipe->buffer) {
+    pipe->ring_size = pipe_size_to_slots(size);
+    pipe->bufs = (pipe_buf_t*)kalloc(pipe->ring_size * sizeof(pipe_buf_t));
+    if (!pipe->bufs) {
         kfree(pipe);
         return NULL;
     }
+    mm_memset(pipe->bufs, 0, pipe->ring_size * sizeof(pipe_buf_t));
 
-    pipe->size = size;
-    pipe->read_pos = 0;
-    pipe->write_pos = 0;
-    pipe->used = 0;
-    pipe->readers = 0;
-    pipe->writers = 0;
     spinlock_init(&pipe->lock, "pipe");
+    rwsem_init(&pipe->mutex, "pipe_mutex");
+    wait_queue_init(&pipe->rd_wait, "pipe_rd");
+    wait_queue_init(&pipe->wr_wait, "pipe_wr");
 
     return pipe;
 }
 
+// A page for a new slot, holding one reference.  Called with pipe->mutex.
+uint64_t pipe_get_page(pipe_t* pipe) {
+    uint64_t page = pipe->spare_page;
+    if (page) {
+        pipe->spare_page = 0;
+    } else {
+        page = mm_allocate_physical_page();
+        if (!page) return 0;
+    }
+    mm_incref_page(page);
+    return page;
+}
+
+// Drop a slot's page reference, keeping one freed page for reuse
+void pipe_put_page(pipe_t* pipe, uint64_t page) {
+    if (!mm_decref_page(page)) return;
+    if (!pipe->spare_page) {
+        pipe->spare_page = page;
+    } else {
+        mm_free_physical_page(page);
+    }
+}
+
+void pipe_destroy(pipe_t* pipe) {
+    for (uint32_t t = pipe->tail; t != pipe->head; t++) {
+        pipe_buf_t* b = &pipe->bufs[t & (pipe->ring_size - 1)];
+        pipe_put_page(pipe, b->page);
+    }
+    if (pipe->spare_page) {
+        mm_free_physical_page(pipe->spare_page);
+    }
+    kfree(pipe->bufs);
+    kfree(pipe);
+}
+
 pipe_end_t* pipe_create_end(pipe_t* pipe, bool is_read) {
     if (!pipe) {
         return NULL;
@@ -85,6 +141,9 @@ void pipe_close_end(pipe_end_t* end) {
         return;
     }
 
+    // Unhook epoll watches from the pipe's queues before they can go away
+    eventpoll_release(end);
+
     // Invalidate magic BEFORE freeing to prevent double-close via stale pointer
     end->magic = 0;
 
@@ -92,7 +151,7 @@ void pipe_close_end(pipe_end_t* end) {
     if (pipe) {
         uint64_t flags;
         spin_lock_irqsave(&pipe->lock, &flags);
-        
+
         bool should_free = false;
         if (end->is_read) {
             if (pipe->readers > 0) {
@@ -107,19 +166,445 @@ void pipe_close_end(pipe_end_t* end) {
         if (pipe->readers == 0 && pipe->writers == 0) {
             should_free = true;
         }
-        
+
         spin_unlock_irqrestore(&pipe->lock, flags);
-        
-        // Wake up waiters outside the lock
-        sched_wake_channel(pipe);
 
+        // The other side sees EOF or EPIPE
         if (should_free) {
-            if (pipe->buffer) {
-                kfree(pipe->buffer);
-            }
-            kfree(pipe);
+            pipe_destroy(pipe);
+        } else if (end->is_read) {
+            wake_up(&pipe->wr_wait);
+        } else {
+            wake_up(&pipe->rd_wait);
         }
     }
 
     kfree(end);
-}
\ No newline at end of file
+}
+
+// Bytes a write can add without blocking.  Called with pipe->mutex.
+static size_t pipe_room(pipe_t* pipe) {
+    uint32_t used_slots = pipe->head - pipe->tail;
+    size_t room = (size_t)(pipe->ring_size - used_slots) * PAGE_SIZE;
+    if (used_slots) {
+        pipe_buf_t* last = &pipe->bufs[(pipe->head - 1) & (pipe->ring_size - 1)];
+        if (last->flags & PIPE_BUF_FLAG_CAN_MERGE) {
+            room += PAGE_SIZE - (last->offset + last->len);
+        }
+    }
+    return room;
+}
+
+// Sleep on wq until woken, dropping pipe->mutex meanwhile.  The caller
+// re-checks its condition after this returns with the mutex held again.
+static void pipe_wait(pipe_t* pipe, wait_queue_head_t* wq, task_t* cur, bool reader) {
+    wait_queue_entry_t wait;
+    init_wait_entry(&wait, cur);
+    prepare_to_wait(wq, &wait);
+    up_write(&pipe->mutex);
+
+    // Anything that changed after the mutex was dropped has woken us (or
+    // will), so only sleep if it still looks blocked
+    bool blocked = reader ? (pipe->head == pipe->tail && pipe->writers)
+                          : pipe->readers != 0;
+    if (blocked && !signal_pending(cur)) {
+        sched_schedule();
+    }
+    finish_wait(wq, &wait);
+    down_write(&pipe->mutex);
+}
+
+void pipe_lock(pipe_t* pipe) {
+    down_write(&pipe->mutex);
+}
+
+void pipe_unlock(pipe_t* pipe) {
+    up_write(&pipe->mutex);
+}
+
+int pipe_wait_readable(pipe_t* pipe, bool nonblock) {
+    task_t* cur = sched_current();
+    while (pipe->head == pipe->tail) {
+        if (pipe->writers == 0) {
+            return 0;  // EOF - no more writers
+        }
+        if (nonblock || !cur) {
+            return -EAGAIN;
+        }
+        if (signal_pending(cur)) {
+            return -EINTR;
+        }
+        pipe_wait(pipe, &pipe->rd_wait, cur, true);
+    }
+    return 1;
+}
+
+int pipe_wait_writable(pipe_t* pipe, bool nonblock) {
+    task_t* cur = sched_current();
+    for (;;) {
+        if (pipe->readers == 0) {
+            if (cur) {
+                sched_signal_task(cur, SIGPIPE);
+            }
+            return -EPIPE;
+        }
+        if (!pipe_full(pipe)) {
+            return 0;
+        }
+        if (nonblock || !cur) {
+            return -EAGAIN;
+        }
+        if (signal_pending(cur)) {
+            return -EINTR;
+        }
+        pipe_wait(pipe, &pipe->wr_wait, cur, false);
+    }
+}
+
+void pipe_push_buf(pipe_t* pipe, uint64_t page, uint32_t offset, uint32_t len, uint32_t flags) {
+    pipe_buf_t* b = &pipe->bufs[pipe->head & (pipe->ring_size - 1)];
+    b->page = page;
+    b->offset = offset;
+    b->len = len;
+    b->flags = flags;
+    pipe->head++;
+    pipe->used += len;
+}
+
+void pipe_consume(pipe_t* pipe, size_t n) {
+    while (n && pipe->tail != pipe->head) {
+        pipe_buf_t* b = &pipe->bufs[pipe->tail & (pipe->ring_size - 1)];
+        uint32_t chunk = n < b->len ? (uint32_t)n : b->len;
+        b->offset += chunk;
+        b->len -= chunk;
+        pipe->used -= chunk;
+        n -= chunk;
+        if (b->len == 0) {
+            pipe_put_page(pipe, b->page);
+            b->page = 0;
+            pipe->tail++;
+        }
+    }
+}
+
+int64_t pipe_read_iter(pipe_end_t* end, iov_iter_t* it, int flags) {
+    if (!end || !end->pipe || !end->is_read) {
+        return -EBADF;
+    }
+    pipe_t* pipe = end->pipe;
+
+    if (it->count == 0) {
+        return 0;
+    }
+
+    down_write(&pipe->mutex);
+
+    // Block until data is available or all writers are gone
+    int ret = pipe_wait_readable(pipe, ((end->flags | flags) & O_NONBLOCK) != 0);
+    if (ret <= 0) {
+        up_write(&pipe->mutex);
+        return ret;
+    }
+
+    // Drain whole slots and the front of the last one, as far as the
+    // iterator goes
+    uint32_t mask = pipe->ring_size - 1;
+    uint64_t done = 0;
+    bool fault = false;
+    while (it->count && pipe->tail != pipe->head) {
+        pipe_buf_t* b = &pipe->bufs[pipe->tail & mask];
+        uint64_t chunk = b->len;
+        if (chunk > it->count) chunk = it->count;
+
+        // Data a fault kept from reaching the user stays in the pipe
+        uint64_t n = copy_to_iter((uint8_t*)phys_to_virt(b->page) + b->offset, chunk, it);
+        pipe_consume(pipe, n);
+        done += n;
+        if (n < chunk) {
+            fault = true;
+            break;
+        }
+    }
+    bool more = pipe->head != pipe->tail;
+
+    up_write(&pipe->mutex);
+
+    // Writers waiting for room; with data left another reader can go on
+    wake_up(&pipe->wr_wait);
+    if (more) {
+        wake_up(&pipe->rd_wait);
+    }
+
+    if (fault && !done) {
+        return -EFAULT;
+    }
+    return (int64_t)done;
+}
+
+int64_t pipe_write_iter(pipe_end_t* end, iov_iter_t* it, int flags) {
+    if (!end || !end->pipe || end->is_read) {
+        return -EBADF;
+    }
+    pipe_t* pipe = end->pipe;
+
+    uint64_t count = it->count;
+    if (count == 0) {
+        return 0;
+    }
+
+    task_t* cur = sched_current();
+    down_write(&pipe->mutex);
+
+    // Writes of up to PIPE_BUF bytes go in all at once or not at all, so
+    // they are never interleaved with other writers' data
+    bool nonblock = ((end->flags | flags) & O_NONBLOCK) != 0;
+    bool atomic = count <= PIPE_BUF;
+    uint32_t mask = pipe->ring_size - 1;
+    uint64_t done = 0;
+    int64_t err = 0;
+
+    while (done < count) {
+        if (pipe->readers == 0) {
+            if (cur) {
+                sched_signal_task(cur, SIGPIPE);
+            }
+            err = -EPIPE;
+            break;
+        }
+
+        size_t room = pipe_room(pipe);
+        if (room == 0 || (atomic && room < count)) {
+            if (nonblock || !cur) {
+                err = -EAGAIN;
+                break;
+            }
+            if (signal_pending(cur)) {
+                err = -EINTR;
+                break;
+            }
+            // Let readers drain what is already in before sleeping
+            if (done) {
+                wake_up(&pipe->rd_wait);
+            }
+            pipe_wait(pipe, &pipe->wr_wait, cur, false);
+            mask = pipe->ring_size - 1;
+            continue;
+        }
+
+        // Top up the newest page, then fill new ones while slots are free
+        if (pipe->head != pipe->tail) {
+            pipe_buf_t* last = &pipe->bufs[(pipe->head - 1) & mask];
+            uint32_t end_off = last->offset + last->len;
+            if ((last->flags & PIPE_BUF_FLAG_CAN_MERGE) && end_off < PAGE_SIZE) {
+                uint64_t chunk = PAGE_SIZE - end_off;
+                if (chunk > count - done) chunk = count - done;
+
+                uint64_t n = copy_from_iter((uint8_t*)phys_to_virt(last->page) + end_off, chunk, it);
+                last->len += (uint32_t)n;
+                pipe->used += n;
+                done += n;
+                if (n < chunk) {
+                    err = -EFAULT;
+                    break;
+                }
+            }
+        }
+        while (done < count && !pipe_full(pipe)) {
+            uint64_t page = pipe_get_page(pipe);
+            if (!page) {
+                err = -ENOMEM;
+                break;
+            }
+            uint64_t chunk = count - done;
+            if (chunk > PAGE_SIZE) chunk = PAGE_SIZE;
+
+            uint64_t n = copy_from_iter(phys_to_virt(page), chunk, it);
+            if (n == 0) {
+                pipe_put_page(pipe, page);
+            } else {
+                pipe_push_buf(pipe, page, 0, (uint32_t)n, PIPE_BUF_FLAG_CAN_MERGE);
+                done += n;
+            }
+            if (n < chunk) {
+                err = -EFAULT;
+                break;
+            }
+        }
+        if (err) break;
+    }
+
+    up_write(&pipe->mutex);
+
+    if (done) {
+        wake_up(&pipe->rd_wait);
+        return (int64_t)done;
+    }
+    return err;
+}
+
+int64_t pipe_read(pipe_end_t* end, uint64_t buf, uint64_t count, int flags) {
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, (void*)buf, count);
+    return pipe_read_iter(end, &it, flags);
+}
+
+int64_t pipe_write(pipe_end_t* end, uint64_t buf, uint64_t count, int flags) {
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, (void*)buf, count);
+    return pipe_write_iter(end, &it, flags);
+}
+
+short pipe_poll(pipe_end_t* end, short events, poll_table_t* pt) {
+    pipe_t* pipe = end->pipe;
+    poll_wait(end->is_read ? &pipe->rd_wait : &pipe->wr_wait, pt);
+    uint32_t head = __atomic_load_n(&pipe->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&pipe->tail, __ATOMIC_ACQUIRE);
+    short rev = 0;
+
+    if (end->is_read) {
+        if ((events & (POLLIN | POLLRDNORM)) && head != tail)
+            rev |= POLLIN | POLLRDNORM;
+        if (pipe->writers == 0)
+            rev |= POLLHUP;
+    } else {
+        if ((events & (POLLOUT | POLLWRNORM)) && head - tail < pipe->ring_size)
+            rev |= POLLOUT | POLLWRNORM;
+        if (pipe->readers == 0)
+            rev |= POLLERR;
+    }
+    return rev;
+}
+
+long pipe_get_size(pipe_t* pipe) {
+    return (long)pipe->ring_size * PAGE_SIZE;
+}
+
+long pipe_set_size(pipe_t* pipe, unsigned long size) {
+    if (size > PIPE_MAX_SIZE) {
+        return -EPERM;
+    }
+    uint32_t slots = pipe_size_to_slots(size ? size : 1);
+
+    pipe_buf_t* bufs = (pipe_buf_t*)kalloc(slots * sizeof(pipe_buf_t));
+    if (!bufs) {
+        return -ENOMEM;
+    }
+    mm_memset(bufs, 0, slots * sizeof(pipe_buf_t));
+
+    down_write(&pipe->mutex);
+    uint32_t used_slots = pipe->head - pipe->tail;
+    if (used_slots > slots) {
+        up_write(&pipe->mutex);
+        kfree(bufs);
+        return -EBUSY;
+    }
+
+    // Repack the filled slots at the start of the new ring
+    uint32_t mask = pipe->ring_size - 1;
+    for (uint32_t i = 0; i < used_slots; i++) {
+        bufs[i] = pipe->bufs[(pipe->tail + i) & mask];
+    }
+    pipe_buf_t* old = pipe->bufs;
+    bool grew = slots > pipe->ring_size;
+    pipe->bufs = bufs;
+    pipe->ring_size = slots;
+    pipe->tail = 0;
+    pipe->head = used_slots;
+    up_write(&pipe->mutex);
+
+    kfree(old);
+    if (grew) {
+        wake_up(&pipe->wr_wait);
+    }
+    return (long)slots * PAGE_SIZE;
+}
+
+// Lock two different pipes in address order
+static void pipe_lock_two(pipe_t* a, pipe_t* b) {
+    if (a > b) {
+        pipe_t* t = a;
+        a = b;
+        b = t;
+    }
+    down_write(&a->mutex);
+    down_write(&b->mutex);
+}
+
+int64_t pipe_link(pipe_end_t* in, pipe_end_t* out, size_t len, int flags, bool move) {
+    if (!in || !in->is_read || !out || out->is_read) {
+        return -EBADF;
+    }
+    pipe_t* ip = in->pipe;
+    pipe_t* op = out->pipe;
+    if (ip == op) {
+        return -EINVAL;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    bool nonblock = (flags & O_NONBLOCK) != 0;
+
+    // Wait on each side with only its own lock held, then take both and
+    // check again, since either may have changed in between
+    for (;;) {
+        down_write(&ip->mutex);
+        int ret = pipe_wait_readable(ip, nonblock);
+        up_write(&ip->mutex);
+        if (ret <= 0) {
+            return ret;
+        }
+
+        down_write(&op->mutex);
+        ret = pipe_wait_writable(op, nonblock);
+        up_write(&op->mutex);
+        if (ret < 0) {
+            return ret;
+        }
+
+        pipe_lock_two(ip, op);
+        if (ip->head != ip->tail && op->readers && !pipe_full(op)) {
+            break;
+        }
+        up_write(&op->mutex);
+        up_write(&ip->mutex);
+    }
+
+    uint32_t imask = ip->ring_size - 1;
+    uint32_t t = ip->tail;
+    uint64_t done = 0;
+    while (done < len && t != ip->head && !pipe_full(op)) {
+        pipe_buf_t* b = &ip->bufs[t & imask];
+        uint32_t chunk = b->len;
+        if (chunk > len - done) chunk = (uint32_t)(len - done);
+
+        if (move && chunk == b->len) {
+            // The whole slot changes pipes, reference and all
+            pipe_push_buf(op, b->page, b->offset, b->len, b->flags);
+            ip->used -= chunk;
+            b->page = 0;
+            b->len = 0;
+            ip->tail++;
+        } else {
+            // Both pipes now see the page, so neither may append to it
+            mm_incref_page(b->page);
+            b->flags &= ~PIPE_BUF_FLAG_CAN_MERGE;
+            pipe_push_buf(op, b->page, b->offset, chunk, 0);
+            if (move) {
+                pipe_consume(ip, chunk);
+            }
+        }
+        t++;
+        done += chunk;
+    }
+
+    up_write(&op->mutex);
+    up_write(&ip->mutex);
+
+    wake_up(&op->rd_wait);
+    if (move) {
+        wake_up(&ip->wr_wait);
+    }
+    return (int64_t)done;
+}
@@ -0,0 +1,291 @@
+// LikeOS-64 Red-Black Tree
+// ============================================================================
+// Classic red-black tree with explicit parent pointers.  NULL children are
+// treated as black leaves.  Used by the fair scheduler run queues and any
+// other subsystem that needs an ordered set with O(log n) insert/erase.
+// ============================================================================
+
+#include "../../include/kernel/rbtree.h"
+
+static inline int rb_is_black(const struct rb_node* n) {
+    return !n || n->rb_color == RB_BLACK;
+}
+
+// Replace old with new in old's parent (or the root)
+static inline void rb_change_child(struct rb_node* old, struct rb_node* new,
+                                   struct rb_node* parent, struct rb_root* root) {
+    if (!parent) {
+        root->rb_node = new;
+    } else if (parent->rb_left == old) {
+        parent->rb_left = new;
+    } else {
+        parent->rb_right = new;
+    }
+}
+
+static void rb_rotate_left(struct rb_node* x, struct rb_root* root) {
+    struct rb_node* y = x->rb_right;
+
+    x->rb_right = y->rb_left;
+    if (y->rb_left) {
+        y->rb_left->rb_parent = x;
+    }
+    y->rb_parent = x->rb_parent;
+    rb_change_child(x, y, x->rb_parent, root);
+    y->rb_left = x;
+    x->rb_parent = y;
+}
+
+static void rb_rotate_right(struct rb_node* x, struct rb_root* root) {
+    struct rb_node* y = x->rb_left;
+
+    x->rb_left = y->rb_right;
+    if (y->rb_right) {
+        y->rb_right->rb_parent = x;
+    }
+    y->rb_parent = x->rb_parent;
+    rb_change_child(x, y, x->rb_parent, root);
+    y->rb_right = x;
+    x->rb_parent = y;
+}
+
+// ============================================================================
+// INSERTION
+// ============================================================================
+
+void rb_insert_color(struct rb_node* node, struct rb_root* root) {
+    struct rb_node* parent;
+
+    while ((parent = node->rb_parent) && parent->rb_color == RB_RED) {
+        // Parent is red, so it is not the root and the grandparent exists
+        struct rb_node* gparent = parent->rb_parent;
+
+        if (parent == gparent->rb_left) {
+            struct rb_node* uncle = gparent->rb_right;
+            if (!rb_is_black(uncle)) {
+                // Case 1: recolor and continue from the grandparent
+                parent->rb_color = RB_BLACK;
+                uncle->rb_color = RB_BLACK;
+                gparent->rb_color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (node == parent->rb_right) {
+                // Case 2: rotate into the outer position
+                rb_rotate_left(parent, root);
+                node = parent;
+                parent = node->rb_parent;
+            }
+            // Case 3
+            parent->rb_color = RB_BLACK;
+            gparent->rb_color = RB_RED;
+            rb_rotate_right(gparent, root);
+        } else {
+            struct rb_node* uncle = gparent->rb_left;
+            if (!rb_is_black(uncle)) {
+                parent->rb_color = RB_BLACK;
+                uncle->rb_color = RB_BLACK;
+                gparent->rb_color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (node == parent->rb_left) {
+                rb_rotate_right(parent, root);
+                node = parent;
+                parent = node->rb_parent;
+            }
+            parent->rb_color = RB_BLACK;
+            gparent->rb_color = RB_RED;
+            rb_rotate_left(gparent, root);
+        }
+    }
+
+    root->rb_node->rb_color = RB_BLACK;
+}
+
+// ============================================================================
+// ERASURE
+// ============================================================================
+
+// Restore the black-height invariant after removing a black node.
+// node may be NULL (a black leaf); parent is its parent.
+static void rb_erase_fixup(struct rb_node* node, struct rb_node* parent,
+                           struct rb_root* root) {
+    while (node != root->rb_node && rb_is_black(node)) {
+        if (node == parent->rb_left) {
+            struct rb_node* sibling = parent->rb_right;
+            if (sibling->rb_color == RB_RED) {
+                sibling->rb_color = RB_BLACK;
+                parent->rb_color = RB_RED;
+                rb_rotate_left(parent, root);
+                sibling = parent->rb_right;
+            }
+            if (rb_is_black(sibling->rb_left) && rb_is_black(sibling->rb_right)) {
+                sibling->rb_color = RB_RED;
+                node = parent;
+                parent = node->rb_parent;
+            } else {
+                if (rb_is_black(sibling->rb_right)) {
+                    sibling->rb_left->rb_color = RB_BLACK;
+                    sibling->rb_color = RB_RED;
+                    rb_rotate_right(sibling, root);
+                    sibling = parent->rb_right;
+                }
+                sibling->rb_color = parent->rb_color;
+                parent->rb_color = RB_BLACK;
+                if (sibling->rb_right) {
+                    sibling->rb_right->rb_color = RB_BLACK;
+                }
+                rb_rotate_left(parent, root);
+                node = root->rb_node;
+                break;
+            }
+        } else {
+            struct rb_node* sibling = parent->rb_left;
+            if (sibling->rb_color == RB_RED) {
+                sibling->rb_color = RB_BLACK;
+                parent->rb_color = RB_RED;
+                rb_rotate_right(parent, root);
+                sibling = parent->rb_left;
+            }
+            if (rb_is_black(sibling->rb_left) && rb_is_black(sibling->rb_right)) {
+                sibling->rb_color = RB_RED;
+                node = parent;
+                parent = node->rb_parent;
+            } else {
+                if (rb_is_black(sibling->rb_left)) {
+                    sibling->rb_right->rb_color = RB_BLACK;
+                    sibling->rb_color = RB_RED;
+                    rb_rotate_left(sibling, root);
+                    sibling = parent->rb_left;
+                }
+                sibling->rb_color = parent->rb_color;
+                parent->rb_color = RB_BLACK;
+                if (sibling->rb_left) {
+                    sibling->rb_left->rb_color = RB_BLACK;
+                }
+                rb_rotate_right(parent, root);
+                node = root->rb_node;
+                break;
+            }
+        }
+    }
+
+    if (node) {
+        node->rb_color = RB_BLACK;
+    }
+}
+
+void rb_erase(struct rb_node* node, struct rb_root* root) {
+    struct rb_node* child;
+    struct rb_node* parent;
+    int color;
+
+    if (!node->rb_left || !node->rb_right) {
+        // At most one child: splice the node out directly
+        child = node->rb_left ? node->rb_left : node->rb_right;
+        parent = node->rb_parent;
+        color = node->rb_color;
+        if (child) {
+            child->rb_parent = parent;
+        }
+        rb_change_child(node, child, parent, root);
+    } else {
+        // Two children: move the in-order successor into node's place
+        struct rb_node* succ = node->rb_right;
+        while (succ->rb_left) {
+            succ = succ->rb_left;
+        }
+        child = succ->rb_right;
+        color = succ->rb_color;
+
+        if (succ->rb_parent == node) {
+            parent = succ;
+        } else {
+            parent = succ->rb_parent;
+            parent->rb_left = child;
+            if (child) {
+                child->rb_parent = parent;
+            }
+            succ->rb_right = node->rb_right;
+            node->rb_right->rb_parent = succ;
+        }
+
+        succ->rb_left = node->rb_left;
+        node->rb_left->rb_parent = succ;
+        succ->rb_parent = node->rb_parent;
+        succ->rb_color = node->rb_color;
+        rb_change_child(node, succ, node->rb_parent, root);
+    }
+
+    node->rb_parent = NULL;
+    node->rb_left = NULL;
+    node->rb_right = NULL;
+
+    if (color == RB_BLACK) {
+        rb_erase_fixup(child, parent, root);
+    }
+}
+
+// ============================================================================
+// TRAVERSAL
+// ============================================================================
+
+struct rb_node* rb_first(const struct rb_root* root) {
+    struct rb_node* n = root->rb_node;
+    if (!n) return NULL;
+    while (n->rb_left) n = n->rb_left;
+    return n;
+}
+
+struct rb_node* rb_last(const struct rb_root* root) {
+    struct rb_node* n = root->rb_node;
+    if (!n) return NULL;
+    while (n->rb_right) n = n->rb_right;
+    return n;
+}
+
+struct rb_node* rb_next(const struct rb_node* node) {
+    if (node->rb_right) {
+        node = node->rb_right;
+        while (node->rb_left) node = node->rb_left;
+        return (struct rb_node*)node;
+    }
+    struct rb_node* parent;
+    while ((parent = node->rb_parent) && node == parent->rb_right) {
+        node = parent;
+    }
+    return parent;
+}
+
+struct rb_node* rb_prev(const struct rb_node* node) {
+    if (node->rb_left) {
+        node = node->rb_left;
+        while (node->rb_right) node = node->rb_right;
+        return (struct rb_node*)node;
+    }
+    struct rb_node* parent;
+    while ((parent = node->rb_parent) && node == parent->rb_left) {
+        node = parent;
+    }
+    return parent;
+}
+
+// ============================================================================
+// CACHED-LEFTMOST VARIANTS
+// ============================================================================
+
+void rb_insert_color_cached(struct rb_node* node, struct rb_root_cached* root,
+                            bool leftmost) {
+    if (leftmost) {
+        root->rb_leftmost = node;
+    }
+    rb_insert_color(node, &root->rb_root);
+}
+
+void rb_erase_cached(struct rb_node* node, struct rb_root_cached* root) {
+    if (root->rb_leftmost == node) {
+        root->rb_leftmost = rb_next(node);
+    }
+    rb_erase(node, &root->rb_root);
+}
@@ -0,0 +1,430 @@
+// LikeOS-64 - Read-Copy-Update
+// ============================================================================
+// See include/kernel/rcu.h for the reader/updater rules.
+//
+// Grace periods are numbered.  Starting one bumps gp_seq and sets qs_mask
+// to every online CPU; each CPU clears its bit at its next quiescent state
+// (context switch, or timer tick outside a read-side section), and the last
+// one sets completed = gp_seq.  Since readers cannot be preempted, a CPU
+// that reaches such a point has finished every section it began before.
+//
+// call_rcu() appends to a per-CPU "next" list.  The CPU's SOFTIRQ_RCU
+// handler moves that batch to its "wait" list tagged with the first grace
+// period that starts after the batch was closed, and invokes it once that
+// grace period has completed.  The timer tick raises the softirq whenever
+// a CPU has a batch to close or to invoke.
+// ============================================================================
+
+#include "../../include/kernel/rcu.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/softirq.h"
+#include "../../include/kernel/console.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/timer.h"
+#include "../../include/kernel/smp.h"
+
+volatile int g_rcu_percpu_ready = 0;
+
+// Global grace-period state
+static struct {
+    spinlock_t lock;
+    volatile uint64_t gp_seq;       // Last grace period started
+    volatile uint64_t completed;    // Last grace period ended
+    uint64_t gp_requested;          // Grace period some batch still needs
+    uint64_t qs_mask;               // CPUs yet to report for gp_seq
+    volatile uint64_t online_mask;  // CPUs taking part in grace periods
+} g_rcu = { .lock = SPINLOCK_INIT("rcu") };
+
+// Per-CPU callback batches, touched only by the owning CPU with IRQs off
+typedef struct rcu_cpu {
+    rcu_head_t* next_list;          // Queued, no grace period assigned yet
+    rcu_head_t** next_tail;         // Valid while next_list is non-NULL
+    rcu_head_t* wait_list;          // Waiting for wait_gp to complete
+    uint64_t wait_gp;
+    uint64_t qs_gp;                 // Grace period this CPU last reported for
+    uint64_t cbs_queued;
+    uint64_t cbs_invoked;
+    bool warned;                    // Context switch inside a reader reported
+} rcu_cpu_t;
+
+static rcu_cpu_t g_rcu_cpu[MAX_CPUS];
+
+static inline uint32_t rcu_cpu_id(void) {
+    return g_rcu_percpu_ready ? this_cpu_id() : 0;
+}
+
+static inline bool rcu_gp_done(uint64_t gp) {
+    return (int64_t)(__atomic_load_n(&g_rcu.completed, __ATOMIC_ACQUIRE) - gp) >= 0;
+}
+
+// ============================================================================
+// Grace Periods
+// ============================================================================
+
+// Caller holds g_rcu.lock
+static void rcu_gp_start_locked(void) {
+    g_rcu.qs_mask = g_rcu.online_mask;
+    __atomic_store_n(&g_rcu.gp_seq, g_rcu.gp_seq + 1, __ATOMIC_RELEASE);
+}
+
+// Caller holds g_rcu.lock
+static void rcu_gp_end_locked(void) {
+    __atomic_store_n(&g_rcu.completed, g_rcu.gp_seq, __ATOMIC_RELEASE);
+    if ((int64_t)(g_rcu.gp_requested - g_rcu.completed) > 0) {
+        rcu_gp_start_locked();
+    }
+}
+
+// Return the number of the first grace period that starts after now,
+// starting it if none is in progress.
+static uint64_t rcu_request_gp(void) {
+    uint64_t target;
+    spin_lock(&g_rcu.lock);
+    if (g_rcu.gp_seq == g_rcu.completed) {
+        rcu_gp_start_locked();
+        target = g_rcu.gp_seq;
+    } else {
+        target = g_rcu.gp_seq + 1;
+        if ((int64_t)(target - g_rcu.gp_requested) > 0) {
+            g_rcu.gp_requested = target;
+        }
+    }
+    spin_unlock(&g_rcu.lock);
+    return target;
+}
+
+// Record a quiescent state for cpu_id.  IRQs disabled, not in a reader.
+static void rcu_report_qs(uint32_t cpu_id) {
+    rcu_cpu_t* rc = &g_rcu_cpu[cpu_id];
+    uint64_t gp = __atomic_load_n(&g_rcu.gp_seq, __ATOMIC_ACQUIRE);
+    if (rc->qs_gp == gp) return;
+    if (gp == __atomic_load_n(&g_rcu.completed, __ATOMIC_ACQUIRE)) {
+        rc->qs_gp = gp;
+        return;
+    }
+
+    uint64_t bit = 1ULL << cpu_id;
+    spin_lock(&g_rcu.lock);
+    if (g_rcu.gp_seq != g_rcu.completed && (g_rcu.qs_mask & bit)) {
+        g_rcu.qs_mask &= ~bit;
+        if (!g_rcu.qs_mask) {
+            rcu_gp_end_locked();
+        }
+    }
+    rc->qs_gp = g_rcu.gp_seq;
+    spin_unlock(&g_rcu.lock);
+}
+
+static bool rcu_cpu_pending(const rcu_cpu_t* rc) {
+    if (rc->wait_list) return rcu_gp_done(rc->wait_gp);
+    return rc->next_list != NULL;
+}
+
+// ============================================================================
+// Scheduler Hooks
+// ============================================================================
+
+void rcu_tick(void) {
+    if (!g_rcu_percpu_ready) return;
+    uint32_t cpu_id = this_cpu_id();
+    uint64_t bit = 1ULL << cpu_id;
+
+    // A CPU joins grace periods from its first tick; until then it has
+    // not run any readers.
+    if (!(__atomic_load_n(&g_rcu.online_mask, __ATOMIC_RELAXED) & bit)) {
+        __atomic_fetch_or(&g_rcu.online_mask, bit, __ATOMIC_SEQ_CST);
+    }
+
+    if (this_cpu()->rcu_nesting == 0) {
+        rcu_report_qs(cpu_id);
+    }
+    if (rcu_cpu_pending(&g_rcu_cpu[cpu_id])) {
+        softirq_raise(SOFTIRQ_RCU);
+    }
+}
+
+void rcu_note_context_switch(void) {
+    if (!g_rcu_percpu_ready) return;
+    uint32_t cpu_id = this_cpu_id();
+    if (this_cpu()->rcu_nesting != 0) {
+        // Sleeping in a read-side section; a QS here would be a lie
+        if (!g_rcu_cpu[cpu_id].warned) {
+            g_rcu_cpu[cpu_id].warned = true;
+            kprintf("RCU: CPU %u switched tasks inside rcu_read_lock (nesting %d)\n",
+                    cpu_id, this_cpu()->rcu_nesting);
+        }
+        return;
+    }
+    rcu_report_qs(cpu_id);
+}
+
+// ============================================================================
+// Callbacks
+// ============================================================================
+
+void call_rcu(rcu_head_t* head, void (*func)(rcu_head_t* head)) {
+    head->func = func;
+    head->next = NULL;
+
+    uint64_t flags = local_irq_save();
+    rcu_cpu_t* rc = &g_rcu_cpu[rcu_cpu_id()];
+    if (rc->next_list) {
+        *rc->next_tail = head;
+    } else {
+        rc->next_list = head;
+    }
+    rc->next_tail = &head->next;
+    rc->cbs_queued++;
+    local_irq_restore(flags);
+}
+
+static void rcu_softirq(void) {
+    uint64_t flags = local_irq_save();
+    rcu_cpu_t* rc = &g_rcu_cpu[rcu_cpu_id()];
+
+    rcu_head_t* done = NULL;
+    if (rc->wait_list && rcu_gp_done(rc->wait_gp)) {
+        done = rc->wait_list;
+        rc->wait_list = NULL;
+    }
+    if (!rc->wait_list && rc->next_list) {
+        rc->wait_list = rc->next_list;
+        rc->next_list = NULL;
+        rc->wait_gp = rcu_request_gp();
+    }
+    local_irq_restore(flags);
+
+    uint64_t n = 0;
+    while (done) {
+        rcu_head_t* next = done->next;
+        done->func(done);
+        done = next;
+        n++;
+    }
+    if (n) __atomic_add_fetch(&rc->cbs_invoked, n, __ATOMIC_RELAXED);
+}
+
+typedef struct rcu_sync {
+    rcu_head_t head;
+    volatile int done;
+} rcu_sync_t;
+
+static void rcu_sync_wake(rcu_head_t* head) {
+    rcu_sync_t* s = container_of(head, rcu_sync_t, head);
+    __atomic_store_n(&s->done, 1, __ATOMIC_RELEASE);
+    sched_wake_channel(s);
+}
+
+void synchronize_rcu(void) {
+    // Before SMP scheduling nothing else runs and nothing preempts, so no
+    // reader can be in progress while we are here
+    if (!sched_is_smp()) return;
+
+    rcu_sync_t s;
+    s.done = 0;
+    call_rcu(&s.head, rcu_sync_wake);
+
+    task_t* cur = sched_current();
+    while (!__atomic_load_n(&s.done, __ATOMIC_ACQUIRE)) {
+        cur->wait_channel = &s;
+        cur->state = TASK_BLOCKED;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&s.done, __ATOMIC_ACQUIRE)) {
+            cur->state = TASK_RUNNING;
+            cur->wait_channel = NULL;
+            break;
+        }
+        sched_schedule();
+        cur->wait_channel = NULL;
+    }
+}
+
+// ============================================================================
+// Initialization / Statistics
+// ============================================================================
+
+void rcu_init(void) {
+    // Callbacks queued before this point sit on CPU 0's list and are
+    // handled once the BSP starts ticking
+    softirq_register(SOFTIRQ_RCU, rcu_softirq);
+    __atomic_store_n(&g_rcu_percpu_ready, 1, __ATOMIC_RELEASE);
+    kprintf("RCU: quiescent-state based, callbacks in softirq\n");
+}
+
+void rcu_get_stats(rcu_stats_t* out) {
+    mm_memset(out, 0, sizeof(*out));
+    out->gp_completed = __atomic_load_n(&g_rcu.completed, __ATOMIC_RELAXED);
+    for (int i = 0; i < MAX_CPUS; i++) {
+        out->cbs_queued += g_rcu_cpu[i].cbs_queued;
+        out->cbs_invoked += __atomic_load_n(&g_rcu_cpu[i].cbs_invoked, __ATOMIC_RELAXED);
+    }
+    out->cbs_pending = out->cbs_queued - out->cbs_invoked;
+}
+
+#ifdef RCU_TORTURE
+// ============================================================================
+// Stress Test (make RCU_TORTURE=1)
+// ============================================================================
+// One reader thread per CPU dereferences a shared object in a tight loop,
+// holding each read-side section for a random while, and checks that the
+// object is still live at both ends.  A writer keeps replacing the object
+// and retires the old one through call_rcu() or synchronize_rcu(); the
+// free path poisons it first, so a grace period that ends too early shows
+// up as a reader seeing the poison.
+
+#define RCU_TORTURE_SECONDS     30
+#define RCU_TORTURE_STACK_SIZE  (16 * 1024)
+#define RCU_TORTURE_LIVE        0x52435554554C4956ULL   // "RCUTLIVE"
+#define RCU_TORTURE_DEAD        0x5243555444454144ULL   // "RCUTDEAD"
+
+typedef struct rcu_torture_obj {
+    volatile uint64_t magic;
+    uint64_t gen;
+    rcu_head_t rcu;
+} rcu_torture_obj_t;
+
+static rcu_torture_obj_t* g_torture_cur;
+static volatile uint64_t g_torture_reads;
+static volatile uint64_t g_torture_errors;
+static volatile uint64_t g_torture_updates;
+static volatile uint64_t g_torture_syncs;
+static volatile int g_torture_stop;
+static volatile int g_torture_readers_left;
+static uint64_t g_torture_seed = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t torture_rand(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (uint32_t)x;
+}
+
+static void torture_free(rcu_head_t* head) {
+    rcu_torture_obj_t* o = container_of(head, rcu_torture_obj_t, rcu);
+    o->magic = RCU_TORTURE_DEAD;
+    kfree(o);
+}
+
+static void torture_sleep(uint64_t ticks) {
+    task_t* cur = sched_current();
+    cur->state = TASK_BLOCKED;
+    cur->wait_channel = (void*)&g_torture_stop;
+    cur->wakeup_tick = timer_ticks() + ticks;
+    sched_schedule();
+    cur->wait_channel = NULL;
+    cur->wakeup_tick = 0;
+}
+
+static void torture_reader(void* arg) {
+    uint64_t seed = g_torture_seed ^ ((uint64_t)(uintptr_t)arg << 32);
+    uint64_t reads = 0;
+
+    while (!g_torture_stop) {
+        rcu_read_lock();
+        rcu_torture_obj_t* o = rcu_dereference(g_torture_cur);
+        if (o) {
+            if (o->magic != RCU_TORTURE_LIVE) __atomic_add_fetch(&g_torture_errors, 1, __ATOMIC_RELAXED);
+            uint32_t spin = torture_rand(&seed) & 0x3FF;
+            for (volatile uint32_t i = 0; i < spin; i++) {
+                __asm__ volatile("pause");
+            }
+            if (o->magic != RCU_TORTURE_LIVE) __atomic_add_fetch(&g_torture_errors, 1, __ATOMIC_RELAXED);
+        }
+        rcu_read_unlock();
+
+        if ((++reads & 0xFFF) == 0) {
+            __atomic_add_fetch(&g_torture_reads, 0x1000, __ATOMIC_RELAXED);
+            sched_yield_in_kernel();
+        }
+    }
+    __atomic_sub_fetch(&g_torture_readers_left, 1, __ATOMIC_RELEASE);
+}
+
+static void torture_writer(void* arg) {
+    (void)arg;
+    uint64_t seed = g_torture_seed;
+    uint64_t end = timer_ticks() + RCU_TORTURE_SECONDS * 100;
+    uint64_t start_ns = sched_clock();
+
+    while (timer_ticks() < end) {
+        rcu_torture_obj_t* o = (rcu_torture_obj_t*)kalloc(sizeof(*o));
+        if (!o) {
+            torture_sleep(1);
+            continue;
+        }
+        o->magic = RCU_TORTURE_LIVE;
+        o->gen = ++g_torture_updates;
+        rcu_torture_obj_t* old = g_torture_cur;
+        rcu_assign_pointer(g_torture_cur, o);
+
+        if (old) {
+            if ((torture_rand(&seed) & 7) == 0) {
+                synchronize_rcu();
+                torture_free(&old->rcu);
+                g_torture_syncs++;
+            } else {
+                call_rcu(&old->rcu, torture_free);
+            }
+        }
+        if ((g_torture_updates & 0x3F) == 0) torture_sleep(1);
+    }
+
+    g_torture_stop = 1;
+    while (__atomic_load_n(&g_torture_readers_left, __ATOMIC_ACQUIRE) > 0) {
+        torture_sleep(1);
+    }
+    rcu_torture_obj_t* last = g_torture_cur;
+    rcu_assign_pointer(g_torture_cur, (rcu_torture_obj_t*)NULL);
+    if (last) call_rcu(&last->rcu, torture_free);
+    synchronize_rcu();
+
+    rcu_stats_t st;
+    rcu_get_stats(&st);
+    uint64_t ms = (sched_clock() - start_ns) / 1000000ULL;
+    kprintf("rcu-torture: %s: %llu reads, %llu updates (%llu synchronous), "
+            "%llu grace periods in %llums, %llu errors\n",
+            g_torture_errors ? "FAILED" : "PASSED",
+            g_torture_reads, g_torture_updates, g_torture_syncs,
+            st.gp_completed, ms, g_torture_errors);
+}
+
+static task_t* torture_spawn(task_entry_t entry, void* arg, int cpu, const char* name) {
+    void* stack = kalloc(RCU_TORTURE_STACK_SIZE);
+    if (!stack) return NULL;
+    task_t* t = sched_add_task(entry, arg, stack, RCU_TORTURE_STACK_SIZE);
+    if (!t) {
+        kfree(stack);
+        return NULL;
+    }
+    if (cpu >= 0) {
+        t->on_cpu = (uint32_t)cpu;
+        t->cpu_affinity = 1ULL << cpu;
+    }
+    int i = 0;
+    while (name[i] && i < 14) {
+        t->comm[i] = name[i];
+        i++;
+    }
+    if (cpu >= 0) t->comm[i++] = (char)('0' + (cpu % 10));
+    t->comm[i] = '\0';
+    return t;
+}
+
+void rcu_torture_start(void) {
+    uint32_t ncpus = smp_get_cpu_count();
+    if (ncpus == 0) ncpus = 1;
+    if (ncpus > MAX_CPUS) ncpus = MAX_CPUS;
+
+    g_torture_seed ^= sched_clock();
+    for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+        __atomic_add_fetch(&g_torture_readers_left, 1, __ATOMIC_RELAXED);
+        if (!torture_spawn(torture_reader, (void*)(uintptr_t)cpu, (int)cpu, "rcu_reader/")) {
+            __atomic_sub_fetch(&g_torture_readers_left, 1, __ATOMIC_RELAXED);
+        }
+    }
+    torture_spawn(torture_writer, NULL, -1, "rcu_writer");
+    kprintf("rcu-torture: %u readers, running for %us\n", ncpus, RCU_TORTURE_SECONDS);
+}
+#endif // RCU_TORTURE
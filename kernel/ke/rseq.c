@@ -0,0 +1,153 @@
+// LikeOS-64 - Restartable sequences (rseq)
+//
+// See include/kernel/rseq.h for the model.  The user area is touched on
+// the return-to-user paths, with interrupts off, through the exception-table
+// accessors in uaccess.h: an area that is unmapped or was never mapped
+// makes the access fail with -EFAULT instead of faulting in the kernel.
+// A fault, a malformed descriptor or a bad signature kills the thread with
+// SIGSEGV, as on Linux.
+
+#include "../../include/kernel/rseq.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/percpu.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/console.h"
+#include "../../include/kernel/signal.h"
+#include "../../include/kernel/syscall.h"
+#include "../../include/kernel/uaccess.h"
+
+// One field of the user area; 0 or -EFAULT
+static int rseq_get(uint64_t* val, uint64_t uptr, size_t size) {
+    if (!access_ok((const void*)uptr, size)) return -EFAULT;
+    smap_disable();
+    int ret = __get_user_size(val, (const void*)uptr, size);
+    smap_enable();
+    return ret;
+}
+
+static int rseq_put(uint64_t val, uint64_t uptr, size_t size) {
+    if (!access_ok((void*)uptr, size)) return -EFAULT;
+    smap_disable();
+    int ret = __put_user_size(val, (void*)uptr, size);
+    smap_enable();
+    return ret;
+}
+
+#define RSEQ_FIELD(t, f)    ((t)->rseq + __builtin_offsetof(k_rseq_t, f))
+#define RSEQ_FIELD_SIZE(f)  sizeof(((k_rseq_t*)0)->f)
+
+static int rseq_write_cpu(task_t* t, uint32_t cpu_start, uint32_t cpu) {
+    if (rseq_put(cpu_start, RSEQ_FIELD(t, cpu_id_start), RSEQ_FIELD_SIZE(cpu_id_start)) ||
+        rseq_put(cpu, RSEQ_FIELD(t, cpu_id), RSEQ_FIELD_SIZE(cpu_id))) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+static int rseq_clear_cs(task_t* t) {
+    return rseq_put(0, RSEQ_FIELD(t, rseq_cs), RSEQ_FIELD_SIZE(rseq_cs));
+}
+
+static void rseq_kill(task_t* t, const char* why) {
+    kprintf("rseq: task %d: %s, killed\n", (int)t->id, why);
+    sched_signal_task(t, SIGSEGV);
+}
+
+int64_t rseq_register(task_t* t, uint64_t uptr, uint32_t len, int flags, uint32_t sig) {
+    if (flags & RSEQ_FLAG_UNREGISTER) {
+        if (flags & ~RSEQ_FLAG_UNREGISTER) return -EINVAL;
+        if (t->rseq != uptr || !uptr) return -EINVAL;
+        if (t->rseq_len != len) return -EINVAL;
+        if (t->rseq_sig != sig) return -EPERM;
+        int ret = rseq_write_cpu(t, 0, RSEQ_CPU_ID_UNINITIALIZED);
+        rseq_clear(t);
+        return ret;
+    }
+    if (flags) return -EINVAL;
+
+    if (t->rseq) {
+        // Re-registering the same area is reported as busy, anything else
+        // as invalid
+        if (t->rseq != uptr || t->rseq_len != len) return -EINVAL;
+        if (t->rseq_sig != sig) return -EPERM;
+        return -EBUSY;
+    }
+
+    if (len < RSEQ_ORIG_SIZE || (uptr & (RSEQ_ORIG_SIZE - 1))) return -EINVAL;
+    if (!access_ok((const void*)uptr, len)) return -EFAULT;
+
+    t->rseq = uptr;
+    // Every return to user space reads rseq_cs; fail now if it cannot
+    uint64_t cs_ptr;
+    if (rseq_get(&cs_ptr, RSEQ_FIELD(t, rseq_cs), RSEQ_FIELD_SIZE(rseq_cs))) {
+        t->rseq = 0;
+        return -EFAULT;
+    }
+
+    t->rseq_len = len;
+    t->rseq_sig = sig;
+    t->rseq_event = 1;
+    t->rseq_cpu = -1;       // cpu_id is written on the way out of the syscall
+    return 0;
+}
+
+// Abort an interrupted critical section.  Returns 0 if there was nothing
+// to do or *user_ip was redirected, -EFAULT if the user memory faulted and
+// -EINVAL for a malformed descriptor; the thread must be killed for both.
+static int rseq_ip_fixup(task_t* t, uint64_t* user_ip) {
+    uint64_t cs_ptr;
+    if (rseq_get(&cs_ptr, RSEQ_FIELD(t, rseq_cs), RSEQ_FIELD_SIZE(rseq_cs))) return -EFAULT;
+    if (!cs_ptr) return 0;
+
+    k_rseq_cs_t cs;
+    if (copy_from_user(&cs, (const void*)cs_ptr, sizeof(cs))) return -EFAULT;
+
+    if (cs.version != 0) return -EINVAL;
+    if (cs.start_ip >= USER_ADDR_END || cs.post_commit_offset >= USER_ADDR_END ||
+        cs.start_ip + cs.post_commit_offset > USER_ADDR_END) return -EINVAL;
+    if (cs.abort_ip - cs.start_ip < cs.post_commit_offset) return -EINVAL;
+
+    // Outside the section: the descriptor is stale, clear it lazily
+    if (*user_ip - cs.start_ip >= cs.post_commit_offset) {
+        return rseq_clear_cs(t);
+    }
+
+    uint64_t sig;
+    if (rseq_get(&sig, cs.abort_ip - sizeof(uint32_t), sizeof(uint32_t))) return -EFAULT;
+    if ((uint32_t)sig != t->rseq_sig) return -EINVAL;
+
+    if (rseq_clear_cs(t)) return -EFAULT;
+    *user_ip = cs.abort_ip;
+    return 0;
+}
+
+void rseq_signal_deliver(task_t* t, uint64_t* user_ip) {
+    if (!t->rseq) return;
+    int ret = rseq_ip_fixup(t, user_ip);
+    if (ret < 0) {
+        rseq_kill(t, ret == -EFAULT ? "rseq area fault" : "bad critical section");
+    }
+}
+
+void rseq_notify_resume(task_t* t, uint64_t* user_ip) {
+    if (!t || !t->rseq) return;
+
+    if (t->rseq_event) {
+        t->rseq_event = 0;
+        int ret = user_ip ? rseq_ip_fixup(t, user_ip) : 0;
+        if (ret < 0) {
+            rseq_kill(t, ret == -EFAULT ? "rseq area fault" : "bad critical section");
+            return;
+        }
+    }
+
+    uint32_t cpu = this_cpu()->cpu_id;
+    if (t->rseq_cpu != (int)cpu) {
+        // Record the CPU even on a fault so the write is not retried on
+        // every return while the signal is pending
+        t->rseq_cpu = (int)cpu;
+        if (rseq_write_cpu(t, cpu, cpu) < 0) {
+            rseq_kill(t, "rseq area fault");
+        }
+    }
+}
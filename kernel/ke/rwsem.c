@@ -0,0 +1,114 @@
+// LikeOS-64 - Reader-Writer Semaphore
+//
+// Blocked tasks sleep on the semaphore's address as their wait channel and
+// re-check the state when woken, so a release simply wakes every waiter.
+
+#include "../../include/kernel/rwsem.h"
+#include "../../include/kernel/sched.h"
+
+void rwsem_init(rw_semaphore_t* sem, const char* name) {
+    spinlock_init(&sem->lock, name);
+    sem->count = 0;
+    sem->waiting_writers = 0;
+    sem->waiters = 0;
+    sem->name = name;
+}
+
+// Sleep until woken by a release.  Called and returns with sem->lock held.
+static void rwsem_wait(rw_semaphore_t* sem, uint64_t* flags) {
+    task_t* cur = sched_current();
+
+    sem->waiters++;
+    cur->wait_channel = sem;
+    cur->state = TASK_BLOCKED;
+    spin_unlock_irqrestore(&sem->lock, *flags);
+
+    sched_schedule();
+    cur->wait_channel = NULL;
+
+    spin_lock_irqsave(&sem->lock, flags);
+    sem->waiters--;
+}
+
+// ============================================================================
+// Readers
+// ============================================================================
+
+void down_read(rw_semaphore_t* sem) {
+    uint64_t flags;
+    spin_lock_irqsave(&sem->lock, &flags);
+    while (sem->count < 0 || sem->waiting_writers)
+        rwsem_wait(sem, &flags);
+    sem->count++;
+    spin_unlock_irqrestore(&sem->lock, flags);
+}
+
+int down_read_trylock(rw_semaphore_t* sem) {
+    uint64_t flags;
+    int ok = 0;
+    spin_lock_irqsave(&sem->lock, &flags);
+    if (sem->count >= 0 && !sem->waiting_writers) {
+        sem->count++;
+        ok = 1;
+    }
+    spin_unlock_irqrestore(&sem->lock, flags);
+    return ok;
+}
+
+void up_read(rw_semaphore_t* sem) {
+    uint64_t flags;
+    spin_lock_irqsave(&sem->lock, &flags);
+    int wake = (--sem->count == 0) && sem->waiters;
+    spin_unlock_irqrestore(&sem->lock, flags);
+    if (wake)
+        sched_wake_channel(sem);
+}
+
+// ============================================================================
+// Writers
+// ============================================================================
+
+void down_write(rw_semaphore_t* sem) {
+    uint64_t flags;
+    spin_lock_irqsave(&sem->lock, &flags);
+    if (sem->count != 0) {
+        sem->waiting_writers++;
+        while (sem->count != 0)
+            rwsem_wait(sem, &flags);
+        sem->waiting_writers--;
+    }
+    sem->count = -1;
+    spin_unlock_irqrestore(&sem->lock, flags);
+}
+
+int down_write_trylock(rw_semaphore_t* sem) {
+    uint64_t flags;
+    int ok = 0;
+    spin_lock_irqsave(&sem->lock, &flags);
+    if (sem->count == 0) {
+        sem->count = -1;
+        ok = 1;
+    }
+    spin_unlock_irqrestore(&sem->lock, flags);
+    return ok;
+}
+
+void up_write(rw_semaphore_t* sem) {
+    uint64_t flags;
+    spin_lock_irqsave(&sem->lock, &flags);
+    sem->count = 0;
+    int wake = sem->waiters;
+    spin_unlock_irqrestore(&sem->lock, flags);
+    if (wake)
+        sched_wake_channel(sem);
+}
+
+void downgrade_write(rw_semaphore_t* sem) {
+    uint64_t flags;
+    spin_lock_irqsave(&sem->lock, &flags);
+    sem->count = 1;
+    int wake = sem->waiters && !sem->waiting_writers;
+    spin_unlock_irqrestore(&sem->lock, flags);
+    if (wake)
+        sched_wake_channel(sem);
+}
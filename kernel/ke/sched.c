@@ -1,28 +1,53 @@
 // LikeOS-64 Per-CPU Preemptive Scheduler
 // ============================================================================
-// SCHEDULER TYPE: O(1) RR with Preemption
+// SCHEDULER TYPE: Real-time (FIFO/RR) + weighted fair (vruntime) classes
 // ============================================================================
 //
-// This is a simple O(1) preemptive RR scheduler with per-CPU run
-// queues. Both enqueue and dequeue operations are O(1) using FIFO linked lists.
+// Two scheduling classes share each per-CPU run queue:
+//
+//   - Real-time (SCHED_FIFO / SCHED_RR, priority 1..99): one FIFO list per
+//     priority plus a bitmap of non-empty lists, so pick-next is a single
+//     find-highest-bit.  A runnable RT task always runs before any fair
+//     task, and a higher-priority RT task preempts a lower one immediately.
+//     SCHED_RR tasks rotate within their priority every RR_TIMESLICE_NS.
+//     RT throttling caps RT runtime at RT_RUNTIME_NS per RT_PERIOD_NS while
+//     fair tasks are waiting.
+//   - Fair (SCHED_NORMAL / SCHED_BATCH / SCHED_IDLE): a CFS-style
+//     proportional-share scheduler.  Every task accumulates virtual runtime
+//     (real runtime scaled by its nice weight); the task with the smallest
+//     vruntime runs next.
 //
 // Key characteristics:
-//   - Time complexity: O(1) for enqueue, dequeue, and context switch
-//   - Scheduling policy: RR with fixed time slices (SCHED_TIME_SLICE)
-//   - Preemption: Timer-driven preemptive multitasking via sched_preempt()
-//   - SMP support: True per-CPU run queues with load balancing
-//   - No priority levels (all tasks are equal priority)
+//   - Time complexity: O(1) RT enqueue/pick-next; fair class O(log n)
+//     enqueue/dequeue, O(1) pick-next (cached leftmost)
+//   - Fair policy: weighted fair share, nice -20..19 (Linux weight table)
+//   - Time slice: SCHED_LATENCY_NS split among runnable fair tasks by
+//     weight, never below SCHED_MIN_GRANULARITY_NS
+//   - Preemption: timer-driven via sched_task_tick()/sched_preempt(), plus
+//     wakeup preemption (RT priority, or vruntime lead for fair tasks) that
+//     takes effect on return from the waking interrupt
+//   - SMP support: True per-CPU run queues with hierarchical load
+//     balancing over CPUID-derived scheduling domains; RT tasks
+//     are pushed to the lowest-priority CPU at wakeup and pulled by CPUs
+//     about to run something of lower priority
 //
 // Architecture:
-//   - Each CPU has its own run queue (percpu->runqueue_head/tail) protected
-//     by percpu->runqueue_lock.  schedule() / sched_preempt() only touch the
-//     *local* CPU's queue – zero cross-CPU lock contention in the hot path.
+//   - Each CPU has its own run queue (percpu->cfs_tasks, a red-black tree
+//     keyed by vruntime) protected by percpu->runqueue_lock.  schedule() /
+//     sched_preempt() only touch the *local* CPU's queue – zero cross-CPU
+//     lock contention in the hot path.
 //   - A global all-tasks linked list (g_task_list_head, via task->next)
 //     protected by g_task_list_lock is used for administrative operations
-//     (find_by_id, wake_channel, signal delivery, dump, etc.).  These are
-//     cold paths where a global lock is acceptable.
-//   - task->rq_next links the task into a per-CPU run queue.
-//   - task->on_cpu records which CPU the task is assigned to.
+//     (wake_channel, signal delivery, dump, etc.).  These are cold paths
+//     where a global lock is acceptable.  PID, process-group and session
+//     hash tables under the same lock index it; find_by_id walks the PID
+//     chain locklessly under rcu_read_lock(); removed tasks are freed
+//     with call_rcu().
+//   - task->rq_node links the task into a per-CPU run queue.
+//   - task->on_cpu records which CPU the task is assigned to; task->rq_cpu
+//     records which CPU's min_vruntime its vruntime is relative to.
+//   - RT tasks are queued on g_rt_rq[cpu] under the same runqueue_lock;
+//     percpu->curr_prio publishes what each CPU is running for RT placement.
 //   - load_balance() is called periodically by the BSP timer to pull tasks
 //     from the busiest CPU to the least-loaded one.
 //
@@ -42,9 +67,17 @@
 #include "../../include/kernel/timer.h"
 #include "../../include/kernel/syscall.h"
 #include "../../include/kernel/percpu.h"
+#include "../../include/kernel/lapic.h"
 #include "../../include/kernel/smp.h"
+#include "../../include/kernel/topology.h"
+#include "../../include/kernel/fpu.h"
+#include "../../include/kernel/cpuidle.h"
+#include "../../include/kernel/rcu.h"
 #include "../../include/kernel/futex.h"
 #include "../../include/kernel/net.h"
+#include "../../include/kernel/workqueue.h"
+#include "../../include/kernel/cputime.h"
+#include "../../include/kernel/rseq.h"
 
 extern void user_mode_iret_trampoline(void);
 extern void ctx_switch_asm(uint64_t** old_sp, uint64_t* new_sp);
@@ -53,9 +86,6 @@ extern void ctx_switch_asm(uint64_t** old_sp, uint64_t* new_sp);
 // GLOBAL STATE
 // ============================================================================
 
-// Preemption control – global counter (used pre-SMP; post-SMP uses per-CPU)
-volatile int g_preempt_count = 0;
-
 // Global all-tasks linked list (linear, via task->next)
 static task_t* g_task_list_head = NULL;
 spinlock_t g_task_list_lock = SPINLOCK_INIT("task_list");
@@ -80,6 +110,17 @@ static uint64_t g_default_kernel_stack = 0;
 static volatile uint64_t g_total_schedules = 0;
 static uint64_t g_preempt_count_total = 0;
 
+// SMP placement tunables (SYS_SCHEDCTL)
+static volatile int g_sched_wake_affine = 1;
+static volatile uint32_t g_sched_wake_imbalance_pct = SCHED_WAKE_IMBALANCE_PCT;
+static volatile uint32_t g_sched_wake_idle_scan = SCHED_WAKE_IDLE_SCAN;
+static volatile uint64_t g_sched_migration_cost_ns = SCHED_MIGRATION_COST_NS;
+
+// Wakeup placement counters, one slot per CPU (summed by sched_get_wakestats)
+static k_sched_wakestats_t g_wakestats[MAX_CPUS];
+#define wakestat_inc(field) \
+    __atomic_fetch_add(&g_wakestats[this_cpu_id()].field, 1, __ATOMIC_RELAXED)
+
 // ============================================================================
 // LOAD AVERAGE TRACKING
 // ============================================================================
@@ -121,15 +162,14 @@ static uint8_t g_idle_stack[4096] __attribute__((aligned(16)));
 static task_t* g_ap_idle_tasks[MAX_AP_IDLE] = {0};
 static uint8_t* g_ap_idle_stacks[MAX_AP_IDLE] = {0};
 
-// Load balance interval (every N timer ticks per CPU)
-#define LOAD_BALANCE_INTERVAL 50
-
 // ============================================================================
 // FORWARD DECLARATIONS
 // ============================================================================
 
 static void task_trampoline(void);
 static void idle_entry(void* arg);
+static void sched_idle_balance(percpu_t* me);
+static uint64_t cpu_load_now(const percpu_t* cpu);
 
 // ============================================================================
 // HELPER FUNCTIONS
@@ -233,37 +273,472 @@ static inline void switch_address_space(task_t* prev, task_t* next) {
 // GLOBAL TASK LIST MANAGEMENT
 // ============================================================================
 // The global list links every task (regardless of state) via task->next.
-// Protected by g_task_list_lock.  Used for admin operations only.
+// Updates hold g_task_list_lock.  Readers either hold the lock or walk the
+// list under rcu_read_lock(): a task is published only once initialized,
+// and an unlinked task keeps its next pointer until it is freed after a
+// grace period, so a walker standing on it can still move on.
+
+//
+// Alongside the list, three hash tables index tasks by PID, process group
+// and session so lookups and group signals cost the size of the group
+// rather than the number of tasks.  They share g_task_list_lock; the PID
+// chains may also be walked under rcu_read_lock() like the list itself.
+// Only positive pgid/sid values are indexed.
+
+#define PID_HASH_BITS   8
+#define PID_HASH_SIZE   (1 << PID_HASH_BITS)
+
+static task_hnode_t* g_pid_hash[PID_HASH_SIZE];
+static task_hnode_t* g_pgrp_hash[PID_HASH_SIZE];
+static task_hnode_t* g_session_hash[PID_HASH_SIZE];
+
+static inline uint32_t pid_hashfn(uint32_t nr) {
+    return (nr * 0x9E3779B1u) >> (32 - PID_HASH_BITS);
+}
+
+static void hnode_add(task_hnode_t** head, task_hnode_t* n) {
+    n->next = *head;
+    n->pprev = head;
+    if (n->next)
+        n->next->pprev = &n->next;
+    rcu_assign_pointer(*head, n);
+}
+
+// Leaves n->next intact so an RCU walker standing on n can move on
+static void hnode_del(task_hnode_t* n) {
+    if (!n->pprev) return;
+    rcu_assign_pointer(*n->pprev, n->next);
+    if (n->next)
+        n->next->pprev = n->pprev;
+    n->pprev = NULL;
+}
+
+static void task_hash_groups(task_t* t) {
+    if (t->pgid > 0)
+        hnode_add(&g_pgrp_hash[pid_hashfn((uint32_t)t->pgid)], &t->pgrp_node);
+    if (t->sid > 0)
+        hnode_add(&g_session_hash[pid_hashfn((uint32_t)t->sid)], &t->session_node);
+}
 
 void task_list_add(task_t* t) {
+    // Fork paths copy the parent wholesale; start from clean links
+    t->pid_node.pprev = NULL;
+    t->pgrp_node.pprev = NULL;
+    t->session_node.pprev = NULL;
+    hnode_add(&g_pid_hash[pid_hashfn((uint32_t)t->id)], &t->pid_node);
+    task_hash_groups(t);
+
     t->next = g_task_list_head;
-    g_task_list_head = t;
+    rcu_assign_pointer(g_task_list_head, t);
 }
 
 static void task_list_remove(task_t* t) {
     if (!t) return;
+    hnode_del(&t->pid_node);
+    hnode_del(&t->pgrp_node);
+    hnode_del(&t->session_node);
     if (g_task_list_head == t) {
-        g_task_list_head = t->next;
-        t->next = NULL;
+        rcu_assign_pointer(g_task_list_head, t->next);
         return;
     }
     for (task_t* prev = g_task_list_head; prev; prev = prev->next) {
         if (prev->next == t) {
-            prev->next = t->next;
-            t->next = NULL;
+            rcu_assign_pointer(prev->next, t->next);
             return;
         }
     }
 }
 
+static void task_free_rcu(rcu_head_t* head) {
+    kfree(container_of(head, task_t, rcu));
+}
+
+// ============================================================================
+// FAIR SCHEDULING HELPERS
+// ============================================================================
+// vruntime advances by delta_exec * NICE_0_LOAD / load_weight, so a heavier
+// (lower nice) task ages more slowly and receives a proportionally larger
+// CPU share.  vruntime values are only comparable on one CPU: task->rq_cpu
+// names the CPU whose cfs_min_vruntime they are relative to, and tasks are
+// rebased when they land on another CPU's queue.
+
+// Nice level to load weight (nice -20 .. 19).  Each step is ~1.25x, which
+// gives ~10% CPU difference between adjacent nice levels.
+static const uint32_t g_nice_to_weight[NICE_WIDTH] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+};
+
+static inline uint32_t nice_to_weight(int nice) {
+    if (nice < NICE_MIN) nice = NICE_MIN;
+    if (nice > NICE_MAX) nice = NICE_MAX;
+    return g_nice_to_weight[nice - NICE_MIN];
+}
+
+// Wrap-safe vruntime ordering
+static inline bool vruntime_before(uint64_t a, uint64_t b) {
+    return (int64_t)(a - b) < 0;
+}
+
+static inline uint64_t max_vruntime(uint64_t a, uint64_t b) {
+    return vruntime_before(a, b) ? b : a;
+}
+
+// Convert a wall-clock delta (ns) into vruntime for this task's weight
+static inline uint64_t calc_delta_fair(uint64_t delta, const task_t* t) {
+    if (t->load_weight == NICE_0_LOAD || t->load_weight == 0) return delta;
+    return delta * NICE_0_LOAD / t->load_weight;
+}
+
+static inline bool rt_policy(int policy) {
+    return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static inline bool task_is_rt(const task_t* t) {
+    return rt_policy(t->policy);
+}
+
+// Queued fair-class tasks (runqueue_length counts both classes)
+static inline uint32_t cfs_nr_running(const percpu_t* cpu) {
+    return cpu->runqueue_length - cpu->rt_nr_running;
+}
+
+// Scheduler clock in nanoseconds.  Uses the calibrated TSC when available
+// (deltas are only ever taken on the same CPU), otherwise tick granularity.
+uint64_t sched_clock(void) {
+    uint64_t tsc_hz = lapic_get_tsc_freq();
+    if (tsc_hz) {
+        uint64_t cycles = timer_rdtsc();
+        uint64_t whole = cycles / tsc_hz;
+        uint64_t rem = cycles % tsc_hz;
+        return whole * 1000000000ULL + (rem * 1000000000ULL) / tsc_hz;
+    }
+    uint32_t hz = timer_get_frequency();
+    return hz ? timer_ticks() * (1000000000ULL / hz) : 0;
+}
+
+// Wall-clock slice for t: the scheduling period divided by weight among the
+// queued tasks plus t itself.  Caller holds the CPU's runqueue_lock.
+static uint64_t sched_slice(percpu_t* cpu, const task_t* t) {
+    uint64_t nr = (uint64_t)cfs_nr_running(cpu) + 1;
+    uint64_t period = SCHED_LATENCY_NS;
+    if (nr > SCHED_LATENCY_NS / SCHED_MIN_GRANULARITY_NS) {
+        period = nr * SCHED_MIN_GRANULARITY_NS;
+    }
+    uint64_t total = cpu->cfs_load_weight + t->load_weight;
+    uint64_t slice = total ? period * t->load_weight / total : period;
+    return slice < SCHED_MIN_GRANULARITY_NS ? SCHED_MIN_GRANULARITY_NS : slice;
+}
+
+// Advance cfs_min_vruntime toward min(curr, leftmost); it never goes back.
+static void update_min_vruntime(percpu_t* cpu, task_t* cur) {
+    bool have_curr = cur && !is_idle_task(cur) && !task_is_rt(cur) &&
+                     cur->state == TASK_RUNNING;
+    uint64_t v = have_curr ? cur->vruntime : cpu->cfs_min_vruntime;
+
+    struct rb_node* left = rb_first_cached(&cpu->cfs_tasks);
+    if (left) {
+        uint64_t lv = rb_entry(left, task_t, rq_node)->vruntime;
+        if (!have_curr || vruntime_before(lv, v)) v = lv;
+    }
+    cpu->cfs_min_vruntime = max_vruntime(cpu->cfs_min_vruntime, v);
+}
+
+// ============================================================================
+// REAL-TIME RUN QUEUES
+// ============================================================================
+// One FIFO list per RT priority and a bitmap of non-empty lists per CPU.
+// The queues live beside percpu_t (which has a fixed size) and are protected
+// by the owning CPU's runqueue_lock.
+
+typedef struct rt_rq {
+    uint64_t bitmap[2];             // Bit p set when queue p is non-empty
+    task_t* head[MAX_RT_PRIO];
+    task_t* tail[MAX_RT_PRIO];
+} rt_rq_t;
+
+static rt_rq_t g_rt_rq[MAX_CPUS];
+
+// CPUs with RT tasks waiting in their queue (candidates for rt_pull)
+static volatile uint64_t g_rt_overload_mask = 0;
+
+static int g_rt_throttle_warned = 0;
+
+static inline rt_rq_t* cpu_rt_rq(const percpu_t* cpu) {
+    return &g_rt_rq[cpu->cpu_id];
+}
+
+// Highest queued RT priority, or 0 when no RT task is queued
+static inline int rt_highest_prio(const rt_rq_t* rq) {
+    if (rq->bitmap[1]) return 127 - __builtin_clzll(rq->bitmap[1]);
+    if (rq->bitmap[0]) return 63 - __builtin_clzll(rq->bitmap[0]);
+    return 0;
+}
+
+// Priority of the best task cpu would run right now (-1 idle, 0 fair)
+static inline int cpu_effective_prio(const percpu_t* cpu) {
+    int queued = rt_highest_prio(cpu_rt_rq(cpu));
+    return queued > cpu->curr_prio ? queued : cpu->curr_prio;
+}
+
+// Queued RT tasks are eligible unless the CPU is throttled with fair work waiting
+static inline bool rt_runnable(const percpu_t* cpu) {
+    return cpu->rt_nr_running && !(cpu->rt_throttled && cfs_nr_running(cpu));
+}
+
+static inline void rt_update_overload(percpu_t* cpu) {
+    uint64_t bit = 1ULL << cpu->cpu_id;
+    if (cpu->rt_nr_running) {
+        __atomic_fetch_or(&g_rt_overload_mask, bit, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&g_rt_overload_mask, ~bit, __ATOMIC_RELAXED);
+    }
+}
+
+static void rt_enqueue(percpu_t* cpu, task_t* task, bool at_head) {
+    rt_rq_t* rq = cpu_rt_rq(cpu);
+    int p = task->rt_priority;
+
+    task->rt_next = NULL;
+    if (!rq->head[p]) {
+        rq->head[p] = rq->tail[p] = task;
+        rq->bitmap[p >> 6] |= 1ULL << (p & 63);
+    } else if (at_head) {
+        task->rt_next = rq->head[p];
+        rq->head[p] = task;
+    } else {
+        rq->tail[p]->rt_next = task;
+        rq->tail[p] = task;
+    }
+    cpu->rt_nr_running++;
+    rt_update_overload(cpu);
+}
+
+static void rt_erase(percpu_t* cpu, task_t* task) {
+    rt_rq_t* rq = cpu_rt_rq(cpu);
+    int p = task->rt_priority;
+
+    task_t* prev = NULL;
+    for (task_t* t = rq->head[p]; t && t != task; t = t->rt_next) prev = t;
+    if (prev) {
+        prev->rt_next = task->rt_next;
+    } else {
+        rq->head[p] = task->rt_next;
+    }
+    if (rq->tail[p] == task) rq->tail[p] = prev;
+    if (!rq->head[p]) rq->bitmap[p >> 6] &= ~(1ULL << (p & 63));
+    task->rt_next = NULL;
+    cpu->rt_nr_running--;
+    rt_update_overload(cpu);
+}
+
+// Charge delta of RT runtime: consume the RR quantum and the CPU's RT budget
+static void update_curr_rt(percpu_t* cpu, task_t* cur, uint64_t delta) {
+    if (cur->policy == SCHED_RR) {
+        cur->rt_time_slice = delta >= cur->rt_time_slice ? 0 : cur->rt_time_slice - delta;
+    }
+    cpu->rt_time += delta;
+    if (!cpu->rt_throttled && cpu->rt_time > RT_RUNTIME_NS) {
+        cpu->rt_throttled = 1;
+        if (!g_rt_throttle_warned) {
+            g_rt_throttle_warned = 1;
+            kprintf("sched: RT throttling activated on CPU %u\n", cpu->cpu_id);
+        }
+    }
+}
+
+// Start a new RT throttling period once RT_PERIOD_NS has elapsed
+static void rt_period_tick(percpu_t* cpu) {
+    uint64_t now = sched_clock();
+    if (now - cpu->rt_period_start < RT_PERIOD_NS) return;
+    cpu->rt_period_start = now;
+    cpu->rt_time = 0;
+    cpu->rt_throttled = 0;
+}
+
+// Charge the running task for the time since exec_start.
+// Caller holds the CPU's runqueue_lock (or runs with IRQs off on that CPU).
+static void update_curr(percpu_t* cpu, task_t* cur) {
+    if (!cur || is_idle_task(cur)) return;
+
+    uint64_t now = sched_clock();
+    // exec_start == 0: first accounting for a task that was made current
+    // without going through set_next_task() (bootstrap, fork child)
+    if (cur->exec_start && (int64_t)(now - cur->exec_start) > 0) {
+        uint64_t delta = now - cur->exec_start;
+        cur->sum_exec_runtime += delta;
+        if (task_is_rt(cur)) {
+            update_curr_rt(cpu, cur, delta);
+        } else {
+            cur->vruntime += calc_delta_fair(delta, cur);
+        }
+    }
+    cur->exec_start = now;
+    update_min_vruntime(cpu, cur);
+}
+
+static inline int task_class_prio(const task_t* t) {
+    if (is_idle_task(t)) return -1;
+    return task_is_rt(t) ? t->rt_priority : 0;
+}
+
+// ============================================================================
+// SCHEDULER STATISTICS
+// ============================================================================
+// Per task and per CPU: time spent runnable on a run queue (run delay), CPU
+// grants, migrations, voluntary/involuntary switches, time blocked on a
+// wait_channel or otherwise asleep, and a log2 histogram of wakeup-to-run
+// latency.  Timestamps are sched_clock(); an interval may start on one CPU
+// and end on another, so a negative delta (TSC skew) counts as zero.
+
+static inline uint64_t sched_stat_delta(uint64_t now, uint64_t since) {
+    return (int64_t)(now - since) > 0 ? now - since : 0;
+}
+
+static inline int sched_lat_bucket(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    if (!us) return 0;
+    int b = 64 - __builtin_clzll(us);
+    return b < SCHED_LAT_BUCKETS ? b : SCHED_LAT_BUCKETS - 1;
+}
+
+static void sched_stat_init(task_t* t) {
+    t->sched_last_queued = 0;
+    t->sched_wakeup_ts = 0;
+    t->sched_block_start = 0;
+    t->sched_block_io = false;
+    t->sched_run_delay = 0;
+    t->sched_pcount = 0;
+    t->sched_block_time = 0;
+    t->sched_sleep_time = 0;
+    t->nvcsw = 0;
+    t->nivcsw = 0;
+    t->nr_migrations = 0;
+    for (int i = 0; i < SCHED_LAT_BUCKETS; i++) t->wakeup_lat_hist[i] = 0;
+}
+
+// A blocked or sleeping task was made runnable: close its block interval
+// and start the wakeup-latency clock.  Caller holds the target runqueue_lock.
+static inline void sched_stat_wakeup(task_t* t) {
+    uint64_t now = sched_clock();
+    if (t->sched_block_start) {
+        uint64_t d = sched_stat_delta(now, t->sched_block_start);
+        if (t->sched_block_io) {
+            t->sched_block_time += d;
+        } else {
+            t->sched_sleep_time += d;
+        }
+        t->sched_block_start = 0;
+    }
+    t->sched_wakeup_ts = now;
+}
+
+// t is about to run on cpu: charge the time it waited on a run queue and
+// record its wakeup latency.  A task that keeps the CPU has neither stamp.
+static inline void sched_stat_arrive(percpu_t* cpu, task_t* t, uint64_t now) {
+    if (t->sched_last_queued) {
+        uint64_t d = sched_stat_delta(now, t->sched_last_queued);
+        t->sched_run_delay += d;
+        cpu->sched_run_delay += d;
+        t->sched_last_queued = 0;
+    }
+    if (t->sched_wakeup_ts) {
+        int b = sched_lat_bucket(sched_stat_delta(now, t->sched_wakeup_ts));
+        t->wakeup_lat_hist[b]++;
+        cpu->sched_wakeup_hist[b]++;
+        t->sched_wakeup_ts = 0;
+    }
+    // A wakeup that raced ahead of the switch-away stamp left this behind
+    t->sched_block_start = 0;
+}
+
+// cpu switches from prev to next.  prev's state says why: still READY
+// means it was preempted or yielded, anything else that it gave the CPU
+// up.  Caller holds cpu's runqueue_lock.
+static inline void sched_stat_switch(percpu_t* cpu, task_t* prev, task_t* next) {
+    if (!is_idle_task(next)) {
+        next->sched_pcount++;
+        cpu->sched_pcount++;
+    }
+    if (is_idle_task(prev)) return;
+    if (prev->state == TASK_READY) {
+        prev->nivcsw++;
+        return;
+    }
+    prev->nvcsw++;
+    if (prev->state == TASK_BLOCKED) {
+        prev->sched_block_start = sched_clock();
+        prev->sched_block_io = prev->wait_channel != NULL;
+    }
+}
+
+// Start a fresh slice for a task that is about to (continue to) run on cpu
+static inline void set_next_task(percpu_t* cpu, task_t* t) {
+    uint64_t now = sched_clock();
+    sched_stat_arrive(cpu, t, now);
+    t->exec_start = now;
+    t->prev_sum_exec_runtime = t->sum_exec_runtime;
+    if (task_is_rt(t) && t->rt_time_slice == 0) {
+        t->rt_time_slice = RR_TIMESLICE_NS;
+    }
+    cpu->curr_prio = task_class_prio(t);
+}
+
+// Move a task's vruntime into cpu's base when it comes from another CPU
+static void rq_rebase_vruntime(percpu_t* cpu, task_t* task) {
+    uint32_t cpu_id = cpu->cpu_id;
+    if (task->rq_cpu == cpu_id) return;
+
+    // rq_cpu starts at 0, so only a task that has run before migrates
+    if (task->sched_pcount) {
+        task->nr_migrations++;
+        cpu->sched_migrations++;
+    }
+
+    percpu_t* src = percpu_get(task->rq_cpu);
+    if (src) {
+        task->vruntime = task->vruntime - src->cfs_min_vruntime + cpu->cfs_min_vruntime;
+    }
+    task->rq_cpu = cpu_id;
+}
+
+// Should the running task keep the CPU instead of switching to the best
+// queued task?  Caller holds the runqueue_lock and has just called update_curr().
+static bool keep_current(percpu_t* cpu, task_t* cur) {
+    if (is_idle_task(cur) || cur->has_exited || cur->on_rq ||
+        cur->state != TASK_RUNNING || cur->on_cpu != cpu->cpu_id) {
+        return false;
+    }
+
+    int rt_top = rt_highest_prio(cpu_rt_rq(cpu));
+    if (task_is_rt(cur)) {
+        if (cpu->rt_throttled && cfs_nr_running(cpu)) return false;
+        if (rt_top > cur->rt_priority) return false;
+        // Expired RR quantum: rotate behind an equal-priority peer
+        return !(rt_top == cur->rt_priority && cur->rt_time_slice == 0);
+    }
+    if (rt_runnable(cpu)) return false;
+
+    struct rb_node* left = rb_first_cached(&cpu->cfs_tasks);
+    if (!left) return true;
+    return !vruntime_before(rb_entry(left, task_t, rq_node)->vruntime, cur->vruntime);
+}
+
 // ============================================================================
 // PER-CPU RUN QUEUE MANAGEMENT
 // ============================================================================
-// Per-CPU run queues use task->rq_next for linkage.
-// Only READY tasks live in a run queue.
+// RT tasks go to the CPU's per-priority lists; fair tasks go to a red-black
+// tree of task->rq_node ordered by vruntime whose cached leftmost node is
+// the next fair task to run.  Only READY tasks live in a run queue.
 // Caller MUST hold the target CPU's runqueue_lock.
 
-static void rq_enqueue_locked(percpu_t* cpu, task_t* task) {
+static void rq_enqueue_class(percpu_t* cpu, task_t* task, bool rt_head) {
     uint32_t cpu_id = cpu - percpu_get(0);
     
     // Prevent double-enqueue
@@ -271,50 +746,142 @@ static void rq_enqueue_locked(percpu_t* cpu, task_t* task) {
         kprintf("BUG: double-enqueue pid %d cpu %u\n", task->id, cpu_id);
         return;
     }
-    if (cpu->runqueue_head == task || cpu->runqueue_tail == task) {
-        kprintf("BUG: pid %d already in queue cpu %u\n", task->id, cpu_id);
-        return;
-    }
     if (task->state == TASK_RUNNING) {
         kprintf("BUG: enqueue RUNNING pid %d cpu %u\n", task->id, cpu_id);
         return;
     }
     
-    task->rq_next = NULL;
+    rq_rebase_vruntime(cpu, task);
+    // Keep the stamp when only moving between queues (balancing, reweight)
+    if (!task->sched_last_queued) task->sched_last_queued = sched_clock();
+
+    if (task_is_rt(task)) {
+        rt_enqueue(cpu, task, rt_head);
+        task->on_rq = true;
+        cpu->runqueue_length++;
+        return;
+    }
+
+    struct rb_node** link = &cpu->cfs_tasks.rb_root.rb_node;
+    struct rb_node* parent = NULL;
+    bool leftmost = true;
+    while (*link) {
+        parent = *link;
+        // Equal keys go right so equal-vruntime tasks keep FIFO order
+        if (vruntime_before(task->vruntime, rb_entry(parent, task_t, rq_node)->vruntime)) {
+            link = &parent->rb_left;
+        } else {
+            link = &parent->rb_right;
+            leftmost = false;
+        }
+    }
+    rb_link_node(&task->rq_node, parent, link);
+    rb_insert_color_cached(&task->rq_node, &cpu->cfs_tasks, leftmost);
+
     task->on_rq = true;
-    if (cpu->runqueue_tail) {
-        cpu->runqueue_tail->rq_next = task;
+    cpu->cfs_load_weight += task->load_weight;
+    cpu->runqueue_length++;
+}
+
+static void rq_enqueue_locked(percpu_t* cpu, task_t* task) {
+    rq_enqueue_class(cpu, task, false);
+}
+
+// Put back a task that is being switched away from while still runnable.
+// A preempted RT task keeps its place at the head of its priority; one that
+// yielded or used up its RR quantum (rt_time_slice == 0) goes to the tail.
+static void rq_put_prev_locked(percpu_t* cpu, task_t* task) {
+    rq_enqueue_class(cpu, task, task_is_rt(task) && task->rt_time_slice != 0);
+}
+
+// Unlink a queued task.  Caller holds cpu's runqueue_lock.
+static void rq_erase_locked(percpu_t* cpu, task_t* task) {
+    if (task_is_rt(task)) {
+        rt_erase(cpu, task);
     } else {
-        cpu->runqueue_head = task;
+        rb_erase_cached(&task->rq_node, &cpu->cfs_tasks);
+        cpu->cfs_load_weight -= task->load_weight;
     }
-    cpu->runqueue_tail = task;
-    cpu->runqueue_length++;
+    task->on_rq = false;
+    cpu->runqueue_length--;
 }
 
+// Pick the next task: the highest-priority RT task, unless RT is throttled
+// and fair tasks are waiting, then the fair task with the smallest vruntime.
 static task_t* rq_dequeue_locked(percpu_t* cpu) {
-    task_t* task = cpu->runqueue_head;
-    if (task) {
-        cpu->runqueue_head = task->rq_next;
-        if (!cpu->runqueue_head) {
-            cpu->runqueue_tail = NULL;
-        }
-        task->rq_next = NULL;
-        task->on_rq = false;
-        cpu->runqueue_length--;
-        
-        if (cpu->runqueue_head == task) {
-            kprintf("BUG: circular list detected after dequeue pid %d!\n", task->id);
-        }
+    rt_rq_t* rq = cpu_rt_rq(cpu);
+    int p = rt_highest_prio(rq);
+
+    task_t* task = NULL;
+    struct rb_node* left = rb_first_cached(&cpu->cfs_tasks);
+    if (p && (!cpu->rt_throttled || !left)) {
+        task = rq->head[p];
+    } else if (left) {
+        task = rb_entry(left, task_t, rq_node);
     }
+    if (task) rq_erase_locked(cpu, task);
     return task;
 }
 
+// A queued task may move to another CPU only once it is fully off its old
+// one: not current there, and not possibly the outgoing task of a context
+// switch still in progress.  Caller holds src's runqueue_lock.
+static inline bool task_can_migrate(percpu_t* src, task_t* t, uint32_t dst_cpu) {
+    if (t->cpu_affinity && !(t->cpu_affinity & (1ULL << dst_cpu))) return false;
+    return src->current_task != t && !src->in_context_switch;
+}
+
+// RT pull: take one queued RT task that outranks `floor` from another CPU
+// whose queue is overloaded.  Returns true if a task was pulled onto me.
+// Must not be called with any runqueue_lock held.
+static bool rt_pull(percpu_t* me, int floor) {
+    uint32_t my_cpu = me->cpu_id;
+    uint64_t mask = g_rt_overload_mask & ~(1ULL << my_cpu);
+
+    while (mask) {
+        uint32_t c = (uint32_t)__builtin_ctzll(mask);
+        mask &= mask - 1;
+
+        percpu_t* src = percpu_get(c);
+        if (!src || rt_highest_prio(cpu_rt_rq(src)) <= floor) continue;
+
+        // Lock ordering: always lock lower CPU ID first to prevent deadlock
+        uint64_t flags;
+        percpu_t* first = (my_cpu < c) ? me : src;
+        percpu_t* second = (my_cpu < c) ? src : me;
+        spin_lock_irqsave(&first->runqueue_lock, &flags);
+        spin_lock(&second->runqueue_lock);
+
+        task_t* pick = NULL;
+        rt_rq_t* rq = cpu_rt_rq(src);
+        int p = rt_highest_prio(rq);
+        if (p > floor && p > rt_highest_prio(cpu_rt_rq(me))) {
+            for (task_t* t = rq->head[p]; t; t = t->rt_next) {
+                if (task_can_migrate(src, t, my_cpu)) {
+                    pick = t;
+                    break;
+                }
+            }
+        }
+        if (pick) {
+            rq_erase_locked(src, pick);
+            pick->on_cpu = my_cpu;
+            rq_enqueue_locked(me, pick);
+        }
+
+        spin_unlock(&second->runqueue_lock);
+        spin_unlock_irqrestore(&first->runqueue_lock, flags);
+        if (pick) return true;
+    }
+    return false;
+}
+
 // Remove a specific task from any run queue it might be on.
 // Acquires the appropriate CPU's runqueue_lock.
 static void rq_remove(task_t* task) {
     if (!task->on_rq) return;
 
-    percpu_t* cpu = percpu_get(task->on_cpu);
+    percpu_t* cpu = percpu_get(task->rq_cpu);
     if (!cpu) return;
 
     uint64_t flags;
@@ -326,30 +893,183 @@ static void rq_remove(task_t* task) {
         return;
     }
 
-    if (cpu->runqueue_head == task) {
-        cpu->runqueue_head = task->rq_next;
-        if (!cpu->runqueue_head) cpu->runqueue_tail = NULL;
-    } else {
-        for (task_t* prev = cpu->runqueue_head; prev; prev = prev->rq_next) {
-            if (prev->rq_next == task) {
-                prev->rq_next = task->rq_next;
-                if (cpu->runqueue_tail == task) cpu->runqueue_tail = prev;
-                break;
-            }
+    rq_erase_locked(cpu, task);
+    task->sched_last_queued = 0;
+    task->sched_wakeup_ts = 0;
+
+    spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
+}
+
+// Should a newly queued task p preempt curr?  Caller holds the runqueue_lock.
+static bool check_preempt_wakeup(percpu_t* cpu, task_t* curr, task_t* p) {
+    if (is_idle_task(curr)) return true;
+    if (curr->state != TASK_RUNNING) return false;
+
+    if (task_is_rt(p)) {
+        if (task_is_rt(curr)) return p->rt_priority > curr->rt_priority;
+        return !cpu->rt_throttled;      // Throttled: the fair task keeps running
+    }
+    if (task_is_rt(curr)) return false;
+    if (curr->policy == SCHED_IDLE && p->policy != SCHED_IDLE) return true;
+
+    // Fair wakeup: preempt if the woken task is behind curr by more than
+    // the wakeup granularity
+    return vruntime_before(p->vruntime + calc_delta_fair(SCHED_WAKEUP_GRANULARITY_NS, p),
+                           curr->vruntime);
+}
+
+// Move a waking task from home to dst only if it is not queued and has
+// finished switching away from home (it may be woken before it reaches
+// sched_schedule()).  Returns the CPU to enqueue on.
+static uint32_t wake_target_checked(task_t* task, uint32_t home, uint32_t dst) {
+    percpu_t* home_cpu = percpu_get(home);
+    uint64_t flags;
+    spin_lock_irqsave(&home_cpu->runqueue_lock, &flags);
+    bool ok = !task->on_rq && task_can_migrate(home_cpu, task, dst);
+    spin_unlock_irqrestore(&home_cpu->runqueue_lock, flags);
+    return ok ? dst : home;
+}
+
+// RT wakeup placement (push): if the task's CPU would not run it at once,
+// move it to the allowed CPU running the lowest-priority work.
+static uint32_t rt_select_cpu(task_t* task) {
+    uint32_t home = task->on_cpu;
+    percpu_t* home_cpu = percpu_get(home);
+    if (!home_cpu || cpu_effective_prio(home_cpu) < task->rt_priority) return home;
+
+    uint32_t online = percpu_get_online_count();
+    uint32_t best = home;
+    int best_prio = task->rt_priority;
+    for (uint32_t c = 0; c < online; c++) {
+        percpu_t* cpu = percpu_get(c);
+        if (!cpu || c == home) continue;
+        if (task->cpu_affinity && !(task->cpu_affinity & (1ULL << c))) continue;
+        int prio = cpu_effective_prio(cpu);
+        if (prio < best_prio) {
+            best_prio = prio;
+            best = c;
+            if (prio < 0) break;    // Idle CPU – cannot do better
         }
     }
-    task->rq_next = NULL;
-    task->on_rq = false;
-    cpu->runqueue_length--;
+    if (best == home) return home;
+    return wake_target_checked(task, home, best);
+}
 
-    spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
+// ============================================================================
+// WAKEUP PLACEMENT
+// ============================================================================
+// A waking fair task first picks between its previous CPU (its cache is
+// there) and the waker's CPU (the data the waker just produced is there):
+// an idle candidate wins outright, otherwise the waker's CPU must be less
+// loaded, even with the task added, than the previous CPU scaled by the
+// imbalance percentage.  The winner is then refined to an idle CPU sharing
+// its last-level cache, preferring one whose SMT siblings are idle too.
+
+static inline bool task_allowed_on(const task_t* t, uint32_t c) {
+    return !t->cpu_affinity || (t->cpu_affinity & (1ULL << c));
+}
+
+// Nothing running or queued (read without the lock; placement is a hint)
+static inline bool cpu_is_idle(const percpu_t* cpu) {
+    return cpu->curr_prio < 0 && cpu->runqueue_length == 0;
+}
+
+static bool core_is_idle(uint32_t c) {
+    sched_domain_t* smt = topology_domain(c, SD_LEVEL_SMT);
+    uint64_t span = smt ? smt->span : (1ULL << c);
+    while (span) {
+        uint32_t s = (uint32_t)__builtin_ctzll(span);
+        span &= span - 1;
+        percpu_t* cpu = percpu_get(s);
+        if (cpu && !cpu_is_idle(cpu)) return false;
+    }
+    return true;
+}
+
+static uint32_t wake_affine(task_t* p, uint32_t this_cpu, uint32_t prev) {
+    percpu_t* this_rq = percpu_get(this_cpu);
+    percpu_t* prev_rq = percpu_get(prev);
+    if (!this_rq || !task_allowed_on(p, this_cpu)) return prev;
+
+    if (cpu_is_idle(prev_rq)) return prev;
+    if (cpu_is_idle(this_rq)) return this_cpu;
+
+    uint64_t this_load = cpu_load_now(this_rq) + p->load_weight;
+    uint64_t prev_load = cpu_load_now(prev_rq);
+    if (this_load * 100 < prev_load * g_sched_wake_imbalance_pct) return this_cpu;
+    return prev;
+}
+
+static uint32_t select_idle_sibling(task_t* p, uint32_t prev, uint32_t target) {
+    if (cpu_is_idle(percpu_get(target))) return target;
+    if (prev != target && topology_cpus_share_cache(prev, target) &&
+        cpu_is_idle(percpu_get(prev))) {
+        return prev;
+    }
+
+    sched_domain_t* llc = topology_domain(target, SD_LEVEL_MC);
+    if (!llc || !g_sched_wake_idle_scan) return target;
+
+    // Walk the LLC starting after target so concurrent wakeups spread out
+    uint64_t span = llc->span & ~(1ULL << target);
+    uint64_t order[2] = { span & ~((2ULL << target) - 1), span & ((2ULL << target) - 1) };
+    uint32_t scanned = 0;
+    int idle_cpu = -1;
+    for (int pass = 0; pass < 2; pass++) {
+        uint64_t m = order[pass];
+        while (m && scanned < g_sched_wake_idle_scan) {
+            uint32_t c = (uint32_t)__builtin_ctzll(m);
+            m &= m - 1;
+            scanned++;
+            percpu_t* cpu = percpu_get(c);
+            if (!cpu || !task_allowed_on(p, c) || !cpu_is_idle(cpu)) continue;
+            if (core_is_idle(c)) return c;
+            if (idle_cpu < 0) idle_cpu = (int)c;
+        }
+    }
+    return idle_cpu >= 0 ? (uint32_t)idle_cpu : target;
 }
 
-// Enqueue a READY task to its assigned CPU's run queue.
-// If the target CPU is remote, send a reschedule IPI.
+static uint32_t select_task_rq_fair(task_t* p) {
+    uint32_t prev = p->on_cpu;
+    uint32_t this_cpu = this_cpu_id();
+    if (!percpu_get(prev)) return prev;     // Caller falls back to CPU 0
+
+    wakestat_inc(wakeups);
+    uint32_t target = prev;
+    if (g_sched_wake_affine && this_cpu != prev) {
+        target = wake_affine(p, this_cpu, prev);
+    }
+    target = select_idle_sibling(p, prev, target);
+    if (target != prev) target = wake_target_checked(p, prev, target);
+
+    if (target == prev) {
+        wakestat_inc(wake_prev);
+    } else {
+        wakestat_inc(wake_migrations);
+        if (target == this_cpu) {
+            wakestat_inc(wake_affine);
+        } else {
+            wakestat_inc(wake_idle);
+        }
+    }
+    return target;
+}
+
+// Enqueue a READY task to a run queue chosen by its class's placement
+// (rt_select_cpu / select_task_rq_fair).  If the target CPU is remote,
+// send a reschedule IPI.
 void sched_enqueue_ready(task_t* task) {
     if (!task || is_idle_task(task)) return;
 
+    if (g_smp_initialized && task->state == TASK_READY && !task->on_rq) {
+        if (task_is_rt(task)) {
+            task->on_cpu = rt_select_cpu(task);
+        } else if (topology_domains_ready()) {
+            task->on_cpu = select_task_rq_fair(task);
+        }
+    }
+
     uint32_t target_cpu = task->on_cpu;
     percpu_t* cpu = percpu_get(target_cpu);
     
@@ -363,12 +1083,35 @@ void sched_enqueue_ready(task_t* task) {
     spin_lock_irqsave(&cpu->runqueue_lock, &flags);
     
     if (!task->on_rq && task->state == TASK_READY) {
+        // Sleeper placement: a task returning from a long sleep gets at most
+        // half a latency period of credit, so it runs soon but cannot
+        // monopolise the CPU to "catch up" on the time it was blocked.
+        sched_stat_wakeup(task);
+        rq_rebase_vruntime(cpu, task);
+        if (!task_is_rt(task)) {
+            task->vruntime = max_vruntime(task->vruntime,
+                                          cpu->cfs_min_vruntime - SCHED_LATENCY_NS / 2);
+        }
         rq_enqueue_locked(cpu, task);
+
+        // Wakeup preemption: kick the running task if the woken one should
+        // run ahead of it.  For the local CPU this takes effect on return
+        // from the waking interrupt or syscall.
+        task_t* curr = cpu->current_task;
+        if (curr && curr != task) {
+            if (g_smp_initialized && target_cpu == this_cpu_id()) update_curr(cpu, curr);
+            if (check_preempt_wakeup(cpu, curr, task)) {
+                sched_set_need_resched(curr);
+            }
+        }
     }
     spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
 
-    // If enqueued to a remote CPU, send IPI to wake it from HLT
-    if (g_smp_initialized && target_cpu != this_cpu_id()) {
+    // If enqueued to a remote CPU, wake it: an idle CPU polling
+    // need_resched in MWAIT needs only the flag, others get an IPI
+    if (g_smp_initialized && target_cpu != this_cpu_id() &&
+        !cpuidle_kick_polling(target_cpu)) {
+        wakestat_inc(wake_ipis);
         smp_send_reschedule(target_cpu);
     }
 }
@@ -379,9 +1122,10 @@ void sched_enqueue_ready(task_t* task) {
 
 static void task_init_common(task_t* t) {
     t->next = NULL;
-    t->rq_next = NULL;
+    t->saved_preempt_count = 0;
     t->on_rq = false;
     t->on_cpu = 0;
+    t->rq_cpu = 0;
     t->cpu_affinity = 0;       // 0 = allowed on all CPUs
     t->user_stack_top = 0;
     t->kernel_stack_top = 0;
@@ -393,8 +1137,18 @@ static void task_init_common(task_t* t) {
     t->wait_channel = NULL;
     t->wakeup_tick = 0;
     t->need_resched = 0;
-    t->remaining_ticks = SCHED_TIME_SLICE;
     t->preempt_frame = NULL;
+    t->nice = 0;
+    t->load_weight = NICE_0_LOAD;
+    t->vruntime = 0;
+    t->exec_start = 0;
+    t->sum_exec_runtime = 0;
+    t->prev_sum_exec_runtime = 0;
+    sched_stat_init(t);
+    t->policy = SCHED_NORMAL;
+    t->rt_priority = 0;
+    t->rt_time_slice = 0;
+    t->rt_next = NULL;
     t->parent = NULL;
     t->first_child = NULL;
     t->next_sibling = NULL;
@@ -407,8 +1161,8 @@ static void task_init_common(task_t* t) {
     t->cmdline[0] = '\0';
     t->environ[0] = '\0';
     t->start_tick = timer_ticks();
-    t->utime_ticks = 0;
-    t->stime_ticks = 0;
+    cputime_task_init(t, CPUTIME_SYS);
+    rseq_clear(t);
     t->cwd[0] = '/';
     t->cwd[1] = 0;
     for (int i = 0; i < TASK_MAX_FDS; i++) t->fd_table[i] = NULL;
@@ -478,7 +1232,8 @@ void sched_init(void) {
     // Name the BSP idle task (Linux-like)
     mm_memcpy(g_idle_task.comm, "kernel idle/0", 14);
 
-    kprintf("Preemptive scheduler initialized (time slice=%d ticks)\n", SCHED_TIME_SLICE);
+    kprintf("Preemptive fair scheduler initialized (latency=%llums, min granularity=%llums)\n",
+            SCHED_LATENCY_NS / 1000000ULL, SCHED_MIN_GRANULARITY_NS / 1000000ULL);
 }
 
 task_t* sched_add_task(task_entry_t entry, void* arg, void* stack_mem, size_t stack_size) {
@@ -551,6 +1306,11 @@ task_t* sched_add_user_task(task_entry_t entry, void* arg, uint64_t* pml4,
     *(--k_sp) = 0; *(--k_sp) = 0; *(--k_sp) = 0;
 
     mm_memset(t, 0, sizeof(task_t));
+    if (fpu_task_alloc(t) < 0) {
+        kfree(k_stack_mem);
+        kfree(t);
+        return NULL;
+    }
     t->sp = k_sp;
     t->pml4 = pml4;
     t->entry = entry;
@@ -559,6 +1319,7 @@ task_t* sched_add_user_task(task_entry_t entry, void* arg, uint64_t* pml4,
     t->privilege = TASK_USER;
     t->id = g_next_id++;
     task_init_common(t);
+    t->cputime_ctx = CPUTIME_USER;      // First switch-in irets straight to user mode
     t->user_stack_top = user_stack;
     t->kernel_stack_top = k_stack_top;
     t->kernel_stack_base = k_stack_mem;
@@ -598,13 +1359,124 @@ void sched_tick(void) {
     // Statistics only – time slice management is in timer_irq_handler
 }
 
-// In-kernel cooperative yield.  Mirrors sys_yield() but callable directly
+// Per-CPU scheduler tick, called from timer_irq_handler with IRQs disabled.
+// Charges the running task and requests preemption once it has consumed its
+// weighted slice and someone else is waiting.
+void sched_task_tick(task_t* cur) {
+    if (!cur) return;
+
+    // Always request preemption for a task that is no longer runnable.  In
+    // particular, a ZOMBIE task (killed by signal while running) sits in an
+    // `sti; hlt` loop waiting to be preempted off this CPU.  If it never got
+    // need_resched, sched_preempt would never be called, and
+    // sched_remove_task on another CPU would spin forever waiting for this
+    // CPU to context-switch away.
+    if (cur->has_exited || cur->state != TASK_RUNNING) {
+        sched_set_need_resched(cur);
+        return;
+    }
+    if (!g_smp_initialized) return;
+
+    percpu_t* cpu = this_cpu();
+    if (is_idle_task(cur)) {
+        if (cpu->runqueue_length) {
+            sched_set_need_resched(cur);
+        } else if (rt_pull(cpu, 0)) {
+            sched_set_need_resched(cur);
+        }
+        return;
+    }
+
+    // Skip accounting this tick if the queue is busy; exec_start is left
+    // untouched so the time is charged on the next update.
+    if (!spin_trylock(&cpu->runqueue_lock)) return;
+
+    update_curr(cpu, cur);
+    rt_period_tick(cpu);
+    if (task_is_rt(cur)) {
+        // Higher-priority arrival, throttling, or RR quantum expiry
+        if (!keep_current(cpu, cur)) {
+            sched_set_need_resched(cur);
+        } else if (cur->rt_time_slice == 0) {
+            cur->rt_time_slice = RR_TIMESLICE_NS;   // No peer to rotate with
+        }
+    } else if (cpu->runqueue_length) {
+        uint64_t ran = cur->sum_exec_runtime - cur->prev_sum_exec_runtime;
+        if (rt_runnable(cpu) || ran >= sched_slice(cpu, cur)) {
+            sched_set_need_resched(cur);
+        }
+    }
+    int floor = cpu_effective_prio(cpu);
+
+    spin_unlock(&cpu->runqueue_lock);
+
+    // Pull RT work that is stuck behind higher priorities elsewhere
+    if (rt_pull(cpu, floor)) sched_set_need_resched(cur);
+}
+
+// preempt_count belongs to the task while it is switched out, so a task
+// that sleeps holding a lock neither leaks its count to the next task on
+// this CPU nor brings it back on another one.  Called with interrupts off
+// right before ctx_switch_asm.
+static inline void switch_preempt_count(percpu_t* cpu, task_t* prev, task_t* next) {
+    prev->saved_preempt_count = cpu->preempt_count;
+    cpu->preempt_count = next->saved_preempt_count;
+}
+
+// Voluntary preemption point for process context (e.g. syscall return):
+// honour a pending need_resched set by wakeup preemption without waiting
+// for the next timer tick.
+void sched_cond_resched(void) {
+    if (!g_smp_initialized) return;
+
+    task_t* cur = sched_current();
+    if (!cur || !cur->need_resched || cur->state != TASK_RUNNING) return;
+    if (is_idle_task(cur) || is_bootstrap_task(cur)) return;
+
+    cur->state = TASK_READY;
+    sched_schedule();
+}
+
+// Reached from preempt_enable() when the count drops to zero with the
+// need_resched hint set.  With interrupts off the hint stays set for the
+// interrupt return path or the next preempt_enable() to act on.
+void preempt_schedule(void) {
+    if (!g_smp_initialized) return;
+    uint64_t rflags;
+    __asm__ volatile("pushfq; popq %0" : "=r"(rflags));
+    if (!(rflags & 0x200)) return;
+
+    percpu_t* cpu = this_cpu();
+    if (cpu->preempt_count || cpu->rcu_nesting || cpu->in_context_switch) return;
+    cpu->need_resched = 0;
+    sched_cond_resched();
+}
+
+// In-kernel cooperative yield.  Also backs sys_yield(); callable directly
 // from kernel-mode busy-wait loops (e.g. loopback recv loops) where waiting
 // only on timer preemption can starve a peer task pinned to the same CPU.
 void sched_yield_in_kernel(void) {
     task_t* cur = sched_current();
     if (!cur) return;
-    cur->remaining_ticks = 0;
+
+    if (g_smp_initialized && !is_idle_task(cur)) {
+        // Queue behind every runnable task on this CPU so the yield is
+        // honoured even when cur still has the smallest vruntime.  An RT
+        // task goes to the tail of its priority list.
+        percpu_t* cpu = this_cpu();
+        uint64_t flags;
+        spin_lock_irqsave(&cpu->runqueue_lock, &flags);
+        update_curr(cpu, cur);
+        struct rb_node* last = rb_last(&cpu->cfs_tasks.rb_root);
+        if (task_is_rt(cur)) {
+            cur->rt_time_slice = 0;
+        } else if (last) {
+            cur->vruntime = max_vruntime(cur->vruntime,
+                                         rb_entry(last, task_t, rq_node)->vruntime);
+        }
+        spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
+    }
+
     cur->state = TASK_READY;
     sched_schedule();
 }
@@ -612,21 +1484,36 @@ void sched_yield_in_kernel(void) {
 // Core scheduling function – select next task from local run queue and switch.
 // Caller must set current task's state before calling (TASK_BLOCKED, TASK_ZOMBIE,
 // TASK_READY, etc.).
-void sched_schedule(void) {
+static void schedule_core(void) {
     if (!g_smp_initialized) {
         // Pre-SMP: nothing to schedule yet (timer hasn't started)
         return;
     }
 
+    // Stay on this CPU until the run queue lock turns interrupts off;
+    // otherwise a preemption here could resume us elsewhere with a stale cpu
+    preempt_disable();
     percpu_t* cpu = this_cpu();
     task_t* cur = cpu->current_task;
-    if (!cur) return;
+    if (!cur) {
+        preempt_enable();
+        return;
+    }
+
+    // Before picking, pull RT work that outranks anything queued here
+    rt_pull(cpu, rt_highest_prio(cpu_rt_rq(cpu)));
+    // About to go idle: pull fair work from the nearest busy CPU now
+    if (cur->state != TASK_RUNNING && !cpu->runqueue_length) sched_idle_balance(cpu);
 
     uint64_t flags;
     spin_lock_irqsave(&cpu->runqueue_lock, &flags);
+    preempt_enable_no_resched();
 
     g_total_schedules++;
 
+    // Charge cur for the time it ran before picking the next task
+    update_curr(cpu, cur);
+
     // Dequeue next ready task from local queue FIRST
     task_t* next = rq_dequeue_locked(cpu);
     int my_cpu = this_cpu_id();
@@ -637,7 +1524,7 @@ void sched_schedule(void) {
     // the wakeup path (set READY, enqueue).  Just keep running.
     if (next == cur) {
         cur->state = TASK_RUNNING;
-        cur->remaining_ticks = SCHED_TIME_SLICE;
+        set_next_task(cpu, cur);
         cur->need_resched = 0;
         spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
         return;
@@ -652,7 +1539,7 @@ void sched_schedule(void) {
     if (!next || next == cur) {
         if (cur && !cur->has_exited) {
             cur->state = TASK_RUNNING;
-            cur->remaining_ticks = SCHED_TIME_SLICE;
+            set_next_task(cpu, cur);
             cur->need_resched = 0;
         }
         spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
@@ -674,7 +1561,7 @@ void sched_schedule(void) {
     if (!next || next == cur || next->sp == 0) {
         if (cur && !cur->has_exited) {
             cur->state = TASK_RUNNING;
-            cur->remaining_ticks = SCHED_TIME_SLICE;
+            set_next_task(cpu, cur);
         }
         spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
         return;
@@ -688,7 +1575,7 @@ void sched_schedule(void) {
         (cur->state == TASK_READY || cur->state == TASK_RUNNING) &&
         !is_idle_task(cur) && !cur->on_rq) {
         cur->state = TASK_READY;
-        rq_enqueue_locked(cpu, cur);
+        rq_put_prev_locked(cpu, cur);
     }
 
     task_t* prev = cur;
@@ -696,22 +1583,32 @@ void sched_schedule(void) {
     set_current(next);
 
     next->state = TASK_RUNNING;
-    next->remaining_ticks = SCHED_TIME_SLICE;
+    set_next_task(cpu, next);
     next->need_resched = 0;
     cpu->context_switches++;
+    sched_stat_switch(cpu, prev, next);
+    cputime_task_switch(cpu, prev, next);
+    rseq_preempt(prev);
+
+    // CRITICAL: From here until ctx_switch_asm completes, current_task
+    // already points to next but we are still on prev's kernel stack.  We
+    // MUST re-enable interrupts below so TLB shootdown IPIs can be ACKed
+    // (otherwise we'd timeout).  However, the timer-driven preempt handler
+    // must NOT preempt us here, because it would see current_task == next
+    // and save the wrong RSP into next->sp.  The per-CPU in_context_switch
+    // flag tells sched_preempt to skip us; it is raised before the lock is
+    // dropped so RT migration (task_can_migrate) never moves prev off this
+    // CPU before its stack pointer has been saved.
+    cpu->in_context_switch = 1;
 
     // Release lock but keep interrupts DISABLED through the context switch.
     spin_unlock(&cpu->runqueue_lock);
 
     switch_address_space(prev, next);
+    fpu_switch(prev, next);
+    if (is_idle_task(prev)) cpuidle_exit();
+    rcu_note_context_switch();
 
-    // CRITICAL: We already set cpu->current_task = next, but we are still on
-    // prev's kernel stack.  We MUST re-enable interrupts so TLB shootdown
-    // IPIs can be ACKed (otherwise we'd timeout).  However, the timer-driven
-    // preempt handler must NOT preempt us here, because it would see
-    // current_task == next and save the wrong RSP into next->sp.
-    // The per-CPU in_context_switch flag tells sched_preempt to skip us.
-    this_cpu()->in_context_switch = 1;
     __asm__ volatile("" ::: "memory");  // Compiler barrier — same-CPU store ordering is guaranteed on x86
     __asm__ volatile("sti");
 
@@ -727,6 +1624,7 @@ void sched_schedule(void) {
         this_cpu()->deferred_zombie = prev;
     }
 
+    switch_preempt_count(cpu, prev, next);
     ctx_switch_asm(&prev->sp, next->sp);
 
     // Resumed on the new task's stack.  Always clear the guard — the task
@@ -742,6 +1640,19 @@ void sched_schedule(void) {
     dead_thread_reap();
 }
 
+void sched_schedule(void) {
+    task_t* cur = sched_current();
+    // A workqueue worker blocking inside a work function hands the pool's
+    // remaining work to an idle worker while it sleeps (workqueue.c)
+    if (cur && cur->wq_worker && cur->state == TASK_BLOCKED) {
+        wq_worker_sleeping(cur);
+        schedule_core();
+        wq_worker_running(cur);
+        return;
+    }
+    schedule_core();
+}
+
 // Called from BSP main loop to check if reschedule is needed
 void sched_run_ready(void) {
     if (!g_smp_initialized) return;
@@ -755,8 +1666,11 @@ void sched_run_ready(void) {
 
     cur->need_resched = 0;
 
-    // Check if there's anything to switch to
-    if (!cpu->runqueue_head) {
+    // Check if there's anything to switch to, and whether cur is still
+    // entitled to the CPU ahead of it
+    update_curr(cpu, cur);
+    if (!cpu->runqueue_length || keep_current(cpu, cur)) {
+        set_next_task(cpu, cur);
         spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
         return;
     }
@@ -774,7 +1688,7 @@ void sched_run_ready(void) {
     
     // If still nothing or same as cur, stay on current
     if (!next || next == cur) {
-        if (cur && !cur->has_exited) { cur->state = TASK_RUNNING; cur->remaining_ticks = SCHED_TIME_SLICE; }
+        if (cur && !cur->has_exited) { cur->state = TASK_RUNNING; set_next_task(cpu, cur); }
         spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
         return;
     }
@@ -795,7 +1709,7 @@ void sched_run_ready(void) {
     if (!cur->has_exited && !is_idle_task(cur) &&
         (cur->state == TASK_READY || cur->state == TASK_RUNNING)) {
         cur->state = TASK_READY;
-        rq_enqueue_locked(cpu, cur);
+        rq_put_prev_locked(cpu, cur);
     }
 
     task_t* prev = cur;
@@ -804,18 +1718,25 @@ void sched_run_ready(void) {
 
     if (prev->state == TASK_RUNNING) prev->state = TASK_READY;
     next->state = TASK_RUNNING;
-    next->remaining_ticks = SCHED_TIME_SLICE;
+    set_next_task(cpu, next);
     next->need_resched = 0;
     cpu->context_switches++;
+    sched_stat_switch(cpu, prev, next);
+    cputime_task_switch(cpu, prev, next);
+    rseq_preempt(prev);
+
+    // Same in_context_switch guard as sched_schedule (see comment there).
+    cpu->in_context_switch = 1;
 
     // Release lock but keep interrupts DISABLED through the context switch
     // (same race prevention as in sched_schedule).
     spin_unlock(&cpu->runqueue_lock);
 
     switch_address_space(prev, next);
+    fpu_switch(prev, next);
+    if (is_idle_task(prev)) cpuidle_exit();
+    rcu_note_context_switch();
 
-    // Same in_context_switch guard as sched_schedule (see comment there).
-    this_cpu()->in_context_switch = 1;
     __asm__ volatile("" ::: "memory");
     __asm__ volatile("sti");
 
@@ -828,6 +1749,7 @@ void sched_run_ready(void) {
         this_cpu()->deferred_zombie = prev;
     }
 
+    switch_preempt_count(cpu, prev, next);
     ctx_switch_asm(&prev->sp, next->sp);
 
     // Resumed on the new task's stack.  Always clear the guard.
@@ -850,17 +1772,16 @@ task_t* sched_current(void) {
 }
 
 int sched_has_user_tasks(void) {
-    uint64_t flags;
-    spin_lock_irqsave(&g_task_list_lock, &flags);
-    for (task_t* t = g_task_list_head; t; t = t->next) {
+    rcu_read_lock();
+    for (task_t* t = rcu_dereference(g_task_list_head); t; t = rcu_dereference(t->next)) {
         if (t->privilege == TASK_USER &&
             (t->state == TASK_READY || t->state == TASK_RUNNING || t->state == TASK_BLOCKED) &&
             !t->has_exited && !is_idle_task(t)) {
-            spin_unlock_irqrestore(&g_task_list_lock, flags);
+            rcu_read_unlock();
             return 1;
         }
     }
-    spin_unlock_irqrestore(&g_task_list_lock, flags);
+    rcu_read_unlock();
     return 0;
 }
 
@@ -914,6 +1835,8 @@ void sched_after_fork_child(void) {
     task_t* child = sched_current();
     if (child && child->privilege == TASK_USER) {
         task_load_tls(child);
+        cputime_switch(CPUTIME_USER);
+        rseq_notify_resume(child, NULL);
     }
 
     // Queue deferred zombie but do NOT reap here — fork_child_return calls
@@ -928,9 +1851,17 @@ void sched_after_fork_child(void) {
 
 static void idle_entry(void* arg) {
     (void)arg;
+    sched_idle_loop();
+}
+
+// Idle until need_resched.  A CPU idling in MWAIT is woken by the store to
+// need_resched alone (no IPI), so it must pick the new task itself.
+void sched_idle_loop(void) {
     for (;;) {
-        __asm__ volatile("sti");
-        __asm__ volatile("hlt");
+        cpuidle_enter();
+        if (g_smp_initialized && sched_need_resched()) {
+            sched_schedule();
+        }
     }
 }
 
@@ -938,29 +1869,61 @@ static void idle_entry(void* arg) {
 // PROCESS HIERARCHY MANAGEMENT
 // ============================================================================
 
+// Lock-free walk of the PID hash chain.  The task_t stays valid until
+// the end of the caller's rcu_read_lock() section, if it holds one; its
+// mm, files and stacks may already be gone once has_exited is set.
 task_t* sched_find_task_by_id(uint32_t id) {
-    // Walk global task list
-    uint64_t flags;
-    spin_lock_irqsave(&g_task_list_lock, &flags);
-    for (task_t* t = g_task_list_head; t; t = t->next) {
+    task_t* found = NULL;
+    rcu_read_lock();
+    for (task_hnode_t* n = rcu_dereference(g_pid_hash[pid_hashfn(id)]); n;
+         n = rcu_dereference(n->next)) {
+        task_t* t = container_of(n, task_t, pid_node);
         if ((uint32_t)t->id == id) {
-            spin_unlock_irqrestore(&g_task_list_lock, flags);
-            return t;
+            found = t;
+            break;
         }
     }
-    spin_unlock_irqrestore(&g_task_list_lock, flags);
-    return NULL;
+    rcu_read_unlock();
+    return found;
 }
 
 // Same but caller must hold g_task_list_lock
 task_t* sched_find_task_by_id_locked(uint32_t id) {
-    for (task_t* t = g_task_list_head; t; t = t->next) {
+    for (task_hnode_t* n = g_pid_hash[pid_hashfn(id)]; n; n = n->next) {
+        task_t* t = container_of(n, task_t, pid_node);
         if ((uint32_t)t->id == id)
             return t;
     }
     return NULL;
 }
 
+// Fill out[] with live tasks in ascending PID order.  The caller must be
+// inside rcu_read_lock() for as long as it uses the returned pointers.
+int sched_snapshot_tasks(task_t** out, int max) {
+    int count = 0;
+    for (task_t* t = rcu_dereference(g_task_list_head); t && count < max;
+         t = rcu_dereference(t->next))
+        out[count++] = t;
+
+    // The list is newest-first, so reversing leaves it almost sorted and
+    // the insertion sort below does little work
+    for (int i = 0, j = count - 1; i < j; i++, j--) {
+        task_t* tmp = out[i];
+        out[i] = out[j];
+        out[j] = tmp;
+    }
+    for (int i = 1; i < count; i++) {
+        task_t* t = out[i];
+        int j = i - 1;
+        while (j >= 0 && out[j]->id > t->id) {
+            out[j + 1] = out[j];
+            j--;
+        }
+        out[j + 1] = t;
+    }
+    return count;
+}
+
 void sched_add_child(task_t* parent, task_t* child) {
     if (!parent || !child) return;
     child->parent = parent;
@@ -1103,14 +2066,138 @@ void sched_remove_task(task_t* task) {
     if (task->kernel_stack_base && task->privilege == TASK_USER) {
         kfree(task->kernel_stack_base);
     }
+    fpu_task_free(task);
 
-    kfree(task);
+    // Lock-free task list walkers may still be looking at the task_t
+    call_rcu(&task->rcu, task_free_rcu);
 }
 
 // ============================================================================
 // FORK
 // ============================================================================
 
+// Scheduling state for a freshly copied child (fork/clone).  The child
+// inherits policy, RT priority, nice and weight, starts with zero runtime
+// and a full RR quantum, and is placed one slice after the parent's CPU
+// min_vruntime so forking cannot be used to gain CPU share.
+void sched_fork_init(task_t* child, task_t* parent) {
+    child->policy = parent->policy;
+    child->rt_priority = parent->rt_priority;
+    child->rt_time_slice = RR_TIMESLICE_NS;
+    child->rt_next = NULL;
+    child->nice = parent->nice;
+    child->load_weight = parent->load_weight;
+    child->sum_exec_runtime = 0;
+    child->prev_sum_exec_runtime = 0;
+    child->exec_start = 0;
+    sched_stat_init(child);
+    cputime_task_init(child, CPUTIME_SYS);   // User from sched_after_fork_child
+    child->rq_cpu = parent->rq_cpu;
+    child->vruntime = parent->vruntime;
+
+    percpu_t* cpu = g_smp_initialized ? percpu_get(parent->rq_cpu) : NULL;
+    if (cpu) {
+        uint64_t flags;
+        spin_lock_irqsave(&cpu->runqueue_lock, &flags);
+        uint64_t vslice = calc_delta_fair(sched_slice(cpu, child), child);
+        child->vruntime = max_vruntime(child->vruntime, cpu->cfs_min_vruntime + vslice);
+        spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
+    }
+}
+
+static inline uint32_t task_weight(const task_t* t) {
+    return t->policy == SCHED_IDLE ? SCHED_IDLE_WEIGHT : nice_to_weight(t->nice);
+}
+
+// Set a task's nice level (clamped to NICE_MIN..NICE_MAX).  A queued task is
+// re-inserted so the run queue's total weight stays consistent.  RT tasks
+// remember the value for when they return to the fair class.
+int sched_set_nice(task_t* task, int nice) {
+    if (!task) return -ESRCH;
+    if (nice < NICE_MIN) nice = NICE_MIN;
+    if (nice > NICE_MAX) nice = NICE_MAX;
+
+    percpu_t* cpu = g_smp_initialized ? percpu_get(task->rq_cpu) : NULL;
+    if (!cpu) {
+        task->nice = nice;
+        task->load_weight = task_weight(task);
+        return 0;
+    }
+
+    uint64_t flags;
+    spin_lock_irqsave(&cpu->runqueue_lock, &flags);
+    bool queued = task->on_rq && task->rq_cpu == cpu->cpu_id;
+    if (queued) rq_erase_locked(cpu, task);
+    task->nice = nice;
+    task->load_weight = task_weight(task);
+    if (queued) rq_enqueue_locked(cpu, task);
+    spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
+    return 0;
+}
+
+// Change a task's scheduling policy.  FIFO/RR take rt_priority
+// 1..MAX_RT_PRIO-1; the fair policies require 0.  A queued task moves to
+// its new class's queue, and the CPU it is on re-evaluates preemption.
+int sched_setscheduler(task_t* task, int policy, int rt_priority) {
+    if (!task) return -ESRCH;
+    if (rt_policy(policy)) {
+        if (rt_priority < 1 || rt_priority >= MAX_RT_PRIO) return -EINVAL;
+    } else if (policy == SCHED_NORMAL || policy == SCHED_BATCH || policy == SCHED_IDLE) {
+        if (rt_priority != 0) return -EINVAL;
+    } else {
+        return -EINVAL;
+    }
+    if (is_idle_task(task)) return -EPERM;
+
+    percpu_t* cpu = g_smp_initialized ? percpu_get(task->rq_cpu) : NULL;
+    if (!cpu) {
+        task->policy = policy;
+        task->rt_priority = rt_priority;
+        task->rt_time_slice = RR_TIMESLICE_NS;
+        task->load_weight = task_weight(task);
+        return 0;
+    }
+
+    uint64_t flags;
+    spin_lock_irqsave(&cpu->runqueue_lock, &flags);
+    bool queued = task->on_rq && task->rq_cpu == cpu->cpu_id;
+    bool running = cpu->current_task == task;
+    bool was_rt = task_is_rt(task);
+    if (running) update_curr(cpu, task);
+    if (queued) rq_erase_locked(cpu, task);
+
+    task->policy = policy;
+    task->rt_priority = rt_priority;
+    task->rt_time_slice = RR_TIMESLICE_NS;
+    task->load_weight = task_weight(task);
+    if (was_rt && !task_is_rt(task)) {
+        // vruntime went stale while RT; restart at the CPU's floor
+        task->vruntime = max_vruntime(task->vruntime, cpu->cfs_min_vruntime);
+    }
+
+    bool resched = false;
+    if (queued) {
+        rq_enqueue_locked(cpu, task);
+        task_t* curr = cpu->current_task;
+        if (curr && check_preempt_wakeup(cpu, curr, task)) {
+            sched_set_need_resched(curr);
+            resched = true;
+        }
+    } else if (running) {
+        cpu->curr_prio = task_class_prio(task);
+        if (!keep_current(cpu, task)) {
+            sched_set_need_resched(task);
+            resched = true;
+        }
+    }
+    spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
+
+    if (resched && cpu->cpu_id != this_cpu_id() && !cpuidle_kick_polling(cpu->cpu_id)) {
+        smp_send_reschedule(cpu->cpu_id);
+    }
+    return 0;
+}
+
 task_t* sched_fork_current(void) {
     task_t* cur = sched_current();
     if (!cur || cur->privilege != TASK_USER) return NULL;
@@ -1149,6 +2236,12 @@ task_t* sched_fork_current(void) {
 
     // Copy parent
     mm_memcpy(child, cur, sizeof(task_t));
+    if (fpu_task_fork(child, cur) < 0) {
+        kfree(k_stack_mem);
+        mm_destroy_address_space(child_pml4);
+        kfree(child);
+        return NULL;
+    }
 
     // Child-specific fields
     child->id = g_next_id++;
@@ -1156,8 +2249,8 @@ task_t* sched_fork_current(void) {
     child->state = TASK_READY;
     child->kernel_stack_top = k_stack_top;
     child->kernel_stack_base = k_stack_mem;
-    child->rq_next = NULL;
     child->on_rq = false;
+    child->saved_preempt_count = 0;
     child->parent = cur;
     child->first_child = NULL;
     child->next_sibling = NULL;
@@ -1169,11 +2262,9 @@ task_t* sched_fork_current(void) {
     child->wait_channel = NULL;
     child->wakeup_tick = 0;
     child->need_resched = 0;
-    child->remaining_ticks = SCHED_TIME_SLICE;
     child->preempt_frame = NULL;
+    sched_fork_init(child, cur);
     child->start_tick = timer_ticks();
-    child->utime_ticks = 0;
-    child->stime_ticks = 0;
     
     // Thread group: fork creates a new process (new thread group)
     thread_group_init(child);
@@ -1227,8 +2318,6 @@ task_t* sched_fork_current(void) {
                 unix_socket_t* us = unix_get((int)(uintptr_t)cur->fd_table[i]);
                 if (us) __atomic_fetch_add(&us->ref_count, 1, __ATOMIC_ACQ_REL);
                 child->fd_table[i] = cur->fd_table[i];
-            } else if (IS_EPOLL_FD(cur->fd_table[i])) {
-                child->fd_table[i] = cur->fd_table[i];
             } else if (pipe_is_end(cur->fd_table[i])) {
                 pipe_end_t* new_end = pipe_dup_end((pipe_end_t*)cur->fd_table[i]);
                 child->fd_table[i] = (vfs_file_t*)new_end;
@@ -1290,16 +2379,6 @@ void sched_reap_zombies(task_t* parent) {
     }
 }
 
-// Wake a single blocked task and enqueue it to its CPU's run queue
-static void sched_wake_task(task_t* task) {
-    if (task && task->state == TASK_BLOCKED) {
-        task->state = TASK_READY;
-        task->wait_channel = NULL;
-        task->wakeup_tick = 0;
-        sched_enqueue_ready(task);
-    }
-}
-
 // Wake all tasks blocked on a channel
 void sched_wake_channel(void* channel) {
     if (!channel) return;
@@ -1328,6 +2407,28 @@ void sched_wake_channel(void* channel) {
     }
 }
 
+// Wake a single blocked task and enqueue it to its CPU's run queue.
+// Returns 1 if it was blocked.
+int sched_wake_task(task_t* task) {
+    if (!task) return 0;
+
+    int woken = 0;
+    uint64_t flags;
+    spin_lock_irqsave(&g_task_list_lock, &flags);
+    if (task->state == TASK_BLOCKED) {
+        task->state = TASK_READY;
+        task->wait_channel = NULL;
+        task->wakeup_tick = 0;
+        woken = 1;
+    }
+    spin_unlock_irqrestore(&g_task_list_lock, flags);
+
+    if (woken) {
+        sched_enqueue_ready(task);
+    }
+    return woken;
+}
+
 // Wake tasks whose sleep timer has expired
 void sched_wake_expired_sleepers(uint64_t current_tick) {
     // Collect tasks that we actually wake, then enqueue only those.
@@ -1449,12 +2550,6 @@ void sched_mark_task_exited(task_t* task, int status) {
                     int ufd = (int)(uintptr_t)task->fd_table[i];
                     task->fd_table[i] = NULL;
                     unix_close(ufd);
-                } else if (IS_EPOLL_FD(task->fd_table[i])) {
-                    int idx = EPOLL_FD_IDX(task->fd_table[i]);
-                    task->fd_table[i] = NULL;
-                    extern epoll_instance_t epoll_instances[];
-                    if (idx >= 0 && idx < MAX_EPOLL_INSTANCES)
-                        epoll_instances[idx].active = 0;
                 } else if (pipe_is_end(task->fd_table[i])) {
                     pipe_close_end((pipe_end_t*)task->fd_table[i]);
                     task->fd_table[i] = NULL;
@@ -1630,20 +2725,35 @@ void sched_signal_task(task_t* task, int sig) {
     }
 }
 
-void sched_signal_pgrp(int pgid, int sig) {
-    if (pgid <= 0) return;
+// Walk the process-group hash bucket for pgid.  Caller holds g_task_list_lock.
+#define for_each_pgrp_task(t, n, pg) \
+    for ((n) = g_pgrp_hash[pid_hashfn((uint32_t)(pg))]; (n); (n) = (n)->next) \
+        if (((t) = container_of((n), task_t, pgrp_node))->pgid == (pg))
+
+// Collect up to max live user tasks of process group pgid.  Tasks are freed
+// through call_rcu(), so the pointers stay valid inside the caller's
+// rcu_read_lock() section.
+int sched_collect_pgrp(int pgid, task_t** out, int max) {
+    if (pgid <= 0) return 0;
+    int count = 0;
     uint64_t flags;
     spin_lock_irqsave(&g_task_list_lock, &flags);
-    // Collect targets first to avoid holding task_list_lock during signal delivery
-    #define MAX_PGRP_TARGETS 32
-    task_t* targets[MAX_PGRP_TARGETS];
-    int count = 0;
-    for (task_t* t = g_task_list_head; t && count < MAX_PGRP_TARGETS; t = t->next) {
-        if (t->pgid == pgid && t->state != TASK_ZOMBIE && t->privilege != TASK_KERNEL) {
-            targets[count++] = t;
+    task_hnode_t* n;
+    task_t* t;
+    for_each_pgrp_task(t, n, pgid) {
+        if (count < max && t->state != TASK_ZOMBIE && t->privilege != TASK_KERNEL) {
+            out[count++] = t;
         }
     }
     spin_unlock_irqrestore(&g_task_list_lock, flags);
+    return count;
+}
+
+void sched_signal_pgrp(int pgid, int sig) {
+    // Collect targets first to avoid holding task_list_lock during signal delivery
+    #define MAX_PGRP_TARGETS 32
+    task_t* targets[MAX_PGRP_TARGETS];
+    int count = sched_collect_pgrp(pgid, targets, MAX_PGRP_TARGETS);
     for (int i = 0; i < count; i++) {
         sched_signal_task(targets[i], sig);
     }
@@ -1651,18 +2761,142 @@ void sched_signal_pgrp(int pgid, int sig) {
 
 int sched_pgid_exists(int pgid) {
     if (pgid <= 0) return 0;
+    int found = 0;
     uint64_t flags;
     spin_lock_irqsave(&g_task_list_lock, &flags);
-    for (task_t* t = g_task_list_head; t; t = t->next) {
-        if (t->pgid == pgid && t->state != TASK_ZOMBIE) {
-            spin_unlock_irqrestore(&g_task_list_lock, flags);
-            return 1;
+    task_hnode_t* n;
+    task_t* t;
+    for_each_pgrp_task(t, n, pgid) {
+        if (t->state != TASK_ZOMBIE) {
+            found = 1;
+            break;
         }
     }
     spin_unlock_irqrestore(&g_task_list_lock, flags);
+    return found;
+}
+
+// Session that process group pgid belongs to, or -1 if the group is empty.
+// Unreaped zombies still count as members.
+int sched_pgid_session(int pgid) {
+    if (pgid <= 0) return -1;
+    int sid = -1;
+    uint64_t flags;
+    spin_lock_irqsave(&g_task_list_lock, &flags);
+    task_hnode_t* n;
+    task_t* t;
+    for_each_pgrp_task(t, n, pgid) {
+        sid = t->sid;
+        break;
+    }
+    spin_unlock_irqrestore(&g_task_list_lock, flags);
+    return sid;
+}
+
+// Change a task's process group and session, keeping the indices in step.
+// Tasks not yet on the task list only get the fields set; task_list_add()
+// hashes them.
+void sched_set_pgid_sid(task_t* task, int pgid, int sid) {
+    if (!task) return;
+    uint64_t flags;
+    spin_lock_irqsave(&g_task_list_lock, &flags);
+    bool listed = task->pid_node.pprev != NULL;
+    if (listed) {
+        hnode_del(&task->pgrp_node);
+        hnode_del(&task->session_node);
+    }
+    task->pgid = pgid;
+    task->sid = sid;
+    if (listed)
+        task_hash_groups(task);
+    spin_unlock_irqrestore(&g_task_list_lock, flags);
+}
+
+// getpriority/setpriority target match.  There is a single user, so
+// PRIO_USER selects every user process.
+static bool prio_match(const task_t* t, int which, int who) {
+    if (t->state == TASK_ZOMBIE || t->privilege == TASK_KERNEL) return false;
+    switch (which) {
+        case PRIO_PROCESS: return t->id == who;
+        case PRIO_PGRP:    return t->pgid == who;
+        case PRIO_USER:    return true;
+        default:           return false;
+    }
+}
+
+// Call fn on every task selected by (which, who), going through the PID or
+// process-group index where one applies.  Caller holds g_task_list_lock.
+// Returns the number of tasks visited.
+static int prio_for_each(int which, int who, void (*fn)(task_t*, void*), void* arg) {
+    int count = 0;
+    if (which == PRIO_PROCESS) {
+        task_t* t = who > 0 ? sched_find_task_by_id_locked((uint32_t)who) : NULL;
+        if (t && prio_match(t, which, who)) {
+            fn(t, arg);
+            count++;
+        }
+    } else if (which == PRIO_PGRP) {
+        if (who <= 0) return 0;
+        task_hnode_t* n;
+        task_t* t;
+        for_each_pgrp_task(t, n, who) {
+            if (prio_match(t, which, who)) {
+                fn(t, arg);
+                count++;
+            }
+        }
+    } else {
+        for (task_t* t = g_task_list_head; t; t = t->next) {
+            if (prio_match(t, which, who)) {
+                fn(t, arg);
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static void prio_min_nice(task_t* t, void* arg) {
+    int* best = (int*)arg;
+    if (t->nice < *best) *best = t->nice;
+}
+
+static void prio_set_nice(task_t* t, void* arg) {
+    sched_set_nice(t, *(int*)arg);
+}
+
+// Lowest nice value among the tasks selected by (which, who), or -ESRCH.
+// who == 0 means the calling process / its process group / its user.
+int sched_getpriority(int which, int who, int* nice_out) {
+    task_t* cur = sched_current();
+    if (which < PRIO_PROCESS || which > PRIO_USER) return -EINVAL;
+    if (who == 0 && cur) who = (which == PRIO_PGRP) ? cur->pgid : cur->id;
+
+    int best = NICE_MAX + 1;
+    uint64_t flags;
+    spin_lock_irqsave(&g_task_list_lock, &flags);
+    prio_for_each(which, who, prio_min_nice, &best);
+    spin_unlock_irqrestore(&g_task_list_lock, flags);
+
+    if (best > NICE_MAX) return -ESRCH;
+    *nice_out = best;
     return 0;
 }
 
+// Apply a nice value to every task selected by (which, who).
+int sched_setpriority(int which, int who, int nice) {
+    task_t* cur = sched_current();
+    if (which < PRIO_PROCESS || which > PRIO_USER) return -EINVAL;
+    if (who == 0 && cur) who = (which == PRIO_PGRP) ? cur->pgid : cur->id;
+
+    uint64_t flags;
+    spin_lock_irqsave(&g_task_list_lock, &flags);
+    int found = prio_for_each(which, who, prio_set_nice, &nice);
+    spin_unlock_irqrestore(&g_task_list_lock, flags);
+
+    return found ? 0 : -ESRCH;
+}
+
 // ============================================================================
 // DEBUG DUMP
 // ============================================================================
@@ -1685,12 +2919,16 @@ void sched_dump_tasks(void) {
         percpu_t* cpu = percpu_get(c);
         if (cpu) {
             spin_lock(&cpu->runqueue_lock);
-            int head_pid = cpu->runqueue_head ? ((task_t*)cpu->runqueue_head)->id : -1;
+            struct rb_node* left = rb_first_cached(&cpu->cfs_tasks);
+            int head_pid = left ? rb_entry(left, task_t, rq_node)->id : -1;
             uint32_t rq_len = cpu->runqueue_length;
+            uint32_t rt_len = cpu->rt_nr_running;
+            int rt_top = rt_highest_prio(cpu_rt_rq(cpu));
             uint64_t ctx_sw = cpu->context_switches;
             spin_unlock(&cpu->runqueue_lock);
-            kprintf("  CPU%u: rq_len=%u ctx_sw=%llu head_pid=%d\n",
-                    c, rq_len, ctx_sw, head_pid);
+            kprintf("  CPU%u: rq_len=%u rt=%u rt_top=%d%s ctx_sw=%llu head_pid=%d\n",
+                    c, rq_len, rt_len, rt_top, cpu->rt_throttled ? " throttled" : "",
+                    ctx_sw, head_pid);
         }
     }
 
@@ -1733,7 +2971,11 @@ int sched_need_resched(void) {
 }
 
 void sched_set_need_resched(task_t* t) {
-    if (t) t->need_resched = 1;
+    if (!t) return;
+    t->need_resched = 1;
+    // Let preempt_enable() on this CPU notice without touching the task
+    if (g_smp_initialized && this_cpu()->current_task == t)
+        this_cpu()->need_resched = 1;
 }
 
 // Called from timer IRQ with interrupts disabled
@@ -1747,6 +2989,14 @@ void sched_preempt(interrupt_frame_t* frame) {
     // kernel stack.  Preempting here would save the wrong RSP into next->sp,
     // permanently corrupting its saved stack pointer → triple fault later.
     if (cpu->in_context_switch) return;
+
+    // Readers in rcu_read_lock() must not be switched out; need_resched
+    // stays set and the next interrupt after rcu_read_unlock() retries.
+    if (cpu->rcu_nesting) return;
+
+    // Same for preempt_disable() sections, which include every held
+    // spinlock; the section's final preempt_enable() takes the reschedule
+    if (cpu->preempt_count) return;
     
     task_t* cur = cpu->current_task;
     if (!cur) return;
@@ -1765,6 +3015,17 @@ void sched_preempt(interrupt_frame_t* frame) {
     cur->need_resched = 0;
     cur->preempt_frame = frame;
 
+    // Fair-share check: a runnable task whose vruntime is still at or below
+    // the leftmost queued task keeps the CPU and starts a new slice.
+    update_curr(cpu, cur);
+    if (keep_current(cpu, cur)) {
+        set_next_task(cpu, cur);
+        cur->preempt_frame = NULL;
+        spin_unlock(&cpu->runqueue_lock);
+        local_irq_restore(flags);
+        return;
+    }
+
     // First, dequeue the next task to see what we're switching to
     task_t* next = rq_dequeue_locked(cpu);
     
@@ -1772,7 +3033,7 @@ void sched_preempt(interrupt_frame_t* frame) {
     // still running), just stay on current — this is a normal race.
     if (next == cur) {
         cur->state = TASK_RUNNING;
-        cur->remaining_ticks = SCHED_TIME_SLICE;
+        set_next_task(cpu, cur);
         cur->preempt_frame = NULL;
         spin_unlock(&cpu->runqueue_lock);
         local_irq_restore(flags);
@@ -1788,7 +3049,7 @@ void sched_preempt(interrupt_frame_t* frame) {
     if (!next || next == cur) {
         if (cur && !cur->has_exited) {
             cur->state = TASK_RUNNING;
-            cur->remaining_ticks = SCHED_TIME_SLICE;
+            set_next_task(cpu, cur);
         }
         cur->preempt_frame = NULL;
         spin_unlock(&cpu->runqueue_lock);
@@ -1804,7 +3065,7 @@ void sched_preempt(interrupt_frame_t* frame) {
 
     if (!next || next == cur || next->sp == 0) {
         if (cur && !cur->has_exited) {
-            cur->remaining_ticks = SCHED_TIME_SLICE;
+            set_next_task(cpu, cur);
         }
         cur->preempt_frame = NULL;
         spin_unlock(&cpu->runqueue_lock);
@@ -1820,10 +3081,10 @@ void sched_preempt(interrupt_frame_t* frame) {
         (cur->state == TASK_READY || cur->state == TASK_RUNNING) &&
         !is_idle_task(cur) && !cur->on_rq) {
         cur->state = TASK_READY;
-        rq_enqueue_locked(cpu, cur);
+        rq_put_prev_locked(cpu, cur);
     }
 
-    next->remaining_ticks = SCHED_TIME_SLICE;
+    set_next_task(cpu, next);
 
     task_t* prev = cur;
     cpu->current_task = next;
@@ -1833,11 +3094,21 @@ void sched_preempt(interrupt_frame_t* frame) {
     next->state = TASK_RUNNING;
     g_preempt_count_total++;
     cpu->context_switches++;
+    sched_stat_switch(cpu, prev, next);
+    cputime_task_switch(cpu, prev, next);
+    rseq_preempt(prev);
+
+    // Interrupts stay off until iretq, so this only marks prev as still
+    // on-CPU for task_can_migrate(); cleared once the switch completes.
+    cpu->in_context_switch = 1;
 
     // Release lock but keep interrupts disabled through the switch
     spin_unlock(&cpu->runqueue_lock);
 
     switch_address_space(prev, next);
+    fpu_switch(prev, next);
+    if (is_idle_task(prev)) cpuidle_exit();
+    rcu_note_context_switch();
 
     // CRITICAL SMP FIX: Save zombie pointer in per-CPU data BEFORE the switch.
     // Do NOT queue yet — we are still on prev's kernel stack.
@@ -1849,6 +3120,7 @@ void sched_preempt(interrupt_frame_t* frame) {
         this_cpu()->deferred_zombie = prev;
     }
 
+    switch_preempt_count(cpu, prev, next);
     ctx_switch_asm(&prev->sp, next->sp);
 
     // Resumed from timer preemption. IF is left at 0 — the interrupt
@@ -1993,101 +3265,258 @@ void sched_init_ap(uint32_t cpu_id) {
 // LOAD BALANCING
 // ============================================================================
 
-// Pull-based load balancer.
-// Called periodically from the timer on each CPU (or just BSP).
-// Finds the busiest CPU and pulls one task from it to the calling CPU.
-void sched_load_balance(void) {
-    if (!g_smp_initialized) return;
+// Hierarchical pull-based load balancer.
+// Each CPU balances from its own timer tick, walking its scheduling domains
+// innermost first: SMT siblings, cores sharing the LLC, the package, then
+// the whole system (see topology.c).  Load is the weight of the runnable
+// tasks, smoothed per tick so a momentary burst does not cause migrations.
+// Inner levels balance often with a small imbalance threshold; outer levels
+// balance rarely and need a larger one since the moved task leaves its
+// cache behind.  Recently-run (cache-hot) tasks stay put until a domain has
+// failed to balance a few times.  A CPU about to go idle balances at once
+// (sched_idle_balance) instead of waiting for its next interval.
 
-    uint32_t online = percpu_get_online_count();
-    if (online <= 1) return;
+#define LOAD_AVG_SHIFT           3          // load_avg moves 1/8 of the way per tick
+#define BALANCE_MAX_MOVE         8          // Tasks moved per balance pass
+#define BALANCE_HOT_RETRIES      2          // Failed passes before hot tasks may move
 
-    uint32_t my_cpu = this_cpu_id();
-    percpu_t* me = this_cpu();
-    uint32_t my_len = me->runqueue_length;
+// Instantaneous load: queued weight plus the running task (counted as a
+// nice-0 task so current_task need not be dereferenced without the lock).
+static uint64_t cpu_load_now(const percpu_t* cpu) {
+    uint64_t load = cpu->cfs_load_weight + (uint64_t)cpu->rt_nr_running * NICE_0_LOAD;
+    if (cpu->curr_prio >= 0) load += NICE_0_LOAD;
+    return load;
+}
 
-    // Find busiest CPU
-    uint32_t busiest_cpu = my_cpu;
-    uint32_t busiest_len = my_len;
-    for (uint32_t c = 0; c < online; c++) {
-        if (c == my_cpu) continue;
-        percpu_t* cpu = percpu_get(c);
-        if (cpu && cpu->runqueue_length > busiest_len) {
-            busiest_len = cpu->runqueue_length;
-            busiest_cpu = c;
-        }
-    }
+static void update_cpu_load(percpu_t* cpu) {
+    int64_t diff = (int64_t)cpu_load_now(cpu) - (int64_t)cpu->load_avg;
+    cpu->load_avg += diff >> LOAD_AVG_SHIFT;
+}
+
+// Conservative load views: a source looks as light as it has recently been
+// and a target as heavy, so short spikes in either direction do not move
+// tasks.  An idle target uses its instantaneous load so it can pull at once.
+static uint64_t source_load(const percpu_t* cpu) {
+    uint64_t now = cpu_load_now(cpu);
+    return now < cpu->load_avg ? now : cpu->load_avg;
+}
 
-    // Pull if busiest has at least 1 more task than us
-    if (busiest_cpu == my_cpu || busiest_len < my_len + 1) return;
+static uint64_t target_load(const percpu_t* cpu, bool idle) {
+    uint64_t now = cpu_load_now(cpu);
+    if (idle) return now;
+    return now > cpu->load_avg ? now : cpu->load_avg;
+}
+
+static inline bool task_cache_hot(const task_t* t, uint64_t now) {
+    return now - t->exec_start < g_sched_migration_cost_ns;
+}
 
-    // Pull one task from the busiest CPU
-    percpu_t* src = percpu_get(busiest_cpu);
-    if (!src) return;
+// Move up to BALANCE_MAX_MOVE queued fair tasks worth at most `imbalance`
+// of load from src to me.  Sets *hot_skipped if a cache-hot task was passed
+// over.  Returns the number of tasks moved.  Must not be called with any
+// runqueue_lock held.
+static uint32_t balance_pull(percpu_t* me, percpu_t* src, uint64_t imbalance,
+                             bool allow_hot, bool* hot_skipped) {
+    uint32_t my_cpu = me->cpu_id;
 
     // Lock ordering: always lock lower CPU ID first to prevent deadlock
     uint64_t flags;
-    percpu_t* first = (my_cpu < busiest_cpu) ? me : src;
-    percpu_t* second = (my_cpu < busiest_cpu) ? src : me;
-    
+    percpu_t* first = (my_cpu < src->cpu_id) ? me : src;
+    percpu_t* second = (my_cpu < src->cpu_id) ? src : me;
     spin_lock_irqsave(&first->runqueue_lock, &flags);
     spin_lock(&second->runqueue_lock);
 
-    // Re-check imbalance under locks (might have changed)
-    if (src->runqueue_length < me->runqueue_length + 1) {
-        spin_unlock(&second->runqueue_lock);
-        spin_unlock_irqrestore(&first->runqueue_lock, flags);
-        return;
+    uint64_t now = sched_clock();
+    uint32_t moved = 0;
+
+    // Scan from the right (largest vruntime): the leftmost tasks are about
+    // to run on the source CPU and are the most likely to be cache-hot.
+    struct rb_node* n = rb_last(&src->cfs_tasks.rb_root);
+    while (n && imbalance && moved < BALANCE_MAX_MOVE) {
+        task_t* t = rb_entry(n, task_t, rq_node);
+        n = rb_prev(n);     // Before t is unlinked
+
+        if (is_idle_task(t) || is_bootstrap_task(t) || t->state != TASK_READY) continue;
+        // Checks affinity (0 means all CPUs allowed) and that t is not
+        // still switching off the source CPU
+        if (!task_can_migrate(src, t, my_cpu)) continue;
+        // A task heavier than twice the imbalance would just reverse it
+        if (t->load_weight >= 2 * imbalance) continue;
+        if (!allow_hot && task_cache_hot(t, now)) {
+            *hot_skipped = true;
+            continue;
+        }
+
+        rq_erase_locked(src, t);
+        // Update on_cpu BEFORE adding to destination queue
+        t->on_cpu = my_cpu;
+        rq_enqueue_locked(me, t);   // Rebases vruntime onto this CPU
+        imbalance -= (t->load_weight < imbalance) ? t->load_weight : imbalance;
+        moved++;
     }
 
-    // Find a migratable task:
-    // - Must be READY state (not RUNNING - could be current on source CPU)
-    // - Not idle or bootstrap
-    // - User task (kernel tasks may have CPU affinity)
-    // - Must be allowed to run on destination CPU (check cpu_affinity)
-    task_t* prev_rq = NULL;
-    task_t* migrate = NULL;
-    for (task_t* t = src->runqueue_head; t; t = t->rq_next) {
-        // Check affinity: 0 means all CPUs allowed, otherwise check bitmask
-        bool affinity_ok = (t->cpu_affinity == 0) || 
-                           (t->cpu_affinity & (1ULL << my_cpu));
-        
-        if (!is_idle_task(t) && !is_bootstrap_task(t) && 
-            t->privilege == TASK_USER && t->state == TASK_READY && affinity_ok) {
-            migrate = t;
-            break;
+    if (moved) {
+        task_t* curr = me->current_task;
+        if (curr && is_idle_task(curr)) curr->need_resched = 1;
+    }
+
+    spin_unlock(&second->runqueue_lock);
+    spin_unlock_irqrestore(&first->runqueue_lock, flags);
+    return moved;
+}
+
+// Balance one domain: find its busiest CPU and, if it exceeds our load by
+// the domain's imbalance percentage, pull half the difference.
+static bool balance_domain(percpu_t* me, sched_domain_t* sd, bool idle) {
+    uint64_t my_load = target_load(me, idle);
+    percpu_t* busiest = NULL;
+    uint64_t busiest_load = 0;
+
+    uint64_t span = sd->span & ~(1ULL << me->cpu_id);
+    while (span) {
+        uint32_t c = (uint32_t)__builtin_ctzll(span);
+        span &= span - 1;
+        percpu_t* cpu = percpu_get(c);
+        if (!cpu || !cfs_nr_running(cpu)) continue;    // Nothing it could give
+        uint64_t load = source_load(cpu);
+        if (load > busiest_load) {
+            busiest_load = load;
+            busiest = cpu;
         }
-        prev_rq = t;
     }
 
-    if (!migrate) {
-        spin_unlock(&second->runqueue_lock);
-        spin_unlock_irqrestore(&first->runqueue_lock, flags);
-        return;
+    if (!busiest || busiest_load * 100 <= my_load * sd->imbalance_pct) {
+        sd->nr_failed = 0;
+        return false;
     }
 
-    // Remove from source run queue
-    if (prev_rq) {
-        prev_rq->rq_next = migrate->rq_next;
-    } else {
-        src->runqueue_head = migrate->rq_next;
+    bool hot_skipped = false;
+    uint32_t moved = balance_pull(me, busiest, (busiest_load - my_load) / 2,
+                                  sd->nr_failed > BALANCE_HOT_RETRIES, &hot_skipped);
+    if (moved) {
+        sd->nr_failed = 0;
+    } else if (hot_skipped) {
+        sd->nr_failed++;
     }
-    if (src->runqueue_tail == migrate) {
-        src->runqueue_tail = prev_rq;
+    return moved != 0;
+}
+
+// Periodic balance, called from every CPU's timer tick.
+void sched_load_balance(void) {
+    if (!g_smp_initialized) return;
+
+    percpu_t* me = this_cpu();
+    update_cpu_load(me);
+
+    if (!topology_domains_ready() || percpu_get_online_count() <= 1) return;
+
+    uint32_t my_cpu = me->cpu_id;
+    uint64_t ticks = me->timer_ticks;
+    bool idle = me->curr_prio < 0 && me->runqueue_length == 0;
+
+    for (int level = 0; level < SD_NR_LEVELS; level++) {
+        sched_domain_t* sd = topology_domain(my_cpu, level);
+        if (!sd || !sd->active) continue;
+        if ((int64_t)(ticks - sd->next_balance) < 0) continue;
+
+        sd->next_balance = ticks + (idle ? sd->min_interval : sd->max_interval);
+        if (balance_domain(me, sd, idle)) idle = false;
     }
-    migrate->rq_next = NULL;
-    migrate->on_rq = false;
-    src->runqueue_length--;
+}
 
-    // Update on_cpu BEFORE adding to destination queue
-    // Both locks are held, so no race with scheduler
-    migrate->on_cpu = my_cpu;
+// New-idle balance: the current task is blocking and nothing is queued
+// here, so pull from the nearest busy domain now.  Stops at the first
+// level that yields work.  Must not be called with any runqueue_lock held.
+static void sched_idle_balance(percpu_t* me) {
+    if (!topology_domains_ready()) return;
 
-    // Add to our run queue
-    rq_enqueue_locked(me, migrate);
+    for (int level = 0; level < SD_NR_LEVELS; level++) {
+        sched_domain_t* sd = topology_domain(me->cpu_id, level);
+        if (sd && sd->active && balance_domain(me, sd, true)) return;
+    }
+}
 
-    spin_unlock(&second->runqueue_lock);
-    spin_unlock_irqrestore(&first->runqueue_lock, flags);
+// ============================================================================
+// SCHEDULER TUNABLES AND STATISTICS (SYS_SCHEDCTL)
+// ============================================================================
+
+int sched_tunable_get(int id, uint64_t* value) {
+    switch (id) {
+    case SCHED_TUNE_WAKE_AFFINE:    *value = (uint64_t)g_sched_wake_affine; return 0;
+    case SCHED_TUNE_WAKE_IMBALANCE: *value = g_sched_wake_imbalance_pct; return 0;
+    case SCHED_TUNE_WAKE_IDLE_SCAN: *value = g_sched_wake_idle_scan; return 0;
+    case SCHED_TUNE_MIGRATION_COST: *value = g_sched_migration_cost_ns; return 0;
+    default: return -EINVAL;
+    }
+}
+
+int sched_tunable_set(int id, uint64_t value) {
+    switch (id) {
+    case SCHED_TUNE_WAKE_AFFINE:
+        if (value > 1) return -EINVAL;
+        g_sched_wake_affine = (int)value;
+        return 0;
+    case SCHED_TUNE_WAKE_IMBALANCE:
+        if (value < 100 || value > 1000) return -EINVAL;
+        g_sched_wake_imbalance_pct = (uint32_t)value;
+        return 0;
+    case SCHED_TUNE_WAKE_IDLE_SCAN:
+        if (value > MAX_CPUS) return -EINVAL;
+        g_sched_wake_idle_scan = (uint32_t)value;
+        return 0;
+    case SCHED_TUNE_MIGRATION_COST:
+        if (value > 1000000000ULL) return -EINVAL;
+        g_sched_migration_cost_ns = value;
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+void sched_get_wakestats(k_sched_wakestats_t* out) {
+    mm_memset(out, 0, sizeof(*out));
+    for (uint32_t c = 0; c < MAX_CPUS; c++) {
+        const k_sched_wakestats_t* s = &g_wakestats[c];
+        out->wakeups += __atomic_load_n(&s->wakeups, __ATOMIC_RELAXED);
+        out->wake_prev += __atomic_load_n(&s->wake_prev, __ATOMIC_RELAXED);
+        out->wake_affine += __atomic_load_n(&s->wake_affine, __ATOMIC_RELAXED);
+        out->wake_idle += __atomic_load_n(&s->wake_idle, __ATOMIC_RELAXED);
+        out->wake_migrations += __atomic_load_n(&s->wake_migrations, __ATOMIC_RELAXED);
+        out->wake_ipis += __atomic_load_n(&s->wake_ipis, __ATOMIC_RELAXED);
+    }
+}
+
+void sched_reset_wakestats(void) {
+    mm_memset(g_wakestats, 0, sizeof(g_wakestats));
+    for (uint32_t c = 0; c < MAX_CPUS; c++) {
+        percpu_t* cpu = percpu_get(c);
+        if (!cpu) continue;
+        uint64_t flags;
+        spin_lock_irqsave(&cpu->runqueue_lock, &flags);
+        cpu->sched_run_delay = 0;
+        cpu->sched_pcount = 0;
+        cpu->sched_migrations = 0;
+        for (int i = 0; i < SCHED_LAT_BUCKETS; i++) cpu->sched_wakeup_hist[i] = 0;
+        spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
+    }
+}
+
+_Static_assert(SCHED_LAT_BUCKETS == SCHED_STAT_LAT_BUCKETS,
+               "sched: histogram size must match the SCHEDCTL_CPUSTATS ABI");
+
+int sched_get_cpustats(uint32_t cpu_id, k_sched_cpustats_t* out) {
+    percpu_t* cpu = cpu_id < MAX_CPUS ? percpu_get(cpu_id) : NULL;
+    if (!cpu) return -EINVAL;
+    uint64_t flags;
+    spin_lock_irqsave(&cpu->runqueue_lock, &flags);
+    out->context_switches = cpu->context_switches;
+    out->run_delay_ns = cpu->sched_run_delay;
+    out->pcount = cpu->sched_pcount;
+    out->migrations = cpu->sched_migrations;
+    for (int i = 0; i < SCHED_LAT_BUCKETS; i++) out->wakeup_hist[i] = cpu->sched_wakeup_hist[i];
+    spin_unlock_irqrestore(&cpu->runqueue_lock, flags);
+    out->irq_time_ns = cputime_to_ns(cpu->irq_time_tsc);
+    return 0;
 }
 
 // ============================================================================
@@ -2193,6 +3622,7 @@ void thread_group_remove(task_t* thread) {
     if (leader->nr_threads > 0) {
         leader->nr_threads--;
     }
+    cputime_thread_exit(leader, thread);
     
     // Clear thread's group links
     thread->thread_group_next = thread;
@@ -2363,8 +3793,6 @@ files_struct_t* files_struct_clone(files_struct_t* src) {
                 unix_socket_t* us = unix_get((int)(uintptr_t)src->fd_table[i]);
                 if (us) __atomic_fetch_add(&us->ref_count, 1, __ATOMIC_ACQ_REL);
                 files->fd_table[i] = src->fd_table[i];
-            } else if (IS_EPOLL_FD(src->fd_table[i])) {
-                files->fd_table[i] = src->fd_table[i];
             } else if (pipe_is_end(src->fd_table[i])) {
                 // Pipe end - duplicate it
                 pipe_end_t* new_end = pipe_dup_end((pipe_end_t*)src->fd_table[i]);
@@ -2406,12 +3834,6 @@ void files_struct_put(files_struct_t* files) {
                     int ufd = (int)(uintptr_t)files->fd_table[i];
                     files->fd_table[i] = NULL;
                     unix_close(ufd);
-                } else if (IS_EPOLL_FD(files->fd_table[i])) {
-                    int idx = EPOLL_FD_IDX(files->fd_table[i]);
-                    files->fd_table[i] = NULL;
-                    extern epoll_instance_t epoll_instances[];
-                    if (idx >= 0 && idx < MAX_EPOLL_INSTANCES)
-                        epoll_instances[idx].active = 0;
                 } else if (pipe_is_end(files->fd_table[i])) {
                     pipe_close_end((pipe_end_t*)files->fd_table[i]);
                 } else {
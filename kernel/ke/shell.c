@@ -18,8 +18,7 @@ static int shell_spawn(void) {
     int ret = elf_exec("/bin/sh", argv, envp, &task);
     if (ret == 0 && task) {
         // Make the shell a session leader with its own process group
-        task->pgid = task->id;
-        task->sid  = task->id;
+        sched_set_pgid_sid(task, task->id, task->id);
         tty_t* tty = tty_get_console();
         if (tty) {
             task->ctty = tty;
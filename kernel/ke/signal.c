@@ -7,6 +7,10 @@
 #include "../../include/kernel/status.h"
 #include "../../include/kernel/syscall.h"
 #include "../../include/kernel/percpu.h"
+#include "../../include/kernel/rcu.h"
+#include "../../include/kernel/fpu.h"
+#include "../../include/kernel/rseq.h"
+#include "../../include/kernel/uaccess.h"
 
 // NOTE: Signal delivery now uses per-CPU storage via percpu_t
 // The old global syscall_signal_pending is deprecated.
@@ -181,16 +185,13 @@ int signal_send_group(int pgid, int sig, siginfo_t* info) {
         return -EINVAL;
     }
     
-    int found = 0;
-    
-    // Iterate through all tasks (simplified - would use a proper list in production)
-    for (int pid = 1; pid < 256; pid++) {
-        task_t* t = sched_find_task_by_id(pid);
-        if (t && t->pgid == pgid) {
-            signal_send(t, sig, info);
-            found++;
-        }
+    task_t* targets[32];
+    rcu_read_lock();
+    int found = sched_collect_pgrp(pgid, targets, 32);
+    for (int i = 0; i < found; i++) {
+        signal_send(targets[i], sig, info);
     }
+    rcu_read_unlock();
     
     return found > 0 ? 0 : -ESRCH;
 }
@@ -296,6 +297,49 @@ int signal_dequeue(task_t* task, kernel_sigset_t* mask, siginfo_t* info) {
     return 0;
 }
 
+// Reserve an FPU_ALIGN-aligned area below user_rsp and copy the task's
+// FPU/SIMD state (XSAVE or FXSAVE image) into it.  Returns the stack top
+// left for the signal frame, or 0 if the area would leave user space or
+// the copy faults.
+static uint64_t signal_save_fpstate(task_t* task, uint64_t user_rsp, uint64_t* fpstate) {
+    *fpstate = 0;
+    if (!task->fpu_state) return user_rsp;
+
+    uint32_t size = fpu_state_size();
+    uint64_t addr = (user_rsp - size) & ~(uint64_t)(FPU_ALIGN - 1);
+    if (addr < 0x10000 || addr >= 0x7FFFFFFFFFFF || addr > user_rsp) {
+        return 0;
+    }
+
+    fpu_task_sync(task);
+    if (copy_to_user((void*)addr, task->fpu_state, size)) {
+        return 0;
+    }
+
+    *fpstate = addr;
+    return addr;
+}
+
+// Reload the FPU/SIMD image saved by signal_save_fpstate().  The image is
+// copied to kernel memory and sanitized before XRSTOR sees it.  Returns
+// -1 if the image is outside user space or cannot be read.
+static int signal_restore_fpstate(task_t* task, uint64_t fpstate) {
+    if (!fpstate || !task->fpu_state) return 0;
+
+    uint32_t size = fpu_state_size();
+    if (fpstate < 0x10000 || fpstate + size > 0x7FFFFFFFFFFF) return -1;
+
+    void* image = kalloc(size);
+    if (!image) return 0;
+    if (copy_from_user(image, (const void*)fpstate, size)) {
+        kfree(image);
+        return -1;
+    }
+    fpu_task_load_image(task, image);
+    kfree(image);
+    return 0;
+}
+
 // Setup a signal frame on the user stack
 // Returns 0 on success, -1 on failure
 int signal_setup_frame(task_t* task, int sig, siginfo_t* info, struct k_sigaction* act) {
@@ -306,8 +350,15 @@ int signal_setup_frame(task_t* task, int sig, siginfo_t* info, struct k_sigactio
     uint64_t user_rip = task->syscall_rip;
     uint64_t user_rflags = task->syscall_rflags;
     
+    // FPU/SIMD state goes above the frame, then the frame itself
+    uint64_t fpstate;
+    uint64_t frame_top = signal_save_fpstate(task, user_rsp, &fpstate);
+    if (!frame_top) {
+        return -1;
+    }
+
     // Calculate new stack position for signal frame (16-byte aligned)
-    uint64_t frame_addr = (user_rsp - sizeof(signal_frame_t)) & ~0xFULL;
+    uint64_t frame_addr = (frame_top - sizeof(signal_frame_t)) & ~0xFULL;
     
     // Validate the stack address is in user space
     if (frame_addr < 0x10000 || frame_addr >= 0x7FFFFFFFFFFF) {
@@ -348,6 +399,7 @@ int signal_setup_frame(task_t* task, int sig, siginfo_t* info, struct k_sigactio
     
     // Save current blocked mask
     kframe.saved_mask = task->signals.blocked;
+    kframe.fpstate = fpstate;
     
     // Set up sigreturn trampoline code in the frame
     // mov rax, SYS_RT_SIGRETURN (256)
@@ -371,10 +423,10 @@ int signal_setup_frame(task_t* task, int sig, siginfo_t* info, struct k_sigactio
         kframe.pretcode = frame_addr + __builtin_offsetof(signal_frame_t, retcode);
     }
     
-    // Copy frame to user stack (SMAP-aware)
-    smap_disable();
-    mm_memcpy((void*)frame_addr, &kframe, sizeof(kframe));
-    smap_enable();
+    // Copy frame to user stack
+    if (copy_to_user((void*)frame_addr, &kframe, sizeof(kframe))) {
+        return -1;
+    }
     
     // Update signal mask - block sa_mask and current signal (unless SA_NODEFER)
     sigorset_k(&task->signals.blocked, &task->signals.blocked, &act->sa_mask);
@@ -422,14 +474,25 @@ int signal_setup_frame_irq(task_t* task, int sig, siginfo_t* info,
                            struct k_sigaction* act, interrupt_frame_t* frame) {
     if (!task || !act || !frame) return -1;
 
+    // The handler must see the abort address of an interrupted rseq
+    // critical section, not a point inside it
+    rseq_signal_deliver(task, &frame->rip);
+
     // Get current user context from the IRETQ frame (this is what the CPU
     // pushed when the interrupt fired — the real user RIP/RSP/RFLAGS)
     uint64_t user_rsp    = frame->rsp;
     uint64_t user_rip    = frame->rip;
     uint64_t user_rflags = frame->rflags;
 
+    // FPU/SIMD state goes above the frame, then the frame itself
+    uint64_t fpstate;
+    uint64_t frame_top = signal_save_fpstate(task, user_rsp, &fpstate);
+    if (!frame_top) {
+        return -1;
+    }
+
     // Calculate new stack position for signal frame (16-byte aligned)
-    uint64_t frame_addr = (user_rsp - sizeof(signal_frame_t)) & ~0xFULL;
+    uint64_t frame_addr = (frame_top - sizeof(signal_frame_t)) & ~0xFULL;
 
     // Validate the stack address is in user space
     if (frame_addr < 0x10000 || frame_addr >= 0x7FFFFFFFFFFF) {
@@ -470,6 +533,7 @@ int signal_setup_frame_irq(task_t* task, int sig, siginfo_t* info,
 
     // Save current blocked mask
     kframe.saved_mask = task->signals.blocked;
+    kframe.fpstate = fpstate;
 
     // Set up sigreturn trampoline code
     kframe.retcode[0] = 0x48;  // REX.W
@@ -490,9 +554,9 @@ int signal_setup_frame_irq(task_t* task, int sig, siginfo_t* info,
     }
 
     // Copy frame to user stack
-    smap_disable();
-    mm_memcpy((void*)frame_addr, &kframe, sizeof(kframe));
-    smap_enable();
+    if (copy_to_user((void*)frame_addr, &kframe, sizeof(kframe))) {
+        return -1;
+    }
 
     // Update signal mask
     sigorset_k(&task->signals.blocked, &task->signals.blocked, &act->sa_mask);
@@ -550,9 +614,15 @@ int signal_restore_frame(task_t* task) {
     
     // Read the frame from user space
     signal_frame_t kframe;
-    smap_disable();
-    mm_memcpy(&kframe, (void*)frame_addr, sizeof(kframe));
-    smap_enable();
+    if (copy_from_user(&kframe, (const void*)frame_addr, sizeof(kframe))) {
+        return -1;
+    }
+
+    // Restore FPU/SIMD registers (possibly modified by the handler) before
+    // anything else, so a bad image leaves the task's state untouched
+    if (signal_restore_fpstate(task, kframe.fpstate) < 0) {
+        return -1;
+    }
     
     // Update task's saved values first (safe without cli)
     task->syscall_rip = kframe.rip;
@@ -570,7 +640,7 @@ int signal_restore_frame(task_t* task) {
     
     // Restore signal mask
     task->signals.blocked = kframe.saved_mask;
-    
+
     // Clear sigsuspend flag if set
     task->signals.in_sigsuspend = 0;
     
@@ -692,7 +762,7 @@ void signal_deliver_irq(task_t* task, interrupt_frame_t* frame) {
             case SIG_DFL_CORE:
                 sched_mark_task_exited(task, 128 + signum);
                 // Ensure sched_preempt runs after we return to irq_handler,
-                // even if the timer's remaining_ticks hasn't expired yet.
+                // even if the current time slice hasn't expired yet.
                 sched_set_need_resched(task);
                 break;
             case SIG_DFL_STOP:
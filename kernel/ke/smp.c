@@ -9,6 +9,8 @@
 #include "../../include/kernel/memory.h"
 #include "../../include/kernel/interrupt.h"
 #include "../../include/kernel/sched.h"  // For sched_enable_smp()
+#include "../../include/kernel/topology.h"
+#include "../../include/kernel/fpu.h"
 
 // ============================================================================
 // External Trampoline Symbols
@@ -88,6 +90,7 @@ void ap_entry(void) {
     // CRITICAL: Enable SSE/FPU first, before any code that might use SSE
     // (such as optimized memcpy in kernel functions)
     ap_enable_sse();
+    fpu_init_cpu();
     
     // CRITICAL: Load kernel's GDT and IDT first thing!
     // The AP is currently using the trampoline's minimal GDT but with
@@ -120,6 +123,9 @@ void ap_entry(void) {
     // Initialize per-CPU data for this AP
     percpu_init_cpu(cpu_id, apic_id);
     
+    // Decode this CPU's SMT/core/cache position (CPUID is per-CPU)
+    topology_init_cpu(cpu_id);
+    
     // Initialize per-CPU TSS (each AP needs its own TSS for RSP0)
     tss_init_ap(cpu_id);
     
@@ -153,11 +159,9 @@ void ap_entry(void) {
     
     // Enter idle loop - the scheduler/timer will preempt us when work arrives.
     // When a task is enqueued to our run queue (by fork, wake, or load balance),
-    // the enqueuer sends a reschedule IPI which wakes us from HLT, and the
-    // next timer tick will call sched_preempt() to switch to the new task.
-    while (1) {
-        __asm__ volatile("sti; hlt");
-    }
+    // the enqueuer either stores need_resched on the line we MWAIT on or sends
+    // a reschedule IPI which wakes us from HLT; see cpuidle.c.
+    sched_idle_loop();
 }
 
 // ============================================================================
@@ -210,6 +214,7 @@ void smp_init(uint64_t trampoline_addr) {
     // Update BSP's per-CPU data with APIC ID
     percpu_t* bsp = this_cpu();
     bsp->apic_id = lapic_get_id();
+    topology_init_cpu(0);
     
     // Enable SMP mode in scheduler (use per-CPU current task)
     sched_enable_smp();
@@ -294,6 +299,12 @@ void smp_boot_aps(void) {
         
         smp_dbg("SMP: Starting AP %u (APIC ID %u)...\n", ap_index, cpu->apic_id);
         
+        // The AP points %gs at its per-CPU area before it takes any lock
+        if (!percpu_prepare_ap(ap_index)) {
+            kprintf("SMP: Failed to allocate per-CPU data for AP %u\n", ap_index);
+            continue;
+        }
+        
         // Allocate stack for this AP
         g_ap_stacks[ap_index] = (uint8_t*)kalloc(AP_STACK_SIZE);
         if (!g_ap_stacks[ap_index]) {
@@ -0,0 +1,127 @@
+// LikeOS-64 - Queued Spinlock and Reader-Writer Lock Slow Paths
+//
+// The uncontended paths live inline in spinlock.h.  A CPU that finds the
+// lock taken joins an MCS queue of per-CPU nodes: it links its node behind
+// the previous tail and spins on its own node's flag until the previous
+// waiter hands the queue head over.  Only the head spins on the lock word.
+//
+// Each CPU has one node per context that can be spinning at the same time
+// (task, softirq, interrupt, nested interrupt).  spin_lock() has already
+// disabled preemption, so the task cannot migrate away from its node.
+
+#include "../../include/kernel/spinlock.h"
+#include "../../include/kernel/percpu.h"
+
+#define Q_MAX_NODES     4
+#define Q_TAIL_IDX_BITS 2
+#define Q_TAIL_IDX_MASK ((1U << Q_TAIL_IDX_BITS) - 1)
+
+typedef struct qnode {
+    struct qnode* volatile next;    // Waiter queued behind us
+    volatile int locked;            // Set when we become the queue head
+    int count;                      // Nodes in use on this CPU (node 0 only)
+} qnode_t;
+
+// Four 16-byte nodes per CPU fill exactly one cache line
+static qnode_t g_qnodes[MAX_CPUS][Q_MAX_NODES] __attribute__((aligned(64)));
+
+static inline uint16_t encode_tail(uint32_t cpu, int idx) {
+    return (uint16_t)(((cpu + 1) << Q_TAIL_IDX_BITS) | (uint32_t)idx);
+}
+
+static inline qnode_t* decode_tail(uint16_t tail) {
+    uint32_t cpu = (tail >> Q_TAIL_IDX_BITS) - 1;
+    return &g_qnodes[cpu][tail & Q_TAIL_IDX_MASK];
+}
+
+void queued_spin_lock_slowpath(spinlock_t* lock) {
+    uint32_t cpu = this_cpu_id();
+    qnode_t* node = &g_qnodes[cpu][0];
+    int idx = node->count++;
+
+    // More nested contexts than nodes: spin on the lock word instead
+    if (idx >= Q_MAX_NODES) {
+        while (!queued_spin_trylock(lock))
+            cpu_relax();
+        goto release;
+    }
+
+    node += idx;
+    node->locked = 0;
+    node->next = NULL;
+    __asm__ volatile("" ::: "memory");
+
+    // The owner may have left while we set up the node
+    if (queued_spin_trylock(lock))
+        goto release;
+
+    // Publish our node as the new tail and link behind the old one
+    uint16_t tail = encode_tail(cpu, idx);
+    uint16_t prev_tail = __atomic_exchange_n(&lock->tail, tail, __ATOMIC_ACQ_REL);
+    if (prev_tail) {
+        qnode_t* prev = decode_tail(prev_tail);
+        __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+        while (!__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE))
+            cpu_relax();
+    }
+
+    // Queue head: wait for the owner to release the locked byte.  While the
+    // tail is set nobody else can take the lock, so this is ours next.
+    while (__atomic_load_n(&lock->locked, __ATOMIC_ACQUIRE))
+        cpu_relax();
+
+    // Still the last waiter: take the lock and empty the queue in one step
+    uint32_t val = lock->val;
+    while ((val >> Q_TAIL_SHIFT) == tail) {
+        if (__atomic_compare_exchange_n(&lock->val, &val, Q_LOCKED_VAL, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            goto release;
+    }
+
+    // Others queued behind us: take the lock, then pass the head on
+    lock->locked = 1;
+    qnode_t* next;
+    while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)))
+        cpu_relax();
+    __atomic_store_n(&next->locked, 1, __ATOMIC_RELEASE);
+
+release:
+    g_qnodes[cpu][0].count--;
+}
+
+// ============================================================================
+// Reader-writer lock
+// ============================================================================
+
+void queued_read_lock_slowpath(rwlock_t* lock) {
+    // Back out and wait our turn behind any queued writer
+    __atomic_sub_fetch(&lock->cnts, RW_READER_BIAS, __ATOMIC_RELAXED);
+    spin_lock(&lock->wait_lock);
+
+    // At the queue head only an active writer can still hold us off; a
+    // writer that arrives later sees our bias and waits for us to leave.
+    __atomic_add_fetch(&lock->cnts, RW_READER_BIAS, __ATOMIC_ACQUIRE);
+    while ((__atomic_load_n(&lock->cnts, __ATOMIC_ACQUIRE) & RW_WLOCKED) == RW_WLOCKED)
+        cpu_relax();
+
+    spin_unlock(&lock->wait_lock);
+}
+
+void queued_write_lock_slowpath(rwlock_t* lock) {
+    spin_lock(&lock->wait_lock);
+
+    if (!queued_write_trylock(lock)) {
+        // Stop new readers, then wait for the current ones to drain
+        __atomic_fetch_or(&lock->cnts, RW_WAITING, __ATOMIC_RELAXED);
+        for (;;) {
+            uint32_t expected = RW_WAITING;
+            if (__atomic_load_n(&lock->cnts, __ATOMIC_RELAXED) == RW_WAITING &&
+                __atomic_compare_exchange_n(&lock->cnts, &expected, RW_WLOCKED, 0,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                break;
+            cpu_relax();
+        }
+    }
+
+    spin_unlock(&lock->wait_lock);
+}
@@ -126,6 +126,10 @@ syscall_entry:
     mov rbp, rsp                               ; RBP = top of our saved register area
     
     and rsp, ~0xF
+    ; Sixth argument (user r9, saved above at [rbp + 40]) goes on the stack;
+    ; the padding slot keeps RSP 16-byte aligned at the call
+    sub rsp, 8
+    push qword [rbp + 5*8]
     ; NOTE: Interrupts remain DISABLED here. syscall_handler will enable them
     ; AFTER copying per-CPU values to task-local storage (to prevent race condition
     ; where another task overwrites our per-CPU data before we read it).
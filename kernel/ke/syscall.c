@@ -17,6 +17,7 @@
 #include "../../include/kernel/dirent.h"
 #include "../../include/kernel/serial.h"
 #include "../../include/kernel/percpu.h"
+#include "../../include/kernel/rcu.h"
 #include "../../include/kernel/smp.h"
 #include "../../include/kernel/futex.h"
 #include "../../include/kernel/acpi.h"
@@ -25,70 +26,40 @@
 #include "../../include/kernel/icache.h"
 #include "../../include/kernel/net.h"
 #include "../../include/kernel/lapic.h"
+#include "../../include/kernel/fpu.h"
+#include "../../include/kernel/cpuidle.h"
+#include "../../include/kernel/lockstat.h"
+#include "../../include/kernel/cputime.h"
+#include "../../include/kernel/rseq.h"
+#include "../../include/kernel/syscallstat.h"
+#include "../../include/kernel/io_uring.h"
+#include "../../include/kernel/eventfd.h"
+#include "../../include/kernel/timerfd.h"
+#include "../../include/kernel/eventpoll.h"
+#include "../../include/kernel/hrtimer.h"
+#include "../../include/kernel/uaccess.h"
+#include "../../include/kernel/uio.h"
+#include "../../include/kernel/shmfs.h"
 
 // Validate user pointer is in user space
 static bool validate_user_ptr(uint64_t ptr, size_t len) {
-    if (ptr < 0x10000) return false;  // Reject low addresses (NULL deref protection)
-    if (ptr >= 0x7FFFFFFFFFFF) return false;  // Beyond user space
-    if (ptr + len < ptr) return false;  // Overflow check
-    return true;
+    return access_ok((const void*)ptr, len);
 }
 
-// SMAP-aware copy from user space to kernel space
-// Returns 0 on success, -EFAULT on failure
-static int copy_from_user(void* kernel_dst, const void* user_src, size_t len) {
-    if (!validate_user_ptr((uint64_t)user_src, len)) {
-        return -EFAULT;
-    }
-    if (!kernel_dst || len == 0) {
-        return (len == 0) ? 0 : -EFAULT;
-    }
-    // Temporarily allow supervisor access to user pages (SMAP bypass)
-    smap_disable();
-    mm_memcpy(kernel_dst, user_src, len);
-    // Re-enable SMAP protection
-    smap_enable();
-    return 0;
-}
-
-// SMAP-aware copy from kernel space to user space
-// Returns 0 on success, -EFAULT on failure
-static int copy_to_user(void* user_dst, const void* kernel_src, size_t len) {
-    if (!validate_user_ptr((uint64_t)user_dst, len)) {
-        return -EFAULT;
-    }
-    if (!kernel_src || len == 0) {
-        return (len == 0) ? 0 : -EFAULT;
-    }
-    // Temporarily allow supervisor access to user pages (SMAP bypass)
-    smap_disable();
-    mm_memcpy(user_dst, kernel_src, len);
-    // Re-enable SMAP protection
-    smap_enable();
-    return 0;
-}
-
-// Safe string length (bounded) from user space (SMAP-aware)
+// Safe string length (bounded) from user space
 static int user_strnlen(const char* user_str, size_t max_len, size_t* out_len) {
     if (!user_str || !out_len) {
         return -EFAULT;
     }
-    // Validate entire potential range first
-    if (!validate_user_ptr((uint64_t)user_str, max_len)) {
-        return -EFAULT;
+    long len = strnlen_user(user_str, (long)max_len);
+    if (len < 0) {
+        return (int)len;
     }
-    // Temporarily allow user memory access
-    smap_disable();
-    size_t i;
-    for (i = 0; i < max_len; i++) {
-        if (user_str[i] == '\0') {
-            *out_len = i;
-            smap_enable();
-            return 0;
-        }
+    if ((size_t)len == max_len) {
+        return -EINVAL;  // Too long
     }
-    smap_enable();
-    return -EINVAL;  // Too long
+    *out_len = (size_t)len;
+    return 0;
 }
 
 static int copy_user_string(const char* user_str, size_t max_len, char** out_str, size_t* out_len) {
@@ -106,7 +77,6 @@ static int copy_user_string(const char* user_str, size_t max_len, char** out_str
     if (!kstr) {
         return -ENOMEM;
     }
-    // Use copy_from_user for SMAP-aware copy
     if (copy_from_user(kstr, user_str, len) != 0) {
         kfree(kstr);
         return -EFAULT;
@@ -126,16 +96,13 @@ static int copy_user_path(const char* user_path, char* kbuf, size_t kbuf_size) {
     if (!user_path || !kbuf || kbuf_size < 2) {
         return -EINVAL;
     }
-    char* kstr = NULL;
-    size_t len = 0;
-    int ret = copy_user_string(user_path, kbuf_size - 1, &kstr, &len);
-    if (ret != 0) {
-        return ret;
+    long len = strncpy_from_user(kbuf, user_path, (long)kbuf_size);
+    if (len < 0) {
+        return (int)len;
     }
-    for (size_t i = 0; i <= len; i++) {
-        kbuf[i] = kstr[i];
+    if ((size_t)len == kbuf_size) {
+        return -EINVAL;  // Too long
     }
-    kfree(kstr);
     return 0;
 }
 
@@ -161,10 +128,6 @@ static int copy_user_string_array(const char* const* user_arr, size_t max_count,
         return 0;
     }
 
-    if (!validate_user_ptr((uint64_t)user_arr, sizeof(uint64_t))) {
-        return -EFAULT;
-    }
-
     char** karr = (char**)kalloc((max_count + 1) * sizeof(char*));
     if (!karr) {
         return -ENOMEM;
@@ -173,20 +136,16 @@ static int copy_user_string_array(const char* const* user_arr, size_t max_count,
 
     size_t total = 0;
     for (size_t i = 0; i < max_count; i++) {
-        // SMAP-aware read of user array element
         const char* user_str;
-        smap_disable();
-        user_str = user_arr[i];
-        smap_enable();
+        if (get_user(user_str, &user_arr[i])) {
+            free_user_string_array(karr);
+            return -EFAULT;
+        }
         if (!user_str) {
             karr[i] = NULL;
             *out_arr = karr;
             return 0;
         }
-        if (!validate_user_ptr((uint64_t)user_arr + (i * sizeof(uint64_t)), sizeof(uint64_t))) {
-            free_user_string_array(karr);
-            return -EFAULT;
-        }
 
         char* kstr = NULL;
         size_t len = 0;
@@ -210,175 +169,6 @@ static int copy_user_string_array(const char* const* user_arr, size_t max_count,
     return -EINVAL;  // Too many entries
 }
 
-// Pipe read/write helpers
-static int64_t pipe_read_to_user(pipe_end_t* end, uint64_t buf, uint64_t count) {
-    if (!end || !end->pipe || !end->is_read) {
-        return -EBADF;
-    }
-    pipe_t* pipe = end->pipe;
-
-    if (count == 0) {
-        return 0;
-    }
-    
-    task_t* cur = sched_current();
-    uint64_t flags;
-    
-    spin_lock_irqsave(&pipe->lock, &flags);
-    
-    // Block until data is available or all writers are gone
-    while (pipe->used == 0) {
-        if (pipe->writers == 0) {
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            return 0;  // EOF - no more writers
-        }
-        
-        // Non-blocking mode: return EAGAIN immediately
-        if (end->flags & O_NONBLOCK) {
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            return -EAGAIN;
-        }
-        
-        // Check for pending signals BEFORE blocking
-        if (cur && signal_pending(cur)) {
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            return -EINTR;
-        }
-        
-        // Block waiting for data
-        if (cur) {
-            cur->state = TASK_BLOCKED;
-            cur->wait_channel = pipe;  // Wait on the pipe
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            sched_schedule();
-            spin_lock_irqsave(&pipe->lock, &flags);
-            // NOTE: Do NOT set cur->state = TASK_READY here!
-            // sched_schedule() already set us to TASK_RUNNING on return.
-            // Overwriting with TASK_READY causes SMP double-scheduling.
-            cur->wait_channel = NULL;
-            
-            // Check if we were woken by a signal
-            if (signal_pending(cur)) {
-                spin_unlock_irqrestore(&pipe->lock, flags);
-                return -EINTR;
-            }
-        } else {
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            return -EAGAIN;
-        }
-    }
-
-    size_t to_read = (count < pipe->used) ? count : pipe->used;
-    size_t first = pipe->size - pipe->read_pos;
-    if (first > to_read) {
-        first = to_read;
-    }
-
-    // SMAP-aware copy to user buffer
-    smap_disable();
-    mm_memcpy((void*)buf, pipe->buffer + pipe->read_pos, first);
-    if (to_read > first) {
-        mm_memcpy((void*)(buf + first), pipe->buffer, to_read - first);
-    }
-    smap_enable();
-
-    pipe->read_pos = (pipe->read_pos + to_read) % pipe->size;
-    pipe->used -= to_read;
-    
-    spin_unlock_irqrestore(&pipe->lock, flags);
-
-    // Wake up writers outside the lock
-    sched_wake_channel(pipe);
-
-    return (int64_t)to_read;
-}
-
-static int64_t pipe_write_from_user(pipe_end_t* end, uint64_t buf, uint64_t count) {
-    if (!end || !end->pipe || end->is_read) {
-        return -EBADF;
-    }
-    pipe_t* pipe = end->pipe;
-
-    if (count == 0) {
-        return 0;
-    }
-
-    task_t* cur = sched_current();
-    uint64_t flags;
-
-    spin_lock_irqsave(&pipe->lock, &flags);
-
-    if (pipe->readers == 0) {
-        spin_unlock_irqrestore(&pipe->lock, flags);
-        if (cur) {
-            sched_signal_task(cur, SIGPIPE);
-        }
-        return -EPIPE;
-    }
-
-    // Block while pipe is full, waiting for readers to consume data
-    while (pipe->used == pipe->size) {
-        // Re-check readers (may have closed while we waited)
-        if (pipe->readers == 0) {
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            if (cur) {
-                sched_signal_task(cur, SIGPIPE);
-            }
-            return -EPIPE;
-        }
-
-        // Check for pending signals BEFORE blocking
-        if (cur && signal_pending(cur)) {
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            return -EINTR;
-        }
-
-        // Block waiting for space
-        if (cur) {
-            cur->state = TASK_BLOCKED;
-            cur->wait_channel = pipe;
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            sched_schedule();
-            spin_lock_irqsave(&pipe->lock, &flags);
-            cur->wait_channel = NULL;
-
-            // Check if we were woken by a signal
-            if (signal_pending(cur)) {
-                spin_unlock_irqrestore(&pipe->lock, flags);
-                return -EINTR;
-            }
-        } else {
-            spin_unlock_irqrestore(&pipe->lock, flags);
-            return -EAGAIN;
-        }
-    }
-
-    size_t space = pipe->size - pipe->used;
-    size_t to_write = (count < space) ? count : space;
-    size_t first = pipe->size - pipe->write_pos;
-    if (first > to_write) {
-        first = to_write;
-    }
-
-    // SMAP-aware copy from user buffer
-    smap_disable();
-    mm_memcpy(pipe->buffer + pipe->write_pos, (void*)buf, first);
-    if (to_write > first) {
-        mm_memcpy(pipe->buffer, (void*)(buf + first), to_write - first);
-    }
-    smap_enable();
-
-    pipe->write_pos = (pipe->write_pos + to_write) % pipe->size;
-    pipe->used += to_write;
-    
-    spin_unlock_irqrestore(&pipe->lock, flags);
-    
-    // Wake up any readers blocked on this pipe
-    sched_wake_channel(pipe);
-
-    return (int64_t)to_write;
-}
-
 // Allocate a file descriptor for current task
 static int alloc_fd(task_t* task) {
     // Start at 3 to skip stdin(0), stdout(1), stderr(2)
@@ -390,6 +180,17 @@ static int alloc_fd(task_t* task) {
     return -EMFILE;  // Too many open files
 }
 
+// The vfs_file_t behind an fd table entry, or NULL for the console, socket
+// and pipe entries that share the table
+static vfs_file_t* fd_entry_file(void* entry) {
+    uintptr_t marker = (uintptr_t)entry;
+    if (marker <= 3 || IS_SOCKET_FD(entry) || IS_UNIX_SOCKET_FD(entry) ||
+        pipe_is_end(entry)) {
+        return NULL;
+    }
+    return (vfs_file_t*)entry;
+}
+
 // Forward declarations for helper syscalls used before definition
 static int64_t sys_getpid(void);
 static void sys_exit(uint64_t status);
@@ -498,7 +299,7 @@ static int64_t sys_read(uint64_t fd, uint64_t buf, uint64_t count) {
         if (!validate_user_ptr(buf, count)) {
             return -EFAULT;
         }
-        return pipe_read_to_user((pipe_end_t*)file, buf, count);
+        return pipe_read((pipe_end_t*)file, buf, count, 0);
     }
 
     // Respect open flags (deny read on write-only)
@@ -572,7 +373,7 @@ static int64_t sys_write(uint64_t fd, uint64_t buf, uint64_t count) {
         if (!validate_user_ptr(buf, count)) {
             return -EFAULT;
         }
-        return pipe_write_from_user((pipe_end_t*)file, buf, count);
+        return pipe_write((pipe_end_t*)file, buf, count, 0);
     }
 
     // Respect open flags (deny write on read-only)
@@ -734,17 +535,6 @@ static int64_t sys_close(uint64_t fd) {
         return unix_close(ufd);
     }
 
-    // Check for epoll fd markers
-    if (IS_EPOLL_FD(file)) {
-        int idx = EPOLL_FD_IDX(file);
-        cur->fd_table[fd] = NULL;
-        // Mark epoll instance as inactive
-        extern epoll_instance_t epoll_instances[];
-        if (idx >= 0 && idx < MAX_EPOLL_INSTANCES)
-            epoll_instances[idx].active = 0;
-        return 0;
-    }
-
     if (pipe_is_end(file)) {
         pipe_close_end((pipe_end_t*)file);
         cur->fd_table[fd] = NULL;
@@ -773,9 +563,8 @@ static int64_t sys_lseek(uint64_t fd, int64_t offset, uint64_t whence) {
     
     vfs_file_t* file = cur->fd_table[fd];
     
-    // Check for console dup markers - not seekable
-    uint64_t marker = (uint64_t)file;
-    if (marker >= 1 && marker <= 3) {
+    // Console markers, sockets and pipes are not seekable
+    if (!fd_entry_file(file)) {
         return -ESPIPE;
     }
     
@@ -1113,9 +902,8 @@ static int64_t sys_uname(uint64_t buf) {
 
 static int64_t sys_time(uint64_t tloc) {
     uint64_t sec = timer_get_epoch();
-    if (tloc && validate_user_ptr(tloc, sizeof(uint64_t))) {
-        copy_to_user((void*)tloc, &sec, sizeof(sec));
-    }
+    if (tloc && copy_to_user((void*)tloc, &sec, sizeof(sec)) != 0)
+        return -EFAULT;
     return (int64_t)sec;
 }
 
@@ -1153,7 +941,10 @@ static int64_t sys_fsync(uint64_t fd) {
     task_t* cur = sched_current();
     if (!cur) return -EFAULT;
     if (fd >= TASK_MAX_FDS || cur->fd_table[fd] == NULL) return -EBADF;
-    vfs_file_t* file = cur->fd_table[fd];
+    vfs_file_t* file = fd_entry_file(cur->fd_table[fd]);
+    if (!file) return -EINVAL;
+    // Only root filesystem files have dirty pages to write back
+    if (!vfs_on_root(file)) return 0;
     fat32_file_t* ff = (fat32_file_t*)file->fs_private;
     if (ff && ff->start_cluster >= 2) {
         pagecache_flush_file(ff->start_cluster);
@@ -1173,8 +964,11 @@ static int64_t sys_ftruncate(uint64_t fd, uint64_t length) {
     task_t* cur = sched_current();
     if (!cur) return -EFAULT;
     if (fd >= TASK_MAX_FDS || cur->fd_table[fd] == NULL) return -EBADF;
-    vfs_file_t* file = cur->fd_table[fd];
-    return vfs_truncate(file, (unsigned long)length);
+    vfs_file_t* file = fd_entry_file(cur->fd_table[fd]);
+    if (!file) return -EINVAL;
+    int ret = vfs_truncate(file, (unsigned long)length);
+    if (ret == ST_UNSUPPORTED) return -EINVAL;
+    return ret < 0 ? vfs_status_to_errno(ret) : ret;
 }
 
 static int64_t sys_fcntl(uint64_t fd, uint64_t cmd, uint64_t arg) {
@@ -1245,14 +1039,6 @@ static int64_t sys_fcntl(uint64_t fd, uint64_t cmd, uint64_t arg) {
         return -EINVAL;
     }
 
-    // Epoll fd markers
-    if (IS_EPOLL_FD(file)) {
-        if (cmd == F_GETFD) return 0;
-        if (cmd == F_SETFD) return 0;
-        if (cmd == F_GETFL) return O_RDWR;
-        return -EINVAL;
-    }
-
     if (pipe_is_end(file)) {
         pipe_end_t* end = (pipe_end_t*)file;
         if (cmd == 3) {
@@ -1264,6 +1050,8 @@ static int64_t sys_fcntl(uint64_t fd, uint64_t cmd, uint64_t arg) {
             end->flags = (end->flags & ~O_NONBLOCK) | ((uint32_t)arg & O_NONBLOCK);
             return 0;
         }
+        if (cmd == F_GETPIPE_SZ) return pipe_get_size(end->pipe);
+        if (cmd == F_SETPIPE_SZ) return pipe_set_size(end->pipe, (unsigned long)arg);
         if (cmd == F_GETFD) return 0;
         if (cmd == F_SETFD) return 0;
         return -EINVAL;
@@ -1359,11 +1147,22 @@ static int64_t sys_setpgid(uint64_t pid, uint64_t pgid) {
     if (pgid == 0) {
         pgid = pid;
     }
+    if ((int64_t)pgid < 0) {
+        return -EINVAL;
+    }
     task_t* t = sched_find_task_by_id((uint32_t)pid);
     if (!t) {
         return -ESRCH;
     }
-    t->pgid = (int)pgid;
+    // A session leader cannot move, and a group can only be joined from
+    // within the same session
+    if (t->sid == t->id) {
+        return (t->pgid == (int)pgid) ? 0 : -EPERM;
+    }
+    if ((int)pgid != t->id && sched_pgid_session((int)pgid) != t->sid) {
+        return -EPERM;
+    }
+    sched_set_pgid_sid(t, (int)pgid, t->sid);
     return 0;
 }
 
@@ -1428,15 +1227,14 @@ static int64_t sys_tcsetpgrp(uint64_t fd, uint64_t pgrp) {
 // On success the calling process becomes session leader, gets a new
 // process group, and is detached from any controlling tty.  Returns
 // the new session ID (the pid).  Returns -EPERM if the caller is
-// already a process-group leader.
+// already a process-group leader or its pid is in use as a group ID.
 static int64_t sys_setsid(void) {
     task_t* cur = sched_current();
     if (!cur) return -EFAULT;
-    if (cur->pgid == (int)cur->id) {
+    if (cur->pgid == (int)cur->id || sched_pgid_session((int)cur->id) >= 0) {
         return -EPERM;
     }
-    cur->sid  = (int)cur->id;
-    cur->pgid = (int)cur->id;
+    sched_set_pgid_sid(cur, (int)cur->id, (int)cur->id);
     cur->ctty = NULL;
     return cur->id;
 }
@@ -1461,174 +1259,550 @@ static int64_t sys_getpgid(uint64_t pid) {
     return t->pgid;
 }
 
-// POSIX getrusage(2) - resource usage.
-// We don't track per-process CPU time accurately yet; return zeros.
+// POSIX getrusage(2) - resource usage of the calling process (the whole
+// thread group), the calling thread, or the reaped children.  Layout
+// matches the libc struct rusage subset (also filled by wait4).
 struct k_rusage_compat {
     int64_t ru_utime_sec;  int64_t ru_utime_usec;
     int64_t ru_stime_sec;  int64_t ru_stime_usec;
-    int64_t ru_pad[14];
+    int64_t ru_maxrss;
+    int64_t ru_minflt;
+    int64_t ru_majflt;
+    int64_t ru_nvcsw;
+    int64_t ru_nivcsw;
 };
+
+static void rusage_set_times(struct k_rusage_compat* ru, uint64_t utime_ns, uint64_t stime_ns) {
+    ru->ru_utime_sec  = (int64_t)(utime_ns / 1000000000ULL);
+    ru->ru_utime_usec = (int64_t)(utime_ns % 1000000000ULL / 1000);
+    ru->ru_stime_sec  = (int64_t)(stime_ns / 1000000000ULL);
+    ru->ru_stime_usec = (int64_t)(stime_ns % 1000000000ULL / 1000);
+}
+
 static int64_t sys_getrusage(uint64_t who, uint64_t uptr) {
-    (void)who;
+    task_t* cur = sched_current();
+    if (!cur) return -ESRCH;
     if (!uptr) return -EFAULT;
     if (!validate_user_ptr(uptr, sizeof(struct k_rusage_compat))) return -EFAULT;
     struct k_rusage_compat ru;
     for (size_t i = 0; i < sizeof(ru); i++) ((uint8_t*)&ru)[i] = 0;
+    uint64_t utime_ns, stime_ns;
+    switch ((int)who) {
+        case RUSAGE_SELF:
+            cputime_group(cur, &utime_ns, &stime_ns);
+            break;
+        case RUSAGE_THREAD:
+            cputime_thread(cur, &utime_ns, &stime_ns);
+            break;
+        case RUSAGE_CHILDREN:
+            cputime_children(cur, &utime_ns, &stime_ns);
+            break;
+        default:
+            return -EINVAL;
+    }
+    rusage_set_times(&ru, utime_ns, stime_ns);
+    if ((int)who != RUSAGE_CHILDREN) {
+        ru.ru_nvcsw = (int64_t)cur->nvcsw;
+        ru.ru_nivcsw = (int64_t)cur->nivcsw;
+    }
     if (copy_to_user((void*)uptr, &ru, sizeof(ru)) != 0) return -EFAULT;
     return 0;
 }
 
-// POSIX writev(2) / readv(2) - scatter/gather I/O implemented as a loop
-// over write(2) / read(2).  Per POSIX the implementation is allowed to
-// process the iovecs sequentially; the only invariant is partial-write
-// semantics on errors mid-stream.  Returns total bytes transferred.
-struct k_iovec_compat { uint64_t iov_base; uint64_t iov_len; };
+// POSIX times(2) - process and reaped-children CPU times in clock ticks
+// (USER_HZ, the sysconf(_SC_CLK_TCK) value); returns the elapsed ticks
+// since boot in the same unit.
+struct k_tms {
+    int64_t tms_utime;
+    int64_t tms_stime;
+    int64_t tms_cutime;
+    int64_t tms_cstime;
+};
 
-static int64_t sys_writev(uint64_t fd, uint64_t iovp, uint64_t iovcnt) {
-    if (iovcnt > 1024) return -EINVAL;
-    if (!iovp) return -EFAULT;
-    if (!validate_user_ptr(iovp, iovcnt * sizeof(struct k_iovec_compat))) return -EFAULT;
-    int64_t total = 0;
-    for (uint64_t i = 0; i < iovcnt; i++) {
-        struct k_iovec_compat iov;
-        if (copy_from_user(&iov, (void*)(iovp + i * sizeof(iov)), sizeof(iov)) != 0)
-            return total ? total : -EFAULT;
-        if (iov.iov_len == 0) continue;
-        int64_t r = sys_write(fd, iov.iov_base, iov.iov_len);
-        if (r < 0) return total ? total : r;
-        total += r;
-        if ((uint64_t)r < iov.iov_len) break;  // short write
+static int64_t sys_times(uint64_t uptr) {
+    task_t* cur = sched_current();
+    if (!cur) return -ESRCH;
+    if (uptr) {
+        if (!validate_user_ptr(uptr, sizeof(struct k_tms))) return -EFAULT;
+        uint64_t utime_ns, stime_ns, cutime_ns, cstime_ns;
+        cputime_group(cur, &utime_ns, &stime_ns);
+        cputime_children(cur, &cutime_ns, &cstime_ns);
+        struct k_tms tms;
+        tms.tms_utime  = (int64_t)(utime_ns / (1000000000ULL / USER_HZ));
+        tms.tms_stime  = (int64_t)(stime_ns / (1000000000ULL / USER_HZ));
+        tms.tms_cutime = (int64_t)(cutime_ns / (1000000000ULL / USER_HZ));
+        tms.tms_cstime = (int64_t)(cstime_ns / (1000000000ULL / USER_HZ));
+        if (copy_to_user((void*)uptr, &tms, sizeof(tms)) != 0) return -EFAULT;
     }
-    return total;
+    return (int64_t)(timer_get_precise_us() / (1000000ULL / USER_HZ));
 }
 
-static int64_t sys_readv(uint64_t fd, uint64_t iovp, uint64_t iovcnt) {
-    if (iovcnt > 1024) return -EINVAL;
-    if (!iovp) return -EFAULT;
-    if (!validate_user_ptr(iovp, iovcnt * sizeof(struct k_iovec_compat))) return -EFAULT;
+// ============================================================================
+// Vectored and positional I/O
+// ============================================================================
+// readv/writev and the pread/pwrite family hand one iterator over all of
+// the caller's buffers to the file, pipe or socket, which moves the data
+// in a single pass: a file walks its page cache once, a datagram is one
+// message however it is split.  Consoles, ttys and unix sockets still take
+// one read/write per segment.  Positional calls need a file that can seek
+// (ESPIPE otherwise) and leave its file position alone.
+
+// One sys_read/sys_write per segment, stopping at the first short one
+static int64_t rw_by_segment(uint64_t fd, iov_iter_t* it, bool write) {
     int64_t total = 0;
-    for (uint64_t i = 0; i < iovcnt; i++) {
-        struct k_iovec_compat iov;
-        if (copy_from_user(&iov, (void*)(iovp + i * sizeof(iov)), sizeof(iov)) != 0)
-            return total ? total : -EFAULT;
-        if (iov.iov_len == 0) continue;
-        int64_t r = sys_read(fd, iov.iov_base, iov.iov_len);
+    while (it->count) {
+        uint64_t base = (uint64_t)it->iov->iov_base + it->iov_offset;
+        uint64_t len = it->iov->iov_len - it->iov_offset;
+        if (len > it->count) len = it->count;
+        int64_t r = write ? sys_write(fd, base, len) : sys_read(fd, base, len);
         if (r < 0) return total ? total : r;
+        iov_iter_advance(it, (uint64_t)r);
         total += r;
-        if (r == 0) break;  // EOF
-        if ((uint64_t)r < iov.iov_len) break;  // short read
+        if ((uint64_t)r < len) break;
     }
     return total;
 }
 
-// Forward declaration for signal functions
-extern ktimer_t timer_create_internal(task_t* task, clockid_t clockid, struct k_sigevent* sevp);
-extern int timer_settime_internal(ktimer_t timerid, int flags, 
-                                  const struct k_itimerspec* new_value,
-                                  struct k_itimerspec* old_value);
-extern int timer_gettime_internal(ktimer_t timerid, struct k_itimerspec* curr_value);
-extern int timer_getoverrun_internal(ktimer_t timerid);
-extern int timer_delete_internal(ktimer_t timerid);
+// pos is VFS_POS_CUR or a file offset; flags are RWF_*
+static int64_t do_iter_rw(uint64_t fd, iov_iter_t* it, int64_t pos, int flags, bool write) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+    if (fd >= TASK_MAX_FDS) return -EBADF;
+    void* entry = cur->fd_table[fd];
+    vfs_file_t* file = fd_entry_file(entry);
 
-static void kill_task(task_t* t, int sig) {
-    if (!t) {
-        return;
+    if (!file) {
+        if (pos != VFS_POS_CUR) return (entry || fd <= STDERR_FD) ? -ESPIPE : -EBADF;
+        bool nowait = (flags & RWF_NOWAIT) != 0;
+        if (pipe_is_end(entry)) {
+            pipe_end_t* end = (pipe_end_t*)entry;
+            int pflags = nowait ? O_NONBLOCK : 0;
+            return write ? pipe_write_iter(end, it, pflags) : pipe_read_iter(end, it, pflags);
+        }
+        if (IS_SOCKET_FD(entry)) {
+            int mflags = nowait ? MSG_DONTWAIT : 0;
+            return write ? sock_sendto_iter(SOCKET_FD_IDX(entry), it, mflags, NULL, 0)
+                         : sock_recv_iter(SOCKET_FD_IDX(entry), it, mflags);
+        }
+        if (nowait) return -EOPNOTSUPP;
+        return rw_by_segment(fd, it, write);
     }
-    // Use sched_signal_task which properly handles SIGKILL/SIGSTOP
-    // and other signals with their default actions
-    sched_signal_task(t, sig);
-}
 
-static int64_t sys_kill(uint64_t pid, uint64_t sig) {
-    if (sig > 64) return -EINVAL;
-    if ((int64_t)pid < 0) {
-        int pgid = -(int)pid;
-        if (sig == 0) {
-            return sched_pgid_exists(pgid) ? 0 : -ESRCH;
-        }
-        sched_signal_pgrp(pgid, (int)sig);
-        return 0;
+    if (write) {
+        if ((file->flags & (O_WRONLY | O_RDWR | O_APPEND)) == 0) return -EBADF;
+    } else if (file->flags & O_WRONLY) {
+        return -EBADF;
     }
-    if (pid == 0) {
-        /* PID 0 is the kernel idle task — cannot be signalled */
-        return -EPERM;
+    if (!it->count) return 0;
+
+    long r = write ? vfs_write_iter(file, it, (long)pos, flags)
+                   : vfs_read_iter(file, it, (long)pos, flags);
+    if (r == ST_UNSUPPORTED) {
+        return (flags & RWF_NOWAIT) ? -EOPNOTSUPP : -ESPIPE;
     }
-    task_t* t = sched_find_task_by_id((uint32_t)pid);
-    if (!t) return -ESRCH;
-    // Kernel tasks (idle, init, kernel threads) cannot be signalled
-    if (t->privilege == TASK_KERNEL) return -EPERM;
-    if (sig == 0) return 0;
-    kill_task(t, (int)sig);
-    return 0;
+    return r;
 }
 
-static int64_t sys_unlink(uint64_t pathname) {
-    if (!validate_user_ptr(pathname, 1)) return -EFAULT;
-    
-    // Copy user path to kernel buffer first
-    char kpath[VFS_MAX_PATH];
-    int cret = copy_user_path((const char*)pathname, kpath, sizeof(kpath));
-    if (cret != 0) return cret;
-    
-    int st = vfs_unlink(kpath);
-    if (st == ST_OK) return 0;
-    if (st == ST_NOT_FOUND) return -ENOENT;
-    return -EINVAL;
+static int64_t do_iovec_rw(uint64_t fd, uint64_t iovp, uint64_t iovcnt, int64_t pos,
+                           uint64_t flags, bool write) {
+    if (flags & ~(uint64_t)RWF_SUPPORTED) return -EOPNOTSUPP;
+    if (pos < 0 && pos != VFS_POS_CUR) return -EINVAL;
+    struct iovec fast[UIO_FASTIOV];
+    struct iovec* iov;
+    iov_iter_t it;
+    long total = import_iovec((const struct iovec*)iovp, iovcnt, fast, &iov, &it);
+    if (total < 0) return total;
+    int64_t ret = do_iter_rw(fd, &it, pos, (int)flags, write);
+    if (iov != fast) kfree(iov);
+    return ret;
 }
 
-static int64_t sys_rename(uint64_t oldpath, uint64_t newpath) {
-    if (!validate_user_ptr(oldpath, 1) || !validate_user_ptr(newpath, 1)) return -EFAULT;
-    
-    // Copy user paths to kernel buffers first
-    char koldpath[VFS_MAX_PATH], knewpath[VFS_MAX_PATH];
-    int cret = copy_user_path((const char*)oldpath, koldpath, sizeof(koldpath));
-    if (cret != 0) return cret;
-    cret = copy_user_path((const char*)newpath, knewpath, sizeof(knewpath));
-    if (cret != 0) return cret;
-    
-    int st = vfs_rename(koldpath, knewpath);
-    if (st == ST_OK) return 0;
-    if (st == ST_NOT_FOUND) return -ENOENT;
-    return -EINVAL;
+static int64_t sys_readv(uint64_t fd, uint64_t iovp, uint64_t iovcnt) {
+    return do_iovec_rw(fd, iovp, iovcnt, VFS_POS_CUR, 0, false);
 }
 
-static int64_t sys_mkdir(uint64_t pathname, uint64_t mode) {
-    (void)mode;
-    if (!validate_user_ptr(pathname, 1)) return -EFAULT;
-    
-    // Copy user path to kernel buffer first
-    char kpath[VFS_MAX_PATH];
-    int cret = copy_user_path((const char*)pathname, kpath, sizeof(kpath));
-    if (cret != 0) return cret;
-    
-    int st = vfs_mkdir(kpath, (unsigned int)mode);
-    if (st == ST_OK) return 0;
-    if (st == ST_EXISTS) return -EEXIST;
-    if (st == ST_NOT_FOUND) return -ENOENT;
-    if (st == ST_NOMEM) return -ENOMEM;
-    if (st == ST_IO) return -EIO;
-    return -EINVAL;
+static int64_t sys_writev(uint64_t fd, uint64_t iovp, uint64_t iovcnt) {
+    return do_iovec_rw(fd, iovp, iovcnt, VFS_POS_CUR, 0, true);
 }
-static int64_t sys_rmdir(uint64_t pathname) {
-    if (!validate_user_ptr(pathname, 1)) return -EFAULT;
-    
-    // Copy user path to kernel buffer first
-    char kpath[VFS_MAX_PATH];
-    int cret = copy_user_path((const char*)pathname, kpath, sizeof(kpath));
-    if (cret != 0) return cret;
-    
-    int st = vfs_rmdir(kpath);
-    if (st == ST_OK) return 0;
-    if (st == ST_NOT_FOUND) return -ENOENT;
-    if (st == ST_NOMEM) return -ENOMEM;
-    if (st == ST_IO) return -EIO;
-    return -EINVAL;
+
+static int64_t do_prw(uint64_t fd, uint64_t buf, uint64_t count, int64_t pos, bool write) {
+    if (pos < 0) return -EINVAL;
+    if (count > MAX_RW_COUNT) count = MAX_RW_COUNT;
+    if (count && !access_ok((void*)buf, count)) return -EFAULT;
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, (void*)buf, count);
+    return do_iter_rw(fd, &it, pos, 0, write);
 }
-static int64_t sys_link(uint64_t oldpath, uint64_t newpath) { (void)oldpath; (void)newpath; return -ENOSYS; }
-static int64_t sys_symlink(uint64_t target, uint64_t linkpath) { (void)target; (void)linkpath; return -ENOSYS; }
-static int64_t sys_readlink(uint64_t pathname, uint64_t buf, uint64_t bufsiz) { (void)pathname; (void)buf; (void)bufsiz; return -ENOSYS; }
-// chmod/fchmod/chown/fchown: FAT32 has no permissions/ownership; silently succeed
-static int64_t sys_chmod(uint64_t pathname, uint64_t mode) { (void)pathname; (void)mode; return 0; }
+
+// preadv/pwritev take pos = -1 as "the file position" only in the v2 forms
+static int64_t do_prwv(uint64_t fd, uint64_t iovp, uint64_t iovcnt, int64_t pos,
+                       uint64_t flags, bool write, bool v2) {
+    if (pos == VFS_POS_CUR && !v2) return -EINVAL;
+    return do_iovec_rw(fd, iovp, iovcnt, pos, flags, write);
+}
+
+// ============================================================================
+// splice(2) / tee(2) / vmsplice(2)
+// ============================================================================
+// Data moves between a pipe and another fd without passing through user
+// memory.  Files hand the pipe references to their page cache pages
+// (vfs_splice_read); other sources are read straight into new pipe pages,
+// and pipe pages are written out from where they are.
+
+// The fd table entry for fd, with the console markers standing in for
+// stdin/stdout/stderr that have no entry
+static void* splice_fd_entry(task_t* cur, uint64_t fd) {
+    if (fd >= TASK_MAX_FDS) return NULL;
+    void* entry = cur->fd_table[fd];
+    if (!entry && fd <= STDERR_FD) {
+        entry = (void*)(uintptr_t)(fd + 1);
+    }
+    return entry;
+}
+
+// Read from a non-pipe entry into kernel memory
+static int64_t splice_read_entry(task_t* cur, void* entry, void* kbuf, size_t len, bool nonblock) {
+    uintptr_t marker = (uintptr_t)entry;
+    if (marker >= 1 && marker <= 3) {
+        tty_t* tty = cur->ctty ? cur->ctty : tty_get_console();
+        return tty_read(tty, kbuf, (long)len, nonblock || (cur->console_flags & O_NONBLOCK));
+    }
+    if (IS_UNIX_SOCKET_FD(entry)) {
+        return unix_recv((int)marker, kbuf, len, 0);
+    }
+    if (IS_SOCKET_FD(entry)) {
+        return sock_recv(SOCKET_FD_IDX(entry), kbuf, len, nonblock ? MSG_DONTWAIT : 0);
+    }
+    vfs_file_t* file = fd_entry_file(entry);
+    if (!file) return -EINVAL;
+    if (file->flags & O_WRONLY) return -EBADF;
+    long r = vfs_read(file, kbuf, (long)len);
+    return r < 0 ? vfs_status_to_errno((int)r) : r;
+}
+
+// Write kernel memory to a non-pipe entry
+static int64_t splice_write_entry(task_t* cur, void* entry, const void* kbuf, size_t len) {
+    uintptr_t marker = (uintptr_t)entry;
+    if (marker >= 1 && marker <= 3) {
+        tty_t* tty = cur->ctty ? cur->ctty : tty_get_console();
+        return tty_write(tty, kbuf, (long)len);
+    }
+    if (IS_UNIX_SOCKET_FD(entry)) {
+        return unix_send((int)marker, kbuf, len, 0);
+    }
+    if (IS_SOCKET_FD(entry)) {
+        return sock_send(SOCKET_FD_IDX(entry), kbuf, len, 0);
+    }
+    vfs_file_t* file = fd_entry_file(entry);
+    if (!file) return -EINVAL;
+    if ((file->flags & (O_WRONLY | O_RDWR | O_APPEND)) == 0) return -EBADF;
+    long r = vfs_write(file, kbuf, (long)len);
+    return r < 0 ? vfs_status_to_errno((int)r) : r;
+}
+
+// An explicit offset applies to that call only: the file position is
+// moved there for the transfer and put back afterwards
+static int splice_seek_in(void* entry, uint64_t offp, int64_t* saved) {
+    vfs_file_t* file = fd_entry_file(entry);
+    if (!file) return -ESPIPE;
+    int64_t off;
+    if (!validate_user_ptr(offp, sizeof(off)) || copy_from_user(&off, (void*)offp, sizeof(off)) != 0)
+        return -EFAULT;
+    if (off < 0) return -EINVAL;
+    *saved = vfs_seek(file, 0, 1);  // SEEK_CUR
+    if (*saved < 0 || vfs_seek(file, off, 0) < 0) return -ESPIPE;
+    return 0;
+}
+
+static int splice_seek_out(void* entry, uint64_t offp, int64_t saved) {
+    vfs_file_t* file = fd_entry_file(entry);
+    int64_t off = vfs_seek(file, 0, 1);
+    int ret = copy_to_user((void*)offp, &off, sizeof(off));
+    vfs_seek(file, saved, 0);
+    return ret;
+}
+
+// Non-pipe source -> pipe
+static int64_t splice_to_pipe(task_t* cur, void* src, pipe_end_t* end, size_t len, bool nonblock) {
+    if (end->is_read) return -EBADF;
+    pipe_t* pipe = end->pipe;
+    vfs_file_t* file = fd_entry_file(src);
+    if (file && (file->flags & O_WRONLY)) return -EBADF;
+    nonblock = nonblock || (end->flags & O_NONBLOCK);
+
+    pipe_lock(pipe);
+    int64_t err = pipe_wait_writable(pipe, nonblock);
+    if (err < 0) {
+        pipe_unlock(pipe);
+        return err;
+    }
+
+    size_t done = 0;
+    if (file) {
+        long r = vfs_splice_read(file, pipe, (long)len);
+        if (r == 0) {
+            pipe_unlock(pipe);
+            return 0;  // EOF
+        }
+        if (r > 0) {
+            done = (size_t)r;
+        } else if (r != ST_UNSUPPORTED) {
+            err = vfs_status_to_errno((int)r);
+        }
+    }
+
+    // Whatever was not spliced by reference is read into new pages
+    while (!err && done < len && !pipe_full(pipe)) {
+        uint64_t page = pipe_get_page(pipe);
+        if (!page) {
+            err = -ENOMEM;
+            break;
+        }
+        size_t chunk = len - done < PAGE_SIZE ? len - done : PAGE_SIZE;
+        int64_t r = splice_read_entry(cur, src, phys_to_virt(page), chunk, nonblock);
+        if (r <= 0) {
+            pipe_put_page(pipe, page);
+            err = r;
+            break;
+        }
+        pipe_push_buf(pipe, page, 0, (uint32_t)r, PIPE_BUF_FLAG_CAN_MERGE);
+        done += (size_t)r;
+        // Sockets and terminals: take what one read gives rather than block
+        if (!file || (size_t)r < chunk) break;
+    }
+    pipe_unlock(pipe);
+
+    if (done) {
+        wake_up(&pipe->rd_wait);
+        return (int64_t)done;
+    }
+    return err;
+}
+
+// Pipe -> non-pipe destination
+static int64_t splice_from_pipe(task_t* cur, pipe_end_t* end, void* dst, size_t len, bool nonblock) {
+    if (!end->is_read) return -EBADF;
+    pipe_t* pipe = end->pipe;
+
+    pipe_lock(pipe);
+    int64_t err = pipe_wait_readable(pipe, nonblock || (end->flags & O_NONBLOCK));
+    if (err <= 0) {
+        pipe_unlock(pipe);
+        return err;
+    }
+    err = 0;
+
+    size_t done = 0;
+    while (done < len && pipe->tail != pipe->head) {
+        pipe_buf_t* b = &pipe->bufs[pipe->tail & (pipe->ring_size - 1)];
+        size_t chunk = len - done < b->len ? len - done : b->len;
+        int64_t r = splice_write_entry(cur, dst, (uint8_t*)phys_to_virt(b->page) + b->offset, chunk);
+        if (r <= 0) {
+            err = r;
+            break;
+        }
+        pipe_consume(pipe, (size_t)r);
+        done += (size_t)r;
+        if ((size_t)r < chunk) break;
+    }
+    pipe_unlock(pipe);
+
+    if (done) {
+        wake_up(&pipe->wr_wait);
+        return (int64_t)done;
+    }
+    return err;
+}
+
+static int64_t sys_splice(uint64_t fd_in, uint64_t off_in, uint64_t fd_out, uint64_t off_out,
+                          uint64_t len, uint64_t flags) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+    if (flags & ~(uint64_t)(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT))
+        return -EINVAL;
+
+    void* in = splice_fd_entry(cur, fd_in);
+    void* out = splice_fd_entry(cur, fd_out);
+    if (!in || !out) return -EBADF;
+    bool in_pipe = pipe_is_end(in);
+    bool out_pipe = pipe_is_end(out);
+    if (!in_pipe && !out_pipe) return -EINVAL;
+    if ((in_pipe && off_in) || (out_pipe && off_out)) return -ESPIPE;
+    if (len == 0) return 0;
+    if (len > (1024ULL * 1024 * 1024)) len = 1024ULL * 1024 * 1024;
+    bool nonblock = (flags & SPLICE_F_NONBLOCK) != 0;
+
+    if (in_pipe && out_pipe) {
+        return pipe_link((pipe_end_t*)in, (pipe_end_t*)out, (size_t)len,
+                         nonblock ? O_NONBLOCK : 0, true);
+    }
+
+    void* file_end = in_pipe ? out : in;
+    uint64_t offp = in_pipe ? off_out : off_in;
+    int64_t saved = 0;
+    if (offp) {
+        int r = splice_seek_in(file_end, offp, &saved);
+        if (r < 0) return r;
+    }
+
+    int64_t ret = in_pipe ? splice_from_pipe(cur, (pipe_end_t*)in, out, (size_t)len, nonblock)
+                          : splice_to_pipe(cur, in, (pipe_end_t*)out, (size_t)len, nonblock);
+
+    if (offp && splice_seek_out(file_end, offp, saved) && ret >= 0) {
+        return -EFAULT;
+    }
+    return ret;
+}
+
+static int64_t sys_tee(uint64_t fd_in, uint64_t fd_out, uint64_t len, uint64_t flags) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+    if (flags & ~(uint64_t)(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT))
+        return -EINVAL;
+
+    void* in = splice_fd_entry(cur, fd_in);
+    void* out = splice_fd_entry(cur, fd_out);
+    if (!in || !out) return -EBADF;
+    if (!pipe_is_end(in) || !pipe_is_end(out)) return -EINVAL;
+    if (len > (1024ULL * 1024 * 1024)) len = 1024ULL * 1024 * 1024;
+    return pipe_link((pipe_end_t*)in, (pipe_end_t*)out, (size_t)len,
+                     (flags & SPLICE_F_NONBLOCK) ? O_NONBLOCK : 0, false);
+}
+
+// vmsplice copies between the iovecs and pipe pages rather than putting
+// the user pages in the pipe: anonymous memory can be freed or rewritten
+// behind the pipe's back, and a mapping may not be RAM at all
+static int64_t sys_vmsplice(uint64_t fd, uint64_t iovp, uint64_t nr_segs, uint64_t flags) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+    if (flags & ~(uint64_t)(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT))
+        return -EINVAL;
+
+    void* entry = splice_fd_entry(cur, fd);
+    if (!entry || !pipe_is_end(entry)) return -EBADF;
+    pipe_end_t* end = (pipe_end_t*)entry;
+    int pflags = (flags & SPLICE_F_NONBLOCK) ? O_NONBLOCK : 0;
+
+    struct iovec fast[UIO_FASTIOV];
+    struct iovec* iov;
+    iov_iter_t it;
+    long total = import_iovec((const struct iovec*)iovp, nr_segs, fast, &iov, &it);
+    if (total < 0) return total;
+    int64_t ret = end->is_read ? pipe_read_iter(end, &it, pflags)
+                               : pipe_write_iter(end, &it, pflags);
+    if (iov != fast) kfree(iov);
+    return ret;
+}
+
+// Forward declaration for signal functions
+extern ktimer_t timer_create_internal(task_t* task, clockid_t clockid, struct k_sigevent* sevp);
+extern int timer_settime_internal(ktimer_t timerid, int flags, 
+                                  const struct k_itimerspec* new_value,
+                                  struct k_itimerspec* old_value);
+extern int timer_gettime_internal(ktimer_t timerid, struct k_itimerspec* curr_value);
+extern int timer_getoverrun_internal(ktimer_t timerid);
+extern int timer_delete_internal(ktimer_t timerid);
+
+static void kill_task(task_t* t, int sig) {
+    if (!t) {
+        return;
+    }
+    // Use sched_signal_task which properly handles SIGKILL/SIGSTOP
+    // and other signals with their default actions
+    sched_signal_task(t, sig);
+}
+
+static int64_t sys_kill(uint64_t pid, uint64_t sig) {
+    if (sig > 64) return -EINVAL;
+    if ((int64_t)pid < 0) {
+        int pgid = -(int)pid;
+        if (sig == 0) {
+            return sched_pgid_exists(pgid) ? 0 : -ESRCH;
+        }
+        sched_signal_pgrp(pgid, (int)sig);
+        return 0;
+    }
+    if (pid == 0) {
+        /* PID 0 is the kernel idle task — cannot be signalled */
+        return -EPERM;
+    }
+    task_t* t = sched_find_task_by_id((uint32_t)pid);
+    if (!t) return -ESRCH;
+    // Kernel tasks (idle, init, kernel threads) cannot be signalled
+    if (t->privilege == TASK_KERNEL) return -EPERM;
+    if (sig == 0) return 0;
+    kill_task(t, (int)sig);
+    return 0;
+}
+
+static int64_t sys_unlink(uint64_t pathname) {
+    if (!validate_user_ptr(pathname, 1)) return -EFAULT;
+    
+    // Copy user path to kernel buffer first
+    char kpath[VFS_MAX_PATH];
+    int cret = copy_user_path((const char*)pathname, kpath, sizeof(kpath));
+    if (cret != 0) return cret;
+    
+    int st = vfs_unlink(kpath);
+    if (st == ST_OK) return 0;
+    if (st == ST_NOT_FOUND) return -ENOENT;
+    return -EINVAL;
+}
+
+static int64_t sys_rename(uint64_t oldpath, uint64_t newpath) {
+    if (!validate_user_ptr(oldpath, 1) || !validate_user_ptr(newpath, 1)) return -EFAULT;
+    
+    // Copy user paths to kernel buffers first
+    char koldpath[VFS_MAX_PATH], knewpath[VFS_MAX_PATH];
+    int cret = copy_user_path((const char*)oldpath, koldpath, sizeof(koldpath));
+    if (cret != 0) return cret;
+    cret = copy_user_path((const char*)newpath, knewpath, sizeof(knewpath));
+    if (cret != 0) return cret;
+    
+    int st = vfs_rename(koldpath, knewpath);
+    if (st == ST_OK) return 0;
+    if (st == ST_NOT_FOUND) return -ENOENT;
+    return -EINVAL;
+}
+
+static int64_t sys_mkdir(uint64_t pathname, uint64_t mode) {
+    (void)mode;
+    if (!validate_user_ptr(pathname, 1)) return -EFAULT;
+    
+    // Copy user path to kernel buffer first
+    char kpath[VFS_MAX_PATH];
+    int cret = copy_user_path((const char*)pathname, kpath, sizeof(kpath));
+    if (cret != 0) return cret;
+    
+    int st = vfs_mkdir(kpath, (unsigned int)mode);
+    if (st == ST_OK) return 0;
+    if (st == ST_EXISTS) return -EEXIST;
+    if (st == ST_NOT_FOUND) return -ENOENT;
+    if (st == ST_NOMEM) return -ENOMEM;
+    if (st == ST_IO) return -EIO;
+    return -EINVAL;
+}
+static int64_t sys_rmdir(uint64_t pathname) {
+    if (!validate_user_ptr(pathname, 1)) return -EFAULT;
+    
+    // Copy user path to kernel buffer first
+    char kpath[VFS_MAX_PATH];
+    int cret = copy_user_path((const char*)pathname, kpath, sizeof(kpath));
+    if (cret != 0) return cret;
+    
+    int st = vfs_rmdir(kpath);
+    if (st == ST_OK) return 0;
+    if (st == ST_NOT_FOUND) return -ENOENT;
+    if (st == ST_NOMEM) return -ENOMEM;
+    if (st == ST_IO) return -EIO;
+    return -EINVAL;
+}
+static int64_t sys_link(uint64_t oldpath, uint64_t newpath) { (void)oldpath; (void)newpath; return -ENOSYS; }
+static int64_t sys_symlink(uint64_t target, uint64_t linkpath) { (void)target; (void)linkpath; return -ENOSYS; }
+static int64_t sys_readlink(uint64_t pathname, uint64_t buf, uint64_t bufsiz) { (void)pathname; (void)buf; (void)bufsiz; return -ENOSYS; }
+// chmod/fchmod/chown/fchown: FAT32 has no permissions/ownership; silently succeed
+static int64_t sys_chmod(uint64_t pathname, uint64_t mode) { (void)pathname; (void)mode; return 0; }
 static int64_t sys_fchmod(uint64_t fd, uint64_t mode) { (void)fd; (void)mode; return 0; }
 static int64_t sys_chown(uint64_t pathname, uint64_t owner, uint64_t group) { (void)pathname; (void)owner; (void)group; return 0; }
 static int64_t sys_fchown(uint64_t fd, uint64_t owner, uint64_t group) { (void)fd; (void)owner; (void)group; return 0; }
@@ -1934,10 +2108,52 @@ static int64_t sys_mmap(uint64_t addr, uint64_t length, uint64_t prot,
     if (!(prot & PROT_EXEC)) {
         page_flags |= PAGE_NO_EXECUTE;
     }
+    if (flags & MAP_SHARED) {
+        page_flags |= PAGE_SHARED;
+    }
     
     // Map pages
     bool is_anonymous = (flags & MAP_ANONYMOUS) || (int64_t)fd == -1;
     uint64_t pages_mapped = 0;
+
+    // Files that supply their own pages (io_uring rings, shm objects) hand
+    // the same pages to every shared mapping.  A private mapping of one
+    // that can be read is a copy like any other file's; without a read op
+    // only shared mappings make sense.
+    vfs_file_t* mfile = NULL;
+    if (!is_anonymous && fd < TASK_MAX_FDS) {
+        mfile = fd_entry_file(cur->fd_table[fd]);
+    }
+    if (mfile && mfile->ops && mfile->ops->mmap &&
+        ((flags & MAP_SHARED) || !mfile->ops->read)) {
+        for (uint64_t off = 0; off < length; off += PAGE_SIZE) {
+            unsigned long phys = 0;
+            bool ok = (flags & MAP_SHARED) && mfile->ops->mmap(mfile, offset + off, &phys) == 0;
+            if (ok && !mm_map_page_in_address_space(cur->pml4, vaddr + off, phys, page_flags)) {
+                if (mm_decref_page(phys)) {
+                    mm_free_physical_page(phys);
+                }
+                ok = false;
+            }
+            if (!ok) {
+                for (uint64_t cleanup = 0; cleanup < off; cleanup += PAGE_SIZE) {
+                    mm_unmap_page_in_address_space(cur->pml4, vaddr + cleanup);
+                }
+                if (!(flags & MAP_FIXED)) {
+                    cur->mmap_base += length;  // Rollback
+                }
+                return (int64_t)MAP_FAILED;
+            }
+        }
+        region->start = vaddr;
+        region->length = length;
+        region->prot = prot;
+        region->flags = flags;
+        region->fd = (int)fd;
+        region->offset = offset;
+        region->in_use = true;
+        return (int64_t)vaddr;
+    }
     
     for (uint64_t off = 0; off < length; off += PAGE_SIZE) {
         uint64_t phys = mm_allocate_physical_page();
@@ -2043,17 +2259,14 @@ static int64_t sys_pipe(uint64_t pipefd_ptr) {
         return -EFAULT;
     }
 
-    pipe_t* pipe = pipe_create(4096);
+    pipe_t* pipe = pipe_create(PIPE_DEF_BUFFERS * PAGE_SIZE);
     if (!pipe) {
         return -ENOMEM;
     }
 
     pipe_end_t* read_end = pipe_create_end(pipe, true);
     if (!read_end) {
-        if (pipe->buffer) {
-            kfree(pipe->buffer);
-        }
-        kfree(pipe);
+        pipe_destroy(pipe);
         return -ENOMEM;
     }
 
@@ -2083,14 +2296,8 @@ static int64_t sys_pipe(uint64_t pipefd_ptr) {
 
     cur->fd_table[fd_write] = (vfs_file_t*)write_end;
 
-    // SMAP-aware write to user array
-    int* user_pipefd = (int*)pipefd_ptr;
-    smap_disable();
-    user_pipefd[0] = fd_read;
-    user_pipefd[1] = fd_write;
-    smap_enable();
-
-    return 0;
+    int kfds[2] = { fd_read, fd_write };
+    return copy_to_user((void*)pipefd_ptr, kfds, sizeof(kfds));
 }
 
 // SYS_EXIT - exit task
@@ -2252,36 +2459,31 @@ static int64_t sys_waitpid(int64_t pid, uint64_t status_ptr, uint64_t options, u
                 status = (child->exit_code & 0xFF) << 8;
             }
             
-            if (status_ptr && validate_user_ptr(status_ptr, sizeof(int))) {
-                copy_to_user((void*)status_ptr, &status, sizeof(status));
-            }
+            // The child is reaped even when the copy-out faults, as on Linux
+            int fault = 0;
+            if (status_ptr && copy_to_user((void*)status_ptr, &status, sizeof(status)) != 0)
+                fault = 1;
 
             /* Fill in resource usage from the child's accounting data */
-            if (rusage_ptr && validate_user_ptr(rusage_ptr, 56)) {
-                uint32_t freq = timer_get_frequency();
-                if (freq == 0) freq = 100;
-                struct {
-                    long ru_utime_sec;
-                    long ru_utime_usec;
-                    long ru_stime_sec;
-                    long ru_stime_usec;
-                    long ru_maxrss;
-                    long ru_minflt;
-                    long ru_majflt;
-                } ru;
-                ru.ru_utime_sec  = (long)(child->utime_ticks / freq);
-                ru.ru_utime_usec = (long)((child->utime_ticks % freq) * (1000000 / freq));
-                ru.ru_stime_sec  = (long)(child->stime_ticks / freq);
-                ru.ru_stime_usec = (long)((child->stime_ticks % freq) * (1000000 / freq));
+            if (rusage_ptr) {
+                struct k_rusage_compat ru;
+                uint64_t utime_ns, stime_ns, cutime_ns, cstime_ns;
+                cputime_group(child, &utime_ns, &stime_ns);
+                cputime_children(child, &cutime_ns, &cstime_ns);
+                rusage_set_times(&ru, utime_ns + cutime_ns, stime_ns + cstime_ns);
                 ru.ru_maxrss = 0;
                 ru.ru_minflt = 0;
                 ru.ru_majflt = 0;
-                copy_to_user((void*)rusage_ptr, &ru, sizeof(ru));
+                ru.ru_nvcsw = (int64_t)child->nvcsw;
+                ru.ru_nivcsw = (int64_t)child->nivcsw;
+                if (copy_to_user((void*)rusage_ptr, &ru, sizeof(ru)) != 0)
+                    fault = 1;
             }
 
             int child_pid = child->id;
+            cputime_reap(cur, child);
             sched_remove_task(child);
-            return child_pid;
+            return fault ? -EFAULT : child_pid;
         }
         
         // No zombie child yet
@@ -2389,6 +2591,11 @@ static int64_t sys_execve(uint64_t pathname, uint64_t argv_ptr, uint64_t envp_pt
         return -ENOEXEC;
     }
 
+    // The new image starts with default x87/SSE/AVX state and no rseq
+    // registration
+    fpu_task_reset(sched_current());
+    rseq_clear(sched_current());
+
     // Set task comm from basename of path (or argv[0])
     {
         task_t* cur = sched_current();
@@ -2428,6 +2635,9 @@ static int64_t sys_execve(uint64_t pathname, uint64_t argv_ptr, uint64_t envp_pt
     free_user_string_array(kargv);
     kfree(kpath);
 
+    // This path never returns through syscall_handler
+    cputime_switch(CPUTIME_USER);
+
     // Success! Jump to the new program
     // We need to return to userspace at the new entry point with the new stack
     // Use inline assembly to set up IRET frame and jump
@@ -2517,11 +2727,6 @@ static int64_t sys_dup(uint64_t oldfd) {
         return newfd;
     }
 
-    if (IS_EPOLL_FD(cur->fd_table[oldfd])) {
-        cur->fd_table[newfd] = cur->fd_table[oldfd];
-        return newfd;
-    }
-
     if (pipe_is_end(cur->fd_table[oldfd])) {
         pipe_end_t* new_end = pipe_dup_end((pipe_end_t*)cur->fd_table[oldfd]);
         if (!new_end) return -ENOMEM;
@@ -2573,11 +2778,6 @@ static int64_t sys_dup2(uint64_t oldfd, uint64_t newfd) {
         return newfd;
     }
 
-    if (IS_EPOLL_FD(cur->fd_table[oldfd])) {
-        cur->fd_table[newfd] = cur->fd_table[oldfd];
-        return newfd;
-    }
-
     if (pipe_is_end(cur->fd_table[oldfd])) {
         pipe_end_t* new_end = pipe_dup_end((pipe_end_t*)cur->fd_table[oldfd]);
         if (!new_end) return -ENOMEM;
@@ -2616,12 +2816,9 @@ static int64_t sys_yield(void) {
         return 0;
     }
     
-    // Reset time slice - we're voluntarily giving it up
-    cur->remaining_ticks = 0;
-    cur->state = TASK_READY;
-    
-    // Immediate reschedule (Linux does this via schedule())
-    sched_schedule();
+    // Give up the rest of the slice: requeue behind the other runnable
+    // tasks on this CPU and reschedule immediately (Linux: schedule())
+    sched_yield_in_kernel();
     
     return 0;
 }
@@ -3176,7 +3373,9 @@ static int64_t sys_nanosleep(uint64_t req_ptr, uint64_t rem_ptr) {
                 struct k_timespec rem;
                 rem.tv_sec = remaining / freq;
                 rem.tv_nsec = (uint64_t)(remaining % freq) * 1000000000ULL / freq;
-                copy_to_user((void*)rem_ptr, &rem, sizeof(struct k_timespec));
+                cur->wakeup_tick = 0;
+                if (copy_to_user((void*)rem_ptr, &rem, sizeof(struct k_timespec)) != 0)
+                    return -EFAULT;
             }
             cur->wakeup_tick = 0;
             return -EINTR;
@@ -3213,11 +3412,23 @@ static int64_t sys_clock_gettime(uint64_t clk_id, uint64_t tp_ptr) {
             tp.tv_nsec = frac_ns;
             break;
         case 1:  // CLOCK_MONOTONIC
-        case 2:  // CLOCK_PROCESS_CPUTIME_ID
-        case 3:  // CLOCK_THREAD_CPUTIME_ID
             tp.tv_sec = total_secs;
             tp.tv_nsec = frac_ns;
             break;
+        case 2:  // CLOCK_PROCESS_CPUTIME_ID
+        case 3: {  // CLOCK_THREAD_CPUTIME_ID
+            task_t* cur = sched_current();
+            if (!cur) return -ESRCH;
+            uint64_t utime_ns, stime_ns;
+            if (clk_id == CLOCK_PROCESS_CPUTIME_ID) {
+                cputime_group(cur, &utime_ns, &stime_ns);
+            } else {
+                cputime_thread(cur, &utime_ns, &stime_ns);
+            }
+            tp.tv_sec = (utime_ns + stime_ns) / 1000000000ULL;
+            tp.tv_nsec = (utime_ns + stime_ns) % 1000000000ULL;
+            break;
+        }
         default:
             return -EINVAL;
     }
@@ -3241,9 +3452,14 @@ static int64_t sys_clock_getres(uint64_t clk_id, uint64_t res_ptr) {
         }
         
         struct k_timespec res;
-        // Resolution = 1 tick in nanoseconds
+        // Resolution = 1 tick in nanoseconds; the CPU-time clocks count
+        // TSC cycles
         res.tv_sec = 0;
-        res.tv_nsec = 1000000000 / timer_get_frequency();
+        if (clk_id == CLOCK_PROCESS_CPUTIME_ID || clk_id == CLOCK_THREAD_CPUTIME_ID) {
+            res.tv_nsec = 1;
+        } else {
+            res.tv_nsec = 1000000000 / timer_get_frequency();
+        }
         
         if (copy_to_user((void*)res_ptr, &res, sizeof(res)) != 0) {
             return -EFAULT;
@@ -3262,33 +3478,139 @@ static int64_t sys_signalfd(uint64_t fd, uint64_t mask_ptr, uint64_t flags) {
     return -ENOSYS;
 }
 
-// ============================================================================
-// SMP/THREADING SYSCALLS - FULL IMPLEMENTATION
-// ============================================================================
-
-// Clone flags (Linux compatible)
-#define CLONE_VM             0x00000100  // Share memory space
-#define CLONE_FS             0x00000200  // Share filesystem info
-#define CLONE_FILES          0x00000400  // Share file descriptors
-#define CLONE_SIGHAND        0x00000800  // Share signal handlers
-#define CLONE_PTRACE         0x00002000  // Allow tracing child
-#define CLONE_VFORK          0x00004000  // vfork() semantics
-#define CLONE_PARENT         0x00008000  // Same parent as cloner
-#define CLONE_THREAD         0x00010000  // Same thread group
-#define CLONE_NEWNS          0x00020000  // New mount namespace
-#define CLONE_SYSVSEM        0x00040000  // Share SysV semaphore undo
-#define CLONE_SETTLS         0x00080000  // Set TLS
-#define CLONE_PARENT_SETTID  0x00100000  // Set parent's TID
-#define CLONE_CHILD_CLEARTID 0x00200000  // Clear child's TID on exit
-#define CLONE_DETACHED       0x00400000  // Unused
-#define CLONE_UNTRACED       0x00800000  // Cannot force trace
-#define CLONE_CHILD_SETTID   0x01000000  // Set child's TID
-#define CLONE_STOPPED        0x02000000  // Start in TASK_STOPPED
-#define CLONE_NEWUTS         0x04000000  // New UTS namespace
-#define CLONE_NEWIPC         0x08000000  // New IPC namespace
+// SYS_EVENTFD2 - create an eventfd
+static int64_t sys_eventfd2(uint64_t initval, uint64_t flags) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
 
-// Forward declare from sched.c
-extern void thread_group_add(task_t* leader, task_t* thread);
+    int fd = alloc_fd(cur);
+    if (fd < 0) return fd;
+    vfs_file_t* file = NULL;
+    int ret = eventfd_create((unsigned int)initval, (int)flags, &file);
+    if (ret < 0) return ret;
+    cur->fd_table[fd] = file;
+    return fd;
+}
+
+// SYS_TIMERFD_CREATE - create a timerfd
+static int64_t sys_timerfd_create(uint64_t clockid, uint64_t flags) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+
+    int fd = alloc_fd(cur);
+    if (fd < 0) return fd;
+    vfs_file_t* file = NULL;
+    int ret = timerfd_create((int)clockid, (int)flags, &file);
+    if (ret < 0) return ret;
+    cur->fd_table[fd] = file;
+    return fd;
+}
+
+// Take a reference to the timerfd behind fd, or return NULL with *err set
+static vfs_file_t* timerfd_get(task_t* cur, uint64_t fd, int* err) {
+    vfs_file_t* file = fd < TASK_MAX_FDS ? cur->fd_table[fd] : NULL;
+    if (!file) {
+        *err = -EBADF;
+        return NULL;
+    }
+    if (!timerfd_is_timerfd(file)) {
+        *err = -EINVAL;
+        return NULL;
+    }
+    vfs_incref(file);
+    return file;
+}
+
+// SYS_TIMERFD_SETTIME - arm or disarm a timerfd
+static int64_t sys_timerfd_settime(uint64_t fd, uint64_t flags, uint64_t new_ptr, uint64_t old_ptr) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+
+    struct k_itimerspec new_value, old;
+    if (copy_from_user(&new_value, (const void*)new_ptr, sizeof(new_value)) != 0) {
+        return -EFAULT;
+    }
+    if (old_ptr && !validate_user_ptr(old_ptr, sizeof(old))) {
+        return -EFAULT;
+    }
+
+    int err;
+    vfs_file_t* file = timerfd_get(cur, fd, &err);
+    if (!file) return err;
+    int ret = timerfd_settime(file, (int)flags, &new_value, old_ptr ? &old : NULL);
+    vfs_close(file);
+    if (ret < 0) return ret;
+
+    if (old_ptr && copy_to_user((void*)old_ptr, &old, sizeof(old)) != 0) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+// SYS_TIMERFD_GETTIME - time left on a timerfd and its interval
+static int64_t sys_timerfd_gettime(uint64_t fd, uint64_t cur_ptr) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+
+    int err;
+    vfs_file_t* file = timerfd_get(cur, fd, &err);
+    if (!file) return err;
+    struct k_itimerspec value;
+    timerfd_gettime(file, &value);
+    vfs_close(file);
+
+    if (copy_to_user((void*)cur_ptr, &value, sizeof(value)) != 0) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+// SYS_MEMFD_CREATE - create an anonymous shared memory file
+static int64_t sys_memfd_create(uint64_t uname, uint64_t flags) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+
+    char name[MFD_NAME_MAX + 1];
+    long len = strncpy_from_user(name, (const char*)uname, sizeof(name));
+    if (len < 0) return len;
+    if (len == (long)sizeof(name)) return -EINVAL;
+
+    int fd = alloc_fd(cur);
+    if (fd < 0) return fd;
+    vfs_file_t* file = NULL;
+    int ret = memfd_create(name, (unsigned int)flags, &file);
+    if (ret < 0) return ret;
+    cur->fd_table[fd] = file;
+    return fd;
+}
+
+// ============================================================================
+// SMP/THREADING SYSCALLS - FULL IMPLEMENTATION
+// ============================================================================
+
+// Clone flags (Linux compatible)
+#define CLONE_VM             0x00000100  // Share memory space
+#define CLONE_FS             0x00000200  // Share filesystem info
+#define CLONE_FILES          0x00000400  // Share file descriptors
+#define CLONE_SIGHAND        0x00000800  // Share signal handlers
+#define CLONE_PTRACE         0x00002000  // Allow tracing child
+#define CLONE_VFORK          0x00004000  // vfork() semantics
+#define CLONE_PARENT         0x00008000  // Same parent as cloner
+#define CLONE_THREAD         0x00010000  // Same thread group
+#define CLONE_NEWNS          0x00020000  // New mount namespace
+#define CLONE_SYSVSEM        0x00040000  // Share SysV semaphore undo
+#define CLONE_SETTLS         0x00080000  // Set TLS
+#define CLONE_PARENT_SETTID  0x00100000  // Set parent's TID
+#define CLONE_CHILD_CLEARTID 0x00200000  // Clear child's TID on exit
+#define CLONE_DETACHED       0x00400000  // Unused
+#define CLONE_UNTRACED       0x00800000  // Cannot force trace
+#define CLONE_CHILD_SETTID   0x01000000  // Set child's TID
+#define CLONE_STOPPED        0x02000000  // Start in TASK_STOPPED
+#define CLONE_NEWUTS         0x04000000  // New UTS namespace
+#define CLONE_NEWIPC         0x08000000  // New IPC namespace
+
+// Forward declare from sched.c
+extern void thread_group_add(task_t* leader, task_t* thread);
 extern void thread_group_init(task_t* leader);
 extern mm_struct_t* mm_struct_create(uint64_t* pml4);
 extern void mm_struct_get(mm_struct_t* mm);
@@ -3356,6 +3678,11 @@ static int64_t sys_clone(uint64_t flags, uint64_t child_stack,
     
     // Initialize child from parent
     mm_memcpy(child, cur, sizeof(task_t));
+    if (fpu_task_fork(child, cur) < 0) {
+        kfree(k_stack_mem);
+        kfree(child);
+        return -ENOMEM;
+    }
     
     // Assign unique ID
     uint64_t irq_flags;
@@ -3365,16 +3692,16 @@ static int64_t sys_clone(uint64_t flags, uint64_t child_stack,
     
     // Basic child setup
     child->state = TASK_READY;
+    child->saved_preempt_count = 0;
     child->kernel_stack_top = k_stack_top;
     child->kernel_stack_base = k_stack_mem;
-    child->rq_next = NULL;
     child->on_rq = false;
     child->wait_next = NULL;
     child->wait_channel = NULL;
     child->wakeup_tick = 0;
     child->need_resched = 0;
-    child->remaining_ticks = SCHED_TIME_SLICE;
     child->preempt_frame = NULL;
+    sched_fork_init(child, cur);
     child->exit_code = 0;
     child->has_exited = false;
     child->exit_lock = 0;
@@ -3394,6 +3721,7 @@ static int64_t sys_clone(uint64_t flags, uint64_t child_stack,
             // First time: create mm_struct from parent's legacy pml4
             cur->mm = mm_struct_create(cur->pml4);
             if (!cur->mm) {
+                fpu_task_free(child);
                 kfree(k_stack_mem);
                 kfree(child);
                 return -ENOMEM;
@@ -3410,6 +3738,7 @@ static int64_t sys_clone(uint64_t flags, uint64_t child_stack,
         // COW clone of address space
         uint64_t* child_pml4 = mm_clone_address_space(cur->pml4);
         if (!child_pml4) {
+            fpu_task_free(child);
             kfree(k_stack_mem);
             kfree(child);
             return -ENOMEM;
@@ -3430,6 +3759,7 @@ static int64_t sys_clone(uint64_t flags, uint64_t child_stack,
                 if (!share_vm && child->pml4) {
                     mm_destroy_address_space(child->pml4);
                 }
+                fpu_task_free(child);
                 kfree(k_stack_mem);
                 kfree(child);
                 return -ENOMEM;
@@ -3482,6 +3812,7 @@ static int64_t sys_clone(uint64_t flags, uint64_t child_stack,
                 if (!share_vm && child->pml4) {
                     mm_destroy_address_space(child->pml4);
                 }
+                fpu_task_free(child);
                 kfree(k_stack_mem);
                 kfree(child);
                 return -ENOMEM;
@@ -3542,16 +3873,18 @@ static int64_t sys_clone(uint64_t flags, uint64_t child_stack,
     
     // Handle CLONE_PARENT_SETTID
     if (set_parent_tid && parent_tidptr) {
-        if (validate_user_ptr(parent_tidptr, sizeof(int))) {
-            smap_disable();
-            *(int*)parent_tidptr = child->id;
-            smap_enable();
-        }
+        put_user((int)child->id, (int*)parent_tidptr);
     }
     
     // Clear robust list (not inherited)
     child->robust_list = NULL;
     child->robust_list_len = 0;
+
+    // A thread registers its own rseq area; a forked copy keeps the
+    // parent's, which lives at the same address in its own memory
+    if (share_vm) {
+        rseq_clear(child);
+    }
     
     // Copy mmap regions (if not sharing VM)
     if (!share_vm) {
@@ -3609,9 +3942,7 @@ static int64_t sys_clone(uint64_t flags, uint64_t child_stack,
     // Handle CLONE_CHILD_SETTID: write TID to child's address space
     // This must be done after child is set up but before scheduling
     if (set_child_tid && child->set_child_tid) {
-        smap_disable();
-        *(int*)(child->set_child_tid) = child->id;
-        smap_enable();
+        put_user((int)child->id, (int*)child->set_child_tid);
     }
     
     // IMPORTANT: Save child->id BEFORE enqueueing!
@@ -3709,6 +4040,7 @@ static int64_t sys_futex(uint64_t uaddr, uint64_t op, uint64_t val,
     (void)val3;  // Used for FUTEX_CMP_REQUEUE comparison value
     
     int cmd = op & ~FUTEX_PRIVATE_FLAG;
+    bool shared = !(op & FUTEX_PRIVATE_FLAG);
     
     if (!validate_user_ptr(uaddr, sizeof(uint32_t))) {
         return -EFAULT;
@@ -3720,18 +4052,16 @@ static int64_t sys_futex(uint64_t uaddr, uint64_t op, uint64_t val,
             uint64_t timeout_ns = 0;
             if (timeout) {
                 // timeout points to struct timespec
-                if (validate_user_ptr(timeout, sizeof(struct k_timespec))) {
-                    smap_disable();
-                    struct k_timespec* ts = (struct k_timespec*)timeout;
-                    timeout_ns = (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
-                    smap_enable();
+                struct k_timespec ts;
+                if (copy_from_user(&ts, (const void*)timeout, sizeof(ts)) == 0) {
+                    timeout_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
                 }
             }
-            return futex_wait(uaddr, (uint32_t)val, timeout_ns);
+            return futex_wait(uaddr, (uint32_t)val, timeout_ns, shared);
         }
         
         case FUTEX_WAKE:
-            return futex_wake(uaddr, (int)val);
+            return futex_wake(uaddr, (int)val, shared);
         
         case FUTEX_REQUEUE:
         case FUTEX_CMP_REQUEUE:
@@ -3740,15 +4070,16 @@ static int64_t sys_futex(uint64_t uaddr, uint64_t op, uint64_t val,
             }
             // For CMP_REQUEUE, val3 is the expected value to compare
             if (cmd == FUTEX_CMP_REQUEUE) {
-                smap_disable();
-                uint32_t curval = *(volatile uint32_t*)uaddr;
-                smap_enable();
+                uint32_t curval;
+                if (get_user(curval, (uint32_t*)uaddr)) {
+                    return -EFAULT;
+                }
                 if (curval != (uint32_t)val3) {
                     return -EAGAIN;
                 }
             }
             // val = nr_wake, timeout = nr_requeue (reusing timeout arg)
-            return futex_requeue(uaddr, uaddr2, (int)val, (int)timeout);
+            return futex_requeue(uaddr, uaddr2, (int)val, (int)timeout, shared);
         
         default:
             return -ENOSYS;
@@ -3775,6 +4106,22 @@ static int64_t sys_set_robust_list(uint64_t head, uint64_t len) {
     return 0;
 }
 
+// SYS_RSEQ - register or unregister the calling thread's rseq area
+static int64_t sys_rseq(uint64_t uptr, uint64_t len, uint64_t flags, uint64_t sig) {
+    task_t* cur = sched_current();
+    if (!cur || cur->privilege != TASK_USER) return -ESRCH;
+    return rseq_register(cur, uptr, (uint32_t)len, (int)flags, (uint32_t)sig);
+}
+
+// SYS_GETCPU - CPU (and NUMA node, always 0) the caller is running on
+static int64_t sys_getcpu(uint64_t cpu_ptr, uint64_t node_ptr) {
+    uint32_t cpu = this_cpu()->cpu_id;
+    uint32_t node = 0;
+    if (cpu_ptr && copy_to_user((void*)cpu_ptr, &cpu, sizeof(cpu)) != 0) return -EFAULT;
+    if (node_ptr && copy_to_user((void*)node_ptr, &node, sizeof(node)) != 0) return -EFAULT;
+    return 0;
+}
+
 // SYS_GET_ROBUST_LIST - get robust futex list head
 static int64_t sys_get_robust_list(uint64_t pid, uint64_t head_ptr, uint64_t len_ptr) {
     task_t* target;
@@ -3798,11 +4145,10 @@ static int64_t sys_get_robust_list(uint64_t pid, uint64_t head_ptr, uint64_t len
         return -EFAULT;
     }
     
-    smap_disable();
-    *(struct robust_list_head**)head_ptr = target->robust_list;
-    *(size_t*)len_ptr = target->robust_list_len;
-    smap_enable();
-    
+    if (put_user(target->robust_list, (struct robust_list_head**)head_ptr) ||
+        put_user(target->robust_list_len, (size_t*)len_ptr)) {
+        return -EFAULT;
+    }
     return 0;
 }
 
@@ -3835,10 +4181,7 @@ static int64_t sys_arch_prctl(uint64_t code, uint64_t addr) {
             if (!validate_user_ptr(addr, sizeof(uint64_t))) {
                 return -EFAULT;
             }
-            smap_disable();
-            *(uint64_t*)addr = cur->fs_base;
-            smap_enable();
-            return 0;
+            return put_user(cur->fs_base, (uint64_t*)addr);
         
         case ARCH_SET_GS: {
             // Reject non-canonical addresses
@@ -3854,24 +4197,13 @@ static int64_t sys_arch_prctl(uint64_t code, uint64_t addr) {
             if (!validate_user_ptr(addr, sizeof(uint64_t))) {
                 return -EFAULT;
             }
-            smap_disable();
-            *(uint64_t*)addr = cur->gs_base;
-            smap_enable();
-            return 0;
+            return put_user(cur->gs_base, (uint64_t*)addr);
         
         default:
             return -EINVAL;
     }
 }
 
-// Scheduling policies
-#define SCHED_NORMAL    0
-#define SCHED_FIFO      1
-#define SCHED_RR        2
-#define SCHED_BATCH     3
-#define SCHED_IDLE      5
-#define SCHED_DEADLINE  6
-
 // CPU set for affinity
 #define CPU_SETSIZE 64
 typedef struct {
@@ -3898,9 +4230,10 @@ static int64_t sys_sched_setaffinity(uint64_t pid, uint64_t cpusetsize, uint64_t
     }
     
     // Read affinity mask from user
-    smap_disable();
-    uint64_t mask = *(uint64_t*)mask_ptr;
-    smap_enable();
+    uint64_t mask;
+    if (get_user(mask, (uint64_t*)mask_ptr)) {
+        return -EFAULT;
+    }
     
     // Validate: at least one CPU must be set
     if (mask == 0) {
@@ -3953,9 +4286,9 @@ static int64_t sys_sched_getaffinity(uint64_t pid, uint64_t cpusetsize, uint64_t
         if (mask == 0) mask = 1;  // At least CPU 0
     }
     
-    smap_disable();
-    *(uint64_t*)mask_ptr = mask;
-    smap_enable();
+    if (put_user(mask, (uint64_t*)mask_ptr)) {
+        return -EFAULT;
+    }
     
     return sizeof(uint64_t);
 }
@@ -3967,7 +4300,9 @@ struct sched_param {
 
 // SYS_SCHED_SETSCHEDULER - set scheduling policy
 static int64_t sys_sched_setscheduler(uint64_t pid, uint64_t policy, uint64_t param_ptr) {
-    (void)param_ptr;
+    if (!validate_user_ptr(param_ptr, sizeof(struct sched_param))) {
+        return -EFAULT;
+    }
     
     task_t* target;
     if (pid == 0) {
@@ -3980,12 +4315,13 @@ static int64_t sys_sched_setscheduler(uint64_t pid, uint64_t policy, uint64_t pa
         return -ESRCH;
     }
     
-    // We only support SCHED_NORMAL for now
-    if (policy != SCHED_NORMAL && policy != SCHED_RR) {
-        return -EINVAL;
+    struct sched_param param;
+    if (copy_from_user(&param, (const void*)param_ptr, sizeof(param))) {
+        return -EFAULT;
     }
     
-    return 0;
+    // SCHED_RESET_ON_FORK is accepted and ignored
+    return sched_setscheduler(target, (int)(policy & ~0x40000000ULL), param.sched_priority);
 }
 
 // SYS_SCHED_GETSCHEDULER - get scheduling policy
@@ -4001,12 +4337,14 @@ static int64_t sys_sched_getscheduler(uint64_t pid) {
         return -ESRCH;
     }
     
-    return SCHED_NORMAL;  // We use round-robin by default
+    return target->policy;
 }
 
 // SYS_SCHED_SETPARAM - set scheduling parameters
 static int64_t sys_sched_setparam(uint64_t pid, uint64_t param_ptr) {
-    (void)param_ptr;
+    if (!validate_user_ptr(param_ptr, sizeof(struct sched_param))) {
+        return -EFAULT;
+    }
     
     task_t* target;
     if (pid == 0) {
@@ -4019,8 +4357,13 @@ static int64_t sys_sched_setparam(uint64_t pid, uint64_t param_ptr) {
         return -ESRCH;
     }
     
-    // Accept but ignore (we use fixed round-robin)
-    return 0;
+    struct sched_param param;
+    if (copy_from_user(&param, (const void*)param_ptr, sizeof(param))) {
+        return -EFAULT;
+    }
+    
+    // Keep the policy, change only the RT priority
+    return sched_setscheduler(target, target->policy, param.sched_priority);
 }
 
 // SYS_SCHED_GETPARAM - get scheduling parameters
@@ -4040,13 +4383,9 @@ static int64_t sys_sched_getparam(uint64_t pid, uint64_t param_ptr) {
         return -ESRCH;
     }
     
-    struct sched_param param = { .sched_priority = 0 };
+    struct sched_param param = { .sched_priority = target->rt_priority };
     
-    smap_disable();
-    *(struct sched_param*)param_ptr = param;
-    smap_enable();
-    
-    return 0;
+    return copy_to_user((void*)param_ptr, &param, sizeof(param));
 }
 
 // SYS_SCHED_GET_PRIORITY_MAX - get max priority for policy
@@ -4096,14 +4435,177 @@ static int64_t sys_sched_rr_get_interval(uint64_t pid, uint64_t tp_ptr) {
         return -ESRCH;
     }
     
-    // Return time slice (at 100Hz, 2 ticks = 20ms)
-    struct k_timespec ts = { .tv_sec = 0, .tv_nsec = 20000000 };  // 20ms
+    // RR quantum; 0 (infinite) for FIFO; fair-class targeted latency otherwise
+    uint64_t ns = SCHED_LATENCY_NS;
+    if (target->policy == SCHED_RR) ns = RR_TIMESLICE_NS;
+    else if (target->policy == SCHED_FIFO) ns = 0;
+    struct k_timespec ts = { .tv_sec = (int64_t)(ns / 1000000000ULL),
+                             .tv_nsec = (int64_t)(ns % 1000000000ULL) };
     
-    smap_disable();
-    *(struct k_timespec*)tp_ptr = ts;
-    smap_enable();
-    
-    return 0;
+    return copy_to_user((void*)tp_ptr, &ts, sizeof(ts));
+}
+
+// SYS_GETPRIORITY - get nice value of a process, process group or user
+// Like the raw Linux syscall, returns 20 - nice (1..40) so that the result
+// is never negative; libc converts it back to a nice value.
+static int64_t sys_getpriority(uint64_t which, uint64_t who) {
+    int nice;
+    int ret = sched_getpriority((int)which, (int)who, &nice);
+    if (ret < 0) {
+        return ret;
+    }
+    return 20 - nice;
+}
+
+// SYS_SETPRIORITY - set nice value (clamped to -20..19)
+static int64_t sys_setpriority(uint64_t which, uint64_t who, uint64_t prio) {
+    return sched_setpriority((int)which, (int)who, (int)prio);
+}
+
+// SYS_SCHEDCTL - read/set scheduler tunables, read wakeup, idle and CPU stats
+static int64_t sys_schedctl(uint64_t op, uint64_t id, uint64_t arg) {
+    switch ((int)op) {
+    case SCHEDCTL_GET: {
+        uint64_t value;
+        int ret = sched_tunable_get((int)id, &value);
+        if (ret < 0) return ret;
+        if (!arg || !validate_user_ptr(arg, sizeof(value))) return -EFAULT;
+        if (copy_to_user((void*)arg, &value, sizeof(value)) != 0) return -EFAULT;
+        return 0;
+    }
+    case SCHEDCTL_SET:
+        return sched_tunable_set((int)id, arg);
+    case SCHEDCTL_WAKESTATS: {
+        k_sched_wakestats_t stats;
+        if (!arg || !validate_user_ptr(arg, sizeof(stats))) return -EFAULT;
+        sched_get_wakestats(&stats);
+        if (copy_to_user((void*)arg, &stats, sizeof(stats)) != 0) return -EFAULT;
+        return 0;
+    }
+    case SCHEDCTL_RESET_STATS:
+        sched_reset_wakestats();
+        cpuidle_reset_stats();
+        return 0;
+    case SCHEDCTL_IDLESTATS: {
+        k_sched_idlestats_t stats;
+        if (!arg || !validate_user_ptr(arg, sizeof(stats))) return -EFAULT;
+        int ret = cpuidle_get_stats((uint32_t)id, &stats);
+        if (ret < 0) return ret;
+        if (copy_to_user((void*)arg, &stats, sizeof(stats)) != 0) return -EFAULT;
+        return 0;
+    }
+    case SCHEDCTL_CPUSTATS: {
+        k_sched_cpustats_t stats;
+        if (!arg || !validate_user_ptr(arg, sizeof(stats))) return -EFAULT;
+        int ret = sched_get_cpustats((uint32_t)id, &stats);
+        if (ret < 0) return ret;
+        if (copy_to_user((void*)arg, &stats, sizeof(stats)) != 0) return -EFAULT;
+        return 0;
+    }
+    default:
+        return -EINVAL;
+    }
+}
+
+// SYS_LOCKSTAT - read or reset spinlock class statistics
+static int64_t sys_lockstat(uint64_t op, uint64_t buf, uint64_t count) {
+    switch ((int)op) {
+    case LOCKSTAT_READ: {
+        if (count > 4096) count = 4096;
+        if (count && (!buf || !validate_user_ptr(buf, count * sizeof(k_lockstat_entry_t))))
+            return -EFAULT;
+        int n = 0;
+        for (; (uint64_t)n < count; n++) {
+            k_lockstat_entry_t e;
+            int ret = lockstat_get(n, &e);
+            if (ret < 0) return ret;
+            if (ret == 0) break;
+            if (copy_to_user((k_lockstat_entry_t*)buf + n, &e, sizeof(e)) != 0)
+                return -EFAULT;
+        }
+        return n;
+    }
+    case LOCKSTAT_RESET:
+        return lockstat_reset();
+    case LOCKSTAT_TSC_HZ:
+        if (!lockstat_enabled()) return -ENOSYS;
+        return (int64_t)lapic_get_tsc_freq();
+    default:
+        return -EINVAL;
+    }
+}
+
+// SYS_SYSCALLSTAT - per-syscall call counts and latency histograms
+static int64_t sys_syscallstat(uint64_t op, uint64_t arg, uint64_t count) {
+    switch ((int)op) {
+    case SYSCALLSTAT_ENABLE:
+        return syscallstat_enable((int)arg);
+    case SYSCALLSTAT_DISABLE:
+        return syscallstat_disable();
+    case SYSCALLSTAT_RESET:
+        return syscallstat_reset();
+    case SYSCALLSTAT_READ: {
+        if (count > NR_SYSCALLS) count = NR_SYSCALLS;
+        if (count && (!arg || !validate_user_ptr(arg, count * sizeof(k_syscallstat_entry_t))))
+            return -EFAULT;
+        uint64_t n = 0;
+        for (uint32_t nr = 0; nr < NR_SYSCALLS && n < count; nr++) {
+            k_syscallstat_entry_t e;
+            if (syscallstat_get(nr, &e) <= 0) continue;
+            if (copy_to_user((k_syscallstat_entry_t*)arg + n, &e, sizeof(e)) != 0)
+                return -EFAULT;
+            n++;
+        }
+        return (int64_t)n;
+    }
+    case SYSCALLSTAT_TSC_HZ:
+        return (int64_t)lapic_get_tsc_freq();
+    default:
+        return -EINVAL;
+    }
+}
+
+// SYS_IO_URING_SETUP - create a submission/completion ring
+static int64_t sys_io_uring_setup(uint64_t entries, uint64_t params) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+
+    struct io_uring_params p;
+    if (copy_from_user(&p, (const void*)params, sizeof(p)) != 0) return -EFAULT;
+    for (int i = 0; i < 3; i++) {
+        if (p.resv[i]) return -EINVAL;
+    }
+
+    int fd = alloc_fd(cur);
+    if (fd < 0) return fd;
+    vfs_file_t* file = NULL;
+    int ret = io_uring_create((uint32_t)entries, &p, &file);
+    if (ret < 0) return ret;
+    if (copy_to_user((void*)params, &p, sizeof(p)) != 0) {
+        vfs_close(file);
+        return -EFAULT;
+    }
+    cur->fd_table[fd] = file;
+    return fd;
+}
+
+// SYS_IO_URING_ENTER - submit SQEs and/or wait for completions
+static int64_t sys_io_uring_enter(uint64_t fd, uint64_t to_submit, uint64_t min_complete,
+                                  uint64_t flags, uint64_t sig) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
+    if (sig) return -EINVAL;
+    if (fd >= TASK_MAX_FDS || !cur->fd_table[fd]) return -EBADF;
+
+    vfs_file_t* file = cur->fd_table[fd];
+    struct io_ring_ctx* ctx = io_uring_from_file(file);
+    if (!ctx) return -EOPNOTSUPP;
+
+    // Another thread may close the fd while this one waits on the ring
+    vfs_incref(file);
+    int64_t ret = io_uring_enter(ctx, (uint32_t)to_submit, (uint32_t)min_complete, (uint32_t)flags);
+    vfs_close(file);
+    return ret;
 }
 
 // SYS_MPROTECT - change memory protection
@@ -4146,8 +4648,10 @@ static int64_t sys_mprotect(uint64_t addr, uint64_t len, uint64_t prot) {
             continue;
         }
         
-        // Remap with new protection
-        mm_map_page_in_address_space(pml4, vaddr, phys, flags);
+        // Remap with new protection; a MAP_SHARED page stays one
+        uint64_t* pte = mm_get_page_table_from_pml4(pml4, vaddr, false);
+        uint64_t keep = pte ? (*pte & PAGE_SHARED) : 0;
+        mm_map_page_in_address_space(pml4, vaddr, phys, flags | keep);
     }
     
     // Flush TLB for modified pages on local CPU
@@ -4249,47 +4753,26 @@ static int64_t sys_getprocinfo(uint64_t buf_ptr, uint64_t max_count) {
     if (!kbuf) return -ENOMEM;
     mm_memset(kbuf, 0, buf_size);
 
-    uint64_t freq = timer_get_frequency();
-    if (freq == 0) freq = 100;
-
-    uint64_t flags;
-    int count = 0;
-    spin_lock_irqsave(&g_task_list_lock, &flags);
-    
-    // g_task_list_head is declared static in sched.c, but we can
-    // iterate using sched_find_task_by_id or we use extern.
-    // Actually we declared g_task_list_lock extern in sched.h, 
-    // but not g_task_list_head. Let's just use a different approach:
-    // iterate IDs from 0 upward.
-    // Actually, let's access the list directly. We need to declare it extern.
-    // For now, use the approach of iterating via sched_find_task_by_id
-    // which acquires its own lock... but we already hold the lock.
-    // Better: we declared an extern iterator in the header or iterate by PID.
-    
-    // We'll iterate PIDs. Not ideal but safe. sched_find_task_by_id
-    // acquires the lock internally, so we must NOT hold it here.
-    spin_unlock_irqrestore(&g_task_list_lock, flags);
-    
-    // Iterate all possible PIDs (g_next_id is the next ID to assign)
-    extern int g_next_id;
-    int max_pid = g_next_id;
-    
-    for (int pid = 0; pid < max_pid && count < (int)max_count; pid++) {
-        spin_lock_irqsave(&g_task_list_lock, &flags);
-        task_t* t = sched_find_task_by_id_locked(pid);
-        if (!t) {
-            spin_unlock_irqrestore(&g_task_list_lock, flags);
-            continue;
-        }
-        
-        procinfo_t* p = &kbuf[count];
+    task_t** tasks = (task_t**)kalloc(max_count * sizeof(task_t*));
+    if (!tasks) {
+        kfree(kbuf);
+        return -ENOMEM;
+    }
+
+    // One pass over the task list; tasks stay allocated until we leave the
+    // read-side section even if they exit meanwhile
+    rcu_read_lock();
+    int count = sched_snapshot_tasks(tasks, (int)max_count);
+    for (int n = 0; n < count; n++) {
+        task_t* t = tasks[n];
+        procinfo_t* p = &kbuf[n];
         p->pid = t->id;
         p->ppid = t->parent ? t->parent->id : 0;
         p->tgid = t->tgid;
         p->pgid = t->pgid;
         p->sid = t->sid;
         p->state = (int)t->state;
-        p->nice = 0;
+        p->nice = t->nice;
         p->nr_threads = t->group_leader ? t->group_leader->nr_threads : 1;
         p->on_cpu = t->on_cpu;
         p->exit_code = t->exit_code;
@@ -4306,8 +4789,22 @@ static int64_t sys_getprocinfo(uint64_t buf_ptr, uint64_t max_count) {
             p->tty_nr = t->ctty->id;
         p->is_kernel = (t->privilege == TASK_KERNEL) ? 1 : 0;
         p->start_tick = t->start_tick;
-        p->utime_ticks = t->utime_ticks;
-        p->stime_ticks = t->stime_ticks;
+        uint64_t utime_ns, stime_ns;
+        cputime_thread(t, &utime_ns, &stime_ns);
+        p->utime_ticks = utime_ns / (1000000000ULL / USER_HZ);
+        p->stime_ticks = stime_ns / (1000000000ULL / USER_HZ);
+
+        // Scheduler statistics (read racily; each field is a single word)
+        p->run_time_ns = t->sum_exec_runtime;
+        p->run_delay_ns = t->sched_run_delay;
+        p->pcount = t->sched_pcount;
+        p->nvcsw = t->nvcsw;
+        p->nivcsw = t->nivcsw;
+        p->nr_migrations = t->nr_migrations;
+        p->block_ns = t->sched_block_time;
+        p->sleep_ns = t->sched_sleep_time;
+        for (int i = 0; i < SCHED_STAT_LAT_BUCKETS; i++)
+            p->wakeup_hist[i] = t->wakeup_lat_hist[i];
         
         // UID/GID from signal state (where the kernel stores it)
         p->uid = 0;
@@ -4352,10 +4849,9 @@ static int64_t sys_getprocinfo(uint64_t buf_ptr, uint64_t max_count) {
         for (int i = 0; i < 255 && t->cwd[i]; i++)
             p->cwd[i] = t->cwd[i];
         p->cwd[255] = '\0';
-        
-        spin_unlock_irqrestore(&g_task_list_lock, flags);
-        count++;
     }
+    rcu_read_unlock();
+    kfree(tasks);
     
     // Copy to user space
     int err = copy_to_user((void*)buf_ptr, kbuf, count * sizeof(procinfo_t));
@@ -4471,43 +4967,81 @@ static int unix_sock_fd_from_fd(uint64_t fd) {
     return (int)(uintptr_t)entry;  // Return the raw UNIX socket FD marker
 }
 
-// Helper: extract epoll index from a process fd
-static int epoll_idx_from_fd(uint64_t fd) {
+// Take a reference to the epoll instance behind fd, or return NULL with
+// *err set
+static vfs_file_t* epoll_get(uint64_t fd, int* err) {
     task_t* cur = sched_current();
-    if (!cur || fd >= TASK_MAX_FDS) return -EBADF;
-    void* entry = cur->fd_table[fd];
-    if (!entry) return -EBADF;
-    if (!IS_EPOLL_FD(entry)) return -EBADF;
-    return EPOLL_FD_IDX(entry);
+    vfs_file_t* file = cur && fd < TASK_MAX_FDS ? cur->fd_table[fd] : NULL;
+    if (!file) {
+        *err = -EBADF;
+        return NULL;
+    }
+    if (!epoll_is_epoll(file)) {
+        *err = -EINVAL;
+        return NULL;
+    }
+    vfs_incref(file);
+    return file;
 }
 
 // ---------------------------------------------------------------------------
 // Noinline helpers for syscalls with large stack-allocated buffers.
-// Keeping these out of syscall_handler_inner prevents the compiler from
-// reserving stack space for ALL local arrays at function entry, which was
-// blowing past the 8 KB kernel stack.
+// Keeping them out of line means their buffers only occupy the 8 KB
+// kernel stack while they run, not in every frame that calls them.
 // ---------------------------------------------------------------------------
 
+// Relative timeouts of select/poll/epoll_wait in nanoseconds, KTIME_MAX = none
+static uint64_t poll_timeout_ms(int timeout_ms) {
+    return timeout_ms < 0 ? KTIME_MAX : (uint64_t)timeout_ms * 1000000ULL;
+}
+
+static uint64_t poll_timeout_ts(uint64_t sec, uint64_t nsec) {
+    if (sec >= KTIME_MAX / NSEC_PER_SEC) return KTIME_MAX;
+    return sec * NSEC_PER_SEC + nsec;
+}
+
+// Copy in the three optional fd_sets; a set that is NULL stays NULL
+static int select_sets_in(uint64_t a2, uint64_t a3, uint64_t a4,
+                          fd_set* kr, fd_set* kw, fd_set* ke,
+                          fd_set** rp, fd_set** wp, fd_set** ep) {
+    *rp = *wp = *ep = NULL;
+    if (a2) { if (copy_from_user(kr, (void*)a2, sizeof(fd_set))) return -EFAULT; *rp = kr; }
+    if (a3) { if (copy_from_user(kw, (void*)a3, sizeof(fd_set))) return -EFAULT; *wp = kw; }
+    if (a4) { if (copy_from_user(ke, (void*)a4, sizeof(fd_set))) return -EFAULT; *ep = ke; }
+    return 0;
+}
+
+static int select_sets_out(uint64_t a2, uint64_t a3, uint64_t a4,
+                           fd_set* rp, fd_set* wp, fd_set* ep) {
+    if (rp && copy_to_user((void*)a2, rp, sizeof(fd_set))) return -EFAULT;
+    if (wp && copy_to_user((void*)a3, wp, sizeof(fd_set))) return -EFAULT;
+    if (ep && copy_to_user((void*)a4, ep, sizeof(fd_set))) return -EFAULT;
+    return 0;
+}
+
+// struct timeval / struct timespec: two 64-bit words
+static int timeout_in(uint64_t uptr, uint64_t* sec, uint64_t* frac) {
+    uint64_t kt[2];
+    if (copy_from_user(kt, (void*)uptr, sizeof(kt))) return -EFAULT;
+    *sec = kt[0];
+    *frac = kt[1];
+    return 0;
+}
+
 __attribute__((noinline))
 static int64_t sys_select_wrapper(uint64_t a1, uint64_t a2, uint64_t a3,
                                   uint64_t a4, uint64_t a5) {
     fd_set kr, kw, ke;
-    fd_set* rp = NULL, *wp = NULL, *ep = NULL;
-    if (a2 && validate_user_ptr(a2, sizeof(fd_set))) { copy_from_user(&kr, (void*)a2, sizeof(fd_set)); rp = &kr; }
-    if (a3 && validate_user_ptr(a3, sizeof(fd_set))) { copy_from_user(&kw, (void*)a3, sizeof(fd_set)); wp = &kw; }
-    if (a4 && validate_user_ptr(a4, sizeof(fd_set))) { copy_from_user(&ke, (void*)a4, sizeof(fd_set)); ep = &ke; }
-    uint64_t timeout_ticks = (uint64_t)-1;
-    if (a5 && validate_user_ptr(a5, 16)) {
-        uint64_t tv_sec = 0, tv_usec = 0;
-        copy_from_user(&tv_sec, (void*)a5, 8);
-        copy_from_user(&tv_usec, (void*)(a5 + 8), 8);
-        timeout_ticks = tv_sec * 100 + tv_usec / 10000;
-        if (tv_sec == 0 && tv_usec == 0) timeout_ticks = 0;
-    }
-    int ret = sys_select_internal((int)a1, rp, wp, ep, timeout_ticks);
-    if (rp && a2) copy_to_user((void*)a2, rp, sizeof(fd_set));
-    if (wp && a3) copy_to_user((void*)a3, wp, sizeof(fd_set));
-    if (ep && a4) copy_to_user((void*)a4, ep, sizeof(fd_set));
+    fd_set* rp, *wp, *ep;
+    if (select_sets_in(a2, a3, a4, &kr, &kw, &ke, &rp, &wp, &ep)) return -EFAULT;
+    uint64_t timeout_ns = KTIME_MAX;
+    if (a5) {
+        uint64_t tv_sec, tv_usec;
+        if (timeout_in(a5, &tv_sec, &tv_usec)) return -EFAULT;
+        timeout_ns = poll_timeout_ts(tv_sec, tv_usec * 1000);
+    }
+    int ret = sys_select_internal((int)a1, rp, wp, ep, timeout_ns);
+    if (ret >= 0 && select_sets_out(a2, a3, a4, rp, wp, ep)) return -EFAULT;
     return ret;
 }
 
@@ -4515,23 +5049,16 @@ __attribute__((noinline))
 static int64_t sys_pselect6_wrapper(uint64_t a1, uint64_t a2, uint64_t a3,
                                     uint64_t a4, uint64_t a5) {
     fd_set kr, kw, ke;
-    fd_set* rp = NULL, *wp = NULL, *ep = NULL;
-    if (a2 && validate_user_ptr(a2, sizeof(fd_set))) { copy_from_user(&kr, (void*)a2, sizeof(fd_set)); rp = &kr; }
-    if (a3 && validate_user_ptr(a3, sizeof(fd_set))) { copy_from_user(&kw, (void*)a3, sizeof(fd_set)); wp = &kw; }
-    if (a4 && validate_user_ptr(a4, sizeof(fd_set))) { copy_from_user(&ke, (void*)a4, sizeof(fd_set)); ep = &ke; }
-    uint64_t timeout_ticks = (uint64_t)-1;
-    if (a5 && validate_user_ptr(a5, 16)) {
-        uint64_t tv_sec = 0;
-        long tv_nsec = 0;
-        copy_from_user(&tv_sec, (void*)a5, 8);
-        copy_from_user(&tv_nsec, (void*)(a5 + 8), 8);
-        timeout_ticks = tv_sec * 100 + (uint64_t)tv_nsec / 10000000;
-        if (tv_sec == 0 && tv_nsec == 0) timeout_ticks = 0;
-    }
-    int ret = sys_select_internal((int)a1, rp, wp, ep, timeout_ticks);
-    if (rp && a2) copy_to_user((void*)a2, rp, sizeof(fd_set));
-    if (wp && a3) copy_to_user((void*)a3, wp, sizeof(fd_set));
-    if (ep && a4) copy_to_user((void*)a4, ep, sizeof(fd_set));
+    fd_set* rp, *wp, *ep;
+    if (select_sets_in(a2, a3, a4, &kr, &kw, &ke, &rp, &wp, &ep)) return -EFAULT;
+    uint64_t timeout_ns = KTIME_MAX;
+    if (a5) {
+        uint64_t tv_sec, tv_nsec;
+        if (timeout_in(a5, &tv_sec, &tv_nsec)) return -EFAULT;
+        timeout_ns = poll_timeout_ts(tv_sec, tv_nsec);
+    }
+    int ret = sys_select_internal((int)a1, rp, wp, ep, timeout_ns);
+    if (ret >= 0 && select_sets_out(a2, a3, a4, rp, wp, ep)) return -EFAULT;
     return ret;
 }
 
@@ -4540,16 +5067,10 @@ static int64_t sys_poll_wrapper(uint64_t a1, uint64_t a2, uint64_t a3) {
     int nfds = (int)a2;
     if (nfds < 0 || nfds > 256) return -EINVAL;
     size_t sz = (size_t)nfds * sizeof(struct pollfd);
-    if (!validate_user_ptr(a1, sz)) return -EFAULT;
     struct pollfd kfds[256];
-    copy_from_user(kfds, (void*)a1, sz);
-    int timeout_ms = (int)(int64_t)a3;
-    uint64_t timeout_ticks;
-    if (timeout_ms < 0) timeout_ticks = (uint64_t)-1;
-    else if (timeout_ms == 0) timeout_ticks = 0;
-    else timeout_ticks = (uint64_t)timeout_ms / 10;
-    int ret = sys_poll_internal(kfds, nfds, timeout_ticks);
-    copy_to_user((void*)a1, kfds, sz);
+    if (copy_from_user(kfds, (void*)a1, sz)) return -EFAULT;
+    int ret = sys_poll_internal(kfds, nfds, poll_timeout_ms((int)(int64_t)a3));
+    if (ret >= 0 && copy_to_user((void*)a1, kfds, sz)) return -EFAULT;
     return ret;
 }
 
@@ -4558,50 +5079,49 @@ static int64_t sys_ppoll_wrapper(uint64_t a1, uint64_t a2, uint64_t a3) {
     int nfds = (int)a2;
     if (nfds < 0 || nfds > 256) return -EINVAL;
     size_t sz = (size_t)nfds * sizeof(struct pollfd);
-    if (!validate_user_ptr(a1, sz)) return -EFAULT;
     struct pollfd kfds[256];
-    copy_from_user(kfds, (void*)a1, sz);
-    uint64_t timeout_ticks = (uint64_t)-1;
-    if (a3 && validate_user_ptr(a3, 16)) {
-        uint64_t tv_sec = 0;
-        long tv_nsec = 0;
-        copy_from_user(&tv_sec, (void*)a3, 8);
-        copy_from_user(&tv_nsec, (void*)(a3 + 8), 8);
-        timeout_ticks = tv_sec * 100 + (uint64_t)tv_nsec / 10000000;
-        if (tv_sec == 0 && tv_nsec == 0) timeout_ticks = 0;
-    }
-    int ret = sys_poll_internal(kfds, nfds, timeout_ticks);
-    copy_to_user((void*)a1, kfds, sz);
+    if (copy_from_user(kfds, (void*)a1, sz)) return -EFAULT;
+    uint64_t timeout_ns = KTIME_MAX;
+    if (a3) {
+        uint64_t tv_sec, tv_nsec;
+        if (timeout_in(a3, &tv_sec, &tv_nsec)) return -EFAULT;
+        timeout_ns = poll_timeout_ts(tv_sec, tv_nsec);
+    }
+    int ret = sys_poll_internal(kfds, nfds, timeout_ns);
+    if (ret >= 0 && copy_to_user((void*)a1, kfds, sz)) return -EFAULT;
     return ret;
 }
 
 __attribute__((noinline))
 static int64_t sys_epoll_wait_wrapper(uint64_t a1, uint64_t a2, uint64_t a3,
                                       uint64_t a4) {
-    int ep_idx = epoll_idx_from_fd(a1);
-    if (ep_idx < 0) return ep_idx;
     int maxevents = (int)a3;
-    if (maxevents <= 0 || maxevents > 256) return -EINVAL;
+    if (maxevents <= 0) return -EINVAL;
+    // Larger arrays are filled 256 events per call; the rest stay ready
+    if (maxevents > 256) maxevents = 256;
     size_t sz = (size_t)maxevents * sizeof(struct epoll_event);
     if (!validate_user_ptr(a2, sz)) return -EFAULT;
+    int err;
+    vfs_file_t* epf = epoll_get(a1, &err);
+    if (!epf) return err;
     struct epoll_event kevs[256];
-    int timeout_ms = (int)(int64_t)a4;
-    uint64_t timeout_ticks;
-    if (timeout_ms < 0) timeout_ticks = (uint64_t)-1;
-    else if (timeout_ms == 0) timeout_ticks = 0;
-    else timeout_ticks = (uint64_t)timeout_ms / 10;
-    int ret = epoll_wait_internal(ep_idx, kevs, maxevents, timeout_ticks);
-    if (ret > 0)
-        copy_to_user((void*)a2, kevs, (size_t)ret * sizeof(struct epoll_event));
+    int ret = epoll_wait_internal(epf, kevs, maxevents, poll_timeout_ms((int)(int64_t)a4));
+    vfs_close(epf);
+    if (ret > 0 && copy_to_user((void*)a2, kevs, (size_t)ret * sizeof(struct epoll_event)))
+        return -EFAULT;
     return ret;
 }
 
 // ---------------------------------------------------------------------------
 // UNIX-domain sendmsg / recvmsg helpers.
-// Both carry large stack objects (iov[256], 4 KB data buffer) so they are
-// kept out of syscall_handler_inner to avoid bloating the kernel stack.
+// The data moves through a per-call kalloc()ed bounce buffer of at most
+// UNIX_MSG_MAX bytes, gathered from or scattered to the caller's iovecs
+// with an iov_iter; the control buffer stays on the stack, so they are
+// kept out of the table handlers to avoid bloating the kernel stack.
 // ---------------------------------------------------------------------------
 
+#define UNIX_MSG_MAX    4096        // Bytes one sendmsg/recvmsg moves
+
 __attribute__((noinline))
 static int unix_do_sendmsg(int ufd, struct msghdr *kmsg) {
     unix_socket_t* us = unix_get(ufd);
@@ -4609,6 +5129,30 @@ static int unix_do_sendmsg(int ufd, struct msghdr *kmsg) {
     unix_socket_t* peer = us->peer;
     if (!peer || !peer->active) return -ENOTCONN;
 
+    /* Gather the data first, so a bad buffer fails the call before any
+     * fd has been passed.  Stream sockets take up to UNIX_MSG_MAX bytes. */
+    struct iovec fast[UIO_FASTIOV];
+    struct iovec* iov;
+    iov_iter_t it;
+    long total = import_iovec(kmsg->msg_iov, (unsigned long)kmsg->msg_iovlen,
+                              fast, &iov, &it);
+    if (total < 0) return (int)total;
+    if (total > UNIX_MSG_MAX) total = UNIX_MSG_MAX;
+    uint8_t* sbuf = NULL;
+    if (total > 0) {
+        sbuf = (uint8_t*)kalloc((size_t)total);
+        if (!sbuf) {
+            if (iov != fast) kfree(iov);
+            return -ENOMEM;
+        }
+        if (copy_from_iter(sbuf, (size_t)total, &it) != (size_t)total) {
+            kfree(sbuf);
+            if (iov != fast) kfree(iov);
+            return -EFAULT;
+        }
+    }
+    if (iov != fast) kfree(iov);
+
     /* Process control data first so the fd arrives before (or with) the
      * byte that the receiver associates it with.  The imsg framing tmux
      * uses sends one fd per message and the receiver pops the next pending
@@ -4617,12 +5161,16 @@ static int unix_do_sendmsg(int ufd, struct msghdr *kmsg) {
         size_t clen = kmsg->msg_controllen;
         if (clen > 256) clen = 256;
         unsigned char cbuf[256];
-        if (!validate_user_ptr((uint64_t)kmsg->msg_control, clen))
+        if (copy_from_user(cbuf, kmsg->msg_control, clen)) {
+            kfree(sbuf);
             return -EFAULT;
-        copy_from_user(cbuf, kmsg->msg_control, clen);
+        }
         size_t off = 0;
         task_t* cur = sched_current();
-        if (!cur) return -EFAULT;
+        if (!cur) {
+            kfree(sbuf);
+            return -EFAULT;
+        }
         while (off + sizeof(struct cmsghdr) <= clen) {
             struct cmsghdr* cmsg = (struct cmsghdr*)(cbuf + off);
             if (cmsg->cmsg_len < sizeof(struct cmsghdr)) break;
@@ -4648,8 +5196,6 @@ static int unix_do_sendmsg(int ufd, struct msghdr *kmsg) {
                     } else if (IS_UNIX_SOCKET_FD(entry)) {
                         unix_socket_t* xs = unix_get((int)(uintptr_t)entry);
                         if (xs) __atomic_fetch_add(&xs->ref_count, 1, __ATOMIC_ACQ_REL);
-                    } else if (IS_EPOLL_FD(entry)) {
-                        /* opaque marker, no per-instance ref */
                     } else if (pipe_is_end(entry)) {
                         pipe_end_t* ne = pipe_dup_end((pipe_end_t*)entry);
                         if (ne) entry = ne;
@@ -4664,40 +5210,10 @@ static int unix_do_sendmsg(int ufd, struct msghdr *kmsg) {
         }
     }
 
-    /* Flatten iov into a temp buffer, then unix_send. */
-    if (kmsg->msg_iovlen <= 0) return 0;
-    /* Stream sockets: process up to 4096 bytes; cap iov count so the
-     * on-stack array is bounded. */
-    int kiovcnt = kmsg->msg_iovlen;
-    if (kiovcnt > 256) kiovcnt = 256;
-    struct iovec iov[256];
-    if (!validate_user_ptr((uint64_t)kmsg->msg_iov,
-                           sizeof(struct iovec) * (size_t)kiovcnt))
-        return -EFAULT;
-    copy_from_user(iov, kmsg->msg_iov,
-                   sizeof(struct iovec) * (size_t)kiovcnt);
-    size_t total = 0;
-    for (int i = 0; i < kiovcnt; i++) {
-        if (total + iov[i].iov_len > 4096) {
-            iov[i].iov_len = 4096 - total;
-            total = 4096;
-            kiovcnt = i + 1;
-            break;
-        }
-        total += iov[i].iov_len;
-    }
     if (total == 0) return 0;
-    static uint8_t sbuf[4096];
-    size_t off = 0;
-    for (int i = 0; i < kiovcnt && off < total; i++) {
-        size_t chunk = iov[i].iov_len;
-        if (off + chunk > total) chunk = total - off;
-        if (!validate_user_ptr((uint64_t)iov[i].iov_base, chunk))
-            return -EFAULT;
-        copy_from_user(sbuf + off, iov[i].iov_base, chunk);
-        off += chunk;
-    }
-    return unix_send(ufd, sbuf, total, 0);
+    int ret = unix_send(ufd, sbuf, (size_t)total, 0);
+    kfree(sbuf);
+    return ret;
 }
 
 __attribute__((noinline))
@@ -4705,19 +5221,17 @@ static int unix_do_recvmsg(int ufd, struct msghdr *kmsg) {
     unix_socket_t* us = unix_get(ufd);
     if (!us) return -EBADF;
 
-    if (kmsg->msg_iovlen <= 0) return 0;
-    int riovcnt = kmsg->msg_iovlen;
-    if (riovcnt > 256) riovcnt = 256;
-    struct iovec iov[256];
-    if (!validate_user_ptr((uint64_t)kmsg->msg_iov,
-                           sizeof(struct iovec) * (size_t)riovcnt))
-        return -EFAULT;
-    copy_from_user(iov, kmsg->msg_iov,
-                   sizeof(struct iovec) * (size_t)riovcnt);
-    size_t total = 0;
-    for (int i = 0; i < riovcnt; i++) total += iov[i].iov_len;
-    if (total == 0) return 0;
-    if (total > 4096) total = 4096;
+    struct iovec fast[UIO_FASTIOV];
+    struct iovec* iov;
+    iov_iter_t it;
+    long itotal = import_iovec(kmsg->msg_iov, (unsigned long)kmsg->msg_iovlen,
+                               fast, &iov, &it);
+    if (itotal <= 0) {
+        if (itotal == 0 && iov != fast) kfree(iov);
+        return (int)itotal;
+    }
+    size_t total = (size_t)itotal;
+    if (total > UNIX_MSG_MAX) total = UNIX_MSG_MAX;
 
     /* Stream-mode SCM_RIGHTS framing: if a pending fd is queued at byte
      * offset N (in the receiver's bytes_read coordinate system), clamp
@@ -4753,20 +5267,18 @@ static int unix_do_recvmsg(int ufd, struct msghdr *kmsg) {
         }
     }
 
-    static uint8_t rbuf[4096];
+    uint8_t* rbuf = (uint8_t*)kalloc(total);
+    if (!rbuf) {
+        if (iov != fast) kfree(iov);
+        return -ENOMEM;
+    }
     int got = unix_recv(ufd, rbuf, total, 0);
+    if (got > 0 && copy_to_iter(rbuf, (size_t)got, &it) != (size_t)got)
+        got = -EFAULT;
+    kfree(rbuf);
+    if (iov != fast) kfree(iov);
     if (got < 0) return got;
 
-    size_t off = 0;
-    for (int i = 0; i < riovcnt && off < (size_t)got; i++) {
-        size_t chunk = iov[i].iov_len;
-        if (off + chunk > (size_t)got) chunk = (size_t)got - off;
-        if (!validate_user_ptr((uint64_t)iov[i].iov_base, chunk))
-            return -EFAULT;
-        copy_to_user(iov[i].iov_base, rbuf + off, chunk);
-        off += chunk;
-    }
-
     /* Deliver one pending fd via SCM_RIGHTS, but only at the correct
      * byte boundary. */
     kmsg->msg_flags = 0;
@@ -4806,10 +5318,8 @@ static int unix_do_recvmsg(int ufd, struct msghdr *kmsg) {
                 c->cmsg_level = SOL_SOCKET;
                 c->cmsg_type  = SCM_RIGHTS;
                 *(int*)CMSG_DATA(c) = newfd;
-                if (!validate_user_ptr((uint64_t)kmsg->msg_control,
-                                       CMSG_SPACE(sizeof(int))))
+                if (copy_to_user(kmsg->msg_control, cbuf, CMSG_SPACE(sizeof(int))))
                     return -EFAULT;
-                copy_to_user(kmsg->msg_control, cbuf, CMSG_SPACE(sizeof(int)));
                 kmsg->msg_controllen = CMSG_SPACE(sizeof(int));
             }
         } else {
@@ -4821,1076 +5331,1099 @@ static int unix_do_recvmsg(int ufd, struct msghdr *kmsg) {
     return got;
 }
 
-// Main syscall dispatcher (inner function)
-static int64_t syscall_handler_inner(uint64_t num, uint64_t a1, uint64_t a2, 
-                        uint64_t a3, uint64_t a4, uint64_t a5) {
-    switch (num) {
-        case SYS_READ:
-            return sys_read(a1, a2, a3);
-            
-        case SYS_WRITE:
-            return sys_write(a1, a2, a3);
-            
-        case SYS_OPEN:
-            return sys_open(a1, a2, a3);
-            
-        case SYS_CLOSE:
-            return sys_close(a1);
-            
-        case SYS_LSEEK:
-            return sys_lseek(a1, (int64_t)a2, a3);
-            
-        case SYS_MMAP:
-            return sys_mmap(a1, a2, a3, a4, a5, 0);  // Note: 6th arg (offset) would need special handling
+// ============================================================================
+// Syscall table
+// ============================================================================
+// Every handler takes the six raw argument registers (rdi, rsi, rdx, r10,
+// r8, r9) and narrows them for the sys_* implementation.  Numbers without
+// an entry fail with -ENOSYS.
+
+typedef int64_t (*syscall_fn_t)(uint64_t a1, uint64_t a2, uint64_t a3,
+                                uint64_t a4, uint64_t a5, uint64_t a6);
+
+#define SC_UNUSED       __attribute__((unused))
+#define SYSCALL_ARGS    uint64_t a1 SC_UNUSED, uint64_t a2 SC_UNUSED, uint64_t a3 SC_UNUSED, \
+                        uint64_t a4 SC_UNUSED, uint64_t a5 SC_UNUSED, uint64_t a6 SC_UNUSED
+
+static int64_t sc_read(SYSCALL_ARGS) { return sys_read(a1, a2, a3); }
+static int64_t sc_write(SYSCALL_ARGS) { return sys_write(a1, a2, a3); }
+static int64_t sc_open(SYSCALL_ARGS) { return sys_open(a1, a2, a3); }
+static int64_t sc_close(SYSCALL_ARGS) { return sys_close(a1); }
+static int64_t sc_lseek(SYSCALL_ARGS) { return sys_lseek(a1, (int64_t)a2, a3); }
+static int64_t sc_mmap(SYSCALL_ARGS) { return sys_mmap(a1, a2, a3, a4, a5, a6); }
+static int64_t sc_munmap(SYSCALL_ARGS) { return sys_munmap(a1, a2); }
+static int64_t sc_brk(SYSCALL_ARGS) { return sys_brk(a1); }
+static int64_t sc_getpid(SYSCALL_ARGS) { return sys_getpid(); }
+static int64_t sc_fork(SYSCALL_ARGS) { return sys_fork(); }
+static int64_t sc_wait4(SYSCALL_ARGS) { return sys_waitpid((int64_t)a1, a2, a3, a4); }
+static int64_t sc_getppid(SYSCALL_ARGS) { return sys_getppid(); }
+static int64_t sc_execve(SYSCALL_ARGS) { return sys_execve(a1, a2, a3); }
+static int64_t sc_dup(SYSCALL_ARGS) { return sys_dup(a1); }
+static int64_t sc_dup2(SYSCALL_ARGS) { return sys_dup2(a1, a2); }
+
+static int64_t sc_exit(SYSCALL_ARGS) {
+    sys_exit(a1);
+    return 0;  // Never reached
+}
+
+static int64_t sc_pipe(SYSCALL_ARGS) { return sys_pipe(a1); }
+static int64_t sc_yield(SYSCALL_ARGS) { return sys_yield(); }
+static int64_t sc_stat(SYSCALL_ARGS) { return sys_stat(a1, a2); }
+static int64_t sc_lstat(SYSCALL_ARGS) { return sys_lstat(a1, a2); }
+static int64_t sc_fstat(SYSCALL_ARGS) { return sys_fstat(a1, a2); }
+static int64_t sc_access(SYSCALL_ARGS) { return sys_access(a1, a2); }
+static int64_t sc_chdir(SYSCALL_ARGS) { return sys_chdir(a1); }
+static int64_t sc_getcwd(SYSCALL_ARGS) { return sys_getcwd(a1, a2); }
+static int64_t sc_umask(SYSCALL_ARGS) { return sys_umask(a1); }
+static int64_t sc_getuid(SYSCALL_ARGS) { return sys_getuid(); }
+static int64_t sc_getgid(SYSCALL_ARGS) { return sys_getgid(); }
+static int64_t sc_geteuid(SYSCALL_ARGS) { return sys_geteuid(); }
+static int64_t sc_getegid(SYSCALL_ARGS) { return sys_getegid(); }
+static int64_t sc_setuid(SYSCALL_ARGS) { return sys_setuid(a1); }
+static int64_t sc_setgid(SYSCALL_ARGS) { return sys_setgid(a1); }
+static int64_t sc_seteuid(SYSCALL_ARGS) { return sys_seteuid(a1); }
+static int64_t sc_setegid(SYSCALL_ARGS) { return sys_setegid(a1); }
+static int64_t sc_getgroups(SYSCALL_ARGS) { return sys_getgroups(a1, a2); }
+static int64_t sc_setgroups(SYSCALL_ARGS) { return sys_setgroups(a1, a2); }
+static int64_t sc_gethostname(SYSCALL_ARGS) { return sys_gethostname(a1, a2); }
+static int64_t sc_uname(SYSCALL_ARGS) { return sys_uname(a1); }
+static int64_t sc_time(SYSCALL_ARGS) { return sys_time(a1); }
+static int64_t sc_gettimeofday(SYSCALL_ARGS) { return sys_gettimeofday(a1, a2); }
+static int64_t sc_settimeofday(SYSCALL_ARGS) { return sys_settimeofday(a1, a2); }
+static int64_t sc_fsync(SYSCALL_ARGS) { return sys_fsync(a1); }
+static int64_t sc_ftruncate(SYSCALL_ARGS) { return sys_ftruncate(a1, a2); }
+static int64_t sc_fcntl(SYSCALL_ARGS) { return sys_fcntl(a1, a2, a3); }
+static int64_t sc_ioctl(SYSCALL_ARGS) { return sys_ioctl(a1, a2, a3); }
+static int64_t sc_setpgid(SYSCALL_ARGS) { return sys_setpgid(a1, a2); }
+static int64_t sc_getpgrp(SYSCALL_ARGS) { return sys_getpgrp(); }
+static int64_t sc_tcgetpgrp(SYSCALL_ARGS) { return sys_tcgetpgrp(a1); }
+static int64_t sc_tcsetpgrp(SYSCALL_ARGS) { return sys_tcsetpgrp(a1, a2); }
+static int64_t sc_kill(SYSCALL_ARGS) { return sys_kill(a1, a2); }
+static int64_t sc_unlink(SYSCALL_ARGS) { return sys_unlink(a1); }
+static int64_t sc_rename(SYSCALL_ARGS) { return sys_rename(a1, a2); }
+static int64_t sc_mkdir(SYSCALL_ARGS) { return sys_mkdir(a1, a2); }
+static int64_t sc_rmdir(SYSCALL_ARGS) { return sys_rmdir(a1); }
+static int64_t sc_link(SYSCALL_ARGS) { return sys_link(a1, a2); }
+static int64_t sc_symlink(SYSCALL_ARGS) { return sys_symlink(a1, a2); }
+static int64_t sc_readlink(SYSCALL_ARGS) { return sys_readlink(a1, a2, a3); }
+static int64_t sc_chmod(SYSCALL_ARGS) { return sys_chmod(a1, a2); }
+static int64_t sc_fchmod(SYSCALL_ARGS) { return sys_fchmod(a1, a2); }
+static int64_t sc_chown(SYSCALL_ARGS) { return sys_chown(a1, a2, a3); }
+static int64_t sc_openat(SYSCALL_ARGS) { return sys_openat(a1, a2, a3, a4); }
+static int64_t sc_fstatat(SYSCALL_ARGS) { return sys_fstatat(a1, a2, a3, a4); }
+static int64_t sc_faccessat(SYSCALL_ARGS) { return sys_faccessat(a1, a2, a3, a4); }
+static int64_t sc_getdents64(SYSCALL_ARGS) { return sys_getdents64(a1, a2, a3); }
+static int64_t sc_getdents(SYSCALL_ARGS) { return sys_getdents(a1, a2, a3); }
+static int64_t sc_fchown(SYSCALL_ARGS) { return sys_fchown(a1, a2, a3); }
+static int64_t sc_utimensat(SYSCALL_ARGS) { return sys_utimensat(a1, a2, a3, a4); }
+static int64_t sc_statfs(SYSCALL_ARGS) { return sys_statfs(a1, a2); }
+static int64_t sc_fstatfs(SYSCALL_ARGS) { return sys_fstatfs(a1, a2); }
+
+// Signal syscalls
+static int64_t sc_rt_sigaction(SYSCALL_ARGS) { return sys_rt_sigaction(a1, a2, a3, a4); }
+static int64_t sc_rt_sigprocmask(SYSCALL_ARGS) { return sys_rt_sigprocmask(a1, a2, a3, a4); }
+static int64_t sc_rt_sigpending(SYSCALL_ARGS) { return sys_rt_sigpending(a1, a2); }
+static int64_t sc_rt_sigtimedwait(SYSCALL_ARGS) { return sys_rt_sigtimedwait(a1, a2, a3, a4); }
+static int64_t sc_rt_sigqueueinfo(SYSCALL_ARGS) { return sys_rt_sigqueueinfo(a1, a2, a3); }
+static int64_t sc_rt_sigsuspend(SYSCALL_ARGS) { return sys_rt_sigsuspend(a1, a2); }
+static int64_t sc_rt_sigreturn(SYSCALL_ARGS) { return sys_rt_sigreturn(); }
+static int64_t sc_sigaltstack(SYSCALL_ARGS) { return sys_sigaltstack(a1, a2); }
+static int64_t sc_tkill(SYSCALL_ARGS) { return sys_tkill(a1, a2); }
+static int64_t sc_tgkill(SYSCALL_ARGS) { return sys_tgkill(a1, a2, a3); }
+static int64_t sc_alarm(SYSCALL_ARGS) { return sys_alarm(a1); }
+static int64_t sc_setitimer(SYSCALL_ARGS) { return sys_setitimer(a1, a2, a3); }
+static int64_t sc_getitimer(SYSCALL_ARGS) { return sys_getitimer(a1, a2); }
+static int64_t sc_timer_create(SYSCALL_ARGS) { return sys_timer_create(a1, a2, a3); }
+static int64_t sc_timer_settime(SYSCALL_ARGS) { return sys_timer_settime(a1, a2, a3, a4); }
+static int64_t sc_timer_gettime(SYSCALL_ARGS) { return sys_timer_gettime(a1, a2); }
+static int64_t sc_timer_getoverrun(SYSCALL_ARGS) { return sys_timer_getoverrun(a1); }
+static int64_t sc_timer_delete(SYSCALL_ARGS) { return sys_timer_delete(a1); }
+static int64_t sc_signalfd(SYSCALL_ARGS) { return sys_signalfd(a1, a2, a3); }
+static int64_t sc_pause(SYSCALL_ARGS) { return sys_pause(); }
+static int64_t sc_nanosleep(SYSCALL_ARGS) { return sys_nanosleep(a1, a2); }
+static int64_t sc_clock_gettime(SYSCALL_ARGS) { return sys_clock_gettime(a1, a2); }
+static int64_t sc_clock_getres(SYSCALL_ARGS) { return sys_clock_getres(a1, a2); }
+
+// SMP/Threading syscalls
+static int64_t sc_clone(SYSCALL_ARGS) { return sys_clone(a1, a2, a3, a4, a5); }
+static int64_t sc_vfork(SYSCALL_ARGS) { return sys_vfork(); }
+
+static int64_t sc_exit_group(SYSCALL_ARGS) {
+    sys_exit_group(a1);
+    return 0;  // Never reached
+}
+
+static int64_t sc_gettid(SYSCALL_ARGS) { return sys_gettid(); }
+static int64_t sc_set_tid_address(SYSCALL_ARGS) { return sys_set_tid_address(a1); }
+static int64_t sc_futex(SYSCALL_ARGS) { return sys_futex(a1, a2, a3, a4, a5, a6); }
+static int64_t sc_set_robust_list(SYSCALL_ARGS) { return sys_set_robust_list(a1, a2); }
+static int64_t sc_get_robust_list(SYSCALL_ARGS) { return sys_get_robust_list(a1, a2, a3); }
+static int64_t sc_arch_prctl(SYSCALL_ARGS) { return sys_arch_prctl(a1, a2); }
+static int64_t sc_sched_setaffinity(SYSCALL_ARGS) { return sys_sched_setaffinity(a1, a2, a3); }
+static int64_t sc_sched_getaffinity(SYSCALL_ARGS) { return sys_sched_getaffinity(a1, a2, a3); }
+static int64_t sc_sched_setscheduler(SYSCALL_ARGS) { return sys_sched_setscheduler(a1, a2, a3); }
+static int64_t sc_sched_getscheduler(SYSCALL_ARGS) { return sys_sched_getscheduler(a1); }
+static int64_t sc_sched_setparam(SYSCALL_ARGS) { return sys_sched_setparam(a1, a2); }
+static int64_t sc_sched_getparam(SYSCALL_ARGS) { return sys_sched_getparam(a1, a2); }
+static int64_t sc_sched_get_priority_max(SYSCALL_ARGS) { return sys_sched_get_priority_max(a1); }
+static int64_t sc_sched_get_priority_min(SYSCALL_ARGS) { return sys_sched_get_priority_min(a1); }
+static int64_t sc_sched_rr_get_interval(SYSCALL_ARGS) { return sys_sched_rr_get_interval(a1, a2); }
+static int64_t sc_getpriority(SYSCALL_ARGS) { return sys_getpriority(a1, a2); }
+static int64_t sc_setpriority(SYSCALL_ARGS) { return sys_setpriority(a1, a2, a3); }
+static int64_t sc_schedctl(SYSCALL_ARGS) { return sys_schedctl(a1, a2, a3); }
+static int64_t sc_lockstat(SYSCALL_ARGS) { return sys_lockstat(a1, a2, a3); }
+static int64_t sc_mprotect(SYSCALL_ARGS) { return sys_mprotect(a1, a2, a3); }
+static int64_t sc_reboot(SYSCALL_ARGS) { return sys_reboot(a1, a2, a3, a4); }
+static int64_t sc_getprocinfo(SYSCALL_ARGS) { return sys_getprocinfo(a1, a2); }
+
+static int64_t sc_memstats(SYSCALL_ARGS) {
+    if (!a1) return -EFAULT;
+    memory_stats_t stats;
+    mm_get_memory_stats(&stats);
+    if (copy_to_user((void*)a1, &stats, sizeof(stats)) != 0)
+        return -EFAULT;
+    return 0;
+}
 
-        case SYS_MUNMAP:
-            return sys_munmap(a1, a2);
-            
-        case SYS_BRK:
-            return sys_brk(a1);
-            
-        case SYS_GETPID:
-            return sys_getpid();
-            
-        case SYS_FORK:
-            return sys_fork();
-            
-        case SYS_WAIT4:
-            return sys_waitpid((int64_t)a1, a2, a3, a4);
-            
-        case SYS_GETPPID:
-            return sys_getppid();
-
-        case SYS_EXECVE:
-            return sys_execve(a1, a2, a3);
-            
-        case SYS_DUP:
-            return sys_dup(a1);
-            
-        case SYS_DUP2:
-            return sys_dup2(a1, a2);
-            
-        case SYS_EXIT:
-            sys_exit(a1);
-            // Never returns
-
-        case SYS_PIPE:
-            return sys_pipe(a1);
-            
-        case SYS_YIELD:
-            return sys_yield();
-
-        case SYS_STAT:
-            return sys_stat(a1, a2);
-
-        case SYS_LSTAT:
-            return sys_lstat(a1, a2);
-
-        case SYS_FSTAT:
-            return sys_fstat(a1, a2);
-
-        case SYS_ACCESS:
-            return sys_access(a1, a2);
-
-        case SYS_CHDIR:
-            return sys_chdir(a1);
-
-        case SYS_GETCWD:
-            return sys_getcwd(a1, a2);
-
-        case SYS_UMASK:
-            return sys_umask(a1);
-
-        case SYS_GETUID:
-            return sys_getuid();
-
-        case SYS_GETGID:
-            return sys_getgid();
-
-        case SYS_GETEUID:
-            return sys_geteuid();
+static int64_t sc_sysinfo(SYSCALL_ARGS) { return sys_sysinfo(a1); }
+static int64_t sc_klogctl(SYSCALL_ARGS) { return sys_klogctl(a1, a2, a3); }
+static int64_t sc_sync(SYSCALL_ARGS) { return sys_sync(); }
 
-        case SYS_GETEGID:
-            return sys_getegid();
+// Socket syscalls
 
-        case SYS_SETUID:
-            return sys_setuid(a1);
-
-        case SYS_SETGID:
-            return sys_setgid(a1);
-
-        case SYS_SETEUID:
-            return sys_seteuid(a1);
-
-        case SYS_SETEGID:
-            return sys_setegid(a1);
-
-        case SYS_GETGROUPS:
-            return sys_getgroups(a1, a2);
-
-        case SYS_SETGROUPS:
-            return sys_setgroups(a1, a2);
-
-        case SYS_GETHOSTNAME:
-            return sys_gethostname(a1, a2);
-
-        case SYS_UNAME:
-            return sys_uname(a1);
-
-        case SYS_TIME:
-            return sys_time(a1);
-
-        case SYS_GETTIMEOFDAY:
-            return sys_gettimeofday(a1, a2);
-
-        case SYS_SETTIMEOFDAY:
-            return sys_settimeofday(a1, a2);
-
-        case SYS_FSYNC:
-            return sys_fsync(a1);
+static int64_t sc_socket(SYSCALL_ARGS) {
+    int real_type = (int)a2 & ~(SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if ((int)a1 == AF_UNIX) {
+        int ufd = unix_create(real_type);
+        if (ufd < 0) return ufd;
+        task_t* cur = sched_current();
+        if (!cur) { unix_close(ufd); return -EFAULT; }
+        for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
+            if (cur->fd_table[_fd] == NULL) {
+                cur->fd_table[_fd] = (void*)(uintptr_t)ufd;
+                if ((int)a2 & SOCK_NONBLOCK) {
+                    unix_socket_t* _s = unix_get(ufd);
+                    if (_s) _s->nonblock = 1;
+                }
+                return _fd;
+            }
+        }
+        unix_close(ufd);
+        return -EMFILE;
+    }
+    int sock_idx = sock_create((int)a1, real_type, (int)a3);
+    if (sock_idx < 0) return sock_idx;
+    // Allocate a process fd pointing to the socket
+    task_t* cur = sched_current();
+    if (!cur) { sock_close(sock_idx); return -EFAULT; }
+    for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
+        if (cur->fd_table[_fd] == NULL) {
+            cur->fd_table[_fd] = MAKE_SOCKET_FD(sock_idx);
+            if ((int)a2 & SOCK_NONBLOCK) {
+                net_socket_t* _s = sock_get(sock_idx);
+                if (_s) _s->nonblock = 1;
+            }
+            return _fd;
+        }
+    }
+    sock_close(sock_idx);
+    return -EMFILE;
+}
 
-        case SYS_FTRUNCATE:
-            return sys_ftruncate(a1, a2);
+static int64_t sc_bind(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        struct sockaddr_un kaddr;
+        if (copy_from_user(&kaddr, (const void*)a2, sizeof(struct sockaddr_un))) return -EFAULT;
+        return unix_bind(ufd, &kaddr);
+    }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    struct sockaddr_in kaddr;
+    if (copy_from_user(&kaddr, (const void*)a2, sizeof(struct sockaddr_in))) return -EFAULT;
+    return sock_bind(idx, &kaddr);
+}
 
-        case SYS_FCNTL:
-            return sys_fcntl(a1, a2, a3);
+static int64_t sc_listen(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) return unix_listen(ufd, (int)a2);
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    return sock_listen(idx, (int)a2);
+}
 
-        case SYS_IOCTL:
-            return sys_ioctl(a1, a2, a3);
+// accept()'s peer address, written before the new fd is installed so a
+// bad buffer can fail the call without leaking the connection
+static int accept_addr_out(uint64_t uaddr, uint64_t ulen, const void* kaddr,
+                           size_t size, socklen_t klen) {
+    if (!uaddr || !ulen) return 0;
+    if (copy_to_user((void*)uaddr, kaddr, size) ||
+        copy_to_user((void*)ulen, &klen, sizeof(socklen_t)))
+        return -EFAULT;
+    return 0;
+}
 
-        case SYS_SETPGID:
-            return sys_setpgid(a1, a2);
-
-        case SYS_GETPGRP:
-            return sys_getpgrp();
-
-        case SYS_TCGETPGRP:
-            return sys_tcgetpgrp(a1);
-
-        case SYS_TCSETPGRP:
-            return sys_tcsetpgrp(a1, a2);
-
-        case SYS_KILL:
-            return sys_kill(a1, a2);
-
-        case SYS_UNLINK:
-            return sys_unlink(a1);
-
-        case SYS_RENAME:
-            return sys_rename(a1, a2);
-
-        case SYS_MKDIR:
-            return sys_mkdir(a1, a2);
-
-        case SYS_RMDIR:
-            return sys_rmdir(a1);
-
-        case SYS_LINK:
-            return sys_link(a1, a2);
-
-        case SYS_SYMLINK:
-            return sys_symlink(a1, a2);
-
-        case SYS_READLINK:
-            return sys_readlink(a1, a2, a3);
-
-        case SYS_CHMOD:
-            return sys_chmod(a1, a2);
-
-        case SYS_FCHMOD:
-            return sys_fchmod(a1, a2);
-
-        case SYS_CHOWN:
-            return sys_chown(a1, a2, a3);
-        case SYS_OPENAT:
-            return sys_openat(a1, a2, a3, a4);
-        case SYS_FSTATAT:
-            return sys_fstatat(a1, a2, a3, a4);
-        case SYS_FACCESSAT:
-            return sys_faccessat(a1, a2, a3, a4);
-        case SYS_GETDENTS64:
-            return sys_getdents64(a1, a2, a3);
-        case SYS_GETDENTS:
-            return sys_getdents(a1, a2, a3);
-
-        case SYS_FCHOWN:
-            return sys_fchown(a1, a2, a3);
-
-        case SYS_UTIMENSAT:
-            return sys_utimensat(a1, a2, a3, a4);
-
-        case SYS_STATFS:
-            return sys_statfs(a1, a2);
-        case SYS_FSTATFS:
-            return sys_fstatfs(a1, a2);
-
-        // Signal syscalls
-        case SYS_RT_SIGACTION:
-            return sys_rt_sigaction(a1, a2, a3, a4);
-        case SYS_RT_SIGPROCMASK:
-            return sys_rt_sigprocmask(a1, a2, a3, a4);
-        case SYS_RT_SIGPENDING:
-            return sys_rt_sigpending(a1, a2);
-        case SYS_RT_SIGTIMEDWAIT:
-            return sys_rt_sigtimedwait(a1, a2, a3, a4);
-        case SYS_RT_SIGQUEUEINFO:
-            return sys_rt_sigqueueinfo(a1, a2, a3);
-        case SYS_RT_SIGSUSPEND:
-            return sys_rt_sigsuspend(a1, a2);
-        case SYS_RT_SIGRETURN:
-            return sys_rt_sigreturn();
-        case SYS_SIGALTSTACK:
-            return sys_sigaltstack(a1, a2);
-        case SYS_TKILL:
-            return sys_tkill(a1, a2);
-        case SYS_TGKILL:
-            return sys_tgkill(a1, a2, a3);
-        case SYS_ALARM:
-            return sys_alarm(a1);
-        case SYS_SETITIMER:
-            return sys_setitimer(a1, a2, a3);
-        case SYS_GETITIMER:
-            return sys_getitimer(a1, a2);
-        case SYS_TIMER_CREATE:
-            return sys_timer_create(a1, a2, a3);
-        case SYS_TIMER_SETTIME:
-            return sys_timer_settime(a1, a2, a3, a4);
-        case SYS_TIMER_GETTIME:
-            return sys_timer_gettime(a1, a2);
-        case SYS_TIMER_GETOVERRUN:
-            return sys_timer_getoverrun(a1);
-        case SYS_TIMER_DELETE:
-            return sys_timer_delete(a1);
-        case SYS_SIGNALFD:
-            return sys_signalfd(a1, a2, a3);
-        case SYS_PAUSE:
-            return sys_pause();
-        case SYS_NANOSLEEP:
-            return sys_nanosleep(a1, a2);
-        case SYS_CLOCK_GETTIME:
-            return sys_clock_gettime(a1, a2);
-        case SYS_CLOCK_GETRES:
-            return sys_clock_getres(a1, a2);
-            
-        // SMP/Threading syscalls
-        case SYS_CLONE:
-            return sys_clone(a1, a2, a3, a4, a5);
-        case SYS_VFORK:
-            return sys_vfork();
-        case SYS_EXIT_GROUP:
-            sys_exit_group(a1);
-            return 0;  // Never reached
-        case SYS_GETTID:
-            return sys_gettid();
-        case SYS_SET_TID_ADDRESS:
-            return sys_set_tid_address(a1);
-        case SYS_FUTEX:
-            return sys_futex(a1, a2, a3, a4, a5, 0);
-        case SYS_SET_ROBUST_LIST:
-            return sys_set_robust_list(a1, a2);
-        case SYS_GET_ROBUST_LIST:
-            return sys_get_robust_list(a1, a2, a3);
-        case SYS_ARCH_PRCTL:
-            return sys_arch_prctl(a1, a2);
-        case SYS_SCHED_SETAFFINITY:
-            return sys_sched_setaffinity(a1, a2, a3);
-        case SYS_SCHED_GETAFFINITY:
-            return sys_sched_getaffinity(a1, a2, a3);
-        case SYS_SCHED_SETSCHEDULER:
-            return sys_sched_setscheduler(a1, a2, a3);
-        case SYS_SCHED_GETSCHEDULER:
-            return sys_sched_getscheduler(a1);
-        case SYS_SCHED_SETPARAM:
-            return sys_sched_setparam(a1, a2);
-        case SYS_SCHED_GETPARAM:
-            return sys_sched_getparam(a1, a2);
-        case SYS_SCHED_GET_PRIORITY_MAX:
-            return sys_sched_get_priority_max(a1);
-        case SYS_SCHED_GET_PRIORITY_MIN:
-            return sys_sched_get_priority_min(a1);
-        case SYS_SCHED_RR_GET_INTERVAL:
-            return sys_sched_rr_get_interval(a1, a2);
-        case SYS_MPROTECT:
-            return sys_mprotect(a1, a2, a3);
-            
-        case SYS_REBOOT:
-            return sys_reboot(a1, a2, a3, a4);
-            
-        case SYS_GETPROCINFO:
-            return sys_getprocinfo(a1, a2);
-            
-        case SYS_MEMSTATS: {
-            if (!a1) return -EFAULT;
-            memory_stats_t stats;
-            mm_get_memory_stats(&stats);
-            if (copy_to_user((void*)a1, &stats, sizeof(stats)) != 0)
-                return -EFAULT;
-            return 0;
+static int64_t sc_accept(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        struct sockaddr_un kaddr;
+        socklen_t kaddrlen = sizeof(struct sockaddr_un);
+        int new_ufd = unix_accept(ufd, &kaddr, &kaddrlen);
+        if (new_ufd < 0) return new_ufd;
+        task_t* cur = sched_current();
+        if (!cur || accept_addr_out(a2, a3, &kaddr, sizeof(struct sockaddr_un), kaddrlen)) {
+            unix_close(new_ufd);
+            return -EFAULT;
         }
-
-        case SYS_SYSINFO:
-            return sys_sysinfo(a1);
-
-        case SYS_KLOGCTL:
-            return sys_klogctl(a1, a2, a3);
-
-        case SYS_SYNC:
-            return sys_sync();
-
-        // ====== Socket syscalls ======
-        case SYS_SOCKET: {
-            int real_type = (int)a2 & ~(SOCK_NONBLOCK | SOCK_CLOEXEC);
-            if ((int)a1 == AF_UNIX) {
-                int ufd = unix_create(real_type);
-                if (ufd < 0) return ufd;
-                task_t* cur = sched_current();
-                if (!cur) { unix_close(ufd); return -EFAULT; }
-                for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
-                    if (cur->fd_table[_fd] == NULL) {
-                        cur->fd_table[_fd] = (void*)(uintptr_t)ufd;
-                        if ((int)a2 & SOCK_NONBLOCK) {
-                            unix_socket_t* _s = unix_get(ufd);
-                            if (_s) _s->nonblock = 1;
-                        }
-                        return _fd;
-                    }
-                }
-                unix_close(ufd);
-                return -EMFILE;
-            }
-            int sock_idx = sock_create((int)a1, real_type, (int)a3);
-            if (sock_idx < 0) return sock_idx;
-            // Allocate a process fd pointing to the socket
-            task_t* cur = sched_current();
-            if (!cur) { sock_close(sock_idx); return -EFAULT; }
-            for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
-                if (cur->fd_table[_fd] == NULL) {
-                    cur->fd_table[_fd] = MAKE_SOCKET_FD(sock_idx);
-                    if ((int)a2 & SOCK_NONBLOCK) {
-                        net_socket_t* _s = sock_get(sock_idx);
-                        if (_s) _s->nonblock = 1;
-                    }
-                    return _fd;
-                }
+        for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
+            if (cur->fd_table[_fd] == NULL) {
+                cur->fd_table[_fd] = (void*)(uintptr_t)new_ufd;
+                return _fd;
             }
-            sock_close(sock_idx);
-            return -EMFILE;
         }
+        unix_close(new_ufd);
+        return -EMFILE;
+    }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    struct sockaddr_in kaddr;
+    socklen_t kaddrlen = sizeof(struct sockaddr_in);
+    int new_sock_idx = sock_accept(idx, &kaddr, &kaddrlen);
+    if (new_sock_idx < 0) return new_sock_idx;
+    // Allocate fd for the new accepted socket
+    task_t* cur = sched_current();
+    if (!cur || accept_addr_out(a2, a3, &kaddr, sizeof(struct sockaddr_in), kaddrlen)) {
+        sock_close(new_sock_idx);
+        return -EFAULT;
+    }
+    for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
+        if (cur->fd_table[_fd] == NULL) {
+            cur->fd_table[_fd] = MAKE_SOCKET_FD(new_sock_idx);
+            return _fd;
+        }
+    }
+    sock_close(new_sock_idx);
+    return -EMFILE;
+}
+
+static int64_t sc_connect(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        struct sockaddr_un kaddr;
+        if (copy_from_user(&kaddr, (const void*)a2, sizeof(struct sockaddr_un))) return -EFAULT;
+        return unix_connect(ufd, &kaddr);
+    }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    struct sockaddr_in kaddr;
+    if (copy_from_user(&kaddr, (const void*)a2, sizeof(struct sockaddr_in))) return -EFAULT;
+    return sock_connect(idx, &kaddr);
+}
+
+static int64_t sc_sendto(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        if (!validate_user_ptr(a2, a3)) return -EFAULT;
+        return unix_send(ufd, (const void*)a2, (size_t)a3, (int)a4);
+    }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    if (!validate_user_ptr(a2, a3)) return -EFAULT;
+    struct sockaddr_in kaddr;
+    const struct sockaddr_in* dest = NULL;
+    if (a5) {
+        if (copy_from_user(&kaddr, (const void*)a5, sizeof(struct sockaddr_in))) return -EFAULT;
+        dest = &kaddr;
+    }
+    return sock_sendto(idx, (const void*)a2, (size_t)a3, (int)a4, dest, dest ? sizeof(struct sockaddr_in) : 0);
+}
+
+static int64_t sc_recvfrom(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        if (!validate_user_ptr(a2, a3)) return -EFAULT;
+        return unix_recv(ufd, (void*)a2, (size_t)a3, (int)a4);
+    }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    if (!validate_user_ptr(a2, a3)) return -EFAULT;
+    struct sockaddr_in kaddr;
+    socklen_t kaddrlen = sizeof(struct sockaddr_in);
+    int ret = sock_recvfrom(idx, (void*)a2, (size_t)a3, (int)a4, &kaddr, &kaddrlen);
+    if (ret >= 0 && a5 && copy_to_user((void*)a5, &kaddr, sizeof(struct sockaddr_in)))
+        return -EFAULT;
+    return ret;
+}
 
-        case SYS_BIND: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                if (!validate_user_ptr(a2, sizeof(struct sockaddr_un))) return -EFAULT;
-                struct sockaddr_un kaddr;
-                copy_from_user(&kaddr, (const void*)a2, sizeof(struct sockaddr_un));
-                return unix_bind(ufd, &kaddr);
-            }
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            struct sockaddr_in kaddr;
-            if (!validate_user_ptr(a2, sizeof(struct sockaddr_in))) return -EFAULT;
-            copy_from_user(&kaddr, (const void*)a2, sizeof(struct sockaddr_in));
-            return sock_bind(idx, &kaddr);
-        }
-
-        case SYS_LISTEN: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) return unix_listen(ufd, (int)a2);
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            return sock_listen(idx, (int)a2);
-        }
-
-        case SYS_ACCEPT: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                struct sockaddr_un kaddr;
-                socklen_t kaddrlen = sizeof(struct sockaddr_un);
-                int new_ufd = unix_accept(ufd, &kaddr, &kaddrlen);
-                if (new_ufd < 0) return new_ufd;
-                task_t* cur = sched_current();
-                if (!cur) { unix_close(new_ufd); return -EFAULT; }
-                for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
-                    if (cur->fd_table[_fd] == NULL) {
-                        cur->fd_table[_fd] = (void*)(uintptr_t)new_ufd;
-                        if (a2 && a3) {
-                            if (validate_user_ptr(a2, sizeof(struct sockaddr_un)))
-                                copy_to_user((void*)a2, &kaddr, sizeof(struct sockaddr_un));
-                            if (validate_user_ptr(a3, sizeof(socklen_t)))
-                                copy_to_user((void*)a3, &kaddrlen, sizeof(socklen_t));
-                        }
-                        return _fd;
-                    }
-                }
-                unix_close(new_ufd);
-                return -EMFILE;
-            }
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            struct sockaddr_in kaddr;
-            socklen_t kaddrlen = sizeof(struct sockaddr_in);
-            int new_sock_idx = sock_accept(idx, &kaddr, &kaddrlen);
-            if (new_sock_idx < 0) return new_sock_idx;
-            // Allocate fd for the new accepted socket
-            task_t* cur = sched_current();
-            if (!cur) { sock_close(new_sock_idx); return -EFAULT; }
-            for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
-                if (cur->fd_table[_fd] == NULL) {
-                    cur->fd_table[_fd] = MAKE_SOCKET_FD(new_sock_idx);
-                    if (a2 && a3) {
-                        if (validate_user_ptr(a2, sizeof(struct sockaddr_in)))
-                            copy_to_user((void*)a2, &kaddr, sizeof(struct sockaddr_in));
-                        if (validate_user_ptr(a3, sizeof(socklen_t)))
-                            copy_to_user((void*)a3, &kaddrlen, sizeof(socklen_t));
-                    }
-                    return _fd;
-                }
-            }
-            sock_close(new_sock_idx);
-            return -EMFILE;
-        }
+static int64_t sc_send(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        if (!validate_user_ptr(a2, a3)) return -EFAULT;
+        return unix_send(ufd, (const void*)a2, (size_t)a3, (int)a4);
+    }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    if (!validate_user_ptr(a2, a3)) return -EFAULT;
+    return sock_send(idx, (const void*)a2, (size_t)a3, (int)a4);
+}
+
+static int64_t sc_recv(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        if (!validate_user_ptr(a2, a3)) return -EFAULT;
+        return unix_recv(ufd, (void*)a2, (size_t)a3, (int)a4);
+    }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    if (!validate_user_ptr(a2, a3)) return -EFAULT;
+    return sock_recv(idx, (void*)a2, (size_t)a3, (int)a4);
+}
+
+static int64_t sc_shutdown(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) return unix_shutdown(ufd, (int)a2);
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    return sock_shutdown(idx, (int)a2);
+}
+
+static int64_t sc_setsockopt(SYSCALL_ARGS) {
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    socklen_t koptlen = (socklen_t)a5;
+    uint8_t koptbuf[256] = {0};
+    if (koptlen > 0) {
+        size_t copy_len = koptlen;
+        if (!a4) return -EFAULT;
+        if (!validate_user_ptr(a4, copy_len)) return -EFAULT;
+        if (copy_len > sizeof(koptbuf)) copy_len = sizeof(koptbuf);
+        int copy_rc = copy_from_user(koptbuf, (const void*)a4, copy_len);
+        if (copy_rc < 0) return copy_rc;
+    }
+    return sock_setsockopt(idx, (int)a2, (int)a3,
+                           koptlen > 0 ? (const void*)koptbuf : NULL,
+                           koptlen);
+}
+
+static int64_t sc_getsockopt(SYSCALL_ARGS) {
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    socklen_t koptlen = 0;
+    uint8_t koptbuf[256] = {0};
+    if (a5 && copy_from_user(&koptlen, (const void*)a5, sizeof(socklen_t))) return -EFAULT;
+    if (koptlen > 0) {
+        if (!a4) return -EFAULT;
+        if (!validate_user_ptr(a4, koptlen)) return -EFAULT;
+        if (koptlen > sizeof(koptbuf)) koptlen = sizeof(koptbuf);
+    }
+    int ret = sock_getsockopt(idx, (int)a2, (int)a3,
+                              koptlen > 0 ? (void*)koptbuf : NULL,
+                              &koptlen);
+    if (ret == 0 && a4 && koptlen > 0 && copy_to_user((void*)a4, koptbuf, koptlen))
+        return -EFAULT;
+    if (ret == 0 && a5 && copy_to_user((void*)a5, &koptlen, sizeof(socklen_t)))
+        return -EFAULT;
+    return ret;
+}
 
-        case SYS_CONNECT: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                if (!validate_user_ptr(a2, sizeof(struct sockaddr_un))) return -EFAULT;
-                struct sockaddr_un kaddr;
-                copy_from_user(&kaddr, (const void*)a2, sizeof(struct sockaddr_un));
-                return unix_connect(ufd, &kaddr);
-            }
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            struct sockaddr_in kaddr;
-            if (!validate_user_ptr(a2, sizeof(struct sockaddr_in))) return -EFAULT;
-            copy_from_user(&kaddr, (const void*)a2, sizeof(struct sockaddr_in));
-            return sock_connect(idx, &kaddr);
-        }
-
-        case SYS_SENDTO: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                if (!validate_user_ptr(a2, a3)) return -EFAULT;
-                return unix_send(ufd, (const void*)a2, (size_t)a3, (int)a4);
-            }
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            if (!validate_user_ptr(a2, a3)) return -EFAULT;
-            struct sockaddr_in kaddr;
-            const struct sockaddr_in* dest = NULL;
-            if (a5 && validate_user_ptr(a5, sizeof(struct sockaddr_in))) {
-                copy_from_user(&kaddr, (const void*)a5, sizeof(struct sockaddr_in));
-                dest = &kaddr;
-            }
-            return sock_sendto(idx, (const void*)a2, (size_t)a3, (int)a4, dest, dest ? sizeof(struct sockaddr_in) : 0);
-        }
+static int64_t sc_getpeername(SYSCALL_ARGS) {
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    struct sockaddr_in kaddr;
+    socklen_t kaddrlen = sizeof(struct sockaddr_in);
+    int ret = sock_getpeername(idx, &kaddr, &kaddrlen);
+    if (ret == 0 && a2 && copy_to_user((void*)a2, &kaddr, sizeof(struct sockaddr_in)))
+        return -EFAULT;
+    if (ret == 0 && a3 && copy_to_user((void*)a3, &kaddrlen, sizeof(socklen_t)))
+        return -EFAULT;
+    return ret;
+}
 
-        case SYS_RECVFROM: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                if (!validate_user_ptr(a2, a3)) return -EFAULT;
-                return unix_recv(ufd, (void*)a2, (size_t)a3, (int)a4);
-            }
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            if (!validate_user_ptr(a2, a3)) return -EFAULT;
-            struct sockaddr_in kaddr;
-            socklen_t kaddrlen = sizeof(struct sockaddr_in);
-            int ret = sock_recvfrom(idx, (void*)a2, (size_t)a3, (int)a4, &kaddr, &kaddrlen);
-            if (ret >= 0 && a5 && validate_user_ptr(a5, sizeof(struct sockaddr_in)))
-                copy_to_user((void*)a5, &kaddr, sizeof(struct sockaddr_in));
-            return ret;
-        }
+static int64_t sc_getsockname(SYSCALL_ARGS) {
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    struct sockaddr_in kaddr;
+    socklen_t kaddrlen = sizeof(struct sockaddr_in);
+    int ret = sock_getsockname(idx, &kaddr, &kaddrlen);
+    if (ret == 0 && a2 && copy_to_user((void*)a2, &kaddr, sizeof(struct sockaddr_in)))
+        return -EFAULT;
+    if (ret == 0 && a3 && copy_to_user((void*)a3, &kaddrlen, sizeof(socklen_t)))
+        return -EFAULT;
+    return ret;
+}
 
-        case SYS_SEND: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                if (!validate_user_ptr(a2, a3)) return -EFAULT;
-                return unix_send(ufd, (const void*)a2, (size_t)a3, (int)a4);
+static int64_t sc_socketpair(SYSCALL_ARGS) {
+    if (!validate_user_ptr(a4, 2 * sizeof(int))) return -EFAULT;
+    if ((int)a1 == AF_UNIX) {
+        int real_type = (int)a2 & ~(SOCK_NONBLOCK | SOCK_CLOEXEC);
+        int usv[2];
+        int ret = unix_socketpair(real_type, usv);
+        if (ret < 0) return ret;
+        task_t* cur = sched_current();
+        if (!cur) { unix_close(usv[0]); unix_close(usv[1]); return -EFAULT; }
+        int pfd[2] = {-1, -1};
+        for (int _fd = 3; _fd < TASK_MAX_FDS && (pfd[0] < 0 || pfd[1] < 0); _fd++) {
+            if (cur->fd_table[_fd] == NULL) {
+                if (pfd[0] < 0) pfd[0] = _fd;
+                else pfd[1] = _fd;
             }
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            if (!validate_user_ptr(a2, a3)) return -EFAULT;
-            return sock_send(idx, (const void*)a2, (size_t)a3, (int)a4);
         }
-
-        case SYS_RECV: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                if (!validate_user_ptr(a2, a3)) return -EFAULT;
-                return unix_recv(ufd, (void*)a2, (size_t)a3, (int)a4);
-            }
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            if (!validate_user_ptr(a2, a3)) return -EFAULT;
-            return sock_recv(idx, (void*)a2, (size_t)a3, (int)a4);
-        }
-
-        case SYS_SHUTDOWN: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) return unix_shutdown(ufd, (int)a2);
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            return sock_shutdown(idx, (int)a2);
-        }
-
-        case SYS_SETSOCKOPT: {
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            socklen_t koptlen = (socklen_t)a5;
-            uint8_t koptbuf[256] = {0};
-            if (koptlen > 0) {
-                size_t copy_len = koptlen;
-                if (!a4) return -EFAULT;
-                if (!validate_user_ptr(a4, copy_len)) return -EFAULT;
-                if (copy_len > sizeof(koptbuf)) copy_len = sizeof(koptbuf);
-                int copy_rc = copy_from_user(koptbuf, (const void*)a4, copy_len);
-                if (copy_rc < 0) return copy_rc;
-            }
-            return sock_setsockopt(idx, (int)a2, (int)a3,
-                                   koptlen > 0 ? (const void*)koptbuf : NULL,
-                                   koptlen);
-        }
-
-        case SYS_GETSOCKOPT: {
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            socklen_t koptlen = 0;
-            uint8_t koptbuf[256] = {0};
-            if (a5 && validate_user_ptr(a5, sizeof(socklen_t)))
-                copy_from_user(&koptlen, (const void*)a5, sizeof(socklen_t));
-            if (koptlen > 0) {
-                if (!a4) return -EFAULT;
-                if (!validate_user_ptr(a4, koptlen)) return -EFAULT;
-                if (koptlen > sizeof(koptbuf)) koptlen = sizeof(koptbuf);
-            }
-            int ret = sock_getsockopt(idx, (int)a2, (int)a3,
-                                      koptlen > 0 ? (void*)koptbuf : NULL,
-                                      &koptlen);
-            if (ret == 0 && a4 && koptlen > 0)
-                copy_to_user((void*)a4, koptbuf, koptlen);
-            if (ret == 0 && a5 && validate_user_ptr(a5, sizeof(socklen_t)))
-                copy_to_user((void*)a5, &koptlen, sizeof(socklen_t));
-            return ret;
+        if (pfd[0] < 0 || pfd[1] < 0) {
+            unix_close(usv[0]); unix_close(usv[1]);
+            return -EMFILE;
         }
-
-        case SYS_GETPEERNAME: {
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            struct sockaddr_in kaddr;
-            socklen_t kaddrlen = sizeof(struct sockaddr_in);
-            int ret = sock_getpeername(idx, &kaddr, &kaddrlen);
-            if (ret == 0 && a2 && validate_user_ptr(a2, sizeof(struct sockaddr_in)))
-                copy_to_user((void*)a2, &kaddr, sizeof(struct sockaddr_in));
-            if (ret == 0 && a3 && validate_user_ptr(a3, sizeof(socklen_t)))
-                copy_to_user((void*)a3, &kaddrlen, sizeof(socklen_t));
-            return ret;
+        if (copy_to_user((void*)a4, pfd, 2 * sizeof(int))) {
+            unix_close(usv[0]); unix_close(usv[1]);
+            return -EFAULT;
         }
-
-        case SYS_GETSOCKNAME: {
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            struct sockaddr_in kaddr;
-            socklen_t kaddrlen = sizeof(struct sockaddr_in);
-            int ret = sock_getsockname(idx, &kaddr, &kaddrlen);
-            if (ret == 0 && a2 && validate_user_ptr(a2, sizeof(struct sockaddr_in)))
-                copy_to_user((void*)a2, &kaddr, sizeof(struct sockaddr_in));
-            if (ret == 0 && a3 && validate_user_ptr(a3, sizeof(socklen_t)))
-                copy_to_user((void*)a3, &kaddrlen, sizeof(socklen_t));
-            return ret;
+        cur->fd_table[pfd[0]] = (void*)(uintptr_t)usv[0];
+        cur->fd_table[pfd[1]] = (void*)(uintptr_t)usv[1];
+        return 0;
+    }
+    int sv[2];
+    int ret = sock_socketpair((int)a1, (int)a2, (int)a3, sv);
+    if (ret < 0) return ret;
+    // Allocate two process fds
+    task_t* cur = sched_current();
+    if (!cur) { sock_close(sv[0]); sock_close(sv[1]); return -EFAULT; }
+    int ufd[2] = {-1, -1};
+    for (int _fd = 3; _fd < TASK_MAX_FDS && (ufd[0] < 0 || ufd[1] < 0); _fd++) {
+        if (cur->fd_table[_fd] == NULL) {
+            if (ufd[0] < 0) ufd[0] = _fd;
+            else ufd[1] = _fd;
         }
+    }
+    if (ufd[0] < 0 || ufd[1] < 0) {
+        sock_close(sv[0]); sock_close(sv[1]);
+        return -EMFILE;
+    }
+    if (copy_to_user((void*)a4, ufd, 2 * sizeof(int))) {
+        sock_close(sv[0]); sock_close(sv[1]);
+        return -EFAULT;
+    }
+    cur->fd_table[ufd[0]] = MAKE_SOCKET_FD(sv[0]);
+    cur->fd_table[ufd[1]] = MAKE_SOCKET_FD(sv[1]);
+    return 0;
+}
 
-        case SYS_SOCKETPAIR: {
-            if (!validate_user_ptr(a4, 2 * sizeof(int))) return -EFAULT;
-            if ((int)a1 == AF_UNIX) {
-                int real_type = (int)a2 & ~(SOCK_NONBLOCK | SOCK_CLOEXEC);
-                int usv[2];
-                int ret = unix_socketpair(real_type, usv);
-                if (ret < 0) return ret;
-                task_t* cur = sched_current();
-                if (!cur) { unix_close(usv[0]); unix_close(usv[1]); return -EFAULT; }
-                int pfd[2] = {-1, -1};
-                for (int _fd = 3; _fd < TASK_MAX_FDS && (pfd[0] < 0 || pfd[1] < 0); _fd++) {
-                    if (cur->fd_table[_fd] == NULL) {
-                        if (pfd[0] < 0) pfd[0] = _fd;
-                        else pfd[1] = _fd;
-                    }
-                }
-                if (pfd[0] < 0 || pfd[1] < 0) {
-                    unix_close(usv[0]); unix_close(usv[1]);
-                    return -EMFILE;
-                }
-                cur->fd_table[pfd[0]] = (void*)(uintptr_t)usv[0];
-                cur->fd_table[pfd[1]] = (void*)(uintptr_t)usv[1];
-                copy_to_user((void*)a4, pfd, 2 * sizeof(int));
-                return 0;
-            }
-            int sv[2];
-            int ret = sock_socketpair((int)a1, (int)a2, (int)a3, sv);
-            if (ret < 0) return ret;
-            // Allocate two process fds
-            task_t* cur = sched_current();
-            if (!cur) { sock_close(sv[0]); sock_close(sv[1]); return -EFAULT; }
-            int ufd[2] = {-1, -1};
-            for (int _fd = 3; _fd < TASK_MAX_FDS && (ufd[0] < 0 || ufd[1] < 0); _fd++) {
-                if (cur->fd_table[_fd] == NULL) {
-                    if (ufd[0] < 0) ufd[0] = _fd;
-                    else ufd[1] = _fd;
-                }
-            }
-            if (ufd[0] < 0 || ufd[1] < 0) {
-                sock_close(sv[0]); sock_close(sv[1]);
-                return -EMFILE;
-            }
-            cur->fd_table[ufd[0]] = MAKE_SOCKET_FD(sv[0]);
-            cur->fd_table[ufd[1]] = MAKE_SOCKET_FD(sv[1]);
-            copy_to_user((void*)a4, ufd, 2 * sizeof(int));
-            return 0;
+static int64_t sc_accept4(SYSCALL_ARGS) {
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        struct sockaddr_un kaddr;
+        socklen_t kaddrlen = sizeof(struct sockaddr_un);
+        int new_ufd = unix_accept(ufd, &kaddr, &kaddrlen);
+        if (new_ufd < 0) return new_ufd;
+        task_t* cur = sched_current();
+        if (!cur || accept_addr_out(a2, a3, &kaddr, sizeof(struct sockaddr_un), kaddrlen)) {
+            unix_close(new_ufd);
+            return -EFAULT;
         }
-
-        case SYS_ACCEPT4: {
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                struct sockaddr_un kaddr;
-                socklen_t kaddrlen = sizeof(struct sockaddr_un);
-                int new_ufd = unix_accept(ufd, &kaddr, &kaddrlen);
-                if (new_ufd < 0) return new_ufd;
-                task_t* cur = sched_current();
-                if (!cur) { unix_close(new_ufd); return -EFAULT; }
-                for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
-                    if (cur->fd_table[_fd] == NULL) {
-                        cur->fd_table[_fd] = (void*)(uintptr_t)new_ufd;
-                        if ((int)a4 & SOCK_NONBLOCK) {
-                            unix_socket_t* _s = unix_get(new_ufd);
-                            if (_s) _s->nonblock = 1;
-                        }
-                        if (a2 && a3) {
-                            if (validate_user_ptr(a2, sizeof(struct sockaddr_un)))
-                                copy_to_user((void*)a2, &kaddr, sizeof(struct sockaddr_un));
-                            if (validate_user_ptr(a3, sizeof(socklen_t)))
-                                copy_to_user((void*)a3, &kaddrlen, sizeof(socklen_t));
-                        }
-                        return _fd;
-                    }
-                }
-                unix_close(new_ufd);
-                return -EMFILE;
-            }
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            struct sockaddr_in kaddr;
-            socklen_t kaddrlen = sizeof(struct sockaddr_in);
-            int new_sock_idx = sock_accept4(idx, &kaddr, &kaddrlen, (int)a4);
-            if (new_sock_idx < 0) return new_sock_idx;
-            task_t* cur = sched_current();
-            if (!cur) { sock_close(new_sock_idx); return -EFAULT; }
-            for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
-                if (cur->fd_table[_fd] == NULL) {
-                    cur->fd_table[_fd] = MAKE_SOCKET_FD(new_sock_idx);
-                    if (a2 && a3) {
-                        if (validate_user_ptr(a2, sizeof(struct sockaddr_in)))
-                            copy_to_user((void*)a2, &kaddr, sizeof(struct sockaddr_in));
-                        if (validate_user_ptr(a3, sizeof(socklen_t)))
-                            copy_to_user((void*)a3, &kaddrlen, sizeof(socklen_t));
-                    }
-                    return _fd;
+        for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
+            if (cur->fd_table[_fd] == NULL) {
+                cur->fd_table[_fd] = (void*)(uintptr_t)new_ufd;
+                if ((int)a4 & SOCK_NONBLOCK) {
+                    unix_socket_t* _s = unix_get(new_ufd);
+                    if (_s) _s->nonblock = 1;
                 }
+                return _fd;
             }
-            sock_close(new_sock_idx);
-            return -EMFILE;
         }
+        unix_close(new_ufd);
+        return -EMFILE;
+    }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    struct sockaddr_in kaddr;
+    socklen_t kaddrlen = sizeof(struct sockaddr_in);
+    int new_sock_idx = sock_accept4(idx, &kaddr, &kaddrlen, (int)a4);
+    if (new_sock_idx < 0) return new_sock_idx;
+    task_t* cur = sched_current();
+    if (!cur || accept_addr_out(a2, a3, &kaddr, sizeof(struct sockaddr_in), kaddrlen)) {
+        sock_close(new_sock_idx);
+        return -EFAULT;
+    }
+    for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
+        if (cur->fd_table[_fd] == NULL) {
+            cur->fd_table[_fd] = MAKE_SOCKET_FD(new_sock_idx);
+            return _fd;
+        }
+    }
+    sock_close(new_sock_idx);
+    return -EMFILE;
+}
 
-        case SYS_SENDMSG: {
-            if (!validate_user_ptr(a2, sizeof(struct msghdr))) return -EFAULT;
-            struct msghdr kmsg;
-            copy_from_user(&kmsg, (const void*)a2, sizeof(struct msghdr));
+static int64_t sc_sendmsg(SYSCALL_ARGS) {
+    struct msghdr kmsg;
+    if (copy_from_user(&kmsg, (const void*)a2, sizeof(struct msghdr))) return -EFAULT;
 
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0)
-                return unix_do_sendmsg(ufd, &kmsg);
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0)
+        return unix_do_sendmsg(ufd, &kmsg);
 
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            return sock_sendmsg(idx, &kmsg, (int)a3);
-        }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    return sock_sendmsg(idx, &kmsg, (int)a3);
+}
 
-        case SYS_RECVMSG: {
-            if (!validate_user_ptr(a2, sizeof(struct msghdr))) return -EFAULT;
-            struct msghdr kmsg;
-            copy_from_user(&kmsg, (const void*)a2, sizeof(struct msghdr));
+static int64_t sc_recvmsg(SYSCALL_ARGS) {
+    struct msghdr kmsg;
+    if (copy_from_user(&kmsg, (const void*)a2, sizeof(struct msghdr))) return -EFAULT;
 
-            int ufd = unix_sock_fd_from_fd(a1);
-            if (ufd >= 0) {
-                int ret = unix_do_recvmsg(ufd, &kmsg);
-                if (ret >= 0)
-                    copy_to_user((void*)a2, &kmsg, sizeof(struct msghdr));
-                return ret;
-            }
+    int ufd = unix_sock_fd_from_fd(a1);
+    if (ufd >= 0) {
+        int ret = unix_do_recvmsg(ufd, &kmsg);
+        if (ret >= 0 && copy_to_user((void*)a2, &kmsg, sizeof(struct msghdr)))
+            return -EFAULT;
+        return ret;
+    }
 
-            int idx = sock_idx_from_fd(a1);
-            if (idx < 0) return idx;
-            int ret = sock_recvmsg(idx, &kmsg, (int)a3);
-            if (ret >= 0)
-                copy_to_user((void*)a2, &kmsg, sizeof(struct msghdr));
-            return ret;
-        }
+    int idx = sock_idx_from_fd(a1);
+    if (idx < 0) return idx;
+    int ret = sock_recvmsg(idx, &kmsg, (int)a3);
+    if (ret >= 0 && copy_to_user((void*)a2, &kmsg, sizeof(struct msghdr)))
+        return -EFAULT;
+    return ret;
+}
 
-        case SYS_SENDFILE: {
-            int64_t koffset = 0;
-            int64_t* koffp = NULL;
-            if (a3) {
-                if (!validate_user_ptr(a3, sizeof(int64_t))) return -EFAULT;
-                copy_from_user(&koffset, (void*)a3, sizeof(int64_t));
-                koffp = &koffset;
-            }
-            int ret = sock_sendfile((int)a1, (int)a2, koffp, (size_t)a4);
-            if (a3 && ret >= 0) {
-                copy_to_user((void*)a3, &koffset, sizeof(int64_t));
-            }
-            return ret;
-        }
+static int64_t sc_sendfile(SYSCALL_ARGS) {
+    int64_t koffset = 0;
+    int64_t* koffp = NULL;
+    if (a3) {
+        if (copy_from_user(&koffset, (void*)a3, sizeof(int64_t))) return -EFAULT;
+        koffp = &koffset;
+    }
+    int ret = sock_sendfile((int)a1, (int)a2, koffp, (size_t)a4);
+    if (a3 && ret >= 0 && copy_to_user((void*)a3, &koffset, sizeof(int64_t)))
+        return -EFAULT;
+    return ret;
+}
 
-        case SYS_SELECT:
-            return sys_select_wrapper(a1, a2, a3, a4, a5);
+static int64_t sc_select(SYSCALL_ARGS) { return sys_select_wrapper(a1, a2, a3, a4, a5); }
+static int64_t sc_pselect6(SYSCALL_ARGS) { return sys_pselect6_wrapper(a1, a2, a3, a4, a5); }
+static int64_t sc_poll(SYSCALL_ARGS) { return sys_poll_wrapper(a1, a2, a3); }
+static int64_t sc_ppoll(SYSCALL_ARGS) { return sys_ppoll_wrapper(a1, a2, a3); }
 
-        case SYS_PSELECT6:
-            return sys_pselect6_wrapper(a1, a2, a3, a4, a5);
+// Install a new epoll instance in the lowest free fd
+static int64_t epoll_install(int flags) {
+    task_t* cur = sched_current();
+    if (!cur) return -EFAULT;
 
-        case SYS_POLL:
-            return sys_poll_wrapper(a1, a2, a3);
+    int fd = alloc_fd(cur);
+    if (fd < 0) return fd;
+    vfs_file_t* file = NULL;
+    int ret = epoll_create_internal(flags, &file);
+    if (ret < 0) return ret;
+    cur->fd_table[fd] = file;
+    return fd;
+}
 
-        case SYS_PPOLL:
-            return sys_ppoll_wrapper(a1, a2, a3);
+static int64_t sc_epoll_create(SYSCALL_ARGS) {
+    if ((int)a1 <= 0) return -EINVAL;  // size is a hint, but must be positive
+    return epoll_install(0);
+}
 
-        case SYS_EPOLL_CREATE: {
-            int ep_idx = epoll_create_internal(0);
-            if (ep_idx < 0) return ep_idx;
-            task_t* cur = sched_current();
-            if (!cur) return -EFAULT;
-            for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
-                if (cur->fd_table[_fd] == NULL) {
-                    cur->fd_table[_fd] = MAKE_EPOLL_FD(ep_idx);
-                    return _fd;
-                }
-            }
-            return -EMFILE;
-        }
+static int64_t sc_epoll_create1(SYSCALL_ARGS) { return epoll_install((int)a1); }
 
-        case SYS_EPOLL_CREATE1: {
-            int ep_idx = epoll_create_internal((int)a1);
-            if (ep_idx < 0) return ep_idx;
-            task_t* cur = sched_current();
-            if (!cur) return -EFAULT;
-            for (int _fd = 3; _fd < TASK_MAX_FDS; _fd++) {
-                if (cur->fd_table[_fd] == NULL) {
-                    cur->fd_table[_fd] = MAKE_EPOLL_FD(ep_idx);
-                    return _fd;
-                }
-            }
-            return -EMFILE;
-        }
+static int64_t sc_epoll_ctl(SYSCALL_ARGS) {
+    struct epoll_event kev;
+    if ((int)a2 != EPOLL_CTL_DEL) {
+        if (!a4 || !validate_user_ptr(a4, sizeof(struct epoll_event)) ||
+            copy_from_user(&kev, (void*)a4, sizeof(struct epoll_event)) != 0)
+            return -EFAULT;
+    }
+    int err;
+    vfs_file_t* epf = epoll_get(a1, &err);
+    if (!epf) return err;
+    int ret = epoll_ctl_internal(epf, (int)a2, (int)a3, (int)a2 != EPOLL_CTL_DEL ? &kev : NULL);
+    vfs_close(epf);
+    return ret;
+}
 
-        case SYS_EPOLL_CTL: {
-            int ep_idx = epoll_idx_from_fd(a1);
-            if (ep_idx < 0) return ep_idx;
-            struct epoll_event kev;
-            if (a4 && validate_user_ptr(a4, sizeof(struct epoll_event)))
-                copy_from_user(&kev, (void*)a4, sizeof(struct epoll_event));
-            return epoll_ctl_internal(ep_idx, (int)a2, (int)a3, a4 ? &kev : NULL);
-        }
-
-        case SYS_EPOLL_WAIT:
-            return sys_epoll_wait_wrapper(a1, a2, a3, a4);
-
-        case SYS_EPOLL_PWAIT:
-            return sys_epoll_wait_wrapper(a1, a2, a3, a4);
-
-        case SYS_DUP3:
-            return sys_dup3(a1, a2, a3);
-
-        case SYS_DNS_RESOLVE: {
-            if (!validate_user_ptr(a1, 1)) return -EFAULT;
-            if (!validate_user_ptr(a2, sizeof(uint32_t))) return -EFAULT;
-            // Copy hostname from user space (max 255 chars).
-            // Copy page-by-page to avoid faulting across page boundaries.
-            char khost[256];
-            size_t off = 0;
-            khost[0] = '\0';
-            smap_disable();
-            while (off < 255) {
-                uintptr_t addr = a1 + off;
-                // Check that the page containing this byte is mapped
-                if (!mm_is_page_mapped(addr)) break;
-                // Copy up to end of this page (or remaining buffer)
-                size_t page_end = (addr | 0xFFF) + 1;
-                size_t chunk = page_end - addr;
-                if (off + chunk > 255) chunk = 255 - off;
-                for (size_t j = 0; j < chunk; j++) {
-                    khost[off] = ((const char*)a1)[off];
-                    if (khost[off] == '\0') goto dns_str_done;
-                    off++;
-                }
-            }
-            dns_str_done:
-            smap_enable();
-            khost[off] = '\0';
-            if (off == 0) return -EFAULT;
-            uint32_t ip = 0;
-            int ret = dns_resolve(khost, &ip);
-            if (ret == 0) {
-                copy_to_user((void*)a2, &ip, sizeof(uint32_t));
-            }
-            return ret;
-        }
+static int64_t sc_epoll_wait(SYSCALL_ARGS) { return sys_epoll_wait_wrapper(a1, a2, a3, a4); }
+static int64_t sc_epoll_pwait(SYSCALL_ARGS) { return sys_epoll_wait_wrapper(a1, a2, a3, a4); }
+static int64_t sc_dup3(SYSCALL_ARGS) { return sys_dup3(a1, a2, a3); }
+
+static int64_t sc_dns_resolve(SYSCALL_ARGS) {
+    if (!validate_user_ptr(a1, 1)) return -EFAULT;
+    if (!validate_user_ptr(a2, sizeof(uint32_t))) return -EFAULT;
+    // Copy hostname from user space (max 255 chars, longer is truncated)
+    char khost[256];
+    long len = strncpy_from_user(khost, (const char*)a1, sizeof(khost) - 1);
+    if (len <= 0) return -EFAULT;
+    khost[len] = '\0';
+    uint32_t ip = 0;
+    int ret = dns_resolve(khost, &ip);
+    if (ret == 0 && copy_to_user((void*)a2, &ip, sizeof(uint32_t)))
+        return -EFAULT;
+    return ret;
+}
 
-        case SYS_SETHOSTNAME: {
-            if (!validate_user_ptr(a1, 1)) return -EFAULT;
-            size_t len = (size_t)a2;
-            if (len == 0 || len > 63) return -EINVAL;
-            char khost[64];
-            if (copy_from_user(khost, (const void*)a1, len) < 0) return -EFAULT;
-            khost[len] = '\0';
-            net_set_hostname(khost);
-            return 0;
-        }
+static int64_t sc_sethostname(SYSCALL_ARGS) {
+    if (!validate_user_ptr(a1, 1)) return -EFAULT;
+    size_t len = (size_t)a2;
+    if (len == 0 || len > 63) return -EINVAL;
+    char khost[64];
+    if (copy_from_user(khost, (const void*)a1, len) < 0) return -EFAULT;
+    khost[len] = '\0';
+    net_set_hostname(khost);
+    return 0;
+}
 
-        case SYS_NET_GETINFO: {
-            int subcmd = (int)a1;
-            if (!validate_user_ptr(a2, 1)) return -EFAULT;
-            int max_entries = (int)a3;
-            if (max_entries <= 0) return -EINVAL;
-
-            switch (subcmd) {
-            case NET_GET_ARP_TABLE: {
-                size_t sz = (size_t)max_entries * sizeof(net_arp_info_t);
-                if (!validate_user_ptr(a2, sz)) return -EFAULT;
-                net_arp_info_t kbuf[64];
-                int n = max_entries > 64 ? 64 : max_entries;
-                int count = net_get_arp_table(kbuf, n);
-                copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_arp_info_t));
-                return count;
-            }
-            case NET_GET_ROUTE_TABLE: {
-                size_t sz = (size_t)max_entries * sizeof(net_route_info_t);
-                if (!validate_user_ptr(a2, sz)) return -EFAULT;
-                net_route_info_t kbuf[32];
-                int n = max_entries > 32 ? 32 : max_entries;
-                int count = net_get_route_table(kbuf, n);
-                copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_route_info_t));
-                return count;
-            }
-            case NET_GET_TCP_CONNECTIONS: {
-                size_t sz = (size_t)max_entries * sizeof(net_tcp_info_t);
-                if (!validate_user_ptr(a2, sz)) return -EFAULT;
-                net_tcp_info_t kbuf[64];
-                int n = max_entries > 64 ? 64 : max_entries;
-                int count = net_get_tcp_connections(kbuf, n);
-                copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_tcp_info_t));
-                return count;
-            }
-            case NET_GET_UDP_SOCKETS: {
-                size_t sz = (size_t)max_entries * sizeof(net_udp_info_t);
-                if (!validate_user_ptr(a2, sz)) return -EFAULT;
-                net_udp_info_t kbuf[64];
-                int n = max_entries > 64 ? 64 : max_entries;
-                int count = net_get_udp_sockets(kbuf, n);
-                copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_udp_info_t));
-                return count;
-            }
-            case NET_GET_IFACE_STATS: {
-                size_t sz = (size_t)max_entries * sizeof(net_iface_info_t);
-                if (!validate_user_ptr(a2, sz)) return -EFAULT;
-                net_iface_info_t kbuf[8];
-                int n = max_entries > 8 ? 8 : max_entries;
-                int count = net_get_iface_info(kbuf, n);
-                copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_iface_info_t));
-                return count;
-            }
-            case NET_DNS_QUERY: {
-                if (!validate_user_ptr(a2, sizeof(dns_query_buf_t))) return -EFAULT;
-                dns_query_buf_t kbuf;
-                copy_from_user(&kbuf, (void*)a2, sizeof(dns_query_buf_t));
-                kbuf.name[255] = '\0';
-                int rlen = dns_query_raw(kbuf.name, kbuf.qtype,
-                                         kbuf.response, 512);
-                kbuf.response_len = rlen;
-                copy_to_user((void*)a2, &kbuf, sizeof(dns_query_buf_t));
-                return rlen > 0 ? 0 : rlen;
-            }
-            default:
-                return -EINVAL;
-            }
-        }
+static int64_t sc_net_getinfo(SYSCALL_ARGS) {
+    int subcmd = (int)a1;
+    if (!validate_user_ptr(a2, 1)) return -EFAULT;
+    int max_entries = (int)a3;
+    if (max_entries <= 0) return -EINVAL;
+
+    switch (subcmd) {
+    case NET_GET_ARP_TABLE: {
+        size_t sz = (size_t)max_entries * sizeof(net_arp_info_t);
+        if (!validate_user_ptr(a2, sz)) return -EFAULT;
+        net_arp_info_t kbuf[64];
+        int n = max_entries > 64 ? 64 : max_entries;
+        int count = net_get_arp_table(kbuf, n);
+        if (copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_arp_info_t)))
+            return -EFAULT;
+        return count;
+    }
+    case NET_GET_ROUTE_TABLE: {
+        size_t sz = (size_t)max_entries * sizeof(net_route_info_t);
+        if (!validate_user_ptr(a2, sz)) return -EFAULT;
+        net_route_info_t kbuf[32];
+        int n = max_entries > 32 ? 32 : max_entries;
+        int count = net_get_route_table(kbuf, n);
+        if (copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_route_info_t)))
+            return -EFAULT;
+        return count;
+    }
+    case NET_GET_TCP_CONNECTIONS: {
+        size_t sz = (size_t)max_entries * sizeof(net_tcp_info_t);
+        if (!validate_user_ptr(a2, sz)) return -EFAULT;
+        net_tcp_info_t kbuf[64];
+        int n = max_entries > 64 ? 64 : max_entries;
+        int count = net_get_tcp_connections(kbuf, n);
+        if (copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_tcp_info_t)))
+            return -EFAULT;
+        return count;
+    }
+    case NET_GET_UDP_SOCKETS: {
+        size_t sz = (size_t)max_entries * sizeof(net_udp_info_t);
+        if (!validate_user_ptr(a2, sz)) return -EFAULT;
+        net_udp_info_t kbuf[64];
+        int n = max_entries > 64 ? 64 : max_entries;
+        int count = net_get_udp_sockets(kbuf, n);
+        if (copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_udp_info_t)))
+            return -EFAULT;
+        return count;
+    }
+    case NET_GET_IFACE_STATS: {
+        size_t sz = (size_t)max_entries * sizeof(net_iface_info_t);
+        if (!validate_user_ptr(a2, sz)) return -EFAULT;
+        net_iface_info_t kbuf[8];
+        int n = max_entries > 8 ? 8 : max_entries;
+        int count = net_get_iface_info(kbuf, n);
+        if (copy_to_user((void*)a2, kbuf, (size_t)count * sizeof(net_iface_info_t)))
+            return -EFAULT;
+        return count;
+    }
+    case NET_DNS_QUERY: {
+        dns_query_buf_t kbuf;
+        if (copy_from_user(&kbuf, (void*)a2, sizeof(dns_query_buf_t))) return -EFAULT;
+        kbuf.name[255] = '\0';
+        int rlen = dns_query_raw(kbuf.name, kbuf.qtype,
+                                 kbuf.response, 512);
+        kbuf.response_len = rlen;
+        if (copy_to_user((void*)a2, &kbuf, sizeof(dns_query_buf_t))) return -EFAULT;
+        return rlen > 0 ? 0 : rlen;
+    }
+    default:
+        return -EINVAL;
+    }
+}
 
-        case SYS_DHCP_CONTROL: {
-            int subcmd = (int)a1;
-            net_device_t* dev = net_get_default_device();
-            if (!dev) return -ENETDOWN;
-            switch (subcmd) {
-            case DHCP_CMD_DISCOVER:
-                return dhcp_discover(dev);
-            case DHCP_CMD_RELEASE:
-                return dhcp_release(dev);
-            case DHCP_CMD_RENEW:
-                return dhcp_renew(dev);
-            case DHCP_CMD_STATUS:
-                return dhcp_get_status();
-            default:
-                return -EINVAL;
-            }
-        }
+static int64_t sc_dhcp_control(SYSCALL_ARGS) {
+    int subcmd = (int)a1;
+    net_device_t* dev = net_get_default_device();
+    if (!dev) return -ENETDOWN;
+    switch (subcmd) {
+    case DHCP_CMD_DISCOVER:
+        return dhcp_discover(dev);
+    case DHCP_CMD_RELEASE:
+        return dhcp_release(dev);
+    case DHCP_CMD_RENEW:
+        return dhcp_renew(dev);
+    case DHCP_CMD_STATUS:
+        return dhcp_get_status();
+    default:
+        return -EINVAL;
+    }
+}
 
-        case SYS_RAW_SEND: {
-            // a1 = subcmd (1=ICMP echo, 2=ARP request)
-            // a2 = dst_ip, a3 = id/seq packed, a4 = ttl, a5 = data_ptr (optional)
-            int subcmd = (int)a1;
-            net_device_t* dev = net_get_default_device();
-            if (!dev) return -ENETDOWN;
-            if (subcmd == 1) {
-                // ICMP echo: a2=dst_ip, a3=id<<16|seq, a4=ttl
-                uint32_t dst_ip = (uint32_t)a2;
-                uint16_t id = (uint16_t)(a3 >> 16);
-                uint16_t seq = (uint16_t)(a3 & 0xFFFF);
-                uint8_t ttl = (uint8_t)a4;
-                if (ttl == 0) ttl = 64;
-                // 56 bytes of padding data
-                uint8_t pad[56];
-                for (int pi = 0; pi < 56; pi++) pad[pi] = (uint8_t)pi;
-                int send_ret = icmp_send_echo(dev, dst_ip, id, seq, pad, 56, ttl);
-                loopback_process_pending();
-                return send_ret;
-            } else if (subcmd == 2) {
-                // ARP request: a2=target_ip
-                uint32_t target_ip = (uint32_t)a2;
-                return arp_send_request(dev, target_ip);
-            }
-            return -EINVAL;
-        }
+static int64_t sc_raw_send(SYSCALL_ARGS) {
+    // a1 = subcmd (1=ICMP echo, 2=ARP request)
+    // a2 = dst_ip, a3 = id/seq packed, a4 = ttl, a5 = data_ptr (optional)
+    int subcmd = (int)a1;
+    net_device_t* dev = net_get_default_device();
+    if (!dev) return -ENETDOWN;
+    if (subcmd == 1) {
+        // ICMP echo: a2=dst_ip, a3=id<<16|seq, a4=ttl
+        uint32_t dst_ip = (uint32_t)a2;
+        uint16_t id = (uint16_t)(a3 >> 16);
+        uint16_t seq = (uint16_t)(a3 & 0xFFFF);
+        uint8_t ttl = (uint8_t)a4;
+        if (ttl == 0) ttl = 64;
+        // 56 bytes of padding data
+        uint8_t pad[56];
+        for (int pi = 0; pi < 56; pi++) pad[pi] = (uint8_t)pi;
+        int send_ret = icmp_send_echo(dev, dst_ip, id, seq, pad, 56, ttl);
+        loopback_process_pending();
+        return send_ret;
+    } else if (subcmd == 2) {
+        // ARP request: a2=target_ip
+        uint32_t target_ip = (uint32_t)a2;
+        return arp_send_request(dev, target_ip);
+    }
+    return -EINVAL;
+}
 
-        case SYS_RAW_RECV: {
-            // a1 = subcmd (1=ICMP reply, 2=ARP reply)
-            // a2 = ptr to result struct, a3 = expected_id or target_ip, a4 = timeout_ticks
-            int subcmd = (int)a1;
-            if (subcmd == 1) {
-                // ICMP reply
-                if (!validate_user_ptr(a2, 24)) return -EFAULT;
-                uint32_t src_ip = 0;
-                uint8_t type = 0, code = 0, recv_ttl = 0;
-                uint16_t seq = 0;
-                uint16_t expected_id = (uint16_t)(a3 >> 16);
-                uint16_t expected_seq = (uint16_t)(a3 & 0xFFFF);
-                uint64_t timeout = a4 ? a4 : 500; // default 5s at 100Hz
-                uint64_t rtt_us = 0;
-                int ret = icmp_recv_reply(&src_ip, expected_id, &type, &code, &seq, timeout, &rtt_us, expected_seq, &recv_ttl);
-                if (ret == 0) {
-                    // Pack result: [src_ip(4), type(1), code(1), seq(2), rtt_us(8), ttl(1), pad(7)]
-                    uint8_t result[24];
-                    for (int i = 0; i < 24; i++) result[i] = 0;
-                    result[0] = (src_ip >> 24) & 0xFF;
-                    result[1] = (src_ip >> 16) & 0xFF;
-                    result[2] = (src_ip >> 8) & 0xFF;
-                    result[3] = src_ip & 0xFF;
-                    result[4] = type;
-                    result[5] = code;
-                    result[6] = (seq >> 8) & 0xFF;
-                    result[7] = seq & 0xFF;
-                    // Pack RTT in microseconds (little-endian uint64_t)
-                    for (int i = 0; i < 8; i++)
-                        result[8 + i] = (rtt_us >> (i * 8)) & 0xFF;
-                    result[16] = recv_ttl;
-                    copy_to_user((void*)a2, result, 24);
-                }
-                return ret;
-            } else if (subcmd == 2) {
-                // ARP reply
-                if (!validate_user_ptr(a2, 6)) return -EFAULT;
-                uint32_t target_ip = (uint32_t)a3;
-                uint64_t timeout = a4 ? a4 : 500;
-                uint8_t mac[6];
-                int ret = arp_recv_reply(target_ip, mac, timeout);
-                if (ret == 0) {
-                    copy_to_user((void*)a2, mac, 6);
-                }
-                return ret;
-            }
-            return -EINVAL;
+static int64_t sc_raw_recv(SYSCALL_ARGS) {
+    // a1 = subcmd (1=ICMP reply, 2=ARP reply)
+    // a2 = ptr to result struct, a3 = expected_id or target_ip, a4 = timeout_ticks
+    int subcmd = (int)a1;
+    if (subcmd == 1) {
+        // ICMP reply
+        if (!validate_user_ptr(a2, 24)) return -EFAULT;
+        uint32_t src_ip = 0;
+        uint8_t type = 0, code = 0, recv_ttl = 0;
+        uint16_t seq = 0;
+        uint16_t expected_id = (uint16_t)(a3 >> 16);
+        uint16_t expected_seq = (uint16_t)(a3 & 0xFFFF);
+        uint64_t timeout = a4 ? a4 : 500; // default 5s at 100Hz
+        uint64_t rtt_us = 0;
+        int ret = icmp_recv_reply(&src_ip, expected_id, &type, &code, &seq, timeout, &rtt_us, expected_seq, &recv_ttl);
+        if (ret == 0) {
+            // Pack result: [src_ip(4), type(1), code(1), seq(2), rtt_us(8), ttl(1), pad(7)]
+            uint8_t result[24];
+            for (int i = 0; i < 24; i++) result[i] = 0;
+            result[0] = (src_ip >> 24) & 0xFF;
+            result[1] = (src_ip >> 16) & 0xFF;
+            result[2] = (src_ip >> 8) & 0xFF;
+            result[3] = src_ip & 0xFF;
+            result[4] = type;
+            result[5] = code;
+            result[6] = (seq >> 8) & 0xFF;
+            result[7] = seq & 0xFF;
+            // Pack RTT in microseconds (little-endian uint64_t)
+            for (int i = 0; i < 8; i++)
+                result[8 + i] = (rtt_us >> (i * 8)) & 0xFF;
+            result[16] = recv_ttl;
+            if (copy_to_user((void*)a2, result, 24)) return -EFAULT;
         }
+        return ret;
+    } else if (subcmd == 2) {
+        // ARP reply
+        if (!validate_user_ptr(a2, 6)) return -EFAULT;
+        uint32_t target_ip = (uint32_t)a3;
+        uint64_t timeout = a4 ? a4 : 500;
+        uint8_t mac[6];
+        int ret = arp_recv_reply(target_ip, mac, timeout);
+        if (ret == 0 && copy_to_user((void*)a2, mac, 6)) return -EFAULT;
+        return ret;
+    }
+    return -EINVAL;
+}
 
-        case SYS_DNS_RESOLVE_REVERSE: {
-            // a1 = IP address in network byte order
-            // a2 = pointer to output hostname buffer (user)
-            // a3 = max length of output buffer
-            uint32_t ip_nbo = (uint32_t)a1;
-            int maxlen = (int)a3;
-            if (maxlen <= 0 || maxlen > 256) return -EINVAL;
-            if (!validate_user_ptr(a2, (size_t)maxlen)) return -EFAULT;
-
-            char kbuf[256];
-            int ret = dns_resolve_reverse(ip_nbo, kbuf, sizeof(kbuf));
-            if (ret == 0) {
-                // Copy result to user space
-                size_t slen = 0;
-                while (kbuf[slen]) slen++;
-                if ((int)(slen + 1) > maxlen) return -ENAMETOOLONG;
-                copy_to_user((void*)a2, kbuf, slen + 1);
-            }
-            return ret;
-        }
+static int64_t sc_dns_resolve_reverse(SYSCALL_ARGS) {
+    // a1 = IP address in network byte order
+    // a2 = pointer to output hostname buffer (user)
+    // a3 = max length of output buffer
+    uint32_t ip_nbo = (uint32_t)a1;
+    int maxlen = (int)a3;
+    if (maxlen <= 0 || maxlen > 256) return -EINVAL;
+    if (!validate_user_ptr(a2, (size_t)maxlen)) return -EFAULT;
+
+    char kbuf[256];
+    int ret = dns_resolve_reverse(ip_nbo, kbuf, sizeof(kbuf));
+    if (ret == 0) {
+        // Copy result to user space
+        size_t slen = 0;
+        while (kbuf[slen]) slen++;
+        if ((int)(slen + 1) > maxlen) return -ENAMETOOLONG;
+        if (copy_to_user((void*)a2, kbuf, slen + 1)) return -EFAULT;
+    }
+    return ret;
+}
 
-        case SYS_SET_DNS_SERVER: {
-            // a1 = ifname (user, NUL-terminated, may be NULL/empty for "all")
-            // a2 = IPv4 address in network byte order (0 to clear)
-            // RFC 3493: install resolver server.  Used by the userland
-            // /etc/resolv.conf parser at boot before DHCP completes, and
-            // by `dhclient` for manual overrides.
-            uint32_t ip_nbo = (uint32_t)a2;
-            char ifname[16] = {0};
-            int have_name = 0;
-            if (a1) {
-                if (!validate_user_ptr(a1, 1)) return -EFAULT;
-                copy_from_user(ifname, (void*)a1, sizeof(ifname) - 1);
-                ifname[sizeof(ifname) - 1] = 0;
-                if (ifname[0]) have_name = 1;
-            }
-            int updated = 0;
-            for (int i = 0; i < 16; i++) {
-                net_device_t* d = net_get_device(i);
-                if (!d) continue;
-                if (have_name) {
-                    int match = 1;
-                    for (int k = 0; k < 16; k++) {
-                        if (d->name[k] != ifname[k]) { match = 0; break; }
-                        if (!ifname[k]) break;
-                    }
-                    if (!match) continue;
-                }
-                d->dns_server = ip_nbo;
-                updated++;
-            }
-            // Loopback too, so test_libc on loopback still has a resolver.
-            net_device_t* lo = net_get_loopback();
-            if (lo && (!have_name ||
-                       (ifname[0] == 'l' && ifname[1] == 'o' && ifname[2] == 0))) {
-                lo->dns_server = ip_nbo;
-                updated++;
+static int64_t sc_set_dns_server(SYSCALL_ARGS) {
+    // a1 = ifname (user, NUL-terminated, may be NULL/empty for "all")
+    // a2 = IPv4 address in network byte order (0 to clear)
+    // RFC 3493: install resolver server.  Used by the userland
+    // /etc/resolv.conf parser at boot before DHCP completes, and
+    // by `dhclient` for manual overrides.
+    uint32_t ip_nbo = (uint32_t)a2;
+    char ifname[16] = {0};
+    int have_name = 0;
+    if (a1) {
+        if (strncpy_from_user(ifname, (const char*)a1, sizeof(ifname) - 1) < 0)
+            return -EFAULT;
+        ifname[sizeof(ifname) - 1] = 0;
+        if (ifname[0]) have_name = 1;
+    }
+    int updated = 0;
+    for (int i = 0; i < 16; i++) {
+        net_device_t* d = net_get_device(i);
+        if (!d) continue;
+        if (have_name) {
+            int match = 1;
+            for (int k = 0; k < 16; k++) {
+                if (d->name[k] != ifname[k]) { match = 0; break; }
+                if (!ifname[k]) break;
             }
-            return updated > 0 ? 0 : -ENODEV;
-        }
-
-        case SYS_SETSID:    return sys_setsid();
-        case SYS_GETSID:    return sys_getsid(a1);
-        case SYS_GETPGID:   return sys_getpgid(a1);
-        case SYS_GETRUSAGE: return sys_getrusage(a1, a2);
-        case SYS_READV:     return sys_readv(a1, a2, a3);
-        case SYS_WRITEV:    return sys_writev(a1, a2, a3);
+            if (!match) continue;
+        }
+        d->dns_server = ip_nbo;
+        updated++;
+    }
+    // Loopback too, so test_libc on loopback still has a resolver.
+    net_device_t* lo = net_get_loopback();
+    if (lo && (!have_name ||
+               (ifname[0] == 'l' && ifname[1] == 'o' && ifname[2] == 0))) {
+        lo->dns_server = ip_nbo;
+        updated++;
+    }
+    return updated > 0 ? 0 : -ENODEV;
+}
+
+static int64_t sc_setsid(SYSCALL_ARGS) { return sys_setsid(); }
+static int64_t sc_getsid(SYSCALL_ARGS) { return sys_getsid(a1); }
+static int64_t sc_getpgid(SYSCALL_ARGS) { return sys_getpgid(a1); }
+static int64_t sc_getrusage(SYSCALL_ARGS) { return sys_getrusage(a1, a2); }
+static int64_t sc_times(SYSCALL_ARGS) { return sys_times(a1); }
+static int64_t sc_rseq(SYSCALL_ARGS) { return sys_rseq(a1, a2, a3, a4); }
+static int64_t sc_getcpu(SYSCALL_ARGS) { return sys_getcpu(a1, a2); }
+static int64_t sc_readv(SYSCALL_ARGS) { return sys_readv(a1, a2, a3); }
+static int64_t sc_writev(SYSCALL_ARGS) { return sys_writev(a1, a2, a3); }
+static int64_t sc_syscallstat(SYSCALL_ARGS) { return sys_syscallstat(a1, a2, a3); }
+static int64_t sc_io_uring_setup(SYSCALL_ARGS) { return sys_io_uring_setup(a1, a2); }
+static int64_t sc_io_uring_enter(SYSCALL_ARGS) { return sys_io_uring_enter(a1, a2, a3, a4, a5); }
+static int64_t sc_splice(SYSCALL_ARGS) { return sys_splice(a1, a2, a3, a4, a5, a6); }
+static int64_t sc_tee(SYSCALL_ARGS) { return sys_tee(a1, a2, a3, a4); }
+static int64_t sc_vmsplice(SYSCALL_ARGS) { return sys_vmsplice(a1, a2, a3, a4); }
+static int64_t sc_eventfd2(SYSCALL_ARGS) { return sys_eventfd2(a1, a2); }
+static int64_t sc_timerfd_create(SYSCALL_ARGS) { return sys_timerfd_create(a1, a2); }
+static int64_t sc_timerfd_settime(SYSCALL_ARGS) { return sys_timerfd_settime(a1, a2, a3, a4); }
+static int64_t sc_timerfd_gettime(SYSCALL_ARGS) { return sys_timerfd_gettime(a1, a2); }
+static int64_t sc_pread64(SYSCALL_ARGS) { return do_prw(a1, a2, a3, (int64_t)a4, false); }
+static int64_t sc_pwrite64(SYSCALL_ARGS) { return do_prw(a1, a2, a3, (int64_t)a4, true); }
+static int64_t sc_preadv(SYSCALL_ARGS) { return do_prwv(a1, a2, a3, (int64_t)a4, 0, false, false); }
+static int64_t sc_pwritev(SYSCALL_ARGS) { return do_prwv(a1, a2, a3, (int64_t)a4, 0, true, false); }
+static int64_t sc_preadv2(SYSCALL_ARGS) { return do_prwv(a1, a2, a3, (int64_t)a4, a5, false, true); }
+static int64_t sc_pwritev2(SYSCALL_ARGS) { return do_prwv(a1, a2, a3, (int64_t)a4, a5, true, true); }
+static int64_t sc_memfd_create(SYSCALL_ARGS) { return sys_memfd_create(a1, a2); }
+
+static const syscall_fn_t g_syscall_table[NR_SYSCALLS] = {
+    [SYS_READ]                  = sc_read,
+    [SYS_WRITE]                 = sc_write,
+    [SYS_OPEN]                  = sc_open,
+    [SYS_CLOSE]                 = sc_close,
+    [SYS_LSEEK]                 = sc_lseek,
+    [SYS_MMAP]                  = sc_mmap,
+    [SYS_MUNMAP]                = sc_munmap,
+    [SYS_BRK]                   = sc_brk,
+    [SYS_GETPID]                = sc_getpid,
+    [SYS_FORK]                  = sc_fork,
+    [SYS_WAIT4]                 = sc_wait4,
+    [SYS_GETPPID]               = sc_getppid,
+    [SYS_EXECVE]                = sc_execve,
+    [SYS_DUP]                   = sc_dup,
+    [SYS_DUP2]                  = sc_dup2,
+    [SYS_EXIT]                  = sc_exit,
+    [SYS_PIPE]                  = sc_pipe,
+    [SYS_YIELD]                 = sc_yield,
+    [SYS_STAT]                  = sc_stat,
+    [SYS_LSTAT]                 = sc_lstat,
+    [SYS_FSTAT]                 = sc_fstat,
+    [SYS_ACCESS]                = sc_access,
+    [SYS_CHDIR]                 = sc_chdir,
+    [SYS_GETCWD]                = sc_getcwd,
+    [SYS_UMASK]                 = sc_umask,
+    [SYS_GETUID]                = sc_getuid,
+    [SYS_GETGID]                = sc_getgid,
+    [SYS_GETEUID]               = sc_geteuid,
+    [SYS_GETEGID]               = sc_getegid,
+    [SYS_SETUID]                = sc_setuid,
+    [SYS_SETGID]                = sc_setgid,
+    [SYS_SETEUID]               = sc_seteuid,
+    [SYS_SETEGID]               = sc_setegid,
+    [SYS_GETGROUPS]             = sc_getgroups,
+    [SYS_SETGROUPS]             = sc_setgroups,
+    [SYS_GETHOSTNAME]           = sc_gethostname,
+    [SYS_UNAME]                 = sc_uname,
+    [SYS_TIME]                  = sc_time,
+    [SYS_GETTIMEOFDAY]          = sc_gettimeofday,
+    [SYS_SETTIMEOFDAY]          = sc_settimeofday,
+    [SYS_FSYNC]                 = sc_fsync,
+    [SYS_FTRUNCATE]             = sc_ftruncate,
+    [SYS_FCNTL]                 = sc_fcntl,
+    [SYS_IOCTL]                 = sc_ioctl,
+    [SYS_SETPGID]               = sc_setpgid,
+    [SYS_GETPGRP]               = sc_getpgrp,
+    [SYS_TCGETPGRP]             = sc_tcgetpgrp,
+    [SYS_TCSETPGRP]             = sc_tcsetpgrp,
+    [SYS_KILL]                  = sc_kill,
+    [SYS_UNLINK]                = sc_unlink,
+    [SYS_RENAME]                = sc_rename,
+    [SYS_MKDIR]                 = sc_mkdir,
+    [SYS_RMDIR]                 = sc_rmdir,
+    [SYS_LINK]                  = sc_link,
+    [SYS_SYMLINK]               = sc_symlink,
+    [SYS_READLINK]              = sc_readlink,
+    [SYS_CHMOD]                 = sc_chmod,
+    [SYS_FCHMOD]                = sc_fchmod,
+    [SYS_CHOWN]                 = sc_chown,
+    [SYS_OPENAT]                = sc_openat,
+    [SYS_FSTATAT]               = sc_fstatat,
+    [SYS_FACCESSAT]             = sc_faccessat,
+    [SYS_GETDENTS64]            = sc_getdents64,
+    [SYS_GETDENTS]              = sc_getdents,
+    [SYS_FCHOWN]                = sc_fchown,
+    [SYS_UTIMENSAT]             = sc_utimensat,
+    [SYS_STATFS]                = sc_statfs,
+    [SYS_FSTATFS]               = sc_fstatfs,
+
+    // Signal syscalls
+    [SYS_RT_SIGACTION]          = sc_rt_sigaction,
+    [SYS_RT_SIGPROCMASK]        = sc_rt_sigprocmask,
+    [SYS_RT_SIGPENDING]         = sc_rt_sigpending,
+    [SYS_RT_SIGTIMEDWAIT]       = sc_rt_sigtimedwait,
+    [SYS_RT_SIGQUEUEINFO]       = sc_rt_sigqueueinfo,
+    [SYS_RT_SIGSUSPEND]         = sc_rt_sigsuspend,
+    [SYS_RT_SIGRETURN]          = sc_rt_sigreturn,
+    [SYS_SIGALTSTACK]           = sc_sigaltstack,
+    [SYS_TKILL]                 = sc_tkill,
+    [SYS_TGKILL]                = sc_tgkill,
+    [SYS_ALARM]                 = sc_alarm,
+    [SYS_SETITIMER]             = sc_setitimer,
+    [SYS_GETITIMER]             = sc_getitimer,
+    [SYS_TIMER_CREATE]          = sc_timer_create,
+    [SYS_TIMER_SETTIME]         = sc_timer_settime,
+    [SYS_TIMER_GETTIME]         = sc_timer_gettime,
+    [SYS_TIMER_GETOVERRUN]      = sc_timer_getoverrun,
+    [SYS_TIMER_DELETE]          = sc_timer_delete,
+    [SYS_SIGNALFD]              = sc_signalfd,
+    [SYS_PAUSE]                 = sc_pause,
+    [SYS_NANOSLEEP]             = sc_nanosleep,
+    [SYS_CLOCK_GETTIME]         = sc_clock_gettime,
+    [SYS_CLOCK_GETRES]          = sc_clock_getres,
+
+    // SMP/Threading syscalls
+    [SYS_CLONE]                 = sc_clone,
+    [SYS_VFORK]                 = sc_vfork,
+    [SYS_EXIT_GROUP]            = sc_exit_group,
+    [SYS_GETTID]                = sc_gettid,
+    [SYS_SET_TID_ADDRESS]       = sc_set_tid_address,
+    [SYS_FUTEX]                 = sc_futex,
+    [SYS_SET_ROBUST_LIST]       = sc_set_robust_list,
+    [SYS_GET_ROBUST_LIST]       = sc_get_robust_list,
+    [SYS_ARCH_PRCTL]            = sc_arch_prctl,
+    [SYS_SCHED_SETAFFINITY]     = sc_sched_setaffinity,
+    [SYS_SCHED_GETAFFINITY]     = sc_sched_getaffinity,
+    [SYS_SCHED_SETSCHEDULER]    = sc_sched_setscheduler,
+    [SYS_SCHED_GETSCHEDULER]    = sc_sched_getscheduler,
+    [SYS_SCHED_SETPARAM]        = sc_sched_setparam,
+    [SYS_SCHED_GETPARAM]        = sc_sched_getparam,
+    [SYS_SCHED_GET_PRIORITY_MAX] = sc_sched_get_priority_max,
+    [SYS_SCHED_GET_PRIORITY_MIN] = sc_sched_get_priority_min,
+    [SYS_SCHED_RR_GET_INTERVAL] = sc_sched_rr_get_interval,
+    [SYS_GETPRIORITY]           = sc_getpriority,
+    [SYS_SETPRIORITY]           = sc_setpriority,
+    [SYS_SCHEDCTL]              = sc_schedctl,
+    [SYS_LOCKSTAT]              = sc_lockstat,
+    [SYS_MPROTECT]              = sc_mprotect,
+    [SYS_REBOOT]                = sc_reboot,
+    [SYS_GETPROCINFO]           = sc_getprocinfo,
+    [SYS_MEMSTATS]              = sc_memstats,
+    [SYS_SYSINFO]               = sc_sysinfo,
+    [SYS_KLOGCTL]               = sc_klogctl,
+    [SYS_SYNC]                  = sc_sync,
+
+    // Socket syscalls
+    [SYS_SOCKET]                = sc_socket,
+    [SYS_BIND]                  = sc_bind,
+    [SYS_LISTEN]                = sc_listen,
+    [SYS_ACCEPT]                = sc_accept,
+    [SYS_CONNECT]               = sc_connect,
+    [SYS_SENDTO]                = sc_sendto,
+    [SYS_RECVFROM]              = sc_recvfrom,
+    [SYS_SEND]                  = sc_send,
+    [SYS_RECV]                  = sc_recv,
+    [SYS_SHUTDOWN]              = sc_shutdown,
+    [SYS_SETSOCKOPT]            = sc_setsockopt,
+    [SYS_GETSOCKOPT]            = sc_getsockopt,
+    [SYS_GETPEERNAME]           = sc_getpeername,
+    [SYS_GETSOCKNAME]           = sc_getsockname,
+    [SYS_SOCKETPAIR]            = sc_socketpair,
+    [SYS_ACCEPT4]               = sc_accept4,
+    [SYS_SENDMSG]               = sc_sendmsg,
+    [SYS_RECVMSG]               = sc_recvmsg,
+    [SYS_SENDFILE]              = sc_sendfile,
+    [SYS_SELECT]                = sc_select,
+    [SYS_PSELECT6]              = sc_pselect6,
+    [SYS_POLL]                  = sc_poll,
+    [SYS_PPOLL]                 = sc_ppoll,
+    [SYS_EPOLL_CREATE]          = sc_epoll_create,
+    [SYS_EPOLL_CREATE1]         = sc_epoll_create1,
+    [SYS_EPOLL_CTL]             = sc_epoll_ctl,
+    [SYS_EPOLL_WAIT]            = sc_epoll_wait,
+    [SYS_EPOLL_PWAIT]           = sc_epoll_pwait,
+    [SYS_DUP3]                  = sc_dup3,
+    [SYS_DNS_RESOLVE]           = sc_dns_resolve,
+    [SYS_SETHOSTNAME]           = sc_sethostname,
+    [SYS_NET_GETINFO]           = sc_net_getinfo,
+    [SYS_DHCP_CONTROL]          = sc_dhcp_control,
+    [SYS_RAW_SEND]              = sc_raw_send,
+    [SYS_RAW_RECV]              = sc_raw_recv,
+    [SYS_DNS_RESOLVE_REVERSE]   = sc_dns_resolve_reverse,
+    [SYS_SET_DNS_SERVER]        = sc_set_dns_server,
+    [SYS_SETSID]                = sc_setsid,
+    [SYS_GETSID]                = sc_getsid,
+    [SYS_GETPGID]               = sc_getpgid,
+    [SYS_GETRUSAGE]             = sc_getrusage,
+    [SYS_TIMES]                 = sc_times,
+    [SYS_RSEQ]                  = sc_rseq,
+    [SYS_GETCPU]                = sc_getcpu,
+    [SYS_READV]                 = sc_readv,
+    [SYS_WRITEV]                = sc_writev,
+    [SYS_SYSCALLSTAT]           = sc_syscallstat,
+    [SYS_IO_URING_SETUP]        = sc_io_uring_setup,
+    [SYS_IO_URING_ENTER]        = sc_io_uring_enter,
+    [SYS_SPLICE]                = sc_splice,
+    [SYS_TEE]                   = sc_tee,
+    [SYS_VMSPLICE]              = sc_vmsplice,
+    [SYS_EVENTFD2]              = sc_eventfd2,
+    [SYS_TIMERFD_CREATE]        = sc_timerfd_create,
+    [SYS_TIMERFD_SETTIME]       = sc_timerfd_settime,
+    [SYS_TIMERFD_GETTIME]       = sc_timerfd_gettime,
+    [SYS_PREAD64]               = sc_pread64,
+    [SYS_PWRITE64]              = sc_pwrite64,
+    [SYS_PREADV]                = sc_preadv,
+    [SYS_PWRITEV]               = sc_pwritev,
+    [SYS_PREADV2]               = sc_preadv2,
+    [SYS_PWRITEV2]              = sc_pwritev2,
+    [SYS_MEMFD_CREATE]          = sc_memfd_create,
+};
 
-        default:
-            return -ENOSYS;
+int64_t syscall_dispatch(uint64_t num, uint64_t a1, uint64_t a2, uint64_t a3,
+                         uint64_t a4, uint64_t a5, uint64_t a6) {
+    if (num >= NR_SYSCALLS || !g_syscall_table[num]) {
+        return -ENOSYS;
     }
+    return g_syscall_table[num](a1, a2, a3, a4, a5, a6);
 }
 
 // Wrapper that handles signal delivery after syscall
-int64_t syscall_handler(uint64_t num, uint64_t a1, uint64_t a2, 
-                        uint64_t a3, uint64_t a4, uint64_t a5) {
+int64_t syscall_handler(uint64_t num, uint64_t a1, uint64_t a2,
+                        uint64_t a3, uint64_t a4, uint64_t a5, uint64_t a6) {
     // CRITICAL: Interrupts are DISABLED when we enter (syscall_entry no longer does sti)
     // This prevents a race where:
     // 1. Task A enters syscall, writes to per-CPU storage
@@ -5915,11 +6448,25 @@ int64_t syscall_handler(uint64_t num, uint64_t a1, uint64_t a2,
         cur->syscall_r15 = cpu->syscall_saved_user_r15;
     }
 
+    // User time ends here; the syscall runs on the task's system time
+    cputime_switch(CPUTIME_SYS);
+
     // NOW enable interrupts - per-CPU values are safely copied to task struct
     __asm__ volatile("sti" ::: "memory");
     
-    int64_t ret = syscall_handler_inner(num, a1, a2, a3, a4, a5);
-    
+    uint64_t stat_start = syscallstat_active() ? timer_rdtsc() : 0;
+    int64_t ret = syscall_dispatch(num, a1, a2, a3, a4, a5, a6);
+    if (stat_start) {
+        syscallstat_record(num, ret, stat_start);
+    }
+
+    // Honour wakeup preemption before returning to userspace.  Must run
+    // before signal delivery: signal_deliver/sigreturn stage the return
+    // context in per-CPU storage, which a context switch would clobber.
+    if (num != SYS_EXIT && num != SYS_RT_SIGRETURN) {
+        sched_cond_resched();
+    }
+
     // Check for pending signals before returning to userspace
     // Skip this for exit (task may be gone) and sigreturn (just restored context)
     if (num != SYS_EXIT && num != SYS_RT_SIGRETURN) {
@@ -5935,6 +6482,11 @@ int64_t syscall_handler(uint64_t num, uint64_t a1, uint64_t a2,
             }
         }
     }
-    
+
+    // Interrupts stay off from here to sysret, so the task cannot move to
+    // another CPU after its rseq cpu_id has been refreshed
+    __asm__ volatile("cli" ::: "memory");
+    rseq_notify_resume(sched_current(), NULL);
+    cputime_switch(CPUTIME_USER);
     return ret;
 }
@@ -0,0 +1,123 @@
+// LikeOS-64 - Syscall Statistics
+//
+// Each CPU gets its own array of counters, one slot per syscall number,
+// allocated the first time accounting is enabled and kept afterwards.
+// syscallstat_record() runs with interrupts off on the CPU the syscall
+// returns on, so the counters need no atomics.  Readers sum the arrays
+// without stopping the writers; a read or reset racing with a syscall can
+// be off by that one call.
+
+#include "../../include/kernel/syscallstat.h"
+#include "../../include/kernel/percpu.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/syscall.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/spinlock.h"
+#include "../../include/kernel/timer.h"
+
+typedef struct syscall_cpustat {
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t time_total;
+    uint64_t time_max;
+    uint32_t hist[SYSCALLSTAT_BUCKETS];
+} syscall_cpustat_t;
+
+volatile int g_syscallstat_on;
+static volatile int g_syscallstat_pid;      // Traced tgid, 0 = every process
+static syscall_cpustat_t* g_syscallstat_cpu[MAX_CPUS];
+static spinlock_t g_syscallstat_lock = SPINLOCK_INIT("syscallstat");
+
+static inline int syscallstat_bucket(uint64_t cycles) {
+    cycles >>= 6;
+    if (!cycles) return 0;
+    int b = 64 - __builtin_clzll(cycles);
+    return b < SYSCALLSTAT_BUCKETS ? b : SYSCALLSTAT_BUCKETS - 1;
+}
+
+void syscallstat_record(uint64_t num, int64_t ret, uint64_t start) {
+    if (num >= NR_SYSCALLS) return;
+    int pid = g_syscallstat_pid;
+    if (pid) {
+        task_t* cur = sched_current();
+        if (!cur || (int)cur->tgid != pid) return;
+    }
+
+    uint64_t now = timer_rdtsc();
+    uint64_t cycles = now > start ? now - start : 0;
+
+    uint64_t flags = local_irq_save();
+    syscall_cpustat_t* s = g_syscallstat_cpu[this_cpu()->cpu_id];
+    if (s) {
+        s += num;
+        s->calls++;
+        if (ret < 0 && ret >= -4095) s->errors++;
+        s->time_total += cycles;
+        if (cycles > s->time_max) s->time_max = cycles;
+        s->hist[syscallstat_bucket(cycles)]++;
+    }
+    local_irq_restore(flags);
+}
+
+int syscallstat_reset(void) {
+    for (uint32_t c = 0; c < MAX_CPUS; c++) {
+        syscall_cpustat_t* s = g_syscallstat_cpu[c];
+        if (s) mm_memset(s, 0, NR_SYSCALLS * sizeof(syscall_cpustat_t));
+    }
+    return 0;
+}
+
+int syscallstat_enable(int pid) {
+    if (pid < 0) return -EINVAL;
+
+    // Allocate outside the lock; a CPU that loses the install race frees
+    // its copy
+    for (uint32_t c = 0; c < MAX_CPUS; c++) {
+        if (!percpu_get(c) || g_syscallstat_cpu[c]) continue;
+        syscall_cpustat_t* s = kalloc(NR_SYSCALLS * sizeof(syscall_cpustat_t));
+        if (!s) return -ENOMEM;
+        mm_memset(s, 0, NR_SYSCALLS * sizeof(syscall_cpustat_t));
+        syscall_cpustat_t* expected = NULL;
+        if (!__atomic_compare_exchange_n(&g_syscallstat_cpu[c], &expected, s, 0,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            kfree(s);
+        }
+    }
+
+    uint64_t flags;
+    spin_lock_irqsave(&g_syscallstat_lock, &flags);
+    g_syscallstat_on = 0;
+    syscallstat_reset();
+    g_syscallstat_pid = pid;
+    __atomic_store_n(&g_syscallstat_on, 1, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&g_syscallstat_lock, flags);
+    return 0;
+}
+
+int syscallstat_disable(void) {
+    uint64_t flags;
+    spin_lock_irqsave(&g_syscallstat_lock, &flags);
+    g_syscallstat_on = 0;
+    spin_unlock_irqrestore(&g_syscallstat_lock, flags);
+    return 0;
+}
+
+int syscallstat_get(uint32_t nr, k_syscallstat_entry_t* out) {
+    if (nr >= NR_SYSCALLS) return -EINVAL;
+
+    mm_memset(out, 0, sizeof(*out));
+    out->nr = nr;
+    for (uint32_t c = 0; c < MAX_CPUS; c++) {
+        syscall_cpustat_t* s = g_syscallstat_cpu[c];
+        if (!s) continue;
+        s += nr;
+        out->calls += s->calls;
+        out->errors += s->errors;
+        out->time_total += s->time_total;
+        if (s->time_max > out->time_max) out->time_max = s->time_max;
+        for (int b = 0; b < SYSCALLSTAT_BUCKETS; b++) {
+            out->hist[b] += s->hist[b];
+        }
+    }
+    return out->calls ? 1 : 0;
+}
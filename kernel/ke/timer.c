@@ -5,11 +5,13 @@
 #include "../../include/kernel/sched.h"
 #include "../../include/kernel/signal.h"
 #include "../../include/kernel/percpu.h"
-#include "../../include/kernel/pagecache.h"
+#include "../../include/kernel/workqueue.h"
 #include "../../include/kernel/acpi.h"
 #include "../../include/kernel/memory.h"
 #include "../../include/kernel/lapic.h"
 #include "../../include/kernel/random.h"
+#include "../../include/kernel/rcu.h"
+#include "../../include/kernel/hrtimer.h"
 
 static volatile uint64_t g_ticks = 0;
 /* PM Timer-based wall-clock microsecond counter.
@@ -35,8 +37,9 @@ static inline uint64_t rdtsc(void);
 static uint64_t g_tsc_cpu_base_us[MAX_CPUS] = {0};
 static uint64_t g_tsc_cpu_base_cycles[MAX_CPUS] = {0};
 static volatile uint8_t g_tsc_cpu_ready[MAX_CPUS] = {0};
-/* Seqlock to ensure g_total_us and g_pm_last are read consistently. */
-static volatile uint32_t g_tick_seq = 0;
+/* Sequence count so g_total_us and g_pm_last are read consistently.
+ * Only the BSP tick handler writes them, so no writer lock is needed. */
+static seqcount_t g_tick_seq = SEQCOUNT_INIT;
 static uint32_t g_frequency = 100; // Default 100 Hz
 static uint64_t g_boot_epoch = 0;  // Unix epoch seconds at boot (from UEFI or CMOS RTC)
 
@@ -168,12 +171,10 @@ static uint64_t timer_get_fallback_precise_us(void) {
         uint32_t pm_base;
         uint32_t seq;
         do {
-            seq = g_tick_seq;
-            __asm__ volatile("" ::: "memory");
+            seq = read_seqcount_begin(&g_tick_seq);
             total_us_base = g_total_us;
             pm_base = g_pm_last;
-            __asm__ volatile("" ::: "memory");
-        } while (seq != g_tick_seq || (seq & 1));
+        } while (read_seqcount_retry(&g_tick_seq, seq));
 
         uint32_t pm_now = pmtimer_read();
         uint32_t delta = (pm_now - pm_base) & g_pmtimer_mask;
@@ -470,7 +471,7 @@ uint64_t timer_get_precise_us(void) {
         uint64_t cycles;
         uint32_t cpu_id;
 
-        percpu_preempt_disable();
+        preempt_disable();
         cpu_id = this_cpu_id();
 
         if (cpu_id < MAX_CPUS && !g_tsc_cpu_ready[cpu_id]) {
@@ -486,11 +487,11 @@ uint64_t timer_get_precise_us(void) {
         if (cpu_id < MAX_CPUS && __atomic_load_n(&g_tsc_cpu_ready[cpu_id], __ATOMIC_ACQUIRE)) {
             uint64_t delta = cycles - g_tsc_cpu_base_cycles[cpu_id];
             uint64_t value = g_tsc_cpu_base_us[cpu_id] + tsc_cycles_to_us(delta);
-            percpu_preempt_enable();
+            preempt_enable();
             return value;
         }
 
-        percpu_preempt_enable();
+        preempt_enable();
     }
 
     return timer_get_fallback_precise_us();
@@ -988,9 +989,8 @@ void timer_irq_handler(void) {
     }
     
     if (is_bsp) {
-        /* Seqlock write: odd = updating, even = stable */
-        g_tick_seq++;
-        __asm__ volatile("" ::: "memory");
+        /* Seqcount write: odd = updating, even = stable */
+        write_seqcount_begin(&g_tick_seq);
 
         g_ticks++;
 
@@ -1004,8 +1004,7 @@ void timer_irq_handler(void) {
             g_pm_last = pm_now;
         }
 
-        __asm__ volatile("" ::: "memory");
-        g_tick_seq++;
+        write_seqcount_end(&g_tick_seq);
 
         // Feed entropy from timer jitter
         entropy_add_timer_jitter();
@@ -1019,61 +1018,32 @@ void timer_irq_handler(void) {
             sched_calc_load();
         }
 
-        // Page cache: signal periodic dirty writeback
-        pagecache_timer_tick(g_ticks);
+        // Queue delayed work that has come due
+        workqueue_timer_tick(g_ticks);
     }
 
-    // Per-CPU: manage this CPU's current task time slice
+    // High-resolution timers are checked on every CPU's tick, not just the
+    // BSP's, so a due timer waits for the nearest tick on any CPU
+    hrtimer_run_queues();
+
+    // Per-CPU: check the current task's time slice.  User and system time
+    // are accounted at kernel entry and exit (see cputime.h).
     task_t* cur = sched_current();
     if (cur) {
-        // Accounting: charge a tick to user or system time.
-        // Skip idle tasks and the bootstrap task (PID 0) — their CPU time
-        // should not be counted.
-        // Guard: this_cpu() reads %gs:0 which faults before percpu_init(),
-        // so only attempt the idle-task check after SMP is initialized.
-        int skip = (cur->id == 0);
-        if (!skip && sched_is_smp()) {
-            percpu_t* cpu = this_cpu();
-            if (cur == cpu->idle_task)
-                skip = 1;
-        }
-        if (!skip) {
-            if (cur->privilege == TASK_USER) {
-                if (cur->preempt_frame && (cur->preempt_frame->cs & 3) == 3)
-                    cur->utime_ticks++;
-                else
-                    cur->stime_ticks++;
-            } else {
-                cur->stime_ticks++;
-            }
-        }
-
-        if (cur->remaining_ticks > 0) {
-            cur->remaining_ticks--;
-        }
-        // Always request preemption when the timeslice expires, regardless
-        // of task state.  In particular, a ZOMBIE task (killed by signal
-        // while running) sits in an `sti; hlt` loop waiting to be preempted
-        // off this CPU.  If we only checked RUNNING/READY here, the ZOMBIE
-        // would never get need_resched set, sched_preempt would never be
-        // called, and sched_remove_task on another CPU would spin forever
-        // waiting for this CPU to context-switch away.
-        if (cur->remaining_ticks == 0) {
-            sched_set_need_resched(cur);
-        }
+        // Charge runtime to the task's vruntime and request preemption
+        // once its fair slice is used up (see sched_task_tick)
+        sched_task_tick(cur);
     }
     
-    // Per-CPU load balancing: periodically pull tasks from busiest CPU
-    // Use per-CPU timer_ticks (incremented in percpu) to avoid depending
-    // on g_ticks which is only updated by BSP.  When g_ticks==0
-    // (BSP hasn't started yet), (0 % 50)==0 would fire load balance on
-    // EVERY AP timer interrupt, causing massive spinlock contention.
+    // Per-CPU load balancing: update this CPU's load average and balance
+    // any scheduling domain whose interval has expired.  Intervals are
+    // kept in per-CPU timer_ticks rather than g_ticks, which only the BSP
+    // advances.
     if (sched_is_smp()) {
         percpu_t* cpu = this_cpu();
         cpu->timer_ticks++;
-        if ((cpu->timer_ticks % 50) == 0) {
-            sched_load_balance();
-        }
+        sched_load_balance();
+        rcu_tick();
     }
     
     // Only BSP calls sched_tick for global statistics
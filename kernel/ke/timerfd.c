@@ -0,0 +1,223 @@
+// LikeOS-64 - Timer Files (timerfd)
+//
+// See include/kernel/timerfd.h.  A timerfd_ctx embeds the vfs_file_t the
+// fd table points at.  The wait queue's lock protects the expiration count
+// and the interval, and is what the hrtimer callback takes, so setting
+// the timer cancels it under that lock with hrtimer_try_to_cancel() and
+// retries if the callback is running (it may be spinning on the lock).
+
+#include "../../include/kernel/timerfd.h"
+#include "../../include/kernel/hrtimer.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/wait.h"
+#include "../../include/kernel/poll.h"
+#include "../../include/kernel/net.h"
+#include "../../include/kernel/syscall.h"
+#include "../../include/kernel/uaccess.h"
+
+typedef struct timerfd_ctx {
+    vfs_file_t vfs;                 // Must be first: the fd table points here
+    wait_queue_head_t wqh;          // Readers; lock covers the fields below
+    hrtimer_t timer;
+    uint64_t interval;              // ns, 0 = one-shot
+    uint64_t ticks;                 // Expirations not yet read
+    int clockid;
+} timerfd_ctx_t;
+
+static long timerfd_read(vfs_file_t* f, void* buf, long bytes);
+static int timerfd_close(vfs_file_t* f);
+static short timerfd_poll(vfs_file_t* f, short events, poll_table_t* pt);
+
+static const vfs_ops_t timerfd_ops = {
+    .read = timerfd_read,
+    .close = timerfd_close,
+    .poll = timerfd_poll,
+};
+
+int timerfd_is_timerfd(vfs_file_t* f) {
+    return f && (uintptr_t)f >= 0xFFFF800000000000ULL && f->ops == &timerfd_ops;
+}
+
+static hrtimer_restart_t timerfd_tmrproc(hrtimer_t* timer) {
+    timerfd_ctx_t* ctx = container_of(timer, timerfd_ctx_t, timer);
+    hrtimer_restart_t ret = HRTIMER_NORESTART;
+    uint64_t flags;
+
+    spin_lock_irqsave(&ctx->wqh.lock, &flags);
+    if (ctx->interval) {
+        ctx->ticks += hrtimer_forward(timer, ktime_get_ns(), ctx->interval);
+        ret = HRTIMER_RESTART;
+    } else {
+        ctx->ticks++;
+    }
+    spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+
+    wake_up_key(&ctx->wqh, POLLIN);
+    return ret;
+}
+
+static long timerfd_read(vfs_file_t* f, void* buf, long bytes) {
+    timerfd_ctx_t* ctx = (timerfd_ctx_t*)f;
+    if (bytes < (long)sizeof(uint64_t)) {
+        return -EINVAL;
+    }
+
+    task_t* cur = sched_current();
+    uint64_t ticks;
+    uint64_t flags;
+    for (;;) {
+        spin_lock_irqsave(&ctx->wqh.lock, &flags);
+        ticks = ctx->ticks;
+        ctx->ticks = 0;
+        spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+        if (ticks) {
+            break;
+        }
+        if (!cur || (f->flags & O_NONBLOCK)) {
+            return -EAGAIN;
+        }
+        if (signal_pending(cur)) {
+            return -EINTR;
+        }
+        wait_queue_entry_t wait;
+        init_wait_entry(&wait, cur);
+        prepare_to_wait(&ctx->wqh, &wait);
+        if (!__atomic_load_n(&ctx->ticks, __ATOMIC_ACQUIRE) && !signal_pending(cur)) {
+            sched_schedule();
+        }
+        finish_wait(&ctx->wqh, &wait);
+    }
+
+    // A faulting copy-out leaves the expirations to be read again
+    if (put_user(ticks, (uint64_t*)buf)) {
+        spin_lock_irqsave(&ctx->wqh.lock, &flags);
+        ctx->ticks += ticks;
+        spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+        return -EFAULT;
+    }
+    return sizeof(ticks);
+}
+
+static short timerfd_poll(vfs_file_t* f, short events, poll_table_t* pt) {
+    timerfd_ctx_t* ctx = (timerfd_ctx_t*)f;
+    poll_wait(&ctx->wqh, pt);
+    if ((events & (POLLIN | POLLRDNORM)) && __atomic_load_n(&ctx->ticks, __ATOMIC_ACQUIRE))
+        return POLLIN | POLLRDNORM;
+    return 0;
+}
+
+static int timerfd_close(vfs_file_t* f) {
+    timerfd_ctx_t* ctx = (timerfd_ctx_t*)f;
+    hrtimer_cancel(&ctx->timer);
+    kfree(ctx);
+    return 0;
+}
+
+static uint64_t timespec_to_ns(const struct k_timespec* ts) {
+    if ((uint64_t)ts->tv_sec >= KTIME_MAX / NSEC_PER_SEC) {
+        return KTIME_MAX;
+    }
+    return (uint64_t)ts->tv_sec * NSEC_PER_SEC + (uint64_t)ts->tv_nsec;
+}
+
+static void ns_to_timespec(uint64_t ns, struct k_timespec* ts) {
+    ts->tv_sec = (int64_t)(ns / NSEC_PER_SEC);
+    ts->tv_nsec = (int64_t)(ns % NSEC_PER_SEC);
+}
+
+static bool timespec_valid(const struct k_timespec* ts) {
+    return ts->tv_sec >= 0 && ts->tv_nsec >= 0 && ts->tv_nsec < (int64_t)NSEC_PER_SEC;
+}
+
+// Time left before an armed timer fires; called with wqh.lock held
+static uint64_t timerfd_remaining(timerfd_ctx_t* ctx, uint64_t now) {
+    // A timer that is due but not yet run reads as about to fire
+    return ctx->timer.expires > now ? ctx->timer.expires - now : 1;
+}
+
+int timerfd_settime(vfs_file_t* f, int flags, const struct k_itimerspec* new_value,
+                    struct k_itimerspec* old) {
+    timerfd_ctx_t* ctx = (timerfd_ctx_t*)f;
+    if (flags & ~(TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET)) {
+        return -EINVAL;
+    }
+    if (!timespec_valid(&new_value->it_value) || !timespec_valid(&new_value->it_interval)) {
+        return -EINVAL;
+    }
+    uint64_t value = timespec_to_ns(&new_value->it_value);
+    uint64_t interval = timespec_to_ns(&new_value->it_interval);
+
+    uint64_t irqflags;
+    int was_armed;
+    for (;;) {
+        spin_lock_irqsave(&ctx->wqh.lock, &irqflags);
+        was_armed = hrtimer_try_to_cancel(&ctx->timer);
+        if (was_armed >= 0) {
+            break;
+        }
+        spin_unlock_irqrestore(&ctx->wqh.lock, irqflags);
+        cpu_relax();
+    }
+
+    uint64_t now = ktime_get_ns();
+    if (old) {
+        ns_to_timespec(was_armed ? timerfd_remaining(ctx, now) : 0, &old->it_value);
+        ns_to_timespec(ctx->interval, &old->it_interval);
+    }
+
+    ctx->ticks = 0;
+    ctx->interval = interval;
+    if (value) {
+        uint64_t expires;
+        if (flags & TFD_TIMER_ABSTIME) {
+            expires = value;
+            if (ctx->clockid == CLOCK_REALTIME) {
+                uint64_t boot_ns = timer_get_boot_epoch() * NSEC_PER_SEC;
+                // A time before boot is already past
+                expires = value > boot_ns ? value - boot_ns : 0;
+            }
+        } else {
+            expires = value > KTIME_MAX - now ? KTIME_MAX : now + value;
+        }
+        hrtimer_start(&ctx->timer, expires);
+    }
+    spin_unlock_irqrestore(&ctx->wqh.lock, irqflags);
+    return 0;
+}
+
+void timerfd_gettime(vfs_file_t* f, struct k_itimerspec* cur) {
+    timerfd_ctx_t* ctx = (timerfd_ctx_t*)f;
+    uint64_t flags;
+    spin_lock_irqsave(&ctx->wqh.lock, &flags);
+    uint64_t left = hrtimer_is_queued(&ctx->timer) ? timerfd_remaining(ctx, ktime_get_ns()) : 0;
+    ns_to_timespec(left, &cur->it_value);
+    ns_to_timespec(ctx->interval, &cur->it_interval);
+    spin_unlock_irqrestore(&ctx->wqh.lock, flags);
+}
+
+int timerfd_create(int clockid, int flags, vfs_file_t** out) {
+    if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC) {
+        return -EINVAL;
+    }
+    if (flags & ~(TFD_NONBLOCK | TFD_CLOEXEC)) {
+        return -EINVAL;
+    }
+
+    timerfd_ctx_t* ctx = kalloc(sizeof(timerfd_ctx_t));
+    if (!ctx) {
+        return -ENOMEM;
+    }
+    mm_memset(ctx, 0, sizeof(timerfd_ctx_t));
+    wait_queue_init(&ctx->wqh, "timerfd");
+    hrtimer_init(&ctx->timer, timerfd_tmrproc);
+    ctx->clockid = clockid;
+
+    ctx->vfs.ops = &timerfd_ops;
+    ctx->vfs.fs_private = ctx;
+    ctx->vfs.refcount = 1;
+    ctx->vfs.flags = O_RDONLY | (flags & (TFD_NONBLOCK | TFD_CLOEXEC));
+
+    *out = &ctx->vfs;
+    return 0;
+}
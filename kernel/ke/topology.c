@@ -0,0 +1,266 @@
+// LikeOS-64 - CPU Topology and Scheduling Domains
+// ============================================================================
+// Each CPU decodes its own x2APIC ID into thread / core / package fields
+// using CPUID leaf 0x1F (or 0xB, or the legacy leaf 1/4 counts), and its
+// cache sharing from the deterministic cache leaf (4 on Intel, 0x8000001D
+// on AMD).  Once all CPUs are up the BSP groups them into per-CPU
+// scheduling domains, innermost first:
+//
+//   SMT  - hardware threads of one core (share L1/L2, balance eagerly)
+//   MC   - cores sharing the last-level cache
+//   PKG  - the whole package (socket)
+//   SYS  - every online CPU
+//
+// A level whose span equals the level below it is marked inactive so the
+// load balancer skips it.
+// ============================================================================
+
+#include "../../include/kernel/topology.h"
+#include "../../include/kernel/percpu.h"
+#include "../../include/kernel/console.h"
+#include "../../include/kernel/smp.h"
+
+static cpu_topology_t g_cpu_topology[MAX_CPUS];
+static sched_domain_t g_sched_domains[MAX_CPUS][SD_NR_LEVELS];
+static volatile bool g_domains_ready = false;
+
+// Per-level balancing parameters: idle interval, busy interval (timer ticks)
+// and the imbalance percentage that must be exceeded before pulling.
+// Inner levels balance more often and more eagerly since migration there
+// keeps the task's cache warm.
+static const struct {
+    uint32_t min_interval;
+    uint32_t max_interval;
+    uint32_t imbalance_pct;
+} g_sd_params[SD_NR_LEVELS] = {
+    [SD_LEVEL_SMT] = { 1,  4, 110 },
+    [SD_LEVEL_MC]  = { 2,  8, 117 },
+    [SD_LEVEL_PKG] = { 4, 32, 125 },
+    [SD_LEVEL_SYS] = { 8, 64, 125 },
+};
+
+// ============================================================================
+// CPUID Helpers
+// ============================================================================
+
+static inline void cpuid_count(uint32_t leaf, uint32_t subleaf, uint32_t* eax,
+                               uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(subleaf));
+}
+
+// Smallest s with (1 << s) >= n
+static uint8_t ceil_log2(uint32_t n) {
+    uint8_t s = 0;
+    while (s < 31 && (1U << s) < n) s++;
+    return s;
+}
+
+static bool cpu_is_amd(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid_count(0, 0, &eax, &ebx, &ecx, &edx);
+    // "AuthenticAMD"
+    return ebx == 0x68747541 && edx == 0x69746E65 && ecx == 0x444D4163;
+}
+
+// Extended topology enumeration (leaf 0x1F or 0xB).  Returns false if the
+// leaf is not implemented.
+static bool topology_read_extended(uint32_t leaf, cpu_topology_t* topo) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid_count(leaf, 0, &eax, &ebx, &ecx, &edx);
+    if (ebx == 0) return false;
+
+    bool have_smt = false;
+    uint8_t last_shift = 0;
+    for (uint32_t sub = 0; sub < 8; sub++) {
+        cpuid_count(leaf, sub, &eax, &ebx, &ecx, &edx);
+        uint32_t type = (ecx >> 8) & 0xFF;
+        if (type == 0) break;
+        uint8_t shift = (uint8_t)(eax & 0x1F);
+        if (type == 1) {            // SMT
+            topo->smt_shift = shift;
+            have_smt = true;
+        }
+        // Core, module, tile and die levels all sit inside the package;
+        // the last reported level's shift covers the whole package.
+        last_shift = shift;
+        topo->x2apic_id = edx;
+    }
+    if (!have_smt) topo->smt_shift = 0;
+    topo->pkg_shift = last_shift > topo->smt_shift ? last_shift : topo->smt_shift;
+    topo->leaf = (uint8_t)leaf;
+    return true;
+}
+
+// Legacy enumeration from leaf 1 logical-processor count and leaf 4 (Intel)
+// or 0x80000008 (AMD) core count.
+static void topology_read_legacy(cpu_topology_t* topo, bool amd, uint32_t max_leaf) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid_count(1, 0, &eax, &ebx, &ecx, &edx);
+    topo->x2apic_id = ebx >> 24;
+
+    uint32_t logical = (edx & (1U << 28)) ? ((ebx >> 16) & 0xFF) : 1;
+    if (logical == 0) logical = 1;
+
+    uint32_t cores = 1;
+    if (amd) {
+        cpuid_count(0x80000000, 0, &eax, &ebx, &ecx, &edx);
+        if (eax >= 0x80000008) {
+            cpuid_count(0x80000008, 0, &eax, &ebx, &ecx, &edx);
+            cores = (ecx & 0xFF) + 1;
+        }
+    } else if (max_leaf >= 4) {
+        cpuid_count(4, 0, &eax, &ebx, &ecx, &edx);
+        if (eax & 0x1F) cores = (eax >> 26) + 1;
+    }
+    if (cores > logical) cores = logical;
+
+    topo->pkg_shift = ceil_log2(logical);
+    topo->smt_shift = ceil_log2(logical / cores);
+    topo->leaf = 1;
+}
+
+// Deterministic cache parameters: find the L2 and the last-level cache and
+// how many APIC IDs share each.
+static void topology_read_caches(cpu_topology_t* topo, bool amd, uint32_t max_leaf) {
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t leaf = 0;
+
+    if (amd) {
+        cpuid_count(0x80000000, 0, &eax, &ebx, &ecx, &edx);
+        if (eax >= 0x8000001D) {
+            cpuid_count(0x80000001, 0, &eax, &ebx, &ecx, &edx);
+            if (ecx & (1U << 22)) leaf = 0x8000001D;    // TOPOEXT
+        }
+    } else if (max_leaf >= 4) {
+        leaf = 4;
+    }
+
+    // Without cache information assume the package shares one LLC
+    topo->llc_shift = topo->pkg_shift;
+    topo->l2_shift = topo->smt_shift;
+    topo->llc_level = 0;
+    if (!leaf) return;
+
+    for (uint32_t sub = 0; sub < 16; sub++) {
+        cpuid_count(leaf, sub, &eax, &ebx, &ecx, &edx);
+        uint32_t type = eax & 0x1F;
+        if (type == 0) break;
+        if (type != 1 && type != 3) continue;   // Data or unified caches only
+
+        uint8_t level = (uint8_t)((eax >> 5) & 0x7);
+        uint8_t shift = ceil_log2(((eax >> 14) & 0xFFF) + 1);
+        if (level == 2) topo->l2_shift = shift;
+        if (level >= topo->llc_level) {
+            topo->llc_level = level;
+            topo->llc_shift = shift;
+        }
+    }
+}
+
+// ============================================================================
+// Public Interface
+// ============================================================================
+
+void topology_init_cpu(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS) return;
+
+    cpu_topology_t* topo = &g_cpu_topology[cpu_id];
+    uint32_t eax, ebx, ecx, edx;
+    cpuid_count(0, 0, &eax, &ebx, &ecx, &edx);
+    uint32_t max_leaf = eax;
+    bool amd = cpu_is_amd();
+
+    if (!(max_leaf >= 0x1F && topology_read_extended(0x1F, topo)) &&
+        !(max_leaf >= 0xB && topology_read_extended(0xB, topo))) {
+        topology_read_legacy(topo, amd, max_leaf);
+    }
+    topology_read_caches(topo, amd, max_leaf);
+
+    topo->core_key = topo->x2apic_id >> topo->smt_shift;
+    topo->pkg_key = topo->x2apic_id >> topo->pkg_shift;
+    topo->llc_key = topo->x2apic_id >> topo->llc_shift;
+    topo->l2_key = topo->x2apic_id >> topo->l2_shift;
+    __atomic_store_n(&topo->valid, true, __ATOMIC_RELEASE);
+
+    smp_dbg("TOPO: CPU %u x2apic=%u core=%u llc=%u(L%u) pkg=%u leaf=0x%x\n",
+            cpu_id, topo->x2apic_id, topo->core_key, topo->llc_key,
+            topo->llc_level, topo->pkg_key, topo->leaf);
+}
+
+static inline bool cpu_present(uint32_t c) {
+    return percpu_get(c) && g_cpu_topology[c].valid;
+}
+
+void topology_build_domains(void) {
+    uint32_t cpus = 0, cores = 0, llcs = 0, pkgs = 0;
+    uint64_t all = 0;
+
+    for (uint32_t c = 0; c < MAX_CPUS; c++) {
+        if (cpu_present(c)) all |= 1ULL << c;
+    }
+
+    for (uint32_t c = 0; c < MAX_CPUS; c++) {
+        if (!(all & (1ULL << c))) continue;
+        const cpu_topology_t* me = &g_cpu_topology[c];
+
+        uint64_t span[SD_NR_LEVELS] = { 0, 0, 0, all };
+        for (uint32_t o = 0; o < MAX_CPUS; o++) {
+            if (!(all & (1ULL << o))) continue;
+            const cpu_topology_t* t = &g_cpu_topology[o];
+            if (t->pkg_key != me->pkg_key) continue;
+            span[SD_LEVEL_PKG] |= 1ULL << o;
+            if (t->llc_key == me->llc_key) span[SD_LEVEL_MC] |= 1ULL << o;
+            if (t->core_key == me->core_key) span[SD_LEVEL_SMT] |= 1ULL << o;
+        }
+        // Each level must contain the one below it
+        span[SD_LEVEL_MC] |= span[SD_LEVEL_SMT];
+        span[SD_LEVEL_PKG] |= span[SD_LEVEL_MC];
+
+        uint64_t below = 1ULL << c;
+        for (int l = 0; l < SD_NR_LEVELS; l++) {
+            sched_domain_t* sd = &g_sched_domains[c][l];
+            sd->span = span[l];
+            sd->min_interval = g_sd_params[l].min_interval;
+            sd->max_interval = g_sd_params[l].max_interval;
+            sd->imbalance_pct = g_sd_params[l].imbalance_pct;
+            sd->nr_failed = 0;
+            // Stagger first passes so CPUs do not balance in lock-step
+            sd->next_balance = c % (sd->max_interval ? sd->max_interval : 1);
+            sd->active = span[l] != below;
+            if (sd->active) below = span[l];
+        }
+
+        // Count distinct groups by their lowest-numbered member
+        cpus++;
+        if (__builtin_ctzll(span[SD_LEVEL_SMT]) == (int)c) cores++;
+        if (__builtin_ctzll(span[SD_LEVEL_MC]) == (int)c) llcs++;
+        if (__builtin_ctzll(span[SD_LEVEL_PKG]) == (int)c) pkgs++;
+    }
+
+    __atomic_store_n(&g_domains_ready, true, __ATOMIC_RELEASE);
+    kprintf("Scheduler: topology %u CPU(s), %u core(s), %u LLC domain(s), %u package(s)\n",
+            cpus, cores, llcs, pkgs);
+}
+
+bool topology_domains_ready(void) {
+    return __atomic_load_n(&g_domains_ready, __ATOMIC_ACQUIRE);
+}
+
+const cpu_topology_t* topology_cpu(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS || !g_cpu_topology[cpu_id].valid) return NULL;
+    return &g_cpu_topology[cpu_id];
+}
+
+sched_domain_t* topology_domain(uint32_t cpu_id, int level) {
+    if (cpu_id >= MAX_CPUS || level < 0 || level >= SD_NR_LEVELS) return NULL;
+    if (!topology_domains_ready()) return NULL;
+    return &g_sched_domains[cpu_id][level];
+}
+
+bool topology_cpus_share_cache(uint32_t a, uint32_t b) {
+    if (a == b) return true;
+    if (!topology_domains_ready() || a >= MAX_CPUS || b >= MAX_CPUS) return false;
+    return (g_sched_domains[a][SD_LEVEL_MC].span >> b) & 1;
+}
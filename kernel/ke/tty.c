@@ -8,42 +8,16 @@
 #include "../../include/kernel/sched.h"
 #include "../../include/kernel/timer.h"
 #include "../../include/kernel/net.h"
+#include "../../include/kernel/uaccess.h"
 
 #define TTY_MAX_PTYS 16
 
+// Staging buffer size for copies through the pty master
+#define PTY_IO_CHUNK 256
+
 // Spinlock for TTY buffer access
 static spinlock_t tty_lock = SPINLOCK_INIT("tty");
 
-// Security: Validate user pointer is in user space
-static bool tty_validate_user_ptr(uint64_t ptr, size_t len) {
-    if (ptr < 0x10000) return false;  // Reject low addresses (NULL deref protection)
-    if (ptr >= 0x7FFFFFFFFFFF) return false;  // Beyond user space
-    if (ptr + len < ptr) return false;  // Overflow check
-    return true;
-}
-
-// Security: SMAP-aware copy from kernel to user
-static int tty_copy_to_user(void* user_dst, const void* kernel_src, size_t len) {
-    if (!tty_validate_user_ptr((uint64_t)user_dst, len)) {
-        return -EFAULT;
-    }
-    smap_disable();
-    mm_memcpy(user_dst, kernel_src, len);
-    smap_enable();
-    return 0;
-}
-
-// Security: SMAP-aware copy from user to kernel
-static int tty_copy_from_user(void* kernel_dst, const void* user_src, size_t len) {
-    if (!tty_validate_user_ptr((uint64_t)user_src, len)) {
-        return -EFAULT;
-    }
-    smap_disable();
-    mm_memcpy(kernel_dst, user_src, len);
-    smap_enable();
-    return 0;
-}
-
 /* PTY master ring buffer.
  *
  * The slave-side process writes here through tty_write -> tty->output.
@@ -76,6 +50,7 @@ typedef struct pty {
     uint32_t m_count;
     spinlock_t lock;
     task_t* master_read_waiters;
+    wait_queue_head_t master_read_wq;   // poll/epoll watchers of the master
     int master_open;
     int slave_open;
 } pty_t;
@@ -97,11 +72,18 @@ static pty_t g_ptys[TTY_MAX_PTYS];
  * unlinking it from any custom wait queues, and the next wake walked
  * t->wait_next through freed memory and page-faulted in tty_wake_readers.
  *
- * 'waiters' itself is no longer touched (kept as a parameter only so
- * existing call sites need no change).
+ * 'waiters' itself is no longer touched; only its address is used.
+ * poll and epoll watchers sit on a real wait queue next to it, which is
+ * woken alongside.
  */
-static void tty_wake_readers(task_t** waiters) {
-    sched_wake_channel((void*)waiters);
+static void tty_wake_readers(tty_t* tty) {
+    sched_wake_channel((void*)&tty->read_waiters);
+    wake_up_key(&tty->read_wq, POLLIN | POLLRDNORM);
+}
+
+static void pty_wake_master_readers(pty_t* pty) {
+    sched_wake_channel((void*)&pty->master_read_waiters);
+    wake_up(&pty->master_read_wq);
 }
 
 static void tty_enqueue_read(tty_t* tty, char c) {
@@ -1036,7 +1018,7 @@ static long pty_master_enqueue_bulk(pty_t* pty, const char* buf, long len) {
     pty->m_count += to_copy;
     spin_unlock_irqrestore(&pty->lock, flags);
     if (to_copy > 0) {
-        tty_wake_readers(&pty->master_read_waiters);
+        pty_wake_master_readers(pty);
     }
     return (long)to_copy;
 }
@@ -1091,6 +1073,7 @@ void tty_init(void) {
     g_console_tty.is_master = 0;
     g_console_tty.fg_pgid = 0;
     g_console_tty.output = tty_output_console;
+    wait_queue_init(&g_console_tty.read_wq, "tty_read");
 
     /* Query actual console dimensions from the framebuffer driver */
     uint32_t rows = 25, cols = 80;
@@ -1128,13 +1111,13 @@ static void tty_signal_pgrp(tty_t* tty, int sig) {
     }
     sched_signal_pgrp(tty->fg_pgid, sig);
     // Wake any blocked readers so they can see they've been signaled/killed
-    tty_wake_readers(&tty->read_waiters);
+    tty_wake_readers(tty);
 }
 
 void tty_input_char_raw(tty_t* tty, char c) {
     if (!tty) return;
     tty_enqueue_read(tty, c);
-    tty_wake_readers(&tty->read_waiters);
+    tty_wake_readers(tty);
 }
 
 /* Helper: inject a string into the TTY read buffer (raw, no line discipline) */
@@ -1261,7 +1244,7 @@ void tty_mouse_report(int pixel_x, int pixel_y, uint8_t buttons, uint8_t prev_bu
 
     /* Wake readers waiting for input */
     if (pressed || released || (motion && tty->mouse_btn_event))
-        tty_wake_readers(&tty->read_waiters);
+        tty_wake_readers(tty);
 }
 
 /*
@@ -1306,7 +1289,7 @@ void tty_mouse_report_scroll(int pixel_x, int pixel_y, int scroll_delta) {
     seq[pos++] = 'M';
     seq[pos] = '\0';
     tty_inject_string(tty, seq);
-    tty_wake_readers(&tty->read_waiters);
+    tty_wake_readers(tty);
 }
 
 void tty_input_char(tty_t* tty, char c, int ctrl) {
@@ -1390,14 +1373,14 @@ void tty_input_char(tty_t* tty, char c, int ctrl) {
         if (c == tty->term.c_cc[VEOF]) {
             if (tty->canon_len == 0) {
                 tty->eof_pending = 1;
-                tty_wake_readers(&tty->read_waiters);
+                tty_wake_readers(tty);
                 return;
             }
             for (uint16_t i = 0; i < tty->canon_len; ++i) {
                 tty_enqueue_read(tty, tty->canon_buf[i]);
             }
             tty->canon_len = 0;
-            tty_wake_readers(&tty->read_waiters);
+            tty_wake_readers(tty);
             return;
         }
         if (tty->canon_len < sizeof(tty->canon_buf)) {
@@ -1415,7 +1398,7 @@ void tty_input_char(tty_t* tty, char c, int ctrl) {
                 tty_enqueue_read(tty, tty->canon_buf[i]);
             }
             tty->canon_len = 0;
-            tty_wake_readers(&tty->read_waiters);
+            tty_wake_readers(tty);
         }
         return;
     }
@@ -1428,7 +1411,7 @@ void tty_input_char(tty_t* tty, char c, int ctrl) {
         }
         tty->output(tty, c);
     }
-    tty_wake_readers(&tty->read_waiters);
+    tty_wake_readers(tty);
 }
 
 long tty_read(tty_t* tty, void* buf, long count, int nonblock) {
@@ -1547,10 +1530,10 @@ long tty_read(tty_t* tty, void* buf, long count, int nonblock) {
             }
             break;
         }
-        // SMAP-aware write to user buffer
-        smap_disable();
-        out[read++] = c;
-        smap_enable();
+        if (put_user(c, &out[read])) {
+            return read > 0 ? read : -EFAULT;
+        }
+        read++;
         if ((tty->term.c_lflag & ICANON) && c == '\n') {
             break;
         }
@@ -1587,9 +1570,9 @@ long tty_write(tty_t* tty, const void* buf, long count) {
         while (total < count) {
             long chunk = count - total;
             if (chunk > PTY_OUT_CHUNK) chunk = PTY_OUT_CHUNK;
-            smap_disable();
-            for (long i = 0; i < chunk; i++) tmpbuf[i] = in[total + i];
-            smap_enable();
+            if (copy_from_user(tmpbuf, in + total, (size_t)chunk)) {
+                return total > 0 ? total : -EFAULT;
+            }
             long out_len = 0;
             if (do_opost) {
                 for (long i = 0; i < chunk; i++) {
@@ -1610,9 +1593,9 @@ long tty_write(tty_t* tty, const void* buf, long count) {
         return total;
     }
 
-    // Copy user buffer into a small kernel-side staging buffer so we do
-    // one SMAP window per chunk instead of per character, and hold the
-    // tty_lock for the entire write so two CPUs can't interleave chars.
+    // Copy user buffer into a small kernel-side staging buffer so a bad
+    // user page faults before tty_lock is taken, and hold the tty_lock for
+    // the entire chunk so two CPUs can't interleave chars.
     #define TTY_WRITE_CHUNK 256
     char tmp[TTY_WRITE_CHUNK];
     char mirror_tmp[TTY_WRITE_CHUNK];
@@ -1627,11 +1610,10 @@ long tty_write(tty_t* tty, const void* buf, long count) {
         long chunk = count - written;
         if (chunk > TTY_WRITE_CHUNK) chunk = TTY_WRITE_CHUNK;
 
-        // Bulk copy from user space
-        smap_disable();
-        for (long i = 0; i < chunk; i++)
-            tmp[i] = ((const char*)buf)[written + i];
-        smap_enable();
+        if (copy_from_user(tmp, (const char*)buf + written, (size_t)chunk)) {
+            console_batch_end();
+            return written > 0 ? written : -EFAULT;
+        }
 
         uint64_t flags;
         long mirror_len = 0;
@@ -1666,7 +1648,7 @@ long tty_write(tty_t* tty, const void* buf, long count) {
          * tty_lock with IRQs off. */
         if (mirror_console && g_console_reply_pending) {
             g_console_reply_pending = 0;
-            tty_wake_readers(&tty->read_waiters);
+            tty_wake_readers(tty);
         }
 
         // Rate-limited VRAM flush (~50fps) — skips if too recent
@@ -1689,30 +1671,29 @@ int tty_ioctl(tty_t* tty, unsigned long req, void* argp, task_t* cur) {
     switch (req) {
         case TCGETS:
             if (!argp) return -EFAULT;
-            // Security: Use SMAP-aware copy to user space
-            return tty_copy_to_user(argp, &tty->term, sizeof(termios_k_t));
+            return copy_to_user(argp, &tty->term, sizeof(termios_k_t));
         case TCSETS:
         case TCSETSW:
         case TCSETSF:
             if (!argp) return -EFAULT;
-            // Security: Use SMAP-aware copy from user space
             {
-                /* Only log when termios actually CHANGES, not the
-                 * spinning re-arm done by ncurses' input timing loop. */
-                int _r = tty_copy_from_user(&tty->term, argp, sizeof(termios_k_t));
+                // Stage it so a fault can't leave a half-written termios
+                termios_k_t term;
+                int _r = copy_from_user(&term, argp, sizeof(termios_k_t));
+                if (_r == 0) {
+                    tty->term = term;
+                }
                 return _r;
             }
         case TIOCGPGRP: {
             if (!argp) return -EFAULT;
             int pgid = tty->fg_pgid;
-            // Security: Use SMAP-aware copy to user space
-            return tty_copy_to_user(argp, &pgid, sizeof(int));
+            return copy_to_user(argp, &pgid, sizeof(int));
         }
         case TIOCSPGRP: {
             if (!argp) return -EFAULT;
             int pgid;
-            // Security: Use SMAP-aware copy from user space
-            int ret = tty_copy_from_user(&pgid, argp, sizeof(int));
+            int ret = copy_from_user(&pgid, argp, sizeof(int));
             if (ret != 0) return ret;
             tty->fg_pgid = pgid;
             return 0;
@@ -1723,13 +1704,14 @@ int tty_ioctl(tty_t* tty, unsigned long req, void* argp, task_t* cur) {
             return 0;
         case TIOCGWINSZ:
             if (!argp) return -EFAULT;
-            // Security: Use SMAP-aware copy to user space
-            return tty_copy_to_user(argp, &tty->winsz, sizeof(struct winsize));
+            return copy_to_user(argp, &tty->winsz, sizeof(struct winsize));
         case TIOCSWINSZ: {
             if (!argp) return -EFAULT;
             struct winsize old_winsz = tty->winsz;
-            int ret = tty_copy_from_user(&tty->winsz, argp, sizeof(struct winsize));
+            struct winsize winsz;
+            int ret = copy_from_user(&winsz, argp, sizeof(struct winsize));
             if (ret != 0) return ret;
+            tty->winsz = winsz;
             if (tty->winsz.ws_row != old_winsz.ws_row ||
                 tty->winsz.ws_col != old_winsz.ws_col) {
                 tty_signal_pgrp(tty, SIGWINCH);
@@ -1756,6 +1738,8 @@ int tty_pty_allocate(int* out_id) {
             pty_t* pty = &g_ptys[i];
             mm_memset(pty, 0, sizeof(pty_t));
             spinlock_init(&pty->lock, "pty");
+            wait_queue_init(&pty->master_read_wq, "pty_master");
+            wait_queue_init(&pty->slave.read_wq, "tty_read");
             pty->id = i;
             pty->master_open = 1;
             pty->slave_open = 0;
@@ -1808,23 +1792,32 @@ long tty_pty_master_read(int id, void* buf, long count, int nonblock) {
     }
     task_t* cur = sched_current();
     char* out = (char*)buf;
+    char kbuf[PTY_IO_CHUNK];
     long read = 0;
     while (read < count) {
         uint64_t flags;
         spin_lock_irqsave(&pty->lock, &flags);
 
-        /* Drain whatever is queued under the lock. */
-        while (pty->m_count > 0 && read < count) {
-            char c = pty->master_buf[pty->m_head];
+        /* Drain a chunk under the lock, then copy it out with the lock
+         * dropped (user-space access can fault). */
+        long want = count - read;
+        if (want > PTY_IO_CHUNK) want = PTY_IO_CHUNK;
+        long n = 0;
+        while (pty->m_count > 0 && n < want) {
+            kbuf[n++] = pty->master_buf[pty->m_head];
             pty->m_head = (pty->m_head + 1) % PTY_MASTER_BUF_SIZE;
             pty->m_count--;
+        }
+        if (n > 0) {
             spin_unlock_irqrestore(&pty->lock, flags);
-            /* SMAP-aware write to user buffer (must be done with the lock
-             * dropped — user-space access can fault). */
-            smap_disable();
-            out[read++] = c;
-            smap_enable();
-            spin_lock_irqsave(&pty->lock, &flags);
+            if (copy_to_user(out + read, kbuf, (size_t)n)) {
+                return read > 0 ? read : -EFAULT;
+            }
+            read += n;
+            if (n == want) {
+                continue;  /* Ring may hold more */
+            }
+            break;
         }
 
         if (read > 0) {
@@ -1863,12 +1856,18 @@ long tty_pty_master_write(int id, const void* buf, long count) {
         return -EINVAL;
     }
     const char* in = (const char*)buf;
-    for (long i = 0; i < count; ++i) {
-        // SMAP-aware read from user buffer
-        smap_disable();
-        char c = in[i];
-        smap_enable();
-        tty_input_char(&pty->slave, c, 0);
+    char kbuf[PTY_IO_CHUNK];
+    long done = 0;
+    while (done < count) {
+        long chunk = count - done;
+        if (chunk > PTY_IO_CHUNK) chunk = PTY_IO_CHUNK;
+        if (copy_from_user(kbuf, in + done, (size_t)chunk)) {
+            return done > 0 ? done : -EFAULT;
+        }
+        for (long i = 0; i < chunk; ++i) {
+            tty_input_char(&pty->slave, kbuf[i], 0);
+        }
+        done += chunk;
     }
     return count;
 }
@@ -1895,7 +1894,7 @@ int tty_pty_slave_close(int id) {
      * EOF (read returns 0) and the master fd's poll set transitions to
      * POLLHUP.  Without this, the last shell `exit` leaves tmux's I/O
      * loop blocked indefinitely. */
-    tty_wake_readers(&pty->master_read_waiters);
+    pty_wake_master_readers(pty);
     if (!pty->master_open) {
         pty->id = -1;
     }
@@ -1905,9 +1904,10 @@ int tty_pty_slave_close(int id) {
 /* Poll a pty master endpoint. Returns POLLIN when there are bytes
  * queued from the slave, POLLOUT always (writes are always accepted),
  * POLLHUP when the slave end is closed and no data remains. */
-int tty_pty_master_poll(int id, int events) {
+int tty_pty_master_poll(int id, int events, poll_table_t* pt) {
     pty_t* pty = tty_get_pty(id);
     if (!pty) return 0;
+    poll_wait(&pty->master_read_wq, pt);
     int rev = 0;
     uint64_t flags;
     spin_lock_irqsave(&pty->lock, &flags);
@@ -0,0 +1,188 @@
+// LikeOS-64 - Wait Queues
+//
+// Entries sit on a doubly linked list under the queue's spinlock.  Tasks
+// are woken through sched_wake_task(), which does the BLOCKED -> READY
+// transition under the task list lock like every other wakeup path, so a
+// task woken here and by a signal or timeout at once is enqueued once.
+
+#include "../../include/kernel/wait.h"
+#include "../../include/kernel/sched.h"
+
+void wait_queue_init(wait_queue_head_t* wq, const char* name) {
+    spinlock_init(&wq->lock, name);
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+static int autoremove_wake_function(wait_queue_entry_t* entry, unsigned long key);
+
+void init_wait_entry(wait_queue_entry_t* entry, task_t* task) {
+    entry->task = task;
+    entry->func = autoremove_wake_function;
+    entry->private = NULL;
+    entry->next = NULL;
+    entry->prev = NULL;
+    entry->queued = 0;
+    entry->flags = 0;
+}
+
+void init_wait_func_entry(wait_queue_entry_t* entry, wait_func_t func, void* private) {
+    entry->task = NULL;
+    entry->func = func;
+    entry->private = private;
+    entry->next = NULL;
+    entry->prev = NULL;
+    entry->queued = 0;
+    entry->flags = 0;
+}
+
+// Called with wq->lock held.  Exclusive entries go to the tail and the
+// others to the head, so a wakeup reaches every non-exclusive entry
+// before it can stop at an exclusive one.
+static void wq_link(wait_queue_head_t* wq, wait_queue_entry_t* entry) {
+    if (entry->flags & WQ_FLAG_EXCLUSIVE) {
+        entry->next = NULL;
+        entry->prev = wq->tail;
+        if (wq->tail) {
+            wq->tail->next = entry;
+        } else {
+            __atomic_store_n(&wq->head, entry, __ATOMIC_RELAXED);
+        }
+        wq->tail = entry;
+    } else {
+        entry->prev = NULL;
+        entry->next = wq->head;
+        if (wq->head) {
+            wq->head->prev = entry;
+        } else {
+            wq->tail = entry;
+        }
+        __atomic_store_n(&wq->head, entry, __ATOMIC_RELAXED);
+    }
+    entry->queued = 1;
+}
+
+// Called with wq->lock held
+static void wq_unlink(wait_queue_head_t* wq, wait_queue_entry_t* entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        __atomic_store_n(&wq->head, entry->next, __ATOMIC_RELAXED);
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        wq->tail = entry->prev;
+    }
+    entry->next = NULL;
+    entry->prev = NULL;
+    entry->queued = 0;
+}
+
+static int autoremove_wake_function(wait_queue_entry_t* entry, unsigned long key) {
+    (void)key;
+    return sched_wake_task(entry->task);
+}
+
+void add_wait_queue(wait_queue_head_t* wq, wait_queue_entry_t* entry) {
+    uint64_t flags;
+    spin_lock_irqsave(&wq->lock, &flags);
+    if (!entry->queued) {
+        entry->flags &= ~WQ_FLAG_EXCLUSIVE;
+        wq_link(wq, entry);
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void add_wait_queue_exclusive(wait_queue_head_t* wq, wait_queue_entry_t* entry) {
+    uint64_t flags;
+    spin_lock_irqsave(&wq->lock, &flags);
+    if (!entry->queued) {
+        entry->flags |= WQ_FLAG_EXCLUSIVE;
+        wq_link(wq, entry);
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void remove_wait_queue(wait_queue_head_t* wq, wait_queue_entry_t* entry) {
+    uint64_t flags;
+    spin_lock_irqsave(&wq->lock, &flags);
+    if (entry->queued) {
+        wq_unlink(wq, entry);
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+static void prepare_to_wait_common(wait_queue_head_t* wq, wait_queue_entry_t* entry,
+                                   int exclusive) {
+    task_t* cur = entry->task;
+    uint64_t flags;
+    spin_lock_irqsave(&wq->lock, &flags);
+    if (!entry->queued) {
+        if (exclusive) {
+            entry->flags |= WQ_FLAG_EXCLUSIVE;
+        } else {
+            entry->flags &= ~WQ_FLAG_EXCLUSIVE;
+        }
+        wq_link(wq, entry);
+    }
+    cur->wait_channel = wq;
+    cur->state = TASK_BLOCKED;
+    spin_unlock_irqrestore(&wq->lock, flags);
+    // Queueing must be visible before the caller tests its condition
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void prepare_to_wait(wait_queue_head_t* wq, wait_queue_entry_t* entry) {
+    prepare_to_wait_common(wq, entry, 0);
+}
+
+void prepare_to_wait_exclusive(wait_queue_head_t* wq, wait_queue_entry_t* entry) {
+    prepare_to_wait_common(wq, entry, 1);
+}
+
+void finish_wait(wait_queue_head_t* wq, wait_queue_entry_t* entry) {
+    task_t* cur = entry->task;
+    uint64_t flags;
+    spin_lock_irqsave(&wq->lock, &flags);
+    // Same lock as the wakers' BLOCKED -> READY transition, so a wakeup
+    // racing with this either lands first or finds the task running
+    spin_lock(&g_task_list_lock);
+    if (cur->state == TASK_BLOCKED) {
+        cur->state = TASK_RUNNING;
+    }
+    cur->wait_channel = NULL;
+    spin_unlock(&g_task_list_lock);
+    if (entry->queued) {
+        wq_unlink(wq, entry);
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+int wake_up_key(wait_queue_head_t* wq, unsigned long key) {
+    if (!waitqueue_active(wq)) {
+        return 0;
+    }
+
+    int woken = 0;
+    uint64_t flags;
+    spin_lock_irqsave(&wq->lock, &flags);
+    wait_queue_entry_t* entry = wq->head;
+    while (entry) {
+        wait_queue_entry_t* next = entry->next;
+        // A default entry lives on the sleeper's stack and may be gone
+        // as soon as its task runs, so it is unlinked before the wakeup
+        int exclusive = entry->flags & WQ_FLAG_EXCLUSIVE;
+        if (entry->func == autoremove_wake_function) {
+            wq_unlink(wq, entry);
+        }
+        int ret = entry->func(entry, key);
+        woken += ret;
+        if (exclusive && ret > 0) {
+            break;
+        }
+        entry = next;
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+    return woken;
+}
@@ -0,0 +1,612 @@
+// LikeOS-64 - Workqueues
+//
+// See include/kernel/workqueue.h for the model.  Each pool keeps a circular
+// worklist under its lock, an idle stack of parked workers, and nr_running:
+// the workers currently executing items and not asleep inside one.  Work is
+// handed out only while nr_running is below max_active (1 for a CPU pool),
+// and wq_worker_sleeping() wakes an idle worker when the last running one
+// blocks with work still queued.
+//
+// Waiters use the repo's wait-channel pattern: idle workers sleep on their
+// worker_t, flush_work()/cancel_*_sync() on the pool and flush_workqueue()
+// on the workqueue.
+
+#include "../../include/kernel/workqueue.h"
+#include "../../include/kernel/sched.h"
+#include "../../include/kernel/percpu.h"
+#include "../../include/kernel/spinlock.h"
+#include "../../include/kernel/smp.h"
+#include "../../include/kernel/console.h"
+#include "../../include/kernel/memory.h"
+
+#define WQ_WORKER_STACK_SIZE    (16 * 1024)
+
+typedef struct worker {
+    task_t* task;
+    struct worker_pool* pool;
+    work_t* current_work;       // Item being run (compared, never dereferenced)
+    struct worker* next_idle;
+    int idle;                   // On pool->idle_list
+    int sleeping;               // Blocked inside a work function
+} worker_t;
+
+typedef struct worker_pool {
+    spinlock_t lock;
+    int cpu;                    // Bound CPU, -1 for the unbound pool
+    work_t worklist;            // Sentinel of the circular worklist
+    worker_t* workers[WQ_MAX_WORKERS];
+    int nr_workers;
+    int nr_running;             // Executing and not asleep
+    int max_active;             // Concurrency target for nr_running
+    worker_t* idle_list;
+    int nr_idle;
+    int creating;               // A worker is spawning a reserve
+    int flush_waiters;          // Tasks in flush_work / cancel_*_sync
+    int next_id;
+} worker_pool_t;
+
+static worker_pool_t g_cpu_pools[MAX_CPUS];
+
+// Ready before workqueue_init(): a CPU pool without workers forwards here,
+// so work queued during early boot waits for the first unbound worker
+static worker_pool_t g_unbound_pool = {
+    .lock = SPINLOCK_INIT("wq_pool_u"),
+    .cpu = -1,
+    .worklist = { .next = &g_unbound_pool.worklist, .prev = &g_unbound_pool.worklist },
+    .max_active = 1,
+};
+
+static workqueue_t g_system_wq = WORKQUEUE_INIT("events", 0);
+static workqueue_t g_system_unbound_wq = WORKQUEUE_INIT("events_unbound", WQ_UNBOUND);
+workqueue_t* system_wq = &g_system_wq;
+workqueue_t* system_unbound_wq = &g_system_unbound_wq;
+
+// Timer wheel: one slot per tick, entries further out than a revolution
+// stay in their slot until expires comes round
+static delayed_work_t* g_wheel[WQ_TIMER_SLOTS];
+static uint64_t g_wheel_now;
+static spinlock_t g_wheel_lock = SPINLOCK_INIT("wq_timer");
+
+// ============================================================================
+// Pool internals (pool->lock held)
+// ============================================================================
+
+static void pool_setup(worker_pool_t* pool, int cpu) {
+    spinlock_init(&pool->lock, "wq_pool");
+    pool->cpu = cpu;
+    pool->worklist.next = pool->worklist.prev = &pool->worklist;
+    pool->max_active = 1;
+}
+
+static void worklist_add(worker_pool_t* pool, work_t* work) {
+    work_t* head = &pool->worklist;
+    work->next = head;
+    work->prev = head->prev;
+    head->prev->next = work;
+    head->prev = work;
+}
+
+static void worklist_del(work_t* work) {
+    work->prev->next = work->next;
+    work->next->prev = work->prev;
+    work->next = work->prev = NULL;
+}
+
+static int worker_executing(worker_pool_t* pool, work_t* work) {
+    for (int i = 0; i < pool->nr_workers; i++) {
+        if (pool->workers[i]->current_work == work)
+            return 1;
+    }
+    return 0;
+}
+
+// First queued item no other worker is running; an instance requeued by
+// its own function waits for that run to end, so a work item never runs
+// concurrently with itself within a pool
+static work_t* worklist_pick(worker_pool_t* pool) {
+    for (work_t* w = pool->worklist.next; w != &pool->worklist; w = w->next) {
+        if (!worker_executing(pool, w))
+            return w;
+    }
+    return NULL;
+}
+
+static worker_t* idle_pop(worker_pool_t* pool) {
+    worker_t* w = pool->idle_list;
+    if (w) {
+        pool->idle_list = w->next_idle;
+        w->next_idle = NULL;
+        w->idle = 0;
+        pool->nr_idle--;
+    }
+    return w;
+}
+
+static void idle_remove(worker_pool_t* pool, worker_t* w) {
+    for (worker_t** pp = &pool->idle_list; *pp; pp = &(*pp)->next_idle) {
+        if (*pp == w) {
+            *pp = w->next_idle;
+            w->next_idle = NULL;
+            w->idle = 0;
+            pool->nr_idle--;
+            return;
+        }
+    }
+}
+
+// An idle worker to start if the pool is below its concurrency target
+static worker_t* pool_want_worker(worker_pool_t* pool) {
+    if (pool->nr_running >= pool->max_active)
+        return NULL;
+    if (pool->worklist.next == &pool->worklist)
+        return NULL;
+    return idle_pop(pool);
+}
+
+static void wq_item_done(workqueue_t* wq) {
+    if (__atomic_sub_fetch(&wq->nr_inflight, 1, __ATOMIC_SEQ_CST) == 0 &&
+        __atomic_load_n(&wq->flush_waiters, __ATOMIC_SEQ_CST))
+        sched_wake_channel(wq);
+}
+
+// ============================================================================
+// Workers
+// ============================================================================
+
+static void worker_main(void* arg);
+
+static void create_worker(worker_pool_t* pool) {
+    worker_t* w = (worker_t*)kalloc(sizeof(worker_t));
+    void* stack = kalloc(WQ_WORKER_STACK_SIZE);
+    if (!w || !stack) {
+        kprintf("workqueue: out of memory for a worker\n");
+        if (w) kfree(w);
+        if (stack) kfree(stack);
+        return;
+    }
+    mm_memset(w, 0, sizeof(worker_t));
+    w->pool = pool;
+
+    uint64_t flags;
+    spin_lock_irqsave(&pool->lock, &flags);
+    if (pool->nr_workers >= WQ_MAX_WORKERS) {
+        spin_unlock_irqrestore(&pool->lock, flags);
+        kfree(stack);
+        kfree(w);
+        return;
+    }
+    int id = pool->next_id++;
+    pool->workers[pool->nr_workers++] = w;
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    task_t* t = sched_add_task(worker_main, w, stack, WQ_WORKER_STACK_SIZE);
+    if (!t) {
+        // Never ran, so nothing else references it yet
+        spin_lock_irqsave(&pool->lock, &flags);
+        for (int i = 0; i < pool->nr_workers; i++) {
+            if (pool->workers[i] == w) {
+                pool->workers[i] = pool->workers[--pool->nr_workers];
+                pool->workers[pool->nr_workers] = NULL;
+                break;
+            }
+        }
+        spin_unlock_irqrestore(&pool->lock, flags);
+        kprintf("workqueue: failed to create a worker\n");
+        kfree(stack);
+        kfree(w);
+        return;
+    }
+    w->task = t;
+    t->wq_worker = w;
+    if (pool->cpu >= 0) {
+        t->on_cpu = (uint32_t)pool->cpu;
+        t->cpu_affinity = 1ULL << pool->cpu;
+        ksnprintf(t->comm, sizeof(t->comm), "kworker/%d:%d", pool->cpu, id);
+    } else {
+        ksnprintf(t->comm, sizeof(t->comm), "kworker/u:%d", id);
+    }
+}
+
+static void worker_main(void* arg) {
+    worker_t* w = (worker_t*)arg;
+    worker_pool_t* pool = w->pool;
+    task_t* self = sched_current();
+    uint64_t flags;
+
+    // May run before create_worker() gets to these
+    w->task = self;
+    self->wq_worker = w;
+
+    spin_lock_irqsave(&pool->lock, &flags);
+    for (;;) {
+        work_t* work = NULL;
+        if (pool->nr_running < pool->max_active)
+            work = worklist_pick(pool);
+
+        if (work) {
+            pool->nr_running++;
+
+            // Leave a worker in reserve so the next item does not have to
+            // wait for this one if it blocks
+            if (!pool->idle_list && !pool->creating &&
+                pool->nr_workers < WQ_MAX_WORKERS) {
+                pool->creating = 1;
+                spin_unlock_irqrestore(&pool->lock, flags);
+                create_worker(pool);
+                spin_lock_irqsave(&pool->lock, &flags);
+                pool->creating = 0;
+                work = worklist_pick(pool);
+            }
+
+            while (work) {
+                worklist_del(work);
+                workqueue_t* wq = work->wq;
+                work_func_t fn = work->func;
+                w->current_work = work;
+                // The function may requeue its own item from here on
+                __atomic_store_n(&work->pending, 0, __ATOMIC_RELEASE);
+                spin_unlock_irqrestore(&pool->lock, flags);
+
+                fn(work);
+
+                spin_lock_irqsave(&pool->lock, &flags);
+                w->current_work = NULL;
+                int waiters = pool->flush_waiters;
+                spin_unlock_irqrestore(&pool->lock, flags);
+                wq_item_done(wq);
+                if (waiters)
+                    sched_wake_channel(pool);
+                spin_lock_irqsave(&pool->lock, &flags);
+
+                // A worker that blocked earlier is running again: leave
+                // the rest to it rather than exceed the concurrency target
+                if (pool->nr_running > pool->max_active)
+                    break;
+                work = worklist_pick(pool);
+            }
+            pool->nr_running--;
+            continue;
+        }
+
+        // Nothing to do: park on the idle list until queue_work picks us
+        w->next_idle = pool->idle_list;
+        pool->idle_list = w;
+        w->idle = 1;
+        pool->nr_idle++;
+        self->wait_channel = w;
+        self->state = TASK_BLOCKED;
+        spin_unlock_irqrestore(&pool->lock, flags);
+
+        sched_schedule();
+        self->wait_channel = NULL;
+
+        spin_lock_irqsave(&pool->lock, &flags);
+        if (w->idle)
+            idle_remove(pool, w);
+    }
+}
+
+// ============================================================================
+// Concurrency management (called by sched_schedule for worker tasks)
+// ============================================================================
+
+void wq_worker_sleeping(task_t* task) {
+    worker_t* w = (worker_t*)task->wq_worker;
+    if (!w || !w->current_work || w->sleeping)
+        return;
+    worker_pool_t* pool = w->pool;
+    uint64_t flags;
+    spin_lock_irqsave(&pool->lock, &flags);
+    w->sleeping = 1;
+    pool->nr_running--;
+    worker_t* wake = pool_want_worker(pool);
+    spin_unlock_irqrestore(&pool->lock, flags);
+    if (wake)
+        sched_wake_channel(wake);
+}
+
+void wq_worker_running(task_t* task) {
+    worker_t* w = (worker_t*)task->wq_worker;
+    if (!w || !w->sleeping)
+        return;
+    worker_pool_t* pool = w->pool;
+    uint64_t flags;
+    spin_lock_irqsave(&pool->lock, &flags);
+    w->sleeping = 0;
+    pool->nr_running++;
+    spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+// ============================================================================
+// Queueing
+// ============================================================================
+
+static int claim_pending(work_t* work) {
+    if (__atomic_load_n(&work->canceling, __ATOMIC_ACQUIRE))
+        return 0;
+    int expected = 0;
+    return __atomic_compare_exchange_n(&work->pending, &expected, 1, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static worker_pool_t* pool_for(workqueue_t* wq, int cpu) {
+    if (wq->flags & WQ_UNBOUND)
+        return &g_unbound_pool;
+    if (cpu < 0 || cpu >= MAX_CPUS)
+        cpu = (int)this_cpu_id();
+    worker_pool_t* pool = &g_cpu_pools[cpu];
+    // A CPU whose pool never got a worker hands its work to the unbound pool
+    return pool->nr_workers ? pool : &g_unbound_pool;
+}
+
+// Put a claimed (pending) item on a pool's worklist
+static int insert_work(workqueue_t* wq, int cpu, work_t* work) {
+    worker_pool_t* pool = pool_for(wq, cpu);
+    uint64_t flags;
+    spin_lock_irqsave(&pool->lock, &flags);
+    // Re-checked under the lock so cancel_work_sync() cannot miss us
+    if (work->canceling) {
+        __atomic_store_n(&work->pending, 0, __ATOMIC_RELEASE);
+        spin_unlock_irqrestore(&pool->lock, flags);
+        return 0;
+    }
+    work->pool = pool;
+    work->wq = wq;
+    __atomic_add_fetch(&wq->nr_inflight, 1, __ATOMIC_SEQ_CST);
+    worklist_add(pool, work);
+    worker_t* wake = pool_want_worker(pool);
+    spin_unlock_irqrestore(&pool->lock, flags);
+    if (wake)
+        sched_wake_channel(wake);
+    return 1;
+}
+
+int queue_work_on(int cpu, workqueue_t* wq, work_t* work) {
+    if (!wq || !work || !work->func)
+        return 0;
+    if (!claim_pending(work))
+        return 0;
+    return insert_work(wq, cpu, work);
+}
+
+int queue_work(workqueue_t* wq, work_t* work) {
+    return queue_work_on(-1, wq, work);
+}
+
+// ============================================================================
+// Delayed work
+// ============================================================================
+
+static void timer_arm_locked(delayed_work_t* dwork, uint64_t delay) {
+    dwork->expires = g_wheel_now + (delay ? delay : 1);
+    delayed_work_t** slot = &g_wheel[dwork->expires & (WQ_TIMER_SLOTS - 1)];
+    dwork->tnext = *slot;
+    if (*slot)
+        (*slot)->tpprev = &dwork->tnext;
+    *slot = dwork;
+    dwork->tpprev = slot;
+}
+
+static void timer_disarm_locked(delayed_work_t* dwork) {
+    *dwork->tpprev = dwork->tnext;
+    if (dwork->tnext)
+        dwork->tnext->tpprev = dwork->tpprev;
+    dwork->tnext = NULL;
+    dwork->tpprev = NULL;
+}
+
+int queue_delayed_work_on(int cpu, workqueue_t* wq, delayed_work_t* dwork, uint64_t delay) {
+    if (!wq || !dwork || !dwork->work.func)
+        return 0;
+    if (delay == 0)
+        return queue_work_on(cpu, wq, &dwork->work);
+    if (!claim_pending(&dwork->work))
+        return 0;
+
+    uint64_t flags;
+    spin_lock_irqsave(&g_wheel_lock, &flags);
+    dwork->wq = wq;
+    dwork->cpu = cpu;
+    timer_arm_locked(dwork, delay);
+    spin_unlock_irqrestore(&g_wheel_lock, flags);
+    return 1;
+}
+
+int queue_delayed_work(workqueue_t* wq, delayed_work_t* dwork, uint64_t delay) {
+    return queue_delayed_work_on(-1, wq, dwork, delay);
+}
+
+int mod_delayed_work(workqueue_t* wq, delayed_work_t* dwork, uint64_t delay) {
+    if (!wq || !dwork)
+        return 0;
+    uint64_t flags;
+    spin_lock_irqsave(&g_wheel_lock, &flags);
+    if (dwork->tpprev) {
+        timer_disarm_locked(dwork);
+        if (delay) {
+            dwork->wq = wq;
+            timer_arm_locked(dwork, delay);
+            spin_unlock_irqrestore(&g_wheel_lock, flags);
+            return 1;
+        }
+        // Due now: hand the pending claim straight to the worklist
+        spin_unlock_irqrestore(&g_wheel_lock, flags);
+        return insert_work(wq, dwork->cpu, &dwork->work);
+    }
+    spin_unlock_irqrestore(&g_wheel_lock, flags);
+    return queue_delayed_work(wq, dwork, delay);
+}
+
+int cancel_delayed_work(delayed_work_t* dwork) {
+    uint64_t flags;
+    int armed = 0;
+    spin_lock_irqsave(&g_wheel_lock, &flags);
+    if (dwork->tpprev) {
+        timer_disarm_locked(dwork);
+        __atomic_store_n(&dwork->work.pending, 0, __ATOMIC_RELEASE);
+        armed = 1;
+    }
+    spin_unlock_irqrestore(&g_wheel_lock, flags);
+    return armed;
+}
+
+void workqueue_timer_tick(uint64_t now) {
+    delayed_work_t* fire = NULL;
+    uint64_t flags;
+
+    spin_lock_irqsave(&g_wheel_lock, &flags);
+    g_wheel_now = now;
+    delayed_work_t* d = g_wheel[now & (WQ_TIMER_SLOTS - 1)];
+    while (d) {
+        delayed_work_t* next = d->tnext;
+        if (d->expires <= now) {
+            timer_disarm_locked(d);
+            d->tnext = fire;
+            fire = d;
+        }
+        d = next;
+    }
+    spin_unlock_irqrestore(&g_wheel_lock, flags);
+
+    while (fire) {
+        delayed_work_t* next = fire->tnext;
+        fire->tnext = NULL;
+        insert_work(fire->wq, fire->cpu, &fire->work);
+        fire = next;
+    }
+}
+
+// ============================================================================
+// Flush and cancel
+// ============================================================================
+
+// Sleep on the pool until a worker finishes an item.  Called and returns
+// with pool->lock held.
+static void pool_wait(worker_pool_t* pool, uint64_t* flags) {
+    task_t* cur = sched_current();
+
+    pool->flush_waiters++;
+    cur->wait_channel = pool;
+    cur->state = TASK_BLOCKED;
+    spin_unlock_irqrestore(&pool->lock, *flags);
+
+    sched_schedule();
+    cur->wait_channel = NULL;
+
+    spin_lock_irqsave(&pool->lock, flags);
+    pool->flush_waiters--;
+}
+
+// Wait until the work is off its pool's worklist and no worker runs it.
+// With `steal` set a queued instance is removed instead of waited for.
+static int work_wait_idle(work_t* work, int steal) {
+    int ret = 0;
+    for (;;) {
+        worker_pool_t* pool = work->pool;
+        if (!pool)
+            return ret;
+        uint64_t flags;
+        spin_lock_irqsave(&pool->lock, &flags);
+        if (pool != work->pool) {
+            spin_unlock_irqrestore(&pool->lock, flags);
+            continue;
+        }
+        if (steal && work->next) {
+            workqueue_t* wq = work->wq;
+            worklist_del(work);
+            __atomic_store_n(&work->pending, 0, __ATOMIC_RELEASE);
+            spin_unlock_irqrestore(&pool->lock, flags);
+            wq_item_done(wq);
+            ret = 1;
+            continue;
+        }
+        if (!work->next && !worker_executing(pool, work)) {
+            spin_unlock_irqrestore(&pool->lock, flags);
+            return ret;
+        }
+        ret = 1;
+        pool_wait(pool, &flags);
+        spin_unlock_irqrestore(&pool->lock, flags);
+    }
+}
+
+int flush_work(work_t* work) {
+    if (!work)
+        return 0;
+    return work_wait_idle(work, 0);
+}
+
+int flush_delayed_work(delayed_work_t* dwork) {
+    if (!dwork)
+        return 0;
+    uint64_t flags;
+    spin_lock_irqsave(&g_wheel_lock, &flags);
+    if (dwork->tpprev) {
+        timer_disarm_locked(dwork);
+        spin_unlock_irqrestore(&g_wheel_lock, flags);
+        insert_work(dwork->wq, dwork->cpu, &dwork->work);
+    } else {
+        spin_unlock_irqrestore(&g_wheel_lock, flags);
+    }
+    return flush_work(&dwork->work);
+}
+
+void flush_workqueue(workqueue_t* wq) {
+    if (!wq)
+        return;
+    task_t* cur = sched_current();
+    __atomic_add_fetch(&wq->flush_waiters, 1, __ATOMIC_SEQ_CST);
+    for (;;) {
+        cur->wait_channel = wq;
+        cur->state = TASK_BLOCKED;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&wq->nr_inflight, __ATOMIC_SEQ_CST) == 0) {
+            cur->state = TASK_RUNNING;
+            cur->wait_channel = NULL;
+            break;
+        }
+        sched_schedule();
+        cur->wait_channel = NULL;
+    }
+    __atomic_sub_fetch(&wq->flush_waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+int cancel_work_sync(work_t* work) {
+    if (!work)
+        return 0;
+    __atomic_add_fetch(&work->canceling, 1, __ATOMIC_SEQ_CST);
+    int ret = work_wait_idle(work, 1);
+    __atomic_sub_fetch(&work->canceling, 1, __ATOMIC_SEQ_CST);
+    return ret;
+}
+
+int cancel_delayed_work_sync(delayed_work_t* dwork) {
+    if (!dwork)
+        return 0;
+    __atomic_add_fetch(&dwork->work.canceling, 1, __ATOMIC_SEQ_CST);
+    int ret = cancel_delayed_work(dwork);
+    ret |= work_wait_idle(&dwork->work, 1);
+    __atomic_sub_fetch(&dwork->work.canceling, 1, __ATOMIC_SEQ_CST);
+    return ret;
+}
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+void workqueue_init(void) {
+    uint32_t ncpus = smp_get_cpu_count();
+    if (ncpus == 0) ncpus = 1;
+    if (ncpus > MAX_CPUS) ncpus = MAX_CPUS;
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++)
+        pool_setup(&g_cpu_pools[cpu], (int)cpu);
+    g_unbound_pool.max_active = (int)ncpus;
+
+    for (uint32_t cpu = 0; cpu < ncpus; cpu++)
+        create_worker(&g_cpu_pools[cpu]);
+    create_worker(&g_unbound_pool);
+
+    kprintf("workqueue: %u CPU pools and an unbound pool (max %d workers each)\n",
+            ncpus, WQ_MAX_WORKERS);
+}
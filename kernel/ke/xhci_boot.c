@@ -7,6 +7,7 @@
 #include "../../include/kernel/console.h"
 #include "../../include/kernel/memory.h"
 #include "../../include/kernel/interrupt.h"
+#include "../../include/kernel/workqueue.h"
 
 // Boot state tracking
 static int g_init_attempted = 0;
@@ -16,6 +17,9 @@ static usb_msd_device_t g_msd_device;
 #define XHCI_BOOT_INIT_TIMEOUT_MS  5000
 #define XHCI_BOOT_POLL_INTERVAL_MS 10
 
+// Hot-plug / event-ring fallback poll period in timer ticks (10 ms at 100 Hz)
+#define XHCI_HOTPLUG_POLL_TICKS    1
+
 // Verify controller is in expected state after initialization
 static int xhci_verify_controller_state(xhci_controller_t* ctrl) {
     if (!ctrl || !ctrl->base) {
@@ -237,3 +241,21 @@ void xhci_boot_poll(xhci_boot_state_t* state) {
 int xhci_boot_is_ready(xhci_boot_state_t* state) {
     return (state && state->msd_ready);
 }
+
+// Runtime hot-plug polling.  Both controllers are handled by one work item
+// so enumeration and disconnect handling never run concurrently; the item
+// runs on an unbound worker because enumeration sleeps on control
+// transfers.
+static void xhci_hotplug_work(work_t* work);
+static delayed_work_t g_xhci_hotplug_work = DELAYED_WORK_INIT(xhci_hotplug_work);
+
+static void xhci_hotplug_work(work_t* work) {
+    (void)work;
+    xhci_hotplug_poll(&g_xhci);
+    xhci_hotplug_poll(&g_xhci_hid);
+    queue_delayed_work(system_unbound_wq, &g_xhci_hotplug_work, XHCI_HOTPLUG_POLL_TICKS);
+}
+
+void xhci_hotplug_start(void) {
+    queue_delayed_work(system_unbound_wq, &g_xhci_hotplug_work, XHCI_HOTPLUG_POLL_TICKS);
+}
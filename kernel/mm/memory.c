@@ -2394,7 +2394,15 @@ uint64_t* mm_clone_address_space(uint64_t* src_pml4) {
                     for (int l = 0; l < 512; l++) {
                         if (!(src_pt[l] & PAGE_PRESENT)) continue;
                         
-                        if (src_pt[l] & PAGE_USER) {
+                        if ((src_pt[l] & (PAGE_USER | PAGE_SHARED)) == (PAGE_USER | PAGE_SHARED)) {
+                            // MAP_SHARED page - both address spaces map it
+                            uint64_t phys_page = src_pt[l] & 0x000FFFFFFFFFF000ULL;
+                            new_pt[l] = src_pt[l];
+                            if (mm_get_page_refcount(phys_page) == 0) {
+                                mm_incref_page(phys_page);
+                            }
+                            mm_incref_page(phys_page);
+                        } else if (src_pt[l] & PAGE_USER) {
                             // User page - share with COW
                             uint64_t phys_page = src_pt[l] & 0x000FFFFFFFFFF000ULL;
                             uint64_t cow_flags = (src_pt[l] & ~PAGE_WRITABLE) | PAGE_COW;
@@ -2534,7 +2542,8 @@ uint64_t* mm_clone_address_space_with_shared(uint64_t* src_pml4,
                         if (src_pt[l] & PAGE_USER) {
                             uint64_t phys_page = src_pt[l] & 0x000FFFFFFFFFF000ULL;
                             
-                            if (is_in_shared_range(vaddr, shared_regions, num_shared)) {
+                            if ((src_pt[l] & PAGE_SHARED) ||
+                                is_in_shared_range(vaddr, shared_regions, num_shared)) {
                                 // Shared region - map same physical page, keep original flags
                                 new_pt[l] = src_pt[l];
                                 // Increment refcount for BOTH parent and child references
@@ -2617,6 +2626,9 @@ extern void syscall_entry(void);
 // Global flag indicating SMAP is active (used by copy_from_user/copy_to_user)
 bool g_smap_enabled = false;
 
+// CPU has fast rep movsb (ERMS); picks the uaccess copy loop
+bool g_cpu_has_erms = false;
+
 // SMAP control: temporarily allow supervisor access to user pages
 void smap_disable(void) {
     if (g_smap_enabled) {
@@ -2654,6 +2666,9 @@ void mm_enable_smep_smap(void) {
     } else {
         g_smap_enabled = false;
     }
+
+    // ERMS: bit 9 of EBX from CPUID
+    g_cpu_has_erms = (ebx & (1 << 9)) != 0;
     
     __asm__ volatile("mov %0, %%cr4" : : "r"(cr4));
 }
@@ -0,0 +1,265 @@
+// LikeOS-64 - User Memory Access
+//
+// See include/kernel/uaccess.h.  The copy loops are rep string
+// instructions: a fault leaves RCX holding the count still to go, so the
+// fixup only has to turn that into bytes.  On CPUs with ERMS a single
+// rep movsb is fastest for all but short copies; otherwise the bulk moves
+// as quadwords with a byte tail.  The kernel is built without SSE
+// (-mgeneral-regs-only, no FPU state saved on kernel entry), so there is
+// no vector copy.
+//
+// The exception table is small and only searched when a fault needs a
+// fixup, so it is scanned linearly rather than sorted at boot.
+//
+// The iov_iter helpers (uio.h) live here too: they are these copies run
+// over a list of buffers.
+
+#include "../../include/kernel/uaccess.h"
+#include "../../include/kernel/uio.h"
+
+extern const exception_table_entry_t __start___ex_table[];
+extern const exception_table_entry_t __stop___ex_table[];
+
+// Below this a rep movsb pays more in startup than it saves
+#define ERMS_COPY_MIN   64
+
+uint64_t search_exception_tables(uint64_t rip) {
+    for (const exception_table_entry_t* e = __start___ex_table; e < __stop___ex_table; e++) {
+        if (e->insn == rip) {
+            return e->fixup;
+        }
+    }
+    return 0;
+}
+
+// Copy with SMAP lifted; returns the number of bytes not copied
+static size_t copy_user_generic(void* dst, const void* src, size_t len) {
+    if (g_cpu_has_erms && len >= ERMS_COPY_MIN) {
+        __asm__ volatile("1: rep movsb\n"
+                         "2:\n"
+                         _ASM_EXTABLE(1b, 2b)
+                         : "+c"(len), "+D"(dst), "+S"(src)
+                         :
+                         : "memory");
+        return len;
+    }
+
+    size_t left = len >> 3;
+    __asm__ volatile("1: rep movsq\n"
+                     "   mov %[tail], %%rcx\n"
+                     "2: rep movsb\n"
+                     "3:\n"
+                     ".pushsection .fixup, \"ax\"\n"
+                     "4: lea (%[tail], %%rcx, 8), %%rcx\n"
+                     "   jmp 3b\n"
+                     ".popsection\n"
+                     _ASM_EXTABLE(1b, 4b)
+                     _ASM_EXTABLE(2b, 3b)
+                     : "+c"(left), "+D"(dst), "+S"(src)
+                     : [tail] "r"(len & 7)
+                     : "memory");
+    return left;
+}
+
+size_t __copy_from_user(void* dst, const void* user_src, size_t len) {
+    smap_disable();
+    size_t left = copy_user_generic(dst, user_src, len);
+    smap_enable();
+    return left;
+}
+
+size_t __copy_to_user(void* user_dst, const void* src, size_t len) {
+    smap_disable();
+    size_t left = copy_user_generic(user_dst, src, len);
+    smap_enable();
+    return left;
+}
+
+int clear_user(void* user_dst, size_t len) {
+    if (!access_ok(user_dst, len)) {
+        return -EFAULT;
+    }
+    smap_disable();
+    __asm__ volatile("1: rep stosb\n"
+                     "2:\n"
+                     _ASM_EXTABLE(1b, 2b)
+                     : "+c"(len), "+D"(user_dst)
+                     : "a"(0)
+                     : "memory");
+    smap_enable();
+    return len ? -EFAULT : 0;
+}
+
+// Scan (and optionally copy) up to count bytes of a user string inside one
+// SMAP window.  The range is clipped to the end of user space, since a
+// short string may sit closer to it than count; running into that end
+// without finding the NUL is a fault.
+static long user_string_op(char* dst, const char* src, long count) {
+    uint64_t addr = (uint64_t)src;
+    long limit = count;
+    if (count <= 0) {
+        return 0;
+    }
+    if (addr < USER_ADDR_MIN || addr >= USER_ADDR_END) {
+        return -EFAULT;
+    }
+    if ((uint64_t)limit > USER_ADDR_END - addr) {
+        limit = (long)(USER_ADDR_END - addr);
+    }
+
+    long i;
+    int err = 0;
+    smap_disable();
+    for (i = 0; i < limit; i++) {
+        uint64_t c;
+        err = __get_user_size(&c, src + i, 1);
+        if (err) {
+            break;
+        }
+        if (dst) {
+            dst[i] = (char)c;
+        }
+        if (!c) {
+            break;
+        }
+    }
+    smap_enable();
+    if (err || (i == limit && limit < count)) {
+        return -EFAULT;
+    }
+    return i;
+}
+
+long strncpy_from_user(char* dst, const char* user_src, long count) {
+    return user_string_op(dst, user_src, count);
+}
+
+long strnlen_user(const char* user_str, long count) {
+    return user_string_op(NULL, user_str, count);
+}
+
+// ============================================================================
+// I/O vector iterators
+// ============================================================================
+
+void iov_iter_init(iov_iter_t* it, const struct iovec* iov, unsigned long nr_segs, size_t count) {
+    it->iov = iov;
+    it->nr_segs = nr_segs;
+    it->iov_offset = 0;
+    it->count = count;
+    // Skip leading empty segments so it->iov always has room when count != 0
+    iov_iter_advance(it, 0);
+}
+
+void iov_iter_advance(iov_iter_t* it, size_t bytes) {
+    if (bytes > it->count) {
+        bytes = it->count;
+    }
+    it->count -= bytes;
+    while (it->nr_segs) {
+        size_t room = it->iov->iov_len - it->iov_offset;
+        if (bytes < room || (room && !bytes)) {
+            it->iov_offset += bytes;
+            return;
+        }
+        bytes -= room;
+        it->iov++;
+        it->nr_segs--;
+        it->iov_offset = 0;
+    }
+}
+
+size_t copy_to_iter(const void* src, size_t len, iov_iter_t* it) {
+    size_t done = 0;
+    if (len > it->count) {
+        len = it->count;
+    }
+    while (done < len) {
+        size_t chunk = it->iov->iov_len - it->iov_offset;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+        size_t left = __copy_to_user((uint8_t*)it->iov->iov_base + it->iov_offset,
+                                     (const uint8_t*)src + done, chunk);
+        iov_iter_advance(it, chunk - left);
+        done += chunk - left;
+        if (left) {
+            break;
+        }
+    }
+    return done;
+}
+
+size_t copy_from_iter(void* dst, size_t len, iov_iter_t* it) {
+    size_t done = 0;
+    if (len > it->count) {
+        len = it->count;
+    }
+    while (done < len) {
+        size_t chunk = it->iov->iov_len - it->iov_offset;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+        size_t left = __copy_from_user((uint8_t*)dst + done,
+                                       (const uint8_t*)it->iov->iov_base + it->iov_offset, chunk);
+        iov_iter_advance(it, chunk - left);
+        done += chunk - left;
+        if (left) {
+            break;
+        }
+    }
+    return done;
+}
+
+long import_iovec(const struct iovec* uvec, unsigned long nr_segs,
+                  struct iovec* fast, struct iovec** iov, iov_iter_t* it) {
+    *iov = fast;
+    if (nr_segs > UIO_MAXIOV) {
+        return -EINVAL;
+    }
+    if (nr_segs == 0) {
+        iov_iter_init(it, fast, 0, 0);
+        return 0;
+    }
+    struct iovec* vec = fast;
+    if (nr_segs > UIO_FASTIOV) {
+        vec = (struct iovec*)kalloc(nr_segs * sizeof(*vec));
+        if (!vec) {
+            return -ENOMEM;
+        }
+    }
+    if (copy_from_user(vec, uvec, nr_segs * sizeof(*vec))) {
+        if (vec != fast) {
+            kfree(vec);
+        }
+        return -EFAULT;
+    }
+
+    // Like Linux, the total is cut at MAX_RW_COUNT by shortening the
+    // segment that crosses it
+    size_t total = 0;
+    for (unsigned long i = 0; i < nr_segs; i++) {
+        size_t len = vec[i].iov_len;
+        if ((long)len < 0) {
+            if (vec != fast) {
+                kfree(vec);
+            }
+            return -EINVAL;
+        }
+        if (len && !access_ok(vec[i].iov_base, len)) {
+            if (vec != fast) {
+                kfree(vec);
+            }
+            return -EFAULT;
+        }
+        if (len > MAX_RW_COUNT - total) {
+            len = MAX_RW_COUNT - total;
+            vec[i].iov_len = len;
+        }
+        total += len;
+    }
+
+    *iov = vec;
+    iov_iter_init(it, vec, nr_segs, total);
+    return (long)total;
+}
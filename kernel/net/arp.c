@@ -20,7 +20,7 @@ typedef struct {
 } arp_entry_t;
 
 static arp_entry_t arp_table[ARP_TABLE_SIZE];
-static spinlock_t arp_lock = SPINLOCK_INIT("arp");
+static rwlock_t arp_lock = RWLOCK_INIT("arp");   // Lookups share, updates exclude
 
 // ============================================================================
 // ARP Pending-skb queue
@@ -148,7 +148,7 @@ static void arp_drain_pending(uint32_t ip, const uint8_t mac[ETH_ALEN]) {
 
 void arp_add_entry(uint32_t ip, const uint8_t mac[ETH_ALEN]) {
     uint64_t flags;
-    spin_lock_irqsave(&arp_lock, &flags);
+    write_lock_irqsave(&arp_lock, &flags);
 
     // Check for existing entry
     int found = 0;
@@ -185,7 +185,7 @@ void arp_add_entry(uint32_t ip, const uint8_t mac[ETH_ALEN]) {
         arp_table[slot].valid = 1;
     }
 
-    spin_unlock_irqrestore(&arp_lock, flags);
+    write_unlock_irqrestore(&arp_lock, flags);
 
     // Drain any pending skbs waiting on this IP (no arp_lock held).
     arp_drain_pending(ip, mac);
@@ -200,18 +200,18 @@ int arp_resolve(net_device_t* dev, uint32_t ip, uint8_t mac_out[ETH_ALEN]) {
     }
 
     uint64_t flags;
-    spin_lock_irqsave(&arp_lock, &flags);
+    read_lock_irqsave(&arp_lock, &flags);
 
     for (int i = 0; i < ARP_TABLE_SIZE; i++) {
         if (arp_table[i].valid && arp_table[i].ip == ip) {
             for (int m = 0; m < ETH_ALEN; m++)
                 mac_out[m] = arp_table[i].mac[m];
-            spin_unlock_irqrestore(&arp_lock, flags);
+            read_unlock_irqrestore(&arp_lock, flags);
             return 0;
         }
     }
 
-    spin_unlock_irqrestore(&arp_lock, flags);
+    read_unlock_irqrestore(&arp_lock, flags);
 
     // Not in cache - send ARP request
     arp_request(dev, ip);
@@ -222,18 +222,18 @@ int arp_resolve(net_device_t* dev, uint32_t ip, uint8_t mac_out[ETH_ALEN]) {
 // Returns 0 on hit, -1 on miss.
 int arp_cache_lookup(uint32_t ip, uint8_t mac_out[ETH_ALEN]) {
     uint64_t flags;
-    spin_lock_irqsave(&arp_lock, &flags);
+    read_lock_irqsave(&arp_lock, &flags);
 
     for (int i = 0; i < ARP_TABLE_SIZE; i++) {
         if (arp_table[i].valid && arp_table[i].ip == ip) {
             for (int m = 0; m < ETH_ALEN; m++)
                 mac_out[m] = arp_table[i].mac[m];
-            spin_unlock_irqrestore(&arp_lock, flags);
+            read_unlock_irqrestore(&arp_lock, flags);
             return 0;
         }
     }
 
-    spin_unlock_irqrestore(&arp_lock, flags);
+    read_unlock_irqrestore(&arp_lock, flags);
     return -1;
 }
 
@@ -315,7 +315,7 @@ void arp_rx(net_device_t* dev, const uint8_t* data, uint16_t len) {
 // Get ARP table entries for userspace
 int net_get_arp_table(net_arp_info_t* entries, int max_entries) {
     uint64_t flags;
-    spin_lock_irqsave(&arp_lock, &flags);
+    read_lock_irqsave(&arp_lock, &flags);
     int count = 0;
     for (int i = 0; i < ARP_TABLE_SIZE && count < max_entries; i++) {
         if (arp_table[i].valid) {
@@ -327,7 +327,7 @@ int net_get_arp_table(net_arp_info_t* entries, int max_entries) {
             count++;
         }
     }
-    spin_unlock_irqrestore(&arp_lock, flags);
+    read_unlock_irqrestore(&arp_lock, flags);
     return count;
 }
 
@@ -363,13 +363,13 @@ int arp_recv_reply(uint32_t target_ip, uint8_t mac_out[6], uint64_t timeout_tick
 // ============================================================================
 void arp_del_entry(uint32_t ip) {
     uint64_t flags;
-    spin_lock_irqsave(&arp_lock, &flags);
+    write_lock_irqsave(&arp_lock, &flags);
     for (int i = 0; i < ARP_TABLE_SIZE; i++) {
         if (arp_table[i].valid && arp_table[i].ip == ip) {
             arp_table[i].valid = 0;
         }
     }
-    spin_unlock_irqrestore(&arp_lock, flags);
+    write_unlock_irqrestore(&arp_lock, flags);
 }
 
 // ============================================================================
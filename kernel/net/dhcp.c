@@ -4,6 +4,7 @@
 #include "../../include/kernel/slab.h"
 #include "../../include/kernel/timer.h"
 #include "../../include/kernel/random.h"
+#include "../../include/kernel/workqueue.h"
 
 // DHCP Message types
 #define DHCP_DISCOVER   1
@@ -58,6 +59,11 @@ static uint32_t dhcp_t1_seconds = 0;            // RFC 2131 §4.4.5: lease/2
 static uint32_t dhcp_t2_seconds = 0;            // 0.875 * lease
 static net_device_t* dhcp_bound_dev = NULL;
 
+// Fires at the next lease deadline (T1, T2 or expiry) while bound
+static void dhcp_lease_timer(work_t* work);
+static delayed_work_t dhcp_lease_work = DELAYED_WORK_INIT(dhcp_lease_timer);
+static void dhcp_arm_lease_timer(void);
+
 // Offset of the variable-length options[] field inside dhcp_packet_t.
 // sizeof(dhcp_packet_t) includes a fixed 312-byte options array, but real
 // DHCP packets may be shorter.  All size checks must use this constant.
@@ -283,6 +289,7 @@ void dhcp_rx(net_device_t* dev, const uint8_t* data, uint16_t len) {
             dhcp_t2_seconds = t2 ? t2 :
                               ((dhcp_lease_seconds * 7) / 8);
             dhcp_lease_start_ticks = timer_ticks();
+            dhcp_arm_lease_timer();
 
             kprintf("[DHCP] Bound to %d.%d.%d.%d",
                     (offered >> 24) & 0xFF, (offered >> 16) & 0xFF,
@@ -388,6 +395,7 @@ int dhcp_release(net_device_t* dev) {
     dev->dns_server = 0;
     dhcp_state = DHCP_STATE_IDLE;
     dhcp_offered_ip = 0;
+    cancel_delayed_work(&dhcp_lease_work);
     
     kprintf("[DHCP] Released IP lease\n");
     return 0;
@@ -448,26 +456,45 @@ void dhcp_invalidate(net_device_t* dev) {
     dhcp_state = DHCP_STATE_IDLE;
     dhcp_offered_ip = 0;
     dhcp_server_ip = 0;
+    cancel_delayed_work(&dhcp_lease_work);
+}
+
+// Timer frequency is TSC-calibrated at boot and is NOT necessarily
+// 100 Hz (e.g. on VMware it lands elsewhere).  Hard-coding 100 here
+// caused T1 (lease/2) to trip far earlier than wall-clock half-lease,
+// making the client RENEW long before the lease was actually half-
+// expired.  Use the real timer rate.
+static uint32_t dhcp_hz(void) {
+    uint32_t hz = timer_get_frequency();
+    return hz ? hz : 100;
+}
+
+// Arm the lease timer for the next deadline of the current state
+static void dhcp_arm_lease_timer(void) {
+    uint32_t deadline;
+    switch (dhcp_state) {
+    case DHCP_STATE_BOUND:     deadline = dhcp_t1_seconds; break;
+    case DHCP_STATE_RENEWING:  deadline = dhcp_t2_seconds; break;
+    case DHCP_STATE_REBINDING: deadline = dhcp_lease_seconds; break;
+    default: return;
+    }
+    uint64_t due = dhcp_lease_start_ticks + (uint64_t)deadline * dhcp_hz();
+    uint64_t now = timer_ticks();
+    mod_delayed_work(system_wq, &dhcp_lease_work, due > now ? due - now : 0);
 }
 
-// RFC 2131 §4.4.5: lease lifecycle.  Called periodically (e.g. once per
-// second) by net_timer_tick.  Drives unicast renewal at T1, broadcast at T2,
-// full re-discovery at lease expiry.
-void dhcp_tick(void) {
+// RFC 2131 §4.4.5: lease lifecycle.  Runs from the lease timer at each
+// deadline.  Drives unicast renewal at T1, broadcast at T2, full
+// re-discovery at lease expiry.
+static void dhcp_lease_timer(work_t* work) {
+    (void)work;
     if (dhcp_state != DHCP_STATE_BOUND &&
         dhcp_state != DHCP_STATE_RENEWING &&
         dhcp_state != DHCP_STATE_REBINDING) return;
     if (!dhcp_bound_dev || dhcp_lease_seconds == 0) return;
 
     uint64_t now = timer_ticks();
-    // Timer frequency is TSC-calibrated at boot and is NOT necessarily
-    // 100 Hz (e.g. on VMware it lands elsewhere).  Hard-coding /100 here
-    // caused T1 (lease/2) to trip far earlier than wall-clock half-lease,
-    // making the client RENEW long before the lease was actually half-
-    // expired.  Use the real timer rate.
-    uint32_t hz = timer_get_frequency();
-    if (hz == 0) hz = 100;
-    uint64_t elapsed = (now - dhcp_lease_start_ticks) / hz;
+    uint64_t elapsed = (now - dhcp_lease_start_ticks) / dhcp_hz();
 
     if (elapsed >= dhcp_lease_seconds) {
         // Lease expired — fall back to DISCOVER
@@ -484,6 +511,7 @@ void dhcp_tick(void) {
         int n = dhcp_build_packet(dhcp_bound_dev, DHCP_REQUEST,
                                   dhcp_offered_ip, 0, pkt, sizeof(pkt));
         if (n > 0) dhcp_send(dhcp_bound_dev, pkt, n);
+        dhcp_arm_lease_timer();
         return;
     }
     if (elapsed >= dhcp_t1_seconds && dhcp_state == DHCP_STATE_BOUND) {
@@ -499,4 +527,5 @@ void dhcp_tick(void) {
                      DHCP_CLIENT_PORT, DHCP_SERVER_PORT,
                      pkt, (uint16_t)n);
     }
+    dhcp_arm_lease_timer();
 }
@@ -49,22 +49,26 @@ int net_register(net_device_t* dev) {
         spin_unlock_irqrestore(&net_registry_lock, flags);
         return -1;
     }
-    net_devices[net_device_num++] = dev;
+    // Fill the slot before publishing the new count; readers index the
+    // registry without the lock and devices are never unregistered
+    net_devices[net_device_num] = dev;
+    __atomic_store_n(&net_device_num, net_device_num + 1, __ATOMIC_RELEASE);
     spin_unlock_irqrestore(&net_registry_lock, flags);
     return 0;
 }
 
 net_device_t* net_get_device(int index) {
-    if (index < 0 || index >= net_device_num) return NULL;
+    if (index < 0 || index >= __atomic_load_n(&net_device_num, __ATOMIC_ACQUIRE))
+        return NULL;
     return net_devices[index];
 }
 
 net_device_t* net_get_default_device(void) {
-    return net_device_num > 0 ? net_devices[0] : NULL;
+    return __atomic_load_n(&net_device_num, __ATOMIC_ACQUIRE) > 0 ? net_devices[0] : NULL;
 }
 
 int net_device_count(void) {
-    return net_device_num;
+    return __atomic_load_n(&net_device_num, __ATOMIC_ACQUIRE);
 }
 
 // Called from acpi_poweroff() before writing SLP_TYP|SLP_EN.  Each NIC
@@ -86,20 +90,10 @@ void net_quiesce_for_poweroff(void) {
     }
 }
 
-// Called from timer IRQ
+// Called from timer IRQ.  DHCP lease deadlines run from their own
+// delayed work (dhcp.c).
 void net_timer_tick(void) {
     tcp_timer_tick();
-    static uint64_t dhcp_last = 0;
-    uint64_t now = timer_ticks();
-    // Timer frequency is TSC-calibrated at boot and is NOT necessarily
-    // 100 Hz (e.g. on VMware it lands elsewhere).  Use the real rate so
-    // dhcp_tick() runs at ~1 Hz wall-time regardless of platform.
-    uint32_t hz = timer_get_frequency();
-    if (hz == 0) hz = 100;
-    if (now - dhcp_last >= hz) {
-        dhcp_last = now;
-        dhcp_tick();
-    }
 }
 
 // Called by NIC driver on packet receive (HARD IRQ context).
@@ -148,10 +142,10 @@ static int         rx_queue_inited = 0;
 // the order they were enqueued by their sender.
 #define NET_RX_CPU 0
 
-// Before percpu_init(), GS base is 0; this_cpu_id() would fault.  In that
-// (BSP-only) window we are always CPU 0.
+// %gs is valid from the start of kernel_main (percpu_early_init); during
+// early init it reads CPU 0.
 static inline uint32_t net_safe_cpu_id(void) {
-    return read_gs_base_msr() ? this_cpu_id() : 0;
+    return this_cpu_id();
 }
 
 static inline int skb_is_loopback(sk_buff_t* skb) {
@@ -1,129 +1,236 @@
-// LikeOS-64 Poll / Select / Epoll Implementation
-// Multiplexed I/O for sockets, pipes, and regular file descriptors
+// LikeOS-64 Poll / Select Implementation
+// Multiplexed I/O for sockets, pipes, and regular file descriptors.
+// fd_entry_poll() is also what epoll (kernel/ke/eventpoll.c) polls with.
 
 #include "../../include/kernel/net.h"
 #include "../../include/kernel/sched.h"
 #include "../../include/kernel/syscall.h"
-#include "../../include/kernel/timer.h"
+#include "../../include/kernel/hrtimer.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/signal.h"
 #include "../../include/kernel/pipe.h"
 #include "../../include/kernel/vfs.h"
 #include "../../include/kernel/tty.h"
 #include "../../include/kernel/devfs.h"
+#include "../../include/kernel/poll.h"
 
 // ============================================================================
-// Epoll instance table
+// Poll wait queues
 // ============================================================================
-epoll_instance_t epoll_instances[MAX_EPOLL_INSTANCES];
-static spinlock_t epoll_lock = SPINLOCK_INIT("epoll");
-
-// Block the calling task until the next timer tick (or `deadline`, whichever
-// comes first).  Used by select/poll/epoll_wait between scan iterations to
-// avoid pegging a CPU at 100% while waiting on FDs that have no kernel-side
-// wake channel registration here.  Without this, tmux (which sits in
-// pselect/poll between every keystroke) keeps a vCPU busy-spinning, and on
-// hypervisors with multiple vCPUs the host CPU becomes overcommitted, making
-// the entire guest feel "very slow even on keystrokes".  10 ms granularity
-// is invisible for interactive workloads.
-static void poll_sleep_until_next_tick(uint64_t deadline_ticks,
-                                       int have_deadline) {
-    task_t* cur = sched_current();
-    if (!cur) {
-        __asm__ volatile("pause");
-        return;
+// select() and poll() hand a poll table to every fd on their first pass, so
+// each fd hooks an entry onto the wait queues that are woken when its
+// readiness changes.  The caller then sleeps until one of those wakeups,
+// its hrtimer timeout or a signal, and re-scans without the table.  The
+// entries stay hooked until the call returns, and each pins the fd entry
+// whose queue it is on, so a thread sharing the fd table that closes the
+// fd meanwhile cannot free the queue under it.
+
+#define POLL_INLINE_ENTRIES 8
+#define POLL_PAGE_SIZE      4096
+
+typedef struct poll_table_entry {
+    wait_queue_entry_t wait;        // private = the poll_wqueues
+    wait_queue_head_t* whead;
+    unsigned long key;              // Events polled for
+    void* file;                     // Reference from fd_entry_get()
+} poll_table_entry_t;
+
+typedef struct poll_table_page {
+    struct poll_table_page* next;
+    int used;
+    poll_table_entry_t entries[];
+} poll_table_page_t;
+
+#define POLL_PAGE_ENTRIES \
+    ((POLL_PAGE_SIZE - sizeof(poll_table_page_t)) / sizeof(poll_table_entry_t))
+
+typedef struct poll_wqueues {
+    poll_table_t pt;
+    task_t* task;
+    int triggered;                  // A hooked queue was woken
+    int error;                      // -ENOMEM if an fd could not be hooked
+    unsigned long key;              // Events of the fd being polled
+    void* file;                     // Entry of the fd being polled
+    int ninline;
+    poll_table_page_t* pages;
+    poll_table_entry_t inline_entries[POLL_INLINE_ENTRIES];
+} poll_wqueues_t;
+
+static int pollwake(wait_queue_entry_t* wait, unsigned long key) {
+    poll_table_entry_t* entry = container_of(wait, poll_table_entry_t, wait);
+    if (key && !(key & entry->key)) {
+        return 0;
+    }
+    poll_wqueues_t* pwq = (poll_wqueues_t*)wait->private;
+    __atomic_store_n(&pwq->triggered, 1, __ATOMIC_RELEASE);
+    return sched_wake_task(pwq->task);
+}
+
+static poll_table_entry_t* poll_get_entry(poll_wqueues_t* pwq) {
+    if (pwq->ninline < POLL_INLINE_ENTRIES) {
+        return &pwq->inline_entries[pwq->ninline++];
     }
-    uint64_t now = timer_ticks();
-    uint64_t wake = now + 1;
-    if (have_deadline && deadline_ticks < wake) {
-        wake = deadline_ticks;
+    poll_table_page_t* page = pwq->pages;
+    if (!page || page->used == (int)POLL_PAGE_ENTRIES) {
+        page = kalloc(POLL_PAGE_SIZE);
+        if (!page) {
+            pwq->error = -ENOMEM;
+            return NULL;
+        }
+        page->used = 0;
+        page->next = pwq->pages;
+        pwq->pages = page;
     }
-    if (wake <= now) {
-        __asm__ volatile("pause");
+    return &page->entries[page->used++];
+}
+
+static void pollwait_queue_proc(wait_queue_head_t* whead, poll_table_t* pt) {
+    poll_wqueues_t* pwq = container_of(pt, poll_wqueues_t, pt);
+    void* file = fd_entry_get(pwq->file);
+    if (!file) {
+        pwq->error = -ENOMEM;
         return;
     }
-    cur->wakeup_tick = wake;
-    cur->state = TASK_BLOCKED;
-    sched_schedule();
-    cur->wakeup_tick = 0;
-    if (cur->state != TASK_RUNNING) cur->state = TASK_RUNNING;
+    poll_table_entry_t* entry = poll_get_entry(pwq);
+    if (!entry) {
+        fd_entry_put(file);
+        return;
+    }
+    init_wait_func_entry(&entry->wait, pollwake, pwq);
+    entry->whead = whead;
+    entry->key = pwq->key;
+    entry->file = file;
+    add_wait_queue(whead, &entry->wait);
 }
 
-// ============================================================================
-// fd_poll_one - Poll a single fd for events (internal helper)
-// Returns revents mask. Works for sockets, pipes, regular files, console.
-// ============================================================================
-static short fd_poll_one(int fd, short events) {
-    task_t* cur = sched_current();
-    if (!cur) return POLLNVAL;
-    if (fd < 0) return POLLNVAL;
-
-    // Check if it's a console fd (0-2 with NULL entry).
-    // /dev/console is bidirectional, so any of fd 0/1/2 may be polled
-    // for both POLLIN and POLLOUT (matches real-tty semantics).
-    if (fd < 3) {
-        short rev = 0;
-        if (events & (POLLIN | POLLRDNORM)) {
-            tty_t* tty = cur->ctty ? cur->ctty : tty_get_console();
-            if (tty && tty->read_count > 0)
-                rev |= POLLIN | POLLRDNORM;
+static void poll_initwait(poll_wqueues_t* pwq) {
+    init_poll_funcptr(&pwq->pt, pollwait_queue_proc);
+    pwq->task = sched_current();
+    pwq->triggered = 0;
+    pwq->error = 0;
+    pwq->key = 0;
+    pwq->file = NULL;
+    pwq->ninline = 0;
+    pwq->pages = NULL;
+}
+
+// Unhook an entry before dropping its pin, which may free the queue
+static void poll_free_entry(poll_table_entry_t* entry) {
+    remove_wait_queue(entry->whead, &entry->wait);
+    fd_entry_put(entry->file);
+}
+
+static void poll_freewait(poll_wqueues_t* pwq) {
+    for (int i = 0; i < pwq->ninline; i++) {
+        poll_free_entry(&pwq->inline_entries[i]);
+    }
+    poll_table_page_t* page = pwq->pages;
+    while (page) {
+        for (int i = 0; i < page->used; i++) {
+            poll_free_entry(&page->entries[i]);
         }
-        if (events & (POLLOUT | POLLWRNORM))
-            rev |= POLLOUT | POLLWRNORM;
-        return rev;
+        poll_table_page_t* next = page->next;
+        kfree(page);
+        page = next;
     }
+}
 
-    if ((unsigned)fd >= TASK_MAX_FDS) return POLLNVAL;
+// Wakeups that matter to a caller polling for `events`, which may name
+// only one of each POLLIN/POLLRDNORM and POLLOUT/POLLWRNORM pair
+static unsigned long poll_key(short events) {
+    unsigned long key = (unsigned short)events | POLLERR | POLLHUP;
+    if (key & (POLLIN | POLLRDNORM))
+        key |= POLLIN | POLLRDNORM;
+    if (key & (POLLOUT | POLLWRNORM))
+        key |= POLLOUT | POLLWRNORM;
+    return key;
+}
 
-    void* entry = cur->fd_table[fd];
+// Arm the timeout of a blocking call; returns false if there is none
+static bool poll_start_timeout(hrtimer_sleeper_t* to, task_t* cur, uint64_t timeout_ns) {
+    if (timeout_ns == 0 || timeout_ns == KTIME_MAX) {
+        return false;
+    }
+    uint64_t now = ktime_get_ns();
+    if (timeout_ns >= KTIME_MAX - now) {
+        return false;
+    }
+    hrtimer_init_sleeper(to, cur);
+    hrtimer_start(&to->timer, now + timeout_ns);
+    return true;
+}
+
+// Sleep until a hooked queue is woken, the timeout fires or a signal comes
+static void poll_schedule(poll_wqueues_t* pwq, hrtimer_sleeper_t* to) {
+    task_t* cur = pwq->task;
+    cur->state = TASK_BLOCKED;
+    // Blocking must be visible before the tests, as in prepare_to_wait()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&pwq->triggered, __ATOMIC_ACQUIRE) && !signal_pending(cur) &&
+        !(to && hrtimer_sleeper_expired(to))) {
+        sched_schedule();
+    }
+
+    uint64_t flags;
+    spin_lock_irqsave(&g_task_list_lock, &flags);
+    if (cur->state == TASK_BLOCKED) {
+        cur->state = TASK_RUNNING;
+    }
+    spin_unlock_irqrestore(&g_task_list_lock, flags);
+    __atomic_store_n(&pwq->triggered, 0, __ATOMIC_RELAXED);
+}
+
+// Readiness of the console or a terminal: always writable, readable when
+// input is queued
+static short tty_poll(tty_t* tty, short events, poll_table_t* pt) {
+    short rev = 0;
+    if (tty) {
+        poll_wait(&tty->read_wq, pt);
+    }
+    if ((events & (POLLIN | POLLRDNORM)) && tty && tty->read_count > 0)
+        rev |= POLLIN | POLLRDNORM;
+    if (events & (POLLOUT | POLLWRNORM))
+        rev |= POLLOUT | POLLWRNORM;
+    return rev;
+}
+
+// ============================================================================
+// fd_entry_poll - Poll an fd table entry for events
+// Returns revents mask.  With a poll table, also hands it every wait queue
+// that is woken when the result may change.  Works for sockets, pipes,
+// files with their own poll op, terminals, regular files and console.
+// ============================================================================
+short fd_entry_poll(void* entry, short events, poll_table_t* pt) {
     if (!entry) return POLLNVAL;
 
     // Socket fd marker
     if (IS_SOCKET_FD(entry)) {
-        return (short)sock_poll(SOCKET_FD_IDX(entry), events);
+        return (short)sock_poll(SOCKET_FD_IDX(entry), events, pt);
     }
 
     // UNIX socket fd marker
     if (IS_UNIX_SOCKET_FD(entry)) {
-        return (short)unix_poll((int)(uintptr_t)entry, events);
-    }
-
-    // Epoll fd marker
-    if (IS_EPOLL_FD(entry)) {
-        // Epoll fds are not themselves pollable in a meaningful way
-        return POLLNVAL;
+        return (short)unix_poll((int)(uintptr_t)entry, events, pt);
     }
 
     // Console dup markers (1, 2, 3) — all reference the bidirectional
     // /dev/console device, so each is both readable and writable.
     uintptr_t marker = (uintptr_t)entry;
     if (marker >= 1 && marker <= 3) {
-        short rev = 0;
-        if (events & (POLLIN | POLLRDNORM)) {
-            tty_t* tty = cur->ctty ? cur->ctty : tty_get_console();
-            if (tty && tty->read_count > 0)
-                rev |= POLLIN | POLLRDNORM;
-        }
-        if (events & (POLLOUT | POLLWRNORM))
-            rev |= POLLOUT | POLLWRNORM;
-        return rev;
+        task_t* cur = sched_current();
+        tty_t* tty = cur && cur->ctty ? cur->ctty : tty_get_console();
+        return tty_poll(tty, events, pt);
     }
 
     // Pipe fd
-    if (pipe_is_end(entry)) {
-        pipe_end_t* pe = (pipe_end_t*)entry;
-        pipe_t* p = pe->pipe;
-        short rev = 0;
-        if (pe->is_read) {
-            if ((events & (POLLIN | POLLRDNORM)) && p->used > 0)
-                rev |= POLLIN | POLLRDNORM;
-            if (p->writers == 0)
-                rev |= POLLHUP;
-        } else {
-            if ((events & (POLLOUT | POLLWRNORM)) && p->used < p->size)
-                rev |= POLLOUT | POLLWRNORM;
-            if (p->readers == 0)
-                rev |= POLLERR;
-        }
-        return rev;
+    if (pipe_is_end(entry))
+        return pipe_poll((pipe_end_t*)entry, events, pt);
+
+    // Files with their own readiness (eventfd, timerfd, epoll)
+    {
+        vfs_file_t* f = (vfs_file_t*)entry;
+        if (f->ops && f->ops->poll)
+            return f->ops->poll(f, events, pt);
     }
 
     // Pty master (opened via /dev/ptmx): readable when slave wrote bytes,
@@ -131,20 +238,14 @@ static short fd_poll_one(int fd, short events) {
     {
         int pid = devfs_get_pty_master_id((vfs_file_t*)entry);
         if (pid >= 0)
-            return (short)tty_pty_master_poll(pid, events);
+            return (short)tty_pty_master_poll(pid, events, pt);
     }
 
-    // Tty/pty-slave (real terminal): always writable, readable when input is queued.
+    // Tty/pty-slave (real terminal)
     {
         tty_t* tty = devfs_get_tty((vfs_file_t*)entry);
-        if (tty) {
-            short rev = 0;
-            if ((events & (POLLIN | POLLRDNORM)) && tty->read_count > 0)
-                rev |= POLLIN | POLLRDNORM;
-            if (events & (POLLOUT | POLLWRNORM))
-                rev |= POLLOUT | POLLWRNORM;
-            return rev;
-        }
+        if (tty)
+            return tty_poll(tty, events, pt);
     }
 
     // Regular file - always ready for read/write
@@ -156,31 +257,134 @@ static short fd_poll_one(int fd, short events) {
     return rev;
 }
 
+// ============================================================================
+// fd_entry_get / fd_entry_put - Pin an fd table entry
+// fd_entry_get() takes a reference as dup() would and returns what to hand
+// fd_entry_put(): the entry itself, or for a pipe a new end of it.  NULL
+// means the entry is gone or a pipe end could not be allocated.
+// ============================================================================
+void* fd_entry_get(void* entry) {
+    if (!entry) return NULL;
+
+    if (IS_SOCKET_FD(entry)) {
+        net_socket_t* s = sock_get(SOCKET_FD_IDX(entry));
+        if (!s) return NULL;
+        __atomic_fetch_add(&s->ref_count, 1, __ATOMIC_ACQ_REL);
+        return entry;
+    }
+
+    if (IS_UNIX_SOCKET_FD(entry)) {
+        unix_socket_t* us = unix_get((int)(uintptr_t)entry);
+        if (!us) return NULL;
+        __atomic_fetch_add(&us->ref_count, 1, __ATOMIC_ACQ_REL);
+        return entry;
+    }
+
+    // Console dup markers name a terminal that is never freed
+    uintptr_t marker = (uintptr_t)entry;
+    if (marker >= 1 && marker <= 3)
+        return entry;
+
+    if (pipe_is_end(entry))
+        return pipe_dup_end((pipe_end_t*)entry);
+
+    return vfs_dup((vfs_file_t*)entry);
+}
+
+void fd_entry_put(void* ref) {
+    if (!ref) return;
+
+    if (IS_SOCKET_FD(ref)) {
+        sock_close(SOCKET_FD_IDX(ref));
+        return;
+    }
+
+    if (IS_UNIX_SOCKET_FD(ref)) {
+        unix_close((int)(uintptr_t)ref);
+        return;
+    }
+
+    uintptr_t marker = (uintptr_t)ref;
+    if (marker >= 1 && marker <= 3)
+        return;
+
+    if (pipe_is_end(ref)) {
+        pipe_close_end((pipe_end_t*)ref);
+        return;
+    }
+
+    vfs_close((vfs_file_t*)ref);
+}
+
+// ============================================================================
+// fd_get / fd_poll_one - Pin or poll a single fd of the current task
+// fd_get() returns a reference for fd_entry_put(), or NULL as
+// fd_entry_get(); fd_poll_one() returns the revents mask.
+// ============================================================================
+
+// The fd table entry of fd, or NULL if there is none
+static void* fd_lookup(task_t* cur, int fd) {
+    if (fd < 0 || (unsigned)fd >= TASK_MAX_FDS) return NULL;
+
+    void* entry = cur->fd_table[fd];
+    // fds 0-2 with a NULL entry are the console; /dev/console is
+    // bidirectional, so each may be polled for both POLLIN and POLLOUT
+    if (!entry && fd < 3)
+        entry = (void*)(uintptr_t)(fd + 1);
+    return entry;
+}
+
+static short fd_poll_table(task_t* cur, int fd, short events, poll_table_t* pt) {
+    return fd_entry_poll(fd_lookup(cur, fd), events, pt);
+}
+
+void* fd_get(int fd) {
+    task_t* cur = sched_current();
+    if (!cur) return NULL;
+    return fd_entry_get(fd_lookup(cur, fd));
+}
+
+short fd_poll_one(int fd, short events) {
+    task_t* cur = sched_current();
+    if (!cur) return POLLNVAL;
+    return fd_poll_table(cur, fd, events, NULL);
+}
+
+// Poll one fd for select/poll, hooking its queues onto the table if given
+static short poll_one(poll_wqueues_t* pwq, int fd, short events, poll_table_t* pt) {
+    pwq->key = poll_key(events);
+    // pollwait_queue_proc() pins this entry for each queue it hooks
+    pwq->file = fd_lookup(pwq->task, fd);
+    return fd_entry_poll(pwq->file, events, pt);
+}
+
 // ============================================================================
 // sys_select_internal - select() implementation
 // Scans readfds/writefds/exceptfds for ready file descriptors.
-// timeout_ticks: 0 = poll (non-blocking), (uint64_t)-1 = block forever
+// timeout_ns: 0 = poll (non-blocking), KTIME_MAX = block forever
 // Returns number of ready fds, or negative errno.
 // ============================================================================
 int sys_select_internal(int nfds, fd_set* readfds, fd_set* writefds,
-                        fd_set* exceptfds, uint64_t timeout_ticks) {
+                        fd_set* exceptfds, uint64_t timeout_ns) {
     if (nfds < 0 || nfds > FD_SETSIZE) return -EINVAL;
+    task_t* cur = sched_current();
+    if (!cur) return -EINVAL;
 
     fd_set r_in, w_in, e_in;
     if (readfds) r_in = *readfds; else FD_ZERO(&r_in);
     if (writefds) w_in = *writefds; else FD_ZERO(&w_in);
     if (exceptfds) e_in = *exceptfds; else FD_ZERO(&e_in);
 
-    uint64_t deadline = 0;
-    if (timeout_ticks == 0) {
-        // Non-blocking poll
-    } else if (timeout_ticks != (uint64_t)-1) {
-        deadline = timer_ticks() + timeout_ticks;
-    }
+    poll_wqueues_t table;
+    poll_initwait(&table);
+    poll_table_t* pt = timeout_ns ? &table.pt : NULL;
+    hrtimer_sleeper_t to;
+    bool timed = poll_start_timeout(&to, cur, timeout_ns);
 
+    fd_set r_out, w_out, e_out;
+    int count;
     while (1) {
-        int count = 0;
-        fd_set r_out, w_out, e_out;
+        count = 0;
         FD_ZERO(&r_out);
         FD_ZERO(&w_out);
         FD_ZERO(&e_out);
@@ -193,7 +397,7 @@ int sys_select_internal(int nfds, fd_set* readfds, fd_set* writefds,
 
             if (events == 0) continue;
 
-            short rev = fd_poll_one(fd, events);
+            short rev = poll_one(&table, fd, events, pt);
 
             if ((rev & (POLLIN | POLLRDNORM | POLLHUP | POLLERR)) &&
                 readfds && FD_ISSET(fd, &r_in)) {
@@ -210,223 +414,85 @@ int sys_select_internal(int nfds, fd_set* readfds, fd_set* writefds,
                 FD_SET(fd, &e_out);
                 count++;
             }
+            // Nothing to wait for once something is ready
+            if (count) pt = NULL;
         }
+        pt = NULL;
 
-        if (count > 0 || timeout_ticks == 0) {
-            if (readfds) *readfds = r_out;
-            if (writefds) *writefds = w_out;
-            if (exceptfds) *exceptfds = e_out;
-            return count;
+        if (count > 0 || timeout_ns == 0 || (timed && hrtimer_sleeper_expired(&to)))
+            break;
+        if (table.error) {
+            count = table.error;
+            break;
         }
-
-        // Block until deadline or forever
-        if (timeout_ticks != (uint64_t)-1 && timer_ticks() >= deadline) {
-            if (readfds) FD_ZERO(readfds);
-            if (writefds) FD_ZERO(writefds);
-            if (exceptfds) FD_ZERO(exceptfds);
-            return 0;
+        if (signal_pending(cur)) {
+            count = -EINTR;
+            break;
         }
+        poll_schedule(&table, timed ? &to : NULL);
+    }
 
-        poll_sleep_until_next_tick(deadline, timeout_ticks != (uint64_t)-1);
+    if (count >= 0) {
+        if (readfds) *readfds = r_out;
+        if (writefds) *writefds = w_out;
+        if (exceptfds) *exceptfds = e_out;
     }
+    if (timed) hrtimer_cancel(&to.timer);
+    poll_freewait(&table);
+    return count;
 }
 
 // ============================================================================
 // sys_poll_internal - poll() implementation
 // Scans array of pollfd structs for ready fds.
-// timeout_ticks: 0 = non-blocking, (uint64_t)-1 = block forever
+// timeout_ns: 0 = non-blocking, KTIME_MAX = block forever
 // Returns number of ready fds, or negative errno.
 // ============================================================================
-int sys_poll_internal(struct pollfd* fds, int nfds, uint64_t timeout_ticks) {
+int sys_poll_internal(struct pollfd* fds, int nfds, uint64_t timeout_ns) {
     if (nfds < 0 || !fds) return -EINVAL;
+    task_t* cur = sched_current();
+    if (!cur) return -EINVAL;
 
-    uint64_t deadline = 0;
-    if (timeout_ticks == 0) {
-        // Non-blocking poll
-    } else if (timeout_ticks != (uint64_t)-1) {
-        deadline = timer_ticks() + timeout_ticks;
-    }
+    poll_wqueues_t table;
+    poll_initwait(&table);
+    poll_table_t* pt = timeout_ns ? &table.pt : NULL;
+    hrtimer_sleeper_t to;
+    bool timed = poll_start_timeout(&to, cur, timeout_ns);
 
+    int count;
     while (1) {
-        int count = 0;
+        count = 0;
 
         for (int i = 0; i < nfds; i++) {
-            fds[i].revents = fd_poll_one(fds[i].fd, fds[i].events);
-            if (fds[i].revents != 0)
+            // Negative fds are skipped, as POSIX allows to disable entries
+            if (fds[i].fd < 0) {
+                fds[i].revents = 0;
+                continue;
+            }
+            fds[i].revents = poll_one(&table, fds[i].fd, fds[i].events, pt);
+            // POLLERR, POLLHUP and POLLNVAL are reported unasked
+            fds[i].revents &= fds[i].events | POLLERR | POLLHUP | POLLNVAL;
+            if (fds[i].revents != 0) {
                 count++;
+                pt = NULL;
+            }
         }
+        pt = NULL;
 
-        if (count > 0 || timeout_ticks == 0)
-            return count;
-
-        if (timeout_ticks != (uint64_t)-1 && timer_ticks() >= deadline)
-            return 0;
-
-        poll_sleep_until_next_tick(deadline, timeout_ticks != (uint64_t)-1);
-    }
-}
-
-// ============================================================================
-// Epoll implementation
-// ============================================================================
-
-int epoll_create_internal(int flags) {
-    (void)flags;
-    uint64_t fl;
-    spin_lock_irqsave(&epoll_lock, &fl);
-
-    int idx = -1;
-    for (int i = 0; i < MAX_EPOLL_INSTANCES; i++) {
-        if (!epoll_instances[i].active) {
-            idx = i;
+        if (count > 0 || timeout_ns == 0 || (timed && hrtimer_sleeper_expired(&to)))
+            break;
+        if (table.error) {
+            count = table.error;
             break;
         }
-    }
-
-    if (idx < 0) {
-        spin_unlock_irqrestore(&epoll_lock, fl);
-        return -ENFILE;
-    }
-
-    epoll_instance_t* ep = &epoll_instances[idx];
-    ep->active = 1;
-    ep->nentries = 0;
-    ep->lock = (spinlock_t)SPINLOCK_INIT("epoll_inst");
-
-    spin_unlock_irqrestore(&epoll_lock, fl);
-    return idx;
-}
-
-int epoll_ctl_internal(int epfd_idx, int op, int fd, struct epoll_event* event) {
-    if (epfd_idx < 0 || epfd_idx >= MAX_EPOLL_INSTANCES) return -EBADF;
-    epoll_instance_t* ep = &epoll_instances[epfd_idx];
-    if (!ep->active) return -EBADF;
-
-    uint64_t fl;
-    spin_lock_irqsave(&ep->lock, &fl);
-
-    switch (op) {
-    case EPOLL_CTL_ADD: {
-        if (!event) { spin_unlock_irqrestore(&ep->lock, fl); return -EINVAL; }
-        // Check for duplicate
-        for (int i = 0; i < ep->nentries; i++) {
-            if (ep->entries[i].fd == fd) {
-                spin_unlock_irqrestore(&ep->lock, fl);
-                return -EEXIST;
-            }
-        }
-        if (ep->nentries >= MAX_EPOLL_ENTRIES) {
-            spin_unlock_irqrestore(&ep->lock, fl);
-            return -ENOMEM;
-        }
-        int idx = ep->nentries++;
-        ep->entries[idx].fd = fd;
-        ep->entries[idx].events = event->events;
-        ep->entries[idx].data = event->data.u64;
-        ep->entries[idx].oneshot_triggered = 0;
-        break;
-    }
-    case EPOLL_CTL_DEL: {
-        int found = -1;
-        for (int i = 0; i < ep->nentries; i++) {
-            if (ep->entries[i].fd == fd) { found = i; break; }
-        }
-        if (found < 0) {
-            spin_unlock_irqrestore(&ep->lock, fl);
-            return -ENOENT;
-        }
-        // Shift entries down
-        for (int i = found; i < ep->nentries - 1; i++)
-            ep->entries[i] = ep->entries[i + 1];
-        ep->nentries--;
-        break;
-    }
-    case EPOLL_CTL_MOD: {
-        if (!event) { spin_unlock_irqrestore(&ep->lock, fl); return -EINVAL; }
-        int found = -1;
-        for (int i = 0; i < ep->nentries; i++) {
-            if (ep->entries[i].fd == fd) { found = i; break; }
-        }
-        if (found < 0) {
-            spin_unlock_irqrestore(&ep->lock, fl);
-            return -ENOENT;
+        if (signal_pending(cur)) {
+            count = -EINTR;
+            break;
         }
-        ep->entries[found].events = event->events;
-        ep->entries[found].data = event->data.u64;
-        ep->entries[found].oneshot_triggered = 0;
-        break;
-    }
-    default:
-        spin_unlock_irqrestore(&ep->lock, fl);
-        return -EINVAL;
+        poll_schedule(&table, timed ? &to : NULL);
     }
 
-    spin_unlock_irqrestore(&ep->lock, fl);
-    return 0;
-}
-
-int epoll_wait_internal(int epfd_idx, struct epoll_event* events,
-                        int maxevents, uint64_t timeout_ticks) {
-    if (epfd_idx < 0 || epfd_idx >= MAX_EPOLL_INSTANCES) return -EBADF;
-    epoll_instance_t* ep = &epoll_instances[epfd_idx];
-    if (!ep->active) return -EBADF;
-    if (maxevents <= 0 || !events) return -EINVAL;
-
-    uint64_t deadline = 0;
-    if (timeout_ticks == 0) {
-        // Non-blocking
-    } else if (timeout_ticks != (uint64_t)-1) {
-        deadline = timer_ticks() + timeout_ticks;
-    }
-
-    while (1) {
-        int count = 0;
-
-        uint64_t fl;
-        spin_lock_irqsave(&ep->lock, &fl);
-
-        for (int i = 0; i < ep->nentries && count < maxevents; i++) {
-            if (ep->entries[i].oneshot_triggered &&
-                (ep->entries[i].events & EPOLLONESHOT))
-                continue;
-
-            short poll_events = 0;
-            if (ep->entries[i].events & (EPOLLIN | EPOLLRDNORM))
-                poll_events |= POLLIN;
-            if (ep->entries[i].events & (EPOLLOUT | EPOLLWRNORM))
-                poll_events |= POLLOUT;
-            if (ep->entries[i].events & EPOLLPRI)
-                poll_events |= POLLPRI;
-
-            short rev = fd_poll_one(ep->entries[i].fd, poll_events);
-            if (rev == 0) continue;
-
-            uint32_t ep_events = 0;
-            if (rev & (POLLIN | POLLRDNORM)) ep_events |= EPOLLIN;
-            if (rev & (POLLOUT | POLLWRNORM)) ep_events |= EPOLLOUT;
-            if (rev & POLLERR) ep_events |= EPOLLERR;
-            if (rev & POLLHUP) ep_events |= EPOLLHUP;
-            if (rev & POLLPRI) ep_events |= EPOLLPRI;
-
-            ep_events &= (ep->entries[i].events | EPOLLERR | EPOLLHUP);
-            if (ep_events == 0) continue;
-
-            events[count].events = ep_events;
-            events[count].data.u64 = ep->entries[i].data;
-            count++;
-
-            if (ep->entries[i].events & EPOLLONESHOT)
-                ep->entries[i].oneshot_triggered = 1;
-        }
-
-        spin_unlock_irqrestore(&ep->lock, fl);
-
-        if (count > 0 || timeout_ticks == 0)
-            return count;
-
-        if (timeout_ticks != (uint64_t)-1 && timer_ticks() >= deadline)
-            return 0;
-
-        poll_sleep_until_next_tick(deadline, timeout_ticks != (uint64_t)-1);
-    }
+    if (timed) hrtimer_cancel(&to.timer);
+    poll_freewait(&table);
+    return count;
 }
@@ -2,10 +2,18 @@
 //
 // Static routing table with longest-prefix-match lookup.
 // Populated by DHCP and ioctl (SIOCADDRT/SIOCDELRT).
+//
+// The table is an immutable snapshot published through an RCU pointer.
+// Entries are kept sorted by prefix length (longest first) and then by
+// metric, so a lookup is a lock-free scan that stops at the first match.
+// Writers serialize on route_lock, build a modified copy, publish it and
+// free the old snapshot after a grace period.
 
 #include "../../include/kernel/net.h"
 #include "../../include/kernel/console.h"
 #include "../../include/kernel/syscall.h"
+#include "../../include/kernel/memory.h"
+#include "../../include/kernel/rcu.h"
 
 // Route flags
 #define RTF_UP      0x0001  // Route is usable
@@ -22,10 +30,17 @@ typedef struct {
     net_device_t* dev;      // Output device
     uint32_t metric;        // Route metric (lower = preferred)
     uint16_t flags;         // RTF_* flags
-    int active;             // Entry in use
+    int prefix;             // Prefix length of netmask
 } rt_entry_t;
 
-static rt_entry_t route_table[MAX_ROUTES];
+typedef struct {
+    rcu_head_t rcu;
+    int count;
+    rt_entry_t entries[MAX_ROUTES];
+} rt_table_t;
+
+static rt_table_t route_empty;
+static rt_table_t* route_table = &route_empty;
 static spinlock_t route_lock = SPINLOCK_INIT("route");
 
 // Count set bits in netmask (prefix length)
@@ -38,144 +53,173 @@ static int mask_len(uint32_t mask) {
     return bits;
 }
 
+// Lookup order: longer prefix first, then lower metric
+static int rt_before(const rt_entry_t* a, const rt_entry_t* b) {
+    if (a->prefix != b->prefix)
+        return a->prefix > b->prefix;
+    return a->metric < b->metric;
+}
+
+// Insertion sort; the table holds at most MAX_ROUTES entries
+static void rt_sort(rt_table_t* t) {
+    for (int i = 1; i < t->count; i++) {
+        rt_entry_t e = t->entries[i];
+        int j = i - 1;
+        while (j >= 0 && rt_before(&e, &t->entries[j])) {
+            t->entries[j + 1] = t->entries[j];
+            j--;
+        }
+        t->entries[j + 1] = e;
+    }
+}
+
+static void rt_table_free_rcu(rcu_head_t* head) {
+    kfree(container_of(head, rt_table_t, rcu));
+}
+
+// Publish a new snapshot (caller holds route_lock) and retire the old one
+static void rt_publish_locked(rt_table_t* t) {
+    rt_table_t* old = route_table;
+    rt_sort(t);
+    rcu_assign_pointer(route_table, t);
+    if (old != &route_empty)
+        call_rcu(&old->rcu, rt_table_free_rcu);
+}
+
 void route_init(void) {
-    for (int i = 0; i < MAX_ROUTES; i++)
-        route_table[i].active = 0;
+    route_empty.count = 0;
+    route_table = &route_empty;
 }
 
 int route_add(uint32_t dst_net, uint32_t netmask, uint32_t gateway,
               net_device_t* dev, uint32_t metric, uint16_t flags) {
+    rt_table_t* t = (rt_table_t*)kalloc(sizeof(rt_table_t));
+    if (!t)
+        return -ENOMEM;
+
     uint64_t fl;
     spin_lock_irqsave(&route_lock, &fl);
 
-    // Check for duplicate
-    for (int i = 0; i < MAX_ROUTES; i++) {
-        if (route_table[i].active &&
-            route_table[i].dst_net == dst_net &&
-            route_table[i].netmask == netmask) {
-            // Update existing route
-            route_table[i].gateway = gateway;
-            route_table[i].dev = dev;
-            route_table[i].metric = metric;
-            route_table[i].flags = flags;
-            spin_unlock_irqrestore(&route_lock, fl);
-            return 0;
+    rt_table_t* cur = route_table;
+    t->count = cur->count;
+    for (int i = 0; i < cur->count; i++)
+        t->entries[i] = cur->entries[i];
+
+    // Update an existing route, or append a new one
+    rt_entry_t* e = NULL;
+    for (int i = 0; i < t->count; i++) {
+        if (t->entries[i].dst_net == dst_net &&
+            t->entries[i].netmask == netmask) {
+            e = &t->entries[i];
+            break;
         }
     }
-
-    // Find free slot
-    for (int i = 0; i < MAX_ROUTES; i++) {
-        if (!route_table[i].active) {
-            route_table[i].dst_net = dst_net;
-            route_table[i].netmask = netmask;
-            route_table[i].gateway = gateway;
-            route_table[i].dev = dev;
-            route_table[i].metric = metric;
-            route_table[i].flags = flags;
-            route_table[i].active = 1;
+    if (!e) {
+        if (t->count >= MAX_ROUTES) {
             spin_unlock_irqrestore(&route_lock, fl);
-            return 0;
+            kfree(t);
+            return -ENOSPC;
         }
+        e = &t->entries[t->count++];
+        e->dst_net = dst_net;
+        e->netmask = netmask;
+        e->prefix = mask_len(netmask);
     }
+    e->gateway = gateway;
+    e->dev = dev;
+    e->metric = metric;
+    e->flags = flags;
 
+    rt_publish_locked(t);
     spin_unlock_irqrestore(&route_lock, fl);
-    return -ENOSPC;
+    return 0;
 }
 
 int route_del(uint32_t dst_net, uint32_t netmask, uint32_t gateway) {
+    rt_table_t* t = (rt_table_t*)kalloc(sizeof(rt_table_t));
+    if (!t)
+        return -ENOMEM;
+
     uint64_t fl;
     spin_lock_irqsave(&route_lock, &fl);
 
-    for (int i = 0; i < MAX_ROUTES; i++) {
-        if (route_table[i].active &&
-            route_table[i].dst_net == dst_net &&
-            route_table[i].netmask == netmask &&
-            (gateway == 0 || route_table[i].gateway == gateway)) {
-            route_table[i].active = 0;
-            spin_unlock_irqrestore(&route_lock, fl);
-            return 0;
+    rt_table_t* cur = route_table;
+    int found = 0;
+    t->count = 0;
+    for (int i = 0; i < cur->count; i++) {
+        const rt_entry_t* e = &cur->entries[i];
+        if (!found && e->dst_net == dst_net && e->netmask == netmask &&
+            (gateway == 0 || e->gateway == gateway)) {
+            found = 1;
+            continue;
         }
+        t->entries[t->count++] = *e;
+    }
+
+    if (!found) {
+        spin_unlock_irqrestore(&route_lock, fl);
+        kfree(t);
+        return -ESRCH;
     }
 
+    rt_publish_locked(t);
     spin_unlock_irqrestore(&route_lock, fl);
-    return -ESRCH;
+    return 0;
 }
 
 // Longest-prefix-match route lookup
 // Returns: device to use, and sets *next_hop_out to the next-hop IP
 net_device_t* route_lookup(uint32_t dst_ip, uint32_t* next_hop_out) {
-    uint64_t fl;
-    spin_lock_irqsave(&route_lock, &fl);
-
-    int best = -1;
-    int best_prefix = -1;
-    uint32_t best_metric = 0xFFFFFFFF;
-
-    for (int i = 0; i < MAX_ROUTES; i++) {
-        if (!route_table[i].active) continue;
-        if (!(route_table[i].flags & RTF_UP)) continue;
-        if (route_table[i].flags & RTF_REJECT) continue;
-
-        if ((dst_ip & route_table[i].netmask) == route_table[i].dst_net) {
-            int prefix = mask_len(route_table[i].netmask);
-            if (prefix > best_prefix ||
-                (prefix == best_prefix && route_table[i].metric < best_metric)) {
-                best = i;
-                best_prefix = prefix;
-                best_metric = route_table[i].metric;
-            }
+    net_device_t* dev = NULL;
+    uint32_t next_hop = dst_ip;
+
+    rcu_read_lock();
+    rt_table_t* t = rcu_dereference(route_table);
+    for (int i = 0; i < t->count; i++) {
+        const rt_entry_t* e = &t->entries[i];
+        if (!(e->flags & RTF_UP)) continue;
+        if (e->flags & RTF_REJECT) continue;
+
+        if ((dst_ip & e->netmask) == e->dst_net) {
+            // Sorted table: the first match is the best one
+            dev = e->dev;
+            if (e->flags & RTF_GATEWAY)
+                next_hop = e->gateway;
+            break;
         }
     }
+    rcu_read_unlock();
 
-    if (best < 0) {
-        spin_unlock_irqrestore(&route_lock, fl);
-        if (next_hop_out) *next_hop_out = dst_ip;
-        return NULL;
-    }
-
-    net_device_t* dev = route_table[best].dev;
-    if (next_hop_out) {
-        if (route_table[best].flags & RTF_GATEWAY)
-            *next_hop_out = route_table[best].gateway;
-        else
-            *next_hop_out = dst_ip;
-    }
-
-    spin_unlock_irqrestore(&route_lock, fl);
+    if (next_hop_out) *next_hop_out = next_hop;
     return dev;
 }
 
 // Get route table entries (for /proc/net/route style display or ioctl)
 int route_get_table(rt_entry_t* entries, int max_entries) {
-    uint64_t fl;
-    spin_lock_irqsave(&route_lock, &fl);
-
+    rcu_read_lock();
+    rt_table_t* t = rcu_dereference(route_table);
     int count = 0;
-    for (int i = 0; i < MAX_ROUTES && count < max_entries; i++) {
-        if (route_table[i].active) {
-            entries[count++] = route_table[i];
-        }
-    }
-
-    spin_unlock_irqrestore(&route_lock, fl);
+    for (int i = 0; i < t->count && count < max_entries; i++)
+        entries[count++] = t->entries[i];
+    rcu_read_unlock();
     return count;
 }
 
 // Get route table for userspace
 int net_get_route_table(net_route_info_t* entries, int max_entries) {
-    uint64_t fl;
-    spin_lock_irqsave(&route_lock, &fl);
+    rcu_read_lock();
+    rt_table_t* t = rcu_dereference(route_table);
 
     int count = 0;
-    for (int i = 0; i < MAX_ROUTES && count < max_entries; i++) {
-        if (!route_table[i].active) continue;
-        entries[count].dst_net = route_table[i].dst_net;
-        entries[count].netmask = route_table[i].netmask;
-        entries[count].gateway = route_table[i].gateway;
-        entries[count].flags = route_table[i].flags;
-        entries[count].metric = (uint16_t)route_table[i].metric;
-        if (route_table[i].dev && route_table[i].dev->name) {
-            const char* n = route_table[i].dev->name;
+    for (int i = 0; i < t->count && count < max_entries; i++) {
+        const rt_entry_t* e = &t->entries[i];
+        entries[count].dst_net = e->dst_net;
+        entries[count].netmask = e->netmask;
+        entries[count].gateway = e->gateway;
+        entries[count].flags = e->flags;
+        entries[count].metric = (uint16_t)e->metric;
+        if (e->dev && e->dev->name) {
+            const char* n = e->dev->name;
             int j = 0;
             while (n[j] && j < 15) { entries[count].dev_name[j] = n[j]; j++; }
             entries[count].dev_name[j] = '\0';
@@ -186,6 +230,6 @@ int net_get_route_table(net_route_info_t* entries, int max_entries) {
         count++;
     }
 
-    spin_unlock_irqrestore(&route_lock, fl);
+    rcu_read_unlock();
     return count;
 }
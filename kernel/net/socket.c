@@ -12,6 +12,8 @@
 #include "../../include/kernel/tty.h"
 #include "../../include/kernel/random.h"
 #include "../../include/kernel/sched.h"
+#include "../../include/kernel/eventpoll.h"
+#include "../../include/kernel/uaccess.h"
 
 // Socket table
 static net_socket_t sockets[NET_MAX_SOCKETS];
@@ -44,6 +46,7 @@ static uint16_t next_ephemeral_port = 49152;
 void socket_init(void) {
     for (int i = 0; i < NET_MAX_SOCKETS; i++) {
         sockets[i].active = 0;
+        wait_queue_init(&sockets[i].wq, "sock");
     }
 }
 
@@ -102,8 +105,12 @@ int sock_create(int domain, int type, int protocol) {
     for (int i = 0; i < NET_MAX_SOCKETS; i++) {
         if (!sockets[i].active) {
             net_socket_t* s = &sockets[i];
-            // Zero the entire struct first so any new fields default to 0.
-            for (size_t b = 0; b < sizeof(*s); b++) ((uint8_t*)s)[b] = 0;
+            // Zero the struct first so any new fields default to 0.  The
+            // wait queue is set up once in socket_init() and left alone:
+            // a late wakeup or epoll release from the slot's previous
+            // owner may still be walking it.
+            for (size_t b = 0; b < __builtin_offsetof(net_socket_t, wq); b++)
+                ((uint8_t*)s)[b] = 0;
             s->type = type;
             if (type == SOCK_STREAM)      s->protocol = IPPROTO_TCP;
             else if (type == SOCK_DGRAM)  s->protocol = IPPROTO_UDP;
@@ -402,6 +409,16 @@ int sock_sendto(int sockfd, const void* buf, size_t len, int flags,
 // ============================================================================
 int sock_recvfrom(int sockfd, void* buf, size_t len, int flags,
                   struct sockaddr_in* src_addr, socklen_t* addrlen) {
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, buf, len);
+    return sock_recvfrom_iter(sockfd, &it, flags, src_addr, addrlen);
+}
+
+// A datagram is scattered over the whole iterator; a stream reads as much
+// as is buffered, up to the iterator's count
+int sock_recvfrom_iter(int sockfd, iov_iter_t* it, int flags,
+                       struct sockaddr_in* src_addr, socklen_t* addrlen) {
     if (sockfd < 0 || sockfd >= NET_MAX_SOCKETS) return -EBADF;
     net_socket_t* s = &sockets[sockfd];
     if (!s->active) return -EBADF;
@@ -431,12 +448,13 @@ int sock_recvfrom(int sockfd, void* buf, size_t len, int flags,
 
         int idx = s->udp_rx_head;
         uint16_t data_len = s->udp_rx_queue[idx].len;
-        if (data_len > len) data_len = (uint16_t)len;
+        if (data_len > it->count) data_len = (uint16_t)it->count;
 
-        smap_disable();
-        for (uint16_t i = 0; i < data_len; i++)
-            ((uint8_t*)buf)[i] = s->udp_rx_queue[idx].data[i];
-        smap_enable();
+        // A datagram that can't be copied out stays queued
+        if (copy_to_iter(s->udp_rx_queue[idx].data, data_len, it) < data_len) {
+            spin_unlock_irqrestore(&s->lock, sflags);
+            return -EFAULT;
+        }
 
         if (src_addr && addrlen && *addrlen >= sizeof(struct sockaddr_in)) {
             *src_addr = s->udp_rx_queue[idx].from;
@@ -454,7 +472,7 @@ int sock_recvfrom(int sockfd, void* buf, size_t len, int flags,
     }
 
     // TCP recvfrom
-    return sock_recv(sockfd, buf, len, flags);
+    return sock_recv_iter(sockfd, it, flags);
 }
 
 // ============================================================================
@@ -517,6 +535,13 @@ int sock_send(int sockfd, const void* buf, size_t len, int flags) {
 // sock_recv - Receive data on connected socket (TCP)
 // ============================================================================
 int sock_recv(int sockfd, void* buf, size_t len, int flags) {
+    struct iovec iov;
+    iov_iter_t it;
+    iov_iter_single(&it, &iov, buf, len);
+    return sock_recv_iter(sockfd, &it, flags);
+}
+
+int sock_recv_iter(int sockfd, iov_iter_t* it, int flags) {
     if (sockfd < 0 || sockfd >= NET_MAX_SOCKETS) return -EBADF;
     net_socket_t* s = &sockets[sockfd];
     if (!s->active) return -EBADF;
@@ -574,30 +599,34 @@ again:
 
         uint32_t avail = (conn->rx_tail - conn->rx_head + conn->rx_buf_size) % conn->rx_buf_size;
         uint32_t copy = avail;
-        if (copy > (len - total)) copy = (uint32_t)(len - total);
-
-        smap_disable();
-        for (uint32_t i = 0; i < copy; i++) {
-            ((uint8_t*)buf)[total + i] = conn->rx_buf[(conn->rx_head + i) % conn->rx_buf_size];
+        if (copy > it->count) copy = (uint32_t)it->count;
+
+        // At most two runs: rx_head to the ring's end, then its start.
+        // Bytes a fault kept from the user stay buffered.
+        uint32_t first = conn->rx_buf_size - conn->rx_head;
+        if (first > copy) first = copy;
+        size_t n = copy_to_iter(conn->rx_buf + conn->rx_head, first, it);
+        if (n == first && copy > first) {
+            n += copy_to_iter(conn->rx_buf, copy - first, it);
         }
-        smap_enable();
         if (!peek) {
-            conn->rx_head = (conn->rx_head + copy) % conn->rx_buf_size;
+            conn->rx_head = (conn->rx_head + (uint32_t)n) % conn->rx_buf_size;
             if (conn->rx_head == conn->rx_tail)
                 conn->rx_ready = 0;
         }
 
         sock_conn_unlock(&conn->lock, cflags);
-        total += copy;
+        total += n;
+        if (n < copy) return total ? (int)total : -EFAULT;
 
-        if (waitall && !peek && total < len &&
+        if (waitall && !peek && it->count &&
             conn->state == TCP_STATE_ESTABLISHED)
             goto again;
         return (int)total;
     }
 
     // UDP recv (connected, no src addr)
-    return sock_recvfrom(sockfd, buf, len, flags, NULL, NULL);
+    return sock_recvfrom_iter(sockfd, it, flags, NULL, NULL);
 }
 
 // ============================================================================
@@ -668,6 +697,8 @@ int sock_close(int sockfd) {
     s->active  = 0;
     spin_unlock_irqrestore(&s->lock, flags);
 
+    eventpoll_release(MAKE_SOCKET_FD(sockfd));
+
     // CRITICAL: do NOT hold s->lock across tcp_close/tcp_abort.  Those
     // call tcp_send_segment (FIN packet, may queue+drain a softirq),
     // tcp_free_conn → slab_free (initiates a TLB-shootdown IPI on freed
@@ -709,6 +740,7 @@ int sock_shutdown(int sockfd, int how) {
         s->tcp = NULL;
         s->connected = 0;
         s->listening = 0;
+        wake_up(&s->wq);
     }
 
     return 0;
@@ -1033,6 +1065,7 @@ void raw_socket_deliver(uint32_t src_ip, uint32_t dst_ip, uint8_t protocol,
         s->udp_rx_ready = 1;
 
         spin_unlock_irqrestore(&s->lock, flags);
+        wake_up_key(&s->wq, POLLIN | POLLRDNORM);
     }
 }
 
@@ -1101,6 +1134,7 @@ void sock_post_icmp_error(uint8_t proto,
             s->tcp->tx_ready = 1;
             s->tcp->connect_done = 1;
         }
+        wake_up(&s->wq);
     }
 }
 
@@ -1175,38 +1209,63 @@ int sock_accept4(int sockfd, struct sockaddr_in* addr, socklen_t* addrlen, int f
 int sock_sendmsg(int sockfd, const struct msghdr* msg, int flags) {
     if (!msg) return -EINVAL;
 
-    // Calculate total length from iovec
-    size_t total = 0;
-    smap_disable();
-    for (int i = 0; i < msg->msg_iovlen; i++)
-        total += msg->msg_iov[i].iov_len;
-
-    if (total == 0) return 0;
-
-    // Copy scatter buffers into a single contiguous buffer
-    uint8_t buf[2048];
-    if (total > sizeof(buf)) total = sizeof(buf);
-
-    size_t off = 0;
-    for (int i = 0; i < msg->msg_iovlen && off < total; i++) {
-        size_t chunk = msg->msg_iov[i].iov_len;
-        if (off + chunk > total) chunk = total - off;
-        for (size_t j = 0; j < chunk; j++)
-            buf[off + j] = ((const uint8_t*)msg->msg_iov[i].iov_base)[j];
-        off += chunk;
-    }
-
     // Use sendto with optional address
     const struct sockaddr_in* dest = NULL;
     struct sockaddr_in dest_copy;
     if (msg->msg_name && msg->msg_namelen >= sizeof(struct sockaddr_in)) {
-        dest_copy = *(const struct sockaddr_in*)msg->msg_name;
+        if (copy_from_user(&dest_copy, msg->msg_name, sizeof(dest_copy))) return -EFAULT;
         dest = &dest_copy;
     }
-    smap_enable();
 
-    return sock_sendto(sockfd, buf, total, flags, dest,
-                       dest ? sizeof(struct sockaddr_in) : 0);
+    struct iovec fast[UIO_FASTIOV];
+    struct iovec* iov;
+    iov_iter_t it;
+    long total = import_iovec(msg->msg_iov, (unsigned long)msg->msg_iovlen, fast, &iov, &it);
+    if (total < 0) return (int)total;
+
+    int ret = 0;
+    if (total > 0) {
+        ret = sock_sendto_iter(sockfd, &it, flags, dest,
+                               dest ? sizeof(struct sockaddr_in) : 0);
+    }
+    if (iov != fast) kfree(iov);
+    return ret;
+}
+
+// A datagram has to leave in one piece, so the iterator is gathered into
+// one buffer for it; a stream is sent a segment at a time and stops at
+// the first short send, like a short write()
+int sock_sendto_iter(int sockfd, iov_iter_t* it, int flags,
+                     const struct sockaddr_in* dest_addr, socklen_t addrlen) {
+    if (sockfd < 0 || sockfd >= NET_MAX_SOCKETS) return -EBADF;
+    net_socket_t* s = &sockets[sockfd];
+    if (!s->active) return -EBADF;
+
+    if (s->type != SOCK_STREAM) {
+        size_t len = it->count;
+        if (len > 0xFFFFU) return -EMSGSIZE;
+        uint8_t* buf = (uint8_t*)kalloc(len ? len : 1);
+        if (!buf) return -ENOMEM;
+        int ret = -EFAULT;
+        if (copy_from_iter(buf, len, it) == len) {
+            ret = sock_sendto(sockfd, buf, len, flags, dest_addr, addrlen);
+        }
+        kfree(buf);
+        return ret;
+    }
+
+    int total = 0;
+    while (it->count) {
+        const void* base = (const uint8_t*)it->iov->iov_base + it->iov_offset;
+        size_t len = it->iov->iov_len - it->iov_offset;
+        if (len > it->count) len = it->count;
+        int r = sock_send(sockfd, base, len, flags);
+        if (r < 0) return total ? total : r;
+        iov_iter_advance(it, (size_t)r);
+        total += r;
+        if ((size_t)r < len) break;
+    }
+    return total;
 }
 
 // ============================================================================
@@ -1218,18 +1277,13 @@ int sock_recvmsg(int sockfd, struct msghdr* msg, int flags) {
     net_socket_t* s = &sockets[sockfd];
     if (!s->active) return -EBADF;
 
-    // Calculate total iovec capacity
-    size_t total = 0;
-    smap_disable();
-    for (int i = 0; i < msg->msg_iovlen; i++)
-        total += msg->msg_iov[i].iov_len;
-    smap_enable();
-
+    struct iovec fast[UIO_FASTIOV];
+    struct iovec* iov;
+    iov_iter_t it;
+    long total = import_iovec(msg->msg_iov, (unsigned long)msg->msg_iovlen, fast, &iov, &it);
+    if (total < 0) return (int)total;
     if (total == 0) return 0;
 
-    uint8_t buf[2048];
-    if (total > sizeof(buf)) total = sizeof(buf);
-
     struct sockaddr_in src_addr;
     socklen_t addrlen = sizeof(src_addr);
 
@@ -1248,32 +1302,24 @@ int sock_recvmsg(int sockfd, struct msghdr* msg, int flags) {
         have_meta = 1;
     }
 
-    int ret = sock_recvfrom(sockfd, buf, total, flags, &src_addr, &addrlen);
+    // Received straight into the caller's iovecs
+    int ret = sock_recvfrom_iter(sockfd, &it, flags, &src_addr, &addrlen);
+    if (iov != fast) kfree(iov);
     if (ret < 0) return ret;
 
-    // Scatter into iovecs
-    smap_disable();
-    size_t off = 0;
-    for (int i = 0; i < msg->msg_iovlen && off < (size_t)ret; i++) {
-        size_t chunk = msg->msg_iov[i].iov_len;
-        if (off + chunk > (size_t)ret) chunk = (size_t)ret - off;
-        for (size_t j = 0; j < chunk; j++)
-            ((uint8_t*)msg->msg_iov[i].iov_base)[j] = buf[off + j];
-        off += chunk;
-    }
-
     // Return source address if requested
     if (msg->msg_name && msg->msg_namelen >= sizeof(struct sockaddr_in)) {
-        *(struct sockaddr_in*)msg->msg_name = src_addr;
+        if (copy_to_user(msg->msg_name, &src_addr, sizeof(src_addr))) return -EFAULT;
         msg->msg_namelen = sizeof(struct sockaddr_in);
     }
 
-    // RFC 2292 ancillary data
+    // RFC 2292 ancillary data, built here and copied out in one go
+    unsigned char cp[CMSG_SPACE(sizeof(struct in_pktinfo)) + 2 * CMSG_SPACE(sizeof(int))]
+        __attribute__((aligned(8)));
     size_t cmsg_avail = msg->msg_controllen;
     size_t cmsg_used  = 0;
     msg->msg_flags = 0;
     if (have_meta && msg->msg_control && cmsg_avail > 0) {
-        unsigned char* cp = (unsigned char*)msg->msg_control;
         if (s->ip_recvpktinfo &&
             cmsg_used + CMSG_SPACE(sizeof(struct in_pktinfo)) <= cmsg_avail) {
             struct cmsghdr* c = (struct cmsghdr*)(cp + cmsg_used);
@@ -1311,8 +1357,8 @@ int sock_recvmsg(int sockfd, struct msghdr* msg, int flags) {
             cmsg_used += CMSG_SPACE(sizeof(int));
         }
     }
+    if (cmsg_used && copy_to_user(msg->msg_control, cp, cmsg_used)) return -EFAULT;
     msg->msg_controllen = cmsg_used;
-    smap_enable();
 
     return ret;
 }
@@ -1321,10 +1367,11 @@ int sock_recvmsg(int sockfd, struct msghdr* msg, int flags) {
 // sock_poll - Check socket for events
 // Returns bitmask of POLLIN/POLLOUT/POLLERR/POLLHUP
 // ============================================================================
-int sock_poll(int sockfd, short events) {
+int sock_poll(int sockfd, short events, poll_table_t* pt) {
     if (sockfd < 0 || sockfd >= NET_MAX_SOCKETS) return POLLNVAL;
     net_socket_t* s = &sockets[sockfd];
     if (!s->active) return POLLNVAL;
+    poll_wait(&s->wq, pt);
 
     short revents = 0;
 
@@ -1749,7 +1796,7 @@ int sock_sendfile(int out_fd, int in_fd, int64_t* offset, size_t count) {
     if (!in_file) return -EBADF;
     uintptr_t in_marker = (uintptr_t)in_file;
     // Reject sockets, pipes, console markers as input
-    if (IS_SOCKET_FD(in_file) || IS_EPOLL_FD(in_file))
+    if (IS_SOCKET_FD(in_file))
         return -EINVAL;
     if (in_marker <= 3)  // console markers
         return -EINVAL;
@@ -1780,7 +1827,7 @@ int sock_sendfile(int out_fd, int in_fd, int64_t* offset, size_t count) {
     } else if (out_marker == 2 || out_marker == 3 ||
                (!out_entry && (out_fd == 1 || out_fd == 2))) {
         out_is_console = 1;
-    } else if (out_entry && out_marker > 3 && !IS_EPOLL_FD(out_entry)) {
+    } else if (out_entry && out_marker > 3) {
         // Regular file - handled by the else branch in the write loop
     } else {
         return -EBADF;
@@ -1838,40 +1885,9 @@ int sock_sendfile(int out_fd, int in_fd, int64_t* offset, size_t count) {
                                sendfile_buf + written,
                                (size_t)nread - written, 0);
             } else if (out_is_pipe) {
-                // Direct pipe buffer write (kernel-to-kernel)
-                pipe_end_t* pe = (pipe_end_t*)out_entry;
-                pipe_t* pp = pe->pipe;
-                if (!pp || pe->is_read) { err = -EBADF; break; }
-                uint64_t pflags;
-                spin_lock_irqsave(&pp->lock, &pflags);
-                if (pp->readers == 0) {
-                    spin_unlock_irqrestore(&pp->lock, pflags);
-                    err = -EPIPE;
-                    break;
-                }
-                size_t space = pp->size - pp->used;
-                size_t todo = (size_t)nread - written;
-                if (todo > space) todo = space;
-                if (todo == 0) {
-                    // Pipe full — wake readers and yield, then retry
-                    spin_unlock_irqrestore(&pp->lock, pflags);
-                    sched_wake_channel(pp);
-                    sched_schedule();
-                    continue;
-                }
-                size_t first = pp->size - pp->write_pos;
-                if (first > todo) first = todo;
-                mm_memcpy(pp->buffer + pp->write_pos,
-                          sendfile_buf + written, first);
-                if (todo > first)
-                    mm_memcpy(pp->buffer,
-                              sendfile_buf + written + first,
-                              todo - first);
-                pp->write_pos = (pp->write_pos + todo) % pp->size;
-                pp->used += todo;
-                spin_unlock_irqrestore(&pp->lock, pflags);
-                sched_wake_channel(pp);
-                nw = (long)todo;
+                // pipe_write() copies from kernel memory just as well
+                nw = pipe_write((pipe_end_t*)out_entry, (uint64_t)(sendfile_buf + written),
+                                (size_t)nread - written, 0);
             } else if (out_is_console) {
                 tty_t* tty = cur->ctty ? cur->ctty : tty_get_console();
                 nw = tty_write(tty, sendfile_buf + written,
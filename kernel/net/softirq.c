@@ -14,11 +14,10 @@ static volatile uint32_t softirq_pending_mask[MAX_CPUS];
 static volatile int      softirq_in_progress[MAX_CPUS];
 static task_t*           ksoftirqd_task[MAX_CPUS];
 
-// Before percpu_init() runs, GS base is 0 and this_cpu_id() would fault
-// reading %gs:cpu_id_offset.  IRQs (PS/2 mouse, keyboard, timer) can fire
-// during early init from the BSP — in that case we are always CPU 0.
+// %gs points at the BSP's per-CPU area from the start of kernel_main
+// (percpu_early_init), so IRQs during early init read CPU 0 here.
 static inline uint32_t safe_cpu_id(void) {
-    return read_gs_base_msr() ? this_cpu_id() : 0;
+    return this_cpu_id();
 }
 
 void softirq_register(uint32_t nr, softirq_fn_t fn) {
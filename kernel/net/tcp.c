@@ -5,7 +5,7 @@
 #include "../../include/kernel/timer.h"
 #include "../../include/kernel/syscall.h"
 #include "../../include/kernel/random.h"
-#include "../../include/kernel/softirq.h"
+#include "../../include/kernel/workqueue.h"
 
 // TCP connection table
 tcp_conn_t tcp_connections[TCP_MAX_CONNECTIONS];
@@ -54,13 +54,15 @@ static inline void tcp_lock_release(spinlock_t* lock, uint64_t flags) {
 //
 // To avoid this, IRQ-context callers (only tcp_timer_tick) push the
 // to-be-freed conn pointer onto this small queue.  The queue is then
-// drained from softirq / process context (where IRQs are enabled around
-// handler invocations on at least one CPU, so IPIs can be serviced) by
-// tcp_reap_pending(), which calls tcp_free_conn → slab_free safely.
+// drained from process context (a kworker, where IRQs are enabled so
+// IPIs can be serviced) by tcp_reap_pending(), which calls
+// tcp_free_conn → slab_free safely.
 static tcp_conn_t* tcp_pending_free[TCP_MAX_CONNECTIONS];
 static uint32_t    tcp_pending_free_count = 0;
 static spinlock_t  tcp_pending_free_lock = SPINLOCK_INIT("tcp_pf");
 static void tcp_free_conn(tcp_conn_t* conn);   // forward
+static void tcp_reap_work_fn(work_t* work);    // forward
+static work_t tcp_reap_work = WORK_INIT(tcp_reap_work_fn);
 
 // Push a conn onto the deferred-free queue.  IRQ-safe (uses spinlock; the
 // critical section is just an array append so it is bounded and very
@@ -77,21 +79,20 @@ static void tcp_defer_free(tcp_conn_t* conn) {
         tcp_pending_free[tcp_pending_free_count++] = conn;
     }
     spin_unlock_irqrestore(&tcp_pending_free_lock, flags);
-    // Wake ksoftirqd to drain the queue in process context.  Without
-    // this, a workload that closes a burst of sockets and then idles
-    // (no further connect/listen/close to trigger an opportunistic
-    // drain) leaves freed-but-not-released slots on the queue forever
-    // — they appear in netstat as stuck CLOSED entries and eventually
-    // exhaust TCP_MAX_CONNECTIONS.  softirq_raise is IRQ-safe and only
-    // sets a per-CPU bit + wakes ksoftirqd if needed.
-    softirq_raise(SOFTIRQ_TIMER);
+    // Queue the drain in process context.  Without this, a workload that
+    // closes a burst of sockets and then idles (no further
+    // connect/listen/close to trigger an opportunistic drain) leaves
+    // freed-but-not-released slots on the queue forever — they appear in
+    // netstat as stuck CLOSED entries and eventually exhaust
+    // TCP_MAX_CONNECTIONS.  queue_work is IRQ-safe and a no-op while the
+    // drain is already pending.
+    schedule_work(&tcp_reap_work);
 }
 
-// Softirq handler bound to SOFTIRQ_TIMER (registered in tcp_init).
-// Runs in process / ksoftirqd context with IRQs enabled, so calling
-// tcp_free_conn → slab_free here is safe (TLB-shootdown IPIs can be
-// serviced).
-static void tcp_pending_softirq(void) {
+// Runs on a kworker with IRQs enabled, so calling tcp_free_conn →
+// slab_free here is safe (TLB-shootdown IPIs can be serviced).
+static void tcp_reap_work_fn(work_t* work) {
+    (void)work;
     tcp_reap_pending();
 }
 
@@ -531,6 +532,17 @@ static int tcp_send_synack_conn(tcp_conn_t* conn, uint16_t window) {
                                options, opt_len);
 }
 
+// Wake poll/epoll watchers of the socket that owns conn after its state,
+// buffers or accept queue changed.  owner_socket may be the conn itself
+// (not yet attached) or NULL (socket gone); socket slots are never freed,
+// so waking one that was closed meanwhile is harmless.
+static void tcp_wake(tcp_conn_t* conn) {
+    net_socket_t* s = (net_socket_t*)__atomic_load_n(&conn->owner_socket, __ATOMIC_ACQUIRE);
+    if (s && (void*)s != (void*)conn) {
+        wake_up(&s->wq);
+    }
+}
+
 static void tcp_fail_connection(tcp_conn_t* conn, int error) {
     conn->state = TCP_STATE_CLOSED;
     conn->error = error;
@@ -538,6 +550,7 @@ static void tcp_fail_connection(tcp_conn_t* conn, int error) {
     conn->rx_ready = 1;
     conn->tx_ready = 1;
     conn->inflight_count = 0;
+    tcp_wake(conn);
 }
 
 // RFC 6528: ISN = hash(secret, src_ip, dst_ip, src_port, dst_port) + time_counter
@@ -659,9 +672,6 @@ void tcp_init(void) {
     // Generate ISN and SYN cookie secrets from CSPRNG
     random_get_bytes(tcp_isn_secret, sizeof(tcp_isn_secret), 0);
     random_get_bytes(tcp_syncookie_secret, sizeof(tcp_syncookie_secret), 0);
-    // Bind the deferred-free drain to a softirq vector so the timer
-    // can hand work off to ksoftirqd from hard-IRQ context.
-    softirq_register(SOFTIRQ_TIMER, tcp_pending_softirq);
 }
 
 // ============================================================================
@@ -1623,6 +1633,7 @@ void tcp_rx(net_device_t* dev, uint32_t src_ip, uint32_t dst_ip,
                         listener->accept_queue[listener->accept_tail] = new_conn;
                         listener->accept_tail = next_tail;
                         listener->accept_ready = 1;
+                        tcp_wake(listener);
                     }
                     tcp_lock_release(&listener->lock, lflags);
                 } else {
@@ -1770,6 +1781,7 @@ void tcp_rx(net_device_t* dev, uint32_t src_ip, uint32_t dst_ip,
                             p->accept_queue[p->accept_tail] = conn;
                             p->accept_tail = next;
                             p->accept_ready = 1;
+                            tcp_wake(p);
                         }
                         spin_unlock_irqrestore(&p->lock, pflags);
                     } else {
@@ -2049,6 +2061,8 @@ void tcp_rx(net_device_t* dev, uint32_t src_ip, uint32_t dst_ip,
         break;
     }
 
+    // Data, ACKed room, a FIN or a state change may all be news to pollers
+    tcp_wake(conn);
     tcp_lock_release(&conn->lock, flags);
 }
 
@@ -2153,6 +2167,7 @@ void tcp_timer_tick(void) {
         if (conn->cork && conn->cork_deadline && now >= conn->cork_deadline) {
             conn->cork_deadline = 0;
             conn->tx_ready = 1;
+            tcp_wake(conn);
         }
 
         // Retransmission timeout
@@ -216,4 +216,5 @@ void udp_deliver_to_socket(uint32_t src_ip, uint16_t src_port,
     sk->udp_rx_ready = 1;
 
     spin_unlock_irqrestore(&sk->lock, flags);
+    wake_up_key(&sk->wq, POLLIN | POLLRDNORM);
 }
@@ -5,6 +5,8 @@
 #include "../../include/kernel/sched.h"
 #include "../../include/kernel/syscall.h"
 #include "../../include/kernel/console.h"
+#include "../../include/kernel/eventpoll.h"
+#include "../../include/kernel/uaccess.h"
 
 // UNIX socket table
 static unix_socket_t unix_sockets[MAX_UNIX_SOCKETS];
@@ -64,6 +66,17 @@ static int unix_alloc_locked(void) {
     return -1;
 }
 
+// ============================================================================
+// unix_clear_slot - Zero a freshly claimed slot
+// The wait queue is not touched: a wakeup or epoll release from the slot's
+// previous owner may still be walking it.  Slots start out zeroed, which
+// is an empty queue with an unlocked lock.
+// ============================================================================
+static void unix_clear_slot(unix_socket_t* us) {
+    uint8_t* p = (uint8_t*)us;
+    for (size_t i = 0; i < __builtin_offsetof(unix_socket_t, wq); i++) p[i] = 0;
+}
+
 // ============================================================================
 // unix_find_by_path - Find a bound & listening socket by path
 // Caller MUST hold unix_table_lock so the returned pointer is stable
@@ -97,8 +110,7 @@ int unix_create(int type) {
     // Zero out the struct, then re-establish active=1 (claimed by alloc).
     // The zeroing is done while we still hold unix_table_lock so that no
     // other allocator/finder can observe the half-zeroed state.
-    uint8_t* p = (uint8_t*)us;
-    for (int i = 0; i < (int)sizeof(unix_socket_t); i++) p[i] = 0;
+    unix_clear_slot(us);
 
     us->active = 1;
     us->type = type;
@@ -208,8 +220,7 @@ int unix_accept(int usockfd, struct sockaddr_un* addr, socklen_t* addrlen) {
     }
 
     unix_socket_t* server = &unix_sockets[new_idx];
-    uint8_t* p = (uint8_t*)server;
-    for (int i = 0; i < (int)sizeof(unix_socket_t); i++) p[i] = 0;
+    unix_clear_slot(server);
     server->active = 1;
     server->type = SOCK_STREAM;
     server->connected = 1;
@@ -223,6 +234,7 @@ int unix_accept(int usockfd, struct sockaddr_un* addr, socklen_t* addrlen) {
     server->peer = client;
     client->peer = server;
     client->connected = 1;
+    wake_up(&client->wq);
     spin_unlock_irqrestore(&unix_table_lock, tflags);
 
     // Fill addr if requested
@@ -270,6 +282,7 @@ int unix_connect(int usockfd, const struct sockaddr_un* addr) {
     listener->accept_tail = next;
     listener->accept_ready = 1;
     spin_unlock_irqrestore(&listener->lock, flags);
+    wake_up_key(&listener->wq, POLLIN | POLLRDNORM);
     spin_unlock_irqrestore(&unix_table_lock, tflags);
 
     // Wait for acceptance (peer link to be set up).  Re-read peer/error
@@ -320,14 +333,16 @@ int unix_send(int usockfd, const void* buf, size_t len, int flags) {
     }
 
     const uint8_t* src = (const uint8_t*)buf;
+    const int size = (int)sizeof(peer->buf);
     int sent = 0;
+    bool fault = false;
 
     uint64_t irqflags;
     spin_lock_irqsave(&peer->lock, &irqflags);
 
-    for (size_t i = 0; i < len; i++) {
-        int next = (peer->tail + 1) % (int)sizeof(peer->buf);
-        if (next == peer->head) {
+    while ((size_t)sent < len) {
+        int room = (peer->head - peer->tail - 1 + size) % size;
+        if (room == 0) {
             // Buffer full
             if (sent > 0) break;
             spin_unlock_irqrestore(&peer->lock, irqflags);
@@ -344,25 +359,34 @@ int unix_send(int usockfd, const void* buf, size_t len, int flags) {
                 sched_yield_in_kernel();
             }
             spin_lock_irqsave(&peer->lock, &irqflags);
-            next = (peer->tail + 1) % (int)sizeof(peer->buf);
-            if (next == peer->head) break;
+            room = (peer->head - peer->tail - 1 + size) % size;
+            if (room == 0) break;
+        }
+        // Copy the run from tail up to the ring's end or the free space's
+        int run = size - peer->tail;
+        if (run > room) run = room;
+        if ((size_t)run > len - (size_t)sent) run = (int)(len - (size_t)sent);
+        size_t left = __copy_from_user(&peer->buf[peer->tail], src + sent, (size_t)run);
+        run -= (int)left;
+        peer->tail = (peer->tail + run) % size;
+        peer->bytes_written += run;
+        sent += run;
+        if (left) {
+            fault = true;
+            break;
         }
-        smap_disable();
-        peer->buf[peer->tail] = src[i];
-        smap_enable();
-        peer->tail = next;
-        peer->bytes_written++;
-        sent++;
     }
     peer->ready = 1;
     spin_unlock_irqrestore(&peer->lock, irqflags);
+    wake_up_key(&peer->wq, POLLIN | POLLRDNORM);
 
     // Drop the reference we took above.  If this was the last ref and
     // peer was already closed, unix_close's deferred-free logic (or
     // our own dec dropping ref to 0) will tear it down on next close.
     __atomic_fetch_sub(&peer->ref_count, 1, __ATOMIC_ACQ_REL);
 
-    return sent > 0 ? sent : -EAGAIN;
+    if (sent > 0) return sent;
+    return fault ? -EFAULT : -EAGAIN;
 }
 
 // ============================================================================
@@ -396,20 +420,39 @@ int unix_recv(int usockfd, void* buf, size_t len, int flags) {
     uint64_t irqflags;
     spin_lock_irqsave(&us->lock, &irqflags);
 
+    const int size = (int)sizeof(us->buf);
     int received = 0;
-    for (size_t i = 0; i < len; i++) {
-        if (us->head == us->tail) break;
-        smap_disable();
-        dst[i] = us->buf[us->head];
-        smap_enable();
-        us->head = (us->head + 1) % (int)sizeof(us->buf);
-        us->bytes_read++;
-        received++;
+    bool fault = false;
+    while ((size_t)received < len && us->head != us->tail) {
+        // Copy the run from head up to the ring's end or the data's
+        int run = (us->tail > us->head ? us->tail : size) - us->head;
+        if ((size_t)run > len - (size_t)received) run = (int)(len - (size_t)received);
+        size_t left = __copy_to_user(dst + received, &us->buf[us->head], (size_t)run);
+        run -= (int)left;
+        us->head = (us->head + run) % size;
+        us->bytes_read += run;
+        received += run;
+        if (left) {
+            fault = true;
+            break;
+        }
     }
     if (us->head == us->tail)
         us->ready = 0;
     spin_unlock_irqrestore(&us->lock, irqflags);
 
+    // Writers on the other end poll our ring for room.  The table lock
+    // keeps the peer link from being torn down under us.
+    if (received > 0) {
+        uint64_t tflags;
+        spin_lock_irqsave(&unix_table_lock, &tflags);
+        if (us->peer) {
+            wake_up_key(&us->peer->wq, POLLOUT | POLLWRNORM);
+        }
+        spin_unlock_irqrestore(&unix_table_lock, tflags);
+    }
+
+    if (received == 0 && fault) return -EFAULT;
     return received;
 }
 
@@ -423,6 +466,8 @@ int unix_close(int usockfd) {
     int old = __atomic_fetch_sub(&us->ref_count, 1, __ATOMIC_ACQ_REL);
     if (old > 1) return 0;
 
+    eventpoll_release((void*)(uintptr_t)usockfd);  // The fd table marker
+
     uint64_t tflags;
     spin_lock_irqsave(&unix_table_lock, &tflags);
 
@@ -458,6 +503,9 @@ int unix_close(int usockfd) {
     us->tail = 0;
 
     spin_unlock_irqrestore(&us->lock, flags);
+    if (peer) {
+        wake_up(&peer->wq);
+    }
     spin_unlock_irqrestore(&unix_table_lock, tflags);
     return 0;
 }
@@ -490,8 +538,7 @@ int unix_socketpair(int type, int sv[2]) {
     unix_socket_t* s1 = &unix_sockets[idx1];
 
     // Initialize s0
-    uint8_t* p = (uint8_t*)s0;
-    for (int i = 0; i < (int)sizeof(unix_socket_t); i++) p[i] = 0;
+    unix_clear_slot(s0);
     s0->active = 1;
     s0->type = type;
     s0->connected = 1;
@@ -499,8 +546,7 @@ int unix_socketpair(int type, int sv[2]) {
     spinlock_init(&s0->lock, "unix_sock");
 
     // Initialize s1
-    p = (uint8_t*)s1;
-    for (int i = 0; i < (int)sizeof(unix_socket_t); i++) p[i] = 0;
+    unix_clear_slot(s1);
     s1->active = 1;
     s1->type = type;
     s1->connected = 1;
@@ -531,12 +577,14 @@ int unix_shutdown(int usockfd, int how) {
         if (us->peer) {
             us->peer->peer_closed = 1;
             us->peer->ready = 1;
+            wake_up(&us->peer->wq);
         }
     }
     if (how == SHUT_RD || how == SHUT_RDWR) {
         // Stop reading
         us->peer_closed = 1;
     }
+    wake_up(&us->wq);
 
     return 0;
 }
@@ -544,9 +592,10 @@ int unix_shutdown(int usockfd, int how) {
 // ============================================================================
 // unix_poll - Poll a UNIX socket for events
 // ============================================================================
-int unix_poll(int usockfd, short events) {
+int unix_poll(int usockfd, short events, poll_table_t* pt) {
     unix_socket_t* us = unix_get(usockfd);
     if (!us) return 0;
+    poll_wait(&us->wq, pt);
 
     short revents = 0;
 
@@ -59,19 +59,19 @@
 #define EVENT__HAVE_DLFCN_H 1
 
 /* Define if your system supports the epoll system calls */
-/* #undef EVENT__HAVE_EPOLL */
+#define EVENT__HAVE_EPOLL 1
 
 /* Define to 1 if you have the `epoll_create1' function. */
-/* #undef EVENT__HAVE_EPOLL_CREATE1 */
+#define EVENT__HAVE_EPOLL_CREATE1 1
 
 /* Define to 1 if you have the `epoll_ctl' function. */
-/* #undef EVENT__HAVE_EPOLL_CTL */
+#define EVENT__HAVE_EPOLL_CTL 1
 
 /* Define to 1 if you have the <errno.h> header file. */
 #define EVENT__HAVE_ERRNO_H 1
 
 /* Define to 1 if you have the `eventfd' function. */
-/* #undef EVENT__HAVE_EVENTFD */
+#define EVENT__HAVE_EVENTFD 1
 
 /* Define if your system supports event ports */
 /* #undef EVENT__HAVE_EVENT_PORTS */
@@ -311,10 +311,10 @@
 /* #undef EVENT__HAVE_SYS_DEVPOLL_H */
 
 /* Define to 1 if you have the <sys/epoll.h> header file. */
-/* #undef EVENT__HAVE_SYS_EPOLL_H */
+#define EVENT__HAVE_SYS_EPOLL_H 1
 
 /* Define to 1 if you have the <sys/eventfd.h> header file. */
-/* #undef EVENT__HAVE_SYS_EVENTFD_H */
+#define EVENT__HAVE_SYS_EVENTFD_H 1
 
 /* Define to 1 if you have the <sys/event.h> header file. */
 /* #undef EVENT__HAVE_SYS_EVENT_H */
@@ -353,7 +353,7 @@
 /* #undef EVENT__HAVE_SYS_SYSCTL_H */
 
 /* Define to 1 if you have the <sys/timerfd.h> header file. */
-/* #undef EVENT__HAVE_SYS_TIMERFD_H */
+#define EVENT__HAVE_SYS_TIMERFD_H 1
 
 /* Define to 1 if you have the <sys/time.h> header file. */
 #define EVENT__HAVE_SYS_TIME_H 1
@@ -383,7 +383,7 @@
 #define EVENT__HAVE_TIMERCMP 1
 
 /* Define to 1 if you have the `timerfd_create' function. */
-/* #undef EVENT__HAVE_TIMERFD_CREATE */
+#define EVENT__HAVE_TIMERFD_CREATE 1
 
 /* Define if timerisset is defined in <sys/time.h> */
 #define EVENT__HAVE_TIMERISSET 1
@@ -58,8 +58,72 @@ static int write_all(const char *buf, size_t n) {
     return 0;
 }
 
+#define SPLICE_CHUNK 65536
+
+/* Move everything from fd to out with splice().  Returns 0 at EOF, 1 if
+ * splice() does not apply to this pair and nothing was moved, -1 on error. */
+static int splice_all(int fd, int out) {
+    int moved = 0;
+    for (;;) {
+        ssize_t n = splice(fd, NULL, out, NULL, SPLICE_CHUNK, SPLICE_F_MOVE);
+        if (n < 0) {
+            if (!moved && (errno == EINVAL || errno == ENOSYS))
+                return 1;
+            return -1;
+        }
+        if (n == 0)
+            return 0;
+        moved = 1;
+    }
+}
+
+/* Copy fd to stdout inside the kernel: straight across when either side
+ * is a pipe, otherwise through a pipe of our own, so file data goes out
+ * from the page cache without a trip through user memory.  Returns 1 if
+ * splice() cannot be used at all. */
+static int splice_cat(int fd) {
+    int r = splice_all(fd, STDOUT_FILENO);
+    if (r != 1)
+        return r;
+
+    int p[2];
+    if (pipe(p) < 0)
+        return 1;
+    int moved = 0;
+    for (;;) {
+        ssize_t n = splice(fd, NULL, p[1], NULL, SPLICE_CHUNK, SPLICE_F_MOVE);
+        if (n < 0) {
+            r = (!moved && (errno == EINVAL || errno == ENOSYS)) ? 1 : -1;
+            break;
+        }
+        if (n == 0) {
+            r = 0;
+            break;
+        }
+        moved = 1;
+        while (n > 0) {
+            ssize_t w = splice(p[0], NULL, STDOUT_FILENO, NULL, (size_t)n, SPLICE_F_MOVE);
+            if (w <= 0) {
+                if (w == 0)
+                    errno = EIO;
+                r = -1;
+                goto out;
+            }
+            n -= w;
+        }
+    }
+out:
+    close(p[0]);
+    close(p[1]);
+    return r;
+}
+
 /* Simple cat: no options active, just copy data */
 static int simple_cat(int fd) {
+    int r = splice_cat(fd);
+    if (r != 1)
+        return r;
+
     char buf[4096];
     for (;;) {
         ssize_t r = read(fd, buf, sizeof(buf));
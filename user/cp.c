@@ -252,6 +252,52 @@ static void apply_attributes(const char *dest, const struct stat *src_st) {
     }
 }
 
+/* splice_copy() results */
+#define SPLICE_OK           0
+#define SPLICE_UNSUPPORTED  1   /* nothing copied; use read/write */
+#define SPLICE_READ_ERR     2
+#define SPLICE_WRITE_ERR    3
+
+/*
+ * Copy sfd to dfd through a pipe with splice().  The source's page cache
+ * pages go into the pipe by reference and are written to the destination
+ * from there, so the data is copied once rather than into and out of a
+ * user buffer.
+ */
+static int splice_copy(int sfd, int dfd) {
+    int p[2];
+    if (pipe(p) < 0)
+        return SPLICE_UNSUPPORTED;
+
+    int ret = SPLICE_OK;
+    int moved = 0;
+    for (;;) {
+        ssize_t n = splice(sfd, NULL, p[1], NULL, COPY_BUF_SIZE * 2, SPLICE_F_MOVE);
+        if (n < 0) {
+            ret = (!moved && (errno == EINVAL || errno == ENOSYS)) ?
+                  SPLICE_UNSUPPORTED : SPLICE_READ_ERR;
+            break;
+        }
+        if (n == 0)
+            break;
+        moved = 1;
+        while (n > 0) {
+            ssize_t w = splice(p[0], NULL, dfd, NULL, (size_t)n, SPLICE_F_MOVE);
+            if (w <= 0) {
+                if (w == 0)
+                    errno = EIO;
+                ret = SPLICE_WRITE_ERR;
+                goto out;
+            }
+            n -= w;
+        }
+    }
+out:
+    close(p[0]);
+    close(p[1]);
+    return ret;
+}
+
 /* Copy a single regular file. */
 static int copy_file_data(const char *src, const char *dest,
                           const struct stat *src_st) {
@@ -290,9 +336,23 @@ static int copy_file_data(const char *src, const char *dest,
     }
 
     char buf[COPY_BUF_SIZE];
-    ssize_t nread;
+    ssize_t nread = 0;
     int ret = 0;
 
+    int sr = splice_copy(sfd, dfd);
+    if (sr == SPLICE_READ_ERR) {
+        nread = -1;
+        goto read_err;
+    }
+    if (sr == SPLICE_WRITE_ERR) {
+        fprintf(stderr, PROGRAM_NAME ": error writing '%s': %s\n",
+            dest, strerror(errno));
+        ret = -1;
+        goto done;
+    }
+    if (sr == SPLICE_OK)
+        goto done;
+
     while ((nread = read(sfd, buf, sizeof(buf))) > 0) {
         ssize_t written = 0;
         while (written < nread) {
@@ -307,6 +367,7 @@ static int copy_file_data(const char *src, const char *dest,
         }
     }
 
+read_err:
     if (nread < 0) {
         fprintf(stderr, PROGRAM_NAME ": error reading '%s': %s\n",
                     src, strerror(errno));
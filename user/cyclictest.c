@@ -0,0 +1,157 @@
+/*
+ * cyclictest - measure timer wakeup latency
+ *
+ * Usage: cyclictest [-i usec] [-l loops] [-p prio] [-b usec] [-q]
+ *
+ * Sleeps until a series of evenly spaced deadlines and records how late
+ * each wakeup is.  The worst case is the scheduling latency of a task of
+ * the chosen priority under whatever else the system is doing.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+
+static volatile int stop;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void sleep_us(uint64_t us)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)(us / 1000000ULL);
+    ts.tv_nsec = (long)(us % 1000000ULL) * 1000;
+    nanosleep(&ts, NULL);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: cyclictest [-i usec] [-l loops] [-p prio] [-b usec] [-q]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    long interval = 10000;
+    long loops = 1000;
+    int prio = 0;
+    long brk = 0;
+    int quiet = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: cyclictest [-i usec] [-l loops] [-p prio] [-b usec] [-q]\n");
+            printf("Measure how late periodic timer wakeups are.\n");
+            printf("-i sets the period (default 10000 us), -l the number of\n");
+            printf("wakeups (default 1000, 0 runs until interrupted), -p runs\n");
+            printf("as SCHED_FIFO at that priority, -b stops once a wakeup is\n");
+            printf("later than the given latency, -q prints only the summary.\n");
+            return 0;
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            interval = atol(argv[++i]);
+            if (interval <= 0)
+                usage();
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            loops = atol(argv[++i]);
+            if (loops < 0)
+                usage();
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            prio = atoi(argv[++i]);
+            if (prio < 1 || prio > 99)
+                usage();
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            brk = atol(argv[++i]);
+            if (brk <= 0)
+                usage();
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = 1;
+        } else {
+            usage();
+        }
+    }
+
+    if (prio) {
+        struct sched_param sp;
+        sp.sched_priority = prio;
+        if (sched_setscheduler(0, SCHED_FIFO, &sp) < 0) {
+            fprintf(stderr, "cyclictest: sched_setscheduler: %s\n", strerror(errno));
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    /* Sleeps end on timer ticks; start on one so the deadlines line up */
+    sleep_us(1);
+    uint64_t next = now_us();
+
+    uint64_t min = UINT64_MAX, max = 0, sum = 0, act = 0;
+    long count = 0, overruns = 0;
+    int broke = 0;
+
+    while (!stop && (loops == 0 || count < loops)) {
+        next += (uint64_t)interval;
+        uint64_t t = now_us();
+        if (t < next)
+            sleep_us(next - t);
+        t = now_us();
+
+        /* A tick-rounded sleep can end a little early; that is no latency */
+        act = t > next ? t - next : 0;
+        if (act < min) min = act;
+        if (act > max) max = act;
+        sum += act;
+        count++;
+
+        /* Missed whole periods: count them and resume from now */
+        if (act >= (uint64_t)interval) {
+            overruns += (long)(act / (uint64_t)interval);
+            next += act / (uint64_t)interval * (uint64_t)interval;
+        }
+
+        if (!quiet) {
+            printf("\rT: 0 (%5d) P:%2d I:%ld C:%7ld Min:%7llu Act:%7llu Avg:%7llu Max:%7llu",
+                   (int)getpid(), prio, interval, count,
+                   (unsigned long long)min, (unsigned long long)act,
+                   (unsigned long long)(sum / (uint64_t)count),
+                   (unsigned long long)max);
+            fflush(stdout);
+        }
+
+        if (brk && act > (uint64_t)brk) {
+            broke = 1;
+            break;
+        }
+    }
+
+    if (!count)
+        return 0;
+    if (!quiet)
+        printf("\n");
+    printf("T: 0 (%5d) P:%2d I:%ld C:%7ld Min:%7llu Avg:%7llu Max:%7llu Overruns:%ld\n",
+           (int)getpid(), prio, interval, count,
+           (unsigned long long)min,
+           (unsigned long long)(sum / (uint64_t)count),
+           (unsigned long long)max, overruns);
+    if (broke)
+        printf("# Break: wakeup %llu us late exceeds %ld us\n",
+               (unsigned long long)act, brk);
+    return broke ? 2 : 0;
+}
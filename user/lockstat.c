@@ -0,0 +1,148 @@
+/*
+ * lockstat - show spinlock contention and hold-time statistics
+ *
+ * Usage: lockstat [-z] [-a] [-s key] [-n count]
+ *
+ * Prints one line per lock class (locks sharing a name), busiest first.
+ * Needs a kernel built with LOCKSTAT=1.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/lockstat.h>
+
+#define MAX_CLASSES 1024
+
+enum { SORT_WAIT, SORT_HOLD, SORT_CONT, SORT_ACQ };
+
+static int sort_key = SORT_WAIT;
+static uint64_t tsc_hz;
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: lockstat [-z] [-a] [-s wait|hold|cont|acq] [-n count]\n");
+    exit(1);
+}
+
+static uint64_t key_of(const struct lockstat_entry *e)
+{
+    switch (sort_key) {
+    case SORT_HOLD: return e->hold_total;
+    case SORT_CONT: return e->contentions;
+    case SORT_ACQ:  return e->acquisitions;
+    default:        return e->wait_total;
+    }
+}
+
+static int compare(const void *a, const void *b)
+{
+    uint64_t ka = key_of(a), kb = key_of(b);
+    return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+/* Cycles as nanoseconds when the TSC rate is known */
+static unsigned long long scaled(uint64_t cycles)
+{
+    if (!tsc_hz)
+        return (unsigned long long)cycles;
+    return (unsigned long long)(cycles / tsc_hz * 1000000000ULL +
+                                cycles % tsc_hz * 1000000000ULL / tsc_hz);
+}
+
+int main(int argc, char *argv[])
+{
+    int limit = 20;
+    int all = 0;
+    int reset = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: lockstat [-z] [-a] [-s wait|hold|cont|acq] [-n count]\n");
+            printf("Show spinlock contention per lock class, busiest first.\n");
+            printf("-s picks the sort key, -n the number of classes (default 20),\n");
+            printf("-a includes classes never contended, -z zeroes the counters.\n");
+            return 0;
+        } else if (strcmp(argv[i], "-z") == 0) {
+            reset = 1;
+        } else if (strcmp(argv[i], "-a") == 0) {
+            all = 1;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            limit = atoi(argv[++i]);
+            if (limit <= 0)
+                usage();
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            const char *k = argv[++i];
+            if (strcmp(k, "wait") == 0)      sort_key = SORT_WAIT;
+            else if (strcmp(k, "hold") == 0) sort_key = SORT_HOLD;
+            else if (strcmp(k, "cont") == 0) sort_key = SORT_CONT;
+            else if (strcmp(k, "acq") == 0)  sort_key = SORT_ACQ;
+            else usage();
+        } else {
+            usage();
+        }
+    }
+
+    if (reset) {
+        if (lockstat(LOCKSTAT_RESET, NULL, 0) < 0) {
+            fprintf(stderr, "lockstat: cannot reset: %s\n", strerror(errno));
+            return 1;
+        }
+        return 0;
+    }
+
+    long hz = lockstat(LOCKSTAT_TSC_HZ, NULL, 0);
+    if (hz < 0) {
+        if (errno == ENOSYS)
+            fprintf(stderr, "lockstat: kernel was built without LOCKSTAT=1\n");
+        else
+            fprintf(stderr, "lockstat: %s\n", strerror(errno));
+        return 1;
+    }
+    tsc_hz = (uint64_t)hz;
+
+    struct lockstat_entry *e = malloc(MAX_CLASSES * sizeof(*e));
+    if (!e) {
+        fprintf(stderr, "lockstat: out of memory\n");
+        return 1;
+    }
+    long n = lockstat(LOCKSTAT_READ, e, MAX_CLASSES);
+    if (n < 0) {
+        fprintf(stderr, "lockstat: cannot read statistics: %s\n", strerror(errno));
+        free(e);
+        return 1;
+    }
+
+    qsort(e, (size_t)n, sizeof(*e), compare);
+
+    const char *unit = tsc_hz ? "ns" : "cycles";
+    printf("%-24s %12s %10s %6s %10s %10s %10s %10s  (%s)\n",
+           "class", "acquired", "contended", "cont%",
+           "wait-avg", "wait-max", "hold-avg", "hold-max", unit);
+
+    int shown = 0;
+    for (long i = 0; i < n && shown < limit; i++) {
+        const struct lockstat_entry *s = &e[i];
+        if (!s->acquisitions || (!all && !s->contentions && sort_key != SORT_HOLD &&
+                                 sort_key != SORT_ACQ))
+            continue;
+        unsigned long t = s->acquisitions ?
+            (unsigned long)(s->contentions * 1000 / s->acquisitions) : 0;
+        printf("%-24.24s %12llu %10llu %3lu.%lu%% %10llu %10llu %10llu %10llu\n",
+               s->name,
+               (unsigned long long)s->acquisitions,
+               (unsigned long long)s->contentions,
+               t / 10, t % 10,
+               scaled(s->contentions ? s->wait_total / s->contentions : 0),
+               scaled(s->wait_max),
+               scaled(s->hold_total / s->acquisitions),
+               scaled(s->hold_max));
+        shown++;
+    }
+    if (!shown)
+        printf("(no contended locks; -a shows all classes)\n");
+
+    free(e);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * nice - run a program with modified scheduling priority
+ *
+ * Usage: nice [-n adjustment] [command [arg ...]]
+ *        nice -adjustment command [arg ...]
+ *
+ * With no command, print the current niceness.  The default adjustment
+ * is 10.  The resulting nice value is clamped to -20..19.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/resource.h>
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: nice [-n adjustment] [command [arg ...]]\n");
+    exit(125);
+}
+
+/* Parse a signed decimal adjustment; returns 0 on success */
+static int parse_adj(const char *s, int *out)
+{
+    char *end;
+    long v;
+
+    if (!s || !*s)
+        return -1;
+    errno = 0;
+    v = strtol(s, &end, 10);
+    if (errno || *end || v < -1000 || v > 1000)
+        return -1;
+    *out = (int)v;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int adj = 10;
+    int i = 1;
+
+    if (i < argc && strcmp(argv[i], "--help") == 0) {
+        printf("Usage: nice [-n adjustment] [command [arg ...]]\n");
+        printf("Run COMMAND with an adjusted niceness (default 10).\n");
+        printf("With no COMMAND, print the current niceness.\n");
+        return 0;
+    }
+
+    if (i < argc && strcmp(argv[i], "-n") == 0) {
+        if (i + 1 >= argc || parse_adj(argv[i + 1], &adj) < 0) {
+            fprintf(stderr, "nice: invalid adjustment '%s'\n",
+                    i + 1 < argc ? argv[i + 1] : "");
+            usage();
+        }
+        i += 2;
+    } else if (i < argc && strncmp(argv[i], "-n", 2) == 0 && argv[i][2]) {
+        if (parse_adj(argv[i] + 2, &adj) < 0) {
+            fprintf(stderr, "nice: invalid adjustment '%s'\n", argv[i] + 2);
+            usage();
+        }
+        i++;
+    } else if (i < argc && argv[i][0] == '-' && argv[i][1] &&
+               strcmp(argv[i], "--") != 0) {
+        /* Historical form: nice -5 cmd, nice --5 cmd */
+        if (parse_adj(argv[i] + 1, &adj) < 0) {
+            fprintf(stderr, "nice: invalid option '%s'\n", argv[i]);
+            usage();
+        }
+        i++;
+    }
+    if (i < argc && strcmp(argv[i], "--") == 0)
+        i++;
+
+    if (i >= argc) {
+        errno = 0;
+        int cur = getpriority(PRIO_PROCESS, 0);
+        if (cur == -1 && errno) {
+            fprintf(stderr, "nice: cannot get niceness: %s\n", strerror(errno));
+            return 125;
+        }
+        printf("%d\n", cur);
+        return 0;
+    }
+
+    errno = 0;
+    if (nice(adj) == -1 && errno) {
+        fprintf(stderr, "nice: cannot set niceness: %s\n", strerror(errno));
+        return 125;
+    }
+
+    execvp(argv[i], &argv[i]);
+    fprintf(stderr, "nice: %s: %s\n", argv[i], strerror(errno));
+    return errno == ENOENT ? 127 : 126;
+}
@@ -51,6 +51,7 @@ enum {
     COL_ADDR,
     COL_LABEL,
     COL_PENDING, COL_BLOCKED, COL_IGNORED, COL_CAUGHT,
+    COL_DELAY, COL_NVCSW, COL_NIVCSW, COL_MIGR, COL_BLKTIME, COL_WLAT,
     COL__COUNT
 };
 
@@ -70,6 +71,7 @@ static const col_spec_t col_specs[] = {
     { "%mem",       "%MEM",     4, 1, COL_PMEM   },
     { "addr",       "ADDR",     4, 1, COL_ADDR   },
     { "args",       "COMMAND", 27, 0, COL_ARGS   },
+    { "blktime",    "BLOCK",    8, 1, COL_BLKTIME },
     { "blocked",    "BLOCKED", 16, 0, COL_BLOCKED },
     { "bsdstart",   "START",    6, 1, COL_START  },
     { "bsdtime",    "TIME",     6, 1, COL_TIME   },
@@ -82,6 +84,7 @@ static const col_spec_t col_specs[] = {
     { "command",    "COMMAND", 27, 0, COL_ARGS   },
     { "cp",         "CP",       3, 1, COL_C      },
     { "cputime",    "TIME",    11, 1, COL_TIME   },
+    { "delay",      "DELAY",    8, 1, COL_DELAY  },
     { "egid",       "EGID",     5, 1, COL_EGID  },
     { "egroup",     "EGROUP",   8, 0, COL_EGID  },
     { "etime",      "ELAPSED", 11, 1, COL_ETIME  },
@@ -98,9 +101,12 @@ static const col_spec_t col_specs[] = {
     { "label",      "LABEL",   25, 0, COL_LABEL  },
     { "lstart",     "STARTED", 24, 0, COL_LSTART },
     { "lwp",        "LWP",      5, 1, COL_LWP   },
+    { "migr",       "MIGR",     5, 1, COL_MIGR  },
     { "ni",         "NI",       3, 1, COL_NI    },
     { "nice",       "NI",       3, 1, COL_NI    },
+    { "nivcsw",     "NIVCSW",   7, 1, COL_NIVCSW },
     { "nlwp",       "NLWP",     4, 1, COL_NLWP  },
+    { "nvcsw",      "NVCSW",    7, 1, COL_NVCSW },
     { "opri",       "PRI",      3, 1, COL_PRI   },
     { "pcpu",       "%CPU",     4, 1, COL_PCPU  },
     { "pending",    "PENDING", 16, 0, COL_PENDING},
@@ -148,6 +154,7 @@ static const col_spec_t col_specs[] = {
     { "vsize",      "VSZ",      7, 1, COL_VSZ   },
     { "vsz",        "VSZ",      7, 1, COL_VSZ   },
     { "wchan",      "WCHAN",    6, 0, COL_WCHAN  },
+    { "wlat",       "WLAT",     7, 1, COL_WLAT   },
     { NULL, NULL, 0, 0, 0 }
 };
 
@@ -309,6 +316,21 @@ static void fmt_etime(uint64_t sec, char *buf, size_t sz) {
         snprintf(buf, sz, "%02u:%02u", m, s);
 }
 
+/* Nanoseconds as milliseconds with one decimal */
+static void fmt_ms(uint64_t ns, char *buf, size_t sz) {
+    uint64_t tenths = ns / 100000;
+    snprintf(buf, sz, "%lu.%lu", (unsigned long)(tenths / 10),
+             (unsigned long)(tenths % 10));
+}
+
+/* Highest non-empty wakeup latency bucket, -1 if the task never woke */
+static int wlat_bucket(const procinfo_t *p) {
+    for (int i = PROCINFO_LAT_BUCKETS - 1; i >= 0; i--)
+        if (p->wakeup_hist[i])
+            return i;
+    return -1;
+}
+
 static int detect_term_width(void) {
     struct winsize ws;
     if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
@@ -675,6 +697,24 @@ static void format_value(const procinfo_t *p, int id, char *buf, size_t sz) {
         snprintf(buf, sz, "0000000000000000");
         break;
 
+    case COL_DELAY:   fmt_ms(p->run_delay_ns, buf, sz); break;
+    case COL_BLKTIME: fmt_ms(p->block_ns, buf, sz); break;
+    case COL_NVCSW:   snprintf(buf, sz, "%lu", (unsigned long)p->nvcsw); break;
+    case COL_NIVCSW:  snprintf(buf, sz, "%lu", (unsigned long)p->nivcsw); break;
+    case COL_MIGR:    snprintf(buf, sz, "%lu", (unsigned long)p->nr_migrations); break;
+
+    /* Worst wakeup-to-run latency, as the upper bound of its log2 bucket */
+    case COL_WLAT: {
+        int b = wlat_bucket(p);
+        if (b < 0)
+            snprintf(buf, sz, "-");
+        else if (b == PROCINFO_LAT_BUCKETS - 1)
+            snprintf(buf, sz, ">%lums", (1UL << (b - 1)) / 1000);
+        else
+            snprintf(buf, sz, "<%luus", 1UL << b);
+        break;
+    }
+
     case COL_START: {
         time_t st = g_boot + (time_t)(p->start_tick / HZ);
         struct tm tm;
@@ -860,6 +900,18 @@ static int cmp_field(const procinfo_t *a, const procinfo_t *b, int id) {
         int64_t d = (int64_t)a->start_tick - (int64_t)b->start_tick;
         return (d > 0) ? 1 : (d < 0) ? -1 : 0;
     }
+    case COL_DELAY:
+        return (a->run_delay_ns > b->run_delay_ns) ? 1 : (a->run_delay_ns < b->run_delay_ns) ? -1 : 0;
+    case COL_BLKTIME:
+        return (a->block_ns > b->block_ns) ? 1 : (a->block_ns < b->block_ns) ? -1 : 0;
+    case COL_NVCSW:
+        return (a->nvcsw > b->nvcsw) ? 1 : (a->nvcsw < b->nvcsw) ? -1 : 0;
+    case COL_NIVCSW:
+        return (a->nivcsw > b->nivcsw) ? 1 : (a->nivcsw < b->nivcsw) ? -1 : 0;
+    case COL_MIGR:
+        return (a->nr_migrations > b->nr_migrations) ? 1 :
+               (a->nr_migrations < b->nr_migrations) ? -1 : 0;
+    case COL_WLAT:  return wlat_bucket(a) - wlat_bucket(b);
     default: return 0;
     }
 }
@@ -1047,6 +1099,7 @@ static void print_help(void) {
 "  stat state s tty time etime etimes %%cpu pcpu c %%mem pmem\n"
 "  rss vsz sz pri ni nlwp lwp psr cls f wchan start lstart addr\n"
 "  pending blocked ignored caught label\n"
+"  delay nvcsw nivcsw migr blktime wlat\n"
     );
 }
 
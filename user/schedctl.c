@@ -0,0 +1,216 @@
+/*
+ * schedctl - show or change scheduler placement tunables
+ *
+ * Usage: schedctl [-c] [-r] [-z] [name=value ...]
+ *
+ * With no arguments, print every tunable and the wakeup placement
+ * counters.  Each name=value argument sets a tunable; -c prints the
+ * per-CPU idle state counters; -r the per-CPU run queue statistics and
+ * wakeup latency histograms; -z zeroes the counters.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/schedctl.h>
+
+static const struct {
+    const char *name;
+    int id;
+    const char *help;
+} tunables[] = {
+    { "wake_affine",    SCHED_TUNE_WAKE_AFFINE,    "consider the waker's CPU (0/1)" },
+    { "wake_imbalance", SCHED_TUNE_WAKE_IMBALANCE, "waker CPU load limit, percent" },
+    { "wake_idle_scan", SCHED_TUNE_WAKE_IDLE_SCAN, "CPUs searched for an idle sibling" },
+    { "migration_cost", SCHED_TUNE_MIGRATION_COST, "cache-hot window, ns" },
+};
+
+#define NTUNABLES (sizeof(tunables) / sizeof(tunables[0]))
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: schedctl [-c] [-r] [-z] [name=value ...]\n");
+    exit(1);
+}
+
+/* Percentage of part in total, one decimal place, as tenths */
+static unsigned long tenths(uint64_t part, uint64_t total)
+{
+    return total ? (unsigned long)(part * 1000 / total) : 0;
+}
+
+static void print_stat(const char *label, uint64_t v, uint64_t total)
+{
+    unsigned long t = tenths(v, total);
+    printf("  %-16s %12llu  %3lu.%lu%%\n", label, (unsigned long long)v,
+           t / 10, t % 10);
+}
+
+static int show(void)
+{
+    for (size_t i = 0; i < NTUNABLES; i++) {
+        uint64_t v;
+        if (schedctl(SCHEDCTL_GET, tunables[i].id, (unsigned long)&v) < 0) {
+            fprintf(stderr, "schedctl: %s: %s\n", tunables[i].name, strerror(errno));
+            return 1;
+        }
+        printf("%-16s %-12llu # %s\n", tunables[i].name,
+               (unsigned long long)v, tunables[i].help);
+    }
+
+    struct sched_wakestats ws;
+    if (schedctl(SCHEDCTL_WAKESTATS, 0, (unsigned long)&ws) < 0) {
+        fprintf(stderr, "schedctl: cannot read statistics: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("\nwakeups %llu\n", (unsigned long long)ws.wakeups);
+    print_stat("previous CPU", ws.wake_prev, ws.wakeups);
+    print_stat("waker's CPU", ws.wake_affine, ws.wakeups);
+    print_stat("idle sibling", ws.wake_idle, ws.wakeups);
+    print_stat("migrated", ws.wake_migrations, ws.wakeups);
+    printf("  %-16s %12llu\n", "remote IPIs", (unsigned long long)ws.wake_ipis);
+    return 0;
+}
+
+static int show_idle(void)
+{
+    for (int cpu = 0; ; cpu++) {
+        struct sched_idlestats is;
+        if (schedctl(SCHEDCTL_IDLESTATS, cpu, (unsigned long)&is) < 0) {
+            if (errno == EINVAL && cpu > 0)
+                return 0;
+            fprintf(stderr, "schedctl: cannot read idle statistics: %s\n", strerror(errno));
+            return 1;
+        }
+
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < is.nr_states; i++)
+            total += is.states[i].time_ns;
+
+        printf("%scpu%d: %s, %llu IPIs avoided\n", cpu ? "\n" : "", cpu,
+               is.polling ? "mwait" : "hlt", (unsigned long long)is.ipis_avoided);
+        printf("  %-6s %-6s %8s %12s %12s %7s\n",
+               "state", "hint", "latency", "usage", "time(ms)", "time");
+        for (uint32_t i = 0; i < is.nr_states && i < SCHED_IDLE_MAX_STATES; i++) {
+            const struct sched_idlestate *st = &is.states[i];
+            char hint[8];
+            if (st->mwait_hint == SCHED_IDLE_HLT)
+                snprintf(hint, sizeof(hint), "hlt");
+            else
+                snprintf(hint, sizeof(hint), "0x%02x", st->mwait_hint);
+            unsigned long t = tenths(st->time_ns, total);
+            printf("  C%-5u %-6s %6uus %12llu %12llu  %3lu.%lu%%\n",
+                   st->type, hint, st->latency_us,
+                   (unsigned long long)st->usage,
+                   (unsigned long long)(st->time_ns / 1000000),
+                   t / 10, t % 10);
+        }
+    }
+}
+
+static int show_runq(void)
+{
+    for (int cpu = 0; ; cpu++) {
+        struct sched_cpustats cs;
+        if (schedctl(SCHEDCTL_CPUSTATS, cpu, (unsigned long)&cs) < 0) {
+            if (errno == EINVAL && cpu > 0)
+                return 0;
+            fprintf(stderr, "schedctl: cannot read CPU statistics: %s\n", strerror(errno));
+            return 1;
+        }
+
+        uint64_t wakeups = 0;
+        for (int i = 0; i < SCHED_STAT_LAT_BUCKETS; i++)
+            wakeups += cs.wakeup_hist[i];
+
+        printf("%scpu%d: %llu switches, %llu runs, %llu migrated in\n", cpu ? "\n" : "",
+               cpu, (unsigned long long)cs.context_switches,
+               (unsigned long long)cs.pcount, (unsigned long long)cs.migrations);
+        printf("  run delay %llu ms total, %llu us per run\n",
+               (unsigned long long)(cs.run_delay_ns / 1000000),
+               (unsigned long long)(cs.pcount ? cs.run_delay_ns / cs.pcount / 1000 : 0));
+        printf("  irq time %llu ms\n", (unsigned long long)(cs.irq_time_ns / 1000000));
+        printf("  %-16s %12s\n", "wakeup latency", "count");
+        for (int i = 0; i < SCHED_STAT_LAT_BUCKETS; i++) {
+            if (!cs.wakeup_hist[i])
+                continue;
+            char range[24];
+            if (i == 0)
+                snprintf(range, sizeof(range), "< 1 us");
+            else if (i == SCHED_STAT_LAT_BUCKETS - 1)
+                snprintf(range, sizeof(range), ">= %lu us", 1UL << (i - 1));
+            else
+                snprintf(range, sizeof(range), "%lu-%lu us", 1UL << (i - 1), (1UL << i) - 1);
+            print_stat(range, cs.wakeup_hist[i], wakeups);
+        }
+    }
+}
+
+static int set(const char *arg)
+{
+    const char *eq = strchr(arg, '=');
+    if (!eq || eq == arg || !eq[1]) {
+        fprintf(stderr, "schedctl: expected name=value, got '%s'\n", arg);
+        return 1;
+    }
+
+    size_t len = (size_t)(eq - arg);
+    for (size_t i = 0; i < NTUNABLES; i++) {
+        if (strlen(tunables[i].name) != len || strncmp(tunables[i].name, arg, len) != 0)
+            continue;
+        char *end;
+        errno = 0;
+        unsigned long long v = strtoull(eq + 1, &end, 10);
+        if (errno || *end) {
+            fprintf(stderr, "schedctl: invalid value '%s'\n", eq + 1);
+            return 1;
+        }
+        if (schedctl(SCHEDCTL_SET, tunables[i].id, (unsigned long)v) < 0) {
+            fprintf(stderr, "schedctl: %s=%llu: %s\n", tunables[i].name, v, strerror(errno));
+            return 1;
+        }
+        return 0;
+    }
+    fprintf(stderr, "schedctl: unknown tunable '%.*s'\n", (int)len, arg);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int i = 1;
+    int rc = 0;
+
+    if (i < argc && strcmp(argv[i], "--help") == 0) {
+        printf("Usage: schedctl [-c] [-r] [-z] [name=value ...]\n");
+        printf("Show scheduler placement tunables and wakeup statistics,\n");
+        printf("or set tunables.  -c shows per-CPU idle states, -r per-CPU\n");
+        printf("run queue delay and wakeup latency, -z zeroes the statistics.\n");
+        return 0;
+    }
+
+    if (i < argc && strcmp(argv[i], "-c") == 0)
+        return show_idle();
+
+    if (i < argc && strcmp(argv[i], "-r") == 0)
+        return show_runq();
+
+    if (i < argc && strcmp(argv[i], "-z") == 0) {
+        if (schedctl(SCHEDCTL_RESET_STATS, 0, 0) < 0) {
+            fprintf(stderr, "schedctl: cannot reset statistics: %s\n", strerror(errno));
+            return 1;
+        }
+        i++;
+        if (i >= argc)
+            return 0;
+    } else if (i < argc && argv[i][0] == '-') {
+        usage();
+    }
+
+    if (i >= argc)
+        return show();
+
+    for (; i < argc; i++)
+        rc |= set(argv[i]);
+    return rc;
+}
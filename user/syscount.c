@@ -0,0 +1,282 @@
+/*
+ * syscount - count syscalls and their latency
+ *
+ * Usage: syscount [-p pid] [-s key] [-n count] [-L] [seconds]
+ *
+ * Turns on the kernel's per-syscall accounting, waits for the given
+ * number of seconds (or until interrupted), then prints the syscalls
+ * that took the most time, system-wide or for one process.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscallstat.h>
+
+#define MAX_SYSCALLS 512
+
+enum { SORT_TIME, SORT_CALLS, SORT_ERRORS, SORT_MAX };
+
+static int sort_key = SORT_TIME;
+static uint64_t tsc_hz;
+static sig_atomic_t interrupted;
+
+static const char *const syscall_names[MAX_SYSCALLS] = {
+    [0] = "read", [1] = "write", [2] = "open", [3] = "close", [8] = "lseek",
+    [9] = "mmap", [11] = "munmap", [12] = "brk", [22] = "pipe",
+    [24] = "yield", [32] = "dup", [33] = "dup2", [39] = "getpid",
+    [57] = "fork", [59] = "execve", [60] = "exit", [61] = "wait4",
+    [110] = "getppid", [200] = "stat", [201] = "lstat", [202] = "fstat",
+    [203] = "access", [204] = "chdir", [205] = "getcwd", [206] = "umask",
+    [207] = "getuid", [208] = "getgid", [209] = "geteuid", [210] = "getegid",
+    [211] = "getgroups", [212] = "setgroups", [213] = "gethostname",
+    [214] = "uname", [215] = "time", [216] = "gettimeofday", [217] = "fsync",
+    [218] = "ftruncate", [219] = "fcntl", [220] = "ioctl", [221] = "setpgid",
+    [222] = "getpgrp", [223] = "tcgetpgrp", [224] = "tcsetpgrp",
+    [225] = "kill", [227] = "setuid", [228] = "setgid", [229] = "seteuid",
+    [230] = "setegid", [231] = "unlink", [232] = "rename", [233] = "mkdir",
+    [234] = "rmdir", [235] = "link", [236] = "symlink", [237] = "readlink",
+    [238] = "chmod", [239] = "fchmod", [240] = "chown", [241] = "fchown",
+    [242] = "openat", [243] = "fstatat", [244] = "faccessat",
+    [245] = "getdents64", [246] = "getdents", [250] = "rt_sigaction",
+    [251] = "rt_sigprocmask", [252] = "rt_sigpending",
+    [253] = "rt_sigtimedwait", [254] = "rt_sigqueueinfo",
+    [255] = "rt_sigsuspend", [256] = "rt_sigreturn", [257] = "sigaltstack",
+    [258] = "tkill", [259] = "tgkill", [260] = "alarm", [261] = "setitimer",
+    [262] = "getitimer", [263] = "timer_create", [264] = "timer_settime",
+    [265] = "timer_gettime", [266] = "timer_getoverrun",
+    [267] = "timer_delete", [268] = "signalfd", [269] = "signalfd4",
+    [270] = "pause", [271] = "nanosleep", [272] = "clock_gettime",
+    [273] = "clock_getres", [300] = "memstats", [310] = "clone",
+    [311] = "vfork", [312] = "exit_group", [313] = "gettid",
+    [314] = "set_tid_address", [315] = "futex", [316] = "set_robust_list",
+    [317] = "get_robust_list", [318] = "arch_prctl", [319] = "futex_requeue",
+    [320] = "sched_setaffinity", [321] = "sched_getaffinity",
+    [322] = "sched_setscheduler", [323] = "sched_getscheduler",
+    [324] = "sched_setparam", [325] = "sched_getparam",
+    [326] = "sched_get_priority_max", [327] = "sched_get_priority_min",
+    [328] = "sched_rr_get_interval", [329] = "mprotect", [330] = "reboot",
+    [331] = "getprocinfo", [332] = "utimensat", [333] = "statfs",
+    [334] = "fstatfs", [335] = "sysinfo", [336] = "klogctl",
+    [337] = "settimeofday", [338] = "sync", [340] = "socket", [341] = "bind",
+    [342] = "listen", [343] = "accept", [344] = "connect", [345] = "sendto",
+    [346] = "recvfrom", [347] = "send", [348] = "recv", [349] = "shutdown",
+    [350] = "setsockopt", [351] = "getsockopt", [352] = "getpeername",
+    [353] = "getsockname", [354] = "socketpair", [355] = "accept4",
+    [356] = "sendmsg", [357] = "recvmsg", [358] = "sendfile",
+    [359] = "select", [360] = "pselect6", [361] = "poll", [362] = "ppoll",
+    [363] = "epoll_create", [364] = "epoll_create1", [365] = "epoll_ctl",
+    [366] = "epoll_wait", [367] = "epoll_pwait", [368] = "dup3",
+    [369] = "dns_resolve", [370] = "sethostname", [371] = "net_getinfo",
+    [372] = "dhcp_control", [373] = "raw_send", [374] = "raw_recv",
+    [375] = "dns_resolve_reverse", [376] = "set_dns_server", [380] = "setsid",
+    [381] = "getsid", [382] = "getpgid", [383] = "getrusage", [384] = "readv",
+    [385] = "writev", [386] = "getpriority", [387] = "setpriority",
+    [388] = "schedctl", [389] = "lockstat", [390] = "times", [391] = "rseq",
+    [392] = "getcpu", [393] = "syscallstat", [394] = "io_uring_setup",
+    [395] = "io_uring_enter", [396] = "splice", [397] = "tee", [398] = "vmsplice",
+    [399] = "eventfd2", [400] = "timerfd_create", [401] = "timerfd_settime",
+    [402] = "timerfd_gettime", [403] = "pread64", [404] = "pwrite64",
+    [405] = "preadv", [406] = "pwritev", [407] = "preadv2", [408] = "pwritev2",
+    [409] = "memfd_create",
+};
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: syscount [-p pid] [-s time|calls|errors|max] [-n count] [-L] [seconds]\n");
+    exit(1);
+}
+
+static void on_interrupt(int sig)
+{
+    (void)sig;
+    interrupted = 1;
+}
+
+static uint64_t key_of(const struct syscallstat_entry *e)
+{
+    switch (sort_key) {
+    case SORT_CALLS:  return e->calls;
+    case SORT_ERRORS: return e->errors;
+    case SORT_MAX:    return e->time_max;
+    default:          return e->time_total;
+    }
+}
+
+static int compare(const void *a, const void *b)
+{
+    uint64_t ka = key_of(a), kb = key_of(b);
+    return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+/* Cycles as nanoseconds when the TSC rate is known */
+static unsigned long long scaled(uint64_t cycles)
+{
+    if (!tsc_hz)
+        return (unsigned long long)cycles;
+    return (unsigned long long)(cycles / tsc_hz * 1000000000ULL +
+                                cycles % tsc_hz * 1000000000ULL / tsc_hz);
+}
+
+static void name_of(uint32_t nr, char *buf, size_t len)
+{
+    if (nr < MAX_SYSCALLS && syscall_names[nr])
+        snprintf(buf, len, "%s", syscall_names[nr]);
+    else
+        snprintf(buf, len, "syscall_%u", nr);
+}
+
+/* Lower bound of histogram bucket b, in cycles */
+static uint64_t bucket_low(int b)
+{
+    return b ? (uint64_t)1 << (b + 5) : 0;
+}
+
+static void print_hist(const struct syscallstat_entry *e, const char *unit)
+{
+    int first = -1, last = -1;
+    uint64_t peak = 0;
+    for (int b = 0; b < SYSCALLSTAT_BUCKETS; b++) {
+        if (!e->hist[b])
+            continue;
+        if (first < 0)
+            first = b;
+        last = b;
+        if (e->hist[b] > peak)
+            peak = e->hist[b];
+    }
+    if (first < 0)
+        return;
+
+    printf("  %12s %-14s %10s  distribution\n", unit, "", "count");
+    for (int b = first; b <= last; b++) {
+        int stars = (int)(e->hist[b] * 40 / peak);
+        char bar[41];
+        memset(bar, '*', (size_t)stars);
+        bar[stars] = '\0';
+        if (b == SYSCALLSTAT_BUCKETS - 1)
+            printf("  %12llu -> %-11s %10llu  |%-40s|\n",
+                   scaled(bucket_low(b)), "...",
+                   (unsigned long long)e->hist[b], bar);
+        else
+            printf("  %12llu -> %-11llu %10llu  |%-40s|\n",
+                   scaled(bucket_low(b)), scaled(bucket_low(b + 1) - 1),
+                   (unsigned long long)e->hist[b], bar);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int limit = 20;
+    int pid = 0;
+    int seconds = 0;
+    int hist = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: syscount [-p pid] [-s time|calls|errors|max] [-n count] [-L] [seconds]\n");
+            printf("Count syscalls for the given number of seconds, or until interrupted,\n");
+            printf("and show those that took the most time.  -p traces one process,\n");
+            printf("-s picks the sort key, -n the number of syscalls (default 20),\n");
+            printf("-L adds a latency histogram for each syscall shown.\n");
+            return 0;
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            pid = atoi(argv[++i]);
+            if (pid <= 0)
+                usage();
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            limit = atoi(argv[++i]);
+            if (limit <= 0)
+                usage();
+        } else if (strcmp(argv[i], "-L") == 0) {
+            hist = 1;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            const char *k = argv[++i];
+            if (strcmp(k, "time") == 0)        sort_key = SORT_TIME;
+            else if (strcmp(k, "calls") == 0)  sort_key = SORT_CALLS;
+            else if (strcmp(k, "errors") == 0) sort_key = SORT_ERRORS;
+            else if (strcmp(k, "max") == 0)    sort_key = SORT_MAX;
+            else usage();
+        } else if (argv[i][0] >= '0' && argv[i][0] <= '9' && !seconds) {
+            seconds = atoi(argv[i]);
+            if (seconds <= 0)
+                usage();
+        } else {
+            usage();
+        }
+    }
+
+    if (pid && kill(pid, 0) < 0) {
+        fprintf(stderr, "syscount: no process %d\n", pid);
+        return 1;
+    }
+
+    long hz = syscallstat(SYSCALLSTAT_TSC_HZ, 0, 0);
+    tsc_hz = hz > 0 ? (uint64_t)hz : 0;
+
+    signal(SIGINT, on_interrupt);
+    if (syscallstat(SYSCALLSTAT_ENABLE, (unsigned long)pid, 0) < 0) {
+        fprintf(stderr, "syscount: cannot enable accounting: %s\n", strerror(errno));
+        return 1;
+    }
+
+    if (pid)
+        printf("Tracing syscalls of process %d", pid);
+    else
+        printf("Tracing syscalls");
+    if (seconds)
+        printf(" for %d seconds...\n", seconds);
+    else
+        printf(", Ctrl-C to end...\n");
+    fflush(stdout);
+
+    for (int t = 0; !interrupted && (!seconds || t < seconds); t++) {
+        sleep(1);
+        if (pid && kill(pid, 0) < 0)
+            break;
+    }
+    syscallstat(SYSCALLSTAT_DISABLE, 0, 0);
+
+    struct syscallstat_entry *e = malloc(MAX_SYSCALLS * sizeof(*e));
+    if (!e) {
+        fprintf(stderr, "syscount: out of memory\n");
+        return 1;
+    }
+    long n = syscallstat(SYSCALLSTAT_READ, (unsigned long)e, MAX_SYSCALLS);
+    if (n < 0) {
+        fprintf(stderr, "syscount: cannot read statistics: %s\n", strerror(errno));
+        free(e);
+        return 1;
+    }
+
+    qsort(e, (size_t)n, sizeof(*e), compare);
+
+    const char *unit = tsc_hz ? "ns" : "cycles";
+    printf("\n%-22s %10s %8s %14s %10s %12s  (%s)\n",
+           "syscall", "calls", "errors", "total", "avg", "max", unit);
+    int shown = 0;
+    for (long i = 0; i < n && shown < limit; i++) {
+        const struct syscallstat_entry *s = &e[i];
+        char name[32];
+        name_of(s->nr, name, sizeof(name));
+        printf("%-22s %10llu %8llu %14llu %10llu %12llu\n",
+               name,
+               (unsigned long long)s->calls,
+               (unsigned long long)s->errors,
+               scaled(s->time_total),
+               scaled(s->time_total / s->calls),
+               scaled(s->time_max));
+        if (hist)
+            print_hist(s, unit);
+        shown++;
+    }
+    if (!shown)
+        printf("(no syscalls)\n");
+
+    free(e);
+    return 0;
+}
@@ -8,7 +8,23 @@
 #include <fcntl.h>
 #include <sched.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/rseq.h>
+#include <sys/syscallstat.h>
+#include <liburing.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdint.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../userland/libc/src/syscalls/syscall.h"
 
 #define TEST_PASS "[PASS] "
 #define TEST_FAIL "[FAIL] "
@@ -180,6 +196,537 @@ static void test_open_close(void) {
     test_result(ret < 0, "cannot close stdin");
 }
 
+// Test rseq registration and the per-CPU fast paths built on it
+static void test_rseq(void) {
+    printf(TEST_INFO "Testing rseq / sched_getcpu()...\n");
+
+    struct rseq* rs = rseq_thread_area();
+    test_result(rs != NULL, "main thread has an rseq area");
+    if (!rs)
+        return;
+
+    unsigned int cpu = 0;
+    int ret = getcpu(&cpu, NULL);
+    int fast = sched_getcpu();
+    printf("  getcpu = %u, sched_getcpu = %d\n", cpu, fast);
+    test_result(ret == 0 && fast >= 0, "getcpu and sched_getcpu succeed");
+
+    ret = rseq(rs, sizeof(*rs), 0, RSEQ_SIG);
+    test_result(ret < 0 && errno == EBUSY, "re-registering the same area gives EBUSY");
+
+    static intptr_t counters[64 * 8];
+    for (int i = 0; i < 100000; i++)
+        rseq_percpu_add(counters, 8 * sizeof(intptr_t), 1);
+    intptr_t sum = 0;
+    for (int i = 0; i < 64; i++)
+        sum += counters[i * 8];
+    test_result(sum == 100000, "rseq_percpu_add counts every add");
+}
+
+static void test_syscallstat(void) {
+    printf(TEST_INFO "Testing per-syscall statistics...\n");
+
+    int ret = (int)syscallstat(SYSCALLSTAT_ENABLE, (unsigned long)getpid(), 0);
+    test_result(ret == 0, "syscallstat enable for this process");
+    if (ret != 0)
+        return;
+    for (int i = 0; i < 100; i++)
+        getppid();
+    for (int i = 0; i < 10; i++)
+        close(-1);
+    syscallstat(SYSCALLSTAT_DISABLE, 0, 0);
+
+    static struct syscallstat_entry e[512];
+    long n = syscallstat(SYSCALLSTAT_READ, (unsigned long)e, 512);
+    test_result(n > 0, "syscallstat read returns entries");
+
+    uint64_t ppid_calls = 0, close_errors = 0;
+    for (long i = 0; i < n; i++) {
+        if (e[i].nr == SYS_GETPPID)
+            ppid_calls = e[i].calls;
+        else if (e[i].nr == SYS_CLOSE)
+            close_errors = e[i].errors;
+    }
+    printf("  getppid calls = %llu, close errors = %llu\n",
+           (unsigned long long)ppid_calls, (unsigned long long)close_errors);
+    test_result(ppid_calls == 100, "every getppid call is counted");
+    test_result(close_errors == 10, "failed close calls are counted as errors");
+}
+
+static void test_io_uring(void) {
+    printf(TEST_INFO "Testing io_uring...\n");
+
+    struct io_uring ring;
+    int ret = io_uring_queue_init(8, &ring, 0);
+    test_result(ret == 0, "io_uring_queue_init");
+    if (ret != 0)
+        return;
+
+    struct io_uring_cqe* cqe;
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_nop(sqe);
+    io_uring_sqe_set_data64(sqe, 42);
+    ret = io_uring_submit_and_wait(&ring, 1);
+    test_result(ret == 1 && io_uring_peek_cqe(&ring, &cqe) == 0 &&
+                cqe->user_data == 42 && cqe->res == 0, "NOP completes");
+    io_uring_cqe_seen(&ring, cqe);
+
+    // The read is queued before there is data and completes once the
+    // write lands; the linked write then runs
+    int fds[2];
+    char buf[16] = {0};
+    pipe(fds);
+    sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_read(sqe, fds[0], buf, sizeof(buf), (uint64_t)-1);
+    io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK);
+    io_uring_sqe_set_data64(sqe, 1);
+    sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_write(sqe, fds[1], "again", 5, (uint64_t)-1);
+    io_uring_sqe_set_data64(sqe, 2);
+    io_uring_submit(&ring);
+    write(fds[1], "ring", 4);
+    ret = io_uring_wait_cqe_nr(&ring, &cqe, 2);
+    int read_ok = ret == 0 && cqe->user_data == 1 && cqe->res == 4 && memcmp(buf, "ring", 4) == 0;
+    io_uring_cqe_seen(&ring, cqe);
+    ret = io_uring_peek_cqe(&ring, &cqe);
+    int write_ok = ret == 0 && cqe->user_data == 2 && cqe->res == 5;
+    io_uring_cqe_seen(&ring, cqe);
+    test_result(read_ok, "READ on an empty pipe completes after a write");
+    test_result(write_ok, "linked WRITE runs after the READ");
+
+    struct timespec ts = { 0, 20 * 1000 * 1000 };
+    sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_timeout(sqe, &ts, 0, 0);
+    ret = io_uring_submit_and_wait(&ring, 1);
+    test_result(ret == 1 && io_uring_peek_cqe(&ring, &cqe) == 0 && cqe->res == -ETIME,
+                "TIMEOUT expires with ETIME");
+    io_uring_cqe_seen(&ring, cqe);
+
+    close(fds[0]);
+    close(fds[1]);
+    io_uring_queue_exit(&ring);
+}
+
+static void test_pipe_size(void) {
+    printf(TEST_INFO "Testing pipe capacity / F_SETPIPE_SZ...\n");
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        test_result(0, "pipe");
+        return;
+    }
+    test_result(fcntl(fds[0], F_GETPIPE_SZ) == 65536, "default capacity is 64 KiB");
+
+    // A full default pipe takes 64 KiB without blocking
+    static char buf[65536];
+    memset(buf, 'p', sizeof(buf));
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    test_result(write(fds[1], buf, sizeof(buf)) == (ssize_t)sizeof(buf),
+                "64 KiB write into an empty pipe");
+    test_result(write(fds[1], buf, 1) < 0 && errno == EAGAIN, "full pipe returns EAGAIN");
+    test_result(fcntl(fds[1], F_SETPIPE_SZ, 4096) < 0 && errno == EBUSY,
+                "cannot shrink below the buffered data");
+
+    test_result(read(fds[0], buf, sizeof(buf)) == (ssize_t)sizeof(buf), "read drains the pipe");
+    test_result(fcntl(fds[1], F_SETPIPE_SZ, 100000) == 131072, "F_SETPIPE_SZ rounds up");
+    test_result(fcntl(fds[1], F_SETPIPE_SZ, 64 * 1024 * 1024) < 0 && errno == EPERM,
+                "F_SETPIPE_SZ above the limit fails");
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void test_splice(void) {
+    printf(TEST_INFO "Testing splice / tee / vmsplice...\n");
+
+    const char* path = "/SPLICE.TXT";
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        test_result(0, "create test file");
+        return;
+    }
+    write(fd, "spliced data", 12);
+    close(fd);
+
+    int a[2], b[2];
+    pipe(a);
+    pipe(b);
+    fd = open(path, O_RDONLY);
+    char buf[32] = {0};
+
+    loff_t off = 8;
+    test_result(splice(fd, &off, a[1], NULL, sizeof(buf), 0) == 4 && off == 12,
+                "splice from a file offset into a pipe");
+    test_result(splice(fd, NULL, a[1], NULL, 7, 0) == 7, "splice from the file position");
+    test_result(tee(a[0], b[1], sizeof(buf), 0) == 11, "tee duplicates the pipe contents");
+    test_result(read(b[0], buf, sizeof(buf)) == 11 && memcmp(buf, "dataspliced", 11) == 0,
+                "tee'd data reads back");
+    test_result(splice(a[0], NULL, b[1], NULL, 4, 0) == 4, "splice between pipes");
+    memset(buf, 0, sizeof(buf));
+    test_result(read(a[0], buf, sizeof(buf)) == 7 && memcmp(buf, "spliced", 7) == 0 &&
+                read(b[0], buf, sizeof(buf)) == 4 && memcmp(buf, "data", 4) == 0,
+                "splice moved only the requested bytes");
+
+    struct iovec iov[2] = { { "vm", 2 }, { "splice", 6 } };
+    test_result(vmsplice(a[1], iov, 2, 0) == 8, "vmsplice gathers into a pipe");
+    test_result(splice(fd, NULL, b[1], NULL, sizeof(buf), 0) == 5, "splice continues from the position");
+    test_result(splice(fd, NULL, b[1], NULL, sizeof(buf), 0) == 0, "splice at EOF returns 0");
+    test_result(splice(a[0], NULL, a[1], NULL, 4, 0) < 0 && errno == EINVAL,
+                "splice of a pipe into itself fails");
+
+    close(fd);
+    close(a[0]); close(a[1]);
+    close(b[0]); close(b[1]);
+    unlink(path);
+}
+
+static void test_pread_pwrite(void) {
+    printf(TEST_INFO "Testing pread / pwrite / preadv / pwritev...\n");
+
+    const char* path = "/PREAD.TXT";
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        test_result(0, "create test file");
+        return;
+    }
+    struct iovec wv[3] = { { "head-", 5 }, { "", 0 }, { "body-tail", 9 } };
+    test_result(writev(fd, wv, 3) == 14, "writev gathers all segments");
+    test_result(pwrite(fd, "BODY", 4, 5) == 4 && lseek(fd, 0, SEEK_CUR) == 14,
+                "pwrite leaves the file position alone");
+
+    char a[6] = {0}, b[16] = {0};
+    struct iovec rv[2] = { { a, 5 }, { b, sizeof(b) } };
+    test_result(preadv(fd, rv, 2, 0) == 14 && memcmp(a, "head-", 5) == 0 &&
+                memcmp(b, "BODY-tail", 9) == 0, "preadv scatters from an offset");
+    memset(b, 0, sizeof(b));
+    test_result(pread(fd, b, 4, 10) == 4 && memcmp(b, "tail", 4) == 0,
+                "pread reads at an offset");
+    test_result(pread(fd, b, 4, 14) == 0, "pread at EOF returns 0");
+    test_result(pread(fd, b, 4, -1) < 0 && errno == EINVAL, "pread rejects a negative offset");
+
+    lseek(fd, 5, SEEK_SET);
+    memset(b, 0, sizeof(b));
+    struct iovec one = { b, 4 };
+    test_result(preadv2(fd, &one, 1, -1, 0) == 4 && lseek(fd, 0, SEEK_CUR) == 9,
+                "preadv2 at offset -1 uses and advances the position");
+    test_result(preadv2(fd, &one, 1, 0, 0x100) < 0 && errno == EOPNOTSUPP,
+                "preadv2 rejects unknown flags");
+
+    int p[2];
+    pipe(p);
+    test_result(pwrite(p[1], "x", 1, 0) < 0 && errno == ESPIPE, "pwrite on a pipe fails with ESPIPE");
+    struct iovec pv[2] = { { "pi", 2 }, { "pe", 2 } };
+    memset(b, 0, sizeof(b));
+    test_result(writev(p[1], pv, 2) == 4 && read(p[0], b, sizeof(b)) == 4 &&
+                memcmp(b, "pipe", 4) == 0, "writev into a pipe");
+    test_result(preadv2(p[0], &one, 1, -1, RWF_NOWAIT) < 0 && errno == EAGAIN,
+                "preadv2 RWF_NOWAIT on an empty pipe returns EAGAIN");
+    close(p[0]); close(p[1]);
+
+    close(fd);
+    unlink(path);
+}
+
+static void test_eventfd_timerfd(void) {
+    printf(TEST_INFO "Testing eventfd / timerfd...\n");
+
+    int efd = eventfd(2, EFD_NONBLOCK);
+    if (efd < 0) {
+        test_result(0, "eventfd");
+        return;
+    }
+    eventfd_t v = 0;
+    test_result(eventfd_write(efd, 3) == 0 && eventfd_read(efd, &v) == 0 && v == 5,
+                "eventfd read returns the summed counter");
+    test_result(eventfd_read(efd, &v) < 0 && errno == EAGAIN, "empty eventfd returns EAGAIN");
+    struct pollfd pfd = { efd, POLLIN, 0 };
+    test_result(poll(&pfd, 1, 0) == 0, "empty eventfd is not readable");
+    eventfd_write(efd, 1);
+    test_result(poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN), "eventfd readable after a write");
+    close(efd);
+
+    efd = eventfd(2, EFD_SEMAPHORE | EFD_NONBLOCK);
+    test_result(eventfd_read(efd, &v) == 0 && v == 1 && eventfd_read(efd, &v) == 0 && v == 1 &&
+                eventfd_read(efd, &v) < 0, "EFD_SEMAPHORE reads count down by one");
+    close(efd);
+
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (tfd < 0) {
+        test_result(0, "timerfd_create");
+        return;
+    }
+    uint64_t ticks = 0;
+    test_result(read(tfd, &ticks, sizeof(ticks)) < 0 && errno == EAGAIN,
+                "disarmed timerfd returns EAGAIN");
+
+    // 5 ms period: after ~50 ms at least a few expirations have been counted
+    struct itimerspec its = { { 0, 5000000 }, { 0, 5000000 } };
+    test_result(timerfd_settime(tfd, 0, &its, NULL) == 0, "timerfd_settime arms a periodic timer");
+    struct itimerspec cur;
+    test_result(timerfd_gettime(tfd, &cur) == 0 && cur.it_interval.tv_nsec == 5000000 &&
+                cur.it_value.tv_sec == 0 && cur.it_value.tv_nsec > 0,
+                "timerfd_gettime reports the interval and time left");
+    pfd.fd = tfd;
+    pfd.revents = 0;
+    test_result(poll(&pfd, 1, 1000) == 1 && (pfd.revents & POLLIN), "timerfd polls readable");
+    struct timespec nap = { 0, 50000000 };
+    nanosleep(&nap, NULL);
+    test_result(read(tfd, &ticks, sizeof(ticks)) == sizeof(ticks) && ticks >= 5,
+                "periodic timerfd counts every expiration");
+
+    struct itimerspec off = { { 0, 0 }, { 0, 0 } };
+    test_result(timerfd_settime(tfd, 0, &off, &cur) == 0 && cur.it_interval.tv_nsec == 5000000,
+                "disarming returns the old setting");
+    test_result(timerfd_gettime(tfd, &cur) == 0 && cur.it_value.tv_sec == 0 &&
+                cur.it_value.tv_nsec == 0, "disarmed timerfd has no time left");
+    close(tfd);
+}
+
+static void test_epoll(void) {
+    printf(TEST_INFO "Testing epoll...\n");
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    int p[2];
+    if (ep < 0 || pipe(p) < 0) {
+        test_result(0, "epoll_create1 / pipe");
+        return;
+    }
+    struct epoll_event ev = { EPOLLIN, { .u64 = 7 } };
+    struct epoll_event out[4];
+    test_result(epoll_ctl(ep, EPOLL_CTL_ADD, p[0], &ev) == 0, "EPOLL_CTL_ADD a pipe");
+    test_result(epoll_ctl(ep, EPOLL_CTL_ADD, p[0], &ev) < 0 && errno == EEXIST,
+                "adding twice returns EEXIST");
+    test_result(epoll_wait(ep, out, 4, 0) == 0, "idle pipe reports nothing");
+
+    // Level-triggered: reported on every call while data is buffered
+    write(p[1], "x", 1);
+    test_result(epoll_wait(ep, out, 4, 1000) == 1 && out[0].data.u64 == 7 &&
+                (out[0].events & EPOLLIN), "write wakes epoll_wait");
+    test_result(epoll_wait(ep, out, 4, 0) == 1, "level-triggered item is reported again");
+
+    // Edge-triggered: once per write
+    ev.events = EPOLLIN | EPOLLET;
+    test_result(epoll_ctl(ep, EPOLL_CTL_MOD, p[0], &ev) == 0, "EPOLL_CTL_MOD to EPOLLET");
+    test_result(epoll_wait(ep, out, 4, 0) == 1 && epoll_wait(ep, out, 4, 0) == 0,
+                "edge-triggered item is reported once");
+    write(p[1], "y", 1);
+    test_result(epoll_wait(ep, out, 4, 0) == 1, "new data re-arms an edge-triggered item");
+
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    epoll_ctl(ep, EPOLL_CTL_MOD, p[0], &ev);
+    test_result(epoll_wait(ep, out, 4, 0) == 1 && epoll_wait(ep, out, 4, 0) == 0,
+                "EPOLLONESHOT disables the item after one event");
+    epoll_ctl(ep, EPOLL_CTL_MOD, p[0], &ev);
+    test_result(epoll_wait(ep, out, 4, 0) == 1, "EPOLL_CTL_MOD re-arms a oneshot item");
+
+    // Closing the watched fd drops the item, though the pipe still has data
+    close(p[0]);
+    test_result(epoll_wait(ep, out, 4, 0) == 0, "closed fd leaves the interest list");
+    close(p[1]);
+
+    // More fds than the old fixed table held
+    int efds[80];
+    int n = 0;
+    for (int i = 0; i < 80; i++) {
+        efds[i] = eventfd(1, EFD_NONBLOCK);
+        if (efds[i] < 0) break;
+        struct epoll_event e = { EPOLLIN, { .fd = efds[i] } };
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, efds[i], &e) == 0) n++;
+    }
+    int total = 0;
+    for (int r; (r = epoll_wait(ep, out, 4, 0)) > 0; ) {
+        for (int i = 0; i < r; i++) {
+            eventfd_t v;
+            eventfd_read(out[i].data.fd, &v);
+        }
+        total += r;
+    }
+    test_result(n == 80 && total == 80, "80 ready eventfds reported four at a time");
+    for (int i = 0; i < n; i++) {
+        close(efds[i]);
+    }
+
+    // An epoll fd stays open through dup, and can be watched by another
+    int ep2 = epoll_create1(0);
+    int dupfd = dup(ep);
+    close(ep);
+    int efd = eventfd(0, EFD_NONBLOCK);
+    struct epoll_event e = { EPOLLIN, { .fd = efd } };
+    test_result(epoll_ctl(dupfd, EPOLL_CTL_ADD, efd, &e) == 0, "dup keeps the instance alive");
+    e.data.fd = dupfd;
+    test_result(epoll_ctl(ep2, EPOLL_CTL_ADD, dupfd, &e) == 0, "an epoll fd can watch another");
+    e.data.fd = ep2;
+    test_result(epoll_ctl(dupfd, EPOLL_CTL_ADD, ep2, &e) < 0 && errno == ELOOP,
+                "watching each other returns ELOOP");
+    eventfd_write(efd, 1);
+    test_result(epoll_wait(ep2, out, 4, 1000) == 1 && out[0].data.fd == dupfd,
+                "nested instance wakes its watcher");
+    close(efd);
+    close(dupfd);
+    close(ep2);
+}
+
+// libc's FUTEX_WAIT / FUTEX_WAKE wrappers (without FUTEX_PRIVATE_FLAG)
+extern int futex_wait(volatile int* uaddr, int val, const struct timespec* timeout);
+extern int futex_wake(volatile int* uaddr, int count);
+
+static void test_shm(void) {
+    printf(TEST_INFO "Testing memfd_create / shm_open...\n");
+
+    int fd = memfd_create("test", MFD_CLOEXEC);
+    if (fd < 0) {
+        test_result(0, "memfd_create");
+        return;
+    }
+    test_result(ftruncate(fd, 8192) == 0 && lseek(fd, 0, SEEK_END) == 8192,
+                "ftruncate sizes a memfd");
+    volatile int* shared = mmap(NULL, 8192, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shared == MAP_FAILED) {
+        test_result(0, "mmap a memfd MAP_SHARED");
+        close(fd);
+        return;
+    }
+    char b[8] = {0};
+    memcpy((char*)shared + 4096, "mapped", 6);
+    test_result(pread(fd, b, 6, 4096) == 6 && memcmp(b, "mapped", 6) == 0,
+                "read() sees stores through the mapping");
+    test_result(pwrite(fd, "file", 4, 16) == 4 && memcmp((char*)shared + 16, "file", 4) == 0,
+                "write() shows through the mapping");
+
+    // Without the physical-address key the child's wake misses the
+    // parent, which then times out
+    shared[0] = 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct timespec nap = { 0, 50000000 };
+        nanosleep(&nap, NULL);
+        shared[0] = 1;
+        futex_wake(shared, 1);
+        _exit(0);
+    }
+    struct timespec limit = { 2, 0 };
+    int timed_out = 0;
+    while (shared[0] == 0 && !timed_out) {
+        timed_out = futex_wait(shared, 0, &limit) < 0 && errno == ETIMEDOUT;
+    }
+    waitpid(pid, NULL, 0);
+    test_result(shared[0] == 1 && !timed_out, "futex wake crosses processes in a shared mapping");
+    munmap((void*)shared, 8192);
+    close(fd);
+
+    shm_unlink("/test_shm");
+    int a = shm_open("/test_shm", O_RDWR | O_CREAT | O_EXCL, 0600);
+    int c = shm_open("/test_shm", O_RDWR, 0);
+    test_result(a >= 0 && c >= 0, "shm_open creates and reopens by name");
+    test_result(shm_open("/test_shm", O_RDWR | O_CREAT | O_EXCL, 0600) < 0 && errno == EEXIST,
+                "shm_open O_EXCL fails on an existing name");
+    memset(b, 0, sizeof(b));
+    test_result(write(a, "hello", 5) == 5 && pread(c, b, 5, 0) == 5 && memcmp(b, "hello", 5) == 0,
+                "both opens share one object");
+    test_result(shm_unlink("/test_shm") == 0 && shm_open("/test_shm", O_RDWR, 0) < 0 && errno == ENOENT,
+                "shm_unlink removes the name");
+    test_result(pread(c, b, 5, 0) == 5, "an unlinked object lives while open");
+    close(a);
+    close(c);
+}
+
+// Fork a child that writes one byte to fd after a short nap
+static pid_t write_later(int fd) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct timespec nap = { 0, 50000000 };
+        nanosleep(&nap, NULL);
+        write(fd, "w", 1);
+        _exit(0);
+    }
+    return pid;
+}
+
+// poll() and select() with no timeout sleep until a child's write wakes
+// the pipe's queue
+static void test_poll_select(void) {
+    printf(TEST_INFO "Testing poll / select wakeups...\n");
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        test_result(0, "pipe");
+        return;
+    }
+    char c;
+
+    pid_t pid = write_later(fds[1]);
+    struct pollfd pfd = { fds[0], POLLIN, 0 };
+    int ret = poll(&pfd, 1, -1);
+    test_result(ret == 1 && (pfd.revents & POLLIN), "poll wakes on a child's write");
+    test_result(read(fds[0], &c, 1) == 1 && c == 'w', "the polled byte is there");
+    waitpid(pid, NULL, 0);
+
+    pid = write_later(fds[1]);
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(fds[0], &rfds);
+    ret = select(fds[0] + 1, &rfds, NULL, NULL, NULL);
+    test_result(ret == 1 && FD_ISSET(fds[0], &rfds), "select wakes on a child's write");
+    test_result(read(fds[0], &c, 1) == 1 && c == 'w', "the selected byte is there");
+    waitpid(pid, NULL, 0);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// A buffer that is unmapped or in the kernel half fails with EFAULT; one
+// that runs into an unmapped page moves only the bytes before the hole
+static void test_efault(void) {
+    printf(TEST_INFO "Testing EFAULT from bad user buffers...\n");
+
+    char* map = mmap(NULL, 8192, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED || munmap(map + 4096, 4096) != 0) {
+        test_result(0, "mmap a page followed by a hole");
+        return;
+    }
+    char* hole = map + 4096;
+    char* edge = hole - 8;
+    void* kaddr = (void*)0xFFFF800000100000ULL;
+    memset(map, 'e', 4096);
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        test_result(0, "pipe");
+        munmap(map, 4096);
+        return;
+    }
+    test_result(write(fds[1], hole, 16) < 0 && errno == EFAULT, "write from an unmapped page");
+    test_result(write(fds[1], kaddr, 16) < 0 && errno == EFAULT, "write from a kernel address");
+    test_result(write(fds[1], edge, 64) == 8, "write stops at an unmapped page");
+
+    test_result(read(fds[0], hole, 16) < 0 && errno == EFAULT, "read into an unmapped page");
+    test_result(read(fds[0], kaddr, 16) < 0 && errno == EFAULT, "read into a kernel address");
+    write(fds[1], "tail", 4);
+    memset(map, 0, 4096);
+    test_result(read(fds[0], edge, 64) == 8 && memcmp(edge, "eeeeeeee", 8) == 0,
+                "read stops at an unmapped page");
+    char b[8] = {0};
+    test_result(read(fds[0], b, sizeof(b)) == 4 && memcmp(b, "tail", 4) == 0,
+                "data past the hole stays queued");
+    close(fds[0]);
+    close(fds[1]);
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        test_result(0, "socketpair");
+        munmap(map, 4096);
+        return;
+    }
+    send(sv[0], "0123456789abcdef", 16, 0);
+    test_result(recv(sv[1], hole, 16, 0) < 0 && errno == EFAULT, "recv into an unmapped page");
+    test_result(recv(sv[1], kaddr, 16, 0) < 0 && errno == EFAULT, "recv into a kernel address");
+    test_result(recv(sv[1], edge, 16, 0) == 8 && memcmp(edge, "01234567", 8) == 0,
+                "recv stops at an unmapped page");
+    close(sv[0]);
+    close(sv[1]);
+    munmap(map, 4096);
+}
+
 // Entry point
 int main(void) {
     printf("\n");
@@ -195,6 +742,17 @@ int main(void) {
     test_mmap();
     test_read();
     test_open_close();
+    test_rseq();
+    test_syscallstat();
+    test_io_uring();
+    test_pipe_size();
+    test_splice();
+    test_pread_pwrite();
+    test_eventfd_timerfd();
+    test_epoll();
+    test_shm();
+    test_poll_select();
+    test_efault();
     
     // Summary
     printf("\n========================================\n");
@@ -19,6 +19,7 @@
 #include <termios.h>
 #include <sys/procinfo.h>
 #include <sys/sysinfo.h>
+#include <sys/resource.h>
 
 #define TOP_VERSION "top (LikeOS procps) 0.1"
 
@@ -69,6 +70,11 @@ enum {
     FLD_USED,      /* Memory in Use (KiB) */
     FLD_ELAPSED,   /* Elapsed Running Time */
     FLD_STARTED,   /* Start Time Interval */
+    FLD_DELAY,     /* Run Queue Delay (ms, last interval) */
+    FLD_NVCSW,     /* Voluntary Context Switches */
+    FLD_NIVCSW,    /* Involuntary Context Switches */
+    FLD_MIGR,      /* CPU Migrations */
+    FLD_WLAT,      /* Worst Wakeup Latency (last interval) */
     FLD__COUNT
 };
 
@@ -118,6 +124,11 @@ static const field_spec_t field_specs[] = {
     { "USED",     "USED",      7, 1, FLD_USED     },
     { "ELAPSED",  "ELAPSED",  10, 1, FLD_ELAPSED  },
     { "STARTED",  "STARTED",   8, 1, FLD_STARTED  },
+    { "DELAY",    "DELAY",     7, 1, FLD_DELAY    },
+    { "nvcsw",    "nvcsw",     7, 1, FLD_NVCSW    },
+    { "nivcsw",   "nivcsw",    7, 1, FLD_NIVCSW   },
+    { "MIGR",     "MIGR",      5, 1, FLD_MIGR     },
+    { "WLAT",     "WLAT",      7, 1, FLD_WLAT     },
     { NULL, NULL, 0, 0, 0 }
 };
 
@@ -152,6 +163,8 @@ typedef struct {
     double pcpu;             /* %CPU */
     double pmem;             /* %MEM */
     uint64_t total_ticks;    /* utime + stime (possibly cumulative) */
+    uint64_t delay_ns;       /* run queue delay since the previous snapshot */
+    int wlat_bucket;         /* worst wakeup latency bucket since then, -1 = none */
 } proc_entry_t;
 
 /* Two snapshots for delta calculation */
@@ -619,12 +632,24 @@ static void collect_processes(void) {
             pe->pmem = 0.0;
         }
 
-        /* Calculate %CPU using delta from previous snapshot */
+        /* Calculate %CPU and scheduler deltas from the previous snapshot */
         pe->pcpu = 0.0;
+        pe->delay_ns = 0;
+        pe->wlat_bucket = -1;
         if (g_prev_procs && g_iteration > 0) {
             /* Find this PID in previous snapshot */
             for (int j = 0; j < g_prev_nprocs; j++) {
                 if (g_prev_procs[j].info.pid == raw->pid) {
+                    const procinfo_t *old = &g_prev_procs[j].info;
+                    if (raw->run_delay_ns > old->run_delay_ns)
+                        pe->delay_ns = raw->run_delay_ns - old->run_delay_ns;
+                    for (int b = PROCINFO_LAT_BUCKETS - 1; b >= 0; b--) {
+                        if (raw->wakeup_hist[b] != old->wakeup_hist[b]) {
+                            pe->wlat_bucket = b;
+                            break;
+                        }
+                    }
+
                     uint64_t prev_total = g_prev_procs[j].total_ticks;
                     uint64_t cur_total = pe->total_ticks;
                     uint64_t delta_ticks = (cur_total > prev_total) ? (cur_total - prev_total) : 0;
@@ -830,6 +855,29 @@ static int compare_procs(const void *a, const void *b) {
     case FLD_COMMAND:
         cmp = strcmp(pa->info.comm, pb->info.comm);
         break;
+    case FLD_DELAY:
+        if (pa->delay_ns > pb->delay_ns) cmp = 1;
+        else if (pa->delay_ns < pb->delay_ns) cmp = -1;
+        else cmp = 0;
+        break;
+    case FLD_NVCSW:
+        if (pa->info.nvcsw > pb->info.nvcsw) cmp = 1;
+        else if (pa->info.nvcsw < pb->info.nvcsw) cmp = -1;
+        else cmp = 0;
+        break;
+    case FLD_NIVCSW:
+        if (pa->info.nivcsw > pb->info.nivcsw) cmp = 1;
+        else if (pa->info.nivcsw < pb->info.nivcsw) cmp = -1;
+        else cmp = 0;
+        break;
+    case FLD_MIGR:
+        if (pa->info.nr_migrations > pb->info.nr_migrations) cmp = 1;
+        else if (pa->info.nr_migrations < pb->info.nr_migrations) cmp = -1;
+        else cmp = 0;
+        break;
+    case FLD_WLAT:
+        cmp = pa->wlat_bucket - pb->wlat_bucket;
+        break;
     default:
         cmp = pa->info.pid - pb->info.pid;
         break;
@@ -982,6 +1030,27 @@ static void format_field_value(const proc_entry_t *pe, int field_id,
     case FLD_STARTED:
         format_started(pe->info.start_tick, buf, bufsz);
         break;
+    case FLD_DELAY:
+        snprintf(buf, bufsz, "%.1f", (double)pe->delay_ns / 1000000.0);
+        break;
+    case FLD_NVCSW:
+        snprintf(buf, bufsz, "%lu", (unsigned long)pe->info.nvcsw);
+        break;
+    case FLD_NIVCSW:
+        snprintf(buf, bufsz, "%lu", (unsigned long)pe->info.nivcsw);
+        break;
+    case FLD_MIGR:
+        snprintf(buf, bufsz, "%lu", (unsigned long)pe->info.nr_migrations);
+        break;
+    case FLD_WLAT:
+        /* Upper bound of the log2 latency bucket */
+        if (pe->wlat_bucket < 0)
+            snprintf(buf, bufsz, "-");
+        else if (pe->wlat_bucket == PROCINFO_LAT_BUCKETS - 1)
+            snprintf(buf, bufsz, ">%lums", (1UL << (pe->wlat_bucket - 1)) / 1000);
+        else
+            snprintf(buf, bufsz, "<%luus", 1UL << pe->wlat_bucket);
+        break;
     default:
         snprintf(buf, bufsz, "?");
         break;
@@ -1716,8 +1785,12 @@ static void process_interactive_command(int ch) {
             if (pid > 0) {
                 char nice_buf[64];
                 if (prompt_input("Renice PID to value", nice_buf, sizeof(nice_buf)) >= 0 && nice_buf[0]) {
-                    /* No renice syscall available in this OS, just show message */
-                    show_message("Renice not supported");
+                    int val = atoi(nice_buf);
+                    if (setpriority(PRIO_PROCESS, pid, val) < 0) {
+                        char msg[128];
+                        snprintf(msg, sizeof(msg), "Renice failed: %s", strerror(errno));
+                        show_message(msg);
+                    }
                 }
             }
         }
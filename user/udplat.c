@@ -0,0 +1,233 @@
+/*
+ * udplat - UDP ping-pong latency over loopback
+ *
+ * Usage: udplat [-m poll|select|epoll|block] [-c count] [-s bytes] [-p port]
+ *
+ * Forks an echo server and bounces a datagram between the two processes
+ * over 127.0.0.1.  Before every recvfrom() both sides wait for their
+ * socket with the chosen call (with a one second timeout), so the round
+ * trip time is mostly two wakeups from that call.  Prints the minimum,
+ * mean, 99th percentile and maximum round trip in microseconds and how
+ * many round trips were shorter than one 10 ms timer tick.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MAX_COUNT   100000
+#define MAX_MSG     1024
+#define TICK_US     10000
+
+enum { M_POLL, M_SELECT, M_EPOLL, M_BLOCK };
+static const char *method_names[] = { "poll", "select", "epoll", "block" };
+
+static uint32_t rtt[MAX_COUNT];
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: udplat [-m poll|select|epoll|block] [-c count] [-s bytes] [-p port]\n");
+    exit(1);
+}
+
+/* Wait up to a second for fd to become readable; 1 if it did */
+static int wait_readable(int method, int fd, int epfd)
+{
+    if (method == M_POLL) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        return poll(&pfd, 1, 1000) == 1;
+    }
+    if (method == M_SELECT) {
+        fd_set rs;
+        FD_ZERO(&rs);
+        FD_SET(fd, &rs);
+        struct timeval tv = { 1, 0 };
+        return select(fd + 1, &rs, NULL, NULL, &tv) == 1;
+    }
+    if (method == M_EPOLL) {
+        struct epoll_event ev;
+        return epoll_wait(epfd, &ev, 1, 1000) == 1;
+    }
+    return 1;   /* M_BLOCK: recvfrom() itself sleeps */
+}
+
+static int open_socket(int port, int method, int *epfd)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "udplat: socket: %s\n", strerror(errno));
+        return -1;
+    }
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)port);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        fprintf(stderr, "udplat: bind port %d: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    *epfd = -1;
+    if (method == M_EPOLL) {
+        *epfd = epoll_create1(0);
+        struct epoll_event ev = { EPOLLIN, { .fd = fd } };
+        if (*epfd < 0 || epoll_ctl(*epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            fprintf(stderr, "udplat: epoll: %s\n", strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static void echo_server(int port, int method)
+{
+    int epfd;
+    int fd = open_socket(port, method, &epfd);
+    if (fd < 0)
+        _exit(1);
+    char buf[MAX_MSG];
+    for (;;) {
+        if (!wait_readable(method, fd, epfd))
+            continue;
+        struct sockaddr_in from;
+        socklen_t flen = sizeof(from);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &flen);
+        if (n > 0)
+            sendto(fd, buf, (size_t)n, 0, (struct sockaddr *)&from, flen);
+    }
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+    int method = M_POLL;
+    long count = 1000;
+    long size = 64;
+    int port = 7777;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: udplat [-m poll|select|epoll|block] [-c count] [-s bytes] [-p port]\n");
+            printf("Measure UDP round trips over loopback between two processes\n");
+            printf("that wait with poll (default), select, epoll or a blocking\n");
+            printf("recvfrom.  -c sets the number of round trips (default 1000),\n");
+            printf("-s the datagram size (default 64), -p the server port\n");
+            printf("(default 7777; the client uses the next one).\n");
+            return 0;
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            const char *m = argv[++i];
+            method = -1;
+            for (int k = 0; k < 4; k++)
+                if (strcmp(m, method_names[k]) == 0)
+                    method = k;
+            if (method < 0)
+                usage();
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+            if (count < 1 || count > MAX_COUNT)
+                usage();
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            size = atol(argv[++i]);
+            if (size < 1 || size > MAX_MSG)
+                usage();
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+            if (port < 1 || port > 65534)
+                usage();
+        } else {
+            usage();
+        }
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "udplat: fork: %s\n", strerror(errno));
+        return 1;
+    }
+    if (pid == 0)
+        echo_server(port, method);
+
+    int epfd;
+    int fd = open_socket(port + 1, method, &epfd);
+    if (fd < 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return 1;
+    }
+    struct sockaddr_in srv;
+    memset(&srv, 0, sizeof(srv));
+    srv.sin_family = AF_INET;
+    srv.sin_port = htons((uint16_t)port);
+    srv.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char msg[MAX_MSG], buf[MAX_MSG];
+    memset(msg, 'u', sizeof(msg));
+
+    /* Give the server time to bind before the first ping */
+    struct timespec nap = { 0, 50000000 };
+    nanosleep(&nap, NULL);
+
+    long done = 0, lost = 0;
+    uint64_t sum = 0;
+    while (done < count && lost < 10) {
+        uint64_t t0 = now_us();
+        sendto(fd, msg, (size_t)size, 0, (struct sockaddr *)&srv, sizeof(srv));
+        if (!wait_readable(method, fd, epfd) ||
+            recvfrom(fd, buf, sizeof(buf), 0, NULL, NULL) != size) {
+            lost++;
+            continue;
+        }
+        uint64_t t = now_us() - t0;
+        rtt[done++] = t > UINT32_MAX ? UINT32_MAX : (uint32_t)t;
+        sum += t;
+    }
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    close(fd);
+    if (epfd >= 0)
+        close(epfd);
+
+    if (!done) {
+        fprintf(stderr, "udplat: no replies from the echo server\n");
+        return 1;
+    }
+    long subtick = 0;
+    for (long i = 0; i < done; i++)
+        if (rtt[i] < TICK_US)
+            subtick++;
+    qsort(rtt, (size_t)done, sizeof(rtt[0]), cmp_u32);
+
+    printf("udplat: %s, %ld round trips of %ld bytes, %ld lost\n",
+           method_names[method], done, size, lost);
+    printf("RTT us: min %u  avg %llu  p99 %u  max %u\n",
+           rtt[0], (unsigned long long)(sum / (uint64_t)done),
+           rtt[(done * 99) / 100], rtt[done - 1]);
+    printf("under one tick (%d us): %ld of %ld\n", TICK_US, subtick, done);
+    return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * uringbench - compare an epoll event loop with io_uring
+ *
+ * Usage: uringbench [-t pipe|unix] [-n fds] [-s bytes] [-r rounds]
+ *
+ * Sets up a number of pipes (or AF_UNIX socket pairs) and moves a message
+ * through every one of them each round.  The epoll loop waits for the read
+ * ends to become readable and then read()s each; the io_uring loop keeps a
+ * READ queued on every read end and reaps the completions.  Both report
+ * rounds per second and the number of syscalls each round cost.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <liburing.h>
+
+#define MAX_FDS     256
+#define MAX_MSG     4096
+
+static int rfd[MAX_FDS];
+static int wfd[MAX_FDS];
+static char rbuf[MAX_FDS][MAX_MSG];
+static char wbuf[MAX_MSG];
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: uringbench [-t pipe|unix] [-n fds] [-s bytes] [-r rounds]\n");
+    exit(1);
+}
+
+static int open_channels(int unix_sock, int nfds)
+{
+    for (int i = 0; i < nfds; i++) {
+        int fds[2];
+        int ret = unix_sock ? socketpair(AF_UNIX, SOCK_STREAM, 0, fds) : pipe(fds);
+        if (ret < 0) {
+            fprintf(stderr, "uringbench: %s: %s\n", unix_sock ? "socketpair" : "pipe",
+                    strerror(errno));
+            return -1;
+        }
+        rfd[i] = fds[0];
+        wfd[i] = fds[1];
+    }
+    return 0;
+}
+
+static void close_channels(int nfds)
+{
+    for (int i = 0; i < nfds; i++) {
+        close(rfd[i]);
+        close(wfd[i]);
+    }
+}
+
+static void fill_all(int nfds, int size)
+{
+    for (int i = 0; i < nfds; i++) {
+        if (write(wfd[i], wbuf, (size_t)size) != size) {
+            fprintf(stderr, "uringbench: write: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+}
+
+/* Returns the elapsed time in microseconds, or 0 on failure */
+static uint64_t run_epoll(int nfds, int size, long rounds, long *calls)
+{
+    int ep = epoll_create1(0);
+    if (ep < 0) {
+        fprintf(stderr, "uringbench: epoll_create1: %s\n", strerror(errno));
+        return 0;
+    }
+    for (int i = 0; i < nfds; i++) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)i;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, rfd[i], &ev) < 0) {
+            fprintf(stderr, "uringbench: epoll_ctl: %s\n", strerror(errno));
+            close(ep);
+            return 0;
+        }
+    }
+
+    struct epoll_event events[MAX_FDS];
+    long n = 0;
+    uint64_t start = now_us();
+    for (long r = 0; r < rounds; r++) {
+        fill_all(nfds, size);
+        n += nfds;
+        int left = nfds;
+        while (left > 0) {
+            int ready = epoll_wait(ep, events, MAX_FDS, -1);
+            n++;
+            if (ready < 0) {
+                if (errno == EINTR)
+                    continue;
+                fprintf(stderr, "uringbench: epoll_wait: %s\n", strerror(errno));
+                close(ep);
+                return 0;
+            }
+            for (int k = 0; k < ready; k++) {
+                int i = (int)events[k].data.u32;
+                ssize_t got = read(rfd[i], rbuf[i], (size_t)size);
+                n++;
+                if (got == size)
+                    left--;
+            }
+        }
+    }
+    uint64_t elapsed = now_us() - start;
+    close(ep);
+    *calls = n;
+    return elapsed ? elapsed : 1;
+}
+
+static uint64_t run_uring(int nfds, int size, long rounds, long *calls)
+{
+    struct io_uring ring;
+    int ret = io_uring_queue_init((unsigned)nfds, &ring, 0);
+    if (ret < 0) {
+        fprintf(stderr, "uringbench: io_uring_queue_init: %s\n", strerror(-ret));
+        return 0;
+    }
+
+    long n = 0;
+    uint64_t start = now_us();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < nfds; i++) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_read(sqe, rfd[i], rbuf[i], (unsigned)size, (uint64_t)-1);
+            io_uring_sqe_set_data64(sqe, (uint64_t)i);
+        }
+        io_uring_submit(&ring);
+        n++;
+        fill_all(nfds, size);
+        n += nfds;
+
+        int left = nfds;
+        while (left > 0) {
+            struct io_uring_cqe *cqe;
+            if (!io_uring_cq_ready(&ring))
+                n++;
+            ret = io_uring_wait_cqe(&ring, &cqe);
+            if (ret == -EINTR)
+                continue;
+            if (ret < 0) {
+                fprintf(stderr, "uringbench: io_uring_wait_cqe: %s\n", strerror(-ret));
+                io_uring_queue_exit(&ring);
+                return 0;
+            }
+            if (cqe->res != size) {
+                fprintf(stderr, "uringbench: read: %s\n",
+                        cqe->res < 0 ? strerror(-cqe->res) : "short read");
+                io_uring_queue_exit(&ring);
+                return 0;
+            }
+            io_uring_cqe_seen(&ring, cqe);
+            left--;
+        }
+    }
+    uint64_t elapsed = now_us() - start;
+    io_uring_queue_exit(&ring);
+    *calls = n;
+    return elapsed ? elapsed : 1;
+}
+
+static void report(const char *name, uint64_t us, long rounds, long calls)
+{
+    printf("%-8s %10llu us  %10llu rounds/s  %6.1f syscalls/round\n", name,
+           (unsigned long long)us,
+           (unsigned long long)((uint64_t)rounds * 1000000ULL / us),
+           (double)calls / (double)rounds);
+}
+
+int main(int argc, char *argv[])
+{
+    int unix_sock = 0;
+    int nfds = 16;
+    int size = 64;
+    long rounds = 2000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: uringbench [-t pipe|unix] [-n fds] [-s bytes] [-r rounds]\n");
+            printf("Move a message through many pipes or socket pairs per round,\n");
+            printf("once with an epoll loop and once with io_uring, and compare.\n");
+            printf("Defaults: pipes, 16 fds, 64-byte messages, 2000 rounds.\n");
+            return 0;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "pipe") == 0)
+                unix_sock = 0;
+            else if (strcmp(argv[i], "unix") == 0)
+                unix_sock = 1;
+            else
+                usage();
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            nfds = atoi(argv[++i]);
+            if (nfds < 1 || nfds > MAX_FDS)
+                usage();
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            size = atoi(argv[++i]);
+            if (size < 1 || size > MAX_MSG)
+                usage();
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = atol(argv[++i]);
+            if (rounds < 1)
+                usage();
+        } else {
+            usage();
+        }
+    }
+
+    memset(wbuf, 'x', sizeof(wbuf));
+    printf("%s: %d fds, %d bytes, %ld rounds\n", unix_sock ? "unix" : "pipe",
+           nfds, size, rounds);
+
+    long calls = 0;
+    if (open_channels(unix_sock, nfds) < 0)
+        return 1;
+    uint64_t us = run_epoll(nfds, size, rounds, &calls);
+    close_channels(nfds);
+    if (!us)
+        return 1;
+    report("epoll", us, rounds, calls);
+
+    if (open_channels(unix_sock, nfds) < 0)
+        return 1;
+    us = run_uring(nfds, size, rounds, &calls);
+    close_channels(nfds);
+    if (!us)
+        return 1;
+    report("io_uring", us, rounds, calls);
+    return 0;
+}
@@ -80,6 +80,7 @@ extern int errno;
 #define EALREADY       114 /* Operation already in progress */
 #define EINPROGRESS    115 /* Operation now in progress */
 #define ESTALE         116 /* Stale file handle */
+#define ECANCELED      125 /* Operation canceled */
 #define EOWNERDEAD     130 /* Owner died */
 #define ENOTRECOVERABLE 131 /* State not recoverable */
 
@@ -1,6 +1,8 @@
 #ifndef _FCNTL_H
 #define _FCNTL_H
 
+#include <sys/types.h>
+
 // File open flags
 #define O_RDONLY    0x0000
 #define O_WRONLY    0x0001
@@ -22,6 +24,8 @@
 #define F_GETFL         3
 #define F_SETFL         4
 #define F_DUPFD_CLOEXEC 1030
+#define F_SETPIPE_SZ    1031
+#define F_GETPIPE_SZ    1032
 
 // File descriptor flags
 #define FD_CLOEXEC      1
@@ -30,4 +34,17 @@
 int open(const char* pathname, int flags, ...);
 int openat(int dirfd, const char* pathname, int flags, ...);
 
+// splice/tee/vmsplice flags
+#define SPLICE_F_MOVE       0x01
+#define SPLICE_F_NONBLOCK   0x02    // Don't block on the pipe
+#define SPLICE_F_MORE       0x04
+#define SPLICE_F_GIFT       0x08
+
+// Move data between a pipe and another fd inside the kernel (Linux)
+struct iovec;
+ssize_t splice(int fd_in, loff_t* off_in, int fd_out, loff_t* off_out,
+               size_t len, unsigned int flags);
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags);
+ssize_t vmsplice(int fd, const struct iovec* iov, size_t nr_segs, unsigned int flags);
+
 #endif
@@ -0,0 +1,219 @@
+/*
+ * liburing.h - helper API over the io_uring syscalls.
+ *
+ * A subset of the liburing interface: set up and map a ring, grab SQEs,
+ * prepare them with the io_uring_prep_* helpers, submit, and reap CQEs.
+ * As in liburing, functions return 0 or a count on success and -errno on
+ * failure; errno is not set.  The implementations live in
+ * src/syscalls/liburing.c.
+ *
+ * Operations run in the context of the task that submitted them.  One
+ * that would block (a read on an empty pipe, an accept with no pending
+ * connection) makes progress only while that task is inside
+ * io_uring_enter(), e.g. in io_uring_wait_cqe().
+ */
+#ifndef _LIBURING_H
+#define _LIBURING_H
+
+#include <stddef.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/io_uring.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct io_uring_sq {
+    unsigned *khead;
+    unsigned *ktail;
+    unsigned *kring_mask;
+    unsigned *kring_entries;
+    unsigned *kflags;
+    unsigned *kdropped;
+    unsigned *array;
+    struct io_uring_sqe *sqes;
+
+    unsigned sqe_head;          /* first SQE not yet submitted */
+    unsigned sqe_tail;          /* next SQE io_uring_get_sqe() returns */
+
+    size_t ring_sz;
+    void *ring_ptr;
+    size_t sqes_sz;
+};
+
+struct io_uring_cq {
+    unsigned *khead;
+    unsigned *ktail;
+    unsigned *kring_mask;
+    unsigned *kring_entries;
+    unsigned *koverflow;
+    struct io_uring_cqe *cqes;
+};
+
+struct io_uring {
+    struct io_uring_sq sq;
+    struct io_uring_cq cq;
+    unsigned flags;
+    int ring_fd;
+};
+
+int io_uring_queue_init(unsigned entries, struct io_uring *ring, unsigned flags);
+int io_uring_queue_init_params(unsigned entries, struct io_uring *ring,
+                               struct io_uring_params *p);
+void io_uring_queue_exit(struct io_uring *ring);
+
+/* Next free SQE, or NULL when the SQ is full */
+struct io_uring_sqe *io_uring_get_sqe(struct io_uring *ring);
+
+/* Publish the prepared SQEs and enter the kernel; returns SQEs submitted */
+int io_uring_submit(struct io_uring *ring);
+int io_uring_submit_and_wait(struct io_uring *ring, unsigned wait_nr);
+
+/* Wait for wait_nr completions and return the first */
+int io_uring_wait_cqe_nr(struct io_uring *ring, struct io_uring_cqe **cqe_ptr,
+                         unsigned wait_nr);
+
+/* Completed CQEs not yet marked seen */
+static inline unsigned io_uring_cq_ready(const struct io_uring *ring) {
+    return __atomic_load_n(ring->cq.ktail, __ATOMIC_ACQUIRE) - *ring->cq.khead;
+}
+
+static inline void io_uring_cq_advance(struct io_uring *ring, unsigned nr) {
+    if (nr)
+        __atomic_store_n(ring->cq.khead, *ring->cq.khead + nr, __ATOMIC_RELEASE);
+}
+
+static inline void io_uring_cqe_seen(struct io_uring *ring, struct io_uring_cqe *cqe) {
+    if (cqe)
+        io_uring_cq_advance(ring, 1);
+}
+
+/* The next CQE without waiting; -EAGAIN if there is none */
+static inline int io_uring_peek_cqe(struct io_uring *ring, struct io_uring_cqe **cqe_ptr) {
+    if (io_uring_cq_ready(ring)) {
+        *cqe_ptr = &ring->cq.cqes[*ring->cq.khead & *ring->cq.kring_mask];
+        return 0;
+    }
+    *cqe_ptr = NULL;
+    return -EAGAIN;
+}
+
+static inline int io_uring_wait_cqe(struct io_uring *ring, struct io_uring_cqe **cqe_ptr) {
+    return io_uring_wait_cqe_nr(ring, cqe_ptr, 1);
+}
+
+static inline void io_uring_sqe_set_data(struct io_uring_sqe *sqe, void *data) {
+    sqe->user_data = (uint64_t)(uintptr_t)data;
+}
+
+static inline void io_uring_sqe_set_data64(struct io_uring_sqe *sqe, uint64_t data) {
+    sqe->user_data = data;
+}
+
+static inline void *io_uring_cqe_get_data(const struct io_uring_cqe *cqe) {
+    return (void *)(uintptr_t)cqe->user_data;
+}
+
+static inline uint64_t io_uring_cqe_get_data64(const struct io_uring_cqe *cqe) {
+    return cqe->user_data;
+}
+
+static inline void io_uring_sqe_set_flags(struct io_uring_sqe *sqe, unsigned flags) {
+    sqe->flags = (uint8_t)flags;
+}
+
+/* ---- SQE preparation ---- */
+
+static inline void io_uring_prep_rw(int op, struct io_uring_sqe *sqe, int fd,
+                                    const void *addr, unsigned len, uint64_t offset) {
+    sqe->opcode = (uint8_t)op;
+    sqe->flags = 0;
+    sqe->ioprio = 0;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->len = len;
+    sqe->rw_flags = 0;
+    sqe->user_data = 0;
+    sqe->buf_index = 0;
+    sqe->personality = 0;
+    sqe->splice_fd_in = 0;
+    sqe->__pad2[0] = sqe->__pad2[1] = 0;
+}
+
+static inline void io_uring_prep_nop(struct io_uring_sqe *sqe) {
+    io_uring_prep_rw(IORING_OP_NOP, sqe, -1, NULL, 0, 0);
+}
+
+static inline void io_uring_prep_read(struct io_uring_sqe *sqe, int fd, void *buf,
+                                      unsigned nbytes, uint64_t offset) {
+    io_uring_prep_rw(IORING_OP_READ, sqe, fd, buf, nbytes, offset);
+}
+
+static inline void io_uring_prep_write(struct io_uring_sqe *sqe, int fd, const void *buf,
+                                       unsigned nbytes, uint64_t offset) {
+    io_uring_prep_rw(IORING_OP_WRITE, sqe, fd, buf, nbytes, offset);
+}
+
+static inline void io_uring_prep_readv(struct io_uring_sqe *sqe, int fd,
+                                       const struct iovec *iovecs, unsigned nr_vecs,
+                                       uint64_t offset) {
+    io_uring_prep_rw(IORING_OP_READV, sqe, fd, iovecs, nr_vecs, offset);
+}
+
+static inline void io_uring_prep_writev(struct io_uring_sqe *sqe, int fd,
+                                        const struct iovec *iovecs, unsigned nr_vecs,
+                                        uint64_t offset) {
+    io_uring_prep_rw(IORING_OP_WRITEV, sqe, fd, iovecs, nr_vecs, offset);
+}
+
+static inline void io_uring_prep_fsync(struct io_uring_sqe *sqe, int fd, unsigned flags) {
+    io_uring_prep_rw(IORING_OP_FSYNC, sqe, fd, NULL, 0, 0);
+    sqe->fsync_flags = flags;
+}
+
+static inline void io_uring_prep_poll_add(struct io_uring_sqe *sqe, int fd, unsigned poll_mask) {
+    io_uring_prep_rw(IORING_OP_POLL_ADD, sqe, fd, NULL, 0, 0);
+    sqe->poll_events = (uint16_t)poll_mask;
+}
+
+/* Complete after ts, or once count other completions have been posted
+ * (count 0 = time only); res is -ETIME on expiry, 0 on count */
+static inline void io_uring_prep_timeout(struct io_uring_sqe *sqe, struct timespec *ts,
+                                         unsigned count, unsigned flags) {
+    io_uring_prep_rw(IORING_OP_TIMEOUT, sqe, -1, ts, 1, count);
+    sqe->timeout_flags = flags;
+}
+
+static inline void io_uring_prep_accept(struct io_uring_sqe *sqe, int fd, struct sockaddr *addr,
+                                        socklen_t *addrlen, int flags) {
+    io_uring_prep_rw(IORING_OP_ACCEPT, sqe, fd, addr, 0, (uint64_t)(uintptr_t)addrlen);
+    sqe->accept_flags = (uint32_t)flags;
+}
+
+static inline void io_uring_prep_connect(struct io_uring_sqe *sqe, int fd,
+                                         const struct sockaddr *addr, socklen_t addrlen) {
+    io_uring_prep_rw(IORING_OP_CONNECT, sqe, fd, addr, 0, addrlen);
+}
+
+static inline void io_uring_prep_send(struct io_uring_sqe *sqe, int sockfd, const void *buf,
+                                      size_t len, int flags) {
+    io_uring_prep_rw(IORING_OP_SEND, sqe, sockfd, buf, (unsigned)len, 0);
+    sqe->msg_flags = (uint32_t)flags;
+}
+
+static inline void io_uring_prep_recv(struct io_uring_sqe *sqe, int sockfd, void *buf,
+                                      size_t len, int flags) {
+    io_uring_prep_rw(IORING_OP_RECV, sqe, sockfd, buf, (unsigned)len, 0);
+    sqe->msg_flags = (uint32_t)flags;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIBURING_H */
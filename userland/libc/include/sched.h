@@ -77,6 +77,11 @@ pid_t clone(int (*fn)(void*), void* stack, int flags, void* arg, ...);
 pid_t vfork(void);
 pid_t gettid(void);
 
+// Current CPU: sched_getcpu reads the thread's rseq area (sys/rseq.h)
+// when it has one and falls back to the getcpu syscall
+int sched_getcpu(void);
+int getcpu(unsigned int* cpu, unsigned int* node);
+
 // CPU affinity
 int sched_setaffinity(pid_t pid, size_t cpusetsize, const cpu_set_t* mask);
 int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t* mask);
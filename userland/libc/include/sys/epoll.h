@@ -13,8 +13,11 @@
 #define EPOLLRDBAND     0x080
 #define EPOLLWRNORM     0x100
 #define EPOLLWRBAND     0x200
-#define EPOLLONESHOT    (1 << 30)
-#define EPOLLET         (1 << 31)
+#define EPOLLRDHUP      0x2000
+#define EPOLLEXCLUSIVE  (1U << 28)
+#define EPOLLWAKEUP     (1U << 29)
+#define EPOLLONESHOT    (1U << 30)
+#define EPOLLET         (1U << 31)
 
 // epoll_create1 flags
 #define EPOLL_CLOEXEC   0x80000
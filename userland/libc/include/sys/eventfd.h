@@ -0,0 +1,32 @@
+/*
+ * sys/eventfd.h - event notification file descriptors.
+ *
+ * An eventfd holds a 64-bit counter: write() adds to it, read() returns
+ * it and resets it to zero (or, with EFD_SEMAPHORE, returns 1 and
+ * decrements it).  The descriptor is readable while the counter is
+ * non-zero, which makes it a cheap wakeup for poll/epoll loops.
+ */
+#ifndef _SYS_EVENTFD_H
+#define _SYS_EVENTFD_H
+
+#include <stdint.h>
+
+#define EFD_SEMAPHORE   0x00001
+#define EFD_NONBLOCK    0x00800     /* O_NONBLOCK */
+#define EFD_CLOEXEC     0x80000     /* O_CLOEXEC */
+
+typedef uint64_t eventfd_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int eventfd(unsigned int initval, int flags);
+int eventfd_read(int fd, eventfd_t* value);
+int eventfd_write(int fd, eventfd_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SYS_EVENTFD_H */
@@ -0,0 +1,123 @@
+#ifndef _SYS_IO_URING_H
+#define _SYS_IO_URING_H
+
+#include <stdint.h>
+
+/*
+ * Submission/completion ring ABI.  The structures, opcodes and mmap
+ * offsets match <linux/io_uring.h>; only the subset below is implemented.
+ * See <liburing.h> for a friendlier interface.
+ */
+
+/* Opcodes */
+#define IORING_OP_NOP           0
+#define IORING_OP_READV         1
+#define IORING_OP_WRITEV        2
+#define IORING_OP_FSYNC         3
+#define IORING_OP_POLL_ADD      6
+#define IORING_OP_TIMEOUT       11
+#define IORING_OP_ACCEPT        13
+#define IORING_OP_CONNECT       16
+#define IORING_OP_READ          22
+#define IORING_OP_WRITE         23
+#define IORING_OP_SEND          26
+#define IORING_OP_RECV          27
+
+/* io_uring_sqe::flags */
+#define IOSQE_IO_LINK           (1U << 2)   /* start the next SQE when this one succeeds */
+#define IOSQE_IO_HARDLINK       (1U << 3)   /* start the next SQE however this one ends */
+#define IOSQE_ASYNC             (1U << 4)   /* not supported (-EINVAL) */
+#define IOSQE_CQE_SKIP_SUCCESS  (1U << 6)   /* no CQE unless the op fails */
+
+/* io_uring_sqe::timeout_flags */
+#define IORING_TIMEOUT_ETIME_SUCCESS (1U << 5)  /* expiry does not break a link */
+
+/* io_uring_params::flags */
+#define IORING_SETUP_CQSIZE     (1U << 3)
+#define IORING_SETUP_CLAMP      (1U << 4)
+
+/* io_uring_params::features */
+#define IORING_FEAT_SINGLE_MMAP (1U << 0)
+
+/* io_uring_enter() flags */
+#define IORING_ENTER_GETEVENTS  (1U << 0)
+
+/* mmap() offsets on the ring fd */
+#define IORING_OFF_SQ_RING      0ULL
+#define IORING_OFF_CQ_RING      0x8000000ULL
+#define IORING_OFF_SQES         0x10000000ULL
+
+struct io_uring_sqe {
+    uint8_t  opcode;
+    uint8_t  flags;
+    uint16_t ioprio;
+    int32_t  fd;
+    union {
+        uint64_t off;           /* file offset, -1 = current position */
+        uint64_t addr2;         /* addrlen pointer (ACCEPT) */
+    };
+    uint64_t addr;              /* buffer, iovec array, sockaddr or timespec */
+    uint32_t len;               /* buffer length, iovec count or addrlen */
+    union {
+        uint32_t rw_flags;
+        uint32_t fsync_flags;
+        uint16_t poll_events;
+        uint32_t timeout_flags;
+        uint32_t accept_flags;
+        uint32_t msg_flags;
+    };
+    uint64_t user_data;         /* copied to the CQE */
+    uint16_t buf_index;
+    uint16_t personality;
+    int32_t  splice_fd_in;
+    uint64_t __pad2[2];
+};
+
+struct io_uring_cqe {
+    uint64_t user_data;
+    int32_t  res;               /* result, or -errno */
+    uint32_t flags;
+};
+
+struct io_sqring_offsets {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t flags;
+    uint32_t dropped;
+    uint32_t array;
+    uint32_t resv1;
+    uint64_t resv2;
+};
+
+struct io_cqring_offsets {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t overflow;
+    uint32_t cqes;
+    uint32_t flags;
+    uint32_t resv1;
+    uint64_t resv2;
+};
+
+struct io_uring_params {
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t flags;
+    uint32_t sq_thread_cpu;
+    uint32_t sq_thread_idle;
+    uint32_t features;
+    uint32_t wq_fd;
+    uint32_t resv[3];
+    struct io_sqring_offsets sq_off;
+    struct io_cqring_offsets cq_off;
+};
+
+int io_uring_setup(unsigned entries, struct io_uring_params *p);
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags, const void *sig);
+
+#endif /* _SYS_IO_URING_H */
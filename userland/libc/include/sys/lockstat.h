@@ -0,0 +1,27 @@
+#ifndef _SYS_LOCKSTAT_H
+#define _SYS_LOCKSTAT_H
+
+#include <stdint.h>
+
+/* lockstat operations (LikeOS specific; kernels built with LOCKSTAT=1,
+ * ENOSYS otherwise) */
+#define LOCKSTAT_READ       0   /* lockstat(READ, entries, count): classes copied */
+#define LOCKSTAT_RESET      1   /* zero all counters */
+#define LOCKSTAT_TSC_HZ     2   /* returns the TSC frequency, 0 if unknown */
+
+#define LOCKSTAT_NAME_LEN   32
+
+/* Per-lock-class counters; times are TSC cycles */
+struct lockstat_entry {
+    char     name[LOCKSTAT_NAME_LEN];
+    uint64_t acquisitions;      /* successful lock/trylock calls */
+    uint64_t contentions;       /* acquisitions that had to wait */
+    uint64_t wait_total;        /* cycles spent waiting */
+    uint64_t wait_max;
+    uint64_t hold_total;        /* cycles between acquire and release */
+    uint64_t hold_max;
+};
+
+long lockstat(int op, struct lockstat_entry *buf, unsigned long count);
+
+#endif /* _SYS_LOCKSTAT_H */
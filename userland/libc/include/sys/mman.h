@@ -2,6 +2,7 @@
 #define _SYS_MMAN_H
 
 #include <stddef.h>
+#include <sys/types.h>
 
 // mmap protection flags
 #define PROT_NONE       0x0
@@ -18,9 +19,22 @@
 // mmap error return
 #define MAP_FAILED      ((void*)-1)
 
+// memfd_create flags
+#define MFD_CLOEXEC         0x0001U
+#define MFD_ALLOW_SEALING   0x0002U     // Accepted; no seals are supported
+
 // Memory mapping
 void* mmap(void* addr, size_t length, int prot, int flags, int fd, long offset);
 int munmap(void* addr, size_t length);
 int mprotect(void* addr, size_t len, int prot);
 
+// Shared memory objects, kept in RAM under /dev/shm.  MAP_SHARED mappings
+// of one are the same pages in every process; size them with ftruncate().
+int shm_open(const char* name, int oflag, mode_t mode);
+int shm_unlink(const char* name);
+
+// Anonymous shared memory file; shared with other processes by fd passing
+// or fork
+int memfd_create(const char* name, unsigned int flags);
+
 #endif
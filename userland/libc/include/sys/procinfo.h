@@ -3,6 +3,10 @@
 
 #include <stdint.h>
 
+/* Wakeup latency histogram: bucket 0 is < 1 us, bucket i is
+ * [2^(i-1), 2^i) us, the last bucket everything longer */
+#define PROCINFO_LAT_BUCKETS 16
+
 /* Process information structure (matches kernel procinfo_t) */
 typedef struct procinfo {
     int     pid;            /* Process ID */
@@ -30,6 +34,16 @@ typedef struct procinfo {
     char    cmdline[1024];  /* Full command line (argv joined by spaces) */
     char    environ[2048];  /* Environment (envp joined by spaces) */
     char    cwd[256];       /* Current working directory */
+    /* Scheduler statistics (nanoseconds) */
+    uint64_t run_time_ns;   /* CPU time consumed */
+    uint64_t run_delay_ns;  /* Time runnable but waiting for a CPU */
+    uint64_t pcount;        /* Times given a CPU */
+    uint64_t nvcsw;         /* Voluntary context switches */
+    uint64_t nivcsw;        /* Involuntary context switches */
+    uint64_t nr_migrations; /* Moves to another CPU */
+    uint64_t block_ns;      /* Time blocked on a wait channel (I/O, locks, ...) */
+    uint64_t sleep_ns;      /* Time in other sleeps (nanosleep, pause, ...) */
+    uint32_t wakeup_hist[PROCINFO_LAT_BUCKETS]; /* Wakeup-to-run latency, log2 us */
 } procinfo_t;
 
 /* Retrieve information about all processes.
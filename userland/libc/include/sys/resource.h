@@ -33,6 +33,14 @@ struct rlimit {
 #define RLIMIT_LOCKS    10
 #define RLIMIT_NLIMITS  16
 
+/* getpriority/setpriority "which" values */
+#define PRIO_PROCESS    0
+#define PRIO_PGRP       1
+#define PRIO_USER       2
+
+#define PRIO_MIN        (-20)
+#define PRIO_MAX        20
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +48,8 @@ extern "C" {
 int getrusage(int who, struct rusage* usage);
 int getrlimit(int resource, struct rlimit* rlim);
 int setrlimit(int resource, const struct rlimit* rlim);
+int getpriority(int which, id_t who);
+int setpriority(int which, id_t who, int prio);
 
 #ifdef __cplusplus
 }
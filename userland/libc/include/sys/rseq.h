@@ -0,0 +1,59 @@
+/*
+ * sys/rseq.h - restartable sequences (Linux-compatible ABI).
+ *
+ * Every thread started through pthread_create, and the main thread once
+ * the pthread library is initialised, has a struct rseq registered in its
+ * thread control block.  The kernel keeps cpu_id current there, so
+ * sched_getcpu() is a memory load, and restarts a critical section at its
+ * abort handler if the thread is preempted, migrated or signalled before
+ * the commit instruction.
+ *
+ * rseq_percpu_add() is the basic per-CPU building block: it adds to the
+ * calling CPU's slot of a per-CPU array without locks or atomic
+ * instructions.
+ */
+#ifndef _SYS_RSEQ_H
+#define _SYS_RSEQ_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RSEQ_SIG                        0x53053053  /* bytes before every abort handler */
+#define RSEQ_FLAG_UNREGISTER            (1 << 0)
+
+#define RSEQ_CPU_ID_UNINITIALIZED       ((uint32_t)-1)
+#define RSEQ_CPU_ID_REGISTRATION_FAILED ((uint32_t)-2)
+
+struct rseq {
+    uint32_t cpu_id_start;      /* current CPU, always a valid index */
+    uint32_t cpu_id;            /* current CPU, or RSEQ_CPU_ID_* */
+    uint64_t rseq_cs;           /* active struct rseq_cs, 0 = none */
+    uint32_t flags;
+    uint32_t node_id;
+    uint32_t mm_cid;
+    uint32_t reserved;
+} __attribute__((aligned(32)));
+
+struct rseq_cs {
+    uint32_t version;           /* 0 */
+    uint32_t flags;
+    uint64_t start_ip;          /* first instruction of the section */
+    uint64_t post_commit_offset;/* length up to and including the commit */
+    uint64_t abort_ip;          /* restart point, preceded by RSEQ_SIG */
+} __attribute__((aligned(32)));
+
+/* Raw registration syscall */
+int rseq(struct rseq* rseq, uint32_t rseq_len, int flags, uint32_t sig);
+
+/* The calling thread's registered area, or NULL if registration failed */
+struct rseq* rseq_thread_area(void);
+
+/*
+ * Add count to slot sched_getcpu() of a per-CPU array of intptr_t spaced
+ * stride bytes apart (at least sizeof(intptr_t), ideally a cache line).
+ * The array needs a slot for every CPU.  Falls back to an atomic add if
+ * the thread has no rseq area.
+ */
+void rseq_percpu_add(intptr_t* base, size_t stride, intptr_t count);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _SYS_SCHEDCTL_H
+#define _SYS_SCHEDCTL_H
+
+#include <stdint.h>
+
+/* schedctl operations (LikeOS specific) */
+#define SCHEDCTL_GET            0   /* schedctl(GET, id, &value) */
+#define SCHEDCTL_SET            1   /* schedctl(SET, id, value) */
+#define SCHEDCTL_WAKESTATS      2   /* schedctl(WAKESTATS, 0, &struct sched_wakestats) */
+#define SCHEDCTL_RESET_STATS    3   /* zero wakeup, idle and run queue counters */
+#define SCHEDCTL_IDLESTATS      4   /* schedctl(IDLESTATS, cpu, &struct sched_idlestats) */
+#define SCHEDCTL_CPUSTATS       5   /* schedctl(CPUSTATS, cpu, &struct sched_cpustats) */
+
+/* Tunable IDs */
+#define SCHED_TUNE_WAKE_AFFINE      0   /* 1 = consider the waker's CPU at wakeup */
+#define SCHED_TUNE_WAKE_IMBALANCE   1   /* percentage, 100..1000 */
+#define SCHED_TUNE_WAKE_IDLE_SCAN   2   /* CPUs searched for an idle sibling */
+#define SCHED_TUNE_MIGRATION_COST   3   /* cache-hot window, nanoseconds */
+#define SCHED_TUNE_COUNT            4
+
+/* Wakeup placement counters (summed over all CPUs) */
+struct sched_wakestats {
+    uint64_t wakeups;           /* fair-class tasks placed at wakeup */
+    uint64_t wake_prev;         /* stayed on the previous CPU */
+    uint64_t wake_affine;       /* moved to the waker's CPU */
+    uint64_t wake_idle;         /* moved to another idle CPU sharing the cache */
+    uint64_t wake_migrations;   /* placed anywhere but the previous CPU */
+    uint64_t wake_ipis;         /* enqueued remotely (reschedule IPI sent) */
+};
+
+/* Per-CPU idle state counters */
+#define SCHED_IDLE_MAX_STATES   8
+#define SCHED_IDLE_HLT          0xFFFFFFFFU /* mwait_hint of a state entered with HLT */
+
+struct sched_idlestate {
+    uint32_t type;              /* ACPI C-state (1 = C1, ...) */
+    uint32_t mwait_hint;        /* MWAIT hint, or SCHED_IDLE_HLT */
+    uint32_t latency_us;        /* exit latency */
+    uint32_t reserved;
+    uint64_t usage;             /* times entered */
+    uint64_t time_ns;           /* total residency */
+};
+
+struct sched_idlestats {
+    uint32_t nr_states;
+    uint32_t polling;           /* 1 = wakeups write need_resched instead of IPI */
+    uint64_t ipis_avoided;      /* remote wakeups that needed no IPI */
+    struct sched_idlestate states[SCHED_IDLE_MAX_STATES];
+};
+
+/* Per-CPU scheduler statistics.  Histogram bucket 0 counts wakeup-to-run
+ * latencies under 1 us, bucket i those in [2^(i-1), 2^i) us, the last
+ * bucket everything longer. */
+#define SCHED_STAT_LAT_BUCKETS  16
+
+struct sched_cpustats {
+    uint64_t context_switches;
+    uint64_t run_delay_ns;      /* time tasks waited on this CPU's run queue */
+    uint64_t pcount;            /* tasks given the CPU */
+    uint64_t migrations;        /* tasks placed here from another CPU */
+    uint64_t wakeup_hist[SCHED_STAT_LAT_BUCKETS];
+    uint64_t irq_time_ns;       /* time spent in hard interrupt handlers */
+};
+
+long schedctl(int op, int id, unsigned long arg);
+
+#endif /* _SYS_SCHEDCTL_H */
@@ -0,0 +1,31 @@
+#ifndef _SYS_SYSCALLSTAT_H
+#define _SYS_SYSCALLSTAT_H
+
+#include <stdint.h>
+
+/* syscallstat operations (LikeOS specific) */
+#define SYSCALLSTAT_ENABLE  0   /* syscallstat(ENABLE, pid, 0): zero, count pid (0 = all) */
+#define SYSCALLSTAT_DISABLE 1   /* stop counting, keep the counters */
+#define SYSCALLSTAT_RESET   2   /* zero all counters */
+#define SYSCALLSTAT_READ    3   /* syscallstat(READ, entries, count): syscalls copied */
+#define SYSCALLSTAT_TSC_HZ  4   /* returns the TSC frequency, 0 if unknown */
+
+/* Latency histogram: bucket 0 counts calls under 64 TSC cycles, bucket i
+ * those in [2^(i+5), 2^(i+6)) cycles, the last bucket everything longer */
+#define SYSCALLSTAT_BUCKETS 32
+
+/* Per-syscall totals for every syscall called since the last reset;
+ * times are TSC cycles from kernel entry to return */
+struct syscallstat_entry {
+    uint32_t nr;                /* syscall number */
+    uint32_t reserved;
+    uint64_t calls;
+    uint64_t errors;            /* calls that failed with an errno */
+    uint64_t time_total;
+    uint64_t time_max;
+    uint64_t hist[SYSCALLSTAT_BUCKETS];
+};
+
+long syscallstat(int op, unsigned long arg, unsigned long count);
+
+#endif /* _SYS_SYSCALLSTAT_H */
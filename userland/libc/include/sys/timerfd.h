@@ -0,0 +1,32 @@
+/*
+ * sys/timerfd.h - timers that notify through a file descriptor.
+ *
+ * read() on a timerfd returns the number of expirations since the last
+ * read as a uint64_t; the descriptor is readable once the timer fires.
+ */
+#ifndef _SYS_TIMERFD_H
+#define _SYS_TIMERFD_H
+
+#include <time.h>
+#include <signal.h>
+
+#define TFD_NONBLOCK            0x00800     /* O_NONBLOCK */
+#define TFD_CLOEXEC             0x80000     /* O_CLOEXEC */
+
+#define TFD_TIMER_ABSTIME       0x1
+#define TFD_TIMER_CANCEL_ON_SET 0x2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int timerfd_create(int clockid, int flags);
+int timerfd_settime(int fd, int flags, const struct itimerspec* new_value,
+                    struct itimerspec* old_value);
+int timerfd_gettime(int fd, struct itimerspec* curr_value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SYS_TIMERFD_H */
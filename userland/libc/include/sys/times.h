@@ -0,0 +1,18 @@
+/*
+ * sys/times.h - process CPU times in clock ticks (sysconf(_SC_CLK_TCK)).
+ */
+#ifndef _SYS_TIMES_H
+#define _SYS_TIMES_H
+
+#include <sys/types.h>
+
+struct tms {
+    clock_t tms_utime;      /* user CPU time */
+    clock_t tms_stime;      /* system CPU time */
+    clock_t tms_cutime;     /* user CPU time of reaped children */
+    clock_t tms_cstime;     /* system CPU time of reaped children */
+};
+
+clock_t times(struct tms* buf);
+
+#endif
@@ -29,6 +29,7 @@ typedef unsigned int   u_int32_t;
 typedef unsigned long  u_int64_t;
 
 typedef int64_t  off64_t;
+typedef int64_t  loff_t;
 typedef long     suseconds_t;
 typedef long     clock_t;
 typedef int      key_t;
@@ -12,12 +12,23 @@ struct iovec {
 };
 #endif
 
+/* preadv2() / pwritev2() flags */
+#define RWF_HIPRI   0x01
+#define RWF_DSYNC   0x02
+#define RWF_SYNC    0x04
+#define RWF_NOWAIT  0x08
+#define RWF_APPEND  0x10
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 ssize_t readv(int fd, const struct iovec* iov, int iovcnt);
 ssize_t writev(int fd, const struct iovec* iov, int iovcnt);
+ssize_t preadv(int fd, const struct iovec* iov, int iovcnt, off_t offset);
+ssize_t pwritev(int fd, const struct iovec* iov, int iovcnt, off_t offset);
+ssize_t preadv2(int fd, const struct iovec* iov, int iovcnt, off_t offset, int flags);
+ssize_t pwritev2(int fd, const struct iovec* iov, int iovcnt, off_t offset, int flags);
 
 #ifdef __cplusplus
 }
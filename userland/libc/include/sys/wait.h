@@ -29,6 +29,7 @@ struct rusage {
 
 #define RUSAGE_SELF     0
 #define RUSAGE_CHILDREN (-1)
+#define RUSAGE_THREAD   1
 
 pid_t wait(int* status);
 pid_t waitpid(pid_t pid, int* status, int options);
@@ -21,7 +21,11 @@ struct timespec {
 
 typedef int clockid_t;
 
+/* clock() units: microseconds of process CPU time, as POSIX requires */
+#define CLOCKS_PER_SEC  1000000L
+
 time_t time(time_t* tloc);
+clock_t clock(void);
 int clock_gettime(clockid_t clk_id, struct timespec* tp);
 int clock_getres(clockid_t clk_id, struct timespec* res);
 
@@ -15,6 +15,8 @@ ssize_t read(int fd, void* buf, size_t count);
 ssize_t write(int fd, const void* buf, size_t count);
 int close(int fd);
 off_t lseek(int fd, off_t offset, int whence);
+ssize_t pread(int fd, void* buf, size_t count, off_t offset);
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset);
 int pipe(int pipefd[2]);
 int pipe2(int pipefd[2], int flags);
 int getpagesize(void);
@@ -97,6 +99,7 @@ char* ptsname(int fd);
 
 // Scheduling
 int sched_yield(void);
+int nice(int inc);
 
 // Process operations
 pid_t getpid(void);
@@ -29,7 +29,7 @@ extern int errno;
 // TLS block layout (dynamic sizing)
 // The TLS block is allocated at the high end of the thread's stack region
 // Layout: [guard page] [stack grows down] ... [TLS block] [TCB at top]
-#define PTHREAD_TLS_ALIGN       16
+#define PTHREAD_TLS_ALIGN       32                  // struct rseq in the TCB
 #define PTHREAD_TCB_SIZE        256                 // Thread control block
 
 // Clone flags for thread creation
@@ -186,6 +186,9 @@ static void __pthread_init_main(void) {
     
     // Set TLS to point to main thread's TCB
     __set_tls(main);
+
+    // Register the main thread's rseq area
+    __rseq_register_thread(main);
     
     // Add to thread list
     main->next = main->prev = main;
@@ -203,6 +206,9 @@ static int __pthread_start(void* arg) {
     
     // Register robust futex list with kernel
     set_robust_list(&tcb->robust_list, sizeof(tcb->robust_list));
+
+    // Register the thread's rseq area
+    __rseq_register_thread(tcb);
     
     // Apply CPU affinity if specified
     if (tcb->cpuset_valid) {
@@ -10,6 +10,7 @@
 
 #include "../../include/pthread.h"
 #include "../../include/sched.h"
+#include "../../include/sys/rseq.h"
 
 // Maximum number of TSD keys (must match PTHREAD_KEYS_MAX)
 #define MAX_TSD_KEYS 128
@@ -53,6 +54,9 @@ struct __pthread {
     
     // Robust mutex list
     struct robust_list_head robust_list;
+
+    // Restartable sequences area (32-byte aligned, registered per thread)
+    struct rseq rseq;
     
     // Linked list of all threads (for cleanup)
     struct __pthread* next;
@@ -81,4 +85,7 @@ static inline struct __pthread* __pthread_self(void) {
 // TSD destructor caller (defined in pthread_tsd.c)
 extern void __pthread_tsd_run_destructors(void);
 
+// Register the thread's rseq area (defined in rseq.c)
+extern void __rseq_register_thread(struct __pthread* tcb);
+
 #endif /* _PTHREAD_INTERNAL_H */
@@ -0,0 +1,97 @@
+/*
+ * LikeOS-64 restartable sequences
+ *
+ * Per-thread rseq registration (done by the pthread start-up code) and the
+ * user-space fast paths built on it: sched_getcpu() and a per-CPU counter
+ * add that needs neither a lock nor a locked instruction.
+ */
+
+#include "../../include/sys/rseq.h"
+#include "../../include/sched.h"
+#include "../../include/pthread.h"
+#include "pthread_internal.h"
+
+// Register tcb->rseq for the calling thread.  A failure (old kernel,
+// seccomp, ...) is recorded in cpu_id so the fast paths fall back.
+void __rseq_register_thread(struct __pthread* tcb) {
+    tcb->rseq.cpu_id_start = 0;
+    tcb->rseq.cpu_id = RSEQ_CPU_ID_UNINITIALIZED;
+    tcb->rseq.rseq_cs = 0;
+    if (rseq(&tcb->rseq, sizeof(tcb->rseq), 0, RSEQ_SIG) < 0) {
+        tcb->rseq.cpu_id = RSEQ_CPU_ID_REGISTRATION_FAILED;
+    }
+}
+
+struct rseq* rseq_thread_area(void) {
+    struct __pthread* self = pthread_self();
+    if ((int32_t)*(volatile uint32_t*)&self->rseq.cpu_id < 0) {
+        return NULL;
+    }
+    return &self->rseq;
+}
+
+int sched_getcpu(void) {
+    struct rseq* rs = rseq_thread_area();
+    if (rs) {
+        return (int)*(volatile uint32_t*)&rs->cpu_id;
+    }
+    unsigned int cpu;
+    if (getcpu(&cpu, NULL) < 0) {
+        return -1;
+    }
+    return (int)cpu;
+}
+
+// One restartable add: *v += count if the thread is still on cpu.  The
+// descriptor goes in __rseq_cs, the abort stub (signature first) out of
+// line in __rseq_failure.  Returns -1 if the section was aborted or the
+// thread had already moved.
+static inline int rseq_addv(struct rseq* rs, intptr_t* v, intptr_t count, int cpu) {
+    __asm__ goto(
+        ".pushsection __rseq_cs, \"aw\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0x0, 0x0\n\t"
+        ".quad 1f, (2f - 1f), 4f\n\t"
+        ".popsection\n\t"
+        "leaq 3b(%%rip), %%rax\n\t"
+        "movq %%rax, %[rseq_cs]\n\t"
+        "1:\n\t"
+        "cmpl %[cpu], %[cpu_id]\n\t"
+        "jnz %l[abort]\n\t"
+        "addq %[count], %[v]\n\t"       // Commit
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        ".byte 0x0f, 0xb9, 0x3d\n\t"    // ud1 <sig>(%rip), %edi
+        ".long 0x53053053\n\t"          // RSEQ_SIG
+        "4:\n\t"
+        "jmp %l[abort]\n\t"
+        ".popsection\n\t"
+        :
+        : [cpu] "r"(cpu), [cpu_id] "m"(rs->cpu_id), [rseq_cs] "m"(rs->rseq_cs),
+          [v] "m"(*v), [count] "er"(count)
+        : "memory", "cc", "rax"
+        : abort);
+    return 0;
+abort:
+    return -1;
+}
+
+void rseq_percpu_add(intptr_t* base, size_t stride, intptr_t count) {
+    struct rseq* rs = rseq_thread_area();
+    if (rs) {
+        for (;;) {
+            int cpu = (int)*(volatile uint32_t*)&rs->cpu_id_start;
+            intptr_t* slot = (intptr_t*)((char*)base + (size_t)cpu * stride);
+            if (rseq_addv(rs, slot, count, cpu) == 0) {
+                return;
+            }
+        }
+    }
+
+    int cpu = sched_getcpu();
+    if (cpu < 0) {
+        cpu = 0;
+    }
+    __atomic_fetch_add((intptr_t*)((char*)base + (size_t)cpu * stride), count, __ATOMIC_RELAXED);
+}
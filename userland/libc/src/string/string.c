@@ -299,6 +299,7 @@ char* strerror(int errnum) {
         case 114: return "Operation already in progress";
         case 115: return "Operation now in progress";
         case 116: return "Stale file handle";
+        case 125: return "Operation canceled";
         case 130: return "Owner died";
         case 131: return "State not recoverable";
         default: {
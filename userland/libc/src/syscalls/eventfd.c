@@ -0,0 +1,43 @@
+/*
+ * eventfd.c - eventfd(2) and timerfd_create(2)/timerfd_settime(2)/
+ * timerfd_gettime(2).
+ */
+#include "../../include/sys/eventfd.h"
+#include "../../include/sys/timerfd.h"
+#include "../../include/unistd.h"
+#include "../../include/errno.h"
+#include "syscall.h"
+
+int eventfd(unsigned int initval, int flags) {
+    long ret = syscall2(SYS_EVENTFD2, (long)initval, (long)flags);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (int)ret;
+}
+
+int eventfd_read(int fd, eventfd_t* value) {
+    return read(fd, value, sizeof(*value)) == sizeof(*value) ? 0 : -1;
+}
+
+int eventfd_write(int fd, eventfd_t value) {
+    return write(fd, &value, sizeof(value)) == sizeof(value) ? 0 : -1;
+}
+
+int timerfd_create(int clockid, int flags) {
+    long ret = syscall2(SYS_TIMERFD_CREATE, (long)clockid, (long)flags);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (int)ret;
+}
+
+int timerfd_settime(int fd, int flags, const struct itimerspec* new_value,
+                    struct itimerspec* old_value) {
+    long ret = syscall4(SYS_TIMERFD_SETTIME, fd, (long)flags, (long)new_value,
+                        (long)old_value);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return 0;
+}
+
+int timerfd_gettime(int fd, struct itimerspec* curr_value) {
+    long ret = syscall2(SYS_TIMERFD_GETTIME, fd, (long)curr_value);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return 0;
+}
@@ -0,0 +1,23 @@
+/*
+ * io_uring.c - io_uring_setup(2) / io_uring_enter(2) syscall wrappers.
+ *
+ * These are the raw interfaces; <liburing.h> builds the ring mapping and
+ * SQE/CQE handling on top of them (src/syscalls/liburing.c).
+ */
+#include "../../include/sys/io_uring.h"
+#include "../../include/errno.h"
+#include "syscall.h"
+
+int io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    long ret = syscall2(SYS_IO_URING_SETUP, (long)entries, (long)p);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (int)ret;
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags, const void *sig) {
+    long ret = syscall5(SYS_IO_URING_ENTER, fd, (long)to_submit, (long)min_complete,
+                        (long)flags, (long)sig);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (int)ret;
+}
@@ -0,0 +1,123 @@
+/*
+ * liburing.c - ring setup, submission and completion helpers (<liburing.h>).
+ *
+ * The SQ/CQ ring header and the SQE array are mapped MAP_SHARED from the
+ * ring fd at the IORING_OFF_* offsets; with IORING_FEAT_SINGLE_MMAP one
+ * mapping covers both rings.  User space owns the SQ tail and the CQ head,
+ * the kernel the SQ head and the CQ tail.
+ */
+#include "../../include/liburing.h"
+#include "../../include/sys/mman.h"
+#include "../../include/unistd.h"
+#include "../../include/string.h"
+#include "../../include/errno.h"
+
+int io_uring_queue_init_params(unsigned entries, struct io_uring *ring,
+                               struct io_uring_params *p) {
+    memset(ring, 0, sizeof(*ring));
+    int fd = io_uring_setup(entries, p);
+    if (fd < 0) return -errno;
+
+    struct io_uring_sq *sq = &ring->sq;
+    struct io_uring_cq *cq = &ring->cq;
+    size_t sq_sz = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    size_t cq_sz = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    sq->ring_sz = sq_sz > cq_sz ? sq_sz : cq_sz;
+    sq->sqes_sz = p->sq_entries * sizeof(struct io_uring_sqe);
+
+    sq->ring_ptr = mmap(NULL, sq->ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        fd, (long)IORING_OFF_SQ_RING);
+    if (sq->ring_ptr == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        return -err;
+    }
+    sq->sqes = mmap(NULL, sq->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, (long)IORING_OFF_SQES);
+    if (sq->sqes == MAP_FAILED) {
+        int err = errno;
+        munmap(sq->ring_ptr, sq->ring_sz);
+        close(fd);
+        return -err;
+    }
+
+    char *base = sq->ring_ptr;
+    sq->khead = (unsigned *)(base + p->sq_off.head);
+    sq->ktail = (unsigned *)(base + p->sq_off.tail);
+    sq->kring_mask = (unsigned *)(base + p->sq_off.ring_mask);
+    sq->kring_entries = (unsigned *)(base + p->sq_off.ring_entries);
+    sq->kflags = (unsigned *)(base + p->sq_off.flags);
+    sq->kdropped = (unsigned *)(base + p->sq_off.dropped);
+    sq->array = (unsigned *)(base + p->sq_off.array);
+    cq->khead = (unsigned *)(base + p->cq_off.head);
+    cq->ktail = (unsigned *)(base + p->cq_off.tail);
+    cq->kring_mask = (unsigned *)(base + p->cq_off.ring_mask);
+    cq->kring_entries = (unsigned *)(base + p->cq_off.ring_entries);
+    cq->koverflow = (unsigned *)(base + p->cq_off.overflow);
+    cq->cqes = (struct io_uring_cqe *)(base + p->cq_off.cqes);
+
+    /* SQ slot i always names SQE i; get_sqe hands SQEs out in ring order */
+    for (unsigned i = 0; i < p->sq_entries; i++)
+        sq->array[i] = i;
+
+    ring->flags = p->flags;
+    ring->ring_fd = fd;
+    return 0;
+}
+
+int io_uring_queue_init(unsigned entries, struct io_uring *ring, unsigned flags) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = flags;
+    return io_uring_queue_init_params(entries, ring, &p);
+}
+
+void io_uring_queue_exit(struct io_uring *ring) {
+    munmap(ring->sq.sqes, ring->sq.sqes_sz);
+    munmap(ring->sq.ring_ptr, ring->sq.ring_sz);
+    close(ring->ring_fd);
+}
+
+struct io_uring_sqe *io_uring_get_sqe(struct io_uring *ring) {
+    struct io_uring_sq *sq = &ring->sq;
+    unsigned head = __atomic_load_n(sq->khead, __ATOMIC_ACQUIRE);
+    if (sq->sqe_tail - head >= *sq->kring_entries)
+        return NULL;
+    return &sq->sqes[sq->sqe_tail++ & *sq->kring_mask];
+}
+
+/* Make the SQEs handed out since the last flush visible to the kernel */
+static unsigned io_uring_flush_sq(struct io_uring *ring) {
+    struct io_uring_sq *sq = &ring->sq;
+    if (sq->sqe_head != sq->sqe_tail) {
+        sq->sqe_head = sq->sqe_tail;
+        __atomic_store_n(sq->ktail, sq->sqe_tail, __ATOMIC_RELEASE);
+    }
+    return sq->sqe_tail - __atomic_load_n(sq->khead, __ATOMIC_ACQUIRE);
+}
+
+int io_uring_submit_and_wait(struct io_uring *ring, unsigned wait_nr) {
+    unsigned submit = io_uring_flush_sq(ring);
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    int ret = io_uring_enter(ring->ring_fd, submit, wait_nr, flags, NULL);
+    return ret < 0 ? -errno : ret;
+}
+
+int io_uring_submit(struct io_uring *ring) {
+    return io_uring_submit_and_wait(ring, 0);
+}
+
+int io_uring_wait_cqe_nr(struct io_uring *ring, struct io_uring_cqe **cqe_ptr,
+                         unsigned wait_nr) {
+    for (;;) {
+        if (!wait_nr || io_uring_cq_ready(ring) >= wait_nr)
+            return io_uring_peek_cqe(ring, cqe_ptr);
+        /* Submit anything still pending; waiting also drives parked ops */
+        unsigned submit = io_uring_flush_sq(ring);
+        if (io_uring_enter(ring->ring_fd, submit, wait_nr,
+                           IORING_ENTER_GETEVENTS, NULL) < 0) {
+            *cqe_ptr = NULL;
+            return -errno;
+        }
+    }
+}
@@ -1,7 +1,13 @@
 #include "../../include/sys/mman.h"
 #include "../../include/errno.h"
+#include "../../include/fcntl.h"
+#include "../../include/unistd.h"
+#include "../../include/string.h"
 #include "syscall.h"
 
+#define SHM_DIR     "/dev/shm/"
+#define SHM_NAME_MAX 255           // NAME_MAX
+
 void* mmap(void* addr, size_t length, int prot, int flags, int fd, long offset) {
     long ret = syscall6(SYS_MMAP, (long)addr, length, prot, flags, fd, offset);
     if (ret < 0 && ret > -4096) {
@@ -28,3 +34,48 @@ int mprotect(void* addr, size_t len, int prot) {
     }
     return 0;
 }
+
+// "/name" -> "/dev/shm/name"; a name is one path component, the leading
+// slash optional as in glibc
+static int shm_path(const char* name, char* path, size_t size) {
+    while (*name == '/') {
+        name++;
+    }
+    size_t len = strlen(name);
+    if (len == 0 || strchr(name, '/') || strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (len > SHM_NAME_MAX || sizeof(SHM_DIR) + len > size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(path, SHM_DIR, sizeof(SHM_DIR) - 1);
+    memcpy(path + sizeof(SHM_DIR) - 1, name, len + 1);
+    return 0;
+}
+
+int shm_open(const char* name, int oflag, mode_t mode) {
+    char path[sizeof(SHM_DIR) + SHM_NAME_MAX];
+    if (shm_path(name, path, sizeof(path)) < 0) {
+        return -1;
+    }
+    return open(path, oflag | O_CLOEXEC, mode);
+}
+
+int shm_unlink(const char* name) {
+    char path[sizeof(SHM_DIR) + SHM_NAME_MAX];
+    if (shm_path(name, path, sizeof(path)) < 0) {
+        return -1;
+    }
+    return unlink(path);
+}
+
+int memfd_create(const char* name, unsigned int flags) {
+    long ret = syscall2(SYS_MEMFD_CREATE, (long)name, (long)flags);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return (int)ret;
+}
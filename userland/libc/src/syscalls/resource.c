@@ -1,13 +1,18 @@
 /*
- * resource.c - getrusage / getrlimit / setrlimit wrappers.
+ * resource.c - getrusage / times / clock and getrlimit / setrlimit wrappers.
  *
- * SYS_GETRUSAGE returns zeros today; the rlimit pair are pure userland
- * stubs reporting "no limit" since the kernel does not enforce per-task
- * resource limits.
+ * SYS_GETRUSAGE, SYS_TIMES and the CPU-time clocks report TSC-accurate
+ * user and system time for the process, the calling thread or the reaped
+ * children; the rlimit pair are pure userland stubs reporting "no limit"
+ * since the kernel does not enforce per-task resource limits.
+ * getpriority/setpriority/nice drive the scheduler's nice levels.
  */
 #include "../../include/sys/resource.h"
+#include "../../include/sys/times.h"
+#include "../../include/time.h"
 #include "../../include/string.h"
 #include "../../include/errno.h"
+#include "../../include/unistd.h"
 #include "syscall.h"
 
 int getrusage(int who, struct rusage* usage) {
@@ -17,6 +22,18 @@ int getrusage(int who, struct rusage* usage) {
     return 0;
 }
 
+clock_t times(struct tms* buf) {
+    long ret = syscall1(SYS_TIMES, (long)buf);
+    if (ret < 0) { errno = (int)-ret; return (clock_t)-1; }
+    return (clock_t)ret;
+}
+
+clock_t clock(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) < 0) return (clock_t)-1;
+    return (clock_t)(ts.tv_sec * CLOCKS_PER_SEC + ts.tv_nsec / (1000000000L / CLOCKS_PER_SEC));
+}
+
 int getrlimit(int resource, struct rlimit* rlim) {
     (void)resource;
     if (!rlim) { errno = EFAULT; return -1; }
@@ -29,3 +46,28 @@ int setrlimit(int resource, const struct rlimit* rlim) {
     (void)resource; (void)rlim;
     return 0;
 }
+
+/* The raw syscall returns 20 - nice (1..40) so errors stay distinguishable. */
+int getpriority(int which, id_t who) {
+    long ret = syscall2(SYS_GETPRIORITY, which, who);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return 20 - (int)ret;
+}
+
+int setpriority(int which, id_t who, int prio) {
+    long ret = syscall3(SYS_SETPRIORITY, which, who, prio);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return 0;
+}
+
+/* nice(2) has no syscall of its own; it is built on get/setpriority. */
+int nice(int inc) {
+    errno = 0;
+    int cur = getpriority(PRIO_PROCESS, 0);
+    if (cur == -1 && errno != 0) return -1;
+    int prio = cur + inc;
+    if (prio < PRIO_MIN) prio = PRIO_MIN;
+    if (prio > PRIO_MAX - 1) prio = PRIO_MAX - 1;
+    if (setpriority(PRIO_PROCESS, 0, prio) < 0) return -1;
+    return prio;
+}
@@ -1,5 +1,6 @@
 // LikeOS-64 Scheduling and SMP syscall wrappers
 #include "../../include/sched.h"
+#include "../../include/sys/rseq.h"
 #include "../../include/unistd.h"
 #include "../../include/errno.h"
 #include "syscall.h"
@@ -182,6 +183,26 @@ int get_robust_list(pid_t pid, void** head_ptr, size_t* len_ptr) {
     return 0;
 }
 
+// SYS_RSEQ - register or unregister the calling thread's rseq area
+int rseq(struct rseq* rseq, uint32_t rseq_len, int flags, uint32_t sig) {
+    long ret = syscall4(SYS_RSEQ, (long)rseq, rseq_len, flags, sig);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return 0;
+}
+
+// SYS_GETCPU - CPU and NUMA node of the caller (see also sched_getcpu)
+int getcpu(unsigned int* cpu, unsigned int* node) {
+    long ret = syscall2(SYS_GETCPU, (long)cpu, (long)node);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return 0;
+}
+
 // arch_prctl codes
 #define ARCH_SET_GS     0x1001
 #define ARCH_SET_FS     0x1002
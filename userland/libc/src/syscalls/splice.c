@@ -0,0 +1,28 @@
+/*
+ * splice.c - splice(2), tee(2) and vmsplice(2): move data between a pipe
+ * and another descriptor without copying it through user memory.
+ */
+#include "../../include/fcntl.h"
+#include "../../include/sys/uio.h"
+#include "../../include/errno.h"
+#include "syscall.h"
+
+ssize_t splice(int fd_in, loff_t* off_in, int fd_out, loff_t* off_out,
+               size_t len, unsigned int flags) {
+    long ret = syscall6(SYS_SPLICE, fd_in, (long)off_in, fd_out, (long)off_out,
+                        (long)len, (long)flags);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (ssize_t)ret;
+}
+
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags) {
+    long ret = syscall4(SYS_TEE, fd_in, fd_out, (long)len, (long)flags);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (ssize_t)ret;
+}
+
+ssize_t vmsplice(int fd, const struct iovec* iov, size_t nr_segs, unsigned int flags) {
+    long ret = syscall4(SYS_VMSPLICE, fd, (long)iov, (long)nr_segs, (long)flags);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (ssize_t)ret;
+}
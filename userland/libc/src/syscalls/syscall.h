@@ -180,6 +180,30 @@
 #define SYS_GETRUSAGE   383
 #define SYS_READV       384
 #define SYS_WRITEV      385
+#define SYS_GETPRIORITY 386
+#define SYS_SETPRIORITY 387
+#define SYS_SCHEDCTL    388
+#define SYS_LOCKSTAT    389
+#define SYS_TIMES       390
+#define SYS_RSEQ        391
+#define SYS_GETCPU      392
+#define SYS_SYSCALLSTAT 393
+#define SYS_IO_URING_SETUP 394
+#define SYS_IO_URING_ENTER 395
+#define SYS_SPLICE      396
+#define SYS_TEE         397
+#define SYS_VMSPLICE    398
+#define SYS_EVENTFD2    399
+#define SYS_TIMERFD_CREATE  400
+#define SYS_TIMERFD_SETTIME 401
+#define SYS_TIMERFD_GETTIME 402
+#define SYS_PREAD64     403
+#define SYS_PWRITE64    404
+#define SYS_PREADV      405
+#define SYS_PWRITEV     406
+#define SYS_PREADV2     407
+#define SYS_PWRITEV2    408
+#define SYS_MEMFD_CREATE 409
 
 // NET_GETINFO sub-commands
 #define NET_GET_ARP_TABLE       1
@@ -1,8 +1,10 @@
 /*
- * uio.c - readv(2) / writev(2) wrappers around the SYS_READV / SYS_WRITEV
- * scatter-gather syscalls.  The kernel implementation processes the iovecs
- * sequentially; partial-transfer semantics on errors mid-stream are
- * documented under POSIX.1-2017 §readv/writev "RETURN VALUE".
+ * uio.c - readv(2) / writev(2) and the positional preadv / pwritev family.
+ * The kernel hands all the iovecs to the file, pipe or socket at once;
+ * partial-transfer semantics on errors mid-stream are documented under
+ * POSIX.1-2017 §readv/writev "RETURN VALUE".  The p* calls leave the file
+ * offset alone; preadv2 / pwritev2 take offset -1 for "the file offset"
+ * and RWF_* flags.
  */
 #include "../../include/sys/uio.h"
 #include "../../include/errno.h"
@@ -19,3 +21,27 @@ ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
     if (ret < 0) { errno = (int)-ret; return -1; }
     return (ssize_t)ret;
 }
+
+ssize_t preadv(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+    long ret = syscall4(SYS_PREADV, fd, (long)iov, (long)iovcnt, offset);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (ssize_t)ret;
+}
+
+ssize_t pwritev(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+    long ret = syscall4(SYS_PWRITEV, fd, (long)iov, (long)iovcnt, offset);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (ssize_t)ret;
+}
+
+ssize_t preadv2(int fd, const struct iovec* iov, int iovcnt, off_t offset, int flags) {
+    long ret = syscall5(SYS_PREADV2, fd, (long)iov, (long)iovcnt, offset, flags);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (ssize_t)ret;
+}
+
+ssize_t pwritev2(int fd, const struct iovec* iov, int iovcnt, off_t offset, int flags) {
+    long ret = syscall5(SYS_PWRITEV2, fd, (long)iov, (long)iovcnt, offset, flags);
+    if (ret < 0) { errno = (int)-ret; return -1; }
+    return (ssize_t)ret;
+}
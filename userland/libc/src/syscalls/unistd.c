@@ -17,6 +17,9 @@
 #include "../../include/sys/ioctl.h"
 #include "../../include/sys/sysinfo.h"
 #include "../../include/sys/klog.h"
+#include "../../include/sys/schedctl.h"
+#include "../../include/sys/lockstat.h"
+#include "../../include/sys/syscallstat.h"
 #include "syscall.h"
 
 int errno = 0;
@@ -143,6 +146,24 @@ off_t lseek(int fd, off_t offset, int whence) {
     return ret;
 }
 
+ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+    long ret = syscall4(SYS_PREAD64, fd, (long)buf, count, offset);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
+
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset) {
+    long ret = syscall4(SYS_PWRITE64, fd, (long)buf, count, offset);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
+
 pid_t getpid(void) {
     return syscall0(SYS_GETPID);
 }
@@ -324,7 +345,7 @@ int ftruncate(int fd, off_t length) {
 
 int fcntl(int fd, int cmd, ...) {
     long arg = 0;
-    if (cmd == F_SETFL) {
+    if (cmd == F_SETFL || cmd == F_SETPIPE_SZ) {
         va_list ap;
         va_start(ap, cmd);
         arg = va_arg(ap, long);
@@ -598,6 +619,24 @@ int klogctl(int type, char *bufp, int len) {
     return (int)ret;
 }
 
+long schedctl(int op, int id, unsigned long arg) {
+    long ret = syscall3(SYS_SCHEDCTL, op, id, (long)arg);
+    if (ret < 0) { errno = -ret; return -1; }
+    return ret;
+}
+
+long lockstat(int op, struct lockstat_entry *buf, unsigned long count) {
+    long ret = syscall3(SYS_LOCKSTAT, op, (long)buf, (long)count);
+    if (ret < 0) { errno = -ret; return -1; }
+    return ret;
+}
+
+long syscallstat(int op, unsigned long arg, unsigned long count) {
+    long ret = syscall3(SYS_SYSCALLSTAT, op, (long)arg, (long)count);
+    if (ret < 0) { errno = -ret; return -1; }
+    return ret;
+}
+
 long fpathconf(int fd, int name) {
     (void)fd;
     switch (name) {